@@ -0,0 +1,255 @@
+#include "voipmonitor.h"
+
+#include "active_calls_log.h"
+#include "calltable.h"
+#include "tools.h"
+
+
+extern Calltable *calltable;
+extern unsigned int opt_listcalls_delta_refresh_ms;
+
+cActiveCallsLog activeCallsLog;
+
+
+cActiveCallsLog::sCallState::sCallState(unsigned fields_count) : rec(fields_count + 5) {
+	// + 5 - reserve for custom headers (as in getCallTableJson)
+	field_version = new FILE_LINE(0) u_int32_t[fields_count];
+	created_version = 0;
+	updated_version = 0;
+	refresh_version = 0;
+}
+
+cActiveCallsLog::sCallState::~sCallState() {
+	rec.free();
+	delete [] field_version;
+}
+
+cActiveCallsLog::cActiveCallsLog() {
+	field_names = NULL;
+	fields_count = 0;
+	version = 0;
+	base_version = 0;
+	refresh_at_ms = 0;
+	_sync = 0;
+}
+
+cActiveCallsLog::~cActiveCallsLog() {
+	clear();
+}
+
+string cActiveCallsLog::getDeltaJson(char *params, bool *zip) {
+	u_int32_t from_version = 0;
+	eFormat format = _json;
+	if(zip) {
+		*zip = false;
+	}
+	if(params && *params) {
+		JsonItem jsonParams;
+		jsonParams.parse(params);
+		if(jsonParams.getItem("seq")) {
+			from_version = atoll(jsonParams.getValue("seq").c_str());
+		}
+		if(jsonParams.getItem("format")) {
+			string formatParam = jsonParams.getValue("format");
+			std::transform(formatParam.begin(), formatParam.end(), formatParam.begin(), ::tolower);
+			if(formatParam == "compact") {
+				format = _compact;
+			}
+		}
+		if(zip && jsonParams.getItem("zip")) {
+			string zipParam = jsonParams.getValue("zip");
+			std::transform(zipParam.begin(), zipParam.end(), zipParam.begin(), ::tolower);
+			*zip = zipParam == "yes";
+		}
+	}
+	lock();
+	u_int64_t now_ms = getTimeMS();
+	if(!refresh_at_ms || now_ms < refresh_at_ms || now_ms - refresh_at_ms >= opt_listcalls_delta_refresh_ms) {
+		refresh();
+		refresh_at_ms = now_ms;
+	}
+	bool reset = !from_version || from_version < base_version || from_version > version;
+	string created;
+	string updated;
+	string closed_ids;
+	for(map<sCallKey, sCallState*>::iterator iter = calls.begin(); iter != calls.end(); iter++) {
+		sCallState *state = iter->second;
+		if(reset || state->created_version > from_version) {
+			addCreated(&created, state, format);
+		} else if(state->updated_version > from_version) {
+			addUpdated(&updated, state, from_version, format);
+		}
+	}
+	if(!reset) {
+		for(deque<sClosed>::reverse_iterator iter = closed.rbegin(); iter != closed.rend() && iter->version > from_version; iter++) {
+			if(!closed_ids.empty()) {
+				closed_ids += ",";
+			}
+			closed_ids += iter->id;
+		}
+	}
+	string rslt = "{\"seq\":" + intToString(version) +
+		      ",\"reset\":" + (reset ? "true" : "false");
+	if(reset && format == _compact) {
+		rslt += ",\"fields\":" + header;
+	}
+	rslt += ",\"created\":[" + created + "]" +
+		",\"updated\":[" + updated + "]" +
+		",\"closed\":[" + closed_ids + "]}";
+	unlock();
+	return(rslt);
+}
+
+void cActiveCallsLog::refresh() {
+	vector<string> names;
+	Call::getFieldNames(&names);
+	if(names.size() != fields_count) {
+		// changed custom headers - all clients get reset
+		clear();
+		fields_count = names.size();
+		field_names = new FILE_LINE(0) string[fields_count];
+		header = "[";
+		for(unsigned i = 0; i < fields_count; i++) {
+			field_names[i] = '"' + json_encode(names[i]) + '"';
+			if(i) {
+				header += ",";
+			}
+			header += field_names[i];
+		}
+		header += "]";
+		base_version = version + 1;
+	}
+	++version;
+	unsigned int now = time(NULL);
+	Call **active_calls = NULL;
+	u_int32_t active_calls_size = 0;
+	u_int32_t active_calls_count = calltable ? calltable->getActiveCalls(&active_calls, &active_calls_size, now) : 0;
+	for(unsigned i = 0; i < active_calls_count; i++) {
+		Call *call = active_calls[i];
+		sCallKey key;
+		key.call = call;
+		key.time_us = call->calltime_us();
+		map<sCallKey, sCallState*>::iterator iter = calls.find(key);
+		if(iter == calls.end()) {
+			sCallState *state = new FILE_LINE(0) sCallState(fields_count);
+			call->getRecordData(&state->rec);
+			state->id = state->rec.fields[0].getJson();
+			for(unsigned j = 0; j < fields_count; j++) {
+				state->field_version[j] = version;
+			}
+			state->created_version = version;
+			state->updated_version = version;
+			state->refresh_version = version;
+			calls[key] = state;
+		} else {
+			sCallState *state = iter->second;
+			RecordArray rec(fields_count + 5);
+			call->getRecordData(&rec);
+			for(unsigned j = 0; j < fields_count; j++) {
+				if(!(rec.fields[j] == state->rec.fields[j])) {
+					state->field_version[j] = version;
+					state->updated_version = version;
+				}
+			}
+			state->rec.free();
+			state->rec = rec;
+			state->refresh_version = version;
+		}
+		__SYNC_DEC(call->useInListCalls);
+	}
+	if(active_calls) {
+		delete [] active_calls;
+	}
+	for(map<sCallKey, sCallState*>::iterator iter = calls.begin(); iter != calls.end();) {
+		if(iter->second->refresh_version != version) {
+			sClosed closed_call;
+			closed_call.version = version;
+			closed_call.at_s = now;
+			closed_call.id = iter->second->id;
+			closed.push_back(closed_call);
+			delete iter->second;
+			calls.erase(iter++);
+		} else {
+			iter++;
+		}
+	}
+	cleanupClosed(now);
+}
+
+void cActiveCallsLog::clear() {
+	for(map<sCallKey, sCallState*>::iterator iter = calls.begin(); iter != calls.end(); iter++) {
+		delete iter->second;
+	}
+	calls.clear();
+	closed.clear();
+	if(field_names) {
+		delete [] field_names;
+		field_names = NULL;
+	}
+	fields_count = 0;
+}
+
+void cActiveCallsLog::cleanupClosed(u_int32_t now) {
+	while(closed.size() && closed.front().at_s + ACTIVE_CALLS_LOG_CLOSED_KEEP_S < now) {
+		// clients behind dropped closed calls have to reload all
+		if(closed.front().version >= base_version) {
+			base_version = closed.front().version + 1;
+		}
+		closed.pop_front();
+	}
+}
+
+void cActiveCallsLog::addCreated(string *str, sCallState *state, eFormat format) {
+	string rec_json;
+	if(format == _compact) {
+		rec_json = "[";
+		for(unsigned i = 0; i < fields_count; i++) {
+			if(i) {
+				rec_json += ",";
+			}
+			rec_json += state->rec.fields[i].getJson();
+		}
+		rec_json += "]";
+	} else {
+		rec_json = "{";
+		for(unsigned i = 0; i < fields_count; i++) {
+			if(i) {
+				rec_json += ",";
+			}
+			rec_json += field_names[i] + ":" + state->rec.fields[i].getJson();
+		}
+		rec_json += "}";
+	}
+	extern cUtfConverter utfConverter;
+	if(!utfConverter.check(rec_json.c_str())) {
+		rec_json = utfConverter.remove_no_ascii(rec_json.c_str());
+	}
+	if(!str->empty()) {
+		*str += ",";
+	}
+	*str += rec_json;
+}
+
+void cActiveCallsLog::addUpdated(string *str, sCallState *state, u_int32_t from_version, eFormat format) {
+	string rec_json = format == _compact ?
+			   "[" + state->id :
+			   "{" + field_names[0] + ":" + state->id;
+	for(unsigned i = 1; i < fields_count; i++) {
+		if(state->field_version[i] > from_version) {
+			if(format == _compact) {
+				rec_json += "," + intToString(i) + "," + state->rec.fields[i].getJson();
+			} else {
+				rec_json += "," + field_names[i] + ":" + state->rec.fields[i].getJson();
+			}
+		}
+	}
+	rec_json += format == _compact ? "]" : "}";
+	extern cUtfConverter utfConverter;
+	if(!utfConverter.check(rec_json.c_str())) {
+		rec_json = utfConverter.remove_no_ascii(rec_json.c_str());
+	}
+	if(!str->empty()) {
+		*str += ",";
+	}
+	*str += rec_json;
+}
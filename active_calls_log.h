@@ -0,0 +1,90 @@
+#ifndef ACTIVE_CALLS_LOG_H
+#define ACTIVE_CALLS_LOG_H
+
+
+#include <deque>
+#include <map>
+#include <string>
+#include <sys/types.h>
+
+#include "record_array.h"
+#include "tools_global.h"
+#include "sync.h"
+
+
+#define ACTIVE_CALLS_LOG_CLOSED_KEEP_S 300
+
+
+class Call;
+
+
+/*
+ versioned state of active calls for incremental listcalls (listcalls_delta)
+ - active calls are read at most once per opt_listcalls_delta_refresh_ms for all clients,
+   each refresh increments version and each field of each call keeps version of its last change
+ - client sends version (seq) of its last response and gets only calls created, fields updated and calls closed after it
+ - closed calls are kept in log for ACTIVE_CALLS_LOG_CLOSED_KEEP_S seconds, older seq (or seq from before restart) gets full snapshot (reset)
+ - format json (objects with field names) or compact (rows in order of field list, updates as index/value pairs)
+*/
+class cActiveCallsLog {
+public:
+	enum eFormat {
+		_json,
+		_compact
+	};
+	struct sCallKey {
+		Call *call;
+		u_int64_t time_us;
+		bool operator < (const sCallKey& other) const {
+			return(call < other.call ? true : call > other.call ? false :
+			       time_us < other.time_us);
+		}
+	};
+	struct sCallState {
+		sCallState(unsigned fields_count);
+		~sCallState();
+		RecordArray rec;
+		u_int32_t *field_version;
+		u_int32_t created_version;
+		u_int32_t updated_version;
+		u_int32_t refresh_version;
+		std::string id;
+	};
+	struct sClosed {
+		u_int32_t version;
+		u_int32_t at_s;
+		std::string id;
+	};
+public:
+	cActiveCallsLog();
+	~cActiveCallsLog();
+	std::string getDeltaJson(char *params, bool *zip = NULL);
+private:
+	void refresh();
+	void clear();
+	void cleanupClosed(u_int32_t now);
+	void addCreated(std::string *str, sCallState *state, eFormat format);
+	void addUpdated(std::string *str, sCallState *state, u_int32_t from_version, eFormat format);
+	void lock() {
+		__SYNC_LOCK_USLEEP(_sync, 100);
+	}
+	void unlock() {
+		__SYNC_UNLOCK(_sync);
+	}
+private:
+	std::map<sCallKey, sCallState*> calls;
+	std::deque<sClosed> closed;
+	std::string header;
+	std::string *field_names;
+	unsigned fields_count;
+	u_int32_t version;
+	u_int32_t base_version;
+	u_int64_t refresh_at_ms;
+	volatile int _sync;
+};
+
+
+extern cActiveCallsLog activeCallsLog;
+
+
+#endif //ACTIVE_CALLS_LOG_H
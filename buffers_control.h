@@ -12,6 +12,7 @@ public:
 		asyncwrite_size = 0;
 		pb_trash_minTime = -1;
 		pb_trash_maxTime = -1;
+		pb_compress_cpu_perc = -1;
 	}
 	void setMaxBufferMem(u_int64_t max_buffer_mem, bool orig = false) {
 		this->max_buffer_mem = max_buffer_mem;
@@ -76,6 +77,12 @@ public:
 	void sub__asyncwrite_size(size_t size) {
 		__sync_fetch_and_sub(&this->asyncwrite_size, size);
 	}
+	void set__pb_compress_cpu_perc(double cpu_perc) {
+		this->pb_compress_cpu_perc = cpu_perc;
+	}
+	double get__pb_compress_cpu_perc() {
+		return(this->pb_compress_cpu_perc);
+	}
 	bool check__pb__add_used(size_t add = 0) {
 		return(check() &&
 		       pb_used_size + 
@@ -150,6 +157,7 @@ private:
 	volatile u_int64_t asyncwrite_size;
 	unsigned long pb_trash_minTime;
 	unsigned long pb_trash_maxTime;
+	volatile double pb_compress_cpu_perc;
 };
 
 #endif
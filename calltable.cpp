@@ -186,6 +186,7 @@ extern bool opt_save_energylevels;
 extern bool opt_disable_cdr_fields_rtp;
 
 volatile int calls_counter = 0;
+volatile u_int64_t calls_counter_total = 0;
 volatile int calls_for_store_counter = 0;
 volatile int registers_counter = 0;
 
@@ -215,6 +216,7 @@ extern char opt_hide_message_content_secret[1024];
 extern vector<string> opt_message_body_url_reg;
 
 SqlDb *sqlDbSaveCall = NULL;
+cSqlDbArrayInsert *sqlDbSaveCallArrayInsert = NULL;
 SqlDb *sqlDbSaveSs7 = NULL;
 extern sExistsColumns existsColumns;
 
@@ -648,6 +650,7 @@ Call::Call(int call_type, char *call_id, unsigned long call_id_len, vector<strin
 	recordingpausedby182 = 0;
 	save_energylevels = false;
 	rtppacketsinqueue = 0;
+	rtp_hash_rcu_epoch = 0;
 	end_call_rtp = 0;
 	end_call_hash_removed = 0;
 	push_call_to_calls_queue = 0;
@@ -1344,6 +1347,9 @@ Call::refresh_data_ip_port(vmIP addr, vmPort port, struct timeval *ts,
 				}
 				this->ip_port[i].sdp_flags = sdp_flags;
 				calltable->lock_calls_hash();
+				#if HASH_RTP_FIND__RCU
+				calltable->hashUpdateSdpFlags(this, addr, port, &sdp_flags);
+				#else
 				node_call_rtp *n_call = calltable->hashfind_by_ip_port(addr, port, false);
 				if(n_call) {
 					#if (NEW_RTP_FIND__NODES && NEW_RTP_FIND__NODES__LIST) || HASH_RTP_FIND__LIST || NEW_RTP_FIND__MAP_LIST
@@ -1360,6 +1366,7 @@ Call::refresh_data_ip_port(vmIP addr, vmPort port, struct timeval *ts,
 					}
 					#endif
 				}
+				#endif
 				calltable->unlock_calls_hash();
 			}
 			if(sdp_flags.protocol == sdp_proto_srtp) {
@@ -4397,6 +4404,19 @@ string Call::getJsonHeader() {
 	return(header);
 }
 
+void Call::getFieldNames(vector<string> *names) {
+	for(unsigned i = 0; i < sizeof(callFields) / sizeof(callFields[0]); i++) {
+		names->push_back(callFields[i].fieldName);
+	}
+	if(custom_headers_cdr) {
+		list<string> headers;
+		custom_headers_cdr->getHeaders(&headers);
+		for(list<string>::iterator iter = headers.begin(); iter != headers.end(); iter++) {
+			names->push_back(*iter);
+		}
+	}
+}
+
 void Call::getRecordData(RecordArray *rec) {
 	unsigned i;
 	for(i = 0; i < sizeof(callFields) / sizeof(callFields[0]); i++) {
@@ -5942,6 +5962,9 @@ Call::saveToDb(bool enableBatchIfPossible) {
 		sqlDbSaveCall = createSqlObject();
 		sqlDbSaveCall->setEnableSqlStringInContent(true);
 	}
+	if(!sqlDbSaveCallArrayInsert) {
+		sqlDbSaveCallArrayInsert = new FILE_LINE(0) cSqlDbArrayInsert(sqlDbSaveCall);
+	}
 	
 	removeRTP_ifSetFlag();
 
@@ -5990,7 +6013,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 					      0);
 			++counterSqlStore;
 		} else {
-			sqlDbSaveCall->insert(sql_cdr_next_table, cdr_next);
+			sqlDbSaveCallArrayInsert->add(sql_cdr_next_table, &cdr_next);
 		}
 		return(0);
 	}
@@ -7784,7 +7807,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 				cdrproxy.add(cdrID, "cdr_ID");
 				cdrproxy.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_proxy_calldate_ms);
 				cdrproxy.add((vmIP)(*iter_undup), "dst", false, sqlDbSaveCall, sql_cdr_proxy_table.c_str());
-				sqlDbSaveCall->insert(sql_cdr_proxy_table, cdrproxy);
+				sqlDbSaveCallArrayInsert->add(sql_cdr_proxy_table, &cdrproxy);
 			}
 		}
 
@@ -7847,7 +7870,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 			if(existsColumns.cdr_rtp_calldate) {
 				rtps.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_rtp_calldate_ms);
 			}
-			sqlDbSaveCall->insert(sql_cdr_rtp_table, rtps);
+			sqlDbSaveCallArrayInsert->add(sql_cdr_rtp_table, &rtps);
 		}
 		
 		#if not EXPERIMENTAL_LITE_RTP_MOD
@@ -7877,7 +7900,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 						if(existsColumns.cdr_rtp_energylevels_calldate) {
 							rtp_el.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_rtp_energylevels_calldate_ms);
 						}
-						sqlDbSaveCall->insert(sql_cdr_rtp_energylevels_table, rtp_el);
+						sqlDbSaveCallArrayInsert->add(sql_cdr_rtp_energylevels_table, &rtp_el);
 						delete [] data_el_zip;
 					}
 					delete zip;
@@ -7898,7 +7921,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 					if(existsColumns.cdr_sdp_calldate) {
 						sdp.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_sdp_calldate_ms);
 					}
-					sqlDbSaveCall->insert(sql_cdr_sdp_table, sdp);
+					sqlDbSaveCallArrayInsert->add(sql_cdr_sdp_table, &sdp);
 				}
 			}
 		}
@@ -7913,7 +7936,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 				if(existsColumns.cdr_txt_calldate) {
 					txt.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_txt_calldate_ms);
 				}
-				sqlDbSaveCall->insert(sql_cdr_txt_table, txt);
+				sqlDbSaveCallArrayInsert->add(sql_cdr_txt_table, &txt);
 			}
 		}
 		
@@ -7937,7 +7960,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 				if(existsColumns.cdr_dtmf_calldate) {
 					dtmf.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_dtmf_calldate_ms);
 				}
-				sqlDbSaveCall->insert(sql_cdr_dtmf_table, dtmf);
+				sqlDbSaveCallArrayInsert->add(sql_cdr_dtmf_table, &dtmf);
 			}
 		}
 		
@@ -7949,7 +7972,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 			if(existsColumns.cdr_sipresp_calldate) {
 				sipresp.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_sipresp_calldate_ms);
 			}
-			sqlDbSaveCall->insert("cdr_sipresp", sipresp);
+			sqlDbSaveCallArrayInsert->add("cdr_sipresp", &sipresp);
 		}
 
 		if(_save_sip_history) {
@@ -7967,7 +7990,7 @@ Call::saveToDb(bool enableBatchIfPossible) {
 				if(existsColumns.cdr_siphistory_calldate) {
 					siphist.add_calldate(calltime_us(), "calldate", existsColumns.cdr_child_siphistory_calldate_ms);
 				}
-				sqlDbSaveCall->insert("cdr_siphistory", siphist);
+				sqlDbSaveCallArrayInsert->add("cdr_siphistory", &siphist);
 			}
 		}
 		
@@ -7982,18 +8005,18 @@ Call::saveToDb(bool enableBatchIfPossible) {
 		}
 
 		cdr_next.add(cdrID, "cdr_ID");
-		sqlDbSaveCall->insert(sql_cdr_next_table, cdr_next);
+		sqlDbSaveCallArrayInsert->add(sql_cdr_next_table, &cdr_next);
 		
 		for(unsigned i = 0; i < CDR_NEXT_MAX; i++) {
 			if(cdr_next_ch_name[i][0]) {
 				cdr_next_ch[i].add(cdrID, "cdr_ID");
-				sqlDbSaveCall->insert(cdr_next_ch_name[i], cdr_next_ch[i]);
+				sqlDbSaveCallArrayInsert->add(cdr_next_ch_name[i], &cdr_next_ch[i]);
 			}
 		}
 		
 		if(opt_cdr_country_code) {
 			cdr_country_code.add(cdrID, "cdr_ID");
-			sqlDbSaveCall->insert("cdr_country_code", cdr_country_code);
+			sqlDbSaveCallArrayInsert->add("cdr_country_code", &cdr_country_code);
 		}
 		
 		if(sql_cdr_table_last30d[0] ||
@@ -8001,13 +8024,13 @@ Call::saveToDb(bool enableBatchIfPossible) {
 		   sql_cdr_table_last1d[0]) {
 			cdr.add(cdrID, "ID");
 			if(sql_cdr_table_last30d[0]) {
-				sqlDbSaveCall->insert(sql_cdr_table_last30d, cdr);
+				sqlDbSaveCallArrayInsert->add(sql_cdr_table_last30d, &cdr);
 			}
 			if(sql_cdr_table_last7d[0]) {
-				sqlDbSaveCall->insert(sql_cdr_table_last7d, cdr);
+				sqlDbSaveCallArrayInsert->add(sql_cdr_table_last7d, &cdr);
 			}
 			if(sql_cdr_table_last1d[0]) {
-				sqlDbSaveCall->insert(sql_cdr_table_last1d, cdr);
+				sqlDbSaveCallArrayInsert->add(sql_cdr_table_last1d, &cdr);
 			}
 		}
 	}
@@ -8015,6 +8038,13 @@ Call::saveToDb(bool enableBatchIfPossible) {
 	return(cdrID <= 0);
 }
 
+void
+Call::flushSaveToDbArrayInsert() {
+	if(sqlDbSaveCallArrayInsert) {
+		sqlDbSaveCallArrayInsert->flush();
+	}
+}
+
 int
 Call::saveAloneByeToDb(bool enableBatchIfPossible) {
 	if(lastSIPresponseNum != 481 ||
@@ -9587,6 +9617,118 @@ void Ss7::init() {
 }
 
 
+cCallIdIndex::cCallIdIndex() {
+	for(unsigned i = 0; i < sizeof(shards) / sizeof(shards[0]); i++) {
+		shards[i].entries = new FILE_LINE(0) sEntry[CALL_ID_INDEX_SHARD_INIT_CAPACITY];
+		memset(shards[i].entries, 0, CALL_ID_INDEX_SHARD_INIT_CAPACITY * sizeof(sEntry));
+		shards[i].capacity = CALL_ID_INDEX_SHARD_INIT_CAPACITY;
+		shards[i].count = 0;
+		shards[i]._sync = 0;
+	}
+}
+
+cCallIdIndex::~cCallIdIndex() {
+	for(unsigned i = 0; i < sizeof(shards) / sizeof(shards[0]); i++) {
+		delete [] shards[i].entries;
+	}
+}
+
+void cCallIdIndex::add(Call *call) {
+	u_int64_t hash = cCallIdIndex::hash(call->call_id.data(), call->call_id.length());
+	lock(hash);
+	sShard *shard = &shards[hash >> (64 - CALL_ID_INDEX_SHARDS_BITS)];
+	if((shard->count + 1) * 4 > shard->capacity * 3) {
+		resize(shard, shard->capacity * 2);
+	}
+	u_int32_t mask = shard->capacity - 1;
+	u_int32_t pos = hash & mask;
+	for(; shard->entries[pos].hash; pos = (pos + 1) & mask) {
+		sEntry *entry = &shard->entries[pos];
+		if(entry->hash == hash &&
+		   entry->call->call_id == call->call_id) {
+			entry->call = call;
+			unlock(hash);
+			return;
+		}
+	}
+	shard->entries[pos].hash = hash;
+	shard->entries[pos].call = call;
+	++shard->count;
+	unlock(hash);
+}
+
+bool cCallIdIndex::remove(Call *call, bool only_if_not_in_preprocess) {
+	u_int64_t hash = cCallIdIndex::hash(call->call_id.data(), call->call_id.length());
+	lock(hash);
+	sShard *shard = &shards[hash >> (64 - CALL_ID_INDEX_SHARDS_BITS)];
+	u_int32_t mask = shard->capacity - 1;
+	u_int32_t pos = hash & mask;
+	for(; shard->entries[pos].hash; pos = (pos + 1) & mask) {
+		if(shard->entries[pos].call == call) {
+			break;
+		}
+	}
+	if(!shard->entries[pos].hash) {
+		unlock(hash);
+		return(true);
+	}
+	if(only_if_not_in_preprocess && call->in_preprocess_queue_before_process_packet > 0) {
+		// find_by_call_id caught the call between the check in cleanup and removal
+		unlock(hash);
+		return(false);
+	}
+	// backward shift deletion - keeps probe sequences without tombstones
+	u_int32_t hole = pos;
+	for(pos = (pos + 1) & mask; shard->entries[pos].hash; pos = (pos + 1) & mask) {
+		u_int32_t home = shard->entries[pos].hash & mask;
+		if(((pos - home) & mask) >= ((pos - hole) & mask)) {
+			shard->entries[hole] = shard->entries[pos];
+			hole = pos;
+		}
+	}
+	shard->entries[hole].hash = 0;
+	shard->entries[hole].call = NULL;
+	--shard->count;
+	unlock(hash);
+	return(true);
+}
+
+void cCallIdIndex::clear() {
+	for(unsigned i = 0; i < sizeof(shards) / sizeof(shards[0]); i++) {
+		while(__sync_lock_test_and_set(&shards[i]._sync, 1)) USLEEP(10);
+		memset(shards[i].entries, 0, shards[i].capacity * sizeof(sEntry));
+		shards[i].count = 0;
+		__sync_lock_release(&shards[i]._sync);
+	}
+}
+
+u_int32_t cCallIdIndex::size() {
+	u_int32_t size = 0;
+	for(unsigned i = 0; i < sizeof(shards) / sizeof(shards[0]); i++) {
+		size += shards[i].count;
+	}
+	return(size);
+}
+
+void cCallIdIndex::resize(sShard *shard, u_int32_t capacity) {
+	sEntry *entries = new FILE_LINE(0) sEntry[capacity];
+	memset(entries, 0, capacity * sizeof(sEntry));
+	u_int32_t mask = capacity - 1;
+	for(u_int32_t i = 0; i < shard->capacity; i++) {
+		if(shard->entries[i].hash) {
+			u_int32_t pos = shard->entries[i].hash & mask;
+			while(entries[pos].hash) {
+				pos = (pos + 1) & mask;
+			}
+			entries[pos] = shard->entries[i];
+		}
+	}
+	delete [] shard->entries;
+	shard->entries = entries;
+	shard->capacity = capacity;
+}
+
+
 /* constructor */
 Calltable::Calltable(SqlDb *sqlDb) {
 	/*
@@ -10322,6 +10464,16 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 
 #else
 
+#if HASH_RTP_FIND__RCU
+static void destroy_node_call_rtp(void *node) {
+	delete (node_call_rtp*)node;
+}
+
+static void destroy_node_call_rtp_ip_port(void *node) {
+	delete (node_call_rtp_ip_port*)node;
+}
+#endif
+
 inline node_call_rtp *insert_node_call(node_call_rtp *&begin, Call *call, int iscaller, int is_rtcp, s_sdp_flags *sdp_flags) {
 	__SYNC_INC(call->rtp_ip_port_counter);
 	#if CHECK_HASHTABLE_FOR_ALL_CALLS
@@ -10333,23 +10485,40 @@ inline node_call_rtp *insert_node_call(node_call_rtp *&begin, Call *call, int is
 	node_new->iscaller = iscaller;
 	node_new->is_rtcp = is_rtcp;
 	node_new->sdp_flags = *sdp_flags;
+	#if HASH_RTP_FIND__RCU
+	__sync_synchronize();
+	#endif
 	begin = node_new;
 	return(node_new);
 }
 
-inline void replace_node_call(node_call_rtp *node, Call *call, int iscaller, int is_rtcp, s_sdp_flags *sdp_flags) {
+inline void replace_node_call(node_call_rtp *&node, Call *call, int iscaller, int is_rtcp, s_sdp_flags *sdp_flags, cEpochRcu *rcu) {
 	__SYNC_INC(call->rtp_ip_port_counter);
 	__SYNC_DEC(node->call->rtp_ip_port_counter);
 	#if CHECK_HASHTABLE_FOR_ALL_CALLS
 	__SYNC_INC(call->rtp_ip_port_counter_add);
 	#endif
+	#if HASH_RTP_FIND__RCU
+	// lock-free readers can be inside the node - replace it by a copy
+	node_call_rtp *node_old = node;
+	node_call_rtp *node_new = new FILE_LINE(0) node_call_rtp;
+	node_new->next = node_old->next;
+	node_new->call = call;
+	node_new->iscaller = iscaller;
+	node_new->is_rtcp = is_rtcp;
+	node_new->sdp_flags = *sdp_flags;
+	__sync_synchronize();
+	node = node_new;
+	node_old->call->rtp_hash_rcu_epoch = rcu->retire(node_old, destroy_node_call_rtp);
+	#else
 	node->call = call;
 	node->iscaller = iscaller;
 	node->is_rtcp = is_rtcp;
 	node->sdp_flags = *sdp_flags;
+	#endif
 }
 
-inline node_call_rtp *delete_node_call(node_call_rtp *&begin, node_call_rtp *node, node_call_rtp *prev) {
+inline node_call_rtp *delete_node_call(node_call_rtp *&begin, node_call_rtp *node, node_call_rtp *prev, cEpochRcu *rcu) {
 	node_call_rtp *next = node->next;
 	if(prev) {
 		prev->next = next;
@@ -10357,21 +10526,53 @@ inline node_call_rtp *delete_node_call(node_call_rtp *&begin, node_call_rtp *nod
 		begin = next;
 	}
 	__SYNC_DEC(node->call->rtp_ip_port_counter);
+	#if HASH_RTP_FIND__RCU
+	node->call->rtp_hash_rcu_epoch = rcu->retire(node, destroy_node_call_rtp);
+	#else
 	delete node;
+	#endif
 	return(next);
 }
 
-inline node_call_rtp_ip_port *delete_node(node_call_rtp_ip_port *&begin, node_call_rtp_ip_port *node, node_call_rtp_ip_port *prev) {
+inline node_call_rtp_ip_port *delete_node(node_call_rtp_ip_port *&begin, node_call_rtp_ip_port *node, node_call_rtp_ip_port *prev, cEpochRcu *rcu) {
 	node_call_rtp_ip_port *next = node->next;
 	if(prev) {
 		prev->next = node->next;
 	} else {
 		begin = node->next;
 	}
+	#if HASH_RTP_FIND__RCU
+	rcu->retire(node, destroy_node_call_rtp_ip_port);
+	#else
 	delete node;
+	#endif
 	return(next);
 }
 
+#if HASH_RTP_FIND__RCU
+void
+Calltable::hashUpdateSdpFlags(Call *call, vmIP addr, vmPort port, s_sdp_flags *sdp_flags) {
+	// lock-free readers can be inside the nodes - replace them by copies with new sdp flags
+	u_int32_t h = tuplehash(addr.getHashNumber(), port);
+	for(node_call_rtp_ip_port *node = calls_hash[h]; node != NULL; node = node->next) {
+		if((node->port == port) && (node->addr == addr)) {
+			for(node_call_rtp **link = &node->calls; *link; link = &(*link)->next) {
+				if((*link)->call == call) {
+					node_call_rtp *node_old = *link;
+					node_call_rtp *node_new = new FILE_LINE(0) node_call_rtp;
+					*node_new = *node_old;
+					node_new->sdp_flags = *sdp_flags;
+					__sync_synchronize();
+					*link = node_new;
+					call->rtp_hash_rcu_epoch = calls_hash_rcu.retire(node_old, destroy_node_call_rtp);
+				}
+			}
+			break;
+		}
+	}
+}
+#endif
+
 void
 Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int iscaller, int is_rtcp, s_sdp_flags sdp_flags, bool useLock) {
  
@@ -10404,7 +10605,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 						     << node_call->call->call_id << " " << addr.getString() << ":" << port.getString() << " " 
 						     << endl;
 					}
-					node_call = delete_node_call(node->calls, node_call, prev_node_call);
+					node_call = delete_node_call(node->calls, node_call, prev_node_call, &calls_hash_rcu);
 					continue;
 				}
 				prev_node_call = node_call;
@@ -10417,7 +10618,7 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 			}
 			if(!found) {
 				if(opt_sdp_multiplication == 0 && count == 1 && node->calls && node->calls->call) {
-					replace_node_call(node->calls, call, iscaller, is_rtcp, &sdp_flags);
+					replace_node_call(node->calls, call, iscaller, is_rtcp, &sdp_flags, &calls_hash_rcu);
 				} else {
 					if(opt_sdp_multiplication > 0 && count >= opt_sdp_multiplication) {
 						// this port/ip combination is already in (opt_sdp_multiplication) calls - do not add to (opt_sdp_multiplication+1)th to not cause multiplication attack. 
@@ -10462,9 +10663,11 @@ Calltable::_hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int isc
 	node->port = port;
 	node->next = calls_hash[h];
 	node->calls = NULL;
-	calls_hash[h] = node;
-	
 	insert_node_call(node->calls, call, iscaller, is_rtcp, &sdp_flags);
+	#if HASH_RTP_FIND__RCU
+	__sync_synchronize();
+	#endif
+	calls_hash[h] = node;
 	
 	if (useLock) unlock_calls_hash();
 	
@@ -10773,14 +10976,14 @@ Calltable::_hashRemove(Call *call, vmIP addr, vmPort port, bool rtcp, bool ignor
 			for (node_call = node->calls; node_call != NULL; node_call = node_call->next) {
 				// walk through all calls under the node and check if the call matches
 				if(node_call->call == call && (ignore_rtcp_check || !rtcp || (rtcp && (node_call->is_rtcp || !node_call->sdp_flags.rtcp_mux)))) {
-					delete_node_call(node->calls, node_call, prev_node_call);
+					delete_node_call(node->calls, node_call, prev_node_call, &calls_hash_rcu);
 					++removeCounter;
 					break;
 				}
 				prev_node_call = node_call;
 			}
 			if(node->calls == NULL) {
-				delete_node(calls_hash[h], node, prev_node);
+				delete_node(calls_hash[h], node, prev_node, &calls_hash_rcu);
 			}
 			break;
 		}
@@ -10937,7 +11140,7 @@ Calltable::_hashRemove(Call *call, bool use_lock) {
 				prev_node_call = NULL;
 				for(node_call = node->calls; node_call != NULL;) {
 					if(node_call->call == call) {
-						node_call = delete_node_call(node->calls, node_call, prev_node_call);
+						node_call = delete_node_call(node->calls, node_call, prev_node_call, &calls_hash_rcu);
 						++removeCounter;
 					} else {
 						prev_node_call = node_call;
@@ -10945,7 +11148,7 @@ Calltable::_hashRemove(Call *call, bool use_lock) {
 					}
 				}
 				if(node->calls == NULL) {
-					node = delete_node(calls_hash[h], node, prev_node);
+					node = delete_node(calls_hash[h], node, prev_node, &calls_hash_rcu);
 				} else {
 					prev_node = node;
 					node = node->next;
@@ -10989,6 +11192,9 @@ Calltable::_applyHashModifyQueue(bool setBegin, bool use_lock_calls_hash) {
 			if (use_lock_calls_hash) unlock_calls_hash();
 			hash_modify_queue.clear();
 			hash_modify_queue_begin_ms = 0;
+			#if HASH_RTP_FIND__RCU
+			calls_hash_rcu.reclaim();
+			#endif
 		}
 	} else {
 		if(setBegin) {
@@ -11022,7 +11228,11 @@ string Calltable::getHashStats() {
 	return("nodes: " + intToString(count_use_nodes) + "\n" +
 	       "max size: " + intToString(max_node_size) + "\n" +
 	       "sum size: " + intToString(sum_nodes_size) + "\n" + 
-	       "avg size: " + (count_use_nodes ? floatToString((double)sum_nodes_size / count_use_nodes, 1) : "-") + "\n");
+	       "avg size: " + (count_use_nodes ? floatToString((double)sum_nodes_size / count_use_nodes, 1) : "-") + "\n"
+	       #if HASH_RTP_FIND__RCU
+	       + calls_hash_rcu.getStatString()
+	       #endif
+	       );
 	#endif
 }
 
@@ -11432,6 +11642,94 @@ Calltable::mgcpCleanupStream(Call *call) {
 	}
 }
 
+u_int32_t
+Calltable::getActiveCalls(Call ***active_calls, u_int32_t *active_calls_size, unsigned int now) {
+	// returned calls are locked by useInListCalls
+	u_int32_t active_calls_count = 0;
+	*active_calls_size = getCountCalls();
+	if(*active_calls_size) {
+		*active_calls_size += *active_calls_size / 4;
+		*active_calls = new FILE_LINE(0) Call*[*active_calls_size];
+		active_calls_count = 0;
+		for(int passTypeCall = 0; passTypeCall < 2; passTypeCall++) {
+			int typeCall = passTypeCall == 0 ? INVITE : MGCP;
+			for(int passListMap = -1; passListMap < (typeCall == INVITE && useCallFindX() ? preProcessPacketCallX_count : 0); passListMap++) {
+				map<string, Call*> *_calls_listMAP;
+				list<Call*>::iterator callIT1;
+				map<string, Call*>::iterator callMAPIT1;
+				map<sStreamIds2, Call*>::iterator callMAPIT2;
+				if(typeCall == INVITE) {
+					if(opt_call_id_alternative[0]) {
+						lock_calls_listMAP();
+						callIT1 = calltable->calls_list.begin();
+					} else {
+						if(passListMap == -1) {
+							lock_calls_listMAP();
+							_calls_listMAP = &calls_listMAP;
+						} else {
+							lock_calls_listMAP_X(passListMap);
+							_calls_listMAP = &calls_listMAP_X[passListMap];
+						}
+						callMAPIT1 = _calls_listMAP->begin();
+					}
+				} else {
+					lock_calls_listMAP();
+					callMAPIT2 = calltable->calls_by_stream_callid_listMAP.begin();
+				}
+				while(typeCall == INVITE ? 
+				       (opt_call_id_alternative[0] ?
+					 callIT1 != calltable->calls_list.end() :
+					 callMAPIT1 != _calls_listMAP->end()) : 
+				       callMAPIT2 != calltable->calls_by_stream_callid_listMAP.end()) {
+					Call *call;
+					if(typeCall == INVITE) {
+						call = opt_call_id_alternative[0] ? *callIT1 : callMAPIT1->second;
+					} else {
+						call = (*callMAPIT2).second;
+					}
+					extern int opt_blockcleanupcalls;
+					if(!(call->exclude_from_active_calls or
+					     call->attemptsClose or
+					     call->typeIs(REGISTER) or call->typeIsOnly(MESSAGE) or 
+					     (call->seenbye and call->seenbyeandok) or
+					     (!opt_blockcleanupcalls &&
+					      ((call->destroy_call_at and call->destroy_call_at < now) or 
+					       (call->destroy_call_at_bye and call->destroy_call_at_bye < now) or 
+					       (call->destroy_call_at_bye_confirmed and call->destroy_call_at_bye_confirmed < now))))) {
+						if(active_calls_count < *active_calls_size) {
+							(*active_calls)[active_calls_count++] = call;
+							__SYNC_INC(call->useInListCalls);
+						}
+					}
+					if(typeCall == INVITE) {
+						if(opt_call_id_alternative[0]) {
+							++callIT1;
+						} else {
+							++callMAPIT1;
+						}
+					} else {
+						++callMAPIT2;
+					}
+				}
+				if(typeCall == INVITE) {
+					if(opt_call_id_alternative[0]) {
+						unlock_calls_listMAP();
+					} else {
+						if(passListMap == -1) {
+							unlock_calls_listMAP();
+						} else {
+							unlock_calls_listMAP_X(passListMap);
+						}
+					}
+				} else {
+					unlock_calls_listMAP();
+				}
+			}
+		}
+	}
+	return(active_calls_count);
+}
+
 string 
 Calltable::getCallTableJson(char *params, bool *zip) {
  
@@ -11537,87 +11835,7 @@ Calltable::getCallTableJson(char *params, bool *zip) {
 	}
 	
 	if(!active_calls) {
-		active_calls_size = getCountCalls();
-		if(active_calls_size) {
-			active_calls_size += active_calls_size / 4;
-			active_calls = new FILE_LINE(0) Call*[active_calls_size];
-			active_calls_count = 0;
-			for(int passTypeCall = 0; passTypeCall < 2; passTypeCall++) {
-				int typeCall = passTypeCall == 0 ? INVITE : MGCP;
-				for(int passListMap = -1; passListMap < (typeCall == INVITE && useCallFindX() ? preProcessPacketCallX_count : 0); passListMap++) {
-					map<string, Call*> *_calls_listMAP;
-					list<Call*>::iterator callIT1;
-					map<string, Call*>::iterator callMAPIT1;
-					map<sStreamIds2, Call*>::iterator callMAPIT2;
-					if(typeCall == INVITE) {
-						if(opt_call_id_alternative[0]) {
-							lock_calls_listMAP();
-							callIT1 = calltable->calls_list.begin();
-						} else {
-							if(passListMap == -1) {
-								lock_calls_listMAP();
-								_calls_listMAP = &calls_listMAP;
-							} else {
-								lock_calls_listMAP_X(passListMap);
-								_calls_listMAP = &calls_listMAP_X[passListMap];
-							}
-							callMAPIT1 = _calls_listMAP->begin();
-						}
-					} else {
-						lock_calls_listMAP();
-						callMAPIT2 = calltable->calls_by_stream_callid_listMAP.begin();
-					}
-					while(typeCall == INVITE ? 
-					       (opt_call_id_alternative[0] ?
-						 callIT1 != calltable->calls_list.end() :
-						 callMAPIT1 != _calls_listMAP->end()) : 
-					       callMAPIT2 != calltable->calls_by_stream_callid_listMAP.end()) {
-						Call *call;
-						if(typeCall == INVITE) {
-							call = opt_call_id_alternative[0] ? *callIT1 : callMAPIT1->second;
-						} else {
-							call = (*callMAPIT2).second;
-						}
-						extern int opt_blockcleanupcalls;
-						if(!(call->exclude_from_active_calls or
-						     call->attemptsClose or
-						     call->typeIs(REGISTER) or call->typeIsOnly(MESSAGE) or 
-						     (call->seenbye and call->seenbyeandok) or
-						     (!opt_blockcleanupcalls &&
-						      ((call->destroy_call_at and call->destroy_call_at < now) or 
-						       (call->destroy_call_at_bye and call->destroy_call_at_bye < now) or 
-						       (call->destroy_call_at_bye_confirmed and call->destroy_call_at_bye_confirmed < now))))) {
-							if(active_calls_count < active_calls_size) {
-								active_calls[active_calls_count++] = call;
-								__SYNC_INC(call->useInListCalls);
-							}
-						}
-						if(typeCall == INVITE) {
-							if(opt_call_id_alternative[0]) {
-								++callIT1;
-							} else {
-								++callMAPIT1;
-							}
-						} else {
-							++callMAPIT2;
-						}
-					}
-					if(typeCall == INVITE) {
-						if(opt_call_id_alternative[0]) {
-							unlock_calls_listMAP();
-						} else {
-							if(passListMap == -1) {
-								unlock_calls_listMAP();
-							} else {
-								unlock_calls_listMAP_X(passListMap);
-							}
-						}
-					} else {
-						unlock_calls_listMAP();
-					}
-				}
-			}
-		}
+		active_calls_count = getActiveCalls(&active_calls, &active_calls_size, now);
 	}
 	
 	if(opt_processing_limitations && opt_processing_limitations_active_calls_cache &&
@@ -11848,6 +12066,8 @@ Calltable::add(int call_type, char *call_id, unsigned long call_id_len, vector<s
 						calls_listMAP[(*call_id_alternative)[i]] = newcall;
 					}
 				}
+			} else {
+				calls_listMAP_index.add(newcall);
 			}
 			newcall->calls_counter_inc();
 			unlock_calls_listMAP();
@@ -11932,6 +12152,7 @@ struct sCleanupCallsStat {
 			if(rejected_hash_or_rtppacketsinqueue) str << "rejected_hash_or_rtppacketsinqueue " << rejected_hash_or_rtppacketsinqueue << endl;
 			if(rejected_set_stop_processing) str << "rejected_set_stop_processing " << rejected_set_stop_processing << endl;
 			if(rejected_wait_for_stop_processing) str << "rejected_wait_for_stop_processing " << rejected_wait_for_stop_processing << endl;
+			if(rejected_in_preprocess) str << "rejected_in_preprocess " << rejected_in_preprocess << endl;
 			if(ok) str << "ok " << ok << endl;
 			str << "*** cleanup calls stat - end ***" << endl;
 		}
@@ -11957,6 +12178,7 @@ struct sCleanupCallsStat {
 	u_int32_t rejected_hash_or_rtppacketsinqueue;
 	u_int32_t rejected_set_stop_processing;
 	u_int32_t rejected_wait_for_stop_processing;
+	u_int32_t rejected_in_preprocess;
 	u_int32_t ok;
 };
 
@@ -12002,6 +12224,10 @@ Calltable::cleanup_calls(bool closeAll, u_int32_t packet_time_s, const char *fil
 		syslog(LOG_NOTICE, "call Calltable::cleanup_calls");
 	}
 	
+	#if HASH_RTP_FIND__RCU
+	calls_hash_rcu.reclaim();
+	#endif
+	
 	unsigned closeCallsMax = getCountCalls();
 	if(!closeCallsMax) {
 		return 0;
@@ -12081,6 +12307,7 @@ Calltable::cleanup_calls(bool closeAll, u_int32_t packet_time_s, const char *fil
 				}
 				// rtptimeout seconds of inactivity will save this call and remove from call table
 				bool closeCall = false;
+				int in_preprocess_queue_before_process_packet = call->in_preprocess_queue_before_process_packet;
 				if(closeAll || call->force_close) {
 					closeCall = true;
 					if(!isReadFromFile) {
@@ -12088,7 +12315,7 @@ Calltable::cleanup_calls(bool closeAll, u_int32_t packet_time_s, const char *fil
 					}
 				} else if(call->typeIs(SKINNY_NEW) ||
 					  call->typeIs(MGCP) ||
-					  call->in_preprocess_queue_before_process_packet <= 0 ||
+					  in_preprocess_queue_before_process_packet <= 0 ||
 					  (!isReadFromFile &&
 					   (call->in_preprocess_queue_before_process_packet_at[0] && call->in_preprocess_queue_before_process_packet_at[0] < currTimeS_unshift - 300 &&
 					    call->in_preprocess_queue_before_process_packet_at[1] && call->in_preprocess_queue_before_process_packet_at[1] < (getTimeMS_rdtsc() / 1000) - 300))) {
@@ -12202,6 +12429,9 @@ Calltable::cleanup_calls(bool closeAll, u_int32_t packet_time_s, const char *fil
 					if(!closeAll &&
 					   ((opt_hash_modify_queue_length_ms && call->hash_queue_counter > 0) ||
 					    call->rtppacketsinqueue > 0 ||
+					    #if HASH_RTP_FIND__RCU
+					    !calls_hash_rcu.isGracePeriodElapsed(call->rtp_hash_rcu_epoch) ||
+					    #endif
 					    call->useInListCalls 
 					    #if CONFERENCE_LEGS_MOD_WITHOUT_TABLE_CDR_CONFERENCE
 					    || call->conference_active
@@ -12236,6 +12466,15 @@ Calltable::cleanup_calls(bool closeAll, u_int32_t packet_time_s, const char *fil
 						}
 					}
 				}
+				if(closeCall && typeCall == INVITE && !opt_call_id_alternative[0] && passListMap == -1) {
+					if(!calls_listMAP_index.remove(call, !closeAll && !call->force_close &&
+									      !call->typeIs(SKINNY_NEW) && !call->typeIs(MGCP) &&
+									      in_preprocess_queue_before_process_packet <= 0)) {
+						closeCall = false;
+						++rejectedCalls_count;
+						++stat.rejected_in_preprocess;
+					}
+				}
 				if(closeCall) {
 				 
 					++stat.ok;
@@ -12385,12 +12624,16 @@ Calltable::cleanup_calls_separate_processing_rtp() {
 		if(closeCall) {
 			call->removeFindTables(true);
 			if((opt_hash_modify_queue_length_ms && call->hash_queue_counter > 0) ||
+			   #if HASH_RTP_FIND__RCU
+			   !calls_hash_rcu.isGracePeriodElapsed(call->rtp_hash_rcu_epoch) ||
+			   #endif
 			   call->rtppacketsinqueue > 0) {
 				closeCall = false;
 			}
 		}
 		if(closeCall) {
 			close_calls.push_back(call);
+			calls_listMAP_index.remove(call);
 			calls_listMAP.erase(iter++);
 		} else {
 			iter++;
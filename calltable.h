@@ -18,6 +18,12 @@
 #define NEW_RTP_FIND__NODES__PORT_MODE 1
 #define NEW_RTP_FIND__NODES__LIST 0
 #define HASH_RTP_FIND__LIST 0
+#define HASH_RTP_FIND__RCU 1
+
+#if NEW_RTP_FIND__NODES || NEW_RTP_FIND__PORT_NODES || NEW_RTP_FIND__MAP_LIST || HASH_RTP_FIND__LIST
+#undef HASH_RTP_FIND__RCU
+#define HASH_RTP_FIND__RCU 0
+#endif
 
 
 #include <queue>
@@ -45,6 +51,8 @@
 #include "record_array.h"
 #include "calltable_base.h"
 #include "dtls.h"
+#include "dedup.h"
+#include "rcu.h"
 
 
 #define MAX_IP_PER_CALL 40	//!< total maxumum of SDP sessions for one call-id
@@ -1146,6 +1154,7 @@ public:
 	
 	int last_sip_method;
 	volatile int rtppacketsinqueue;
+	volatile u_int64_t rtp_hash_rcu_epoch;
 	volatile int end_call_rtp;
 	volatile int end_call_hash_removed;
 	volatile int push_call_to_calls_queue;
@@ -1535,6 +1544,7 @@ public:
 	*/
 	int saveToDb(bool enableBatchIfPossible = true);
 	int saveAloneByeToDb(bool enableBatchIfPossible = true);
+	static void flushSaveToDbArrayInsert();
 
 	/**
 	 * @brief save register msgs to database
@@ -1880,8 +1890,10 @@ public:
 	
 	void calls_counter_inc() {
 		extern volatile int calls_counter;
+		extern volatile u_int64_t calls_counter_total;
 		if(typeIs(INVITE) || typeIs(MESSAGE) || typeIs(MGCP)) {
 			__sync_add_and_fetch(&calls_counter, 1);
+			__sync_add_and_fetch(&calls_counter_total, 1);
 			set_call_counter = true;
 		}
 	}
@@ -2246,6 +2258,7 @@ public:
 	
 	void getValue(eCallField field, RecordArrayField *rfield);
 	static string getJsonHeader();
+	static void getFieldNames(vector<string> *names);
 	void getRecordData(RecordArray *rec);
 	string getJsonData();
 	void setRtpThreadNum();
@@ -2603,6 +2616,65 @@ struct sChartsCallData {
 };
 
 
+#define CALL_ID_INDEX_SHARDS_BITS 6
+#define CALL_ID_INDEX_SHARD_INIT_CAPACITY 256
+
+/**
+  * Sharded open-addressing index Call-ID -> Call* for calls_listMAP.
+  * Lookups take only the lock of one shard, modifications are done under lock_calls_listMAP + shard lock.
+*/
+
+class cCallIdIndex {
+private:
+	struct sEntry {
+		u_int64_t hash;
+		Call *call;
+	};
+	struct sShard {
+		sEntry *entries;
+		u_int32_t capacity;
+		u_int32_t count;
+		volatile int _sync;
+		char _filler[64 - sizeof(sEntry*) - sizeof(u_int32_t) * 2 - sizeof(int)];
+	};
+public:
+	cCallIdIndex();
+	~cCallIdIndex();
+	static inline u_int64_t hash(const char *call_id, unsigned call_id_len) {
+		u_int64_t hash = dedup_hash64(call_id, call_id_len);
+		return(hash ? hash : 1);
+	}
+	inline void lock(u_int64_t hash) {
+		sShard *shard = &shards[hash >> (64 - CALL_ID_INDEX_SHARDS_BITS)];
+		while(__sync_lock_test_and_set(&shard->_sync, 1)) USLEEP(10);
+	}
+	inline void unlock(u_int64_t hash) {
+		__sync_lock_release(&shards[hash >> (64 - CALL_ID_INDEX_SHARDS_BITS)]._sync);
+	}
+	inline Call *find_locked(u_int64_t hash, const char *call_id, unsigned call_id_len) {
+		sShard *shard = &shards[hash >> (64 - CALL_ID_INDEX_SHARDS_BITS)];
+		u_int32_t mask = shard->capacity - 1;
+		for(u_int32_t pos = hash & mask; shard->entries[pos].hash; pos = (pos + 1) & mask) {
+			sEntry *entry = &shard->entries[pos];
+			if(entry->hash == hash &&
+			   entry->call->call_id.length() == call_id_len &&
+			   !memcmp(entry->call->call_id.data(), call_id, call_id_len)) {
+				return(entry->call);
+			}
+		}
+		return(NULL);
+	}
+	void add(Call *call);
+	bool remove(Call *call, bool only_if_not_in_preprocess = false);
+	void clear();
+	u_int32_t size();
+private:
+	void resize(sShard *shard, u_int32_t capacity);
+private:
+	sShard shards[1 << CALL_ID_INDEX_SHARDS_BITS];
+};
+
+
 /**
   * This class implements operations on Call list
 */
@@ -2697,6 +2769,7 @@ public:
 	queue<string> files_sqlqueue; //!< this queue is used for asynchronous storing CDR by the worker thread
 	list<Call*> calls_list;
 	map<string, Call*> calls_listMAP;
+	cCallIdIndex calls_listMAP_index;
 	map<string, Call*> *calls_listMAP_X;
 	map<sStreamIds2, Call*> calls_by_stream_callid_listMAP;
 	map<sStreamId2, Call*> calls_by_stream_id2_listMAP;
@@ -2810,6 +2883,21 @@ public:
 	Call *find_by_call_id(char *call_id, unsigned long call_id_len, vector<string> *call_id_alternative, time_t time) {
 		extern char opt_call_id_alternative[256];
 		Call *rslt_call = NULL;
+		if(!opt_call_id_alternative[0]) {
+			if(!call_id_len) {
+				call_id_len = strlen(call_id);
+			}
+			u_int64_t hash = cCallIdIndex::hash(call_id, call_id_len);
+			calls_listMAP_index.lock(hash);
+			rslt_call = calls_listMAP_index.find_locked(hash, call_id, call_id_len);
+			if(rslt_call && time) {
+				__sync_add_and_fetch(&rslt_call->in_preprocess_queue_before_process_packet, 1);
+				rslt_call->in_preprocess_queue_before_process_packet_at[0] = time;
+				rslt_call->in_preprocess_queue_before_process_packet_at[1] = getTimeMS_rdtsc() / 1000;
+			}
+			calls_listMAP_index.unlock(hash);
+			return(rslt_call);
+		}
 		string call_idS = call_id_len ? string(call_id, call_id_len) : string(call_id);
 		lock_calls_listMAP();
 		map<string, Call*>::iterator callMAPIT = calls_listMAP.find(call_idS);
@@ -3032,6 +3120,9 @@ public:
 	void hashAdd(vmIP addr, vmPort port, u_int64_t time_us, Call* call, int iscaller, int isrtcp, s_sdp_flags sdp_flags);
 	inline void _hashAdd(vmIP addr, vmPort port, long int time_s, Call* call, int iscaller, int isrtcp, s_sdp_flags sdp_flags, bool use_lock = true);
 	void _hashAddExt(vmIP addr, vmPort port, long int time_s, Call* call, int iscaller, int isrtcp, s_sdp_flags sdp_flags, bool use_lock = true);
+	#if HASH_RTP_FIND__RCU
+	void hashUpdateSdpFlags(Call *call, vmIP addr, vmPort port, s_sdp_flags *sdp_flags);
+	#endif
 
 	/**
 	 * @brief find call
@@ -3258,6 +3349,7 @@ public:
 	void mgcpCleanupTransactions(Call *call);
 	void mgcpCleanupStream(Call *call);
 	
+	u_int32_t getActiveCalls(Call ***active_calls, u_int32_t *active_calls_size, unsigned int now);
 	string getCallTableJson(char *params, bool *zip = NULL);
 	
 	void lock_calls_hash() {
@@ -3269,6 +3361,24 @@ public:
 	void unlock_calls_hash() {
 		__sync_lock_release(&this->_sync_lock_calls_hash);
 	}
+	bool lock_calls_hash_read() {
+		#if HASH_RTP_FIND__RCU
+		if(calls_hash_rcu.read_lock()) {
+			return(true);
+		}
+		#endif
+		lock_calls_hash();
+		return(false);
+	}
+	void unlock_calls_hash_read(bool rcu) {
+		#if HASH_RTP_FIND__RCU
+		if(rcu) {
+			calls_hash_rcu.read_unlock();
+			return;
+		}
+		#endif
+		unlock_calls_hash();
+	}
 	
 	void addSystemCommand(const char *command);
 	
@@ -3295,6 +3405,7 @@ private:
 	#else
 	node_call_rtp_ip_port *calls_hash[MAXNODE];
 	#endif
+	cEpochRcu calls_hash_rcu;
 	volatile int _sync_lock_calls_hash;
 	volatile int _sync_lock_calls_listMAP;
 	volatile int *_sync_lock_calls_listMAP_X;
@@ -10,6 +10,8 @@ extern int opt_charts_cache_max_threads;
 extern bool opt_cdr_stat_values;
 extern bool opt_cdr_stat_sources;
 extern int opt_cdr_stat_interval;
+extern int opt_charts_percentile;
+extern double opt_charts_percentile_sketch_accuracy;
 
 
 static sChartTypeDef ChartTypeDef[] = { 
@@ -95,6 +97,13 @@ cChartDataItem::cChartDataItem() {
 	this->countConected = 0;
 	this->sumDuration = 0;
 	this->countShort = 0;
+	this->values_sketch = NULL;
+}
+
+cChartDataItem::~cChartDataItem() {
+	if(this->values_sketch) {
+		delete this->values_sketch;
+	}
 }
 
 void cChartDataItem::add(sChartsCallData *call, 
@@ -125,7 +134,14 @@ void cChartDataItem::add(sChartsCallData *call,
 		}
 		if(!value_null && (value || series->def.enableZero)) {
 			if(series->def.percType != _chartPercType_NA) {
-				++this->values[value];
+				if(opt_charts_percentile == 1) {
+					if(!this->values_sketch) {
+						this->values_sketch = new FILE_LINE(0) cChartPercSketch;
+					}
+					this->values_sketch->add(value, series->def.percType == _chartPercType_Desc);
+				} else {
+					++this->values[value];
+				}
 			}
 			if(value > this->max) {
 				this->max = value;
@@ -254,30 +270,33 @@ string cChartDataItem::json(cChartSeries *series) {
 			exp.add("i", floatToString(this->min, precision_base, true), JsonExport::_number);
 			exp.add("s", floatToString(this->sum, precision_base, true), JsonExport::_number);
 			exp.add("c", this->count);
-			unsigned values_size = 0;
-			for(map<float, unsigned>::iterator iter = this->values.begin(); iter != this->values.end(); iter++) {
-				values_size += iter->second;
-			}
+			unsigned values_size = getValuesSize();
 			if(values_size) {
 				for(unsigned i = 0; i < 2; i++) {
 					int perc = i == 0 ? 95 : 99;
 					float perc_rslt = getPerc(perc, series->def.percType, values_size);
 					exp.add(i == 0 ? "p5" : "p9", floatToString(perc_rslt, precision_base, true), JsonExport::_number);
 				}
+				map<float, unsigned> valuesSketch;
+				map<float, unsigned> *values = &this->values;
+				if(this->values_sketch) {
+					this->values_sketch->getValues(&valuesSketch);
+					values = &valuesSketch;
+				}
 				map<float, unsigned> valuesReduk;
 				map<float, unsigned> *valuesRslt;
 				unsigned int maxValuesPartsForPercentile = series->typeUse == _chartTypeUse_chartCache ? 
 									    chartsCache->maxValuesPartsForPercentile :
 									    cdrStat->maxValuesPartsForPercentile;
 				if(values_size > maxValuesPartsForPercentile && 
-				   (this->values.size() / maxValuesPartsForPercentile) > 1) {
+				   (values->size() / maxValuesPartsForPercentile) > 1) {
 					unsigned counter = 0;
 					float s_v = 0;
 					unsigned s_c = 0;
-					for(map<float, unsigned>::iterator iter = this->values.begin(); iter != this->values.end(); iter++) {
+					for(map<float, unsigned>::iterator iter = values->begin(); iter != values->end(); iter++) {
 						float v_v = iter->first;
 						unsigned v_c = iter->second;
-						if(counter && !(counter % (this->values.size() / maxValuesPartsForPercentile))) {
+						if(counter && !(counter % (values->size() / maxValuesPartsForPercentile))) {
 							float new_v = s_v / s_c;
 							valuesReduk[new_v] += s_c;
 							s_v = 0;
@@ -293,7 +312,7 @@ string cChartDataItem::json(cChartSeries *series) {
 					}
 					valuesRslt = &valuesReduk;
 				} else {
-					valuesRslt = &this->values;
+					valuesRslt = values;
 				}
 				stringstream vm_stream;
 				vm_stream << setprecision(precision_vm);
@@ -426,9 +445,13 @@ double cChartDataItem::getValue(class cChartSeries *series, eChartValueType type
 }
 
 double cChartDataItem::getPerc(unsigned perc, eChartPercType type, unsigned values_size) {
+	if(this->values_sketch) {
+		return(this->values_sketch->getPerc(perc, type == _chartPercType_Desc, values_size));
+	}
 	if(!values_size) {
-		for(map<float, unsigned>::iterator iter = this->values.begin(); iter != this->values.end(); iter++) {
-			values_size += iter->second;
+		values_size = getValuesSize();
+		if(!values_size) {
+			return(0);
 		}
 	}
 	unsigned percIndex = ::min((unsigned)round((double)values_size * perc / 100), values_size - 1);
@@ -455,6 +478,17 @@ double cChartDataItem::getPerc(unsigned perc, eChartPercType type, unsigned valu
 	return(perc_rslt);
 }
 
+unsigned cChartDataItem::getValuesSize() {
+	if(this->values_sketch) {
+		return(this->values_sketch->getCount());
+	}
+	unsigned values_size = 0;
+	for(map<float, unsigned>::iterator iter = this->values.begin(); iter != this->values.end(); iter++) {
+		values_size += iter->second;
+	}
+	return(values_size);
+}
+
 
 cChartDataMultiseriesItem::cChartDataMultiseriesItem() {
 }
@@ -2371,6 +2405,7 @@ bool cmpValCondEqLeft(const char *val1, const char *val2) {
 
 
 void chartsCacheInit(SqlDb *sqlDb) {
+	cChartPercSketch::setParameters(opt_charts_percentile_sketch_accuracy / 100, CHART_PERC_SKETCH_MAX_BINS);
 	cCharts *_chartsCache = new FILE_LINE(0) cCharts();
 	if(!opt_nocdr) {
 		_chartsCache->load(sqlDb);
@@ -2466,6 +2501,7 @@ void chartsCacheInitIntervals() {
 
 
 void cdrStatInit(SqlDb *sqlDb) {
+	cChartPercSketch::setParameters(opt_charts_percentile_sketch_accuracy / 100, CHART_PERC_SKETCH_MAX_BINS);
 	cdrStat = new FILE_LINE(0) cCdrStat();
 }
 
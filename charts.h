@@ -10,6 +10,7 @@
 #include "sql_db.h"
 #include "calltable.h"
 #include "tools_global.h"
+#include "charts_sketch.h"
 
 
 using namespace std;
@@ -142,6 +143,7 @@ struct sChartTypeDef {
 class cChartDataItem {
 public:
 	cChartDataItem();
+	~cChartDataItem();
 	void add(sChartsCallData *call, unsigned call_interval, bool firstInterval, bool lastInterval, bool beginInInterval,
 		 class cChartSeries *series, class cChartIntervalSeriesData *intervalSeries,
 		 u_int32_t calldate_from, u_int32_t calldate_to);
@@ -149,11 +151,13 @@ public:
 	double getValue(class cChartSeries *series, eChartValueType typeValue = _chartValueType_na, bool *null = NULL);
 private:
 	double getPerc(unsigned perc, eChartPercType type, unsigned values_size = 0);
+	unsigned getValuesSize();
 private:
 	volatile double max;
 	volatile double min;
 	volatile double sum;
 	map<float, unsigned> values;
+	cChartPercSketch *values_sketch;
 	volatile unsigned int count;
 	map<unsigned int, unsigned int> count_intervals;
 	volatile unsigned int countAll;
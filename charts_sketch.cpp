@@ -0,0 +1,137 @@
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "charts_sketch.h"
+
+
+#define CHART_PERC_SKETCH_KEY_OFFSET (1 << 20)
+#define CHART_PERC_SKETCH_MIN_VALUE 1e-9
+// value range (max / min) which fits in max_bins without joining
+#define CHART_PERC_SKETCH_MIN_RANGE 1e6
+
+double cChartPercSketch::gamma = 1.01 / 0.99;
+double cChartPercSketch::gamma_log = log(1.01 / 0.99);
+unsigned cChartPercSketch::max_bins = CHART_PERC_SKETCH_MAX_BINS;
+
+cChartPercSketch::cChartPercSketch() {
+}
+
+void cChartPercSketch::add(double value, bool desc, unsigned count) {
+	addToKey(keyFromValue(value), desc, count);
+}
+
+double cChartPercSketch::getPerc(unsigned perc, bool desc, unsigned values_size) {
+	if(!values_size) {
+		values_size = getCount();
+		if(!values_size) {
+			return(0);
+		}
+	}
+	unsigned percIndex = ::min((unsigned)round((double)values_size * perc / 100), values_size - 1);
+	unsigned count = 0;
+	if(!desc) {
+		for(unsigned i = 0; i < bins.size(); i++) {
+			if(percIndex < count + bins[i].count) {
+				return(valueFromKey(bins[i].key));
+			}
+			count += bins[i].count;
+		}
+	} else {
+		for(int i = bins.size() - 1; i >= 0; i--) {
+			if(percIndex < count + bins[i].count) {
+				return(valueFromKey(bins[i].key));
+			}
+			count += bins[i].count;
+		}
+	}
+	return(0);
+}
+
+void cChartPercSketch::getValues(map<float, unsigned> *values) {
+	for(unsigned i = 0; i < bins.size(); i++) {
+		(*values)[valueFromKey(bins[i].key)] += bins[i].count;
+	}
+}
+
+unsigned cChartPercSketch::getCount() {
+	unsigned count = 0;
+	for(unsigned i = 0; i < bins.size(); i++) {
+		count += bins[i].count;
+	}
+	return(count);
+}
+
+void cChartPercSketch::setParameters(double relativeAccuracy, unsigned maxBins) {
+	if(relativeAccuracy < 0.0001) {
+		relativeAccuracy = 0.0001;
+	} else if(relativeAccuracy > 0.5) {
+		relativeAccuracy = 0.5;
+	}
+	gamma = (1 + relativeAccuracy) / (1 - relativeAccuracy);
+	gamma_log = log(gamma);
+	// with small accuracy fixed maxBins would cover narrow range and joining reaches p95/p99
+	max_bins = ::max(::max(maxBins, 16u), (unsigned)ceil(log(CHART_PERC_SKETCH_MIN_RANGE) / gamma_log));
+}
+
+void cChartPercSketch::addToKey(int32_t key, bool desc, unsigned count) {
+	unsigned lo = 0;
+	unsigned hi = bins.size();
+	while(lo < hi) {
+		unsigned mid = (lo + hi) / 2;
+		if(bins[mid].key < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if(lo < bins.size() && bins[lo].key == key) {
+		bins[lo].count += count;
+		return;
+	}
+	sBin bin;
+	bin.key = key;
+	bin.count = count;
+	bins.insert(bins.begin() + lo, bin);
+	if(bins.size() > max_bins) {
+		collapse(desc);
+	}
+}
+
+void cChartPercSketch::collapse(bool desc) {
+	// percentiles are taken from upper (asc) or lower (desc) tail - join bins on the opposite side
+	while(bins.size() > max_bins) {
+		if(desc) {
+			bins[bins.size() - 2].count += bins[bins.size() - 1].count;
+			bins.pop_back();
+		} else {
+			bins[1].count += bins[0].count;
+			bins.erase(bins.begin());
+		}
+	}
+}
+
+int32_t cChartPercSketch::keyFromValue(double value) {
+	double value_abs = fabs(value);
+	if(value_abs < CHART_PERC_SKETCH_MIN_VALUE) {
+		return(0);
+	}
+	int32_t index = (int32_t)ceil(log(value_abs) / gamma_log);
+	if(index >= CHART_PERC_SKETCH_KEY_OFFSET) {
+		index = CHART_PERC_SKETCH_KEY_OFFSET - 1;
+	} else if(index <= -CHART_PERC_SKETCH_KEY_OFFSET) {
+		index = -CHART_PERC_SKETCH_KEY_OFFSET + 1;
+	}
+	return(value > 0 ? 
+		index + CHART_PERC_SKETCH_KEY_OFFSET : 
+		-(index + CHART_PERC_SKETCH_KEY_OFFSET));
+}
+
+double cChartPercSketch::valueFromKey(int32_t key) {
+	if(!key) {
+		return(0);
+	}
+	int32_t index = abs(key) - CHART_PERC_SKETCH_KEY_OFFSET;
+	double value = 2 * pow(gamma, index) / (gamma + 1);
+	return(key > 0 ? value : -value);
+}
@@ -0,0 +1,49 @@
+#ifndef CHARTS_SKETCH_H
+#define CHARTS_SKETCH_H
+
+
+#include <sys/types.h>
+#include <map>
+#include <vector>
+
+
+#define CHART_PERC_SKETCH_MAX_BINS 1024
+
+
+using namespace std;
+
+
+/**
+  * Logarithmic quantile sketch (DDSketch style) for percentiles of chart series.
+  * Values are counted in buckets [gamma^(k-1), gamma^k], reported value of bucket has relative error <= (gamma-1)/(gamma+1).
+  * Over max_bins buckets, buckets on the tail opposite to the percentile direction are joined,
+  * max_bins is raised for small accuracy so that it always covers values range 1:10^6.
+*/
+
+class cChartPercSketch {
+public:
+	struct sBin {
+		int32_t key;
+		u_int32_t count;
+	};
+public:
+	cChartPercSketch();
+	void add(double value, bool desc, unsigned count = 1);
+	double getPerc(unsigned perc, bool desc, unsigned values_size = 0);
+	void getValues(map<float, unsigned> *values);
+	unsigned getCount();
+	static void setParameters(double relativeAccuracy, unsigned maxBins);
+private:
+	void addToKey(int32_t key, bool desc, unsigned count);
+	void collapse(bool desc);
+	static int32_t keyFromValue(double value);
+	static double valueFromKey(int32_t key);
+private:
+	vector<sBin> bins;
+	static double gamma;
+	static double gamma_log;
+	static unsigned max_bins;
+};
+
+
+#endif //CHARTS_SKETCH_H
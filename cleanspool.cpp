@@ -1,6 +1,7 @@
 #include "voipmonitor.h"
 #include <algorithm>
 #include <errno.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -30,12 +31,16 @@ extern int opt_newdir;
 extern int opt_pcap_split;
 extern int opt_pcap_dump_tar;
 extern bool opt_cleanspool_use_files;
+extern bool opt_cleanspool_index;
 
 
 #define DISABLE_CLEANSPOOL ((suspended && !critical_low_space) || do_convert_filesindex_flag)
 #define ENCODE_FIELD_SEPARATOR ";"
 #define ENCODE_DATA_SEPARATOR "|"
 #define CACHE_NAME ".cleanspool_cache"
+#define CACHE_INDEX_NAME ".cleanspool_index"
+#define CACHE_INDEX_HEADER "cleanspool_index 1"
+#define CACHE_INDEX_COMPACT_MIN_RECORDS 10000
 
 
 string CleanSpool::sSpoolDataDirIndex::encode_hour() {
@@ -129,6 +134,16 @@ void CleanSpool::cSpoolData::getSumSizeByDate(map<string, long long> *sizeByDate
 	}
 }
 
+void CleanSpool::cSpoolData::getSizeByDateHour(map<u_int32_t, sSpoolHourSize> *sizeByDateHour) {
+	sizeByDateHour->clear();
+	for(map<sSpoolDataDirIndex, sSpoolDataDirItem>::iterator iter = data.begin(); iter != data.end(); iter++) {
+		if(!iter->second.is_dir && iter->first.hour >= 0) {
+			u_int32_t datehour = CleanSpool::date_to_int(iter->first.date.c_str()) * 100 + iter->first.hour;
+			(*sizeByDateHour)[datehour].size[cSpoolIndex::getTypeClass(iter->first._type)] += iter->second.size;
+		}
+	}
+}
+
 map<CleanSpool::sSpoolDataDirIndex, CleanSpool::sSpoolDataDirItem>::iterator CleanSpool::cSpoolData::getBegin() {
 	return(data.begin());
 }
@@ -317,6 +332,349 @@ void CleanSpool::cSpoolData::eraseDir(string dir) {
 }
 
 
+CleanSpool::cSpoolIndex::cSpoolIndex() {
+	fd = -1;
+	memset(sum_size, 0, sizeof(sum_size));
+	log_records = 0;
+	loaded = false;
+	pthread_mutex_init(&_sync, NULL);
+}
+
+CleanSpool::cSpoolIndex::~cSpoolIndex() {
+	closeFile();
+	pthread_mutex_destroy(&_sync);
+}
+
+bool CleanSpool::cSpoolIndex::load() {
+	lock();
+	closeFile();
+	hours.clear();
+	for(int i = 0; i < _tc_end; i++) {
+		hours_by_class[i].clear();
+	}
+	memset(sum_size, 0, sizeof(sum_size));
+	log_records = 0;
+	loaded = false;
+	FILE *indexf = fopen(fileName.c_str(), "r");
+	if(!indexf) {
+		unlock();
+		return(false);
+	}
+	bool okHeader = false;
+	bool tornRecord = false;
+	char line[1024];
+	while(fgets(line, sizeof(line), indexf)) {
+		size_t length = strlen(line);
+		if(!length || line[length - 1] != '\n') {
+			// incomplete last record after crash
+			tornRecord = true;
+			break;
+		}
+		line[length - 1] = 0;
+		if(!okHeader) {
+			if(strcmp(line, CACHE_INDEX_HEADER)) {
+				break;
+			}
+			okHeader = true;
+			continue;
+		}
+		char type;
+		u_int32_t datehour;
+		int typeClass;
+		long long size;
+		if(line[0] == 'A' &&
+		   sscanf(line, "%c %u %i %lli", &type, &datehour, &typeClass, &size) == 4 &&
+		   typeClass >= 0 && typeClass < _tc_end) {
+			addHourSize(datehour, typeClass, size);
+		} else if(line[0] == 'D' &&
+			  sscanf(line, "%c %u %i", &type, &datehour, &typeClass) == 3) {
+			for(int i = 0; i < _tc_end; i++) {
+				if(typeClass & (1 << i)) {
+					eraseHourSize(datehour, i);
+				}
+			}
+		} else {
+			continue;
+		}
+		++log_records;
+	}
+	fclose(indexf);
+	if(!okHeader) {
+		unlock();
+		return(false);
+	}
+	loaded = true;
+	if(tornRecord) {
+		syslog(LOG_NOTICE, "cleanspool index: ignored incomplete record in %s", fileName.c_str());
+		writeSnapshot();
+	}
+	mergePendingRecords();
+	unlock();
+	return(true);
+}
+
+void CleanSpool::cSpoolIndex::add(u_int32_t datehour, eTypeSpoolFile typeSpoolFile, long long size) {
+	int typeClass = getTypeClass(typeSpoolFile);
+	lock();
+	if(!loaded) {
+		// memory is replaced by load / rebuild - record is kept for merge
+		sPendingRecord pendingRecord = { 'A', datehour, typeClass, size };
+		pending_records.push_back(pendingRecord);
+		addHourSize(datehour, typeClass, size);
+		unlock();
+		return;
+	}
+	char record[100];
+	snprintf(record, sizeof(record), "A %u %i %lli\n", datehour, typeClass, size);
+	if(appendRecord(record)) {
+		addHourSize(datehour, typeClass, size);
+	}
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::erase(u_int32_t datehour, bool sip, bool rtp, bool graph, bool audio) {
+	int typeClassMask = (sip ? 1 << _tc_sip : 0) |
+			    (rtp ? 1 << _tc_rtp : 0) |
+			    (graph ? 1 << _tc_graph : 0) |
+			    (audio ? 1 << _tc_audio : 0);
+	lock();
+	if(!loaded) {
+		sPendingRecord pendingRecord = { 'D', datehour, typeClassMask, 0 };
+		pending_records.push_back(pendingRecord);
+	} else {
+		char record[100];
+		snprintf(record, sizeof(record), "D %u %i\n", datehour, typeClassMask);
+		appendRecord(record);
+	}
+	for(int i = 0; i < _tc_end; i++) {
+		if(typeClassMask & (1 << i)) {
+			eraseHourSize(datehour, i);
+		}
+	}
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::rebuildBegin() {
+	// records during directory walk are kept in memory and merged after snapshot of walk result
+	// (file finished during walk can be counted twice - cleaning starts rather earlier than later)
+	lock();
+	loaded = false;
+	closeFile();
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::rebuild(cSpoolData *spoolData) {
+	map<u_int32_t, sSpoolHourSize> sizeByDateHour;
+	spoolData->getSizeByDateHour(&sizeByDateHour);
+	lock();
+	hours.clear();
+	for(int i = 0; i < _tc_end; i++) {
+		hours_by_class[i].clear();
+	}
+	memset(sum_size, 0, sizeof(sum_size));
+	for(map<u_int32_t, sSpoolHourSize>::iterator iter = sizeByDateHour.begin(); iter != sizeByDateHour.end(); iter++) {
+		for(int i = 0; i < _tc_end; i++) {
+			if(iter->second.size[i]) {
+				addHourSize(iter->first, i, iter->second.size[i]);
+			}
+		}
+	}
+	loaded = true;
+	writeSnapshot();
+	mergePendingRecords();
+	unlock();
+}
+
+void CleanSpool::cSpoolIndex::compact(bool force) {
+	lock();
+	if(loaded) {
+		unsigned live_records = 0;
+		for(int i = 0; i < _tc_end; i++) {
+			live_records += hours_by_class[i].size();
+		}
+		if(force ||
+		   (log_records > CACHE_INDEX_COMPACT_MIN_RECORDS && log_records > live_records * 2)) {
+			writeSnapshot();
+		} else if(fd >= 0) {
+			fdatasync(fd);
+		}
+	}
+	unlock();
+}
+
+u_int32_t CleanSpool::cSpoolIndex::getOldest(bool sip, bool rtp, bool graph, bool audio) {
+	bool enable[_tc_end] = { sip, rtp, graph, audio };
+	u_int32_t oldest = 0;
+	lock();
+	for(int i = 0; i < _tc_end; i++) {
+		if(enable[i] && hours_by_class[i].size() &&
+		   (!oldest || *hours_by_class[i].begin() < oldest)) {
+			oldest = *hours_by_class[i].begin();
+		}
+	}
+	unlock();
+	return(oldest);
+}
+
+long long CleanSpool::cSpoolIndex::getSplitSumSize(long long *sip, long long *rtp, long long *graph, long long *audio) {
+	lock();
+	if(sip) {
+		*sip = sum_size[_tc_sip];
+	}
+	if(rtp) {
+		*rtp = sum_size[_tc_rtp];
+	}
+	if(graph) {
+		*graph = sum_size[_tc_graph];
+	}
+	if(audio) {
+		*audio = sum_size[_tc_audio];
+	}
+	long long size = sum_size[_tc_sip] + sum_size[_tc_rtp] + sum_size[_tc_graph] + sum_size[_tc_audio];
+	unlock();
+	return(size);
+}
+
+void CleanSpool::cSpoolIndex::getSumSizeByDate(map<string, long long> *sizeByDate) {
+	sizeByDate->clear();
+	lock();
+	for(map<u_int32_t, sSpoolHourSize>::iterator iter = hours.begin(); iter != hours.end(); iter++) {
+		unsigned date = iter->first / 100;
+		char date_str[20];
+		snprintf(date_str, sizeof(date_str), "%4i-%02i-%02i", date / 10000, date % 10000 / 100, date % 100);
+		for(int i = 0; i < _tc_end; i++) {
+			(*sizeByDate)[date_str] += iter->second.size[i];
+		}
+	}
+	unlock();
+}
+
+CleanSpool::eTypeClass CleanSpool::cSpoolIndex::getTypeClass(eTypeSpoolFile typeSpoolFile) {
+	switch(typeSpoolFile) {
+	case tsf_rtp:
+		return(_tc_rtp);
+	case tsf_graph:
+		return(_tc_graph);
+	case tsf_audio:
+		return(_tc_audio);
+	default:
+		return(_tc_sip);
+	}
+}
+
+void CleanSpool::cSpoolIndex::addHourSize(u_int32_t datehour, int typeClass, long long size) {
+	hours[datehour].size[typeClass] += size;
+	hours_by_class[typeClass].insert(datehour);
+	sum_size[typeClass] += size;
+}
+
+void CleanSpool::cSpoolIndex::eraseHourSize(u_int32_t datehour, int typeClass) {
+	map<u_int32_t, sSpoolHourSize>::iterator iter = hours.find(datehour);
+	if(iter == hours.end()) {
+		return;
+	}
+	sum_size[typeClass] -= iter->second.size[typeClass];
+	iter->second.size[typeClass] = 0;
+	hours_by_class[typeClass].erase(datehour);
+	bool empty = true;
+	for(int i = 0; i < _tc_end; i++) {
+		if(iter->second.size[i]) {
+			empty = false;
+			break;
+		}
+	}
+	if(empty) {
+		hours.erase(iter);
+	}
+}
+
+bool CleanSpool::cSpoolIndex::appendRecord(const char *record) {
+	if(fd < 0) {
+		bool exists = file_exists(fileName);
+		fd = open(fileName.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+		if(fd < 0) {
+			syslog(LOG_ERR, "cleanspool index: failed to open %s", fileName.c_str());
+			return(false);
+		}
+		if(!exists) {
+			string header = string(CACHE_INDEX_HEADER) + "\n";
+			if(write(fd, header.c_str(), header.length()) != (ssize_t)header.length()) {
+				closeFile();
+				return(false);
+			}
+		}
+	}
+	// one write per record - after crash only the last record can be incomplete
+	size_t length = strlen(record);
+	if(write(fd, record, length) != (ssize_t)length) {
+		syslog(LOG_ERR, "cleanspool index: failed to write to %s", fileName.c_str());
+		closeFile();
+		return(false);
+	}
+	++log_records;
+	return(true);
+}
+
+void CleanSpool::cSpoolIndex::mergePendingRecords() {
+	// files created / hours cleaned before index was loaded or rebuilt
+	for(vector<sPendingRecord>::iterator iter = pending_records.begin(); iter != pending_records.end(); iter++) {
+		char record[100];
+		if(iter->type == 'A') {
+			snprintf(record, sizeof(record), "A %u %i %lli\n", iter->datehour, iter->typeClass, iter->size);
+			if(appendRecord(record)) {
+				addHourSize(iter->datehour, iter->typeClass, iter->size);
+			}
+		} else {
+			snprintf(record, sizeof(record), "D %u %i\n", iter->datehour, iter->typeClass);
+			appendRecord(record);
+			for(int i = 0; i < _tc_end; i++) {
+				if(iter->typeClass & (1 << i)) {
+					eraseHourSize(iter->datehour, i);
+				}
+			}
+		}
+	}
+	pending_records.clear();
+}
+
+bool CleanSpool::cSpoolIndex::writeSnapshot() {
+	closeFile();
+	string fileNameTmp = fileName + ".tmp";
+	FILE *indexf = fopen(fileNameTmp.c_str(), "w");
+	if(!indexf) {
+		syslog(LOG_ERR, "cleanspool index: failed to create %s", fileNameTmp.c_str());
+		return(false);
+	}
+	unsigned records = 0;
+	fprintf(indexf, "%s\n", CACHE_INDEX_HEADER);
+	for(map<u_int32_t, sSpoolHourSize>::iterator iter = hours.begin(); iter != hours.end(); iter++) {
+		for(int i = 0; i < _tc_end; i++) {
+			if(iter->second.size[i]) {
+				fprintf(indexf, "A %u %i %lli\n", iter->first, i, iter->second.size[i]);
+				++records;
+			}
+		}
+	}
+	bool ok = !ferror(indexf) && !fflush(indexf) && !fsync(fileno(indexf));
+	fclose(indexf);
+	if(!ok || rename(fileNameTmp.c_str(), fileName.c_str())) {
+		syslog(LOG_ERR, "cleanspool index: failed to write %s", fileName.c_str());
+		unlink(fileNameTmp.c_str());
+		return(false);
+	}
+	syslog(LOG_NOTICE, "cleanspool index: compacted %s (%u -> %u records)", fileName.c_str(), log_records, records);
+	log_records = records;
+	return(true);
+}
+
+void CleanSpool::cSpoolIndex::closeFile() {
+	if(fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+
 CleanSpool::CleanSpool(int spoolIndex) {
 	this->spoolIndex = spoolIndex;
 	this->loadOpt();
@@ -332,6 +690,7 @@ CleanSpool::CleanSpool(int spoolIndex) {
 	lastRunLoadSpoolDataDir = 0;
 	counterLoadSpoolDataDir = 0;
 	force_reindex_spool_flag = false;
+	spoolIndexLog.setFileName(getSpoolDir_string(tsf_main) + '/' + CACHE_INDEX_NAME);
 }
 
 CleanSpool::~CleanSpool() {
@@ -342,6 +701,10 @@ CleanSpool::~CleanSpool() {
 }
 
 void CleanSpool::addFile(const char *ymdh, eTypeSpoolFile typeSpoolFile, const char *file, long long int size) {
+	if(useSpoolIndex()) {
+		spoolIndexLog.add(atol(ymdh), typeSpoolFile, size);
+		return;
+	}
 	if(!opt_newdir || !opt_cleanspool_use_files) {
 		return;
 	}
@@ -490,6 +853,10 @@ string CleanSpool::getMaxSpoolDate() {
 }
 
 void CleanSpool::getSumSizeByDate(map<string, long long> *sizeByDate) {
+	if(useSpoolIndex()) {
+		spoolIndexLog.getSumSizeByDate(sizeByDate);
+		return;
+	}
 	spoolData.getSumSizeByDate(sizeByDate);
 }
 
@@ -813,6 +1180,33 @@ void CleanSpool::updateSpoolDataDir() {
 	++counterLoadSpoolDataDir;
 }
 
+void CleanSpool::updateSpoolIndex() {
+	if(!force_reindex_spool_flag && spoolIndexLog.isLoaded()) {
+		spoolIndexLog.compact();
+		return;
+	}
+	if(!force_reindex_spool_flag && spoolIndexLog.load()) {
+		syslog(LOG_NOTICE, "cleanspool[%i]: spool index loaded", spoolIndex);
+		spoolIndexLog.compact();
+		return;
+	}
+	// recovery - spool index is missing or reindex_spool was requested
+	syslog(LOG_NOTICE, "cleanspool[%i]: rebuild spool index from spool dirs", spoolIndex);
+	spoolIndexLog.rebuildBegin();
+	reloadSpoolDataDir(!force_reindex_spool_flag, true);
+	if(is_terminating()) {
+		return;
+	}
+	spoolData.lock();
+	spoolIndexLog.rebuild(&spoolData);
+	spoolData.clearAll();
+	spoolData.unlock();
+}
+
+bool CleanSpool::useSpoolIndex() {
+	return(opt_cleanspool_index && opt_newdir && !opt_cleanspool_use_files);
+}
+
 void CleanSpool::loadSpoolDataDir(cSpoolData *spoolData, sSpoolDataDirIndex index, string path, sLoadParams params) {
 	if(!index.getSettedItems()) {
 		list<string> spool_dirs;
@@ -1127,7 +1521,9 @@ void CleanSpool::cleanThread() {
 }
 
 void CleanSpool::cleanThreadProcess() {
-	if(!opt_cleanspool_use_files) {
+	if(useSpoolIndex()) {
+		updateSpoolIndex();
+	} else if(!opt_cleanspool_use_files) {
 		updateSpoolDataDir();
 	}
 	if(opt_cleanspool_use_files &&
@@ -1177,7 +1573,7 @@ void CleanSpool::cleanThreadProcess() {
 			if(opt_cleanspool_use_files) {
 				syslog(LOG_NOTICE, "cleanspool[%i]: low spool disk space - executing reindex_all", spoolIndex);
 				reindex_all("call from clean_spooldir - low spool disk space");
-			} else {
+			} else if(!useSpoolIndex()) {
 				syslog(LOG_NOTICE, "cleanspool[%i]: low spool disk space - executing reloadSpoolDataDir", spoolIndex);
 				reloadSpoolDataDir(false, true);
 			}
@@ -1207,6 +1603,8 @@ void CleanSpool::cleanThreadProcess() {
 					usedSizeGB = atol(row["sum_size"].c_str()) / (1024 * 1024 * 1024);
 				}
 				delete sqlDb;
+			} else if(useSpoolIndex()) {
+				usedSizeGB = (double)spoolIndexLog.getSplitSumSize(NULL, NULL, NULL, NULL) / (1024 * 1024 * 1024);
 			} else {
 				usedSizeGB = (double)spoolData.getSumSize() / (1024 * 1024 * 1024);
 			}
@@ -2043,6 +2441,57 @@ void CleanSpool::clean_maxpoolsize(bool sip, bool rtp, bool graph, bool audio) {
 					      id_sensor = " + getIdSensor_string());
 			}
 		}
+	} else if(useSpoolIndex()) {
+		while(!is_terminating() && !DISABLE_CLEANSPOOL) {
+			long long sipsize_total;
+			long long rtpsize_total;
+			long long graphsize_total;
+			long long audiosize_total;
+			long long allsize_total = this->spoolIndexLog.getSplitSumSize(&sipsize_total, &rtpsize_total, &graphsize_total, &audiosize_total);
+			double total = (all ? 
+					 allsize_total : 
+					 ((sip ? sipsize_total : 0) + 
+					  (rtp ? rtpsize_total : 0) + 
+					  (graph ? graphsize_total : 0) + 
+					  (audio ? audiosize_total : 0))) / (double)(1024 * 1024);
+			if(sverb.cleanspool) {
+				cout << "total[" << total << "] = " 
+				     << (sip ? intToString(sipsize_total) : "na") << " + " 
+				     << (rtp ? intToString(rtpsize_total) : "na") << " + " 
+				     << (graph ? intToString(graphsize_total) : "na") << " + " 
+				     << (audio ? intToString(audiosize_total) : "na")
+				     << " maxpoolsize[" << maxpoolsize;
+				if(maxpoolsize_set) {
+					cout << " / reduk: " << maxpoolsize_set;
+				}
+				cout << "]\n";
+			}
+			unsigned int reduk_maxpoolsize = all ? 
+							  get_reduk_maxpoolsize(maxpoolsize) :
+							  maxpoolsize;
+			if(reduk_maxpoolsize == 0 ||
+			   total <= reduk_maxpoolsize) {
+				break;
+			}
+			u_int32_t datehour = this->spoolIndexLog.getOldest(sip, rtp, graph, audio);
+			if(!datehour) {
+				break;
+			}
+			unlink_dirs(intToString(datehour),
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    rtp ? 2 : 1, 
+				    graph ? 2 : 1, 
+				    audio ? 2 : 1, 
+				    "clean_maxpoolsize");
+			if(DISABLE_CLEANSPOOL) {
+				break;
+			}
+			this->spoolIndexLog.erase(datehour, sip, rtp, graph, audio);
+		}
 	} else {
 		this->spoolData.lock();
 		while(!is_terminating() && !DISABLE_CLEANSPOOL) {
@@ -2212,6 +2661,30 @@ void CleanSpool::clean_maxpooldays(bool sip, bool rtp, bool graph, bool audio) {
 					      id_sensor = " + getIdSensor_string());
 			}
 		}
+	} else if(useSpoolIndex()) {
+		time_t limit_time = time(NULL) - maxpooldays * 24 * 60 * 60;
+		struct tm limit_tm = time_r(&limit_time);
+		u_int32_t limit_datehour = ((limit_tm.tm_year + 1900) * 10000 + (limit_tm.tm_mon + 1) * 100 + limit_tm.tm_mday) * 100 + limit_tm.tm_hour;
+		while(!is_terminating() && !DISABLE_CLEANSPOOL) {
+			u_int32_t datehour = this->spoolIndexLog.getOldest(sip, rtp, graph, audio);
+			if(!datehour || datehour >= limit_datehour) {
+				break;
+			}
+			unlink_dirs(intToString(datehour),
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    sip ? 2 : 1, 
+				    rtp ? 2 : 1, 
+				    graph ? 2 : 1, 
+				    audio ? 2 : 1, 
+				    "clean_maxpooldays");
+			if(DISABLE_CLEANSPOOL) {
+				break;
+			}
+			this->spoolIndexLog.erase(datehour, sip, rtp, graph, audio);
+		}
 	} else {
 		this->spoolData.lock();
 		while(!is_terminating() && !DISABLE_CLEANSPOOL) {
@@ -2625,6 +3098,9 @@ void CleanSpool::force_reindex_spool() {
 }
 
 string CleanSpool::print_spool() {
+	if(useSpoolIndex()) {
+		return(intToString(spoolIndexLog.getSplitSumSize(NULL, NULL, NULL, NULL)) + "\r\n" + printSumSizeByDate());
+	}
 	return(intToString(spoolData.getSumSize()) + "\r\n" + printSumSizeByDate());
 }
 
@@ -120,6 +120,19 @@ public:
 		string type;
 		eTypeSpoolFile _type;
 	};
+	enum eTypeClass {
+		_tc_sip,
+		_tc_rtp,
+		_tc_graph,
+		_tc_audio,
+		_tc_end
+	};
+	struct sSpoolHourSize {
+		sSpoolHourSize() {
+			memset(size, 0, sizeof(size));
+		}
+		long long size[_tc_end];
+	};
 	struct sSpoolDataDirItem {
 		sSpoolDataDirItem() {
 			size = 0;
@@ -142,6 +155,7 @@ public:
 		long long getSumSize();
 		long long getSplitSumSize(long long *sip, long long *rtp, long long *graph, long long *audio);
 		void getSumSizeByDate(map<string, long long> *sizeByDate);
+		void getSizeByDateHour(map<u_int32_t, sSpoolHourSize> *sizeByDateHour);
 		map<sSpoolDataDirIndex, sSpoolDataDirItem>::iterator getBegin();
 		map<sSpoolDataDirIndex, sSpoolDataDirItem>::iterator getMin(bool sip, bool rtp, bool graph, bool audio);
 		bool existsFileIndex(sSpoolDataDirIndex *dirIndex);
@@ -179,6 +193,66 @@ public:
 		list<sSpoolDataDirIndex> list_delete_hour_cache_files;
 		volatile int _sync;
 	};
+	/*
+	 persistent index of spool usage by date/hour and type (without cleanspool_use_files)
+	 - append-only log in main spool dir (CACHE_INDEX_NAME), each created file adds record A, cleaning of date/hour adds record D
+	 - torn last record (crash) is ignored, log is compacted to snapshot (tmp file + rename) when it grows
+	 - oldest date/hour of type is first item of ordered set - no directory walk during cleaning
+	 - directory walk (reloadSpoolDataDir) is needed only if log does not exist or by manager command reindexspool
+	 - log is not created before load / rebuild - records until then are kept in memory and appended after them
+	*/
+	class cSpoolIndex {
+	private:
+		struct sPendingRecord {
+			char type;
+			u_int32_t datehour;
+			int typeClass;
+			long long size;
+		};
+	public:
+		cSpoolIndex();
+		~cSpoolIndex();
+		void setFileName(string fileName) {
+			this->fileName = fileName;
+		}
+		bool load();
+		bool isLoaded() {
+			return(loaded);
+		}
+		void add(u_int32_t datehour, eTypeSpoolFile typeSpoolFile, long long size);
+		void erase(u_int32_t datehour, bool sip, bool rtp, bool graph, bool audio);
+		void rebuildBegin();
+		void rebuild(cSpoolData *spoolData);
+		void compact(bool force = false);
+		u_int32_t getOldest(bool sip, bool rtp, bool graph, bool audio);
+		long long getSplitSumSize(long long *sip, long long *rtp, long long *graph, long long *audio);
+		void getSumSizeByDate(map<string, long long> *sizeByDate);
+		static eTypeClass getTypeClass(eTypeSpoolFile typeSpoolFile);
+	private:
+		void addHourSize(u_int32_t datehour, int typeClass, long long size);
+		void eraseHourSize(u_int32_t datehour, int typeClass);
+		bool appendRecord(const char *record);
+		void mergePendingRecords();
+		bool writeSnapshot();
+		void closeFile();
+		void lock() {
+			// held across index file io (fsync of snapshot) - blocking lock instead of spin
+			pthread_mutex_lock(&_sync);
+		}
+		void unlock() {
+			pthread_mutex_unlock(&_sync);
+		}
+	private:
+		string fileName;
+		int fd;
+		map<u_int32_t, sSpoolHourSize> hours;
+		set<u_int32_t> hours_by_class[_tc_end];
+		long long sum_size[_tc_end];
+		unsigned log_records;
+		bool loaded;
+		vector<sPendingRecord> pending_records;
+		pthread_mutex_t _sync;
+	};
 	struct sLoadParams {
 		sLoadParams() {
 			enable_cache_load = false;
@@ -225,6 +299,8 @@ public:
 private:
 	void reloadSpoolDataDir(bool enableCacheLoad, bool enableCacheSave);
 	void updateSpoolDataDir();
+	void updateSpoolIndex();
+	bool useSpoolIndex();
 	void loadSpoolDataDir(cSpoolData *spoolData, sSpoolDataDirIndex index, string path, sLoadParams params);
 	void loadOpt();
 	void runCleanThread();
@@ -326,6 +402,7 @@ private:
 	bool suspended;
 	volatile int clean_spooldir_run_processing;
 	cSpoolData spoolData;
+	cSpoolIndex spoolIndexLog;
 	time_t lastRunLoadSpoolDataDir;
 	unsigned counterLoadSpoolDataDir;
 	bool force_reindex_spool_flag;
@@ -12,6 +12,10 @@
 #include <errno.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
+#ifndef FREEBSD
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 
 
 extern bool CR_TERMINATE();
@@ -217,11 +221,18 @@ string cRsa::getError() {
 cAes::cAes() {
 	ctx_enc = NULL;
 	ctx_dec = NULL;
+	mode = _mode_cbc;
+	initiator = false;
+	ctx_gcm_enc = NULL;
+	ctx_gcm_dec = NULL;
+	gcm_enc_seq = 0;
+	gcm_dec_seq = 0;
 }
 
 cAes::~cAes() {
 	destroyCtxEnc();
 	destroyCtxDec();
+	destroyCtxGcm();
 }
 
 void cAes::generate_keys() {
@@ -236,6 +247,7 @@ void cAes::generate_keys() {
 		char ch = (char)((double)rand() * ('z' - '0') / RAND_MAX + '0');
 		ivec.append(1, ch);
 	}
+	initiator = true;
 }
 
 bool cAes::encrypt(u_char *data, size_t datalen, u_char **data_enc, size_t *datalen_enc, bool final) {
@@ -322,6 +334,60 @@ bool cAes::decrypt(u_char *data, size_t datalen, u_char **data_dec, size_t *data
 	#endif
 }
 
+bool cAes::encryptGcm(u_char *data, size_t datalen, u_char *data_enc) {
+	#ifdef HAVE_OPENSSL
+	if(!ctx_gcm_enc) {
+		ctx_gcm_enc = createCtxGcm(true);
+		if(!ctx_gcm_enc) {
+			return(false);
+		}
+	}
+	u_char iv[_gcm_iv_length];
+	gcmIv(iv, initiator, gcm_enc_seq);
+	int len;
+	if(!EVP_EncryptInit_ex(ctx_gcm_enc, NULL, NULL, NULL, iv) ||
+	   (datalen && !EVP_EncryptUpdate(ctx_gcm_enc, data_enc, &len, data, datalen)) ||
+	   !EVP_EncryptFinal_ex(ctx_gcm_enc, data_enc + datalen, &len) ||
+	   !EVP_CIPHER_CTX_ctrl(ctx_gcm_enc, EVP_CTRL_GCM_GET_TAG, _gcm_tag_length, data_enc + datalen)) {
+		return(false);
+	}
+	++gcm_enc_seq;
+	return(true);
+	#else
+	return(false);
+	#endif
+}
+
+bool cAes::decryptGcm(u_char *data, size_t datalen, u_char *data_dec, size_t *datalen_dec) {
+	#ifdef HAVE_OPENSSL
+	*datalen_dec = 0;
+	if(datalen < _gcm_tag_length) {
+		return(false);
+	}
+	if(!ctx_gcm_dec) {
+		ctx_gcm_dec = createCtxGcm(false);
+		if(!ctx_gcm_dec) {
+			return(false);
+		}
+	}
+	size_t datalen_payload = datalen - _gcm_tag_length;
+	u_char iv[_gcm_iv_length];
+	gcmIv(iv, !initiator, gcm_dec_seq);
+	int len;
+	if(!EVP_DecryptInit_ex(ctx_gcm_dec, NULL, NULL, NULL, iv) ||
+	   !EVP_CIPHER_CTX_ctrl(ctx_gcm_dec, EVP_CTRL_GCM_SET_TAG, _gcm_tag_length, data + datalen_payload) ||
+	   (datalen_payload && !EVP_DecryptUpdate(ctx_gcm_dec, data_dec, &len, data, datalen_payload)) ||
+	   EVP_DecryptFinal_ex(ctx_gcm_dec, data_dec + datalen_payload, &len) <= 0) {
+		return(false);
+	}
+	++gcm_dec_seq;
+	*datalen_dec = datalen_payload;
+	return(true);
+	#else
+	return(false);
+	#endif
+}
+
 string cAes::getError() {
 	#ifdef HAVE_OPENSSL
 	char *error_buffer = new FILE_LINE(0) char[1000];
@@ -355,6 +421,49 @@ void cAes::destroyCtxDec() {
 	#endif
 }
 
+EVP_CIPHER_CTX *cAes::createCtxGcm(bool enc) {
+	#ifdef HAVE_OPENSSL
+	if(ckey.length() < 16 || ivec.length() < _gcm_iv_length) {
+		return(NULL);
+	}
+	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+	if(!(enc ?
+	      EVP_EncryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, (u_char*)ckey.c_str(), NULL) :
+	      EVP_DecryptInit_ex(ctx, EVP_aes_128_gcm(), NULL, (u_char*)ckey.c_str(), NULL)) ||
+	   !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, _gcm_iv_length, NULL)) {
+		EVP_CIPHER_CTX_free(ctx);
+		return(NULL);
+	}
+	return(ctx);
+	#else
+	return(NULL);
+	#endif
+}
+
+void cAes::destroyCtxGcm() {
+	#ifdef HAVE_OPENSSL
+	if(ctx_gcm_enc) {
+		EVP_CIPHER_CTX_free(ctx_gcm_enc);
+		ctx_gcm_enc = NULL;
+	}
+	if(ctx_gcm_dec) {
+		EVP_CIPHER_CTX_free(ctx_gcm_dec);
+		ctx_gcm_dec = NULL;
+	}
+	#endif
+}
+
+void cAes::gcmIv(u_char *iv, bool sentByInitiator, u_int64_t seq) {
+	// both directions share the key - the nonce is ivec with the direction in the high bit (ivec is ascii) and the block sequence xored in
+	memcpy(iv, ivec.c_str(), _gcm_iv_length);
+	if(sentByInitiator) {
+		iv[0] ^= 0x80;
+	}
+	for(unsigned i = 0; i < 8; i++) {
+		iv[_gcm_iv_length - 8 + i] ^= (u_char)(seq >> (i * 8));
+	}
+}
+
 
 cSocket::cSocket(const char *name, bool autoClose) {
 	if(name) {
@@ -537,11 +646,11 @@ bool cSocket::await(cSocket **clientSocket) {
 		setError(_se_bad_connection, "await");
 		return(false);
 	}
-	int clientHandle = -1;
+	bool rsltAccept = false;
 	if(clientSocket) {
 		*clientSocket = NULL;
 	}
-	while(clientHandle < 0 && !terminate) {
+	while(!rsltAccept && !terminate) {
 		bool doAccept = false;
 		if(opt_socket_use_poll) {
 			pollfd fds[2];
@@ -563,25 +672,34 @@ bool cSocket::await(cSocket **clientSocket) {
 			}
 		}
 		if(doAccept) {
-			vmIP clientIP;
-			vmPort clientPort;
-			clientHandle = socket_accept(handle, &clientIP, &clientPort);
-			if(clientHandle >= 0) {
-				int flags = fcntl(clientHandle, F_GETFL, 0);
-				if(flags >= 0) {
-					fcntl(clientHandle, F_SETFL, flags | O_NONBLOCK);
-				}
-				if(clientSocket) {
-					*clientSocket = new FILE_LINE(0) cSocket("client/await");
-					(*clientSocket)->host = clientIP.getString();
-					(*clientSocket)->port = clientPort;
-					(*clientSocket)->ip = clientIP;
-					(*clientSocket)->handle = clientHandle;
-				}
-			}
+			rsltAccept = accept(clientSocket);
 		}
 	}
-	return(clientHandle >= 0);
+	return(rsltAccept);
+}
+
+bool cSocket::accept(cSocket **clientSocket) {
+	if(clientSocket) {
+		*clientSocket = NULL;
+	}
+	vmIP clientIP;
+	vmPort clientPort;
+	int clientHandle = socket_accept(handle, &clientIP, &clientPort);
+	if(clientHandle < 0) {
+		return(false);
+	}
+	int flags = fcntl(clientHandle, F_GETFL, 0);
+	if(flags >= 0) {
+		fcntl(clientHandle, F_SETFL, flags | O_NONBLOCK);
+	}
+	if(clientSocket) {
+		*clientSocket = new FILE_LINE(0) cSocket("client/await");
+		(*clientSocket)->host = clientIP.getString();
+		(*clientSocket)->port = clientPort;
+		(*clientSocket)->ip = clientIP;
+		(*clientSocket)->handle = clientHandle;
+	}
+	return(true);
 }
 
 bool cSocket::write(u_char *data, size_t dataLen) {
@@ -782,7 +900,7 @@ bool cSocket::decodeAesReadBuffer(u_char *data, size_t dataLen, u_char **data_de
 	return(aes.decrypt(data, dataLen, data_dec, dataLenDec, final));
 }
 
-bool cSocket::checkHandleRead() {
+bool cSocket::checkHandleRead(int timeout_ms) {
 	if(!okHandle()) {
 		return(false);
 	}
@@ -792,7 +910,7 @@ bool cSocket::checkHandleRead() {
 		memset(fds, 0 , sizeof(fds));
 		fds[0].fd = handle;
 		fds[0].events = POLLIN;
-		int rsltPool = poll(fds, 1, 100);
+		int rsltPool = poll(fds, 1, timeout_ms);
 		if(rsltPool < 0) {
 			return(false);
 		}
@@ -804,8 +922,8 @@ bool cSocket::checkHandleRead() {
 		FD_ZERO(&rfds);
 		FD_SET(handle, &rfds);
 		struct timeval tv;
-		tv.tv_sec = 0;
-		tv.tv_usec = 100000;
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = timeout_ms % 1000 * 1000;
 		int rsltSelect = select(handle + 1, &rfds, (fd_set *) 0, (fd_set *) 0, &tv);
 		if(rsltSelect < 0) {
 			return(false);
@@ -903,6 +1021,7 @@ void cSocket::sleep(int s) {
 cSocketBlock::cSocketBlock(const char *name, bool autoClose)
  : cSocket(name, autoClose) {
 	block_header_string = NULL;
+	readPartActive = false;
 }
 
 cSocketBlock::~cSocketBlock() {
@@ -923,6 +1042,9 @@ void cSocketBlock::setBlockHeaderString(const char *block_header_string) {
 }
 
 bool cSocketBlock::writeBlock(u_char *data, size_t dataLen, eTypeEncode typeEncode, string xor_key) {
+	if(typeEncode == _te_aes && aes.isGcm()) {
+		return(writeBlockAesGcm(data, dataLen));
+	}
 	unsigned int data_sum = dataSum(data, dataLen);
 	u_char *xor_key_data = NULL;
 	u_char *rsa_data = NULL;
@@ -973,6 +1095,22 @@ bool cSocketBlock::writeBlock(string str, eTypeEncode typeEncode, string xor_key
 	return(writeBlock((u_char*)str.c_str(), str.length(), typeEncode, xor_key));
 }
 
+bool cSocketBlock::writeBlockAesGcm(u_char *data, size_t dataLen) {
+	// encrypted directly into the block, the tag authenticates data so sum is not counted
+	size_t blockLength = sizeof(sBlockHeader) + dataLen + cAes::_gcm_tag_length;
+	u_char *block = new FILE_LINE(0) u_char[blockLength];
+	((sBlockHeader*)block)->init(block_header_string);
+	((sBlockHeader*)block)->length = dataLen + cAes::_gcm_tag_length;
+	((sBlockHeader*)block)->sum = 0;
+	if(!aes.encryptGcm(data, dataLen, block + sizeof(sBlockHeader))) {
+		delete [] block;
+		return(false);
+	}
+	bool rsltWrite = write(block, blockLength);
+	delete [] block;
+	return(rsltWrite);
+}
+
 u_char *cSocketBlock::readBlock(size_t *dataLen, eTypeEncode typeEncode, string xor_key, bool quietEwouldblock, u_int16_t timeout, size_t bufferIncLength) {
 	if(!timeout) {
 		timeout = timeouts.readblock;
@@ -1001,40 +1139,7 @@ u_char *cSocketBlock::readBlock(size_t *dataLen, eTypeEncode typeEncode, string
 				}
 				if(blockHeaderOK) {
 					if(readBuffer.length >= readBuffer.lengthBlockHeader(true)) {
-						if(typeEncode == _te_xor && !xor_key.empty()) {
-							xorData(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), xor_key.c_str(), xor_key.length(), 0);
-						} else if(typeEncode == _te_rsa && rsa.isSetPrivKey()) {
-							u_char *rsa_data = readBuffer.buffer + sizeof(sBlockHeader);
-							size_t rsa_data_len = readBuffer.lengthBlockHeader();
-							if(rsa.private_decrypt(&rsa_data, &rsa_data_len, false)) {
-								size_t new_buffer_length = rsa_data_len + sizeof(sBlockHeader);
-								u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
-								memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
-								((sBlockHeader*)new_buffer)->length = rsa_data_len;
-								memcpy(new_buffer + sizeof(sBlockHeader), rsa_data, rsa_data_len);
-								readBuffer.set(new_buffer, new_buffer_length);
-								delete [] rsa_data;
-							} else {
-								rsltRead = false;
-							}
-						} else if(typeEncode == _te_aes) {
-							u_char *aes_data;
-							size_t aes_data_len;
-							if(aes.decrypt(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), &aes_data, &aes_data_len, true)) {
-								size_t new_buffer_length = aes_data_len + sizeof(sBlockHeader);
-								u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
-								memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
-								((sBlockHeader*)new_buffer)->length = aes_data_len;
-								memcpy(new_buffer + sizeof(sBlockHeader), aes_data, aes_data_len);
-								readBuffer.set(new_buffer, new_buffer_length);
-								delete [] aes_data;
-							} else  {
-								rsltRead = false;
-							}
-						}
-						if(rsltRead && !checkSumReadBuffer()) {
-							rsltRead = false;
-						}
+						rsltRead = decodeReadBuffer(typeEncode, xor_key);
 						break;
 					}
 				}
@@ -1059,6 +1164,123 @@ u_char *cSocketBlock::readBlock(size_t *dataLen, eTypeEncode typeEncode, string
 	}
 }
 
+cSocketBlock::eReadPartResult cSocketBlock::readBlockPart(u_char **data, size_t *dataLen, eTypeEncode typeEncode, string xor_key, size_t bufferIncLength) {
+	*data = NULL;
+	*dataLen = 0;
+	if(isError() || !okHandle()) {
+		readPartActive = false;
+		setError(_se_bad_connection, "read");
+		return(_rp_error);
+	}
+	if(!readPartActive) {
+		readBuffer.clear();
+		readPartActive = true;
+	}
+	while(true) {
+		bool blockHeaderOK = readBuffer.length >= sizeof(sBlockHeader);
+		size_t readLength = blockHeaderOK ?
+				     readBuffer.lengthBlockHeader(true) - readBuffer.length :
+				     sizeof(sBlockHeader) - readBuffer.length;
+		readBuffer.needFreeSize(readLength, bufferIncLength);
+		ssize_t recvLen = recv(handle, readBuffer.buffer + readBuffer.length, readLength, 0);
+		if(recvLen > 0) {
+			readBuffer.incLength(recvLen);
+			lastTimeOkRead = getTimeUS();
+			if(!blockHeaderOK && readBuffer.length >= sizeof(sBlockHeader) &&
+			   !readBuffer.okBlockHeader(block_header_string)) {
+				readPartActive = false;
+				setError(_se_loss_connection, "bad block header");
+				return(_rp_error);
+			}
+			if(readBuffer.length >= sizeof(sBlockHeader) &&
+			   readBuffer.length >= readBuffer.lengthBlockHeader(true)) {
+				readPartActive = false;
+				if(!decodeReadBuffer(typeEncode, xor_key)) {
+					return(_rp_error);
+				}
+				*data = readBuffer.buffer + sizeof(sBlockHeader);
+				*dataLen = readBuffer.lengthBlockHeader();
+				return(_rp_complete);
+			}
+		} else if(recvLen < 0 && errno == EINTR) {
+			continue;
+		} else if(recvLen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return(_rp_incomplete);
+		} else {
+			readPartActive = false;
+			if(!(isTerminate() || CR_TERMINATE()) && (recvLen < 0 || readBuffer.length)) {
+				setError(_se_loss_connection, "failed read()");
+			}
+			return(_rp_error);
+		}
+	}
+	return(_rp_incomplete);
+}
+
+cSocketBlock::eReadPartResult cSocketBlock::readLinePart(string *line, u_char **remainder, size_t *remainder_length, size_t maxLength) {
+	if(isError() || !okHandle()) {
+		readPartActive = false;
+		setError(_se_bad_connection, "read");
+		return(_rp_error);
+	}
+	if(!readPartActive) {
+		readBuffer.clear();
+		readPartActive = true;
+	}
+	u_char buffer[10 * 1024];
+	while(true) {
+		ssize_t recvLen = recv(handle, buffer, sizeof(buffer), 0);
+		if(recvLen > 0) {
+			lastTimeOkRead = getTimeUS();
+			size_t endLinePos = 0;
+			bool endLine = false;
+			for(ssize_t i = 0; i < recvLen; i++) {
+				if(buffer[i] == '\r' || buffer[i] == '\n') {
+					endLinePos = i;
+					endLine = true;
+					break;
+				}
+			}
+			if(endLine) {
+				readBuffer.add(buffer, endLinePos);
+				*line = readBuffer.length ? string((char*)readBuffer.buffer, readBuffer.length) : "";
+				if(remainder) {
+					size_t pos = endLinePos;
+					while(pos < (size_t)recvLen && 
+					      (buffer[pos] == '\r' || buffer[pos] == '\n')) {
+						++pos;
+					}
+					if(pos < (size_t)recvLen) {
+						size_t _remainder_length = recvLen - pos;
+						*remainder = new FILE_LINE(0) u_char[_remainder_length];
+						memcpy(*remainder, buffer + pos, _remainder_length);
+						if(remainder_length) {
+							*remainder_length = _remainder_length;
+						}
+					}
+				}
+				readBuffer.clear();
+				readPartActive = false;
+				return(_rp_complete);
+			}
+			readBuffer.add(buffer, recvLen);
+			if(readBuffer.length > maxLength) {
+				readPartActive = false;
+				setError("line too long");
+				return(_rp_error);
+			}
+		} else if(recvLen < 0 && errno == EINTR) {
+			continue;
+		} else if(recvLen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return(_rp_incomplete);
+		} else {
+			readPartActive = false;
+			return(_rp_error);
+		}
+	}
+	return(_rp_incomplete);
+}
+
 bool cSocketBlock::readBlock(string *str, eTypeEncode typeEncode, string xor_key, bool quietEwouldblock, u_int16_t timeout) {
 	u_char *data;
 	size_t dataLen;
@@ -1194,6 +1416,50 @@ void cSocketBlock::readDecodeAesAndResendTo(cSocketBlock *dest, u_char *remainde
 	}
 }
 
+bool cSocketBlock::decodeReadBuffer(eTypeEncode typeEncode, string &xor_key) {
+	if(typeEncode == _te_xor && !xor_key.empty()) {
+		xorData(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), xor_key.c_str(), xor_key.length(), 0);
+	} else if(typeEncode == _te_rsa && rsa.isSetPrivKey()) {
+		u_char *rsa_data = readBuffer.buffer + sizeof(sBlockHeader);
+		size_t rsa_data_len = readBuffer.lengthBlockHeader();
+		if(rsa.private_decrypt(&rsa_data, &rsa_data_len, false)) {
+			size_t new_buffer_length = rsa_data_len + sizeof(sBlockHeader);
+			u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
+			memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
+			((sBlockHeader*)new_buffer)->length = rsa_data_len;
+			memcpy(new_buffer + sizeof(sBlockHeader), rsa_data, rsa_data_len);
+			readBuffer.set(new_buffer, new_buffer_length);
+			delete [] rsa_data;
+		} else {
+			return(false);
+		}
+	} else if(typeEncode == _te_aes && aes.isGcm()) {
+		size_t aes_data_len;
+		if(!aes.decryptGcm(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), 
+				   readBuffer.buffer + sizeof(sBlockHeader), &aes_data_len)) {
+			return(false);
+		}
+		((sBlockHeader*)readBuffer.buffer)->length = aes_data_len;
+		readBuffer.length = sizeof(sBlockHeader) + aes_data_len;
+		return(true);
+	} else if(typeEncode == _te_aes) {
+		u_char *aes_data;
+		size_t aes_data_len;
+		if(aes.decrypt(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.lengthBlockHeader(), &aes_data, &aes_data_len, true)) {
+			size_t new_buffer_length = aes_data_len + sizeof(sBlockHeader);
+			u_char *new_buffer = new FILE_LINE(0) u_char[new_buffer_length];
+			memcpy(new_buffer, readBuffer.buffer, sizeof(sBlockHeader));
+			((sBlockHeader*)new_buffer)->length = aes_data_len;
+			memcpy(new_buffer + sizeof(sBlockHeader), aes_data, aes_data_len);
+			readBuffer.set(new_buffer, new_buffer_length);
+			delete [] aes_data;
+		} else  {
+			return(false);
+		}
+	}
+	return(checkSumReadBuffer());
+}
+
 bool cSocketBlock::checkSumReadBuffer() {
 	return(readBuffer.sumBlockHeader() ==
 	       dataSum(readBuffer.buffer + sizeof(sBlockHeader), readBuffer.length - sizeof(sBlockHeader)));
@@ -1208,6 +1474,389 @@ u_int32_t cSocketBlock::dataSum(u_char *data, size_t dataLen) {
 }
 
 
+cServerReactor::cServerReactor(cServer *server, unsigned workers, unsigned tasks) {
+	this->server = server;
+	workers_count = workers ? workers : 1;
+	task_threads_count = tasks ? tasks : 1;
+	epoll_fd = -1;
+	event_fd = -1;
+	reactor_thread = 0;
+	worker_threads = NULL;
+	task_threads = NULL;
+	connections_id = 0;
+	tasks_active = 0;
+	terminating = false;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&ready_cond, NULL);
+	pthread_cond_init(&task_cond, NULL);
+}
+
+cServerReactor::~cServerReactor() {
+	stop();
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&ready_cond);
+	pthread_cond_destroy(&task_cond);
+}
+
+bool cServerReactor::start() {
+	#ifndef FREEBSD
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_fd < 0) {
+		syslog(LOG_ERR, "cServerReactor: epoll_create1 failed: %s", strerror(errno));
+		return(false);
+	}
+	event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(event_fd < 0) {
+		syslog(LOG_ERR, "cServerReactor: eventfd failed: %s", strerror(errno));
+		::close(epoll_fd);
+		epoll_fd = -1;
+		return(false);
+	}
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u64 = 0;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev);
+	// ids 1 .. MAX_LISTEN_SOCKETS are reserved for listen sockets
+	connections_id = MAX_LISTEN_SOCKETS;
+	vm_pthread_create("cServerReactor::reactor", &reactor_thread, NULL, cServerReactor::reactorThreadFunction, this, __FILE__, __LINE__);
+	worker_threads = new FILE_LINE(0) pthread_t[workers_count];
+	for(unsigned i = 0; i < workers_count; i++) {
+		vm_pthread_create("cServerReactor::worker", &worker_threads[i], NULL, cServerReactor::workerThreadFunction, this, __FILE__, __LINE__);
+	}
+	task_threads = new FILE_LINE(0) pthread_t[task_threads_count];
+	for(unsigned i = 0; i < task_threads_count; i++) {
+		vm_pthread_create("cServerReactor::task", &task_threads[i], NULL, cServerReactor::taskThreadFunction, this, __FILE__, __LINE__);
+	}
+	if(CR_VERBOSE().start_server) {
+		syslog(LOG_INFO, "START SERVER REACTOR (workers: %u, task threads: %u)", workers_count, task_threads_count);
+	}
+	return(true);
+	#else
+	return(false);
+	#endif
+}
+
+void cServerReactor::stop() {
+	if(epoll_fd < 0) {
+		return;
+	}
+	lock();
+	terminating = true;
+	pthread_cond_broadcast(&ready_cond);
+	pthread_cond_broadcast(&task_cond);
+	unlock();
+	kick();
+	if(reactor_thread) {
+		pthread_join(reactor_thread, NULL);
+		reactor_thread = 0;
+	}
+	if(worker_threads) {
+		for(unsigned i = 0; i < workers_count; i++) {
+			pthread_join(worker_threads[i], NULL);
+		}
+		delete [] worker_threads;
+		worker_threads = NULL;
+	}
+	if(task_threads) {
+		for(unsigned i = 0; i < task_threads_count; i++) {
+			pthread_join(task_threads[i], NULL);
+		}
+		delete [] task_threads;
+		task_threads = NULL;
+	}
+	while(connections.size()) {
+		cServerConnection *connection = connections.begin()->second;
+		connections.erase(connections.begin());
+		delete connection;
+	}
+	timers.clear();
+	ready_queue.clear();
+	task_queue.clear();
+	::close(event_fd);
+	event_fd = -1;
+	::close(epoll_fd);
+	epoll_fd = -1;
+}
+
+bool cServerReactor::addListen(cSocket *listen_socket) {
+	#ifndef FREEBSD
+	if(epoll_fd < 0 || listen_sockets.size() >= MAX_LISTEN_SOCKETS) {
+		return(false);
+	}
+	lock();
+	listen_sockets.push_back(listen_socket);
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u64 = listen_sockets.size();
+	bool rslt = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_socket->getHandle(), &ev) == 0;
+	if(!rslt) {
+		listen_sockets.pop_back();
+	}
+	unlock();
+	return(rslt);
+	#else
+	return(false);
+	#endif
+}
+
+void cServerReactor::add(cServerConnection *connection) {
+	lock();
+	connection->reactor = this;
+	connection->reactor_id = ++connections_id;
+	connection->reactor_connection_state = _rcs_na;
+	connection->reactor_timer_ms = 0;
+	connection->reactor_registered = false;
+	connection->reactor_wake_pending = false;
+	connections[connection->reactor_id] = connection;
+	pushReady(connection, _re_start);
+	unlock();
+}
+
+void cServerReactor::wake(cServerConnection *connection) {
+	lock();
+	connection->reactor_wake_pending = true;
+	if(connection->reactor_connection_state == _rcs_wait_timer) {
+		clearTimer(connection);
+		pushReady(connection, _re_wake);
+	}
+	unlock();
+}
+
+string cServerReactor::getStatString() {
+	ostringstream outStr;
+	lock();
+	outStr << "connections: " << connections.size()
+	       << ", ready: " << ready_queue.size()
+	       << ", tasks: " << tasks_active << "/" << task_threads_count
+	       << ", tasks queue: " << task_queue.size();
+	unlock();
+	return(outStr.str());
+}
+
+void cServerReactor::process(cServerConnection *connection, eEvent event) {
+	u_int64_t wait_ms = 0;
+	eWait wait = connection->reactor_step(event, &wait_ms);
+	if(terminating && wait != _rw_end && wait != _rw_thread) {
+		// connection is deleted in stop
+		return;
+	}
+	lock();
+	switch(wait) {
+	case _rw_read: {
+		#ifndef FREEBSD
+		connection->reactor_connection_state = _rcs_wait_read;
+		if(wait_ms) {
+			setTimer(connection, getTimeMS_rdtsc() + wait_ms);
+		}
+		epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+		ev.data.u64 = connection->reactor_id;
+		if(epoll_ctl(epoll_fd, connection->reactor_registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, 
+			     connection->socket->getHandle(), &ev) == 0) {
+			connection->reactor_registered = true;
+		} else {
+			clearTimer(connection);
+			pushReady(connection, _re_read);
+		}
+		#endif
+		}
+		break;
+	case _rw_timer:
+		if(connection->reactor_wake_pending) {
+			pushReady(connection, _re_wake);
+		} else {
+			connection->reactor_connection_state = _rcs_wait_timer;
+			setTimer(connection, getTimeMS_rdtsc() + wait_ms);
+		}
+		break;
+	case _rw_task:
+		connection->reactor_connection_state = _rcs_task;
+		task_queue.push_back(connection);
+		pthread_cond_signal(&task_cond);
+		break;
+	case _rw_thread:
+		unregister(connection);
+		unlock();
+		connection->reactor = NULL;
+		connection->connection_start();
+		return;
+	case _rw_end:
+		unregister(connection);
+		unlock();
+		delete connection;
+		return;
+	}
+	unlock();
+}
+
+void cServerReactor::pushReady(cServerConnection *connection, eEvent event) {
+	connection->reactor_connection_state = _rcs_ready;
+	sReady ready;
+	ready.connection = connection;
+	ready.event = event;
+	ready_queue.push_back(ready);
+	pthread_cond_signal(&ready_cond);
+}
+
+void cServerReactor::setTimer(cServerConnection *connection, u_int64_t time_ms) {
+	clearTimer(connection);
+	connection->reactor_timer_ms = time_ms;
+	timers.insert(make_pair(time_ms, connection->reactor_id));
+	if(timers.begin()->second == connection->reactor_id) {
+		kick();
+	}
+}
+
+void cServerReactor::clearTimer(cServerConnection *connection) {
+	if(connection->reactor_timer_ms) {
+		timers.erase(make_pair(connection->reactor_timer_ms, connection->reactor_id));
+		connection->reactor_timer_ms = 0;
+	}
+}
+
+void cServerReactor::unregister(cServerConnection *connection) {
+	clearTimer(connection);
+	#ifndef FREEBSD
+	if(connection->reactor_registered) {
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->socket->getHandle(), NULL);
+		connection->reactor_registered = false;
+	}
+	#endif
+	connections.erase(connection->reactor_id);
+}
+
+void cServerReactor::kick() {
+	if(event_fd >= 0) {
+		u_int64_t value = 1;
+		if(::write(event_fd, &value, sizeof(value)) < 0) {
+		}
+	}
+}
+
+void *cServerReactor::reactorThreadFunction(void *arg) {
+	((cServerReactor*)arg)->reactorProcess();
+	return(NULL);
+}
+
+void cServerReactor::reactorProcess() {
+	#ifndef FREEBSD
+	epoll_event events[64];
+	while(!terminating) {
+		int timeout_ms = 100;
+		lock();
+		if(timers.size()) {
+			u_int64_t act_time_ms = getTimeMS_rdtsc();
+			timeout_ms = timers.begin()->first > act_time_ms ?
+				      min((u_int64_t)timeout_ms, timers.begin()->first - act_time_ms) :
+				      0;
+		}
+		unlock();
+		int events_count = epoll_wait(epoll_fd, events, 64, timeout_ms);
+		if(events_count < 0 && errno != EINTR) {
+			syslog(LOG_ERR, "cServerReactor: epoll_wait failed: %s", strerror(errno));
+			USLEEP(10000);
+		}
+		if(terminating) {
+			break;
+		}
+		for(int i = 0; i < events_count; i++) {
+			u_int64_t id = events[i].data.u64;
+			if(id == 0) {
+				u_int64_t value;
+				if(::read(event_fd, &value, sizeof(value)) < 0) {
+				}
+			} else if(id <= listen_sockets.size()) {
+				cSocket *listen_socket = listen_sockets[id - 1];
+				cSocket *clientSocket;
+				while(!terminating && listen_socket->accept(&clientSocket)) {
+					server->acceptConnection(clientSocket);
+				}
+			} else {
+				lock();
+				map<u_int64_t, cServerConnection*>::iterator iter = connections.find(id);
+				if(iter != connections.end() &&
+				   iter->second->reactor_connection_state == _rcs_wait_read) {
+					clearTimer(iter->second);
+					pushReady(iter->second, _re_read);
+				}
+				unlock();
+			}
+		}
+		lock();
+		u_int64_t act_time_ms = getTimeMS_rdtsc();
+		while(timers.size() && timers.begin()->first <= act_time_ms) {
+			map<u_int64_t, cServerConnection*>::iterator iter = connections.find(timers.begin()->second);
+			timers.erase(timers.begin());
+			if(iter != connections.end()) {
+				iter->second->reactor_timer_ms = 0;
+				if(iter->second->reactor_connection_state == _rcs_wait_read ||
+				   iter->second->reactor_connection_state == _rcs_wait_timer) {
+					pushReady(iter->second, _re_timeout);
+				}
+			}
+		}
+		unlock();
+	}
+	#endif
+}
+
+void *cServerReactor::workerThreadFunction(void *arg) {
+	((cServerReactor*)arg)->workerProcess();
+	return(NULL);
+}
+
+void cServerReactor::workerProcess() {
+	while(true) {
+		lock();
+		while(!terminating && !ready_queue.size()) {
+			pthread_cond_wait(&ready_cond, &mutex);
+		}
+		if(terminating) {
+			unlock();
+			break;
+		}
+		sReady ready = ready_queue.front();
+		ready_queue.pop_front();
+		ready.connection->reactor_connection_state = _rcs_busy;
+		if(ready.event == _re_wake || ready.event == _re_timeout) {
+			ready.connection->reactor_wake_pending = false;
+		}
+		unlock();
+		process(ready.connection, ready.event);
+	}
+}
+
+void *cServerReactor::taskThreadFunction(void *arg) {
+	((cServerReactor*)arg)->taskProcess();
+	return(NULL);
+}
+
+void cServerReactor::taskProcess() {
+	while(true) {
+		lock();
+		while(!terminating && !task_queue.size()) {
+			pthread_cond_wait(&task_cond, &mutex);
+		}
+		if(terminating) {
+			unlock();
+			break;
+		}
+		cServerConnection *connection = task_queue.front();
+		task_queue.pop_front();
+		++tasks_active;
+		unlock();
+		connection->reactor_task();
+		process(connection, _re_task_done);
+		lock();
+		--tasks_active;
+		unlock();
+	}
+}
+
+
 cServer::cServer(bool udp, bool simple_read) {
 	this->udp = udp;
 	this->simple_read = simple_read || udp;
@@ -1215,12 +1864,20 @@ cServer::cServer(bool udp, bool simple_read) {
 		listen_socket[i] = NULL;
 		listen_thread[i] = 0;
 	}
+	reactor_workers = 0;
+	reactor_task_threads = 0;
+	reactor = NULL;
 }
 
 cServer::~cServer() {
 	listen_stop();
 }
 
+void cServer::setReactor(unsigned workers, unsigned task_threads) {
+	reactor_workers = workers;
+	reactor_task_threads = task_threads;
+}
+
 bool cServer::listen_start(const char *name, string host, u_int16_t port, unsigned index) {
 	listen_socket[index] = new FILE_LINE(0) cSocketBlock(name);
 	listen_socket[index]->setHostPort(host, port);
@@ -1232,6 +1889,21 @@ bool cServer::listen_start(const char *name, string host, u_int16_t port, unsign
 		listen_socket[index] = NULL;
 		return(false);
 	}
+	if(!udp && reactor_workers) {
+		if(!reactor) {
+			reactor = new FILE_LINE(0) cServerReactor(this, reactor_workers, reactor_task_threads);
+			if(!reactor->start()) {
+				delete reactor;
+				reactor = NULL;
+			}
+		}
+		if(reactor && reactor->addListen(listen_socket[index])) {
+			if(CR_VERBOSE().start_server) {
+				syslog(LOG_INFO, "%s", startVerbString.empty() ? "START SERVER LISTEN" : startVerbString.c_str());
+			}
+			return(true);
+		}
+	}
 	sListenParams *listenParams = new sListenParams;
 	listenParams->server = this;
 	listenParams->index = index;
@@ -1240,6 +1912,7 @@ bool cServer::listen_start(const char *name, string host, u_int16_t port, unsign
 }
 
 void cServer::listen_stop(unsigned index) {
+	reactor_stop();
 	if(listen_socket[index]) {
 		listen_socket[index]->setTerminate();
 		listen_socket[index]->close();
@@ -1252,6 +1925,14 @@ void cServer::listen_stop(unsigned index) {
 	}
 }
 
+void cServer::reactor_stop() {
+	if(reactor) {
+		reactor->stop();
+		delete reactor;
+		reactor = NULL;
+	}
+}
+
 void *cServer::listen_process(void *arg) {
 	if(CR_VERBOSE().start_server) {
 		ostringstream verbstr;
@@ -1270,24 +1951,7 @@ void cServer::listen_process(int index) {
 		cSocket *clientSocket;
 		while(!((listen_socket[index] && listen_socket[index]->isTerminate()) || CR_TERMINATE())) {
 			if(listen_socket[index]->await(&clientSocket)) {
-				#ifdef CLOUD_ROUTER_SERVER
-				extern cBlockIP blockIP;
-				if(blockIP.isBlocked(clientSocket->getIPL())) {
-					clientSocket->close();
-					delete clientSocket;
-				} else 
-				#endif
-				if(!CR_TERMINATE()) {
-					if(CR_VERBOSE().connect_info) {
-						ostringstream verbstr;
-						verbstr << "NEW CONNECTION FROM: " 
-							<< clientSocket->getIP() << " : " << clientSocket->getPort();
-						syslog(LOG_INFO, "%s", verbstr.str().c_str());
-					}
-					createConnection(clientSocket);
-				} else {
-					delete clientSocket;
-				}
+				acceptConnection(clientSocket);
 			}
 		}
 	} else {
@@ -1312,9 +1976,38 @@ void cServer::listen_process(int index) {
 	}
 }
 
+void cServer::acceptConnection(cSocket *clientSocket) {
+	#ifdef CLOUD_ROUTER_SERVER
+	extern cBlockIP blockIP;
+	if(blockIP.isBlocked(clientSocket->getIPL())) {
+		clientSocket->close();
+		delete clientSocket;
+	} else 
+	#endif
+	if(!CR_TERMINATE()) {
+		if(CR_VERBOSE().connect_info) {
+			ostringstream verbstr;
+			verbstr << "NEW CONNECTION FROM: " 
+				<< clientSocket->getIP() << " : " << clientSocket->getPort();
+			syslog(LOG_INFO, "%s", verbstr.str().c_str());
+		}
+		createConnection(clientSocket);
+	} else {
+		delete clientSocket;
+	}
+}
+
 void cServer::createConnection(cSocket *socket) {
 	cServerConnection *connection = new FILE_LINE(0) cServerConnection(socket, simple_read);
-	connection->connection_start();
+	startConnection(connection);
+}
+
+void cServer::startConnection(cServerConnection *connection) {
+	if(reactor) {
+		reactor->add(connection);
+	} else {
+		connection->connection_start();
+	}
 }
 
 void cServer::evData(u_char */*data*/, size_t /*dataLen*/) {
@@ -1330,7 +2023,14 @@ cServerConnection::cServerConnection(cSocket *socket, bool simple_read) {
 	this->simple_read = simple_read;
 	*(cSocket*)this->socket = *socket;
 	delete socket;
+	thread = 0;
 	begin_time_ms = getTimeMS();
+	reactor = NULL;
+	reactor_id = 0;
+	reactor_connection_state = 0;
+	reactor_timer_ms = 0;
+	reactor_registered = false;
+	reactor_wake_pending = false;
 }
 
 cServerConnection::~cServerConnection() {
@@ -1380,6 +2080,19 @@ void cServerConnection::connection_process() {
 void cServerConnection::evData(u_char */*data*/, size_t /*dataLen*/) {
 }
 
+cServerReactor::eWait cServerConnection::reactor_step(cServerReactor::eEvent /*event*/, u_int64_t */*wait_ms*/) {
+	return(cServerReactor::_rw_thread);
+}
+
+void cServerConnection::reactor_task() {
+}
+
+void cServerConnection::reactor_wake() {
+	if(reactor) {
+		reactor->wake(this);
+	}
+}
+
 void cServerConnection::setTerminateSocket() {
 	if(socket) {
 		socket->setTerminate();
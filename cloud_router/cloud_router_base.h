@@ -7,8 +7,12 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <map>
+#include <set>
+#include <vector>
+#include <deque>
 #include <string>
 #include <arpa/inet.h>
+#include <pthread.h>
 
 #include "cloud_router.h"
 
@@ -108,6 +112,15 @@ private:
 
 
 class cAes {
+public:
+	enum eMode {
+		_mode_cbc,
+		_mode_gcm
+	};
+	enum eGcmParams {
+		_gcm_iv_length = 12,
+		_gcm_tag_length = 16
+	};
 public:
 	cAes();
 	~cAes();
@@ -115,6 +128,21 @@ public:
 	void setKeys(string ckey, string ivec) {
 		this->ckey = ckey;
 		this->ivec = ivec;
+		this->initiator = false;
+	}
+	void setMode(eMode mode) {
+		if(this->mode != mode) {
+			destroyCtxGcm();
+			this->mode = mode;
+			gcm_enc_seq = 0;
+			gcm_dec_seq = 0;
+		}
+	}
+	eMode getMode() {
+		return(mode);
+	}
+	bool isGcm() {
+		return(mode == _mode_gcm);
 	}
 	bool getKeys(string *ckey, string *ivec) {
 		if(!this->ckey.empty() && !this->ivec.empty()) {
@@ -127,6 +155,8 @@ public:
 	}
 	bool encrypt(u_char *data, size_t datalen, u_char **data_enc, size_t *datalen_enc, bool final);
 	bool decrypt(u_char *data, size_t datalen, u_char **data_dec, size_t *datalen_dec, bool final);
+	bool encryptGcm(u_char *data, size_t datalen, u_char *data_enc);
+	bool decryptGcm(u_char *data, size_t datalen, u_char *data_dec, size_t *datalen_dec);
 	string getError();
 	bool isSetKeys() {
 		return(!ckey.empty() && !ivec.empty());
@@ -134,11 +164,20 @@ public:
 private:
 	void destroyCtxEnc();
 	void destroyCtxDec();
+	EVP_CIPHER_CTX *createCtxGcm(bool enc);
+	void destroyCtxGcm();
+	void gcmIv(u_char *iv, bool sentByInitiator, u_int64_t seq);
 private:
 	EVP_CIPHER_CTX *ctx_enc;
 	EVP_CIPHER_CTX *ctx_dec;
 	string ckey;
 	string ivec;
+	eMode mode;
+	bool initiator;
+	EVP_CIPHER_CTX *ctx_gcm_enc;
+	EVP_CIPHER_CTX *ctx_gcm_dec;
+	u_int64_t gcm_enc_seq;
+	u_int64_t gcm_dec_seq;
 };
 
 
@@ -252,6 +291,7 @@ public:
 	bool listen();
 	void close();
 	bool await(cSocket **clientSocket);
+	bool accept(cSocket **clientSocket);
 	bool write(u_char *data, size_t dataLen);
 	bool write(const char *data);
 	bool write(string &data);
@@ -264,7 +304,7 @@ public:
 	void decodeXorKeyReadBuffer(u_char *data, size_t dataLen);
 	bool encodeAesWriteBuffer(u_char *data, size_t dataLen, u_char **data_enc, size_t *dataLenEnc, bool final);
 	bool decodeAesReadBuffer(u_char *data, size_t dataLen, u_char **data_dec, size_t *dataLenDec, bool final);
-	bool checkHandleRead();
+	bool checkHandleRead(int timeout_ms = 100);
 	bool checkHandleWrite();
 	bool okHandle() {
 		return(handle >= 0);
@@ -319,6 +359,12 @@ public:
 	bool get_aes_keys(string *ckey, string *ivec) {
 		return(aes.getKeys(ckey, ivec));
 	}
+	void set_aes_mode(cAes::eMode mode) {
+		aes.setMode(mode);
+	}
+	bool is_aes_gcm() {
+		return(aes.isGcm());
+	}
 	void setErrorTypeString(eSocketError errorType, const char *errorString) {
 		errorTypeStrings[errorType] = errorString ? errorString : "";
 	}
@@ -328,6 +374,9 @@ public:
 	u_int64_t getLastTimeOkWrite() {
 		return(lastTimeOkWrite);
 	}
+	int getTimeoutReadBlock() {
+		return(timeouts.readblock);
+	}
 protected:
 	void clearError();
 	void sleep(int s);
@@ -463,6 +512,11 @@ public:
 		size_t length;
 		size_t capacity;
 	};
+	enum eReadPartResult {
+		_rp_incomplete,
+		_rp_complete,
+		_rp_error
+	};
 public:
 	cSocketBlock(const char *name, bool autoClose = false);
 	~cSocketBlock();
@@ -478,6 +532,8 @@ public:
 		return(readBlock(str, typeCode, xor_key, quietEwouldblock, timeout));
 	}
 	string readLine(u_char **remainder = NULL, size_t *remainder_length = NULL);
+	eReadPartResult readBlockPart(u_char **data, size_t *dataLen, eTypeEncode typeCode = _te_na, string xor_key = "", size_t bufferIncLength = 0);
+	eReadPartResult readLinePart(string *line, u_char **remainder = NULL, size_t *remainder_length = NULL, size_t maxLength = 64 * 1024);
 	void readDecodeAesAndResendTo(cSocketBlock *dest, u_char *remainder = NULL, size_t remainder_length = 0, u_int16_t timeout = 0,
 				      SimpleBuffer *rsltBuffer = NULL);
 	void generate_rsa_keys(unsigned keylen = 2048) {
@@ -490,6 +546,8 @@ public:
 		return(rsa.setPubKey(key));
 	}
 protected:
+	bool writeBlockAesGcm(u_char *data, size_t dataLen);
+	bool decodeReadBuffer(eTypeEncode typeEncode, string &xor_key);
 	bool checkSumReadBuffer();
 	u_int32_t dataSum(u_char *data, size_t dataLen);
 protected:
@@ -497,6 +555,96 @@ protected:
 	cRsa rsa;
 private:
 	char *block_header_string;
+	bool readPartActive;
+};
+
+
+/**
+  * Epoll reactor for cServer connections (replaces listen thread and thread per connection).
+  * The reactor thread accepts new connections and waits for readable sockets and timers,
+  * connection steps (cServerConnection::reactor_step - must not block) run in a fixed pool of workers,
+  * blocking parts (cServerConnection::reactor_task - handshake, sql, ...) in a bounded pool of task threads.
+  * Each connection is in one place at a time (waiting, ready, in worker, in task), so its steps never run concurrently.
+  * Connections without step implementation get their own thread as before (reactor_step returns _rw_thread).
+*/
+
+class cServerReactor {
+public:
+	enum eEvent {
+		_re_start,
+		_re_read,
+		_re_timeout,
+		_re_wake,
+		_re_task_done
+	};
+	enum eWait {
+		_rw_read,
+		_rw_timer,
+		_rw_task,
+		_rw_thread,
+		_rw_end
+	};
+private:
+	enum eConnectionState {
+		_rcs_na,
+		_rcs_ready,
+		_rcs_busy,
+		_rcs_wait_read,
+		_rcs_wait_timer,
+		_rcs_task
+	};
+	struct sReady {
+		class cServerConnection *connection;
+		eEvent event;
+	};
+public:
+	cServerReactor(class cServer *server, unsigned workers, unsigned tasks);
+	~cServerReactor();
+	bool start();
+	void stop();
+	bool addListen(cSocket *listen_socket);
+	void add(class cServerConnection *connection);
+	void wake(class cServerConnection *connection);
+	string getStatString();
+private:
+	void process(class cServerConnection *connection, eEvent event);
+	void pushReady(class cServerConnection *connection, eEvent event);
+	void setTimer(class cServerConnection *connection, u_int64_t time_ms);
+	void clearTimer(class cServerConnection *connection);
+	void unregister(class cServerConnection *connection);
+	void kick();
+	static void *reactorThreadFunction(void *arg);
+	void reactorProcess();
+	static void *workerThreadFunction(void *arg);
+	void workerProcess();
+	static void *taskThreadFunction(void *arg);
+	void taskProcess();
+	void lock() {
+		pthread_mutex_lock(&mutex);
+	}
+	void unlock() {
+		pthread_mutex_unlock(&mutex);
+	}
+private:
+	class cServer *server;
+	unsigned workers_count;
+	unsigned task_threads_count;
+	int epoll_fd;
+	int event_fd;
+	pthread_t reactor_thread;
+	pthread_t *worker_threads;
+	pthread_t *task_threads;
+	vector<cSocket*> listen_sockets;
+	map<u_int64_t, class cServerConnection*> connections;
+	u_int64_t connections_id;
+	set<pair<u_int64_t, u_int64_t> > timers;
+	deque<sReady> ready_queue;
+	deque<class cServerConnection*> task_queue;
+	pthread_mutex_t mutex;
+	pthread_cond_t ready_cond;
+	pthread_cond_t task_cond;
+	unsigned tasks_active;
+	volatile bool terminating;
 };
 
 
@@ -509,19 +657,29 @@ private:
 public:
 	 cServer(bool udp = false, bool simple_read = false);
 	 virtual ~cServer();
+	 void setReactor(unsigned workers, unsigned task_threads);
 	 bool listen_start(const char *name, string host, u_int16_t port, unsigned index = 0);
 	 void listen_stop(unsigned index = 0);
+	 void reactor_stop();
 	 static void *listen_process(void *arg);
 	 void listen_process(int index);
+	 void acceptConnection(cSocket *clientSocket);
 	 virtual void createConnection(cSocket *socket);
+	 void startConnection(class cServerConnection *connection);
 	 virtual void evData(u_char *data, size_t dataLen);
 	 void setStartVerbString(const char *startVerbString);
+	 bool isReactor() {
+		return(reactor != NULL);
+	 }
 protected:
 	 bool udp;
 	 bool simple_read;
 	 cSocketBlock *listen_socket[MAX_LISTEN_SOCKETS];
 	 pthread_t listen_thread[MAX_LISTEN_SOCKETS];
 	 string startVerbString;
+	 unsigned reactor_workers;
+	 unsigned reactor_task_threads;
+	 cServerReactor *reactor;
 };
 
 
@@ -533,6 +691,9 @@ public:
 	static void *connection_process(void *arg);
 	virtual void connection_process();
 	virtual void evData(u_char *data, size_t dataLen);
+	virtual cServerReactor::eWait reactor_step(cServerReactor::eEvent event, u_int64_t *wait_ms);
+	virtual void reactor_task();
+	void reactor_wake();
 	void setTerminateSocket();
 	pthread_t getThread() {
 		return(thread);
@@ -542,6 +703,14 @@ protected:
 	bool simple_read;
 	pthread_t thread;
 	u_int64_t begin_time_ms;
+	cServerReactor *reactor;
+private:
+	u_int64_t reactor_id;
+	int reactor_connection_state;
+	u_int64_t reactor_timer_ms;
+	bool reactor_registered;
+	bool reactor_wake_pending;
+friend class cServerReactor;
 };
 
 
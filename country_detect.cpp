@@ -488,6 +488,8 @@ string CheckInternational::numberNormalized(const char *number, CountryPrefixes
 
 
 CountryPrefixes::CountryPrefixes() {
+	data_trie_ok = false;
+	customer_data_simple_trie_ok = false;
 }
 
 CountryPrefixes::~CountryPrefixes() {
@@ -568,12 +570,86 @@ bool CountryPrefixes::load(SqlDb *sqlDb) {
 	if(_createSqlObject) {
 		delete sqlDb;
 	}
+	buildIndex();
 	return(true);
 }
 
 void CountryPrefixes::clear() {
 	data.clear();
 	customer_data_simple.clear();
+	data_trie.clear();
+	customer_data_simple_trie.clear();
+	data_trie_ok = false;
+	customer_data_simple_trie_ok = false;
+	country_prefix_number.clear();
+	napa_countries.clear();
+}
+
+void CountryPrefixes::buildIndex() {
+	for(int pass = 0; pass < 2; pass++) {
+		vector<CountryPrefix_rec> *data = pass == 0 ? &this->customer_data_simple : &this->data;
+		cDigitTrie *trie = pass == 0 ? &this->customer_data_simple_trie : &this->data_trie;
+		bool *trie_ok = pass == 0 ? &this->customer_data_simple_trie_ok : &this->data_trie_ok;
+		trie->clear();
+		*trie_ok = true;
+		for(unsigned i = 0; i < data->size(); i++) {
+			CountryPrefix_rec *rec = &(*data)[i];
+			// value is the last record with the same prefix - _getCountry collects the others backwards
+			if(!trie->add(rec->number.c_str(), i, true)) {
+				*trie_ok = false;
+			}
+			// customer data first, first record of country wins
+			country_prefix_number.insert(make_pair(rec->country_code, rec->number));
+			if(rec->number.length() == 4 && rec->number[0] == '1') {
+				napa_countries.insert(rec->country_code);
+			}
+		}
+		if(!*trie_ok) {
+			trie->clear();
+		}
+	}
+}
+
+bool CountryPrefixes::findRec(const char *number, vector<CountryPrefix_rec> *data, vector<CountryPrefix_rec>::iterator *findRecIt) {
+	cDigitTrie *trie = data == &this->customer_data_simple ? &this->customer_data_simple_trie : &this->data_trie;
+	bool trie_ok = data == &this->customer_data_simple ? this->customer_data_simple_trie_ok : this->data_trie_ok;
+	if(trie_ok) {
+		u_int32_t index = trie->findLongestPrefix(number);
+		if(index == DIGIT_TRIE_NO_VALUE) {
+			return(false);
+		}
+		*findRecIt = data->begin() + index;
+		return(true);
+	}
+	*findRecIt = std::lower_bound(data->begin(), data->end(), number);
+	if(*findRecIt == data->end()) {
+		--*findRecIt;
+	}
+	int _redukSizeFindNumber = 0;
+	while(strncmp((*findRecIt)->number.c_str(), number, (*findRecIt)->number.length())) {
+		if((*findRecIt)->number[0] < number[0]) {
+			return(false);
+		}
+		if((!_redukSizeFindNumber || _redukSizeFindNumber > 1) &&
+		   atol((*findRecIt)->number.c_str()) < atol(string(number, min(strlen(number), (*findRecIt)->number.length())).c_str())) {
+			if(_redukSizeFindNumber) {
+				--_redukSizeFindNumber;
+			} else {
+				_redukSizeFindNumber = (*findRecIt)->number.length() - 1;
+			}
+			*findRecIt = std::lower_bound(data->begin(), data->end(), string(number).substr(0, _redukSizeFindNumber).c_str());
+			if(*findRecIt == data->end()) {
+				--*findRecIt;
+			}
+		} else {
+			if(*findRecIt == data->begin()) {
+				return(false);
+			} else {
+				--*findRecIt;
+			}
+		}
+	}
+	return(!strncmp((*findRecIt)->number.c_str(), number, (*findRecIt)->number.length()));
 }
 
 string CountryPrefixes::getCountry(const char *number, vector<string> *countries, string *country_prefix,
@@ -684,39 +760,7 @@ string CountryPrefixes::_getCountry(const char *number, vector<string> *countrie
 	for(int pass = 0; pass < 2; pass++) {
 		vector<CountryPrefix_rec> *data = pass == 0 ? &this->customer_data_simple : &this->data;
 		if(data->size()) {
-			findRecIt = std::lower_bound(data->begin(), data->end(), number);
-			if(findRecIt == data->end()) {
-				--findRecIt;
-			}
-			int _redukSizeFindNumber = 0;
-			bool okFind = true;
-			while(strncmp(findRecIt->number.c_str(), number, findRecIt->number.length())) {
-				if(findRecIt->number[0] < number[0]) {
-					okFind = false;
-					break;
-				}
-				if((!_redukSizeFindNumber || _redukSizeFindNumber > 1) &&
-				   atol(findRecIt->number.c_str()) < atol(string(number, min(strlen(number), findRecIt->number.length())).c_str())) {
-					if(_redukSizeFindNumber) {
-						--_redukSizeFindNumber;
-					} else {
-						_redukSizeFindNumber = findRecIt->number.length() - 1;
-					}
-					findRecIt = std::lower_bound(data->begin(), data->end(), string(number).substr(0, _redukSizeFindNumber).c_str());
-					if(findRecIt == data->end()) {
-						--findRecIt;
-					}
-				} else {
-					if(findRecIt == data->begin()) {
-						okFind = false;
-						break;
-					} else {
-						--findRecIt;
-					}
-				}
-			}
-			if(okFind &&
-			   !strncmp(findRecIt->number.c_str(), number, findRecIt->number.length())) {
+			if(findRec(number, data, &findRecIt)) {
 				string rslt = findRecIt->country_code;
 				string rsltNumber = findRecIt->number;
 				if(country_prefix) {
@@ -835,77 +879,77 @@ void CountryDetect::load(SqlDb *sqlDb) {
 
 string CountryDetect::getCountryByPhoneNumber(const char *phoneNumber) {
 	string rslt;
-	lock();
+	bool rcu_lock = read_lock();
 	if(countryPrefixes->loadOK) {
 		rslt = countryPrefixes->getCountry(phoneNumber, NULL, NULL, checkInternational);
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
 unsigned CountryDetect::getCountryIdByPhoneNumber(const char *phoneNumber) {
 	unsigned rslt = 0;
-	lock();
+	bool rcu_lock = read_lock();
 	if(countryPrefixes->loadOK) {
 		string rslt_str = countryPrefixes->getCountry(phoneNumber, NULL, NULL, checkInternational);
 		if(!rslt_str.empty()) {
 			rslt = countryCodes->getIdCountry(rslt_str.c_str());
 		}
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
 bool CountryDetect::isLocalByPhoneNumber(const char *phoneNumber) {
 	bool rslt = false;
-	lock();
+	bool rcu_lock = read_lock();
 	if(countryPrefixes->loadOK) {
 		rslt = countryPrefixes->isLocal(phoneNumber, checkInternational);
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
 string CountryDetect::getCountryByIP(vmIP ip) {
 	string rslt;
-	lock();
+	bool rcu_lock = read_lock();
 	if(geoIP_country->loadOK) {
 		rslt = geoIP_country->getCountry(ip);
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
 unsigned CountryDetect::getCountryIdByIP(vmIP ip) {
 	unsigned rslt = 0;
-	lock();
+	bool rcu_lock = read_lock();
 	if(geoIP_country->loadOK) {
 		string rslt_str = geoIP_country->getCountry(ip);
 		if(!rslt_str.empty()) {
 			rslt = countryCodes->getIdCountry(rslt_str.c_str());
 		}
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
 bool CountryDetect::isLocalByIP(vmIP ip) {
 	bool rslt = false;
-	lock();
+	bool rcu_lock = read_lock();
 	if(geoIP_country->loadOK) {
 		rslt = geoIP_country->isLocal(ip, checkInternational);
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
 string CountryDetect::getContinentByCountry(const char *country) {
 	string rslt;
-	lock();
+	bool rcu_lock = read_lock();
 	if(countryCodes->loadOK) {
 		rslt = countryCodes->getContinent(country);
 	}
-	unlock();
+	read_unlock(rcu_lock);
 	return(rslt);
 }
 
@@ -943,16 +987,22 @@ void CountryDetect::applyReload() {
 	if(reload_do) {
 		lock_reload();
 		if(reload_do) {
+			CountryCodes *countryCodes_old = countryCodes;
+			CountryPrefixes *countryPrefixes_old = countryPrefixes;
+			GeoIP_country *geoIP_country_old = geoIP_country;
+			CheckInternational *checkInternational_old = checkInternational;
 			lock();
-			delete countryCodes;
-			delete countryPrefixes;
-			delete geoIP_country;
-			delete checkInternational;
 			countryCodes = countryCodes_reload;
 			countryPrefixes = countryPrefixes_reload;
 			geoIP_country = geoIP_country_reload;
 			checkInternational = checkInternational_reload;
 			unlock();
+			// wait for lookups started before the swap
+			rcu.synchronize();
+			delete countryCodes_old;
+			delete countryPrefixes_old;
+			delete geoIP_country_old;
+			delete checkInternational_old;
 			countryCodes_reload = NULL;
 			countryPrefixes_reload = NULL;
 			geoIP_country_reload = NULL;
@@ -6,9 +6,12 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <math.h>
 
 #include "sql_db.h"
+#include "digit_trie.h"
+#include "rcu.h"
 
 
 using namespace std;
@@ -187,36 +190,24 @@ public:
 		return(countryIsNapa(country.c_str()));
 	}
 	bool countryIsNapa(const char *country) {
-		for(int pass = 0; pass < 2; pass++) {
-			if(pass == 1 || !customer_data_simple.empty()) {
-				vector<CountryPrefix_rec> *data = pass == 0 ? &this->customer_data_simple : &this->data;
-				for(vector<CountryPrefix_rec>::iterator iter = data->begin(); iter != data->end(); iter++) {
-					if(iter->country_code == country &&
-					   iter->number.length() == 4 &&
-					   iter->number[0] == '1') {
-						return(true);
-					}
-				}
-			}
-		}
-		return(false);
+		return(napa_countries.find(country) != napa_countries.end());
 	}
 	string getPrefixNumber(const char *country) {
-		for(int pass = 0; pass < 2; pass++) {
-			if(pass == 1 || !customer_data_simple.empty()) {
-				vector<CountryPrefix_rec> *data = pass == 0 ? &this->customer_data_simple : &this->data;
-				for(vector<CountryPrefix_rec>::iterator iter = data->begin(); iter != data->end(); iter++) {
-					if(iter->country_code == country) {
-						return(iter->number);
-					}
-				}
-			}
-		}
-		return("");
+		map<string, string>::iterator iter = country_prefix_number.find(country);
+		return(iter != country_prefix_number.end() ? iter->second : "");
 	}
+private:
+	void buildIndex();
+	bool findRec(const char *number, vector<CountryPrefix_rec> *data, vector<CountryPrefix_rec>::iterator *findRecIt);
 private:
 	vector<CountryPrefix_rec> data;
 	vector<CountryPrefix_rec> customer_data_simple;
+	cDigitTrie data_trie;
+	cDigitTrie customer_data_simple_trie;
+	bool data_trie_ok;
+	bool customer_data_simple_trie_ok;
+	map<string, string> country_prefix_number;
+	set<string> napa_countries;
 };
 
 
@@ -312,6 +303,20 @@ public:
 	void unlock() {
 		__sync_lock_release(&_sync);
 	}
+	bool read_lock() {
+		if(rcu.read_lock()) {
+			return(true);
+		}
+		lock();
+		return(false);
+	}
+	void read_unlock(bool rcu_lock) {
+		if(rcu_lock) {
+			rcu.read_unlock();
+		} else {
+			unlock();
+		}
+	}
 	void lock_reload() {
 		while(__sync_lock_test_and_set(&_sync_reload, 1));
 	}
@@ -330,6 +335,7 @@ private:
 	volatile bool reload_do;
 	volatile int _sync;
 	volatile int _sync_reload;
+	cEpochRcu rcu;
 };
 
 
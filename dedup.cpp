@@ -0,0 +1,377 @@
+#include <syslog.h>
+#include <sstream>
+#include <iomanip>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "dedup.h"
+#include "tools.h"
+
+
+extern int opt_dup_check_hash;
+
+
+static bool dedup_crc32c_hw = false;
+static u_int32_t dedup_crc32c_table[256];
+
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline u_int64_t fmix64(u_int64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdull;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ull;
+	k ^= k >> 33;
+	return(k);
+}
+
+static inline u_int64_t read64(const u_char *p) {
+	u_int64_t v;
+	memcpy(&v, p, sizeof(v));
+	return(v);
+}
+
+static inline u_int32_t read32(const u_char *p) {
+	u_int32_t v;
+	memcpy(&v, p, sizeof(v));
+	return(v);
+}
+
+
+/* crc32c (castagnoli)
+ * two interleaved lanes (even / odd 8-byte words) give a 64-bit result
+ * and keep two independent dependency chains in flight
+ */
+
+static void dedup_crc32c_init_table() {
+	for(u_int32_t i = 0; i < 256; i++) {
+		u_int32_t crc = i;
+		for(int j = 0; j < 8; j++) {
+			crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+		}
+		dedup_crc32c_table[i] = crc;
+	}
+}
+
+static inline u_int32_t crc32c_sw_u8(u_int32_t crc, u_char v) {
+	return(dedup_crc32c_table[(crc ^ v) & 0xFF] ^ (crc >> 8));
+}
+
+static inline u_int32_t crc32c_sw_u64(u_int32_t crc, u_int64_t v) {
+	for(int i = 0; i < 8; i++) {
+		crc = crc32c_sw_u8(crc, v & 0xFF);
+		v >>= 8;
+	}
+	return(crc);
+}
+
+static void dedup_crc32c_sw(const u_char *data, unsigned len, u_int32_t *lane_a, u_int32_t *lane_b) {
+	u_int32_t a = 0xFFFFFFFF;
+	u_int32_t b = 0x9E3779B9;
+	while(len >= 16) {
+		a = crc32c_sw_u64(a, read64(data));
+		b = crc32c_sw_u64(b, read64(data + 8));
+		data += 16;
+		len -= 16;
+	}
+	while(len--) {
+		a = crc32c_sw_u8(a, *data++);
+	}
+	*lane_a = a;
+	*lane_b = b;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static void dedup_crc32c_sse42(const u_char *data, unsigned len, u_int32_t *lane_a, u_int32_t *lane_b) {
+	u_int64_t a = 0xFFFFFFFF;
+	u_int64_t b = 0x9E3779B9;
+	while(len >= 16) {
+		a = _mm_crc32_u64(a, read64(data));
+		b = _mm_crc32_u64(b, read64(data + 8));
+		data += 16;
+		len -= 16;
+	}
+	if(len >= 8) {
+		a = _mm_crc32_u64(a, read64(data));
+		data += 8;
+		len -= 8;
+	}
+	u_int32_t a32 = a;
+	if(len >= 4) {
+		a32 = _mm_crc32_u32(a32, read32(data));
+		data += 4;
+		len -= 4;
+	}
+	while(len--) {
+		a32 = _mm_crc32_u8(a32, *data++);
+	}
+	*lane_a = a32;
+	*lane_b = b;
+}
+#endif
+
+static inline void dedup_hash_crc32c(const u_char *data, unsigned len, u_int64_t *h) {
+	u_int32_t lane_a, lane_b;
+	#if defined(__x86_64__)
+	if(dedup_crc32c_hw) {
+		dedup_crc32c_sse42(data, len, &lane_a, &lane_b);
+	} else
+	#endif
+	dedup_crc32c_sw(data, len, &lane_a, &lane_b);
+	h[0] = ((u_int64_t)lane_a << 32) | lane_b;
+	h[1] = fmix64(h[0] ^ len);
+}
+
+
+/* xxh64 */
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ull
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME64_3 0x165667B19E3779F9ull
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ull
+
+static inline u_int64_t xxh64_round(u_int64_t acc, u_int64_t input) {
+	acc += input * XXH_PRIME64_2;
+	acc = ROTL64(acc, 31);
+	acc *= XXH_PRIME64_1;
+	return(acc);
+}
+
+static inline u_int64_t xxh64_merge_round(u_int64_t acc, u_int64_t val) {
+	val = xxh64_round(0, val);
+	acc ^= val;
+	acc = acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+	return(acc);
+}
+
+static u_int64_t xxh64(const u_char *data, unsigned len, u_int64_t seed) {
+	const u_char *end = data + len;
+	u_int64_t h;
+	if(len >= 32) {
+		const u_char *limit = end - 32;
+		u_int64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		u_int64_t v2 = seed + XXH_PRIME64_2;
+		u_int64_t v3 = seed;
+		u_int64_t v4 = seed - XXH_PRIME64_1;
+		do {
+			v1 = xxh64_round(v1, read64(data)); data += 8;
+			v2 = xxh64_round(v2, read64(data)); data += 8;
+			v3 = xxh64_round(v3, read64(data)); data += 8;
+			v4 = xxh64_round(v4, read64(data)); data += 8;
+		} while(data <= limit);
+		h = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+		h = xxh64_merge_round(h, v1);
+		h = xxh64_merge_round(h, v2);
+		h = xxh64_merge_round(h, v3);
+		h = xxh64_merge_round(h, v4);
+	} else {
+		h = seed + XXH_PRIME64_5;
+	}
+	h += len;
+	while(data + 8 <= end) {
+		h ^= xxh64_round(0, read64(data));
+		h = ROTL64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		data += 8;
+	}
+	if(data + 4 <= end) {
+		h ^= (u_int64_t)read32(data) * XXH_PRIME64_1;
+		h = ROTL64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		data += 4;
+	}
+	while(data < end) {
+		h ^= (*data) * XXH_PRIME64_5;
+		h = ROTL64(h, 11) * XXH_PRIME64_1;
+		++data;
+	}
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return(h);
+}
+
+static inline void dedup_hash_xxh64(const u_char *data, unsigned len, u_int64_t *h) {
+	h[0] = xxh64(data, len, 0);
+	h[1] = fmix64(h[0]);
+}
+
+
+/* murmur3 x64 128 */
+
+static void dedup_hash_murmur3(const u_char *data, unsigned len, u_int64_t *h) {
+	const u_int64_t c1 = 0x87c37b91114253d5ull;
+	const u_int64_t c2 = 0x4cf5ad432745937full;
+	u_int64_t h1 = 0;
+	u_int64_t h2 = 0;
+	unsigned nblocks = len / 16;
+	for(unsigned i = 0; i < nblocks; i++) {
+		u_int64_t k1 = read64(data + i * 16);
+		u_int64_t k2 = read64(data + i * 16 + 8);
+		k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = ROTL64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+		k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = ROTL64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+	const u_char *tail = data + nblocks * 16;
+	u_int64_t k1 = 0;
+	u_int64_t k2 = 0;
+	switch(len & 15) {
+	case 15: k2 ^= ((u_int64_t)tail[14]) << 48;
+	case 14: k2 ^= ((u_int64_t)tail[13]) << 40;
+	case 13: k2 ^= ((u_int64_t)tail[12]) << 32;
+	case 12: k2 ^= ((u_int64_t)tail[11]) << 24;
+	case 11: k2 ^= ((u_int64_t)tail[10]) << 16;
+	case 10: k2 ^= ((u_int64_t)tail[9]) << 8;
+	case 9:  k2 ^= ((u_int64_t)tail[8]);
+		 k2 *= c2; k2 = ROTL64(k2, 33); k2 *= c1; h2 ^= k2;
+	case 8:  k1 ^= ((u_int64_t)tail[7]) << 56;
+	case 7:  k1 ^= ((u_int64_t)tail[6]) << 48;
+	case 6:  k1 ^= ((u_int64_t)tail[5]) << 40;
+	case 5:  k1 ^= ((u_int64_t)tail[4]) << 32;
+	case 4:  k1 ^= ((u_int64_t)tail[3]) << 24;
+	case 3:  k1 ^= ((u_int64_t)tail[2]) << 16;
+	case 2:  k1 ^= ((u_int64_t)tail[1]) << 8;
+	case 1:  k1 ^= ((u_int64_t)tail[0]);
+		 k1 *= c1; k1 = ROTL64(k1, 31); k1 *= c2; h1 ^= k1;
+	}
+	h1 ^= len;
+	h2 ^= len;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+	h[0] = h1;
+	h[1] = h2;
+}
+
+
+void dedup_hash_init() {
+	dedup_crc32c_init_table();
+	#if defined(__x86_64__)
+	__builtin_cpu_init();
+	dedup_crc32c_hw = __builtin_cpu_supports("sse4.2");
+	#endif
+	extern int opt_dup_check;
+	if(opt_dup_check) {
+		syslog(LOG_NOTICE, "deduplicate hash: %s%s",
+		       dedup_hash_type_name(opt_dup_check_hash),
+		       opt_dup_check_hash == _dedup_hash_crc32c ? (dedup_crc32c_hw ? " (sse4.2)" : " (sw)") : "");
+	}
+}
+
+void dedup_hash(const void *data, unsigned len, u_int16_t *digest, int type) {
+	// digest is u_int16_t[8] - compute 64bit lanes in local buffer, not via casted (unaligned) pointer
+	u_int64_t h[2];
+	switch(type ? type : opt_dup_check_hash) {
+	case _dedup_hash_crc32c:
+		dedup_hash_crc32c((const u_char*)data, len, h);
+		memcpy(digest, h, sizeof(h));
+		break;
+	case _dedup_hash_xxh64:
+		dedup_hash_xxh64((const u_char*)data, len, h);
+		memcpy(digest, h, sizeof(h));
+		break;
+	case _dedup_hash_murmur3:
+		dedup_hash_murmur3((const u_char*)data, len, h);
+		memcpy(digest, h, sizeof(h));
+		break;
+	default: {
+		MD5_CTX ctx;
+		MD5_Init(&ctx);
+		MD5_Update(&ctx, (void*)data, len);
+		MD5_Final((unsigned char*)digest, &ctx);
+		}
+		break;
+	}
+	// digest[0] == 0 means 'not calculated' in packet headers
+	if(!digest[0]) {
+		digest[0] = 1;
+	}
+}
+
+u_int64_t dedup_hash64(const void *data, unsigned len) {
+	return(xxh64((const u_char*)data, len, 0));
+}
+
+bool dedup_hash_crc32c_hw() {
+	return(dedup_crc32c_hw);
+}
+
+const char *dedup_hash_type_name(int type) {
+	switch(type) {
+	case _dedup_hash_md5:
+		return("md5");
+	case _dedup_hash_crc32c:
+		return("crc32c");
+	case _dedup_hash_xxh64:
+		return("xxh64");
+	case _dedup_hash_murmur3:
+		return("murmur3");
+	}
+	return("");
+}
+
+int dedup_hash_type_from_name(const char *name) {
+	if(!strcasecmp(name, "md5")) {
+		return(_dedup_hash_md5);
+	} else if(!strcasecmp(name, "crc32c") || !strcasecmp(name, "crc")) {
+		return(_dedup_hash_crc32c);
+	} else if(!strcasecmp(name, "xxh64") || !strcasecmp(name, "xxhash")) {
+		return(_dedup_hash_xxh64);
+	} else if(!strcasecmp(name, "murmur3") || !strcasecmp(name, "murmur")) {
+		return(_dedup_hash_murmur3);
+	}
+	return(0);
+}
+
+
+cPacketDedup::cPacketDedup(unsigned sets_bits, unsigned window_ms) {
+	unsigned sets_count = 1u << sets_bits;
+	sets = new FILE_LINE(0) sSet[sets_count];
+	sets_mask = sets_count - 1;
+	this->window_ms = window_ms;
+	clear();
+}
+
+cPacketDedup::~cPacketDedup() {
+	delete [] sets;
+}
+
+void cPacketDedup::getStat(sStat *stat) {
+	stat->packets = this->stat.packets;
+	stat->duplicates = this->stat.duplicates;
+	stat->evictions = this->stat.evictions;
+}
+
+double cPacketDedup::getDuplicatesPerc() {
+	sStat stat;
+	getStat(&stat);
+	double perc = stat.packets > stat_last.packets ?
+		       (double)(stat.duplicates - stat_last.duplicates) / (stat.packets - stat_last.packets) * 100 :
+		       0;
+	stat_last = stat;
+	return(perc);
+}
+
+string cPacketDedup::getStatString() {
+	sStat stat;
+	getStat(&stat);
+	ostringstream outStr;
+	outStr << "packets: " << stat.packets
+	       << ", duplicates: " << stat.duplicates
+	       << ", evictions in window: " << stat.evictions;
+	return(outStr.str());
+}
+
+void cPacketDedup::clear() {
+	memset((void*)sets, 0, (sets_mask + 1) * sizeof(sSet));
+	memset((void*)&stat, 0, sizeof(stat));
+	memset(&stat_last, 0, sizeof(stat_last));
+}
@@ -0,0 +1,107 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+
+#include <sys/types.h>
+#include <string.h>
+#include <string>
+
+#include "md5.h"
+
+
+#define DEDUP_DIGEST_LENGTH MD5_DIGEST_LENGTH
+#define DEDUP_TABLE_WAYS 4
+#define DEDUP_TABLE_SETS_BITS_DEFAULT 15
+
+
+enum eDedupHashType {
+	_dedup_hash_md5 = 1,
+	_dedup_hash_crc32c = 2,
+	_dedup_hash_xxh64 = 3,
+	_dedup_hash_murmur3 = 4
+};
+
+void dedup_hash_init();
+void dedup_hash(const void *data, unsigned len, u_int16_t *digest, int type = 0);
+u_int64_t dedup_hash64(const void *data, unsigned len);
+bool dedup_hash_crc32c_hw();
+const char *dedup_hash_type_name(int type);
+int dedup_hash_type_from_name(const char *name);
+
+class cPacketDedup {
+public:
+	struct sStat {
+		u_int64_t packets;
+		u_int64_t duplicates;
+		u_int64_t evictions;
+	};
+private:
+	struct sSet {
+		u_int64_t tag[DEDUP_TABLE_WAYS];
+		u_int32_t time_ms[DEDUP_TABLE_WAYS];
+		u_int32_t _filler[DEDUP_TABLE_WAYS];
+	};
+public:
+	cPacketDedup(unsigned sets_bits = DEDUP_TABLE_SETS_BITS_DEFAULT, unsigned window_ms = 0);
+	~cPacketDedup();
+	inline bool check(u_int16_t *digest, u_int64_t time_ms) {
+		++stat.packets;
+		u_int64_t tag = ((u_int64_t*)digest)[0];
+		if(!tag) {
+			tag = 1;
+		}
+		sSet *set = &sets[((u_int64_t*)digest)[1] & sets_mask];
+		u_int32_t _time_ms = (u_int32_t)time_ms;
+		int replace_way = 0;
+		u_int32_t replace_age = 0;
+		bool replace_empty = false;
+		for(int i = 0; i < DEDUP_TABLE_WAYS; i++) {
+			if(!set->tag[i]) {
+				if(!replace_empty) {
+					replace_way = i;
+					replace_empty = true;
+				}
+				continue;
+			}
+			u_int32_t age = _time_ms - set->time_ms[i];
+			if(age > (u_int32_t)-1 / 2) {
+				// packet older than the stored one (reordered input)
+				age = 0;
+			}
+			if(set->tag[i] == tag) {
+				if(!window_ms || age <= window_ms) {
+					++stat.duplicates;
+					return(true);
+				}
+				// same content seen before the time window - refresh the slot
+				replace_way = i;
+				replace_empty = true;
+				break;
+			}
+			if(!replace_empty && age >= replace_age) {
+				replace_way = i;
+				replace_age = age;
+			}
+		}
+		if(!replace_empty &&
+		   (!window_ms || replace_age <= window_ms)) {
+			++stat.evictions;
+		}
+		set->tag[replace_way] = tag;
+		set->time_ms[replace_way] = _time_ms;
+		return(false);
+	}
+	void getStat(sStat *stat);
+	double getDuplicatesPerc();
+	std::string getStatString();
+	void clear();
+private:
+	sSet *sets;
+	u_int32_t sets_mask;
+	u_int32_t window_ms;
+	volatile sStat stat;
+	sStat stat_last;
+};
+
+
+#endif //DEDUP_H
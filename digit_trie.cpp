@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "digit_trie.h"
+
+
+using namespace std;
+
+
+cDigitTrie::cDigitTrie() {
+	count = 0;
+	newNode();
+}
+
+bool cDigitTrie::add(const char *key, u_int32_t value, bool replace) {
+	if(!isIndexable(key)) {
+		return(false);
+	}
+	u_int32_t node = 0;
+	for(const char *p = key; *p; p++) {
+		int child = childIndex(*p);
+		if(!nodes[node].childs[child]) {
+			u_int32_t new_node = newNode();
+			nodes[node].childs[child] = new_node;
+		}
+		node = nodes[node].childs[child];
+	}
+	if(nodes[node].value == DIGIT_TRIE_NO_VALUE) {
+		nodes[node].value = value;
+		++count;
+	} else if(replace) {
+		nodes[node].value = value;
+	}
+	return(true);
+}
+
+void cDigitTrie::clear() {
+	nodes.clear();
+	count = 0;
+	newNode();
+}
+
+bool cDigitTrie::isIndexable(const char *key) {
+	if(!key || !*key) {
+		return(false);
+	}
+	for(const char *p = key; *p; p++) {
+		if(childIndex(*p) < 0) {
+			return(false);
+		}
+	}
+	return(true);
+}
+
+u_int32_t cDigitTrie::findExact(const char *key) const {
+	u_int32_t node = 0;
+	for(const char *p = key; *p; p++) {
+		int child = childIndex(*p);
+		if(child < 0 || !(node = nodes[node].childs[child])) {
+			return(DIGIT_TRIE_NO_VALUE);
+		}
+	}
+	return(nodes[node].value);
+}
+
+u_int32_t cDigitTrie::findLongestPrefix(const char *key, unsigned *prefixLength) const {
+	u_int32_t rslt = DIGIT_TRIE_NO_VALUE;
+	u_int32_t node = 0;
+	unsigned length = 0;
+	for(const char *p = key; *p; p++) {
+		int child = childIndex(*p);
+		if(child < 0 || !(node = nodes[node].childs[child])) {
+			break;
+		}
+		++length;
+		if(nodes[node].value != DIGIT_TRIE_NO_VALUE) {
+			rslt = nodes[node].value;
+			if(prefixLength) {
+				*prefixLength = length;
+			}
+		}
+	}
+	return(rslt);
+}
+
+u_int32_t cDigitTrie::findShortestPrefix(const char *key, unsigned *prefixLength) const {
+	u_int32_t node = 0;
+	unsigned length = 0;
+	for(const char *p = key; *p; p++) {
+		int child = childIndex(*p);
+		if(child < 0 || !(node = nodes[node].childs[child])) {
+			break;
+		}
+		++length;
+		if(nodes[node].value != DIGIT_TRIE_NO_VALUE) {
+			if(prefixLength) {
+				*prefixLength = length;
+			}
+			return(nodes[node].value);
+		}
+	}
+	return(DIGIT_TRIE_NO_VALUE);
+}
+
+u_int32_t cDigitTrie::newNode() {
+	sNode node;
+	memset(node.childs, 0, sizeof(node.childs));
+	node.value = DIGIT_TRIE_NO_VALUE;
+	nodes.push_back(node);
+	return(nodes.size() - 1);
+}
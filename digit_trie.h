@@ -0,0 +1,62 @@
+#ifndef DIGIT_TRIE_H
+#define DIGIT_TRIE_H
+
+
+#include <sys/types.h>
+#include <vector>
+
+
+#define DIGIT_TRIE_CHILDS 13
+#define DIGIT_TRIE_NO_VALUE ((u_int32_t)-1)
+
+
+/**
+  * Compact trie for phone numbers and number prefixes.
+  * Alphabet is 0-9, '+', '*', '#' - keys with other characters are rejected by add().
+  * Nodes are packed in one vector and addressed by index (root is 0, child index 0 means no child).
+  * Structure is built once and then only read - concurrent lookups need no lock.
+*/
+
+class cDigitTrie {
+public:
+	struct sNode {
+		u_int32_t childs[DIGIT_TRIE_CHILDS];
+		u_int32_t value;
+	};
+public:
+	cDigitTrie();
+	bool add(const char *key, u_int32_t value, bool replace = false);
+	void clear();
+	static inline int childIndex(char c) {
+		if(c >= '0' && c <= '9') {
+			return(c - '0');
+		}
+		switch(c) {
+		case '+': return(10);
+		case '*': return(11);
+		case '#': return(12);
+		}
+		return(-1);
+	}
+	static bool isIndexable(const char *key);
+	u_int32_t findExact(const char *key) const;
+	u_int32_t findLongestPrefix(const char *key, unsigned *prefixLength = NULL) const;
+	u_int32_t findShortestPrefix(const char *key, unsigned *prefixLength = NULL) const;
+	bool isEmpty() const {
+		return(count == 0);
+	}
+	unsigned getCount() const {
+		return(count);
+	}
+	size_t getMemorySize() const {
+		return(nodes.capacity() * sizeof(sNode));
+	}
+private:
+	u_int32_t newNode();
+private:
+	std::vector<sNode> nodes;
+	unsigned count;
+};
+
+
+#endif //DIGIT_TRIE_H
@@ -114,11 +114,25 @@ void DSSL_EnvOnSessionClosing( DSSL_Env* env, DSSL_Session* s )
 
 	if( env->session_cache )
 	{
+		DSSL_EnvLockCache( env );
 		dssl_SessionKT_Release( env->session_cache, s->session_id );
+		DSSL_EnvUnlockCache( env );
 	}
 }
 
 
+void DSSL_EnvLockCache( DSSL_Env* env )
+{
+	while( __sync_lock_test_and_set( &env->cache_sync, 1 ) );
+}
+
+
+void DSSL_EnvUnlockCache( DSSL_Env* env )
+{
+	__sync_lock_release( &env->cache_sync );
+}
+
+
 DSSL_Env* DSSL_EnvCreate( int session_cache_size, uint32_t cache_timeout_interval )
 {
 	DSSL_Env* env = (DSSL_Env*) malloc( sizeof( DSSL_Env ) );
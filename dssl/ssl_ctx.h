@@ -49,17 +49,13 @@ typedef struct _DSSL_Env
 
 	dssl_SessionKeyTable*		session_cache;
 	DSSL_SessionTicketTable*	ticket_cache;
+	volatile int			cache_sync; /* session_cache and ticket_cache lock - sessions are decoded from several threads */
 
 	EVP_PKEY**				keys;
 	int						key_count;
 	int						keys_try_index; /* round-robin index of the first key to try */
 
-#ifndef NM_MULTI_THREADED_SSL
-	u_char			decompress_buffer[DSSL_MAX_RECORD_LENGTH];
-	u_char			decrypt_buffer[DSSL_MAX_COMPRESSED_LENGTH];
-#else
-	#error "Multi-threading is not implemented for DSSL_Env"
-#endif
+	/* decrypt and decompress buffers are per thread - see ssls_get_decrypt_buffer */
 
 } DSSL_Env;
 
@@ -86,6 +82,10 @@ DSSL_Session* DSSL_EnvCreateSession( DSSL_Env* env, struct in_addr dst_ip, uint1
 									struct in_addr src_ip, uint16_t src_port );
 void DSSL_EnvOnSessionClosing( DSSL_Env* env, DSSL_Session* sess );
 
+/* session_cache / ticket_cache lock */
+void DSSL_EnvLockCache( DSSL_Env* env );
+void DSSL_EnvUnlockCache( DSSL_Env* env );
+
 
 /*========= DSSL_ServerInfo =========*/
 /* Free a DSSL_ServerInfo structure */
@@ -714,13 +714,17 @@ int ssls_lookup_session( DSSL_Session* sess )
 	_ASSERT( sess );
 	_ASSERT( sess->env );
 	
-	if( sess->env->session_cache )
+	if( !sess->env->session_cache ) return NM_ERROR( DSSL_E_SSL_SESSION_NOT_IN_CACHE );
+
+	DSSL_EnvLockCache( sess->env );
+	sess_data = dssl_SessionKT_Find( sess->env->session_cache, sess->session_id );
+
+	if( !sess_data ) 
 	{
-		sess_data = dssl_SessionKT_Find( sess->env->session_cache, sess->session_id );
+		DSSL_EnvUnlockCache( sess->env );
+		return NM_ERROR( DSSL_E_SSL_SESSION_NOT_IN_CACHE );
 	}
 
-	if( !sess_data ) return NM_ERROR( DSSL_E_SSL_SESSION_NOT_IN_CACHE );
-
 	dssl_SessionKT_AddRef( sess_data );
 	memcpy( sess->master_secret, sess_data->master_secret, SSL3_MASTER_SECRET_SIZE );
 	sess->master_key_len = sess_data->master_secret_len;
@@ -733,6 +737,7 @@ int ssls_lookup_session( DSSL_Session* sess )
 		sess->cipher_suite = sess_data->ssl2_cipher_suite;
 	}
 	#endif //(OPENSSL_VERSION_NUMBER < 0x10100000L)
+	DSSL_EnvUnlockCache( sess->env );
 
 	return DSSL_RC_OK;
 }
@@ -745,6 +750,7 @@ void ssls_store_session( DSSL_Session* sess )
 	_ASSERT( sess->env );
 	if( !sess->env->session_cache ) return;
 
+	DSSL_EnvLockCache( sess->env );
 	sess_data = dssl_SessionKT_Find( sess->env->session_cache, sess->session_id );
 
 	if( sess_data )
@@ -756,23 +762,35 @@ void ssls_store_session( DSSL_Session* sess )
 	{
 		dssl_SessionKT_Add( sess->env->session_cache, sess );
 	}
+	DSSL_EnvUnlockCache( sess->env );
 }
 
 
 #ifdef NM_MULTI_THREADED_SSL
 	#error "Multithreading is not implemented for SSL session decode buffer!"
 #else
+/* sessions of one env are decoded from several threads (ssl reassembly shards), 
+   the buffers are allocated for each thread on the first use */
+static __thread u_char* decrypt_buffer = NULL;
+static __thread u_char* decompress_buffer = NULL;
+
 int ssls_get_decrypt_buffer( DSSL_Session* sess, u_char** data, uint32_t len )
 {
 	if(!data || !len ) return NM_ERROR( DSSL_E_INVALID_PARAMETER );
 
-	if( len > sizeof(sess->env->decrypt_buffer))
+	if( len > DSSL_MAX_COMPRESSED_LENGTH )
 	{
 		_ASSERT( FALSE ); /*decrypt_buffer is supposed to fit the biggest possible SSL record!*/
 		return NM_ERROR( DSSL_E_OUT_OF_MEMORY );
 	}
 
-	(*data) = sess->env->decrypt_buffer;
+	if( !decrypt_buffer )
+	{
+		decrypt_buffer = (u_char*) malloc( DSSL_MAX_COMPRESSED_LENGTH );
+		if( !decrypt_buffer ) return NM_ERROR( DSSL_E_OUT_OF_MEMORY );
+	}
+
+	(*data) = decrypt_buffer;
 	return DSSL_RC_OK;
 }
 
@@ -786,13 +804,19 @@ int ssls_get_decompress_buffer( DSSL_Session* sess, u_char** data, uint32_t len
 {
 	if(!data || !len ) return NM_ERROR( DSSL_E_INVALID_PARAMETER );
 
-	if( len > sizeof(sess->env->decompress_buffer))
+	if( len > DSSL_MAX_RECORD_LENGTH )
 	{
 		_ASSERT( FALSE ); /*decompressed record can not exceed 2^14 + 1024 bytes !*/
 		return NM_ERROR( DSSL_E_OUT_OF_MEMORY );
 	}
 
-	(*data) = sess->env->decompress_buffer;
+	if( !decompress_buffer )
+	{
+		decompress_buffer = (u_char*) malloc( DSSL_MAX_RECORD_LENGTH );
+		if( !decompress_buffer ) return NM_ERROR( DSSL_E_OUT_OF_MEMORY );
+	}
+
+	(*data) = decompress_buffer;
 	return DSSL_RC_OK;
 }
 
@@ -920,19 +944,24 @@ int ssls_init_from_tls_ticket( DSSL_Session* sess )
 	_ASSERT( sess );
 	_ASSERT( sess->env );
 	
-	if( sess->env->ticket_cache )
+	if( !sess->env->ticket_cache ) return NM_ERROR( DSSL_E_SSL_SESSION_TICKET_NOT_CACHED );
+
+	DSSL_EnvLockCache( sess->env );
+	ticket_data = dssl_SessionTicketTable_Find( sess->env->ticket_cache, 
+		sess->session_ticket, sess->session_ticket_len );
+
+	if( !ticket_data ) 
 	{
-		ticket_data = dssl_SessionTicketTable_Find( sess->env->ticket_cache, 
-			sess->session_ticket, sess->session_ticket_len );
+		DSSL_EnvUnlockCache( sess->env );
+		return NM_ERROR( DSSL_E_SSL_SESSION_TICKET_NOT_CACHED );
 	}
 
-	if( !ticket_data ) return NM_ERROR( DSSL_E_SSL_SESSION_TICKET_NOT_CACHED );
-
 	memcpy( sess->master_secret, ticket_data->master_secret, SSL3_MASTER_SECRET_SIZE );
 	sess->master_key_len = SSL3_MASTER_SECRET_SIZE;
 	sess->cipher_suite = ticket_data->cipher_suite;
 	sess->version = ticket_data->protocol_version;
 	sess->compression_method = ticket_data->compression_method;
+	DSSL_EnvUnlockCache( sess->env );
 
 	return DSSL_RC_OK;
 }
@@ -943,7 +972,11 @@ int ssls_store_new_ticket(DSSL_Session* sess, u_char* ticket, uint32_t len)
 
 	if( sess->env->ticket_cache )
 	{
-		return dssl_SessionTicketTable_Add( sess->env->ticket_cache, sess, ticket, len );
+		int rc;
+		DSSL_EnvLockCache( sess->env );
+		rc = dssl_SessionTicketTable_Add( sess->env->ticket_cache, sess, ticket, len );
+		DSSL_EnvUnlockCache( sess->env );
+		return rc;
 	}
 	else
 	{
@@ -0,0 +1,329 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <iomanip>
+#include <sstream>
+
+#include "voipmonitor.h"
+#include "tools_global.h"
+#include "file_store_io.h"
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif //HAVE_LIBURING
+
+
+using namespace std;
+
+
+cFileStoreIO::cFileStoreIO(eType type, unsigned threads, unsigned queue_depth) {
+	this->type = type;
+	this->threads_count = threads > 0 ? threads : 1;
+	this->queue_depth = queue_depth > 0 ? queue_depth : 1;
+	this->threads = NULL;
+	pthread_mutex_init(&queue_mutex, NULL);
+	pthread_cond_init(&queue_cond, NULL);
+	terminating = false;
+	memset(&stat, 0, sizeof(stat));
+	memset(&stat_last, 0, sizeof(stat_last));
+	stat_last_ms = getTimeMS();
+	_sync_stat = 0;
+	#ifdef HAVE_LIBURING
+	uring = NULL;
+	uring_completion_thread = 0;
+	_sync_uring = 0;
+	if(this->type == _fsio_uring) {
+		if(!uringInit()) {
+			syslog(LOG_NOTICE, "packetbuffer: io_uring initialization failed - use pwrite threads");
+			this->type = _fsio_direct;
+		}
+	}
+	#else
+	if(this->type == _fsio_uring) {
+		syslog(LOG_NOTICE, "packetbuffer: missing io_uring support - use pwrite threads");
+		this->type = _fsio_direct;
+	}
+	#endif //HAVE_LIBURING
+	if(this->type == _fsio_direct) {
+		this->threads = new FILE_LINE(0) pthread_t[this->threads_count];
+		for(unsigned i = 0; i < this->threads_count; i++) {
+			vm_pthread_create("packetbuffer file io",
+					  &this->threads[i], NULL, threadFunction, this, __FILE__, __LINE__);
+		}
+	}
+}
+
+cFileStoreIO::~cFileStoreIO() {
+	pthread_mutex_lock(&queue_mutex);
+	terminating = true;
+	pthread_cond_broadcast(&queue_cond);
+	pthread_mutex_unlock(&queue_mutex);
+	if(this->threads) {
+		for(unsigned i = 0; i < this->threads_count; i++) {
+			pthread_join(this->threads[i], NULL);
+		}
+		delete [] this->threads;
+	}
+	#ifdef HAVE_LIBURING
+	uringTerm();
+	#endif //HAVE_LIBURING
+	pthread_mutex_destroy(&queue_mutex);
+	pthread_cond_destroy(&queue_cond);
+}
+
+void cFileStoreIO::submit(sRequest *request) {
+	request->done = 0;
+	request->result = 0;
+	request->submit_ns = getTimeNS();
+	#ifdef HAVE_LIBURING
+	if(type == _fsio_uring) {
+		lock_uring();
+		io_uring_sqe *sqe = io_uring_get_sqe((io_uring*)uring);
+		while(!sqe) {
+			// submission queue full - completions are reaped by completion thread
+			io_uring_submit((io_uring*)uring);
+			unlock_uring();
+			USLEEP(10);
+			lock_uring();
+			sqe = io_uring_get_sqe((io_uring*)uring);
+		}
+		if(request->write) {
+			io_uring_prep_write(sqe, request->fd, request->buffer, request->length, request->offset);
+		} else {
+			io_uring_prep_read(sqe, request->fd, request->buffer, request->length, request->offset);
+		}
+		io_uring_sqe_set_data(sqe, request);
+		io_uring_submit((io_uring*)uring);
+		unlock_uring();
+		return;
+	}
+	#endif //HAVE_LIBURING
+	pthread_mutex_lock(&queue_mutex);
+	queue.push_back(request);
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+void cFileStoreIO::wait(sRequest *request) {
+	while(!request->done) {
+		USLEEP(20);
+	}
+	__sync_synchronize();
+}
+
+string cFileStoreIO::getStatString(bool reset) {
+	lock_stat();
+	sStat diff;
+	diff.write_bytes = stat.write_bytes - stat_last.write_bytes;
+	diff.write_ops = stat.write_ops - stat_last.write_ops;
+	diff.write_ns = stat.write_ns - stat_last.write_ns;
+	diff.read_bytes = stat.read_bytes - stat_last.read_bytes;
+	diff.read_ops = stat.read_ops - stat_last.read_ops;
+	diff.read_ns = stat.read_ns - stat_last.read_ns;
+	diff.errors = stat.errors - stat_last.errors;
+	u_int64_t write_ns_max = stat.write_ns_max;
+	u_int64_t read_ns_max = stat.read_ns_max;
+	u_int64_t time_ms = getTimeMS();
+	double period_s = time_ms > stat_last_ms ? (time_ms - stat_last_ms) / 1000. : 0;
+	if(reset) {
+		stat.write_ns_max = 0;
+		stat.read_ns_max = 0;
+		stat_last = stat;
+		stat_last_ms = time_ms;
+	}
+	unlock_stat();
+	ostringstream outStr;
+	outStr << fixed;
+	if(diff.write_ops) {
+		outStr << "w" << setprecision(1) << (period_s > 0 ? diff.write_bytes / period_s / 1024 / 1024 : 0) << "MB/s:"
+		       << setprecision(2) << (diff.write_ns / diff.write_ops / 1e6) << "/" << (write_ns_max / 1e6) << "ms";
+	}
+	if(diff.read_ops) {
+		if(diff.write_ops) {
+			outStr << " ";
+		}
+		outStr << "r" << setprecision(1) << (period_s > 0 ? diff.read_bytes / period_s / 1024 / 1024 : 0) << "MB/s:"
+		       << setprecision(2) << (diff.read_ns / diff.read_ops / 1e6) << "/" << (read_ns_max / 1e6) << "ms";
+	}
+	if(diff.errors) {
+		outStr << " err:" << diff.errors;
+	}
+	return(outStr.str());
+}
+
+u_char *cFileStoreIO::alignedAlloc(size_t size) {
+	void *buffer = NULL;
+	if(posix_memalign(&buffer, FILE_STORE_IO_ALIGN, alignSize(size))) {
+		return(NULL);
+	}
+	return((u_char*)buffer);
+}
+
+void cFileStoreIO::alignedFree(u_char *buffer) {
+	free(buffer);
+}
+
+int cFileStoreIO::openFile(const char *pathName, bool *direct, bool truncate) {
+	int flags = O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0);
+	int fd = open(pathName, flags | O_DIRECT, 0600);
+	if(fd >= 0) {
+		*direct = true;
+		return(fd);
+	}
+	if(errno == EINVAL) {
+		// filesystem without O_DIRECT support (e.g. tmpfs)
+		fd = open(pathName, flags, 0600);
+	}
+	*direct = false;
+	return(fd);
+}
+
+void cFileStoreIO::complete(sRequest *request, ssize_t result) {
+	u_int64_t time_ns = getTimeNS() - request->submit_ns;
+	lock_stat();
+	if(result == (ssize_t)request->length) {
+		if(request->write) {
+			stat.write_bytes += result;
+			++stat.write_ops;
+			stat.write_ns += time_ns;
+			if(time_ns > stat.write_ns_max) {
+				stat.write_ns_max = time_ns;
+			}
+		} else {
+			stat.read_bytes += result;
+			++stat.read_ops;
+			stat.read_ns += time_ns;
+			if(time_ns > stat.read_ns_max) {
+				stat.read_ns_max = time_ns;
+			}
+		}
+	} else {
+		++stat.errors;
+	}
+	unlock_stat();
+	request->result = result;
+	__sync_synchronize();
+	request->done = 1;
+}
+
+void *cFileStoreIO::threadFunction(void *arg) {
+	((cFileStoreIO*)arg)->threadProcess();
+	return(NULL);
+}
+
+void cFileStoreIO::threadProcess() {
+	while(true) {
+		pthread_mutex_lock(&queue_mutex);
+		while(!terminating && queue.empty()) {
+			pthread_cond_wait(&queue_cond, &queue_mutex);
+		}
+		if(queue.empty()) {
+			pthread_mutex_unlock(&queue_mutex);
+			break;
+		}
+		sRequest *request = queue.front();
+		queue.pop_front();
+		pthread_mutex_unlock(&queue_mutex);
+		size_t pos = 0;
+		ssize_t rslt = 0;
+		while(pos < request->length) {
+			rslt = request->write ?
+				pwrite(request->fd, request->buffer + pos, request->length - pos, request->offset + pos) :
+				pread(request->fd, request->buffer + pos, request->length - pos, request->offset + pos);
+			if(rslt < 0 && errno == EINTR) {
+				continue;
+			}
+			if(rslt <= 0) {
+				break;
+			}
+			pos += rslt;
+		}
+		complete(request, rslt < 0 ? -errno : (ssize_t)pos);
+	}
+}
+
+#ifdef HAVE_LIBURING
+
+bool cFileStoreIO::uringInit() {
+	io_uring *ring = new FILE_LINE(0) io_uring;
+	if(io_uring_queue_init(queue_depth * 2, ring, 0) < 0) {
+		delete ring;
+		return(false);
+	}
+	uring = ring;
+	vm_pthread_create("packetbuffer file io_uring",
+			  &uring_completion_thread, NULL, uringCompletionThreadFunction, this, __FILE__, __LINE__);
+	return(true);
+}
+
+void cFileStoreIO::uringTerm() {
+	if(!uring) {
+		return;
+	}
+	// wake up completion thread by nop without request
+	lock_uring();
+	io_uring_sqe *sqe = io_uring_get_sqe((io_uring*)uring);
+	while(!sqe) {
+		io_uring_submit((io_uring*)uring);
+		unlock_uring();
+		USLEEP(10);
+		lock_uring();
+		sqe = io_uring_get_sqe((io_uring*)uring);
+	}
+	io_uring_prep_nop(sqe);
+	io_uring_sqe_set_data(sqe, NULL);
+	io_uring_submit((io_uring*)uring);
+	unlock_uring();
+	pthread_join(uring_completion_thread, NULL);
+	io_uring_queue_exit((io_uring*)uring);
+	delete (io_uring*)uring;
+	uring = NULL;
+}
+
+void *cFileStoreIO::uringCompletionThreadFunction(void *arg) {
+	((cFileStoreIO*)arg)->uringCompletionProcess();
+	return(NULL);
+}
+
+void cFileStoreIO::uringCompletionProcess() {
+	while(true) {
+		io_uring_cqe *cqe;
+		int rslt = io_uring_wait_cqe((io_uring*)uring, &cqe);
+		if(rslt == -EINTR) {
+			continue;
+		}
+		if(rslt < 0) {
+			syslog(LOG_ERR, "packetbuffer: io_uring_wait_cqe failed: %s", strerror(-rslt));
+			break;
+		}
+		sRequest *request = (sRequest*)io_uring_cqe_get_data(cqe);
+		ssize_t res = cqe->res;
+		io_uring_cqe_seen((io_uring*)uring, cqe);
+		if(!request) {
+			if(terminating) {
+				break;
+			}
+			continue;
+		}
+		if(res > 0 && (size_t)res < request->length) {
+			// short transfer - finish synchronously
+			size_t pos = res;
+			while(pos < request->length) {
+				ssize_t _rslt = request->write ?
+						 pwrite(request->fd, request->buffer + pos, request->length - pos, request->offset + pos) :
+						 pread(request->fd, request->buffer + pos, request->length - pos, request->offset + pos);
+				if(_rslt <= 0) {
+					break;
+				}
+				pos += _rslt;
+			}
+			res = pos;
+		}
+		complete(request, res);
+	}
+}
+
+#endif //HAVE_LIBURING
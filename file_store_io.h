@@ -0,0 +1,121 @@
+#ifndef FILE_STORE_IO_H
+#define FILE_STORE_IO_H
+
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <deque>
+#include <string>
+
+#include "config.h"
+
+
+#define FILE_STORE_IO_ALIGN 4096
+
+
+/**
+  * Asynchronous aligned I/O for packetbuffer disk spill (pcap_file_store).
+  * Requests are whole O_DIRECT compatible chunks (buffer, length and offset aligned to FILE_STORE_IO_ALIGN).
+  * Backend is io_uring (HAVE_LIBURING) or pool of pwrite/pread threads.
+*/
+
+class cFileStoreIO {
+public:
+	enum eType {
+		_fsio_buffered = 0,
+		_fsio_direct = 1,
+		_fsio_uring = 2
+	};
+	struct sRequest {
+		sRequest() {
+			fd = -1;
+			write = false;
+			buffer = NULL;
+			length = 0;
+			offset = 0;
+			done = 0;
+			result = 0;
+			submit_ns = 0;
+		}
+		int fd;
+		bool write;
+		u_char *buffer;
+		size_t length;
+		u_int64_t offset;
+		volatile int done;
+		ssize_t result;
+		u_int64_t submit_ns;
+	};
+	struct sStat {
+		u_int64_t write_bytes;
+		u_int64_t write_ops;
+		u_int64_t write_ns;
+		u_int64_t write_ns_max;
+		u_int64_t read_bytes;
+		u_int64_t read_ops;
+		u_int64_t read_ns;
+		u_int64_t read_ns_max;
+		u_int64_t errors;
+	};
+public:
+	cFileStoreIO(eType type, unsigned threads = 2, unsigned queue_depth = 32);
+	~cFileStoreIO();
+	void submit(sRequest *request);
+	void wait(sRequest *request);
+	eType getType() {
+		return(type);
+	}
+	unsigned getQueueDepth() {
+		return(queue_depth);
+	}
+	std::string getStatString(bool reset = true);
+	static u_char *alignedAlloc(size_t size);
+	static void alignedFree(u_char *buffer);
+	static size_t alignSize(size_t size) {
+		return((size + FILE_STORE_IO_ALIGN - 1) / FILE_STORE_IO_ALIGN * FILE_STORE_IO_ALIGN);
+	}
+	static int openFile(const char *pathName, bool *direct, bool truncate);
+private:
+	void complete(sRequest *request, ssize_t result);
+	static void *threadFunction(void *arg);
+	void threadProcess();
+	#ifdef HAVE_LIBURING
+	bool uringInit();
+	void uringTerm();
+	static void *uringCompletionThreadFunction(void *arg);
+	void uringCompletionProcess();
+	void lock_uring() {
+		while(__sync_lock_test_and_set(&_sync_uring, 1));
+	}
+	void unlock_uring() {
+		__sync_lock_release(&_sync_uring);
+	}
+	#endif
+	void lock_stat() {
+		while(__sync_lock_test_and_set(&_sync_stat, 1));
+	}
+	void unlock_stat() {
+		__sync_lock_release(&_sync_stat);
+	}
+private:
+	eType type;
+	unsigned threads_count;
+	unsigned queue_depth;
+	pthread_t *threads;
+	std::deque<sRequest*> queue;
+	pthread_mutex_t queue_mutex;
+	pthread_cond_t queue_cond;
+	volatile bool terminating;
+	#ifdef HAVE_LIBURING
+	void *uring;
+	pthread_t uring_completion_thread;
+	volatile int _sync_uring;
+	#endif
+	sStat stat;
+	sStat stat_last;
+	u_int64_t stat_last_ms;
+	volatile int _sync_stat;
+};
+
+
+#endif //FILE_STORE_IO_H
@@ -90,3 +90,317 @@ Generator::send(char *data, int datalen) {
 	}
 	return res;
 }
+
+
+#define CORPUS_PROXY_IP 0xC0A80001		// 192.168.0.1
+#define CORPUS_CALLER_NET 0x0A000000		// 10.0.0.0
+#define CORPUS_SIP_PORT 5060
+#define CORPUS_PROXY_RTP_PORT_BASE 30000
+#define CORPUS_CALLER_RTP_PORT_BASE 10000
+#define CORPUS_RTP_INTERVAL_US 20000
+#define CORPUS_RTP_PAYLOAD_SIZE 160
+#define CORPUS_TIME_START 1600000000
+
+cReplayCorpusGenerator::cReplayCorpusGenerator(sParams *params) {
+	this->params = *params;
+	seed = params->seed;
+	ip_id = 0;
+	packets = 0;
+	dumper = NULL;
+}
+
+bool cReplayCorpusGenerator::generate() {
+	pcap_t *handle = pcap_open_dead(DLT_EN10MB, 65535);
+	if(!handle) {
+		return(false);
+	}
+	dumper = pcap_dump_open(handle, params.pcap.c_str());
+	if(!dumper) {
+		cerr << "benchmark corpus: " << pcap_geterr(handle) << endl;
+		pcap_close(handle);
+		return(false);
+	}
+	u_int64_t call_duration_us = 3100000ull + params.rtp_packets * CORPUS_RTP_INTERVAL_US;
+	u_int64_t call_interval_us = call_duration_us / (params.concurrent ? params.concurrent : 1);
+	u_int64_t span_us = params.calls * call_interval_us + call_duration_us;
+	u_int64_t start_us = CORPUS_TIME_START * 1000000ull;
+	calls.resize(params.calls + params.registers);
+	priority_queue<sEvent> events;
+	for(unsigned i = 0; i < calls.size(); i++) {
+		sCall *call = &calls[i];
+		memset(call, 0, sizeof(*call));
+		call->index = i;
+		call->caller_ip = CORPUS_CALLER_NET + (i % 0xFFFFF0) + 1;
+		if(i < params.calls) {
+			call->step = _invite;
+			call->time_us = start_us + i * call_interval_us + nextRand() % 1000;
+			call->caller_rtp_port = CORPUS_CALLER_RTP_PORT_BASE + (i % 20000) * 2;
+			call->called_rtp_port = CORPUS_PROXY_RTP_PORT_BASE + (i % 15000) * 2;
+			for(unsigned j = 0; j < 2; j++) {
+				call->ssrc[j] = nextRand();
+				call->seq[j] = nextRand() & 0xFFFF;
+				call->timestamp[j] = nextRand();
+			}
+		} else {
+			call->step = _register;
+			call->time_us = start_us + (u_int64_t)(i - params.calls) * span_us / params.registers + nextRand() % 1000;
+		}
+		sEvent event;
+		event.time_us = call->time_us;
+		event.call = i;
+		events.push(event);
+	}
+	while(!events.empty()) {
+		sEvent event = events.top();
+		events.pop();
+		sCall *call = &calls[event.call];
+		step(call);
+		if(call->step != _end) {
+			event.time_us = call->time_us;
+			events.push(event);
+		}
+	}
+	pcap_dump_close(dumper);
+	pcap_close(handle);
+	dumper = NULL;
+	return(true);
+}
+
+void cReplayCorpusGenerator::step(sCall *call) {
+	switch(call->step) {
+	case _invite:
+		sip(call, true, "INVITE sip:%s@192.168.0.1 SIP/2.0", "INVITE", true);
+		call->step = _trying;
+		call->time_us += 10000;
+		break;
+	case _trying:
+		sip(call, false, "SIP/2.0 100 Trying", "INVITE", false);
+		call->step = _ringing;
+		call->time_us += 990000;
+		break;
+	case _ringing:
+		sip(call, false, "SIP/2.0 180 Ringing", "INVITE", false);
+		call->step = _ok;
+		call->time_us += 2000000;
+		break;
+	case _ok:
+		sip(call, false, "SIP/2.0 200 OK", "INVITE", true);
+		call->step = _ack;
+		call->time_us += 20000;
+		break;
+	case _ack:
+		sip(call, true, "ACK sip:%s@192.168.0.1 SIP/2.0", "ACK", false);
+		call->step = params.rtp_packets ? _rtp : _bye;
+		call->time_us += params.rtp_packets ? 1000 : 60000;
+		break;
+	case _rtp:
+		rtp(call, true);
+		rtp(call, false);
+		if(++call->rtp_counter >= params.rtp_packets) {
+			call->step = _bye;
+		}
+		call->time_us += CORPUS_RTP_INTERVAL_US;
+		break;
+	case _bye:
+		sip(call, true, "BYE sip:%s@192.168.0.1 SIP/2.0", "BYE", false);
+		call->step = _bye_ok;
+		call->time_us += 15000;
+		break;
+	case _bye_ok:
+		sip(call, false, "SIP/2.0 200 OK", "BYE", false);
+		call->step = _end;
+		break;
+	case _register:
+		sip(call, true, "REGISTER sip:192.168.0.1 SIP/2.0", "REGISTER", false);
+		call->step = _register_ok;
+		call->time_us += 12000;
+		break;
+	case _register_ok:
+		sip(call, false, "SIP/2.0 200 OK", "REGISTER", false);
+		call->step = _end;
+		break;
+	case _end:
+		break;
+	}
+}
+
+void cReplayCorpusGenerator::sip(sCall *call, bool from_caller, const char *first_line, const char *method_cseq, bool sdp) {
+	bool reg = call->index >= params.calls;
+	char number[20];
+	snprintf(number, sizeof(number), "%u", (reg ? 500000 : 100000) + call->index);
+	char caller_ip_str[20];
+	snprintf(caller_ip_str, sizeof(caller_ip_str), "%u.%u.%u.%u", 
+		 call->caller_ip >> 24, (call->caller_ip >> 16) & 0xFF, (call->caller_ip >> 8) & 0xFF, call->caller_ip & 0xFF);
+	char first_line_str[200];
+	snprintf(first_line_str, sizeof(first_line_str), first_line, number);
+	char sdp_str[500] = "";
+	if(sdp) {
+		snprintf(sdp_str, sizeof(sdp_str),
+			 "v=0\r\n"
+			 "o=- %u 1 IN IP4 %s\r\n"
+			 "s=benchmark\r\n"
+			 "c=IN IP4 %s\r\n"
+			 "t=0 0\r\n"
+			 "m=audio %u RTP/AVP 0 101\r\n"
+			 "a=rtpmap:0 PCMU/8000\r\n"
+			 "a=rtpmap:101 telephone-event/8000\r\n"
+			 "a=sendrecv\r\n",
+			 call->index,
+			 from_caller ? caller_ip_str : "192.168.0.1",
+			 from_caller ? caller_ip_str : "192.168.0.1",
+			 from_caller ? call->caller_rtp_port : call->called_rtp_port);
+	}
+	unsigned cseq = !strcmp(method_cseq, "BYE") ? 2 : 1;
+	bool response = !strncmp(first_line, "SIP/2.0", 7);
+	char msg[2000];
+	int msglen = snprintf(msg, sizeof(msg),
+			      "%s\r\n"
+			      "Via: SIP/2.0/UDP %s:5060;branch=z9hG4bK-%u-%u\r\n"
+			      "Max-Forwards: 70\r\n"
+			      "From: <sip:%s@%s>;tag=from-%u\r\n"
+			      "To: <sip:%s@192.168.0.1>%s\r\n"
+			      "Call-ID: bench-%u-%u@%s\r\n"
+			      "CSeq: %u %s\r\n"
+			      "Contact: <sip:%s@%s:5060>\r\n"
+			      "%s"
+			      "User-Agent: voipmonitor-benchmark\r\n"
+			      "%s"
+			      "Content-Length: %u\r\n"
+			      "\r\n"
+			      "%s",
+			      first_line_str,
+			      caller_ip_str, call->index, cseq,
+			      reg ? number : "200", caller_ip_str, call->index,
+			      number, response && !reg ? (";tag=to-" + intToString(call->index)).c_str() : "",
+			      params.seed, call->index, caller_ip_str,
+			      cseq, method_cseq,
+			      reg ? number : "200", caller_ip_str,
+			      reg ? "Expires: 3600\r\n" : "",
+			      sdp ? "Content-Type: application/sdp\r\n" : "",
+			      (unsigned)strlen(sdp_str),
+			      sdp_str);
+	if(from_caller) {
+		udp(call->time_us, call->caller_ip, CORPUS_SIP_PORT, CORPUS_PROXY_IP, CORPUS_SIP_PORT, 
+		    (u_char*)msg, msglen, true, call->step == _invite);
+	} else {
+		udp(call->time_us, CORPUS_PROXY_IP, CORPUS_SIP_PORT, call->caller_ip, CORPUS_SIP_PORT, 
+		    (u_char*)msg, msglen, true, false);
+	}
+}
+
+void cReplayCorpusGenerator::rtp(sCall *call, bool from_caller) {
+	unsigned dir = from_caller ? 0 : 1;
+	u_char packet[12 + CORPUS_RTP_PAYLOAD_SIZE];
+	packet[0] = 0x80;
+	packet[1] = call->rtp_counter ? 0 : 0x80;
+	*(u_int16_t*)(packet + 2) = htons(call->seq[dir]++);
+	*(u_int32_t*)(packet + 4) = htonl(call->timestamp[dir]);
+	*(u_int32_t*)(packet + 8) = htonl(call->ssrc[dir]);
+	call->timestamp[dir] += CORPUS_RTP_PAYLOAD_SIZE;
+	for(unsigned i = 0; i < CORPUS_RTP_PAYLOAD_SIZE; i++) {
+		packet[12 + i] = 0xFF - (nextRand() & 0x0F);
+	}
+	if(from_caller) {
+		udp(call->time_us, call->caller_ip, call->caller_rtp_port, CORPUS_PROXY_IP, call->called_rtp_port,
+		    packet, sizeof(packet), false, false);
+	} else {
+		udp(call->time_us, CORPUS_PROXY_IP, call->called_rtp_port, call->caller_ip, call->caller_rtp_port,
+		    packet, sizeof(packet), false, false);
+	}
+}
+
+void cReplayCorpusGenerator::udp(u_int64_t time_us, u_int32_t saddr, u_int16_t sport, u_int32_t daddr, u_int16_t dport,
+				 const u_char *data, unsigned datalen, bool enable_dupl, bool enable_frag) {
+	u_char frame[sizeof(ether_header) + sizeof(iphdr2) + sizeof(udphdr2) + 2000];
+	ether_header *eth = (ether_header*)frame;
+	memset(eth, 0, sizeof(ether_header));
+	eth->ether_shost[5] = saddr == CORPUS_PROXY_IP ? 1 : 2;
+	eth->ether_dhost[5] = saddr == CORPUS_PROXY_IP ? 2 : 1;
+	eth->ether_type = htons(ETHERTYPE_IP);
+	iphdr2 *iphdr = (iphdr2*)(frame + sizeof(ether_header));
+	memset(iphdr, 0, sizeof(iphdr2));
+	iphdr->version = 4;
+	iphdr->_ihl = 5;
+	iphdr->_id = htons(++ip_id);
+	iphdr->_ttl = 64;
+	iphdr->_protocol = IPPROTO_UDP;
+	iphdr->_set_saddr(htonl(saddr));
+	iphdr->_set_daddr(htonl(daddr));
+	udphdr2 *udphdr = (udphdr2*)((u_char*)iphdr + sizeof(iphdr2));
+	udphdr->set_source(sport);
+	udphdr->set_dest(dport);
+	udphdr->len = htons(sizeof(udphdr2) + datalen);
+	udphdr->check = 0;
+	memcpy((u_char*)udphdr + sizeof(udphdr2), data, datalen);
+	unsigned iplen = sizeof(iphdr2) + sizeof(udphdr2) + datalen;
+	if(enable_frag && params.frag_perc && nextRand() % 100 < params.frag_perc) {
+		// split into two fragments (in order)
+		unsigned ip_payload_len = sizeof(udphdr2) + datalen;
+		unsigned frag1_len = (ip_payload_len / 2) & ~7;
+		u_char frag_frame[sizeof(frame)];
+		memcpy(frag_frame, frame, sizeof(ether_header) + sizeof(iphdr2));
+		iphdr2 *frag_iphdr = (iphdr2*)(frag_frame + sizeof(ether_header));
+		memcpy((u_char*)frag_iphdr + sizeof(iphdr2), udphdr, frag1_len);
+		frag_iphdr->set_tot_len(sizeof(iphdr2) + frag1_len);
+		frag_iphdr->_frag_off = htons(IP_MF);
+		dump(time_us, frag_frame, sizeof(ether_header) + sizeof(iphdr2) + frag1_len);
+		memcpy((u_char*)frag_iphdr + sizeof(iphdr2), (u_char*)udphdr + frag1_len, ip_payload_len - frag1_len);
+		frag_iphdr->set_tot_len(sizeof(iphdr2) + ip_payload_len - frag1_len);
+		frag_iphdr->_frag_off = htons(frag1_len / 8);
+		dump(time_us, frag_frame, sizeof(ether_header) + sizeof(iphdr2) + ip_payload_len - frag1_len);
+		return;
+	}
+	iphdr->set_tot_len(iplen);
+	dump(time_us, frame, sizeof(ether_header) + iplen);
+	if(enable_dupl && params.dupl_perc && nextRand() % 100 < params.dupl_perc) {
+		dump(time_us, frame, sizeof(ether_header) + iplen);
+	}
+}
+
+void cReplayCorpusGenerator::dump(u_int64_t time_us, u_char *frame, unsigned framelen) {
+	iphdr2 *iphdr = (iphdr2*)(frame + sizeof(ether_header));
+	iphdr->_check = 0;
+	u_int32_t sum = 0;
+	for(unsigned i = 0; i < sizeof(iphdr2) / 2; i++) {
+		sum += ((u_int16_t*)iphdr)[i];
+	}
+	while(sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	iphdr->_check = ~sum;
+	pcap_pkthdr header;
+	header.ts.tv_sec = time_us / 1000000;
+	header.ts.tv_usec = time_us % 1000000;
+	header.caplen = framelen;
+	header.len = framelen;
+	pcap_dump((u_char*)dumper, &header, frame);
+	++packets;
+}
+
+int generate_replay_corpus(const char *params_str) {
+	// pcap;calls;concurrent;rtp_packets;registers;seed;dupl_perc;frag_perc
+	vector<string> params_vect = split(params_str, ';');
+	if(params_vect.empty() || params_vect[0].empty()) {
+		cerr << "benchmark corpus: missing pcap file" << endl;
+		return(1);
+	}
+	cReplayCorpusGenerator::sParams params;
+	params.pcap = params_vect[0];
+	unsigned *params_num[] = {
+		&params.calls, &params.concurrent, &params.rtp_packets, &params.registers, 
+		&params.seed, &params.dupl_perc, &params.frag_perc
+	};
+	for(unsigned i = 1; i < params_vect.size() && i <= sizeof(params_num) / sizeof(params_num[0]); i++) {
+		if(!params_vect[i].empty()) {
+			*params_num[i - 1] = atol(params_vect[i].c_str());
+		}
+	}
+	cReplayCorpusGenerator generator(&params);
+	if(!generator.generate()) {
+		return(1);
+	}
+	cout << "benchmark corpus: " << params.pcap << " - calls: " << params.calls 
+	     << ", registers: " << params.registers 
+	     << ", packets: " << generator.getPacketsCount() << endl;
+	return(0);
+}
@@ -2,6 +2,7 @@
 #define GENERATOR_H
 
 #include "voipmonitor.h"
+#include <pcap.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -26,6 +27,8 @@
 #include <errno.h>
 #include <netinet/udp.h>
 #include <netinet/ip_icmp.h>
+#include <queue>
+#include <vector>
 
 #ifndef FREEBSD
 #include <features.h>    /* for the glibc version number */
@@ -58,4 +61,92 @@ private:
 	void socket_iphdrincl(int);
 };
 
+/*
+ deterministic SIP+RTP corpus for replay benchmark (--benchmark-corpus)
+ - calls INVITE / 100 / 180 / 200 / ACK / RTP both directions (20ms, PCMU) / BYE / 200
+ - optional REGISTER / 200 pairs, duplicated SIP packets (dedup) and fragmented INVITEs (defrag)
+ - packets are written ordered by time, same parameters give same pcap
+*/
+class cReplayCorpusGenerator {
+public:
+	struct sParams {
+		sParams() {
+			calls = 1000;
+			concurrent = 100;
+			rtp_packets = 500;
+			registers = 0;
+			seed = 1;
+			dupl_perc = 0;
+			frag_perc = 0;
+		}
+		string pcap;
+		unsigned calls;
+		unsigned concurrent;
+		unsigned rtp_packets;
+		unsigned registers;
+		unsigned seed;
+		unsigned dupl_perc;
+		unsigned frag_perc;
+	};
+private:
+	enum eStep {
+		_invite,
+		_trying,
+		_ringing,
+		_ok,
+		_ack,
+		_rtp,
+		_bye,
+		_bye_ok,
+		_register,
+		_register_ok,
+		_end
+	};
+	struct sCall {
+		unsigned index;
+		eStep step;
+		u_int64_t time_us;
+		u_int32_t caller_ip;
+		u_int16_t caller_rtp_port;
+		u_int16_t called_rtp_port;
+		u_int32_t ssrc[2];
+		u_int16_t seq[2];
+		u_int32_t timestamp[2];
+		unsigned rtp_counter;
+	};
+	struct sEvent {
+		u_int64_t time_us;
+		unsigned call;
+		bool operator < (const sEvent& other) const {
+			return(this->time_us > other.time_us ||
+			       (this->time_us == other.time_us && this->call > other.call));
+		}
+	};
+public:
+	cReplayCorpusGenerator(sParams *params);
+	bool generate();
+	u_int64_t getPacketsCount() {
+		return(packets);
+	}
+private:
+	void step(sCall *call);
+	void sip(sCall *call, bool from_caller, const char *first_line, const char *method_cseq, bool sdp);
+	void rtp(sCall *call, bool from_caller);
+	void udp(u_int64_t time_us, u_int32_t saddr, u_int16_t sport, u_int32_t daddr, u_int16_t dport,
+		 const u_char *data, unsigned datalen, bool enable_dupl, bool enable_frag);
+	void dump(u_int64_t time_us, u_char *frame, unsigned framelen);
+	unsigned nextRand() {
+		return(rand_r(&seed));
+	}
+private:
+	sParams params;
+	unsigned seed;
+	vector<sCall> calls;
+	u_int16_t ip_id;
+	u_int64_t packets;
+	pcap_dumper_t *dumper;
+};
+
+int generate_replay_corpus(const char *params);
+
 #endif
@@ -5,6 +5,12 @@
 
 #include "header_packet.h"
 
+
+#define IPFRAG_TABLE_SIZE_INIT 256
+#define IPFRAG_WHEEL_SIZE 64		// power of 2, greater than the longest prune limit (30s)
+#define IPFRAG_SLAB_ITEMS 256
+
+
 struct ip_frag_s {
 	sHeaderPacket *header_packet;
 	void *header_packet_pqout;
@@ -13,22 +19,88 @@ struct ip_frag_s {
 	u_int32_t offset;
 	u_int32_t len;
 	u_int16_t iphdr_len;
+	ip_frag_s *next;		// queue sorted by offset / free list
 };
 
-typedef map<unsigned int, ip_frag_s*> ip_frag_queue_t;
-typedef map<unsigned int, ip_frag_s*>::iterator ip_frag_queue_it_t;
-
-struct ip_frag_queue : ip_frag_queue_t {
-	ip_frag_queue() {
-		has_last = false;
+struct ip_frag_queue {
+	inline bool eq(vmIP saddr, vmIP daddr, u_int32_t id, u_int8_t protocol) {
+		return(this->id == id && this->protocol == protocol &&
+		       this->saddr == saddr && this->daddr == daddr);
 	}
+	vmIP saddr;
+	vmIP daddr;
+	u_int32_t id;
+	u_int8_t protocol;
 	bool has_last;
+	u_int32_t hash;
+	unsigned count;
+	time_t ts;
+	ip_frag_s *first;
+	ip_frag_s *last;
+	unsigned wheel_slot;
+	ip_frag_queue *wheel_prev;
+	ip_frag_queue *wheel_next;	// timer wheel slot / free list
 };
 
+/*
+ fragment queues in open-addressed hash table keyed on (src, dst, id, proto),
+ fragment descriptors and queues from slab pools,
+ expiration via timer wheel with one second slots (slot by time of first fragment)
+*/
 struct ipfrag_data_s {
-	map<vmIP, map<unsigned int, ip_frag_queue*> > ip_frag_stream;
-	map<vmIP, map<unsigned int, ip_frag_queue*> >::iterator ip_frag_streamIT;
-	map<unsigned int, ip_frag_queue*>::iterator ip_frag_streamITinner;
+	ipfrag_data_s();
+	~ipfrag_data_s();
+	ip_frag_queue *getQueue(vmIP saddr, vmIP daddr, u_int32_t id, u_int8_t protocol, time_t ts);
+	void removeQueue(ip_frag_queue *queue) {
+		tableRemove(queue);
+		wheelRemove(queue);
+	}
+	void freeQueue(ip_frag_queue *queue) {
+		queue->wheel_next = free_queues;
+		free_queues = queue;
+	}
+	ip_frag_queue *popExpiredQueue(time_t expire_to);
+	ip_frag_queue *popQueue();
+	inline ip_frag_s *allocNode() {
+		if(!free_nodes) {
+			addNodesSlab();
+		}
+		ip_frag_s *node = free_nodes;
+		free_nodes = node->next;
+		return(node);
+	}
+	inline void freeNode(ip_frag_s *node) {
+		node->next = free_nodes;
+		free_nodes = node;
+	}
+	unsigned getQueuesCount() {
+		return(table_count);
+	}
+private:
+	static inline u_int32_t hash(vmIP saddr, vmIP daddr, u_int32_t id, u_int8_t protocol) {
+		u_int32_t h = saddr.getHashNumber() ^ (daddr.getHashNumber() * 0x9E3779B1) ^ ((id << 8) | protocol);
+		h ^= h >> 16;
+		h *= 0x85EBCA6B;
+		h ^= h >> 13;
+		return(h);
+	}
+	void tableInsert(ip_frag_queue *queue);
+	void tableRemove(ip_frag_queue *queue);
+	void tableResize(unsigned size);
+	void wheelInsert(ip_frag_queue *queue);
+	void wheelRemove(ip_frag_queue *queue);
+	void addNodesSlab();
+	void addQueuesSlab();
+private:
+	ip_frag_queue **table;
+	unsigned table_size;
+	unsigned table_count;
+	ip_frag_queue *wheel[IPFRAG_WHEEL_SIZE];
+	time_t wheel_time;
+	ip_frag_s *free_nodes;
+	ip_frag_queue *free_queues;
+	vector<ip_frag_s*> nodes_slabs;
+	vector<ip_frag_queue*> queues_slabs;
 };
 
 void ipfrag_prune(unsigned int tv_sec, bool all, ipfrag_data_s *ipfrag_data,
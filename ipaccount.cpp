@@ -176,13 +176,10 @@ Ipacc::Ipacc() {
 	map_ipacc_data_save_limit = 2;
 	last_ipacc_time = 0;
 	last_ipacc_data = NULL;
-	qringmax = 10000;
+	table = NULL;
+	memset((void*)qring, 0, sizeof(qring));
 	readit = 0;
 	writeit = 0;
-	qring = new FILE_LINE(12001) packet[qringmax];
-	for(unsigned int i = 0; i < qringmax; i++) {
-		qring[i].used = 0;
-	}
 	memset(this->threadPstatData, 0, sizeof(this->threadPstatData));
 	save_thread_count = 2;
 	save_thread_data = new FILE_LINE(0) s_save_thread_data[save_thread_count];
@@ -198,29 +195,83 @@ Ipacc::Ipacc() {
 
 Ipacc::~Ipacc() {
 	stopThread();
-	delete [] qring;
+	if(table) {
+		delete table;
+	}
+	for(unsigned i = 0; i < IPACC_QRING_SIZE; i++) {
+		if(qring[i]) {
+			delete qring[i];
+		}
+	}
 	delete [] save_thread_data;
 	term();
 }
 
+/*
+ push and flushTable are called only from t2 destroy blocks thread (the only producer),
+ the table is passed to out thread through qring (slot is free if NULL)
+*/
 inline void Ipacc::push(time_t timestamp, vmIP saddr, vmIP daddr, vmPort port, int proto, int packetlen, int voippacket) {
-	while(this->qring[this->writeit].used != 0) {
+	unsigned int cur_interval_time = timestamp / opt_ipacc_interval * opt_ipacc_interval;
+	t_ipacc_flow_key key;
+	key.set(saddr, daddr, port, proto, voippacket);
+	if(table &&
+	   (table->interval_time != cur_interval_time || table->isFull())) {
+		pushTable();
+	}
+	if(!table) {
+		table = new FILE_LINE(12001) IpaccFlowTable(cur_interval_time);
+	}
+	table->add(&key, packetlen);
+}
+
+void Ipacc::flushTable() {
+	// without packets the table would wait for the next packet - pass it on when its interval is over
+	if(table &&
+	   table->interval_time + opt_ipacc_interval <= (unsigned int)getTimeS()) {
+		pushTable();
+	}
+}
+
+void Ipacc::pushTable() {
+	while(qring[writeit]) {
 		USLEEP(10);
 	}
-	packet *_packet = &this->qring[this->writeit];
-	_packet->timestamp = timestamp;
-	_packet->saddr = saddr;
-	_packet->daddr = daddr;
-	_packet->port = port;
-	_packet->proto = proto;
-	_packet->packetlen = packetlen;
-	_packet->voippacket = voippacket;
-	_packet->used = 1;
-	if((this->writeit + 1) == this->qringmax) {
-		this->writeit = 0;
+	__sync_synchronize();
+	qring[writeit] = table;
+	if((writeit + 1) == IPACC_QRING_SIZE) {
+		writeit = 0;
 	} else {
-		this->writeit++;
+		writeit++;
 	}
+	table = NULL;
+}
+
+void Ipacc::mergeTable(IpaccFlowTable *table) {
+	unsigned int cur_interval_time = table->interval_time;
+	s_ipacc_data *ipacc_data;
+	if(last_ipacc_time && last_ipacc_time == cur_interval_time) {
+		ipacc_data = last_ipacc_data;
+	} else {
+		if(last_ipacc_time && cur_interval_time / opt_ipacc_interval <= last_ipacc_time / opt_ipacc_interval - map_ipacc_data_save_limit) {
+			return;
+		}
+		lock_map_ipacc_data();
+		map<unsigned int, s_ipacc_data*>::iterator iter = map_ipacc_data.find(cur_interval_time);
+		if(iter != map_ipacc_data.end()) {
+			ipacc_data = iter->second;
+		} else {
+			ipacc_data = new FILE_LINE(0) s_ipacc_data;
+			ipacc_data->interval_time = cur_interval_time;
+			map_ipacc_data[cur_interval_time] = ipacc_data;
+			if(cur_interval_time > last_ipacc_time) {
+				last_ipacc_time = cur_interval_time;
+				last_ipacc_data = ipacc_data;
+			}
+		}
+		unlock_map_ipacc_data();
+	}
+	table->mergeTo(&ipacc_data->ipacc_buffer);
 }
 
 void Ipacc::save(unsigned int interval_time, t_ipacc_buffer *ipacc_buffer, s_cache *cache) {
@@ -484,87 +535,6 @@ void Ipacc::save(unsigned int interval_time, t_ipacc_buffer *ipacc_buffer, s_cac
 	*/
 }
 
-inline void Ipacc::add_octets(time_t timestamp, vmIP saddr, vmIP daddr, vmPort port, int proto, int packetlen, int voippacket) {
-	unsigned int cur_interval_time = timestamp / opt_ipacc_interval * opt_ipacc_interval;
-	s_ipacc_data *ipacc_data;
-	if(last_ipacc_time && last_ipacc_time == cur_interval_time) {
-		ipacc_data = last_ipacc_data;
-	} else {
-		if(last_ipacc_time && cur_interval_time / opt_ipacc_interval <= last_ipacc_time / opt_ipacc_interval - map_ipacc_data_save_limit) {
-			return;
-		}
-		lock_map_ipacc_data();
-		map<unsigned int, s_ipacc_data*>::iterator iter = map_ipacc_data.find(cur_interval_time);
-		if(iter != map_ipacc_data.end()) {
-			ipacc_data = iter->second;
-		} else {
-			ipacc_data = new FILE_LINE(0) s_ipacc_data;
-			ipacc_data->interval_time = cur_interval_time;
-			map_ipacc_data[cur_interval_time] = ipacc_data;
-			if(cur_interval_time > last_ipacc_time) {
-				last_ipacc_time = cur_interval_time;
-				last_ipacc_data = ipacc_data;
-			}
-		}
-		unlock_map_ipacc_data();
-	}
-	t_ipacc_buffer_key key;
-	key.saddr = saddr;
-	key.daddr = daddr;
-	key.port = port;
-	key.proto = proto;
-	key.voip = voippacket;
-	t_ipacc_buffer::iterator iter = ipacc_data->ipacc_buffer.find(key);
-	if(iter != ipacc_data->ipacc_buffer.end()) {
-		iter->second.octects += packetlen;
-		iter->second.numpackets++;
-	} else {
-		octects_t octects_data;
-		octects_data.octects += packetlen;
-		octects_data.numpackets++;
-		ipacc_data->ipacc_buffer[key] = octects_data;
-	}
-
-	/*
-	t_ipacc_buffer_key key;
-	key.saddr = saddr;
-	key.daddr = daddr;
-	key.port = port;
-	key.proto = proto;
-	octects_t *octects_data;
-	unsigned int cur_interval_time = timestamp / opt_ipacc_interval * opt_ipacc_interval;
-	int indexIpaccBuffer = (cur_interval_time / opt_ipacc_interval) % 2;
-	if(last_flush_interval_time != cur_interval_time &&
-	   (timestamp - cur_interval_time) > opt_ipacc_interval / 5) {
-		int saveIndexIpaccBuffer = indexIpaccBuffer == 0 ? 1 : 0;
-		if(!__sync_fetch_and_add(&sync_save_ipacc_buffer[saveIndexIpaccBuffer], 1)) {
-			last_flush_interval_time = cur_interval_time;
-			save(saveIndexIpaccBuffer, last_flush_interval_time);
-		}
-	}
-	t_ipacc_buffer::iterator iter;
-	iter = ipacc_buffer[indexIpaccBuffer].find(key);
-	if(iter == ipacc_buffer[indexIpaccBuffer].end()) {
-		// not found;
-		octects_data = new FILE_LINE(12003) octects_t;
-		octects_data->octects += packetlen;
-		octects_data->numpackets++;
-		octects_data->interval_time = cur_interval_time;
-		octects_data->voippacket = voippacket;
-		ipacc_buffer[indexIpaccBuffer][key] = octects_data;
-//		printf("key: %s\n", buf);
-	} else {
-		//found
-		octects_t *tmp = iter->second;
-		tmp->octects += packetlen;
-		tmp->numpackets++;
-		tmp->interval_time = cur_interval_time;
-		tmp->voippacket = voippacket;
-//		printf("key[%s] %u\n", key.c_str(), tmp->octects);
-	}
-	*/
-}
-
 unsigned int Ipacc::lengthBuffer() {
 	unsigned int sum_size = 0;
 	lock_map_ipacc_data();
@@ -650,14 +620,16 @@ void *Ipacc::outThreadFunction() {
 	this->outThreadId = get_unix_tid();
 	syslog(LOG_NOTICE, "start Ipacc out thread %i", this->outThreadId);
 	while(!is_terminating()) {
-		if(this->qring[this->readit].used == 1) {
-			packet *_packet = &this->qring[this->readit];
-			add_octets(_packet->timestamp, _packet->saddr, _packet->daddr, _packet->port, _packet->proto, _packet->packetlen, _packet->voippacket);
-			_packet->used = 0;
-			if((this->readit + 1) == this->qringmax) {
-				this->readit = 0;
+		IpaccFlowTable *_table = qring[readit];
+		if(_table) {
+			__sync_synchronize();
+			mergeTable(_table);
+			delete _table;
+			qring[readit] = NULL;
+			if((readit + 1) == IPACC_QRING_SIZE) {
+				readit = 0;
 			} else {
-				this->readit++;
+				readit++;
 			}
 		} else {
 			USLEEP(1000);
@@ -776,6 +748,12 @@ inline void ipacc_add_octets(time_t timestamp, vmIP saddr, vmIP daddr, vmPort po
 	}
 }
 
+void ipaccount_flush() {
+	if(IPACC) {
+		IPACC->flushTable();
+	}
+}
+
 void ipaccount(time_t timestamp, struct iphdr2 *header_ip, int packetlen, int voippacket){
 	struct udphdr2 *header_udp;
 	struct tcphdr2 *header_tcp;
@@ -1234,9 +1212,6 @@ int CustIpCache::getCustByIp(vmIP ip) {
 			this->fetchAllIpQueryFromDb();
 			this->doFlushVect = false;
 		}
-		if(!this->custCacheVect.size()) {
-			return(0);
-		}
 		return(this->getCustByIpFromCacheVect(ip));
 	} else if(this->query_getIp.length()) {
 		int cust_id = 0;
@@ -1284,7 +1259,7 @@ int CustIpCache::fetchAllIpQueryFromDb() {
 	}
 	int _start_time = time(NULL);
 	if(this->sqlDb->query(this->query_fetchAllIp)) {
-		this->custCacheVect.clear();
+		vector<cust_cache_rec> custCacheVect;
 		SqlDb_row row;
 		while((row = this->sqlDb->fetchRow())) {
 			cust_cache_rec rec;
@@ -1292,7 +1267,7 @@ int CustIpCache::fetchAllIpQueryFromDb() {
 			_ip.setFromString(row["IP"].c_str());
 			rec.ip = _ip;
 			rec.cust_id = atol(row["ID"].c_str());
-			this->custCacheVect.push_back(rec);
+			custCacheVect.push_back(rec);
 		}
 		if(this->sqlDbRadius && this->sqlDb->query(this->query_fetchAllRadiusNames)) {
 			map<string, unsigned int> radiusUsers;
@@ -1316,13 +1291,14 @@ int CustIpCache::fetchAllIpQueryFromDb() {
 					_ip.setFromString(row["IP"].c_str());
 					rec.ip = _ip;
 					rec.cust_id = radiusUsers[row["radius_username"]];
-					this->custCacheVect.push_back(rec);
+					custCacheVect.push_back(rec);
 				}
 			}
 		}
-		if(this->custCacheVect.size()) {
-			std::sort(this->custCacheVect.begin(), this->custCacheVect.end());
+		if(custCacheVect.size()) {
+			std::sort(custCacheVect.begin(), custCacheVect.end());
 		}
+		this->custCacheVect.set(&custCacheVect);
 		if(verbosity > 0) {
 			int _diff_time = time(NULL) - _start_time;
 			cout << "IPACC load customers " << _diff_time << " s" << endl;
@@ -1341,12 +1317,18 @@ int CustIpCache::getCustByIpFromCacheMap(vmIP ip) {
 }
 
 int CustIpCache::getCustByIpFromCacheVect(vmIP ip) {
-  	vector<cust_cache_rec>::iterator findRecIt;
-  	findRecIt = std::lower_bound(this->custCacheVect.begin(), this->custCacheVect.end(), ip);
-  	if(findRecIt != this->custCacheVect.end() && (*findRecIt).ip == ip) {
-  		return((*findRecIt).cust_id);
-  	}
-	return(0);
+	bool rcu_lock;
+	IpaccCacheSnapshot<cust_cache_rec>::sSnapshot *snapshot = this->custCacheVect.read_lock(&rcu_lock);
+	int cust_id = 0;
+	if(snapshot) {
+		vector<cust_cache_rec>::const_iterator findRecIt;
+		findRecIt = std::lower_bound(snapshot->recs.begin(), snapshot->recs.end(), ip);
+		if(findRecIt != snapshot->recs.end() && (*findRecIt).ip == ip) {
+			cust_id = (*findRecIt).cust_id;
+		}
+	}
+	this->custCacheVect.read_unlock(rcu_lock);
+	return(cust_id);
 }
 
 void CustIpCache::flush() {
@@ -1360,17 +1342,22 @@ void CustIpCache::flush() {
 }
 
 void CustIpCache::clear() {
-	this->custCacheVect.clear();
+	this->custCacheVect.set(NULL);
 	this->custCacheMap.clear();
 }
 
 string CustIpCache::printVect() {
 	string rslt;
-	for(size_t i = 0; i < this->custCacheVect.size(); i++) {
-		char rsltRec[100];
-		snprintf(rsltRec, sizeof(rsltRec), "%s -> %u\n", this->custCacheVect[i].ip.getString().c_str(), this->custCacheVect[i].cust_id);
-		rslt += rsltRec;
+	bool rcu_lock;
+	IpaccCacheSnapshot<cust_cache_rec>::sSnapshot *snapshot = this->custCacheVect.read_lock(&rcu_lock);
+	if(snapshot) {
+		for(size_t i = 0; i < snapshot->recs.size(); i++) {
+			char rsltRec[100];
+			snprintf(rsltRec, sizeof(rsltRec), "%s -> %u\n", snapshot->recs[i].ip.getString().c_str(), snapshot->recs[i].cust_id);
+			rslt += rsltRec;
+		}
 	}
+	this->custCacheVect.read_unlock(rcu_lock);
 	return(rslt);
 }
 
@@ -1399,12 +1386,12 @@ bool NextIpCache::isIn(vmIP ip) {
 		this->fetch();
 		this->doFlush = false;
 	}
-	if(!this->nextCache.size()) {
-		return(false);
-	}
+	bool rcu_lock;
+	IpaccCacheSnapshot<next_cache_rec>::sSnapshot *snapshot = this->nextCache.read_lock(&rcu_lock);
+	bool rslt = false;
 	next_cache_rec rec;
-	vector<next_cache_rec>::iterator findRecIt;
-	for(unsigned int mask = 32; mask >= 16; --mask) {
+	vector<next_cache_rec>::const_iterator findRecIt;
+	for(unsigned int mask = 32; snapshot && mask >= 16; --mask) {
 		rec.ip = ip;
 		rec.mask = mask;
 		if(!rec.mask) {
@@ -1413,22 +1400,24 @@ bool NextIpCache::isIn(vmIP ip) {
 		if(rec.mask < 32) {
 			rec.ip = rec.ip.network(rec.mask);
 		}
-		findRecIt = std::lower_bound(this->nextCache.begin(), this->nextCache.end(), rec);
-		if(findRecIt != this->nextCache.end() && (*findRecIt).ip == rec.ip) {
+		findRecIt = std::lower_bound(snapshot->recs.begin(), snapshot->recs.end(), rec);
+		if(findRecIt != snapshot->recs.end() && (*findRecIt).ip == rec.ip) {
 			//cout << endl << (*findRecIt).ip << "/" << mask << endl;
-			return(true);
+			rslt = true;
+			break;
 		}
 	}
-	return(false);
+	this->nextCache.read_unlock(rcu_lock);
+	return(rslt);
 }
 
 void NextIpCache::fetch() {
 	if(!this->sqlDb->existsTable("ipacc_capt_ip")) {
-		this->nextCache.clear();
+		this->nextCache.set(NULL);
 		return;
 	}
 	if(this->sqlDb->query("select ip, mask from ipacc_capt_ip where enable")) {
-		this->nextCache.clear();
+		vector<next_cache_rec> nextCache;
 		SqlDb_row row;
 		while((row = this->sqlDb->fetchRow())) {
 			next_cache_rec rec;
@@ -1440,11 +1429,12 @@ void NextIpCache::fetch() {
 			if(rec.mask < 32) {
 				rec.ip = rec.ip.network(rec.mask);
 			}
-			this->nextCache.push_back(rec);
+			nextCache.push_back(rec);
 		}
-		if(this->nextCache.size()) {
-			std::sort(this->nextCache.begin(), this->nextCache.end());
+		if(nextCache.size()) {
+			std::sort(nextCache.begin(), nextCache.end());
 		}
+		this->nextCache.set(&nextCache);
 		if(verbosity > 1) {
 			cout << "IPACC load next IP" << endl;
 		}
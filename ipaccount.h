@@ -14,17 +14,14 @@
 #include "sniff.h"
 #include "sql_db.h"
 #include "tools.h"
+#include "rcu.h"
+#include "ipaccount_flow.h"
 
-void ipaccount(time_t, struct iphdr2 *, int, int);
 
-struct octects_t {
-	octects_t() {
-		octects = 0;
-		numpackets = 0;
-	}
-	u_int32_t octects;
-	u_int32_t numpackets;
-};
+#define IPACC_QRING_SIZE 64
+
+void ipaccount(time_t, struct iphdr2 *, int, int);
+void ipaccount_flush();
 
 struct octects_live_t {
 	int all;
@@ -111,42 +108,78 @@ struct cust_reseller {
 	string reseller_id;
 };
 
-struct t_ipacc_buffer_key {
-	vmIP saddr;
-	vmIP daddr;
-	vmPort port; 
-	int proto;
-	bool voip;
-	inline bool operator == (const t_ipacc_buffer_key& other) const {
-		return(this->saddr == other.saddr &&
-		       this->daddr == other.daddr &&
-		       this->port == other.port &&
-		       this->proto == other.proto && 
-		       this->voip == other.voip);
+/*
+ immutable snapshot of lookup cache
+ - replaced as whole (set), old snapshot is retired through epoch rcu
+ - readers (read_lock / read_unlock) don't lock, only a thread without rcu reader slot falls back to the writer lock
+*/
+template<class T>
+class IpaccCacheSnapshot {
+public:
+	struct sSnapshot {
+		sSnapshot(vector<T> *recs) {
+			this->recs.swap(*recs);
+		}
+		static void destroy(void *snapshot) {
+			delete (sSnapshot*)snapshot;
+		}
+		vector<T> recs;
+	};
+public:
+	IpaccCacheSnapshot() {
+		snapshot = NULL;
+		sync = 0;
+	}
+	~IpaccCacheSnapshot() {
+		if(snapshot) {
+			delete snapshot;
+		}
+	}
+	void set(vector<T> *recs) {
+		sSnapshot *new_snapshot = recs ? new FILE_LINE(0) sSnapshot(recs) : NULL;
+		__SYNC_LOCK(sync);
+		sSnapshot *old_snapshot = snapshot;
+		snapshot = new_snapshot;
+		__SYNC_UNLOCK(sync);
+		if(old_snapshot) {
+			cEpochRcu *rcu = getRcu();
+			rcu->retire(old_snapshot, sSnapshot::destroy);
+			rcu->reclaim();
+		}
+	}
+	sSnapshot *read_lock(bool *rcu_lock) {
+		*rcu_lock = getRcu()->read_lock();
+		if(!*rcu_lock) {
+			__SYNC_LOCK(sync);
+		}
+		return(snapshot);
+	}
+	void read_unlock(bool rcu_lock) {
+		if(rcu_lock) {
+			getRcu()->read_unlock();
+		} else {
+			__SYNC_UNLOCK(sync);
+		}
+	}
+	size_t size() {
+		bool rcu_lock;
+		sSnapshot *_snapshot = read_lock(&rcu_lock);
+		size_t size = _snapshot ? _snapshot->recs.size() : 0;
+		read_unlock(rcu_lock);
+		return(size);
 	}
-	inline bool operator < (const t_ipacc_buffer_key& other) const { 
-		return(this->saddr < other.saddr ? 1 : this->saddr > other.saddr ? 0 :
-		       this->daddr < other.daddr ? 1 : this->daddr > other.daddr ? 0 :
-		       this->port < other.port ? 1 : this->port > other.port ? 0 :
-		       this->proto < other.proto ? 1 : this->proto > other.proto ? 0 :
-		       this->voip < other.voip);
+private:
+	static cEpochRcu *getRcu() {
+		static cEpochRcu rcu;
+		return(&rcu);
 	}
+private:
+	sSnapshot * volatile snapshot;
+	volatile int sync;
 };
 
-typedef map<t_ipacc_buffer_key, octects_t> t_ipacc_buffer; 
-
 class Ipacc {
 public:
-	struct packet {
-		time_t timestamp;
-		vmIP saddr;
-		vmIP daddr;
-		vmPort port; 
-		int proto;
-		int packetlen;
-		int voippacket;
-		volatile int used;
-	};
 	struct s_ipacc_data {
 		unsigned int interval_time;
 		t_ipacc_buffer ipacc_buffer;
@@ -181,11 +214,11 @@ public:
 	Ipacc();
 	~Ipacc();
 	inline void push(time_t timestamp, vmIP saddr, vmIP daddr, vmPort port, int proto, int packetlen, int voippacket);
+	void flushTable();
 	void init();
 	void term();
 	int refreshCustIpCache();
 	void save(unsigned int interval_time, t_ipacc_buffer *ipacc_buffer, s_cache *cache);
-	inline void add_octets(time_t timestamp, vmIP saddr, vmIP daddr, vmPort port, int proto, int packetlen, int voippacket);
 	unsigned int lengthBuffer();
 	unsigned int sizeBuffer();
 	class CustIpCache *getCustIpCache() {
@@ -198,6 +231,8 @@ public:
 	void stopThread();
 	string getCpuUsagePerc();
 private:
+	void pushTable();
+	void mergeTable(IpaccFlowTable *table);
 	void *outThreadFunction();
 	void lock_map_ipacc_data() {
 		__SYNC_LOCK(map_ipacc_data_sync);
@@ -214,10 +249,10 @@ private:
 	volatile int map_ipacc_data_sync;
 	unsigned map_ipacc_data_save_limit;
 	SqlDb *sqlDbSave;
-	packet *qring;
-	unsigned int qringmax;
-	volatile unsigned int readit;
-	volatile unsigned int writeit;
+	IpaccFlowTable *table;
+	IpaccFlowTable * volatile qring[IPACC_QRING_SIZE];
+	unsigned int readit;
+	unsigned int writeit;
 	pthread_t out_thread_handle;
 	int outThreadId;
 	pstat_data threadPstatData[2];
@@ -352,7 +387,7 @@ private:
 	SqlDb *sqlDb;
 	SqlDb *sqlDbRadius;
 	map<vmIP, cust_cache_item> custCacheMap;
-	vector<cust_cache_rec> custCacheVect;
+	IpaccCacheSnapshot<cust_cache_rec> custCacheVect;
 	string sqlDriver;
 	string odbcDsn;
 	string odbcUser;
@@ -388,7 +423,7 @@ public:
 	}
 private:
 	SqlDb *sqlDb;
-	vector<next_cache_rec> nextCache;
+	IpaccCacheSnapshot<next_cache_rec> nextCache;
 	unsigned int flushCounter;
 	bool doFlush;
 };
@@ -0,0 +1,174 @@
+#ifndef IPACCOUNT_FLOW_H
+#define IPACCOUNT_FLOW_H
+
+#include <string.h>
+#include <map>
+
+#include "ip.h"
+
+
+#define IPACC_FLOW_TABLE_BITS 16
+
+
+struct octects_t {
+	octects_t() {
+		octects = 0;
+		numpackets = 0;
+	}
+	u_int32_t octects;
+	u_int32_t numpackets;
+};
+
+struct t_ipacc_buffer_key {
+	vmIP saddr;
+	vmIP daddr;
+	vmPort port;
+	int proto;
+	bool voip;
+	inline bool operator == (const t_ipacc_buffer_key& other) const {
+		return(this->saddr == other.saddr &&
+		       this->daddr == other.daddr &&
+		       this->port == other.port &&
+		       this->proto == other.proto &&
+		       this->voip == other.voip);
+	}
+	inline bool operator < (const t_ipacc_buffer_key& other) const {
+		return(this->saddr < other.saddr ? 1 : this->saddr > other.saddr ? 0 :
+		       this->daddr < other.daddr ? 1 : this->daddr > other.daddr ? 0 :
+		       this->port < other.port ? 1 : this->port > other.port ? 0 :
+		       this->proto < other.proto ? 1 : this->proto > other.proto ? 0 :
+		       this->voip < other.voip);
+	}
+};
+
+typedef std::map<t_ipacc_buffer_key, octects_t> t_ipacc_buffer;
+
+/*
+ fixed-size flow key (ipv4 is stored as ipv4-mapped word 3, without padding)
+ - can be compared by memcmp and hashed by words
+*/
+struct t_ipacc_flow_key {
+	enum eFlags {
+		_voip = 1,
+		_saddr_v6 = 2,
+		_daddr_v6 = 4
+	};
+	inline void set(vmIP saddr, vmIP daddr, vmPort port, int proto, bool voip) {
+		flags = voip ? _voip : 0;
+		setIP(this->saddr, saddr, _saddr_v6);
+		setIP(this->daddr, daddr, _daddr_v6);
+		this->port = port.getPort();
+		this->proto = proto;
+	}
+	inline u_int32_t hash() const {
+		u_int32_t h = port | (proto << 16) | (flags << 24);
+		for(unsigned i = 0; i < 4; i++) {
+			h = (h ^ saddr[i]) * 0x9E3779B1;
+			h = (h ^ daddr[i]) * 0x85EBCA6B;
+		}
+		return(h ^ (h >> 15));
+	}
+	inline bool operator == (const t_ipacc_flow_key& other) const {
+		return(!memcmp(this, &other, sizeof(t_ipacc_flow_key)));
+	}
+	inline void getBufferKey(t_ipacc_buffer_key *key) const {
+		key->saddr = getIP(saddr, _saddr_v6);
+		key->daddr = getIP(daddr, _daddr_v6);
+		key->port = port;
+		key->proto = proto;
+		key->voip = flags & _voip;
+	}
+	u_int32_t saddr[4];
+	u_int32_t daddr[4];
+	u_int16_t port;
+	u_int8_t proto;
+	u_int8_t flags;
+private:
+	inline void setIP(u_int32_t *words, vmIP ip, u_int8_t flag_v6) {
+		#if VM_IPV6
+		if(ip.is_v6()) {
+			in6_addr ip6 = ip.getIPv6();
+			memcpy(words, &ip6, sizeof(ip6));
+			flags |= flag_v6;
+			return;
+		}
+		#endif
+		words[0] = 0;
+		words[1] = 0;
+		words[2] = 0;
+		words[3] = ip.getIPv4();
+	}
+	inline vmIP getIP(const u_int32_t *words, u_int8_t flag_v6) const {
+		#if VM_IPV6
+		if(flags & flag_v6) {
+			in6_addr ip6;
+			memcpy(&ip6, words, sizeof(ip6));
+			return(vmIP(ip6));
+		}
+		#endif
+		return(vmIP(words[3]));
+	}
+};
+
+/*
+ open-addressed aggregation table of one producer thread for one interval
+ - filled without locks in producer thread, merged into t_ipacc_buffer in out thread
+*/
+class IpaccFlowTable {
+public:
+	struct sItem {
+		t_ipacc_flow_key key;
+		octects_t octects;
+	};
+public:
+	IpaccFlowTable(unsigned interval_time, unsigned size_bits = IPACC_FLOW_TABLE_BITS) {
+		this->interval_time = interval_time;
+		this->mask = (1 << size_bits) - 1;
+		this->count = 0;
+		this->items = new FILE_LINE(0) sItem[this->mask + 1];
+	}
+	~IpaccFlowTable() {
+		delete [] this->items;
+	}
+	inline void add(const t_ipacc_flow_key *key, unsigned packetlen) {
+		u_int32_t i = key->hash() & mask;
+		while(items[i].octects.numpackets) {
+			if(items[i].key == *key) {
+				items[i].octects.octects += packetlen;
+				items[i].octects.numpackets++;
+				return;
+			}
+			i = (i + 1) & mask;
+		}
+		items[i].key = *key;
+		items[i].octects.octects = packetlen;
+		items[i].octects.numpackets = 1;
+		++count;
+	}
+	inline bool isFull() {
+		return(count >= (mask + 1) / 4 * 3);
+	}
+	void mergeTo(t_ipacc_buffer *ipacc_buffer) {
+		t_ipacc_buffer_key key;
+		for(u_int32_t i = 0; i <= mask; i++) {
+			if(items[i].octects.numpackets) {
+				items[i].key.getBufferKey(&key);
+				octects_t *octects = &(*ipacc_buffer)[key];
+				octects->octects += items[i].octects.octects;
+				octects->numpackets += items[i].octects.numpackets;
+			}
+		}
+	}
+	unsigned getCount() {
+		return(count);
+	}
+public:
+	unsigned interval_time;
+private:
+	sItem *items;
+	u_int32_t mask;
+	unsigned count;
+};
+
+
+#endif //IPACCOUNT_FLOW_H
@@ -50,6 +50,8 @@
 #include "server.h"
 #include "filter_mysql.h"
 #include "charts.h"
+#include "packet_latency.h"
+#include "active_calls_log.h"
 
 #ifndef FREEBSD
 #include <malloc.h>
@@ -232,6 +234,12 @@ int Mgmt_params::sendFile(const char *fileName, u_int64_t tailMaxSize) {
 				  rbuf[0] == 'L' && rbuf[1] == 'Z' && rbuf[2] == 'O') {
 				recompressStream->setTypeDecompress(RecompressStream::lzo, true);
 			}
+			#ifdef HAVE_LIBZSTD
+			else if(nread >= ZSTD_HEADER_CHECK_LENGTH &&
+				ZSTD_HEADER_CHECK(rbuf, 0)) {
+				recompressStream->setTypeDecompress(RecompressStream::zstd);
+			}
+			#endif //HAVE_LIBZSTD
 		}
 		read_size += nread;
 		recompressStream->processData(rbuf, nread);
@@ -329,6 +337,7 @@ Mgmt_params::Mgmt_params(char *ibuf, int isize, sClientInfo iclient, cClient *ic
 int Mgmt_help(Mgmt_params *params);
 int Mgmt_getversion(Mgmt_params *params);
 int Mgmt_listcalls(Mgmt_params *params);
+int Mgmt_listcalls_delta(Mgmt_params *params);
 int Mgmt_reindexfiles(Mgmt_params *params);
 int Mgmt_offon(Mgmt_params *params);
 int Mgmt_check_filesindex(Mgmt_params *params);
@@ -437,11 +446,13 @@ int Mgmt_hashtable_stats(Mgmt_params *params);
 int Mgmt_usleep_stats(Mgmt_params *params);
 int Mgmt_charts_cache(Mgmt_params *params);
 int Mgmt_packetbuffer_log(Mgmt_params *params);
+int Mgmt_packet_latency(Mgmt_params *params);
 
 int (* MgmtFuncArray[])(Mgmt_params *params) = {
 	Mgmt_help,
 	Mgmt_getversion,
 	Mgmt_listcalls,
+	Mgmt_listcalls_delta,
 	Mgmt_reindexfiles,
 	Mgmt_offon,
 	Mgmt_check_filesindex,
@@ -550,6 +561,7 @@ int (* MgmtFuncArray[])(Mgmt_params *params) = {
 	Mgmt_usleep_stats,
 	Mgmt_charts_cache,
 	Mgmt_packetbuffer_log,
+	Mgmt_packet_latency,
 	NULL
 };
 
@@ -2327,6 +2339,28 @@ int Mgmt_listcalls(Mgmt_params *params) {
 	return 0;
 }
 
+int Mgmt_listcalls_delta(Mgmt_params *params) {
+	if (params->task == params->mgmt_task_DoInit) {
+		params->registerCommand("listcalls_delta", "lists changes of active calls since seq of previous response (listcalls_delta {\"seq\":N,\"format\":\"json|compact\"})");
+		return(0);
+	}
+	if(calltable) {
+		string rslt_data;
+		char *pointer;
+		if((pointer = strchr(params->buf, '\n')) != NULL) {
+			*pointer = 0;
+		}
+		params->zip = false;
+		char *jsonParams = params->buf + strlen("listcalls_delta");
+		while(*jsonParams == ' ') {
+			++jsonParams;
+		}
+		rslt_data = activeCallsLog.getDeltaJson(jsonParams, &params->zip);
+		return(params->sendString(&rslt_data));
+	}
+	return 0;
+}
+
 typedef struct {
 	const char *cmd;
 	volatile int *setVar;
@@ -4716,6 +4750,15 @@ int Mgmt_packetbuffer_log(Mgmt_params *params) {
 	return(0);
 }
 
+int Mgmt_packet_latency(Mgmt_params *params) {
+	if (params->task == params->mgmt_task_DoInit) {
+		params->registerCommand("packet_latency", "return latency histograms of packet pipeline stages (packet_latency [buckets])");
+		return(0);
+	}
+	string rslt = packetLatency.getJson(strstr(params->buf, "buckets"));
+	return(params->sendString(rslt + "\n"));
+}
+
 int Mgmt_memcrash_test(Mgmt_params *params) {
 	if (params->task == params->mgmt_task_DoInit) {
 		commandAndHelp ch[] = {
@@ -0,0 +1,159 @@
+#include "voipmonitor.h"
+
+#include <iomanip>
+#include <sstream>
+
+#include "packet_latency.h"
+#include "tools.h"
+
+
+cPacketLatency packetLatency;
+
+
+void sPacketLatencyHistogram::diff(sPacketLatencyHistogram *prev, sPacketLatencyHistogram *rslt) {
+	for(unsigned i = 0; i < PACKET_LATENCY_BUCKETS; i++) {
+		u_int64_t act = buckets[i];
+		rslt->buckets[i] = act - prev->buckets[i];
+		prev->buckets[i] = act;
+	}
+	u_int64_t act_count = count;
+	u_int64_t act_sum = sum;
+	rslt->count = act_count - prev->count;
+	rslt->sum = act_sum - prev->sum;
+	prev->count = act_count;
+	prev->sum = act_sum;
+	// max in interval is not known - upper bound of highest used bucket
+	rslt->max = 0;
+	for(int i = PACKET_LATENCY_BUCKETS - 1; i >= 0; i--) {
+		if(rslt->buckets[i]) {
+			rslt->max = min((u_int64_t)max, getBucketMax(i));
+			break;
+		}
+	}
+}
+
+u_int64_t sPacketLatencyHistogram::getPercentile(double perc) {
+	u_int64_t sum_count = 0;
+	for(unsigned i = 0; i < PACKET_LATENCY_BUCKETS; i++) {
+		sum_count += buckets[i];
+	}
+	if(!sum_count) {
+		return(0);
+	}
+	u_int64_t limit = (u_int64_t)ceil(sum_count * perc / 100);
+	if(!limit) {
+		limit = 1;
+	}
+	u_int64_t sum_count_to = 0;
+	for(unsigned i = 0; i < PACKET_LATENCY_BUCKETS; i++) {
+		sum_count_to += buckets[i];
+		if(sum_count_to >= limit) {
+			return(min((u_int64_t)max, getBucketMax(i)));
+		}
+	}
+	return(max);
+}
+
+const char *cPacketLatency::getStageName(int stage) {
+	switch(stage) {
+	case _fifo:
+		return("fifo");
+	case _detach:
+		return("detach");
+	case _sip:
+		return("sip");
+	case _extend:
+		return("extend");
+	case _call:
+		return("call");
+	case _register:
+		return("register");
+	case _sip_other:
+		return("sip_other");
+	case _rtp:
+		return("rtp");
+	case _other:
+		return("other");
+	case _process_rtp:
+		return("process_rtp");
+	}
+	return("");
+}
+
+const char *cPacketLatency::getStageShortcut(int stage) {
+	switch(stage) {
+	case _fifo:
+		return("f");
+	case _detach:
+		return("d");
+	case _sip:
+		return("s");
+	case _extend:
+		return("e");
+	case _call:
+		return("c");
+	case _register:
+		return("g");
+	case _sip_other:
+		return("so");
+	case _rtp:
+		return("r");
+	case _other:
+		return("o");
+	case _process_rtp:
+		return("t");
+	}
+	return("");
+}
+
+string cPacketLatency::getStatString() {
+	// p50/p99 in ms since previous call (one caller - sniffer_stat line)
+	ostringstream outStr;
+	outStr << fixed;
+	unsigned counter = 0;
+	for(int i = 0; i < _stage_end; i++) {
+		sPacketLatencyHistogram interval;
+		stages[i].diff(&stages_last[i], &interval);
+		if(!interval.count) {
+			continue;
+		}
+		if(counter) {
+			outStr << ' ';
+		}
+		outStr << getStageShortcut(i) << ':'
+		       << setprecision(1) << interval.getPercentile(50) / 1000. << '/'
+		       << setprecision(1) << interval.getPercentile(99) / 1000.;
+		++counter;
+	}
+	return(outStr.str());
+}
+
+string cPacketLatency::getJson(bool buckets) {
+	JsonExport json;
+	json.add("sample", opt_packet_latency_sample);
+	JsonExport *json_stages = json.addArray("stages");
+	for(int i = 0; i < _stage_end; i++) {
+		sPacketLatencyHistogram *histogram = &stages[i];
+		JsonExport *json_stage = json_stages->addObject(NULL);
+		json_stage->add("stage", getStageName(i));
+		json_stage->add("count", histogram->count);
+		json_stage->add("avg_us", floatToString(histogram->getAvg(), 1, false), JsonExport::_number);
+		json_stage->add("p50_us", histogram->getPercentile(50));
+		json_stage->add("p90_us", histogram->getPercentile(90));
+		json_stage->add("p99_us", histogram->getPercentile(99));
+		json_stage->add("p999_us", histogram->getPercentile(99.9));
+		json_stage->add("max_us", histogram->max);
+		if(buckets) {
+			JsonExport *json_buckets = json_stage->addArray("buckets");
+			for(unsigned j = 0; j < PACKET_LATENCY_BUCKETS; j++) {
+				if(histogram->buckets[j]) {
+					JsonExport *json_bucket = json_buckets->addObject(NULL);
+					json_bucket->add("from_us", sPacketLatencyHistogram::getBucketMin(j));
+					json_bucket->add("to_us", sPacketLatencyHistogram::getBucketMax(j));
+					json_bucket->add("count", histogram->buckets[j]);
+				}
+			}
+		}
+	}
+	return(json.getJson());
+}
@@ -0,0 +1,146 @@
+#ifndef PACKET_LATENCY_H
+#define PACKET_LATENCY_H
+
+
+#include <string>
+#include <string.h>
+#include <sys/types.h>
+
+#include "tools_global.h"
+
+
+#define PACKET_LATENCY_SUB_BITS 2
+#define PACKET_LATENCY_BUCKETS 125	// log-linear buckets in us, last one for >= 2^32 us
+
+
+extern unsigned opt_packet_latency_sample;
+
+
+/*
+ log-linear histogram of latency in us
+ - values < 4us have own bucket, each next power of two is split into 4 linear sub-buckets (relative error <= 25%)
+ - updated by atomic adds from several threads
+*/
+struct sPacketLatencyHistogram {
+	sPacketLatencyHistogram() {
+		clear();
+	}
+	void clear() {
+		memset((void*)this, 0, sizeof(*this));
+	}
+	static inline unsigned getBucket(u_int64_t us) {
+		if(us < (1 << PACKET_LATENCY_SUB_BITS)) {
+			return(us);
+		}
+		if(us >> 32) {
+			return(PACKET_LATENCY_BUCKETS - 1);
+		}
+		unsigned msb = 63 - __builtin_clzll(us);
+		unsigned sub = (us >> (msb - PACKET_LATENCY_SUB_BITS)) & ((1 << PACKET_LATENCY_SUB_BITS) - 1);
+		return((msb - PACKET_LATENCY_SUB_BITS + 1) * (1 << PACKET_LATENCY_SUB_BITS) + sub);
+	}
+	static inline u_int64_t getBucketMin(unsigned bucket) {
+		if(bucket < (1 << PACKET_LATENCY_SUB_BITS)) {
+			return(bucket);
+		}
+		unsigned group = bucket >> PACKET_LATENCY_SUB_BITS;
+		unsigned sub = bucket & ((1 << PACKET_LATENCY_SUB_BITS) - 1);
+		return((u_int64_t)((1 << PACKET_LATENCY_SUB_BITS) + sub) << (group - 1));
+	}
+	static inline u_int64_t getBucketMax(unsigned bucket) {
+		return(bucket < PACKET_LATENCY_BUCKETS - 1 ? getBucketMin(bucket + 1) - 1 : getBucketMin(bucket));
+	}
+	inline void add(u_int64_t us) {
+		__sync_fetch_and_add(&buckets[getBucket(us)], 1);
+		__sync_fetch_and_add(&count, 1);
+		__sync_fetch_and_add(&sum, us);
+		if(us > max) {
+			max = us;
+		}
+	}
+	void diff(sPacketLatencyHistogram *prev, sPacketLatencyHistogram *rslt);
+	u_int64_t getPercentile(double perc);
+	double getAvg() {
+		return(count ? (double)sum / count : 0);
+	}
+	volatile u_int64_t buckets[PACKET_LATENCY_BUCKETS];
+	volatile u_int64_t count;
+	volatile u_int64_t sum;
+	volatile u_int64_t max;
+};
+
+/*
+ time which sampled packets wait between stages of packet pipeline
+ - fifo: from creation of pcap block (capture thread) to pop in PcapQueue_readFromFifo
+ - preprocess stages and process rtp: from start of filling batch (push into qring) to take over by out thread
+ every opt_packet_latency_sample-th batch / block is timestamped by rdtsc, other ones cost only one counter increment
+*/
+class cPacketLatency {
+public:
+	enum eStage {
+		_fifo,
+		_detach,
+		_sip,
+		_extend,
+		_call,
+		_register,
+		_sip_other,
+		_rtp,
+		_other,
+		_process_rtp,
+		_stage_end
+	};
+public:
+	static inline u_int64_t getTicks() {
+		#if defined(__i386__) or defined(__x86_64__)
+		return(rdtsc());
+		#else
+		return(getTimeUS());
+		#endif
+	}
+	static inline u_int64_t mark(unsigned *counter) {
+		if(opt_packet_latency_sample && ++*counter >= opt_packet_latency_sample) {
+			*counter = 0;
+			return(getTicks());
+		}
+		return(0);
+	}
+	static inline bool sample(unsigned *counter) {
+		if(opt_packet_latency_sample && ++*counter >= opt_packet_latency_sample) {
+			*counter = 0;
+			return(true);
+		}
+		return(false);
+	}
+	inline void addTicks(eStage stage, u_int64_t mark_ticks) {
+		u_int64_t act_ticks = getTicks();
+		if(act_ticks <= mark_ticks) {
+			stages[stage].add(0);
+			return;
+		}
+		#if defined(__i386__) or defined(__x86_64__)
+		if(!rdtsc_by_250ms) {
+			return;
+		}
+		stages[stage].add((act_ticks - mark_ticks) * 250000 / rdtsc_by_250ms);
+		#else
+		stages[stage].add(act_ticks - mark_ticks);
+		#endif
+	}
+	inline void addUS(eStage stage, u_int64_t us) {
+		stages[stage].add(us);
+	}
+	static const char *getStageName(int stage);
+	static const char *getStageShortcut(int stage);
+	std::string getStatString();
+	std::string getJson(bool buckets);
+private:
+	sPacketLatencyHistogram stages[_stage_end];
+	sPacketLatencyHistogram stages_last[_stage_end];
+};
+
+
+extern cPacketLatency packetLatency;
+
+
+#endif //PACKET_LATENCY_H
@@ -40,6 +40,8 @@
 #include "ssl_dssl.h"
 #include "tcmalloc_hugetables.h"
 #include "heap_chunk.h"
+#include "replay_benchmark.h"
+#include "packet_latency.h"
 
 #ifndef FREEBSD
 #include <malloc.h>
@@ -95,6 +97,7 @@ extern int opt_ipaccount;
 extern int opt_pcapdump;
 extern int opt_dup_check;
 extern int opt_dup_check_ipheader;
+extern int opt_dup_check_time_window_ms;
 extern int opt_mirrorip;
 extern char opt_mirrorip_src[20];
 extern char opt_mirrorip_dst[20];
@@ -170,6 +173,18 @@ extern int opt_dpdk_prealloc_packetbuffer;
 extern int opt_dpdk_defer_send_packetbuffer;
 extern int opt_dpdk_rotate_packetbuffer;
 extern int opt_dpdk_copy_packetbuffer;
+extern bool opt_use_tpacket;
+extern int opt_tpacket_block_size;
+extern int opt_tpacket_block_timeout;
+extern int opt_tpacket_fanout;
+extern int opt_tpacket_fanout_threads;
+extern bool opt_tpacket_zerocopy;
+extern bool opt_use_xdp;
+extern int opt_xdp_queues;
+extern int opt_xdp_attach_mode;
+extern int opt_xdp_bind_mode;
+extern int opt_xdp_frame_size;
+extern bool opt_xdp_frames_in_packetbuffer;
 
 extern sSnifferClientOptions snifferClientOptions;
 extern sSnifferServerClientOptions snifferServerClientOptions;
@@ -213,6 +228,11 @@ int opt_pcap_queue_compress				= -1;
 pcap_block_store::compress_method opt_pcap_queue_compress_method 
 							= pcap_block_store::snappy;
 int opt_pcap_queue_compress_ratio = 100;
+int opt_pcap_queue_compress_level = 0;
+string opt_pcap_queue_compress_zstd_dictionary;
+int opt_pcap_queue_file_io = cFileStoreIO::_fsio_buffered;
+int opt_pcap_queue_file_io_threads = 2;
+u_int64_t opt_pcap_queue_file_readahead = 8 * 1024 * 1024;
 string opt_pcap_queue_disk_folder;
 ip_port opt_pcap_queue_send_to_ip_port;
 ip_port opt_pcap_queue_receive_from_ip_port;
@@ -249,12 +269,35 @@ double last_traffic = -1;
 
 static pcap_block_store_queue *blockStoreBypassQueue; 
 
+#define COMPRESS_ADAPTIVE_PROBE_INTERVAL 128
+
+struct sCompressAdaptiveMethod {
+	double ratio;
+	double ns_per_byte;
+	u_int32_t blocks;
+};
+
+struct sCompressAdaptive {
+	sCompressAdaptiveMethod methods[pcap_block_store::compress_method_adaptive];
+	u_int8_t last_method;
+	u_int32_t counter;
+	u_int32_t probe_index;
+};
+
+static __thread sCompressAdaptive compress_adaptive;
+
+#ifdef HAVE_LIBZSTD
+static ZSTD_CDict *packetbuffer_zstd_cdict;
+static ZSTD_DDict *packetbuffer_zstd_ddict;
+#endif //HAVE_LIBZSTD
+
 static unsigned long sumPacketsCounterIn[3];
 static unsigned long sumPacketsCounterOut[3];
 static unsigned long sumBlocksCounterIn[3];
 static unsigned long sumBlocksCounterOut[3];
 static unsigned long long sumPacketsSize[3];
 static unsigned long long sumPacketsSizeCompress[3];
+static unsigned long sumBlocksCompressMethod[pcap_block_store::compress_method_adaptive];
 static unsigned long maxBypassBufferItems;
 static unsigned long maxBypassBufferSize;
 static unsigned long countBypassBufferSizeExceeded;
@@ -543,6 +586,33 @@ void pcap_block_store::add_dpdk(pcap_pkthdr_plus2 *header, void *mbuf) {
 	++this->count;
 }
 
+void pcap_block_store::add_ring_packet(pcap_pkthdr_plus2 *header, u_char *packet, unsigned max_count) {
+	if(!this->dpdk_data_size) {
+		this->dpdk_data_size = max_count;
+		this->dpdk_data = new FILE_LINE(0) s_dpdk_data[this->dpdk_data_size];
+	}
+	this->dpdk_data[this->count].header = *header;
+	this->dpdk_data[this->count].packet = packet;
+	this->dpdk_data[this->count].mbuf = NULL;
+ 	this->size += header->get_caplen();
+	this->size_packets += header->get_caplen();
+	++this->count;
+}
+
+void pcap_block_store::add_xdp_frame(pcap_pkthdr_plus2 *header, u_char *packet, void *umem, unsigned max_count) {
+	if(!this->dpdk_data_size) {
+		this->dpdk_data_size = max_count;
+		this->dpdk_data = new FILE_LINE(0) s_dpdk_data[this->dpdk_data_size];
+	}
+	this->xdp_umem = umem;
+	this->dpdk_data[this->count].header = *header;
+	this->dpdk_data[this->count].packet = packet;
+	this->dpdk_data[this->count].mbuf = NULL;
+ 	this->size += header->get_caplen();
+	this->size_packets += header->get_caplen();
+	++this->count;
+}
+
 bool pcap_block_store::is_dpkd_data_full() {
 	return(this->count == this->dpdk_data_size);
 }
@@ -581,11 +651,33 @@ void pcap_block_store::destroy() {
 				dpdk_mbuf_free(this->dpdk_data[i].mbuf);
 			}
 		}
+		if(this->xdp_umem) {
+			// umem frames are returned to the fill ring in batches
+			u_char *packets[64];
+			unsigned packets_count = 0;
+			for(unsigned i = 0; i < this->count; i++) {
+				packets[packets_count++] = this->dpdk_data[i].packet;
+				if(packets_count == sizeof(packets) / sizeof(packets[0])) {
+					xdp_frames_release(this->xdp_umem, packets, packets_count);
+					packets_count = 0;
+				}
+			}
+			if(packets_count) {
+				xdp_frames_release(this->xdp_umem, packets, packets_count);
+			}
+			this->xdp_umem = NULL;
+		}
 		delete [] this->dpdk_data;
+		this->dpdk_data = NULL;
 		this->dpdk_data_size = 0;
 	}
+	if(this->ring_block) {
+		tpacket_ring_block_release(this->ring_block);
+		this->ring_block = NULL;
+	}
 	this->size = 0;
 	this->size_compress = 0;
+	this->compressMethod = 0;
 	this->size_packets = 0;
 	this->count = 0;
 	this->offsets_size = 0;
@@ -615,6 +707,26 @@ void pcap_block_store::destroyRestoreBuffer() {
 	this->restoreBufferAllocSize = 0;
 }
 
+void pcap_block_store::upgradeRestoreBufferHeader_v7() {
+	// v7 header is v8 header without trailing compress_type - insert it (0 = local packetbuffer_compress_method)
+	size_t sizeHeaderV7 = offsetof(pcap_block_store_header, compress_type);
+	size_t sizeInsert = sizeof(pcap_block_store_header) - sizeHeaderV7;
+	if(this->restoreBufferAllocSize < this->restoreBufferSize + sizeInsert) {
+		this->restoreBufferAllocSize = this->restoreBufferSize + sizeInsert + _opt_pcap_queue_block_restore_buffer_inc_size;
+		u_char *restoreBufferNew = new FILE_LINE(0) u_char[this->restoreBufferAllocSize];
+		memcpy_heapsafe(restoreBufferNew, this->restoreBuffer, this->restoreBufferSize,
+				__FILE__, __LINE__);
+		delete [] this->restoreBuffer;
+		this->restoreBuffer = restoreBufferNew;
+	}
+	memmove(this->restoreBuffer + sizeof(pcap_block_store_header), 
+		this->restoreBuffer + sizeHeaderV7, 
+		this->restoreBufferSize - sizeHeaderV7);
+	memset(this->restoreBuffer + sizeHeaderV7, 0, sizeInsert);
+	this->restoreBufferSize += sizeInsert;
+	((pcap_block_store_header*)this->restoreBuffer)->version = PCAP_BLOCK_STORE_HEADER_VERSION;
+}
+
 bool pcap_block_store::isEmptyRestoreBuffer() {
 	return(!this->restoreBuffer);
 }
@@ -626,35 +738,42 @@ void pcap_block_store::freeBlock() {
 	}
 }
 
-u_char* pcap_block_store::getSaveBuffer(uint32_t block_counter) {
+u_char* pcap_block_store::getSaveBuffer(uint32_t block_counter, bool use_checksum) {
+	u_char *saveBuffer = new FILE_LINE(15010) u_char[this->getSizeSaveBuffer()];
+	this->fillSaveBuffer(saveBuffer, block_counter, true, use_checksum);
+	return(saveBuffer);
+}
+
+void pcap_block_store::fillSaveBuffer(u_char *saveBuffer, uint32_t block_counter, bool heapBuffer, bool use_checksum) {
+	// buffer not allocated by new (aligned buffer for direct io) cannot be checked by heapsafe
+	u_char *saveBufferBegin = heapBuffer ? saveBuffer : NULL;
 	size_t sizeSaveBuffer = this->getSizeSaveBuffer();
-	u_char *saveBuffer = new FILE_LINE(15010) u_char[sizeSaveBuffer];
 	pcap_block_store_header header;
 	header.hm = this->hm;
 	header.size = this->size;
 	header.size_compress = this->size_compress;
+	header.compress_type = this->compressMethod;
 	header.count = this->count;
 	header.dlink = this->dlink;
 	header.sensor_id = this->sensor_id;
 	header.counter = block_counter;
 	strcpy(header.ifname, this->ifname);
 	header.time_s = getTimeS();
-	memcpy_heapsafe(saveBuffer, saveBuffer,
+	memcpy_heapsafe(saveBuffer, saveBufferBegin,
 			&header, NULL,
 			sizeof(header),
 			__FILE__, __LINE__);
-	memcpy_heapsafe(saveBuffer + sizeof(header), saveBuffer,
+	memcpy_heapsafe(saveBuffer + sizeof(header), saveBufferBegin,
 			this->offsets, this->offsets,
 			sizeof(uint32_t) * this->count,
 			__FILE__, __LINE__);
-	memcpy_heapsafe(saveBuffer + sizeof(pcap_block_store_header) + this->count * sizeof(uint32_t), saveBuffer,
+	memcpy_heapsafe(saveBuffer + sizeof(pcap_block_store_header) + this->count * sizeof(uint32_t), saveBufferBegin,
 			this->block, this->block,
 			this->getUseSize(),
 			__FILE__, __LINE__);
-	((pcap_block_store_header*)saveBuffer)->checksum = opt_pcap_queues_mirror_use_checksum ?
+	((pcap_block_store_header*)saveBuffer)->checksum = opt_pcap_queues_mirror_use_checksum && use_checksum ?
 							    max(checksum32buf(saveBuffer + sizeof(pcap_block_store_header), sizeSaveBuffer - sizeof(pcap_block_store_header)), (u_int32_t)1) :
 							    0;
-	return(saveBuffer);
 }
 
 void pcap_block_store::restoreFromSaveBuffer(u_char *saveBuffer) {
@@ -662,6 +781,7 @@ void pcap_block_store::restoreFromSaveBuffer(u_char *saveBuffer) {
 	this->hm = (header_mode)header->hm;
 	this->size = header->size;
 	this->size_compress = header->size_compress;
+	this->compressMethod = header->compress_type;
 	this->count = header->count;
 	this->dlink = header->dlink;
 	this->sensor_id = header->sensor_id;
@@ -725,6 +845,11 @@ int pcap_block_store::addRestoreChunk(u_char *buffer, size_t size, size_t *offse
 	   strncmp(((pcap_block_store_header*)this->restoreBuffer)->title, PCAP_BLOCK_STORE_HEADER_STRING, PCAP_BLOCK_STORE_HEADER_STRING_LEN)) {
 		return(-3);
 	}
+	if(this->restoreBufferSize >= offsetof(pcap_block_store_header, compress_type) &&
+	   ((pcap_block_store_header*)this->restoreBuffer)->version == PCAP_BLOCK_STORE_HEADER_VERSION_V7 &&
+	   !strncmp(((pcap_block_store_header*)this->restoreBuffer)->title, PCAP_BLOCK_STORE_HEADER_STRING, PCAP_BLOCK_STORE_HEADER_STRING_LEN)) {
+		this->upgradeRestoreBufferHeader_v7();
+	}
 	if(this->restoreBufferSize >= sizeof(pcap_block_store_header) &&
 	   ((pcap_block_store_header*)this->restoreBuffer)->version != PCAP_BLOCK_STORE_HEADER_VERSION) {
 		return(-6);
@@ -809,6 +934,118 @@ string pcap_block_store::addRestoreChunk_getErrorString(int errorCode) {
 	return(error);
 }
 
+static u_char *compress_thread_buffer(size_t size) {
+	static __thread u_char *buffer;
+	static __thread size_t buffer_size;
+	if(size > buffer_size) {
+		if(buffer) {
+			delete [] buffer;
+		}
+		buffer = new FILE_LINE(0) u_char[size];
+		buffer_size = size;
+	}
+	return(buffer);
+}
+
+static void compress_store(pcap_block_store *blockStore, u_char *compressBuff, size_t compressSize, u_int8_t method) {
+	if(compressSize >= blockStore->size) {
+		// incompressible block (e.g. srtp) - keep it as is
+		sumPacketsSizeCompress[0] += blockStore->size;
+		return;
+	}
+	delete [] blockStore->block;
+	blockStore->block = new FILE_LINE(15016) u_char[compressSize];
+	memcpy_heapsafe(blockStore->block, compressBuff, compressSize,
+			__FILE__, __LINE__);
+	blockStore->size_compress = compressSize;
+	blockStore->compressMethod = method;
+	sumPacketsSizeCompress[0] += compressSize;
+	++sumBlocksCompressMethod[method];
+}
+
+static int compress_adaptive_candidates(u_int8_t *methods) {
+	int count = 0;
+	methods[count++] = pcap_block_store::snappy;
+	#ifdef HAVE_LIBLZ4
+	methods[count++] = pcap_block_store::lz4;
+	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	methods[count++] = pcap_block_store::zstd;
+	#else
+	#ifdef HAVE_LIBLZ4
+	methods[count++] = pcap_block_store::lz4_hc;
+	#endif //HAVE_LIBLZ4
+	#endif //HAVE_LIBZSTD
+	return(count);
+}
+
+static pcap_block_store::compress_method compress_adaptive_select() {
+	sCompressAdaptive *ca = &compress_adaptive;
+	u_int8_t candidates[pcap_block_store::compress_method_adaptive];
+	int candidates_count = compress_adaptive_candidates(candidates);
+	++ca->counter;
+	for(int i = 0; i < candidates_count; i++) {
+		if(!ca->methods[candidates[i]].blocks) {
+			return((pcap_block_store::compress_method)candidates[i]);
+		}
+	}
+	if(!(ca->counter % COMPRESS_ADAPTIVE_PROBE_INTERVAL)) {
+		u_int8_t probe = candidates[(ca->probe_index++) % candidates_count];
+		if(probe != ca->last_method) {
+			return((pcap_block_store::compress_method)probe);
+		}
+	}
+	if(!ca->last_method) {
+		ca->last_method = candidates[0];
+	}
+	// cpu of t1 (compress) thread projected by relative speed of methods against the last selected one
+	// with high packetbuffer usage there is allowed more cpu for better ratio
+	double cpu = buffersControl.get__pb_compress_cpu_perc();
+	if(cpu < 0) {
+		cpu = 50;
+	}
+	double cpu_limit = buffersControl.getPerc_pb() > 50 ? 90 : 70;
+	sCompressAdaptiveMethod *last = &ca->methods[ca->last_method];
+	int select = -1;
+	int fastest = -1;
+	for(int i = 0; i < candidates_count; i++) {
+		sCompressAdaptiveMethod *method = &ca->methods[candidates[i]];
+		if(fastest < 0 || method->ns_per_byte < ca->methods[candidates[fastest]].ns_per_byte) {
+			fastest = i;
+		}
+		double cpu_projected = last->ns_per_byte > 0 ? cpu * method->ns_per_byte / last->ns_per_byte : cpu;
+		if(cpu_projected <= cpu_limit &&
+		   (select < 0 || method->ratio < ca->methods[candidates[select]].ratio)) {
+			select = i;
+		}
+	}
+	u_int8_t rslt = candidates[select >= 0 ? select : fastest];
+	if(rslt != ca->last_method && cpu <= cpu_limit &&
+	   ca->methods[rslt].ratio > last->ratio * 0.95) {
+		// hysteresis - keep the last method while the other is not noticeably better
+		rslt = ca->last_method;
+	}
+	ca->last_method = rslt;
+	return((pcap_block_store::compress_method)rslt);
+}
+
+static void compress_adaptive_update(u_int8_t method, size_t size, size_t size_compress, u_int64_t time_ns) {
+	if(!size) {
+		return;
+	}
+	sCompressAdaptiveMethod *ca_method = &compress_adaptive.methods[method];
+	double ratio = (double)size_compress / size;
+	double ns_per_byte = (double)time_ns / size;
+	if(ca_method->blocks) {
+		ca_method->ratio = ca_method->ratio * 0.9 + ratio * 0.1;
+		ca_method->ns_per_byte = ca_method->ns_per_byte * 0.9 + ns_per_byte * 0.1;
+	} else {
+		ca_method->ratio = ratio;
+		ca_method->ns_per_byte = ns_per_byte;
+	}
+	++ca_method->blocks;
+}
+
 bool pcap_block_store::compress() {
 	if(!opt_pcap_queue_compress ||
 	   this->size_compress) {
@@ -828,36 +1065,47 @@ bool pcap_block_store::compress() {
 		case 9: if(!((__counter++) % 6)) return(true); break;
 		}
 	}
-	switch(opt_pcap_queue_compress_method) {
+	compress_method method = opt_pcap_queue_compress_method;
+	u_int64_t adaptive_start_ns = 0;
+	if(method == compress_method_adaptive) {
+		method = compress_adaptive_select();
+		adaptive_start_ns = getTimeNS();
+	}
+	bool rslt;
+	switch(method) {
+	#ifdef HAVE_LIBLZ4
 	case lz4:
-		#ifdef HAVE_LIBLZ4
-		return(this->compress_lz4());
-		#endif //HAVE_LIBLZ4
+		rslt = this->compress_lz4();
+		break;
+	case lz4_hc:
+		rslt = this->compress_lz4_hc();
+		break;
+	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	case zstd:
+		rslt = this->compress_zstd();
+		break;
+	#endif //HAVE_LIBZSTD
 	case snappy:
 	default:
-		return(this->compress_snappy());
+		method = snappy;
+		rslt = this->compress_snappy();
+		break;
 	}
-	return(true);
+	if(adaptive_start_ns && rslt) {
+		compress_adaptive_update(method, this->size, this->size_compress ? this->size_compress : this->size,
+					 getTimeNS() - adaptive_start_ns);
+	}
+	return(rslt);
 }
 
 bool pcap_block_store::compress_snappy() {
 	size_t snappyBuffSize = snappy_max_compressed_length(this->size);
-	u_char *snappyBuff = new FILE_LINE(15014) u_char[snappyBuffSize];
-	if(!snappyBuff) {
-		syslog(LOG_ERR, "packetbuffer: snappy_compress: snappy buffer allocation failed - PACKETBUFFER BLOCK DROPPED!");
-		return(false);
-	}
+	u_char *snappyBuff = compress_thread_buffer(snappyBuffSize);
 	snappy_status snappyRslt = snappy_compress((char*)this->block, this->size, (char*)snappyBuff, &snappyBuffSize);
 	switch(snappyRslt) {
 		case SNAPPY_OK:
-			delete [] this->block;
-			#if HEAPSAFE
-				this->block = (u_char*)realloc_object(snappyBuff, snappyBuffSize, __FILE__, __LINE__, 16015);
-			#else
-				this->block = (u_char*)realloc(snappyBuff, snappyBuffSize);
-			#endif
-			this->size_compress = snappyBuffSize;
-			sumPacketsSizeCompress[0] += this->size_compress;
+			compress_store(this, snappyBuff, snappyBuffSize, snappy);
 			return(true);
 		case SNAPPY_INVALID_INPUT:
 			syslog(LOG_ERR, "packetbuffer: snappy_compress: invalid input");
@@ -869,45 +1117,95 @@ bool pcap_block_store::compress_snappy() {
 			syslog(LOG_ERR, "packetbuffer: snappy_compress: unknown error");
 			break;
 	}
-	delete [] snappyBuff; 
 	return(false);
 }
 
 bool pcap_block_store::compress_lz4() {
 	#ifdef HAVE_LIBLZ4
-	size_t lz4BuffSize = LZ4_compressBound(this->size);
-	u_char *lz4Buff = new FILE_LINE(15015) u_char[lz4BuffSize];
-	if(!lz4Buff) {
-		syslog(LOG_ERR, "packetbuffer: lz4_compress: lz4 buffer allocation failed - PACKETBUFFER BLOCK DROPPED!");
-		return(false);
+	static __thread char *lz4State;
+	if(!lz4State) {
+		lz4State = new FILE_LINE(0) char[LZ4_sizeofState()];
 	}
-	int lz4_size = LZ4_compress((char*)this->block, (char*)lz4Buff, this->size);
+	size_t lz4BuffSize = LZ4_compressBound(this->size);
+	u_char *lz4Buff = compress_thread_buffer(lz4BuffSize);
+	int lz4_size = LZ4_compress_fast_extState(lz4State, (char*)this->block, (char*)lz4Buff, this->size, lz4BuffSize, 1);
 	if(lz4_size > 0) {
-		delete [] this->block;
-		this->block = new FILE_LINE(15016) u_char[lz4_size];
-		memcpy_heapsafe(this->block, lz4Buff, lz4_size,
-				__FILE__, __LINE__);
-		delete [] lz4Buff;
-		this->size_compress = lz4_size;
-		sumPacketsSizeCompress[0] += this->size_compress;
+		compress_store(this, lz4Buff, lz4_size, lz4);
 		return(true);
 	} else {
 		syslog(LOG_ERR, "packetbuffer: lz4_compress: error");
 	}
-	delete [] lz4Buff; 
 	#endif //HAVE_LIBLZ4
 	return(false);
 }
 
+bool pcap_block_store::compress_lz4_hc() {
+	#ifdef HAVE_LIBLZ4
+	static __thread char *lz4hcState;
+	if(!lz4hcState) {
+		lz4hcState = new FILE_LINE(0) char[LZ4_sizeofStateHC()];
+	}
+	size_t lz4BuffSize = LZ4_compressBound(this->size);
+	u_char *lz4Buff = compress_thread_buffer(lz4BuffSize);
+	int lz4_size = LZ4_compress_HC_extStateHC(lz4hcState, (char*)this->block, (char*)lz4Buff, this->size, lz4BuffSize,
+						  opt_pcap_queue_compress_level > 0 ? opt_pcap_queue_compress_level : 3);
+	if(lz4_size > 0) {
+		compress_store(this, lz4Buff, lz4_size, lz4_hc);
+		return(true);
+	} else {
+		syslog(LOG_ERR, "packetbuffer: lz4hc_compress: error");
+	}
+	#endif //HAVE_LIBLZ4
+	return(false);
+}
+
+bool pcap_block_store::compress_zstd() {
+	#ifdef HAVE_LIBZSTD
+	static __thread ZSTD_CCtx *zstdCCtx;
+	if(!zstdCCtx) {
+		zstdCCtx = ZSTD_createCCtx();
+		if(!zstdCCtx) {
+			syslog(LOG_ERR, "packetbuffer: zstd_compress: context allocation failed - PACKETBUFFER BLOCK DROPPED!");
+			return(false);
+		}
+	}
+	size_t zstdBuffSize = ZSTD_compressBound(this->size);
+	u_char *zstdBuff = compress_thread_buffer(zstdBuffSize);
+	size_t zstd_size = packetbuffer_zstd_cdict ?
+			    ZSTD_compress_usingCDict(zstdCCtx, zstdBuff, zstdBuffSize, this->block, this->size, packetbuffer_zstd_cdict) :
+			    ZSTD_compressCCtx(zstdCCtx, zstdBuff, zstdBuffSize, this->block, this->size, 
+					      opt_pcap_queue_compress_level ? opt_pcap_queue_compress_level : 1);
+	if(!ZSTD_isError(zstd_size)) {
+		compress_store(this, zstdBuff, zstd_size, zstd);
+		return(true);
+	} else {
+		syslog(LOG_ERR, "packetbuffer: zstd_compress: %s", ZSTD_getErrorName(zstd_size));
+	}
+	#endif //HAVE_LIBZSTD
+	return(false);
+}
+
 bool pcap_block_store::uncompress(compress_method method) {
 	if(!this->size_compress) {
 		return(true);
 	}
-	switch(method == compress_method_default ? opt_pcap_queue_compress_method : method) {
+	switch(this->compressMethod ? (compress_method)this->compressMethod :
+	       method == compress_method_default ? opt_pcap_queue_compress_method : method) {
 	case lz4:
+	case lz4_hc:
 		#ifdef HAVE_LIBLZ4
 		return(this->uncompress_lz4());
+		#else
+		syslog(LOG_ERR, "packetbuffer: lz4_uncompress: missing lz4 support");
+		return(false);
 		#endif //HAVE_LIBLZ4
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		return(this->uncompress_zstd());
+		#else
+		syslog(LOG_ERR, "packetbuffer: zstd_uncompress: missing zstd support");
+		return(false);
+		#endif //HAVE_LIBZSTD
 	case snappy:
 	default:
 		return(this->uncompress_snappy());
@@ -927,6 +1225,7 @@ bool pcap_block_store::uncompress_snappy() {
 			delete [] this->block;
 			this->block = snappyBuff;
 			this->size_compress = 0;
+			this->compressMethod = 0;
 			return(true);
 		case SNAPPY_INVALID_INPUT:
 			syslog(LOG_ERR, "packetbuffer: snappy_uncompress: invalid input");
@@ -951,10 +1250,11 @@ bool pcap_block_store::uncompress_lz4() {
 	}
 	size_t lz4BuffSize = this->size;
 	u_char *lz4Buff = new FILE_LINE(15018) u_char[lz4BuffSize];
-	if(LZ4_decompress_fast((char*)this->block, (char*)lz4Buff, this->size) >= 0) {
+	if(LZ4_decompress_safe((char*)this->block, (char*)lz4Buff, this->size_compress, this->size) == (int)this->size) {
 		delete [] this->block;
 		this->block = lz4Buff;
 		this->size_compress = 0;
+		this->compressMethod = 0;
 		return(true);
 	} else {
 		syslog(LOG_ERR, "packetbuffer: lz4_uncompress: error");
@@ -964,10 +1264,43 @@ bool pcap_block_store::uncompress_lz4() {
 	return(false);
 }
 
+bool pcap_block_store::uncompress_zstd() {
+	#ifdef HAVE_LIBZSTD
+	if(!this->size_compress) {
+		return(true);
+	}
+	static __thread ZSTD_DCtx *zstdDCtx;
+	if(!zstdDCtx) {
+		zstdDCtx = ZSTD_createDCtx();
+		if(!zstdDCtx) {
+			syslog(LOG_ERR, "packetbuffer: zstd_uncompress: context allocation failed");
+			return(false);
+		}
+	}
+	size_t zstdBuffSize = this->size;
+	u_char *zstdBuff = new FILE_LINE(0) u_char[zstdBuffSize];
+	size_t zstd_size = packetbuffer_zstd_ddict ?
+			    ZSTD_decompress_usingDDict(zstdDCtx, zstdBuff, zstdBuffSize, this->block, this->size_compress, packetbuffer_zstd_ddict) :
+			    ZSTD_decompressDCtx(zstdDCtx, zstdBuff, zstdBuffSize, this->block, this->size_compress);
+	if(zstd_size == this->size) {
+		delete [] this->block;
+		this->block = zstdBuff;
+		this->size_compress = 0;
+		this->compressMethod = 0;
+		return(true);
+	} else {
+		syslog(LOG_ERR, "packetbuffer: zstd_uncompress: %s", 
+		       ZSTD_isError(zstd_size) ? ZSTD_getErrorName(zstd_size) : "bad size");
+	}
+	delete [] zstdBuff;
+	#endif //HAVE_LIBZSTD
+	return(false);
+}
+
 
 pcap_block_store_queue::pcap_block_store_queue() {
 	extern volatile int terminating;
-	this->queueBlock = new FILE_LINE(15019) rqueue_quick<pcap_block_store*>(
+	this->queueBlock = new FILE_LINE(15019) rqueue_ring<pcap_block_store*>(
 				100000,
 				100, 100,
 				&terminating, true);
@@ -984,7 +1317,7 @@ pcap_block_store_queue::~pcap_block_store_queue() {
 }
 
 
-pcap_file_store::pcap_file_store(u_int id, const char *folder) {
+pcap_file_store::pcap_file_store(u_int id, const char *folder, cFileStoreIO *io) {
 	this->id = id;
 	this->folder = folder;
 	this->fileHandlePush = NULL;
@@ -998,6 +1331,14 @@ pcap_file_store::pcap_file_store(u_int id, const char *folder) {
 	this->full = false;
 	this->timestampMS = getTimeMS_rdtsc();
 	this->_sync_flush_file = 0;
+	this->io = io;
+	this->fd = -1;
+	this->fdDirect = false;
+	this->directPushOpen = false;
+	this->directPopOpen = false;
+	this->fileSizeWritten = 0;
+	this->_sync_pending_writes = 0;
+	this->readWindowActive = 0;
 }
 
 pcap_file_store::~pcap_file_store() {
@@ -1005,6 +1346,9 @@ pcap_file_store::~pcap_file_store() {
 }
 
 bool pcap_file_store::push(pcap_block_store *blockStore) {
+	if(this->io) {
+		return(this->push_direct(blockStore));
+	}
 	if(!this->fileHandlePush && !this->open(typeHandlePush)) {
 		return(false);
 	}
@@ -1042,6 +1386,9 @@ bool pcap_file_store::pop(pcap_block_store *blockStore) {
 		syslog(LOG_ERR, "packetbuffer: invalid file store id");
 		return(false);
 	}
+	if(this->io) {
+		return(this->pop_direct(blockStore));
+	}
 	if(!this->fileHandlePop && !this->open(typeHandlePop)) {
 		return(false);
 	}
@@ -1080,6 +1427,9 @@ bool pcap_file_store::pop(pcap_block_store *blockStore) {
 }
 
 bool pcap_file_store::open(eTypeHandle typeHandle) {
+	if(this->io) {
+		return(this->open_direct(typeHandle));
+	}
 	if((!(typeHandle & typeHandlePush) || this->fileHandlePush) &&
 	   (!(typeHandle & typeHandlePop) || this->fileHandlePop)) {
 		return(true);
@@ -1133,6 +1483,9 @@ bool pcap_file_store::open(eTypeHandle typeHandle) {
 }
 
 bool pcap_file_store::close(eTypeHandle typeHandle) {
+	if(this->io) {
+		return(this->close_direct(typeHandle));
+	}
 	if(typeHandle & typeHandlePush &&
 	   this->fileHandlePush != NULL) {
 		this->lock_sync_flush_file();
@@ -1161,6 +1514,238 @@ bool pcap_file_store::destroy() {
 	return(true);
 }
 
+bool pcap_file_store::push_direct(pcap_block_store *blockStore) {
+	if(!this->directPushOpen && !this->open(typeHandlePush)) {
+		return(false);
+	}
+	size_t sizeSaveBuffer = blockStore->getSizeSaveBuffer();
+	size_t sizeWrite = cFileStoreIO::alignSize(sizeSaveBuffer);
+	u_char *saveBuffer = cFileStoreIO::alignedAlloc(sizeWrite);
+	if(!saveBuffer) {
+		syslog(LOG_ERR, "packetbuffer: write buffer allocation failed");
+		return(false);
+	}
+	blockStore->fillSaveBuffer(saveBuffer, 0, false);
+	memset(saveBuffer + sizeSaveBuffer, 0, sizeWrite - sizeSaveBuffer);
+	unsigned int usleepCounter = 0;
+	while(this->pendingWritesCount() >= this->io->getQueueDepth()) {
+		if(!this->reapWrites()) {
+			USLEEP_C(20, usleepCounter++);
+		}
+	}
+	u_int64_t position = this->fileSize;
+	cFileStoreIO::sRequest *request = new FILE_LINE(0) cFileStoreIO::sRequest;
+	request->fd = this->fd;
+	request->write = true;
+	request->buffer = saveBuffer;
+	request->length = sizeWrite;
+	request->offset = position;
+	this->lock_pending_writes();
+	this->pendingWrites.push_back(request);
+	this->unlock_pending_writes();
+	this->fileSize += sizeWrite;
+	this->io->submit(request);
+	blockStore->freeBlock();
+	blockStore->idFileStore = this->id;
+	blockStore->filePosition = position;
+	blockStore->fileSaveSize = sizeSaveBuffer;
+	++this->countPush;
+	return(true);
+}
+
+bool pcap_file_store::pop_direct(pcap_block_store *blockStore) {
+	if(!this->directPopOpen && !this->open(typeHandlePop)) {
+		return(false);
+	}
+	u_int64_t position = blockStore->filePosition;
+	size_t sizeRead = cFileStoreIO::alignSize(blockStore->fileSaveSize);
+	unsigned int usleepCounter = 0;
+	while(this->fileSizeWritten < position + sizeRead) {
+		if(!this->reapWrites()) {
+			if(!this->pendingWritesCount()) {
+				break;
+			}
+			USLEEP_C(20, usleepCounter++);
+		}
+	}
+	blockStore->destroyRestoreBuffer();
+	int rsltRestoreChunk = -1;
+	u_char *data = this->fileSizeWritten >= position + sizeRead ?
+			this->readDirect(position, sizeRead) :
+			NULL;
+	if(data) {
+		rsltRestoreChunk = blockStore->addRestoreChunk(data, blockStore->fileSaveSize, NULL, true);
+		if(rsltRestoreChunk < 0) {
+			syslog(LOG_ERR, "packetbuffer: restore block from %s failed - %s", 
+			       this->getFilePathName().c_str(),
+			       blockStore->addRestoreChunk_getErrorString(rsltRestoreChunk).c_str());
+		}
+	} else {
+		syslog(LOG_ERR, "packetbuffer: read from %s failed", this->getFilePathName().c_str());
+	}
+	++this->countPop;
+	blockStore->destroyRestoreBuffer();
+	if(this->countPop == this->countPush && this->isFull()) {
+		this->close(typeHandlePop);
+	}
+	return(rsltRestoreChunk > 0);
+}
+
+bool pcap_file_store::open_direct(eTypeHandle typeHandle) {
+	if(this->fd < 0) {
+		string filePathName = this->getFilePathName();
+		if(typeHandle & typeHandlePush) {
+			remove(filePathName.c_str());
+		}
+		this->fd = cFileStoreIO::openFile(filePathName.c_str(), &this->fdDirect, typeHandle & typeHandlePush);
+		if(this->fd < 0) {
+			syslog(LOG_ERR, "packetbuffer: open %s failed", filePathName.c_str());
+			return(false);
+		}
+		if(VERBOSE || DEBUG_VERBOSE) {
+			ostringstream outStr;
+			outStr << "open packet buffer store: " << filePathName
+			       << (this->fdDirect ? " (direct io)" : "")
+			       << " fd: " << this->fd
+			       << endl;
+			if(DEBUG_VERBOSE) {
+				cout << outStr.str();
+			} else {
+				syslog(LOG_NOTICE, "packetbuffer: %s", outStr.str().c_str());
+			}
+		}
+	}
+	if(typeHandle & typeHandlePush) {
+		this->directPushOpen = true;
+	}
+	if(typeHandle & typeHandlePop) {
+		this->directPopOpen = true;
+	}
+	return(true);
+}
+
+bool pcap_file_store::close_direct(eTypeHandle typeHandle) {
+	if(typeHandle & typeHandleAll) {
+		typeHandle = (eTypeHandle)(typeHandlePush | typeHandlePop | typeHandleAll);
+	}
+	if(typeHandle & typeHandlePush &&
+	   this->directPushOpen) {
+		unsigned int usleepCounter = 0;
+		while(this->pendingWritesCount()) {
+			if(!this->reapWrites()) {
+				USLEEP_C(20, usleepCounter++);
+			}
+		}
+		this->directPushOpen = false;
+	}
+	if(typeHandle & typeHandlePop &&
+	   this->directPopOpen) {
+		for(int i = 0; i < 2; i++) {
+			this->readWindowWait(&this->readWindow[i]);
+			if(this->readWindow[i].buffer) {
+				cFileStoreIO::alignedFree(this->readWindow[i].buffer);
+			}
+			this->readWindow[i] = sReadWindow();
+		}
+		this->directPopOpen = false;
+	}
+	if(this->fd >= 0 &&
+	   (typeHandle & typeHandleAll ||
+	    (!this->directPushOpen && !this->directPopOpen && this->full))) {
+		::close(this->fd);
+		this->fd = -1;
+	}
+	return(true);
+}
+
+bool pcap_file_store::reapWrites() {
+	bool rslt = false;
+	this->lock_pending_writes();
+	while(this->pendingWrites.size() && this->pendingWrites.front()->done) {
+		cFileStoreIO::sRequest *request = this->pendingWrites.front();
+		this->pendingWrites.pop_front();
+		if(request->result != (ssize_t)request->length) {
+			syslog(LOG_ERR, "packetbuffer: write to %s failed", this->getFilePathName().c_str());
+		}
+		this->fileSizeWritten = request->offset + request->length;
+		cFileStoreIO::alignedFree(request->buffer);
+		delete request;
+		rslt = true;
+	}
+	this->unlock_pending_writes();
+	return(rslt);
+}
+
+size_t pcap_file_store::pendingWritesCount() {
+	this->lock_pending_writes();
+	size_t count = this->pendingWrites.size();
+	this->unlock_pending_writes();
+	return(count);
+}
+
+u_char *pcap_file_store::readDirect(u_int64_t position, size_t size) {
+	extern u_int64_t opt_pcap_queue_file_readahead;
+	size_t readahead = cFileStoreIO::alignSize(opt_pcap_queue_file_readahead);
+	sReadWindow *window = &this->readWindow[this->readWindowActive];
+	if(!(window->valid &&
+	     position >= window->offset && position + size <= window->offset + window->length)) {
+		sReadWindow *next = &this->readWindow[this->readWindowActive ^ 1];
+		this->readWindowWait(next);
+		if(next->valid &&
+		   position >= next->offset && position + size <= next->offset + next->length) {
+			this->readWindowActive ^= 1;
+			window = next;
+		} else {
+			this->readWindowSubmit(window, position, max(size, min(readahead, (size_t)(this->fileSizeWritten - position))));
+			this->readWindowWait(window);
+			if(!window->valid) {
+				return(NULL);
+			}
+		}
+	}
+	// read ahead of next window
+	sReadWindow *next = &this->readWindow[this->readWindowActive ^ 1];
+	u_int64_t nextOffset = window->offset + window->length;
+	if(readahead && !next->pending &&
+	   !(next->valid && next->offset == nextOffset) &&
+	   nextOffset < this->fileSizeWritten) {
+		this->readWindowSubmit(next, nextOffset, min(readahead, (size_t)(this->fileSizeWritten - nextOffset)));
+	}
+	return(window->buffer + (position - window->offset));
+}
+
+void pcap_file_store::readWindowSubmit(sReadWindow *window, u_int64_t offset, size_t length) {
+	if(window->bufferSize < length) {
+		if(window->buffer) {
+			cFileStoreIO::alignedFree(window->buffer);
+		}
+		window->buffer = cFileStoreIO::alignedAlloc(length);
+		window->bufferSize = window->buffer ? length : 0;
+		if(!window->buffer) {
+			window->valid = false;
+			return;
+		}
+	}
+	window->offset = offset;
+	window->length = length;
+	window->valid = false;
+	window->pending = true;
+	window->request.fd = this->fd;
+	window->request.write = false;
+	window->request.buffer = window->buffer;
+	window->request.length = length;
+	window->request.offset = offset;
+	this->io->submit(&window->request);
+}
+
+void pcap_file_store::readWindowWait(sReadWindow *window) {
+	if(window->pending) {
+		this->io->wait(&window->request);
+		window->pending = false;
+		window->valid = window->request.result == (ssize_t)window->length;
+	}
+}
+
 string pcap_file_store::getFilePathName() {
 	char filePathName[this->folder.length() + 100];
 	sprintf(filePathName, TEST_DEBUG_PARAMS ? "%s/pcap_store_mx_%010u" : "%s/pcap_store_%010u", this->folder.c_str(), this->id);
@@ -1176,9 +1761,15 @@ pcap_store_queue::pcap_store_queue(const char *fileStoreFolder) {
 	this->cleanupFileStoreCounter = 0;
 	this->lastTimeLogErrDiskIsFull = 0;
 	this->lastTimeLogErrMemoryIsFull = 0;
+	this->fileStoreIO = NULL;
 	if(fileStoreFolder && fileStoreFolder[0] && access(fileStoreFolder, F_OK ) == -1) {
 		mkdir_r(fileStoreFolder, 0700);
 	}
+	if(opt_pcap_queue_file_io != cFileStoreIO::_fsio_buffered &&
+	   opt_pcap_queue_store_queue_max_disk_size &&
+	   fileStoreFolder && fileStoreFolder[0]) {
+		this->fileStoreIO = new FILE_LINE(0) cFileStoreIO((cFileStoreIO::eType)opt_pcap_queue_file_io, opt_pcap_queue_file_io_threads);
+	}
 }
 
 pcap_store_queue::~pcap_store_queue() {
@@ -1194,6 +1785,9 @@ pcap_store_queue::~pcap_store_queue() {
 		delete blockStore;
 		this->queueStore.pop_front();
 	}
+	if(this->fileStoreIO) {
+		delete this->fileStoreIO;
+	}
 }
 
 bool pcap_store_queue::push(pcap_block_store *blockStore, bool deleteBlockStoreIfFail) {
@@ -1243,7 +1837,7 @@ bool pcap_store_queue::push(pcap_block_store *blockStore, bool deleteBlockStoreI
 			if(!this->lastFileStoreId) {
 				++this->lastFileStoreId;
 			}
-			fileStore = new FILE_LINE(15023) pcap_file_store(this->lastFileStoreId, this->fileStoreFolder.c_str());
+			fileStore = new FILE_LINE(15023) pcap_file_store(this->lastFileStoreId, this->fileStoreFolder.c_str(), this->fileStoreIO);
 			this->fileStore.push_back(fileStore);
 		} else {
 			fileStore = this->fileStore[this->fileStore.size() - 1];
@@ -1381,11 +1975,20 @@ void pcap_store_queue::memoryBufferIsFull_log() {
 void pcap_store_queue::diskBufferIsFull_log() {
 	u_int64_t actTime = getTimeMS();
 	if(actTime - 1000 > this->lastTimeLogErrDiskIsFull) {
-		syslog(LOG_ERR, "packetbuffer: DISK IS FULL");
+		string ioStat = this->getFileStoreIOStatString(false);
+		if(ioStat.length()) {
+			syslog(LOG_ERR, "packetbuffer: DISK IS FULL (spill %s)", ioStat.c_str());
+		} else {
+			syslog(LOG_ERR, "packetbuffer: DISK IS FULL");
+		}
 		this->lastTimeLogErrDiskIsFull = actTime;
 	}
 }
 
+string pcap_store_queue::getFileStoreIOStatString(bool reset) {
+	return(this->fileStoreIO ? this->fileStoreIO->getStatString(reset) : "");
+}
+
 
 PcapQueue::PcapQueue(eTypeQueue typeQueue, const char *nameQueue) {
 	this->typeQueue = typeQueue;
@@ -2160,11 +2763,20 @@ void PcapQueue::pcapStat(int statPeriod, bool statCalls) {
 		if(diskBufferMb >= 0) {
 			double diskBufferPerc = this->pcapStat_get_disk_buffer_perc();
 			outStr << "fileq[" << setprecision(1) << diskBufferMb << "MB "
-			       << setprecision(1) << diskBufferPerc << "%] ";
+			       << setprecision(1) << diskBufferPerc << "%";
+			string diskBufferIO = this->pcapStat_get_disk_buffer_io();
+			if(diskBufferIO.length()) {
+				outStr << " " << diskBufferIO;
+			}
+			outStr << "] ";
 		}
 		double compress = this->pcapStat_get_compress();
 		if(compress >= 0) {
-			outStr << "comp[" << setprecision(0) << compress << "] ";
+			outStr << "comp[" << setprecision(0) << compress;
+			if(opt_pcap_queue_compress_method == pcap_block_store::compress_method_adaptive) {
+				outStr << this->pcapStatString_compress_methods();
+			}
+			outStr << "] ";
 		}
 		double speed = this->pcapStat_get_speed_mb_s(statPeriod);
 		if(speed >= 0) {
@@ -2242,6 +2854,7 @@ void PcapQueue::pcapStat(int statPeriod, bool statCalls) {
 			outStrStat << "t0CPU[" << setprecision(1) << t0cpu;
 			if(t0cpuWrite >= 0) {
 				outStrStat << "/" << setprecision(1) << t0cpuWrite;
+				outStrStat << this->instancePcapHandle->pcapStatString_qring();
 			}
 			for(int i = 0; i < PCAP_QUEUE_NEXT_THREADS_MAX; i++) {
 				if(t0cpuNextThreads[i] >= 0) {
@@ -2280,6 +2893,7 @@ void PcapQueue::pcapStat(int statPeriod, bool statCalls) {
 			if (opt_rrd) {
 				rrd_set_value(RRD_VALUE_tCPU_t1, t1cpu);
 			}
+			buffersControl.set__pb_compress_cpu_perc(t1cpu);
 		}
 	}
 	if(sverb.log_profiler) {
@@ -2334,6 +2948,10 @@ void PcapQueue::pcapStat(int statPeriod, bool statCalls) {
 				double dedup_cpu = pcapQueueQ_outThread_dedup->getCpuUsagePerc(true);
 				if(dedup_cpu >= 0) {
 					outStrStat << "/dedup:" << setprecision(1) << dedup_cpu;
+					double dedup_duplicates_perc = pcapQueueQ_outThread_dedup->getDedupDuplicatesPerc();
+					if(dedup_duplicates_perc > 0) {
+						outStrStat << "d" << dedup_duplicates_perc;
+					}
 				}
 			}
 			if(pcapQueueQ_outThread_detach2) {
@@ -2747,6 +3365,12 @@ void PcapQueue::pcapStat(int statPeriod, bool statCalls) {
 			}
 		}
 	}
+	if(opt_packet_latency_sample) {
+		string latency = packetLatency.getStatString();
+		if(!latency.empty()) {
+			outStrStat << "LAT[" << latency << "]ms ";
+		}
+	}
 	outStrStat << "RSS/VSZ[";
 	long unsigned int rss = this->getRssUsage(true);
 	if(rss > 0) {
@@ -3117,6 +3741,27 @@ string PcapQueue::pcapStatString_packets(int statPeriod) {
 	return(outStr.str());
 }
 
+string PcapQueue::pcapStatString_compress_methods() {
+	static unsigned long lastBlocksCompressMethod[pcap_block_store::compress_method_adaptive];
+	static const char *methodsAbbr[pcap_block_store::compress_method_adaptive] = { NULL, "s", "l", "h", "z" };
+	unsigned long diff[pcap_block_store::compress_method_adaptive];
+	unsigned long sum = 0;
+	for(unsigned i = 1; i < pcap_block_store::compress_method_adaptive; i++) {
+		diff[i] = sumBlocksCompressMethod[i] - lastBlocksCompressMethod[i];
+		lastBlocksCompressMethod[i] = sumBlocksCompressMethod[i];
+		sum += diff[i];
+	}
+	ostringstream outStr;
+	if(sum) {
+		for(unsigned i = 1; i < pcap_block_store::compress_method_adaptive; i++) {
+			if(diff[i]) {
+				outStr << " " << methodsAbbr[i] << ":" << (diff[i] * 100 / sum) << "%";
+			}
+		}
+	}
+	return(outStr.str());
+}
+
 double PcapQueue::pcapStat_get_compress() {
 	if(sumPacketsSizeCompress[0] && sumPacketsSize[0]) {
 		return(100.0 * sumPacketsSizeCompress[0] / sumPacketsSize[0]);
@@ -3285,6 +3930,9 @@ PcapQueue_readFromInterface_base::PcapQueue_readFromInterface_base(const char *i
 	this->pcapHandleIndex = 0;
 	this->pcapEnd = false;
 	this->dpdkHandle = NULL;
+	this->tpacketHandle = NULL;
+	this->xdpHandle = NULL;
+	this->interfaceReadThreads = 1;
 	memset(&this->filterData, 0, sizeof(this->filterData));
 	this->filterDataUse = false;
 	this->pcapDumpHandle = NULL;
@@ -3339,6 +3987,12 @@ PcapQueue_readFromInterface_base::~PcapQueue_readFromInterface_base() {
 	if(this->dpdkHandle) {
 		destroy_dpdk_handle(this->dpdkHandle);
 	}
+	if(this->tpacketHandle) {
+		destroy_tpacket_handle(this->tpacketHandle);
+	}
+	if(this->xdpHandle) {
+		destroy_xdp_handle(this->xdpHandle);
+	}
 	if(filter_ip) {
 		delete filter_ip;
 	}
@@ -3348,7 +4002,7 @@ void PcapQueue_readFromInterface_base::setInterfaceName(const char *interfaceNam
 	this->interfaceName = interfaceName;
 }
 
-bool PcapQueue_readFromInterface_base::startCapture(string *error, sDpdkConfig *dpdkConfig) {
+bool PcapQueue_readFromInterface_base::startCapture(string *error, sDpdkConfig *dpdkConfig, sTpacketConfig *tpacketConfig, sXdpConfig *xdpConfig) {
 	*error = "";
 	static volatile int _sync_start_capture = 0;
 	long unsigned int rssBeforeActivate, rssAfterActivate;
@@ -3406,6 +4060,81 @@ bool PcapQueue_readFromInterface_base::startCapture(string *error, sDpdkConfig *
 			this->dpdkHandle = NULL;
 		}
 	}
+	if(xdpConfig && xdpConfig->device[0]) {
+		this->xdpHandle = create_xdp_handle();
+		if(this->xdpHandle && !xdp_activate(xdpConfig, this->xdpHandle, error)) {
+			if(*user_filter != '\0') {
+				struct bpf_program fp;
+				if(!this->compileUserFilterEthernet(&fp, errorstr, sizeof(errorstr))) {
+					goto failed;
+				}
+				string filterError;
+				int setfilterRslt = xdp_setfilter(this->xdpHandle, &fp, &filterError);
+				pcap_freecode(&fp);
+				if(setfilterRslt != 0) {
+					snprintf(errorstr, sizeof(errorstr), "packetbuffer - %s: can not install filter: %s", this->getInterfaceName().c_str(), filterError.c_str());
+					goto failed;
+				}
+			}
+			this->pcapLinklayerHeaderType = DLT_EN10MB;
+			global_pcap_dlink = this->pcapLinklayerHeaderType;
+			__sync_lock_release(&_sync_start_capture);
+			return(true);
+		} else {
+			if(this->xdpHandle) {
+				destroy_xdp_handle(this->xdpHandle);
+				this->xdpHandle = NULL;
+			}
+			if(this->interfaceReadThreads > 1) {
+				// each read thread would open its own libpcap handle and capture every packet
+				snprintf(errorstr, sizeof(errorstr), "packetbuffer - %s: %s - libpcap fallback is not possible with %i read threads per interface (xdp_queues)", 
+					 this->getInterfaceName().c_str(), error->empty() ? "xdp activate failed" : error->c_str(), this->interfaceReadThreads);
+				goto failed;
+			}
+			if(!error->empty()) {
+				syslog(LOG_ERR, "%s - use libpcap", error->c_str());
+				*error = "";
+			}
+		}
+	}
+	if(tpacketConfig && tpacketConfig->device[0]) {
+		this->tpacketHandle = create_tpacket_handle();
+		if(this->tpacketHandle && !tpacket_activate(tpacketConfig, this->tpacketHandle, error)) {
+			if(*user_filter != '\0') {
+				// filter is attached to the packet socket
+				struct bpf_program fp;
+				if(!this->compileUserFilterEthernet(&fp, errorstr, sizeof(errorstr))) {
+					goto failed;
+				}
+				string filterError;
+				int setfilterRslt = tpacket_setfilter(this->tpacketHandle, &fp, &filterError);
+				pcap_freecode(&fp);
+				if(setfilterRslt != 0) {
+					snprintf(errorstr, sizeof(errorstr), "packetbuffer - %s: can not install filter: %s", this->getInterfaceName().c_str(), filterError.c_str());
+					goto failed;
+				}
+			}
+			this->pcapLinklayerHeaderType = DLT_EN10MB;
+			global_pcap_dlink = this->pcapLinklayerHeaderType;
+			__sync_lock_release(&_sync_start_capture);
+			return(true);
+		} else {
+			if(this->tpacketHandle) {
+				destroy_tpacket_handle(this->tpacketHandle);
+				this->tpacketHandle = NULL;
+			}
+			if(this->interfaceReadThreads > 1) {
+				// each read thread would open its own libpcap handle and capture every packet
+				snprintf(errorstr, sizeof(errorstr), "packetbuffer - %s: %s - libpcap fallback is not possible with %i read threads per interface (tpacket_fanout_threads)", 
+					 this->getInterfaceName().c_str(), error->empty() ? "tpacket activate failed" : error->c_str(), this->interfaceReadThreads);
+				goto failed;
+			}
+			if(!error->empty()) {
+				syslog(LOG_ERR, "%s - use libpcap", error->c_str());
+				*error = "";
+			}
+		}
+	}
 	if(pcap_lookupnet(this->interfaceName.c_str(), &this->interfaceNet, &this->interfaceMask, errbuf) == -1) {
 		this->interfaceMask = PCAP_NETMASK_UNKNOWN;
 	}
@@ -3524,6 +4253,20 @@ failed:
 	return(false);
 }
 
+bool PcapQueue_readFromInterface_base::compileUserFilterEthernet(bpf_program *fp, char *errorstr, unsigned errorstr_size) {
+	// capture without libpcap handle (tpacket, xdp) - filter is compiled for ethernet
+	pcap_t *deadHandle = pcap_open_dead(DLT_EN10MB, this->pcap_snaplen);
+	if(pcap_compile(deadHandle, fp, user_filter, 0, PCAP_NETMASK_UNKNOWN) == -1) {
+		char user_filter_err[2048];
+		snprintf(user_filter_err, sizeof(user_filter_err), "%.2000s%s", user_filter, strlen(user_filter) > 2000 ? "..." : "");
+		snprintf(errorstr, errorstr_size, "packetbuffer - %s: can not parse filter %s: %s", this->getInterfaceName().c_str(), user_filter_err, pcap_geterr(deadHandle));
+		pcap_close(deadHandle);
+		return(false);
+	}
+	pcap_close(deadHandle);
+	return(true);
+}
+
 inline int PcapQueue_readFromInterface_base::pcap_next_ex_iface(pcap_t *pcapHandle, pcap_pkthdr** header, u_char** packet,
 								bool checkProtocol, sCheckProtocolData *checkProtocolData) {
 	if(!pcapHandle) {
@@ -3584,6 +4327,9 @@ inline int PcapQueue_readFromInterface_base::pcap_next_ex_iface(pcap_t *pcapHand
 			}
 		}
 		if(res == -2) {
+			if(replayBenchmark) {
+				replayBenchmark->setReadEnd(packets_counter);
+			}
 			return(-1);
 		}
 	} else if(res == 0) {
@@ -3608,6 +4354,9 @@ inline int PcapQueue_readFromInterface_base::pcap_next_ex_iface(pcap_t *pcapHand
 			(*header)->caplen = (*header)->len;
 		}
 		++packets_counter;
+		if(packets_counter == 1 && replayBenchmark) {
+			replayBenchmark->setStart();
+		}
 		if(opt_pb_read_from_file_time_adjustment) {
 			u_int64_t packetTime = getTimeUS(*header);
 			packetTime += opt_pb_read_from_file_time_adjustment * 1000000ull;
@@ -3959,13 +4708,57 @@ string PcapQueue_readFromInterface_base::pcapStatString_interface(int /*statPeri
 			this->last_ps = ps;
 			outStr << dpdk_stats_str_rslt << endl;
 		}
+	} else if(this->xdpHandle) {
+		pcap_stat ps;
+		string xdp_stats_str_rslt;
+		int pcapstatres = pcap_xdp_stats(this->xdpHandle, &ps, &xdp_stats_str_rslt);
+		if(pcapstatres == 0) {
+			if(ps.ps_recv >= this->last_ps.ps_recv &&
+			   (ps.ps_drop > this->last_ps.ps_drop || ps.ps_ifdrop > this->last_ps.ps_ifdrop)) {
+				pcap_drop_flag = 1;
+				++this->countPacketDrop;
+				u_int64_t rx = ps.ps_recv - this->last_ps.ps_recv;
+				outStr << fixed
+				       << "DROPPED PACKETS - " << this->getInterfaceName() << ": "
+				       << "xdp socket dropped some packets!"
+				       << " rx:" << rx
+				       << " pcapdrop:" << (ps.ps_drop - this->last_ps.ps_drop) << " " 
+				       << setprecision(1) << (rx ? (double)(ps.ps_drop - this->last_ps.ps_drop) / rx * 100 : 0) << "%%"
+				       << " fill ring empty:" << (ps.ps_ifdrop - this->last_ps.ps_ifdrop)
+				       << endl
+				       << "     increase --ring-buffer"
+				       << endl;
+			}
+			this->last_ps = ps;
+			outStr << xdp_stats_str_rslt << endl;
+		}
+	} else if(this->tpacketHandle) {
+		pcap_stat ps;
+		int pcapstatres = pcap_tpacket_stats(this->tpacketHandle, &ps);
+		if(pcapstatres == 0) {
+			if(ps.ps_recv >= this->last_ps.ps_recv &&
+			   ps.ps_drop > this->last_ps.ps_drop) {
+				pcap_drop_flag = 1;
+				++this->countPacketDrop;
+				outStr << fixed
+				       << "DROPPED PACKETS - " << this->getInterfaceName() << ": "
+				       << "tpacket ring dropped some packets!"
+				       << " rx:" << (ps.ps_recv - this->last_ps.ps_recv)
+				       << " pcapdrop:" << (ps.ps_drop - this->last_ps.ps_drop) << " " 
+				       << setprecision(1) << (ps.ps_recv > this->last_ps.ps_recv ? (double)(ps.ps_drop - this->last_ps.ps_drop) / (ps.ps_recv - this->last_ps.ps_recv) * 100 : 0) << "%%"
+				       << endl
+				       << "     increase --ring-buffer or use tpacket_fanout"
+				       << endl;
+			}
+			this->last_ps = ps;
+		}
 	}
 	return(outStr.str());
 }
 
 string PcapQueue_readFromInterface_base::pcapDropCountStat_interface() {
 	ostringstream outStr;
-	if(this->pcapHandle || this->dpdkHandle) {
+	if(this->pcapHandle || this->dpdkHandle || this->tpacketHandle || this->xdpHandle) {
 		outStr << this->getInterfaceName(true) << " : " << "pdropsCount [" << this->countPacketDrop << "]";
 		pcap_stat ps;
 		int pcapstatres = 1;
@@ -3973,6 +4766,10 @@ string PcapQueue_readFromInterface_base::pcapDropCountStat_interface() {
 			pcapstatres = pcap_stats(this->pcapHandle, &ps);
 		} else if(this->dpdkHandle) {
 			pcapstatres = pcap_dpdk_stats(this->dpdkHandle, &ps);
+		} else if(this->tpacketHandle) {
+			pcapstatres = pcap_tpacket_stats(this->tpacketHandle, &ps);
+		} else if(this->xdpHandle) {
+			pcapstatres = pcap_xdp_stats(this->xdpHandle, &ps);
 		}
 		if(pcapstatres == 0) {
 			outStr << " pcapdrop [" << ps.ps_drop << "]"
@@ -3996,9 +4793,13 @@ string PcapQueue_readFromInterface_base::getStatPacketDrop() {
 }
 
 void PcapQueue_readFromInterface_base::initStat_interface() {
-	if(this->pcapHandle) {
+	if(this->pcapHandle || this->tpacketHandle || this->xdpHandle) {
 		pcap_stat ps;
-		int pcapstatres = pcap_stats(this->pcapHandle, &ps);
+		int pcapstatres = this->pcapHandle ?
+				   pcap_stats(this->pcapHandle, &ps) :
+				  this->tpacketHandle ?
+				   pcap_tpacket_stats(this->tpacketHandle, &ps) :
+				   pcap_xdp_stats(this->xdpHandle, &ps);
 		if(pcapstatres == 0) {
 			this->last_ps = ps;
 		}
@@ -4055,9 +4856,21 @@ void PcapQueue_readFromInterface_base::terminatingAtEndOfReadPcap() {
 			++sleepCounter;
 		}
 	} else {
+		unsigned waitCounter = 0;
 		while(buffersControl.getPerc_pb_used() > 0.1) {
-			syslog(LOG_NOTICE, "wait for processing packetbuffer (%.1lf%%)", buffersControl.getPerc_pb_used());
-			sleep(1);
+			// benchmark waits in short steps so that the end of processing is measured accurately
+			if(!replayBenchmark || !(waitCounter % 100)) {
+				syslog(LOG_NOTICE, "wait for processing packetbuffer (%.1lf%%)", buffersControl.getPerc_pb_used());
+			}
+			if(replayBenchmark) {
+				USLEEP(10000);
+			} else {
+				sleep(1);
+			}
+			++waitCounter;
+		}
+		if(replayBenchmark) {
+			replayBenchmark->setProcessEnd();
 		}
 		int sleepTimeBeforeCleanup = opt_time_to_terminate > 0 ? (opt_time_to_terminate / 2) :
 					     opt_enable_ssl ? 10 :
@@ -4087,6 +4900,9 @@ void PcapQueue_readFromInterface_base::terminatingAtEndOfReadPcap() {
 				--sleepTimeAfterCleanup;
 			}
 		}
+		if(replayBenchmark) {
+			replayBenchmark->report();
+		}
 		vm_terminate();
 	}
 }
@@ -4610,8 +5426,49 @@ void *PcapQueue_readFromInterfaceThread::threadFunction(void */*arg*/, unsigned
 				this->pcapProcessThread = new FILE_LINE(15044) PcapQueue_readFromInterfaceThread(this->interfaceName.c_str(), pcap_process, this, this, this->parent);
 			}
 		}
+		sTpacketConfig tpacketConfig;
+		if(opt_pcap_queue_use_blocks && opt_use_tpacket && !opt_use_dpdk && !opt_pb_read_from_file[0]) {
+			extern int opt_ringbuffer;
+			strcpy_null_term(tpacketConfig.device, this->interfaceName.c_str());
+			tpacketConfig.snaplen = this->pcap_snaplen;
+			tpacketConfig.promisc = this->pcap_promisc;
+			tpacketConfig.ring_size = opt_ringbuffer * 1024 * 1024;
+			tpacketConfig.block_size = opt_tpacket_block_size * 1024;
+			tpacketConfig.block_timeout_ms = opt_tpacket_block_timeout;
+			if(opt_tpacket_fanout) {
+				tpacketConfig.fanout_mode = (eTpacketFanoutMode)opt_tpacket_fanout;
+				tpacketConfig.fanout_group_id = tpacket_fanout_group_id(tpacketConfig.device);
+			}
+			// packetbuffer blocks referencing the ring can not be compressed or stored to disk
+			tpacketConfig.zerocopy = opt_tpacket_zerocopy && 
+						 !opt_pcap_queue_compress && 
+						 !opt_pcap_queue_store_queue_max_disk_size;
+			tpacketConfig.zerocopy_max_held_perc = 75;
+		}
+		sXdpConfig xdpConfig;
+		if(opt_pcap_queue_use_blocks && opt_use_xdp && !opt_use_dpdk && !opt_pb_read_from_file[0]) {
+			extern int opt_ringbuffer;
+			strcpy_null_term(xdpConfig.device, this->interfaceName.c_str());
+			xdpConfig.snapshot = this->pcap_snaplen;
+			xdpConfig.promisc = this->pcap_promisc;
+			xdpConfig.frame_size = opt_xdp_frame_size;
+			xdpConfig.frames = (u_int64_t)opt_ringbuffer * 1024 * 1024 / opt_xdp_frame_size;
+			xdpConfig.attach_mode = (eXdpAttachMode)opt_xdp_attach_mode;
+			xdpConfig.bind_mode = (eXdpBindMode)opt_xdp_bind_mode;
+			// packetbuffer blocks referencing umem frames can not be compressed or stored to disk
+			xdpConfig.frames_in_packetbuffer = opt_xdp_frames_in_packetbuffer && 
+							   !opt_pcap_queue_compress && 
+							   !opt_pcap_queue_store_queue_max_disk_size;
+			xdpConfig.frames_max_held_perc = 75;
+			xdpConfig.read_timeout_ms = 10;
+			dispatch_data.me = this;
+			xdpConfig.callback.packet_user = &dispatch_data;
+			xdpConfig.callback.packet_allocation = _dpdk_packet_allocation;
+			xdpConfig.callback.packet_completion = _dpdk_packet_completion;
+			xdpConfig.callback.packet_process__mbufs_in_packetbuffer = _xdp_packet_process__frames_in_packetbuffer;
+		}
 		string error;
-		if(this->startCapture(&error, &dpdkConfig)) {
+		if(this->startCapture(&error, &dpdkConfig, &tpacketConfig, &xdpConfig)) {
 			if(this->dpdkHandle && dpdk_config(this->dpdkHandle)->type_worker_thread == _dpdk_twt_std) {
 				this->dpdkWorkerThread = new FILE_LINE(0) PcapQueue_readFromInterfaceThread(this->interfaceName.c_str(), dpdk_worker, this, this, this->parent);
 			}
@@ -5350,6 +6207,28 @@ void PcapQueue_readFromInterfaceThread::dpdk_packet_process__mbufs_in_packetbuff
 	}
 }
 
+void PcapQueue_readFromInterfaceThread::_xdp_packet_process__frames_in_packetbuffer(void *user, pcap_pkthdr *pcap_header, void *packet) {
+	PcapQueue_readFromInterfaceThread::pcap_dispatch_data *dd = (PcapQueue_readFromInterfaceThread::pcap_dispatch_data*)user;
+	dd->me->xdp_packet_process__frames_in_packetbuffer(dd, pcap_header, (u_char*)packet);
+}
+
+void PcapQueue_readFromInterfaceThread::xdp_packet_process__frames_in_packetbuffer(pcap_dispatch_data *dd, pcap_pkthdr *pcap_header, u_char *packet) {
+	pcap_pkthdr_plus2 pcap_header_plus2;
+	if(!this->tpacket_fill_header(pcap_header, packet, &pcap_header_plus2, &dd->checkProtocolData)) {
+		xdp_frames_release(xdp_umem(xdpHandle), &packet, 1);
+		return;
+	}
+	if(!dd->frames_block) {
+		dd->frames_block = new FILE_LINE(0) pcap_block_store(pcap_block_store::plus2, true);
+	}
+	// block holds at most 1/8 of umem so that blocks waiting in packetbuffer do not exhaust the fill ring
+	dd->frames_block->add_xdp_frame(&pcap_header_plus2, packet, xdp_umem(xdpHandle), xdp_config(xdpHandle)->frames / 8);
+	if(dd->frames_block->is_dpkd_data_full()) {
+		this->push_block(dd->frames_block);
+		dd->frames_block = NULL;
+	}
+}
+
 #define DEBUG_threadFunction_blocks_LAG 0
 
 void PcapQueue_readFromInterfaceThread::threadFunction_blocks() {
@@ -5486,6 +6365,14 @@ void PcapQueue_readFromInterfaceThread::threadFunction_blocks() {
 			}
 			this->threadTerminated = true;
 			return;
+		} else if(xdpHandle) {
+			threadFunction_blocks_xdp();
+			this->threadTerminated = true;
+			return;
+		} else if(tpacketHandle) {
+			threadFunction_blocks_tpacket();
+			this->threadTerminated = true;
+			return;
 		} else if(opt_t2_boost_pcap_dispatch) {
 			dispatch_data.me = this;
 			unsigned counter_zero_packets = 0;
@@ -5705,6 +6592,119 @@ void PcapQueue_readFromInterfaceThread::pcap_dispatch_handler(pcap_dispatch_data
 	dd->block->inc_h(dd->pcap_header_plus2);
 }
 
+void PcapQueue_readFromInterfaceThread::threadFunction_blocks_tpacket() {
+	sTpacketBlock ringBlock;
+	pcap_pkthdr header;
+	u_char *packet;
+	pcap_pkthdr_plus2 ringHeader;
+	pcap_pkthdr_plus2 *pcap_header_plus2 = NULL;
+	u_char *pcap_packet = NULL;
+	pcap_block_store *block = NULL;
+	sCheckProtocolData checkProtocolData;
+	while(!(is_terminating() || this->threadDoTerminate)) {
+		if(!tpacket_read_block(tpacketHandle, &ringBlock, 50)) {
+			if(block && block->count && (force_push || block->isTimeout())) {
+				this->push_block(block);
+				block = NULL;
+				force_push = false;
+			}
+			continue;
+		}
+		if(tpacket_zerocopy_enable(tpacketHandle)) {
+			// ring block is referenced by packetbuffer block and returned to kernel when the block is destroyed
+			if(block) {
+				if(block->count) {
+					this->push_block(block);
+				} else {
+					delete block;
+				}
+				block = NULL;
+			}
+			pcap_block_store *ringBlockStore = new FILE_LINE(0) pcap_block_store(pcap_block_store::plus2, true);
+			while(tpacket_block_next_packet(&ringBlock, &header, &packet)) {
+				if(this->tpacket_fill_header(&header, packet, &ringHeader, &checkProtocolData)) {
+					ringBlockStore->add_ring_packet(&ringHeader, packet, ringBlock.packets_count);
+				}
+			}
+			if(ringBlockStore->count) {
+				ringBlockStore->set_ring_block(ringBlock.ring_block);
+				this->push_block(ringBlockStore);
+			} else {
+				delete ringBlockStore;
+				tpacket_release_block(&ringBlock);
+			}
+			force_push = false;
+		} else {
+			while(tpacket_block_next_packet(&ringBlock, &header, &packet)) {
+				while(!block ||
+				      !block->get_add_hp_pointers(&pcap_header_plus2, &pcap_packet, pcap_snaplen) ||
+				      (block->count && force_push)) {
+					if(block) {
+						this->push_block(block);
+					}
+					block = new FILE_LINE(0) pcap_block_store(pcap_block_store::plus2);
+					force_push = false;
+				}
+				if(this->tpacket_fill_header(&header, packet, pcap_header_plus2, &checkProtocolData)) {
+					memcpy(pcap_packet, packet, header.caplen);
+					block->inc_h(pcap_header_plus2);
+				}
+			}
+			tpacket_release_block(&ringBlock);
+		}
+	}
+	if(block) {
+		delete block;
+	}
+}
+
+void PcapQueue_readFromInterfaceThread::threadFunction_blocks_xdp() {
+	while(!(is_terminating() || this->threadDoTerminate)) {
+		xdp_read_proc(xdpHandle);
+		// copied packets are in dispatch_data.block, referenced umem frames in dispatch_data.frames_block
+		pcap_block_store **blocks[] = { &dispatch_data.block, &dispatch_data.frames_block };
+		for(unsigned i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+			if(*blocks[i] && (*blocks[i])->count && (force_push || (*blocks[i])->isTimeout())) {
+				this->push_block(*blocks[i]);
+				*blocks[i] = NULL;
+			}
+		}
+		force_push = false;
+	}
+	if(dispatch_data.block) {
+		delete dispatch_data.block;
+	}
+	if(dispatch_data.frames_block) {
+		delete dispatch_data.frames_block;
+	}
+}
+
+inline bool PcapQueue_readFromInterfaceThread::tpacket_fill_header(pcap_pkthdr *header, u_char *packet, pcap_pkthdr_plus2 *pcap_header_plus2,
+								   sCheckProtocolData *checkProtocolData) {
+	if(opt_pcap_queue_use_blocks_read_check || filter_ip) {
+		if(!check_protocol(header, packet, checkProtocolData) ||
+		   !check_filter_ip(header, packet, checkProtocolData)) {
+			return(false);
+		}
+	}
+	sumPacketsSize[0] += header->caplen;
+	pcap_header_plus2->clear();
+	if(opt_pcap_queue_use_blocks_read_check) {
+		pcap_header_plus2->detect_headers = 0x01;
+		pcap_header_plus2->header_ip_encaps_offset = checkProtocolData->header_ip_offset;
+		pcap_header_plus2->header_ip_offset = checkProtocolData->header_ip_offset;
+		pcap_header_plus2->eth_protocol = checkProtocolData->protocol;
+		pcap_header_plus2->pid.vlan = checkProtocolData->vlan;
+		pcap_header_plus2->pid.flags = 0;
+	} else {
+		pcap_header_plus2->header_ip_encaps_offset = 0;
+		pcap_header_plus2->header_ip_offset = 0;
+	}
+	pcap_header_plus2->convertFromStdHeader(header);
+	pcap_header_plus2->dlink = pcapLinklayerHeaderType;
+	return(true);
+}
+
 void PcapQueue_readFromInterfaceThread::processBlock(pcap_block_store *block) {
 	unsigned counter = 0;
 	int ppf = 0;
@@ -5878,14 +6878,23 @@ PcapQueue_readFromInterface::PcapQueue_readFromInterface(const char *nameQueue)
 	   !opt_pcap_queue_suppress_t1_thread &&
 	   !opt_pcap_queue_use_blocks) {
 		this->setEnableWriteThread();
-		extern volatile int terminating;
-		this->block_qring = new FILE_LINE(15046) rqueue_quick<pcap_block_store*>(
+		this->block_qring = new FILE_LINE(15046) rqueue_ring<pcap_block_store*>(
 			100,
 			100, 100,
-			&terminating, true);
+			NULL, true);
+		// wait in ring ends on the same condition as the thread loops (TERMINATING)
+		this->block_qring->setTermCheck(block_qring_term_check, this);
 	}
 }
 
+bool PcapQueue_readFromInterface::block_qring_term_check(void *queue) {
+	return(((PcapQueue_readFromInterface*)queue)->isTerminating());
+}
+
+bool PcapQueue_readFromInterface::isTerminating() {
+	return(TERMINATING);
+}
+
 PcapQueue_readFromInterface::~PcapQueue_readFromInterface() {
 	pthread_join(this->threadHandle, NULL);
 	if(this->writeThreadHandle) {
@@ -5922,10 +6931,21 @@ bool PcapQueue_readFromInterface::init() {
 		return(true);
 	}
 	vector<string> interfaces = split(this->interfaceName.c_str(), split(",|;| |\t|\r|\n", "|"), true);
+	// with tpacket fanout several read threads share one interface
+	int threadsPerInterface = opt_use_tpacket && opt_pcap_queue_use_blocks && !opt_use_dpdk && 
+				  opt_tpacket_fanout && opt_tpacket_fanout_threads > 1 ?
+				   opt_tpacket_fanout_threads : 1;
 	for(size_t i = 0; i < interfaces.size(); i++) {
-		if(this->readThreadsCount < READ_THREADS_MAX - 1) {
-			this->readThreads[this->readThreadsCount] = new FILE_LINE(15047) PcapQueue_readFromInterfaceThread(interfaces[i].c_str(), PcapQueue_readFromInterfaceThread::read, NULL, NULL, this);
-			++this->readThreadsCount;
+		// xdp - one read thread (socket) per rx queue
+		if(opt_use_xdp && opt_pcap_queue_use_blocks && !opt_use_dpdk) {
+			threadsPerInterface = opt_xdp_queues > 0 ? opt_xdp_queues : xdp_queues_count(interfaces[i].c_str());
+		}
+		for(int j = 0; j < threadsPerInterface; j++) {
+			if(this->readThreadsCount < READ_THREADS_MAX - 1) {
+				this->readThreads[this->readThreadsCount] = new FILE_LINE(15047) PcapQueue_readFromInterfaceThread(interfaces[i].c_str(), PcapQueue_readFromInterfaceThread::read, NULL, NULL, this);
+				this->readThreads[this->readThreadsCount]->interfaceReadThreads = threadsPerInterface;
+				++this->readThreadsCount;
+			}
 		}
 	}
 	return(this->readThreadsCount > 0);
@@ -6376,7 +7396,7 @@ void *PcapQueue_readFromInterface::writeThreadFunction(void *arg, unsigned int a
 		unsigned int usleepCounter = 0;
 		while(!TERMINATING) {
 			pcap_block_store *blockStore;
-			if(this->block_qring->pop(&blockStore, false)) {
+			if(this->block_qring->pop(&blockStore, true)) {
 				for(size_t i = 0; i < blockStore->count; i++) {
 					u_char *packetPos = blockStore->block + blockStore->offsets[i] + sizeof(pcap_pkthdr_plus);
 					hp = *(sHeaderPacket**)packetPos;
@@ -6401,7 +7421,7 @@ bool PcapQueue_readFromInterface::openFifoForWrite(void */*arg*/, unsigned int /
 	return(true);
 }
 
-bool PcapQueue_readFromInterface::startCapture(string *error, sDpdkConfig *dpdkConfig) {
+bool PcapQueue_readFromInterface::startCapture(string *error, sDpdkConfig *dpdkConfig, sTpacketConfig *tpacketConfig, sXdpConfig *xdpConfig) {
 	*error = "";
 	if(this->readThreadsCount) {
 		return(true);
@@ -6415,7 +7435,7 @@ bool PcapQueue_readFromInterface::startCapture(string *error, sDpdkConfig *dpdkC
 		global_pcap_dlink = this->pcapLinklayerHeaderType;
 		return(true);
 	}
-	return(this->PcapQueue_readFromInterface_base::startCapture(error, dpdkConfig));
+	return(this->PcapQueue_readFromInterface_base::startCapture(error, dpdkConfig, tpacketConfig, xdpConfig));
 }
 
 bool PcapQueue_readFromInterface::openPcap(const char *filename, string *tempFileName) {
@@ -6472,10 +7492,15 @@ string PcapQueue_readFromInterface::pcapStatString_bypass_buffer(int /*statPerio
 	       << setw(6) << (useSize / 1024 / 1024) << "MB (" << setw(3) << useItems << ")"
 	       << " " << setw(5) << setprecision(1) << (100. * useSize / opt_pcap_queue_bypass_max_size) << "%"
 	       << " of " << setw(6) << (opt_pcap_queue_bypass_max_size / 1024 / 1024) << "MB"
-	       << "   peak: " << (maxBypassBufferSize / 1024 / 1024) << "MB" << " (" << maxBypassBufferItems << ")" << " / size exceeded occurrence " << countBypassBufferSizeExceeded << endl;
+	       << "   peak: " << (maxBypassBufferSize / 1024 / 1024) << "MB" << " (" << maxBypassBufferItems << ")" << " / size exceeded occurrence " << countBypassBufferSizeExceeded
+	       << " / queue " << blockStoreBypassQueue->getQueueStatString() << endl;
 	return(outStr.str());
 }
 
+string PcapQueue_readFromInterface::pcapStatString_qring() {
+	return(this->block_qring ? this->block_qring->getStatString() : "");
+}
+
 unsigned long PcapQueue_readFromInterface::pcapStat_get_bypass_buffer_size_exeeded() {
 	return(countBypassBufferSizeExceeded);
 }
@@ -6723,6 +7748,10 @@ string PcapQueue_readFromInterface::pcapStatString_cpuUsageReadThreads(double *s
 				if(tid_cpu >= 0) {
 					sum += tid_cpu;
 					outStrStat << "%/" << setprecision(1) << tid_cpu;
+					double dedup_duplicates_perc = this->readThreads[i]->dedupThread->getDedupDuplicatesPerc();
+					if(dedup_duplicates_perc > 0) {
+						outStrStat << "d" << dedup_duplicates_perc;
+					}
 					if(sverb.qring_stat) {
 						double qringFillingPerc = this->readThreads[i]->dedupThread->getQringFillingPerc();
 						if(qringFillingPerc > 0) {
@@ -6864,6 +7893,8 @@ PcapQueue_readFromFifo::PcapQueue_readFromFifo(const char *nameQueue, const char
 	this->_last_ts.tv_sec = 0;
 	this->_last_ts.tv_usec = 0;
 	this->block_counter = 0;
+	// identifies block_counter sequence of this process - server drops blocks resent after reconnect and already accepted
+	this->clientSocketBlockSession = intToString(getTimeUS()) + "_" + intToString(getpid());
 	this->setEnableMainThread(opt_pcap_queue_compress || is_receiver() ||
 				  (opt_pcap_queue_disk_folder.length() && opt_pcap_queue_store_queue_max_disk_size) ||
 				  !opt_pcap_queue_suppress_t1_thread);
@@ -6902,6 +7933,7 @@ PcapQueue_readFromFifo::~PcapQueue_readFromFifo() {
 	if(this->clientSocket) {
 		delete this->clientSocket;
 	}
+	this->clearUnconfirmedBlocks();
 	this->cleanupBlockStoreTrash(true);
 	syslog(LOG_NOTICE, "packetbuffer terminating (%s): cleanupBlockStoreTrash", nameQueue.c_str());
 }
@@ -6939,7 +7971,9 @@ bool PcapQueue_readFromFifo::addBlockStoreToPcapStoreQueue(u_char *buffer, size_
 		}
 	} 
 	if(error->empty()) {
-		if(*block_counter == blockStore->block_counter) {
+		if(*block_counter &&
+		   (int32_t)(blockStore->block_counter - *block_counter) <= 0) {
+			// already accepted (block resent after reconnect)
 			delete blockStore;
 		} else {
 			if(*block_counter &&
@@ -7507,6 +8541,7 @@ void *PcapQueue_readFromFifo::writeThreadFunction(void *arg, unsigned int arg2)
 	unsigned long usleepSumTime_lastPush = 0;
 	sHeaderPacketPQout hp_out;
 	u_int64_t cleanupBlockStoreTrash_at_ms = 0;
+	unsigned latency_sample_counter = 0;
 	//
 	while(!TERMINATING) {
 		if(DEBUG_SLEEP && access((this->pcapStoreQueue.fileStoreFolder + "/__/sleep").c_str(), F_OK ) != -1) {
@@ -7532,6 +8567,10 @@ void *PcapQueue_readFromFifo::writeThreadFunction(void *arg, unsigned int arg2)
 					blockStore = NULL;
 				} else {
 					buffersControl.add__pb_trash_size(blockStore->getUseAllSize());
+					if(cPacketLatency::sample(&latency_sample_counter)) {
+						u_int64_t time_ms = getTimeMS_rdtsc();
+						packetLatency.addUS(cPacketLatency::_fifo, time_ms > blockStore->timestampMS ? (time_ms - blockStore->timestampMS) * 1000 : 0);
+					}
 					if(opt_ipaccount) {
 						blockStore->is_voip = new FILE_LINE(15056) u_int8_t[blockStore->count];
 						memset(blockStore->is_voip, 0, blockStore->count);
@@ -7807,6 +8846,9 @@ void *PcapQueue_readFromFifo::writeThreadFunction(void *arg, unsigned int arg2)
 			this->blockStoreTrashPush(blockInfo[i].blockStore);
 		}
 	}
+	if(is_client_packetbuffer_sender()) {
+		this->socketFlushBySnifferClient();
+	}
 	this->writeThreadTerminated = true;
 	return(NULL);
 }
@@ -7825,6 +8867,9 @@ void *PcapQueue_readFromFifo::destroyBlocksThreadFunction(void */*arg*/, unsigne
 	}
 	while(!TERMINATING) {
 		if(this->blockStoreTrash.size() < 3) {
+			if(opt_ipaccount) {
+				ipaccount_flush();
+			}
 			USLEEP(1000);
 			continue;
 		}
@@ -7883,6 +8928,9 @@ void *PcapQueue_readFromFifo::destroyBlocksThreadFunction(void */*arg*/, unsigne
 				delete block;
 			}
 		} else {
+			if(opt_ipaccount) {
+				ipaccount_flush();
+			}
 			USLEEP(1000);
 			continue;
 		}
@@ -8001,6 +9049,10 @@ double PcapQueue_readFromFifo::pcapStat_get_disk_buffer_mb() {
 	}
 }
 
+string PcapQueue_readFromFifo::pcapStat_get_disk_buffer_io() {
+	return(this->pcapStoreQueue.getFileStoreIOStatString());
+}
+
 string PcapQueue_readFromFifo::getCpuUsage(bool writeThread, bool preparePstatData) {
 	if(!writeThread && this->packetServerDirection == directionRead) {
 		bool empty = true;
@@ -8085,7 +9137,12 @@ bool PcapQueue_readFromFifo::socketWritePcapBlock(pcap_block_store *blockStore)
 }
 
 bool PcapQueue_readFromFifo::socketWritePcapBlockBySnifferClient(pcap_block_store *blockStore) {
+	// window > 1 - blocks are sent without waiting for confirmation of previous blocks; unconfirmed blocks are sent again after reconnect
+	unsigned window = opt_pcap_queues_mirror_require_confirmation ?
+			   max(snifferClientOptions.packetbuffer_window, 1u) : 0;
 	bool ok = false;
+	bool queued = false;
+	bool rejectedFront = false;
 	unsigned maxPass = 100000;
 	for(unsigned int pass = 0; pass < maxPass; pass++) {
 		if(is_terminating() > 1 && pass > 2) {
@@ -8104,100 +9161,178 @@ bool PcapQueue_readFromFifo::socketWritePcapBlockBySnifferClient(pcap_block_stor
 			syslog(LOG_INFO, "send packetbuffer block - next attempt %u", pass);
 		}
 		if(!this->clientSocket) {
-			this->clientSocket = new FILE_LINE(0) cSocketBlock("packetbuffer block", true);
-			this->clientSocket->setHostPort(snifferClientOptions.host, snifferClientOptions.port);
-			if(!this->clientSocket->connect()) {
-				syslog(LOG_ERR, "send packetbuffer block error: %s", "failed connect to cloud router");
-				pcapQueueQ->externalError = "send packetbuffer block error: failed connect to cloud router";
+			if(!this->socketConnectBySnifferClient() ||
+			   !this->socketResendUnconfirmedBySnifferClient()) {
 				continue;
 			}
-			string cmd = "{\"type_connection\":\"packetbuffer block\"}\r\n";
-			if(!this->clientSocket->write(cmd)) {
-				syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send command");
-				pcapQueueQ->externalError = "send packetbuffer block error: failed send command";
-				continue;
+		}
+		if(!queued) {
+			size_t sizeSaveBuffer = blockStore->getSizeSaveBuffer();
+			u_char *saveBuffer = blockStore->getSaveBuffer(block_counter, !this->clientSocket->is_aes_gcm());
+			if(!opt_pcap_queues_mirror_require_confirmation ||
+			   buffersControl.getPerc_pb() > 70) {
+				((pcap_block_store::pcap_block_store_header*)saveBuffer)->time_s = 0;
 			}
-			string rsltRsaKey;
-			if(!this->clientSocket->readBlock(&rsltRsaKey) || rsltRsaKey.find("key") == string::npos) {
-				syslog(LOG_ERR, "send packetbuffer block error: %s", "failed read rsa key");
-				pcapQueueQ->externalError = "send packetbuffer block error: failed read rsa key";
-				continue;
+			if(window) {
+				sUnconfirmedBlock unconfirmedBlock;
+				unconfirmedBlock.saveBuffer = saveBuffer;
+				unconfirmedBlock.sizeSaveBuffer = sizeSaveBuffer;
+				this->clientSocketUnconfirmedBlocks.push_back(unconfirmedBlock);
+				queued = true;
 			}
-			JsonItem jsonRsaKey;
-			jsonRsaKey.parse(rsltRsaKey);
-			string rsa_key = jsonRsaKey.getValue("rsa_key");
-			this->clientSocket->set_rsa_pub_key(rsa_key);
-			this->clientSocket->generate_aes_keys();
-			JsonExport json_keys;
-			json_keys.add("password", snifferServerClientOptions.password);
-			string aes_ckey, aes_ivec;
-			this->clientSocket->get_aes_keys(&aes_ckey, &aes_ivec);
-			json_keys.add("aes_ckey", aes_ckey);
-			json_keys.add("aes_ivec", aes_ivec);
-			json_keys.add("time", sqlDateTimeString(time(NULL)).c_str());
-			json_keys.add("sensor_id", opt_id_sensor);
-			json_keys.add("sensor_name", opt_name_sensor);
-			if(!this->clientSocket->writeBlock(json_keys.getJson(), cSocket::_te_rsa)) {
-				syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send token & aes keys");
-				pcapQueueQ->externalError = "";
-				continue;
+			bool okSendBlock = this->clientSocket->writeBlock(saveBuffer, sizeSaveBuffer, cSocket::_te_aes);
+			if(!window) {
+				delete [] saveBuffer;
 			}
-			string connectResponse;
-			if(!this->clientSocket->readBlock(&connectResponse) || connectResponse != "OK") {
-				if(!this->clientSocket->isError() && connectResponse != "OK") {
-					string errorStr = connectResponse == "bad time" ?
-							   "different time between server and client" :
-							   connectResponse;
-					syslog(LOG_ERR, "send packetbuffer block error: %s", ("failed response from server - " + errorStr).c_str());
-					pcapQueueQ->externalError = "send packetbuffer block error: failed response from server - " + errorStr;
-					delete this->clientSocket;
-					this->clientSocket = NULL;
-				} else {
-					syslog(LOG_ERR, "send packetbuffer block error: %s", "failed read ok");
-					pcapQueueQ->externalError = "send packetbuffer block error: failed read ok";
-				}
+			if(!okSendBlock) {
+				syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send");
+				pcapQueueQ->externalError = "send packetbuffer block error: failed send";
 				continue;
 			}
 		}
-		bool okSendBlock = true;
-		size_t sizeSaveBuffer = blockStore->getSizeSaveBuffer();
-		u_char *saveBuffer = blockStore->getSaveBuffer(block_counter);
-		if(!opt_pcap_queues_mirror_require_confirmation ||
-		   buffersControl.getPerc_pb() > 70) {
-			((pcap_block_store::pcap_block_store_header*)saveBuffer)->time_s = 0;
+		rejectedFront = false;
+		if(window &&
+		   !this->socketReadConfirmationsBySnifferClient(window, &maxPass, pass, &rejectedFront)) {
+			continue;
 		}
-		if(!this->clientSocket->writeBlock(saveBuffer, sizeSaveBuffer, cSocket::_te_aes)) {
-			okSendBlock = false;
+		ok = true;
+		break;
+	}
+	if(!ok && queued && this->clientSocketUnconfirmedBlocks.size()) {
+		// drop only the failed block - the oldest one if the server rejected it, otherwise this one
+		// the rest of the window stays and is sent again after reconnect
+		deque<sUnconfirmedBlock>::iterator failed = rejectedFront ?
+							    this->clientSocketUnconfirmedBlocks.begin() :
+							    this->clientSocketUnconfirmedBlocks.end() - 1;
+		delete [] failed->saveBuffer;
+		this->clientSocketUnconfirmedBlocks.erase(failed);
+	}
+	return(ok);
+}
+
+bool PcapQueue_readFromFifo::socketConnectBySnifferClient() {
+	this->clientSocket = new FILE_LINE(0) cSocketBlock("packetbuffer block", true);
+	this->clientSocket->setHostPort(snifferClientOptions.host, snifferClientOptions.port);
+	if(!this->clientSocket->connect()) {
+		syslog(LOG_ERR, "send packetbuffer block error: %s", "failed connect to cloud router");
+		pcapQueueQ->externalError = "send packetbuffer block error: failed connect to cloud router";
+		return(false);
+	}
+	string cmd = "{\"type_connection\":\"packetbuffer block\"}\r\n";
+	if(!this->clientSocket->write(cmd)) {
+		syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send command");
+		pcapQueueQ->externalError = "send packetbuffer block error: failed send command";
+		return(false);
+	}
+	string rsltRsaKey;
+	if(!this->clientSocket->readBlock(&rsltRsaKey) || rsltRsaKey.find("key") == string::npos) {
+		syslog(LOG_ERR, "send packetbuffer block error: %s", "failed read rsa key");
+		pcapQueueQ->externalError = "send packetbuffer block error: failed read rsa key";
+		return(false);
+	}
+	JsonItem jsonRsaKey;
+	jsonRsaKey.parse(rsltRsaKey);
+	string rsa_key = jsonRsaKey.getValue("rsa_key");
+	this->clientSocket->set_rsa_pub_key(rsa_key);
+	this->clientSocket->generate_aes_keys();
+	JsonExport json_keys;
+	json_keys.add("password", snifferServerClientOptions.password);
+	string aes_ckey, aes_ivec;
+	this->clientSocket->get_aes_keys(&aes_ckey, &aes_ivec);
+	json_keys.add("aes_ckey", aes_ckey);
+	json_keys.add("aes_ivec", aes_ivec);
+	if(snifferClientOptions.packetbuffer_aes_gcm) {
+		json_keys.add("aes_mode", "gcm");
+	}
+	json_keys.add("block_session", this->clientSocketBlockSession);
+	json_keys.add("time", sqlDateTimeString(time(NULL)).c_str());
+	json_keys.add("sensor_id", opt_id_sensor);
+	json_keys.add("sensor_name", opt_name_sensor);
+	if(!this->clientSocket->writeBlock(json_keys.getJson(), cSocket::_te_rsa)) {
+		syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send token & aes keys");
+		pcapQueueQ->externalError = "";
+		return(false);
+	}
+	string connectResponse;
+	// server without aes gcm support ignores aes_mode and responds OK - cbc is used
+	if(!this->clientSocket->readBlock(&connectResponse) || 
+	   (connectResponse != "OK" && connectResponse != "OK aes_gcm")) {
+		if(!this->clientSocket->isError() && connectResponse != "OK") {
+			string errorStr = connectResponse == "bad time" ?
+					   "different time between server and client" :
+					   connectResponse;
+			syslog(LOG_ERR, "send packetbuffer block error: %s", ("failed response from server - " + errorStr).c_str());
+			pcapQueueQ->externalError = "send packetbuffer block error: failed response from server - " + errorStr;
+			delete this->clientSocket;
+			this->clientSocket = NULL;
+		} else {
+			syslog(LOG_ERR, "send packetbuffer block error: %s", "failed read ok");
+			pcapQueueQ->externalError = "send packetbuffer block error: failed read ok";
 		}
-		delete [] saveBuffer;
-		if(!okSendBlock) {
-			syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send");
-			pcapQueueQ->externalError = "send packetbuffer block error: failed send";
-			continue;
+		return(false);
+	}
+	if(connectResponse == "OK aes_gcm") {
+		this->clientSocket->set_aes_mode(cAes::_mode_gcm);
+	}
+	return(true);
+}
+
+bool PcapQueue_readFromFifo::socketResendUnconfirmedBySnifferClient() {
+	u_int32_t time_s = getTimeS();
+	for(deque<sUnconfirmedBlock>::iterator iter = this->clientSocketUnconfirmedBlocks.begin(); iter != this->clientSocketUnconfirmedBlocks.end(); iter++) {
+		pcap_block_store::pcap_block_store_header *header = (pcap_block_store::pcap_block_store_header*)iter->saveBuffer;
+		if(header->time_s) {
+			header->time_s = time_s;
 		}
-		if(opt_pcap_queues_mirror_require_confirmation) {
-			string response;
-			if(!this->clientSocket->readBlock(&response, cSocket::_te_aes)) {
-				syslog(LOG_ERR, "send packetbuffer block error: %s", "failed read response");
-				pcapQueueQ->externalError = "send packetbuffer block error: failed read response";
-				continue;
+		if(!this->clientSocket->writeBlock(iter->saveBuffer, iter->sizeSaveBuffer, cSocket::_te_aes)) {
+			syslog(LOG_ERR, "send packetbuffer block error: %s", "failed send unconfirmed block");
+			pcapQueueQ->externalError = "send packetbuffer block error: failed send unconfirmed block";
+			return(false);
+		}
+	}
+	return(true);
+}
+
+bool PcapQueue_readFromFifo::socketReadConfirmationsBySnifferClient(unsigned window, unsigned *maxPass, unsigned pass, bool *rejectedFront) {
+	while(this->clientSocketUnconfirmedBlocks.size() &&
+	      (this->clientSocketUnconfirmedBlocks.size() >= window ||
+	       this->clientSocket->checkHandleRead(0))) {
+		string response;
+		if(!this->clientSocket->readBlock(&response, cSocket::_te_aes)) {
+			syslog(LOG_ERR, "send packetbuffer block error: %s", "failed read response");
+			pcapQueueQ->externalError = "send packetbuffer block error: failed read response";
+			return(false);
+		}
+		if(response == "OK") {
+			delete [] this->clientSocketUnconfirmedBlocks.front().saveBuffer;
+			this->clientSocketUnconfirmedBlocks.pop_front();
+		} else {
+			syslog(LOG_ERR, "send packetbuffer block error: %s", response.empty() ? "response is empty" : ("bad response - " + response).c_str());
+			pcapQueueQ->externalError = "send packetbuffer block error: " + (response.empty() ? "response is empty" : ("bad response - " + response));
+			if(maxPass && response.find("bad header") != string::npos) {
+				*maxPass = pass + 10;
 			}
-			if(response == "OK") {
-				ok = true;
-				break;
-			} else {
-				syslog(LOG_ERR, "send packetbuffer block error: %s", response.empty() ? "response is empty" : ("bad response - " + response).c_str());
-				pcapQueueQ->externalError = "send packetbuffer block error: " + (response.empty() ? "response is empty" : ("bad response - " + response));
-				if(response.find("bad header") != string::npos) {
-					maxPass = pass + 10;
-				}
+			if(rejectedFront) {
+				*rejectedFront = true;
 			}
-		} else {
-			ok = true;
-			break;
+			return(false);
 		}
 	}
-	return(ok);
+	return(true);
+}
+
+void PcapQueue_readFromFifo::socketFlushBySnifferClient() {
+	if(this->clientSocket && this->clientSocketUnconfirmedBlocks.size()) {
+		this->socketReadConfirmationsBySnifferClient(1);
+	}
+	this->clearUnconfirmedBlocks();
+}
+
+void PcapQueue_readFromFifo::clearUnconfirmedBlocks() {
+	for(deque<sUnconfirmedBlock>::iterator iter = this->clientSocketUnconfirmedBlocks.begin(); iter != this->clientSocketUnconfirmedBlocks.end(); iter++) {
+		delete [] iter->saveBuffer;
+	}
+	this->clientSocketUnconfirmedBlocks.clear();
 }
 
 bool PcapQueue_readFromFifo::socketGetHost() {
@@ -8930,10 +10065,9 @@ PcapQueue_outputThread::PcapQueue_outputThread(eTypeOutputThread typeOutputThrea
 	this->defrag_counter = 0;
 	this->ipfrag_lastprune = 0;
 	if(typeOutputThread == dedup) {
-		this->dedup_buffer = new FILE_LINE(16003) u_char[65536 * MD5_DIGEST_LENGTH]; // 1M
-		memset(this->dedup_buffer, 0, 65536 * MD5_DIGEST_LENGTH * sizeof(u_char));
+		this->dedup_table = new FILE_LINE(16003) cPacketDedup(DEDUP_TABLE_SETS_BITS_DEFAULT, opt_dup_check_time_window_ms);
 	} else {
-		this->dedup_buffer = NULL;
+		this->dedup_table = NULL;
 	}
 	this->initThreadOk = false;
 	this->terminatingThread = false;
@@ -8954,7 +10088,7 @@ PcapQueue_outputThread::~PcapQueue_outputThread() {
 		ipfrag_prune(0, true, &ipfrag_data, -1, 0);
 	}
 	if(typeOutputThread == dedup) {
-		delete [] dedup_buffer;
+		delete dedup_table;
 	}
 }
 
@@ -9273,8 +10407,6 @@ void PcapQueue_outputThread::processDedup(sHeaderPacketPQout *hp) {
 				datalen = get_sctp_data_len(header_ip, &data, hp->packet, hp->header->get_caplen());
 			}
 			if(data && datalen) {
-				MD5_CTX md5_ctx;
-				MD5_Init(&md5_ctx);
 				if(opt_dup_check_ipheader) {
 					u_int8_t header_ip_ttl_orig = 0;
 					u_int8_t header_ip_check_orig = 0;
@@ -9284,28 +10416,26 @@ void PcapQueue_outputThread::processDedup(sHeaderPacketPQout *hp) {
 						header_ip->set_ttl(0);
 						header_ip->set_check(0);
 					}
-					MD5_Update(&md5_ctx, header_ip, MIN(datalen + (data - (char*)header_ip), header_ip->get_tot_len()));
+					dedup_hash(header_ip, MIN(datalen + (data - (char*)header_ip), header_ip->get_tot_len()), __md5);
 					if(opt_dup_check_ipheader_ignore_ttl) {
 						header_ip->set_ttl(header_ip_ttl_orig);
 						header_ip->set_check(header_ip_check_orig);
 					}
 				} else {
-					MD5_Update(&md5_ctx, data, datalen);
+					dedup_hash(data, datalen, __md5);
 				}
-				MD5_Final((unsigned char*)__md5, &md5_ctx);
 				_md5 = __md5;
 			}
 		}
 	}
 	if(_md5) {
-		if(memcmp(_md5, this->dedup_buffer + (_md5[0] * MD5_DIGEST_LENGTH), MD5_DIGEST_LENGTH) == 0) {
+		if(this->dedup_table->check(_md5, hp->header->get_time_ms())) {
 			if(sverb.dedup) {
 				cout << "*** DEDUP 2" << endl;
 			}
 			hp->destroy_or_unlock_blockstore();
 			return;
 		}
-		memcpy(this->dedup_buffer + (_md5[0] * MD5_DIGEST_LENGTH), _md5, MD5_DIGEST_LENGTH);
 	}
 	if(this->pcapQueue->processPacket(hp, _hppq_out_state_dedup) == 0) {
 		hp->destroy_or_unlock_blockstore();
@@ -9355,6 +10485,32 @@ static void *dpdk_main_thread_fce(void *arg) {
 
 void PcapQueue_init() {
 	blockStoreBypassQueue = new FILE_LINE(15061) pcap_block_store_queue;
+	#ifdef HAVE_LIBZSTD
+	if(!opt_pcap_queue_compress_zstd_dictionary.empty()) {
+		FILE *dictFile = fopen(opt_pcap_queue_compress_zstd_dictionary.c_str(), "r");
+		if(dictFile) {
+			fseek(dictFile, 0, SEEK_END);
+			long dictSize = ftell(dictFile);
+			fseek(dictFile, 0, SEEK_SET);
+			if(dictSize > 0) {
+				u_char *dict = new FILE_LINE(0) u_char[dictSize];
+				if(fread(dict, 1, dictSize, dictFile) == (size_t)dictSize) {
+					packetbuffer_zstd_cdict = ZSTD_createCDict(dict, dictSize, opt_pcap_queue_compress_level ? opt_pcap_queue_compress_level : 1);
+					packetbuffer_zstd_ddict = ZSTD_createDDict(dict, dictSize);
+				}
+				delete [] dict;
+			}
+			fclose(dictFile);
+		}
+		if(packetbuffer_zstd_cdict && packetbuffer_zstd_ddict) {
+			syslog(LOG_NOTICE, "packetbuffer: zstd dictionary %s loaded (id %u)", 
+			       opt_pcap_queue_compress_zstd_dictionary.c_str(),
+			       ZSTD_getDictID_fromDDict(packetbuffer_zstd_ddict));
+		} else {
+			syslog(LOG_ERR, "packetbuffer: load zstd dictionary %s failed", opt_pcap_queue_compress_zstd_dictionary.c_str());
+		}
+	}
+	#endif //HAVE_LIBZSTD
 	if(opt_use_dpdk) {
 		if(opt_dpdk_init == 0) {
 			dpdk_do_pre_init(NULL);
@@ -9373,6 +10529,16 @@ void PcapQueue_init() {
 
 void PcapQueue_term() {
 	delete blockStoreBypassQueue;
+	#ifdef HAVE_LIBZSTD
+	if(packetbuffer_zstd_cdict) {
+		ZSTD_freeCDict(packetbuffer_zstd_cdict);
+		packetbuffer_zstd_cdict = NULL;
+	}
+	if(packetbuffer_zstd_ddict) {
+		ZSTD_freeDDict(packetbuffer_zstd_ddict);
+		packetbuffer_zstd_ddict = NULL;
+	}
+	#endif //HAVE_LIBZSTD
 }
 
 int getThreadingMode() {
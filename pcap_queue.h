@@ -16,11 +16,15 @@
 
 #include "pcap_queue_block.h"
 #include "md5.h"
+#include "dedup.h"
 #include "sniff.h"
 #include "pstat.h"
 #include "ip_frag.h"
 #include "header_packet.h"
 #include "dpdk.h"
+#include "tpacket.h"
+#include "xdp.h"
+#include "file_store_io.h"
 
 #define READ_THREADS_MAX 20
 #define DLT_TYPES_MAX 10
@@ -50,6 +54,9 @@ public:
 	size_t getUseItems() {
 		return(this->queueBlock->size());
 	}	
+	string getQueueStatString() {
+		return(this->queueBlock->getStatString());
+	}
 	size_t getUseSize() {
 		ssize_t sizeOfBlocks = this->sizeOfBlocks;
 		return(max(sizeOfBlocks, (ssize_t)0));
@@ -69,7 +76,7 @@ private:
 		__sync_lock_release(&this->sizeOfBlocks_sync);
 	}
 private:
-	rqueue_quick<pcap_block_store*> *queueBlock;
+	rqueue_ring<pcap_block_store*> *queueBlock;
 	volatile ssize_t sizeOfBlocks;
 	volatile int sizeOfBlocks_sync;
 };
@@ -82,7 +89,7 @@ public:
 		typeHandleAll 	= 4
 	};
 public:
-	pcap_file_store(u_int id = 0, const char *folder = NULL);
+	pcap_file_store(u_int id = 0, const char *folder = NULL, cFileStoreIO *io = NULL);
 	~pcap_file_store();
 	bool push(pcap_block_store *blockStore);
 	bool pop(pcap_block_store *blockStore);
@@ -106,16 +113,49 @@ public:
 		       this->countPush == this->countPop);
 	}
 	std::string getFilePathName();
+private:
+	struct sReadWindow {
+		sReadWindow() {
+			buffer = NULL;
+			bufferSize = 0;
+			offset = 0;
+			length = 0;
+			valid = false;
+			pending = false;
+		}
+		u_char *buffer;
+		size_t bufferSize;
+		u_int64_t offset;
+		size_t length;
+		bool valid;
+		bool pending;
+		cFileStoreIO::sRequest request;
+	};
 private:
 	bool open(eTypeHandle typeHandle);
 	bool close(eTypeHandle typeHandle);
 	bool destroy();
+	bool push_direct(pcap_block_store *blockStore);
+	bool pop_direct(pcap_block_store *blockStore);
+	bool open_direct(eTypeHandle typeHandle);
+	bool close_direct(eTypeHandle typeHandle);
+	bool reapWrites();
+	size_t pendingWritesCount();
+	u_char *readDirect(u_int64_t position, size_t size);
+	void readWindowSubmit(sReadWindow *window, u_int64_t offset, size_t length);
+	void readWindowWait(sReadWindow *window);
 	void lock_sync_flush_file() {
 		while(__sync_lock_test_and_set(&this->_sync_flush_file, 1));
 	}
 	void unlock_sync_flush_file() {
 		__sync_lock_release(&this->_sync_flush_file);
 	}
+	void lock_pending_writes() {
+		while(__sync_lock_test_and_set(&this->_sync_pending_writes, 1));
+	}
+	void unlock_pending_writes() {
+		__sync_lock_release(&this->_sync_pending_writes);
+	}
 private:
 	u_int id;
 	std::string folder;
@@ -130,6 +170,16 @@ private:
 	bool full;
 	u_int64_t timestampMS;
 	volatile int _sync_flush_file;
+	cFileStoreIO *io;
+	int fd;
+	bool fdDirect;
+	bool directPushOpen;
+	bool directPopOpen;
+	std::deque<cFileStoreIO::sRequest*> pendingWrites;
+	volatile u_int64_t fileSizeWritten;
+	volatile int _sync_pending_writes;
+	sReadWindow readWindow[2];
+	int readWindowActive;
 friend class pcap_store_queue;
 };
 
@@ -149,6 +199,7 @@ private:
 	uint64_t getFileStoreUseSize(bool lock = true);
 	void memoryBufferIsFull_log();
 	void diskBufferIsFull_log();
+	std::string getFileStoreIOStatString(bool reset = true);
 	void lock_queue() {
 		while(__sync_lock_test_and_set(&this->_sync_queue, 1));
 	}
@@ -179,6 +230,7 @@ private:
 	int cleanupFileStoreCounter;
 	u_int64_t lastTimeLogErrDiskIsFull;
 	u_int64_t lastTimeLogErrMemoryIsFull;
+	cFileStoreIO *fileStoreIO;
 friend class PcapQueue_readFromFifo;
 };
 
@@ -299,14 +351,17 @@ protected:
 		return(global_pcap_handle_index); 
 	}
 	virtual string pcapStatString_packets(int statPeriod);
+	string pcapStatString_compress_methods();
 	virtual double pcapStat_get_compress();
 	virtual double pcapStat_get_speed_mb_s(int statPeriod);
 	virtual string pcapStatString_bypass_buffer(int /*statPeriod*/) { return(""); }
+	virtual string pcapStatString_qring() { return(""); }
 	virtual unsigned long pcapStat_get_bypass_buffer_size_exeeded() { return(0); }
 	virtual string pcapStatString_memory_buffer(int /*statPeriod*/) { return(""); }
 	virtual string pcapStatString_disk_buffer(int /*statPeriod*/) { return(""); }
 	virtual double pcapStat_get_disk_buffer_perc() { return(-1); }
 	virtual double pcapStat_get_disk_buffer_mb() { return(-1); }
+	virtual string pcapStat_get_disk_buffer_io() { return(""); }
 	virtual string pcapStatString_interface(int /*statPeriod*/) { return(""); }
 	virtual string pcapDropCountStat_interface() { return(""); }
 	virtual ulong getCountPacketDrop() { return(0); }
@@ -383,14 +438,14 @@ struct pcapProcessData {
 	pcapProcessData() {
 		memset((void*)this, 0, sizeof(pcapProcessData) - sizeof(ipfrag_data_s));
 		extern int opt_dup_check;
+		extern int opt_dup_check_time_window_ms;
 		if(opt_dup_check) {
-			this->prevmd5s = new FILE_LINE(16003) unsigned char[65536 * MD5_DIGEST_LENGTH]; // 1M
-			memset(this->prevmd5s, 0, 65536 * MD5_DIGEST_LENGTH * sizeof(unsigned char));
+			this->dedup = new FILE_LINE(16003) cPacketDedup(DEDUP_TABLE_SETS_BITS_DEFAULT, opt_dup_check_time_window_ms);
 		}
 	}
 	~pcapProcessData() {
-		if(this->prevmd5s) {
-			delete [] this->prevmd5s;
+		if(this->dedup) {
+			delete this->dedup;
 		}
 		ipfrag_prune(0, true, &ipfrag_data, -1, 0);
 	}
@@ -407,8 +462,7 @@ struct pcapProcessData {
 	int16_t traillen;
 	packet_flags flags;
 	sPacketInfoData pid;
-	unsigned char *prevmd5s;
-	MD5_CTX ctx;
+	cPacketDedup *dedup;
 	u_int ipfrag_lastprune;
 	ipfrag_data_s ipfrag_data;
 };
@@ -427,7 +481,8 @@ public:
 	virtual ~PcapQueue_readFromInterface_base();
 	void setInterfaceName(const char *interfaceName);
 protected:
-	virtual bool startCapture(string *error, sDpdkConfig *dpdkConfig);
+	virtual bool startCapture(string *error, sDpdkConfig *dpdkConfig, sTpacketConfig *tpacketConfig = NULL, sXdpConfig *xdpConfig = NULL);
+	bool compileUserFilterEthernet(bpf_program *fp, char *errorstr, unsigned errorstr_size);
 	inline int pcap_next_ex_iface(pcap_t *pcapHandle, pcap_pkthdr** header, u_char** packet,
 				      bool checkProtocol = false, sCheckProtocolData *checkProtocolData = NULL);
 	inline bool check_protocol(pcap_pkthdr* header, u_char* packet, sCheckProtocolData *checkProtocolData);
@@ -460,6 +515,9 @@ protected:
 	queue<pcap_t*> pcapHandlesLapsed;
 	bool pcapEnd;
 	sDpdkHandle *dpdkHandle;
+	sTpacketHandle *tpacketHandle;
+	sXdpHandle *xdpHandle;
+	int interfaceReadThreads;
 	bpf_program filterData;
 	bool filterDataUse;
 	pcap_dumper_t *pcapDumpHandle;
@@ -634,6 +692,7 @@ public:
 		}
 		PcapQueue_readFromInterfaceThread *me;
 		pcap_block_store *block;
+		pcap_block_store *frames_block;
 		volatile pcap_block_store *next_free_block; 
 		volatile pcap_block_store *last_full_block;
 		pcap_block_store *copy_block[2];
@@ -708,6 +767,10 @@ protected:
 private:
 	void *threadFunction(void *arg, unsigned int arg2);
 	void threadFunction_blocks();
+	void threadFunction_blocks_tpacket();
+	void threadFunction_blocks_xdp();
+	inline bool tpacket_fill_header(pcap_pkthdr *header, u_char *packet, pcap_pkthdr_plus2 *pcap_header_plus2,
+					sCheckProtocolData *checkProtocolData);
 	inline static void _pcap_dispatch_handler(u_char *user, const struct pcap_pkthdr *h, const u_char *bytes);
 	void pcap_dispatch_handler(pcap_dispatch_data *dd, const struct pcap_pkthdr *h, const u_char *bytes);
 	inline static u_char* _dpdk_packet_allocation(void *user, u_int32_t *packet_maxlen);
@@ -718,6 +781,8 @@ private:
 	inline void dpdk_packet_process(pcap_dispatch_data *dd);
 	inline static void _dpdk_packet_process__mbufs_in_packetbuffer(void *user, pcap_pkthdr *pcap_header, void *mbuf);
 	inline void dpdk_packet_process__mbufs_in_packetbuffer(pcap_dispatch_data *dd, pcap_pkthdr *pcap_header, void *mbuf);
+	inline static void _xdp_packet_process__frames_in_packetbuffer(void *user, pcap_pkthdr *pcap_header, void *packet);
+	inline void xdp_packet_process__frames_in_packetbuffer(pcap_dispatch_data *dd, pcap_pkthdr *pcap_header, u_char *packet);
 	void processBlock(pcap_block_store *block);
 	void preparePstatData();
 	double getCpuUsagePerc(bool preparePstatData = false);
@@ -728,6 +793,9 @@ private:
 			(double)(_writeit - _readit) / qringmax * 100 :
 			(double)(qringmax - _readit + _writeit) / qringmax * 100);
 	}
+	double getDedupDuplicatesPerc() {
+		return(ppd.dedup ? ppd.dedup->getDuplicatesPerc() : -1);
+	}
 	void terminate();
 	const char *getTypeThreadName();
 	void prepareLogTraffic();
@@ -805,7 +873,7 @@ protected:
 	void threadFunction_blocks();
 	void *writeThreadFunction(void *arg, unsigned int arg2);
 	bool openFifoForWrite(void *arg, unsigned int arg2);
-	bool startCapture(string *error, sDpdkConfig *dpdkConfig);
+	bool startCapture(string *error, sDpdkConfig *dpdkConfig, sTpacketConfig *tpacketConfig = NULL, sXdpConfig *xdpConfig = NULL);
 	pcap_t* _getPcapHandle(int /*dlt*/) { 
 		return(this->pcapHandle);
 	}
@@ -813,6 +881,7 @@ protected:
 		return(this->pcapHandleIndex);
 	}
 	string pcapStatString_bypass_buffer(int statPeriod);
+	string pcapStatString_qring();
 	unsigned long pcapStat_get_bypass_buffer_size_exeeded();
 	string pcapStatString_interface(int statPeriod);
 	string pcapDropCountStat_interface();
@@ -826,13 +895,15 @@ private:
 	inline void check_bypass_buffer();
 	inline void push_blockstore(pcap_block_store **block_store);
 	inline pcap_block_store *new_blockstore(int index_read_thread);
+	bool isTerminating();
+	static bool block_qring_term_check(void *queue);
 protected:
 	PcapQueue_readFromInterfaceThread *readThreads[READ_THREADS_MAX];
 	int readThreadsCount;
 	int lastReadThreadsIndex_pcapStatString_interface;
 	u_int64_t lastTimeLogErrThread0BufferIsFull;
 private:
-	rqueue_quick<pcap_block_store*> *block_qring;
+	rqueue_ring<pcap_block_store*> *block_qring;
 };
 
 class PcapQueue_readFromFifo : public PcapQueue {
@@ -886,6 +957,10 @@ public:
 		u_int64_t utime_last;
 		u_int64_t at;
 	};
+	struct sUnconfirmedBlock {
+		u_char *saveBuffer;
+		size_t sizeSaveBuffer;
+	};
 public:
 	PcapQueue_readFromFifo(const char *nameQueue, const char *fileStoreFolder);
 	virtual ~PcapQueue_readFromFifo();
@@ -960,9 +1035,15 @@ protected:
 	string pcapStatString_disk_buffer(int statPeriod);
 	double pcapStat_get_disk_buffer_perc();
 	double pcapStat_get_disk_buffer_mb();
+	string pcapStat_get_disk_buffer_io();
 	string getCpuUsage(bool writeThread = false, bool preparePstatData = false);
 	bool socketWritePcapBlock(pcap_block_store *blockStore);
 	bool socketWritePcapBlockBySnifferClient(pcap_block_store *blockStore);
+	bool socketConnectBySnifferClient();
+	bool socketResendUnconfirmedBySnifferClient();
+	bool socketReadConfirmationsBySnifferClient(unsigned window, unsigned *maxPass = NULL, unsigned pass = 0, bool *rejectedFront = NULL);
+	void socketFlushBySnifferClient();
+	void clearUnconfirmedBlocks();
 	bool socketGetHost();
 	bool socketReadyForConnect();
 	bool socketConnect();
@@ -1028,6 +1109,8 @@ private:
 	vmIP socketHostIP;
 	int socketHandle;
 	cSocketBlock *clientSocket;
+	deque<sUnconfirmedBlock> clientSocketUnconfirmedBlocks;
+	string clientSocketBlockSession;
 	map<unsigned int, sPacketServerConnection*> packetServerConnections;
 	volatile int _sync_packetServerConnections;
 	u_int64_t lastCheckFreeSizeCachedir_timeMS;
@@ -1091,6 +1174,9 @@ public:
 	}
 	void preparePstatData();
 	double getCpuUsagePerc(bool preparePstatData);
+	double getDedupDuplicatesPerc() {
+		return(dedup_table ? dedup_table->getDuplicatesPerc() : -1);
+	}
 private:
 	eTypeOutputThread typeOutputThread;
 	PcapQueue_readFromFifo *pcapQueue;
@@ -1108,7 +1194,7 @@ private:
 	ipfrag_data_s ipfrag_data;
 	unsigned ipfrag_lastprune;
 	unsigned defrag_counter;
-	u_char *dedup_buffer;
+	cPacketDedup *dedup_table;
 	volatile bool initThreadOk;
 	volatile bool terminatingThread;
 	#if EXPERIMENTAL_CHECK_TID_IN_PUSH
@@ -13,10 +13,13 @@
 #include "md5.h"
 #include "header_packet.h"
 #include "dpdk.h"
+#include "tpacket.h"
+#include "xdp.h"
 
 #define PCAP_BLOCK_STORE_HEADER_STRING		"pcap_block_store"
 #define PCAP_BLOCK_STORE_HEADER_STRING_LEN	16
-#define PCAP_BLOCK_STORE_HEADER_VERSION		7
+#define PCAP_BLOCK_STORE_HEADER_VERSION		8
+#define PCAP_BLOCK_STORE_HEADER_VERSION_V7	7
 
 #define FLAG_AUDIOCODES 1
 #define FLAG_FRAGMENTED 2
@@ -191,7 +194,10 @@ struct pcap_block_store {
 	enum compress_method {
 		compress_method_default,
 		snappy,
-		lz4
+		lz4,
+		lz4_hc,
+		zstd,
+		compress_method_adaptive
 	};
 	struct pcap_pkthdr_pcap {
 		pcap_pkthdr_pcap() {
@@ -216,6 +222,7 @@ struct pcap_block_store {
 			this->hm = plus;
 			this->size = 0;
 			this->size_compress = 0;
+			this->compress_type = 0;
 			this->count = 0;
 			this->dlink = 0;
 			this->sensor_id = 0;
@@ -238,6 +245,7 @@ struct pcap_block_store {
 		uint32_t counter;
 		uint8_t require_confirmation;
 		uint32_t time_s;
+		uint8_t compress_type;
 	};
 	struct s_dpdk_data {
 		pcap_pkthdr_plus2 header;
@@ -250,6 +258,8 @@ struct pcap_block_store {
 		this->offsets = NULL;
 		this->dpdk_data_size = 0;
 		this->dpdk_data = NULL;
+		this->ring_block = NULL;
+		this->xdp_umem = NULL;
 		this->block = NULL;
 		this->is_voip = NULL;
 		#if DEBUG_SYNC_PCAP_BLOCK_STORE
@@ -263,6 +273,7 @@ struct pcap_block_store {
 		this->destroyRestoreBuffer();
 		this->idFileStore = 0;
 		this->filePosition = 0;
+		this->fileSaveSize = 0;
 		this->timestampMS = getTimeMS_rdtsc();
 		this->_sync_packet_lock = 0;
 	}
@@ -277,6 +288,11 @@ struct pcap_block_store {
 	inline void inc_h(pcap_pkthdr_plus2 *header);
 	inline bool get_add_hp_pointers(pcap_pkthdr_plus2 **header, u_char **packet, unsigned min_size_for_packet);
 	inline void add_dpdk(pcap_pkthdr_plus2 *header, void *mbuf);
+	inline void add_ring_packet(pcap_pkthdr_plus2 *header, u_char *packet, unsigned max_count);
+	inline void add_xdp_frame(pcap_pkthdr_plus2 *header, u_char *packet, void *umem, unsigned max_count);
+	void set_ring_block(void *ring_block) {
+		this->ring_block = ring_block;
+	}
 	inline bool is_dpkd_data_full();
 	inline bool isFull_checkTimeout();
 	inline bool isTimeout();
@@ -308,7 +324,7 @@ struct pcap_block_store {
 	}
 	inline bool is_ignore(size_t indexItem) {
 		return(dpdk ?
-			this->dpdk_data[this->count - 1].header.ignore :
+			this->dpdk_data[indexItem].header.ignore :
 			((pcap_pkthdr_plus2*)(this->block + this->offsets[indexItem]))->ignore);
 	}
 	void dpdk_free(size_t indexItem) {
@@ -319,6 +335,7 @@ struct pcap_block_store {
 	}
 	void destroy();
 	void destroyRestoreBuffer();
+	void upgradeRestoreBufferHeader_v7();
 	bool isEmptyRestoreBuffer();
 	void freeBlock();
 	size_t getSizeSaveBuffer() {
@@ -340,16 +357,20 @@ struct pcap_block_store {
 		       sizeof(uint32_t) * offsets_size + 
 		       sizeof(*this));
 	}
-	u_char *getSaveBuffer(uint32_t block_counter = 0);
+	u_char *getSaveBuffer(uint32_t block_counter = 0, bool use_checksum = true);
+	void fillSaveBuffer(u_char *saveBuffer, uint32_t block_counter = 0, bool heapBuffer = true, bool use_checksum = true);
 	void restoreFromSaveBuffer(u_char *saveBuffer);
 	int addRestoreChunk(u_char *buffer, size_t size, size_t *offset = NULL, bool restoreFromStore = false, string *error = NULL);
 	string addRestoreChunk_getErrorString(int errorCode);
 	inline bool compress();
 	bool compress_snappy();
 	bool compress_lz4();
+	bool compress_lz4_hc();
+	bool compress_zstd();
 	inline bool uncompress(compress_method method = compress_method_default);
 	bool uncompress_snappy();
 	bool uncompress_lz4();
+	bool uncompress_zstd();
 	bool check_offsets() {
 		if(dpdk) {
 			return(true);
@@ -481,9 +502,12 @@ struct pcap_block_store {
 	uint32_t *offsets;
 	unsigned dpdk_data_size;
 	s_dpdk_data *dpdk_data;
+	void *ring_block;
+	void *xdp_umem;
 	u_char *block;
 	size_t size;
 	size_t size_compress;
+	uint8_t compressMethod;
 	size_t size_packets;
 	size_t count;
 	size_t offsets_size;
@@ -499,6 +523,7 @@ struct pcap_block_store {
 	size_t restoreBufferAllocSize;
 	u_int idFileStore;
 	u_int64_t filePosition;
+	u_int32_t fileSaveSize;
 	u_int64_t timestampMS;
 	volatile int _sync_packet_lock;
 	#if DEBUG_SYNC_PCAP_BLOCK_STORE
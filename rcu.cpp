@@ -0,0 +1,138 @@
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+
+#include "rcu.h"
+
+
+using namespace std;
+
+
+volatile int cEpochRcu::readers_count = 0;
+volatile int cEpochRcu::readers_used[EPOCH_RCU_MAX_READERS];
+pthread_key_t cEpochRcu::reader_slot_key;
+pthread_once_t cEpochRcu::reader_slot_key_once = PTHREAD_ONCE_INIT;
+__thread int cEpochRcu::thread_reader_slot = -1;
+
+
+cEpochRcu::cEpochRcu() {
+	memset((void*)readers, 0, sizeof(readers));
+	epoch = 1;
+	_sync_retired = 0;
+	stat_retired = 0;
+	stat_reclaimed = 0;
+}
+
+cEpochRcu::~cEpochRcu() {
+	reclaim(true);
+}
+
+u_int64_t cEpochRcu::retire(void *ptr, void (*destroy)(void *ptr)) {
+	sRetired item;
+	item.ptr = ptr;
+	item.destroy = destroy;
+	// the node is already unlinked - readers entering after the increment cannot reach it
+	item.epoch = __sync_fetch_and_add(&epoch, 1);
+	lock_retired();
+	retired.push_back(item);
+	++stat_retired;
+	unlock_retired();
+	return(item.epoch);
+}
+
+bool cEpochRcu::isGracePeriodElapsed(u_int64_t retire_epoch) {
+	return(minReaderEpoch() > retire_epoch);
+}
+
+void cEpochRcu::synchronize() {
+	u_int64_t retire_epoch = __sync_fetch_and_add(&epoch, 1);
+	while(!isGracePeriodElapsed(retire_epoch)) {
+		USLEEP(10);
+	}
+}
+
+unsigned cEpochRcu::reclaim(bool force) {
+	if(!force && retired.empty()) {
+		return(0);
+	}
+	u_int64_t min_epoch = force ? (u_int64_t)-1 : minReaderEpoch();
+	unsigned count = 0;
+	lock_retired();
+	unsigned i = 0;
+	for(unsigned j = 0; j < retired.size(); j++) {
+		if(retired[j].epoch < min_epoch) {
+			retired[j].destroy(retired[j].ptr);
+			++count;
+		} else {
+			retired[i++] = retired[j];
+		}
+	}
+	retired.resize(i);
+	stat_reclaimed += count;
+	unlock_retired();
+	return(count);
+}
+
+void cEpochRcu::getStat(sStat *stat) {
+	lock_retired();
+	stat->retired = stat_retired;
+	stat->reclaimed = stat_reclaimed;
+	stat->pending = retired.size();
+	unlock_retired();
+	stat->readers = 0;
+	for(int i = 0; i < readers_count; i++) {
+		if(readers_used[i]) {
+			++stat->readers;
+		}
+	}
+}
+
+string cEpochRcu::getStatString() {
+	sStat stat;
+	getStat(&stat);
+	ostringstream outStr;
+	outStr << "epoch: " << epoch << endl
+	       << "readers: " << stat.readers << endl
+	       << "retired: " << stat.retired << endl
+	       << "reclaimed: " << stat.reclaimed << endl
+	       << "pending: " << stat.pending << endl;
+	return(outStr.str());
+}
+
+u_int64_t cEpochRcu::minReaderEpoch() {
+	// nodes retired after the scan get epoch >= current one and must wait for the next reclaim
+	u_int64_t min_epoch = epoch;
+	__sync_synchronize();
+	int _readers_count = readers_count;
+	for(int i = 0; i < _readers_count; i++) {
+		u_int64_t reader_epoch = readers[i].epoch;
+		if(reader_epoch && reader_epoch < min_epoch) {
+			min_epoch = reader_epoch;
+		}
+	}
+	return(min_epoch);
+}
+
+int cEpochRcu::alloc_reader_slot() {
+	pthread_once(&reader_slot_key_once, create_reader_slot_key);
+	for(int i = 0; i < EPOCH_RCU_MAX_READERS; i++) {
+		if(!readers_used[i] && __sync_bool_compare_and_swap(&readers_used[i], 0, 1)) {
+			// readers_count is the high-water mark of used slots - range scanned by minReaderEpoch
+			int _readers_count;
+			while((_readers_count = readers_count) < i + 1 &&
+			      !__sync_bool_compare_and_swap(&readers_count, _readers_count, i + 1));
+			pthread_setspecific(reader_slot_key, (void*)(long)(i + 1));
+			return(i);
+		}
+	}
+	return(-2);
+}
+
+void cEpochRcu::free_reader_slot(void *slot) {
+	// thread ends - its epoch in all instances is 0 (it is out of read sections)
+	__sync_lock_release(&readers_used[(long)slot - 1]);
+}
+
+void cEpochRcu::create_reader_slot_key() {
+	pthread_key_create(&reader_slot_key, free_reader_slot);
+}
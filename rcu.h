@@ -0,0 +1,116 @@
+#ifndef RCU_H
+#define RCU_H
+
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+
+#ifndef USLEEP
+#define USLEEP(us) usleep(us);
+#endif
+
+
+#define EPOCH_RCU_MAX_READERS 256
+
+
+/**
+  * Epoch based read-copy-update for read-mostly structures.
+  * Readers only publish the epoch in which they entered (per-thread slot, no shared write),
+  * writers serialize on their own lock, unlink nodes and pass them to retire().
+  * Retired nodes are destroyed by reclaim() when no reader is active in an epoch <= retire epoch.
+  * Slots are taken from a free map and returned by thread-specific key destructor when the thread ends.
+  * Threads over EPOCH_RCU_MAX_READERS concurrently living readers get no slot - read_lock returns false and caller must fall back to the writer lock.
+*/
+
+class cEpochRcu {
+public:
+	struct sStat {
+		u_int64_t retired;
+		u_int64_t reclaimed;
+		u_int32_t pending;
+		u_int32_t readers;
+	};
+private:
+	struct sReader {
+		volatile u_int64_t epoch;
+		u_int32_t nesting;
+		char _filler[64 - sizeof(u_int64_t) - sizeof(u_int32_t)];
+	};
+	struct sRetired {
+		void *ptr;
+		void (*destroy)(void *ptr);
+		u_int64_t epoch;
+	};
+public:
+	cEpochRcu();
+	~cEpochRcu();
+	inline bool read_lock() {
+		int slot = reader_slot();
+		if(slot < 0) {
+			return(false);
+		}
+		sReader *reader = &readers[slot];
+		if(reader->nesting++) {
+			return(true);
+		}
+		u_int64_t _epoch;
+		do {
+			_epoch = epoch;
+			reader->epoch = _epoch;
+			__sync_synchronize();
+		} while(_epoch != epoch);
+		return(true);
+	}
+	inline void read_unlock() {
+		sReader *reader = &readers[thread_reader_slot];
+		if(!--reader->nesting) {
+			__sync_synchronize();
+			reader->epoch = 0;
+		}
+	}
+	u_int64_t retire(void *ptr, void (*destroy)(void *ptr));
+	u_int64_t getEpoch() {
+		return(epoch);
+	}
+	bool isGracePeriodElapsed(u_int64_t retire_epoch);
+	void synchronize();
+	unsigned reclaim(bool force = false);
+	void getStat(sStat *stat);
+	std::string getStatString();
+private:
+	inline int reader_slot() {
+		if(thread_reader_slot == -1) {
+			thread_reader_slot = alloc_reader_slot();
+		}
+		return(thread_reader_slot);
+	}
+	static int alloc_reader_slot();
+	static void free_reader_slot(void *slot);
+	static void create_reader_slot_key();
+	u_int64_t minReaderEpoch();
+	void lock_retired() {
+		while(__sync_lock_test_and_set(&_sync_retired, 1)) USLEEP(10);
+	}
+	void unlock_retired() {
+		__sync_lock_release(&_sync_retired);
+	}
+private:
+	sReader readers[EPOCH_RCU_MAX_READERS];
+	volatile u_int64_t epoch;
+	std::vector<sRetired> retired;
+	volatile int _sync_retired;
+	u_int64_t stat_retired;
+	u_int64_t stat_reclaimed;
+	static volatile int readers_count;
+	static volatile int readers_used[EPOCH_RCU_MAX_READERS];
+	static pthread_key_t reader_slot_key;
+	static pthread_once_t reader_slot_key_once;
+	static __thread int thread_reader_slot;
+};
+
+
+#endif //RCU_H
@@ -128,6 +128,43 @@ bool RegisterId:: operator < (const RegisterId& other) const {
 	       ((rslt_cmp_digest_username = REG_CMP0_STR(this->reg->digest_username, other.reg->digest_username)) < 0));
 }
 
+u_int32_t RegisterId::hash() const {
+	// only fields compared by equality - digest_username (REG_EQ0_STR) is not part of hash
+	u_int32_t h = 0;
+	if(opt_sip_register_compare_sipcallerip) {
+		h = (h ^ this->reg->sipcallerip.getHashNumber()) * 0x9E3779B1;
+	}
+	if(opt_sip_register_compare_sipcalledip) {
+		h = (h ^ this->reg->sipcalledip.getHashNumber()) * 0x9E3779B1;
+	}
+	if(opt_sip_register_compare_sipcallerip_encaps) {
+		h = (h ^ this->reg->sipcallerip_encaps.getHashNumber()) * 0x9E3779B1;
+	}
+	if(opt_sip_register_compare_sipcalledip_encaps) {
+		h = (h ^ this->reg->sipcalledip_encaps.getHashNumber()) * 0x9E3779B1;
+	}
+	if(opt_sip_register_compare_sipcallerport) {
+		h = (h ^ this->reg->sipcallerport.getPort()) * 0x9E3779B1;
+	}
+	if(opt_sip_register_compare_sipcalledport) {
+		h = (h ^ this->reg->sipcalledport.getPort()) * 0x9E3779B1;
+	}
+	if(opt_sip_register_compare_vlan) {
+		h = (h ^ this->reg->vlan) * 0x9E3779B1;
+	}
+	if(this->reg->to_num) {
+		for(const char *p = this->reg->to_num; *p; p++) {
+			h = (h ^ tolower(*p)) * 0x01000193;
+		}
+	}
+	if(opt_sip_register_compare_to_domain && this->reg->to_domain) {
+		for(const char *p = this->reg->to_domain; *p; p++) {
+			h = (h ^ tolower(*p)) * 0x01000193;
+		}
+	}
+	return(h ^ (h >> 16));
+}
+
 
 RegisterState::RegisterState(Call *call, Register *reg) {
 	if(call) {
@@ -273,6 +310,10 @@ Register::Register(Call *call) {
 		reg_tcp_seq = *call->reg_tcp_seq;
 	}
 	_sync_states = 0;
+	wheel_prev = NULL;
+	wheel_next = NULL;
+	wheel_time = 0;
+	wheel_slot = -1;
 }
 
 Register::~Register() {
@@ -727,8 +768,15 @@ volatile int Register::_sync_id = 0;
 
 
 Registers::Registers() {
-	_sync_registers = 0;
-	_sync_registers_erase = 0;
+	for(unsigned i = 0; i < REGISTERS_SHARDS; i++) {
+		memset(shards[i].wheel, 0, sizeof(shards[i].wheel));
+		shards[i].wheel_time = 0;
+		shards[i]._sync = 0;
+	}
+	count = 0;
+	readers = 0;
+	_sync_retired = 0;
+	_sync_cleanup = 0;
 	register_failed_id = 0;
 	_sync_register_failed_id = 0;
 	last_cleanup_time = 0;
@@ -739,7 +787,7 @@ Registers::~Registers() {
 }
 
 int Registers::getCount() {
-	return(registers.size());
+	return(count);
 }
 
 void Registers::add(Call *call) {
@@ -770,12 +818,15 @@ void Registers::add(Call *call) {
 		<< "ua:" << (reg->ua ? reg->ua : "") << endl;
 	*/
 	RegisterId rid(reg);
-	lock_registers();
-	map<RegisterId, Register*>::iterator iter = registers.find(rid);
-	if(iter == registers.end()) {
+	sShard *shard = getShard(&rid);
+	lock_shard(shard);
+	map<RegisterId, Register*>::iterator iter = shard->registers.find(rid);
+	if(iter == shard->registers.end()) {
 		reg->addState(call);
-		registers[rid] = reg;
-		unlock_registers();
+		shard->registers[rid] = reg;
+		__sync_add_and_fetch(&count, 1);
+		schedule(shard, reg, getTimeS_rdtsc());
+		unlock_shard(shard);
 	} else {
 		Register *existsReg = iter->second;
 		existsReg->lock_states();
@@ -788,8 +839,9 @@ void Registers::add(Call *call) {
 		}
 		existsReg->unlock_states();
 		existsReg->update(call);
-		unlock_registers();
 		existsReg->addState(call);
+		schedule(shard, existsReg, getTimeS_rdtsc());
+		unlock_shard(shard);
 		delete reg;
 	}
 	
@@ -816,10 +868,11 @@ bool Registers::existsDuplTcpSeqInRegOK(Call *call, u_int32_t seq) {
 	}
 	Register *reg = new FILE_LINE(20004) Register(call);
 	RegisterId rid(reg);
+	sShard *shard = getShard(&rid);
 	bool rslt = false;
-	lock_registers();
-	map<RegisterId, Register*>::iterator iter = registers.find(rid);
-	if(iter != registers.end()) {
+	lock_shard(shard);
+	map<RegisterId, Register*>::iterator iter = shard->registers.find(rid);
+	if(iter != shard->registers.end()) {
 		Register *existsReg = iter->second;
 		if(existsReg->getState() == rs_OK &&
 		   existsReg->reg_call_id == call->call_id &&
@@ -828,7 +881,7 @@ bool Registers::existsDuplTcpSeqInRegOK(Call *call, u_int32_t seq) {
 			rslt = true;
 		}
 	}
-	unlock_registers();
+	unlock_shard(shard);
 	delete reg;
 	return(rslt);
 }
@@ -840,68 +893,275 @@ void Registers::cleanup(bool force, int expires_add) {
 		return;
 	}
 	if(actTimeS > last_cleanup_time + NEW_REGISTER_CLEAN_PERIOD || force) {
-		lock_registers();
-		map<RegisterId, Register*>::iterator iter;
-		for(iter = registers.begin(); iter != registers.end(); ) {
-			Register *reg = iter->second;
-			reg->lock_states();
-			RegisterState *regstate = reg->states_last();
-			bool eraseRegister = false;
-			bool eraseRegisterFailed = false;
-			if(regstate) {
-				u_int32_t actTimeS_unshift = regstate->unshiftSystemTime_s(actTimeS);
-				if(regstate->state == rs_OK || regstate->state == rs_UnknownMessageOK) {
-					if(regstate->expires &&
-					   TIME_US_TO_S(regstate->state_to_us) + regstate->expires + expires_add < actTimeS_unshift) {
-						reg->expire(false);
-						// cout << "expire" << endl;
-					}
-				} else {
-					if(regstate->state == rs_Failed) {
-						iter->second->saveFailedToDb(regstate, force);
-						RegisterState *regstate_prev = reg->states_prev_last();
-						if(regstate_prev &&
-						   (regstate_prev->state == rs_OK || regstate_prev->state == rs_UnknownMessageOK) &&
-						   regstate_prev->expires &&
-						   TIME_US_TO_S(regstate_prev->state_to_us) + regstate_prev->expires + expires_add < actTimeS_unshift) {
-							reg->expire(false, true);
-							// cout << "expire prev state" << endl;
-						}
-					}
-					if(!_sync_registers_erase) {
-						if(regstate->state == rs_Failed && reg->countStates == 1 &&
-						   TIME_US_TO_S(regstate->state_to_us) + NEW_REGISTER_ERASE_FAILED_TIMEOUT < actTimeS_unshift) {
-							eraseRegisterFailed = true;
-							// cout << "erase failed" << endl;
-						} else if(TIME_US_TO_S(regstate->state_to_us) + NEW_REGISTER_ERASE_TIMEOUT < actTimeS_unshift) {
-							eraseRegister = true;
-							// cout << "erase" << endl;
-						}
+		lock_cleanup();
+		for(unsigned i = 0; i < REGISTERS_SHARDS; i++) {
+			sShard *shard = &shards[i];
+			lock_shard(shard);
+			if(force) {
+				for(map<RegisterId, Register*>::iterator iter = shard->registers.begin(); iter != shard->registers.end(); ) {
+					Register *reg = iter->second;
+					wheelRemove(shard, reg);
+					if(cleanupRegister(reg, actTimeS, force, expires_add)) {
+						shard->registers.erase(iter++);
+						__sync_sub_and_fetch(&count, 1);
+						retire(reg);
+					} else {
+						schedule(shard, reg, actTimeS, expires_add);
+						iter++;
 					}
 				}
-			}
-			reg->unlock_states();
-			if(eraseRegister || eraseRegisterFailed) {
-				lock_registers_erase();
-				delete iter->second;
-				registers.erase(iter++);
-				unlock_registers_erase();
 			} else {
-				iter++;
+				Register *reg = wheelAdvance(shard, actTimeS);
+				while(reg) {
+					Register *next = reg->wheel_next;
+					reg->wheel_next = NULL;
+					if(cleanupRegister(reg, actTimeS, force, expires_add)) {
+						erase(shard, reg);
+					} else {
+						schedule(shard, reg, actTimeS, expires_add);
+					}
+					reg = next;
+				}
 			}
+			unlock_shard(shard);
 		}
-		unlock_registers();
+		freeRetired();
 		last_cleanup_time = actTimeS;
+		unlock_cleanup();
 	}
 }
 
 void Registers::clean_all() {
-	lock_registers();
-	while(registers.size()) {
-		delete registers.begin()->second;
-		registers.erase(registers.begin());
+	for(unsigned i = 0; i < REGISTERS_SHARDS; i++) {
+		sShard *shard = &shards[i];
+		lock_shard(shard);
+		while(shard->registers.size()) {
+			delete shard->registers.begin()->second;
+			shard->registers.erase(shard->registers.begin());
+		}
+		memset(shard->wheel, 0, sizeof(shard->wheel));
+		unlock_shard(shard);
+	}
+	count = 0;
+	lock_retired();
+	for(unsigned i = 0; i < retired.size(); i++) {
+		delete retired[i];
+	}
+	retired.clear();
+	unlock_retired();
+}
+
+Registers::sShard *Registers::getShard(RegisterId *rid) {
+	return(&shards[rid->hash() % REGISTERS_SHARDS]);
+}
+
+bool Registers::cleanupRegister(Register *reg, u_int32_t actTimeS, bool force, int expires_add) {
+	reg->lock_states();
+	RegisterState *regstate = reg->states_last();
+	bool eraseRegister = false;
+	if(regstate) {
+		u_int32_t actTimeS_unshift = regstate->unshiftSystemTime_s(actTimeS);
+		if(regstate->state == rs_OK || regstate->state == rs_UnknownMessageOK) {
+			if(regstate->expires &&
+			   TIME_US_TO_S(regstate->state_to_us) + regstate->expires + expires_add < actTimeS_unshift) {
+				reg->expire(false);
+				// cout << "expire" << endl;
+			}
+		} else {
+			if(regstate->state == rs_Failed) {
+				reg->saveFailedToDb(regstate, force);
+				RegisterState *regstate_prev = reg->states_prev_last();
+				if(regstate_prev &&
+				   (regstate_prev->state == rs_OK || regstate_prev->state == rs_UnknownMessageOK) &&
+				   regstate_prev->expires &&
+				   TIME_US_TO_S(regstate_prev->state_to_us) + regstate_prev->expires + expires_add < actTimeS_unshift) {
+					reg->expire(false, true);
+					// cout << "expire prev state" << endl;
+				}
+			}
+			if(regstate->state == rs_Failed && reg->countStates == 1 &&
+			   TIME_US_TO_S(regstate->state_to_us) + NEW_REGISTER_ERASE_FAILED_TIMEOUT < actTimeS_unshift) {
+				eraseRegister = true;
+				// cout << "erase failed" << endl;
+			} else if(TIME_US_TO_S(regstate->state_to_us) + NEW_REGISTER_ERASE_TIMEOUT < actTimeS_unshift) {
+				eraseRegister = true;
+				// cout << "erase" << endl;
+			}
+		}
+	}
+	reg->unlock_states();
+	return(eraseRegister);
+}
+
+u_int32_t Registers::getNextCheckTime(Register *reg, u_int32_t actTimeS, int expires_add) {
+	// system time (in seconds) in which cleanupRegister can change something, 0 - never
+	u_int32_t rslt = 0;
+	reg->lock_states();
+	RegisterState *regstate = reg->states_last();
+	if(regstate) {
+		u_int32_t shift_s = regstate->time_shift_ms / 1000;
+		if(regstate->state == rs_OK || regstate->state == rs_UnknownMessageOK) {
+			if(regstate->expires) {
+				rslt = TIME_US_TO_S(regstate->state_to_us) + regstate->expires + expires_add + shift_s + 1;
+			}
+		} else {
+			rslt = TIME_US_TO_S(regstate->state_to_us) + shift_s + 1 +
+			       (regstate->state == rs_Failed && reg->countStates == 1 ?
+				 NEW_REGISTER_ERASE_FAILED_TIMEOUT :
+				 NEW_REGISTER_ERASE_TIMEOUT);
+			if(regstate->state == rs_Failed) {
+				if(regstate->counter > regstate->save_at_counter) {
+					rslt = min(rslt, actTimeS + NEW_REGISTER_CLEAN_PERIOD);
+				}
+				RegisterState *regstate_prev = reg->states_prev_last();
+				if(regstate_prev &&
+				   (regstate_prev->state == rs_OK || regstate_prev->state == rs_UnknownMessageOK) &&
+				   regstate_prev->expires) {
+					rslt = min(rslt, (u_int32_t)(TIME_US_TO_S(regstate_prev->state_to_us) + regstate_prev->expires + expires_add + 
+								     regstate_prev->time_shift_ms / 1000 + 1));
+				}
+			}
+		}
+	}
+	reg->unlock_states();
+	return(rslt);
+}
+
+void Registers::schedule(sShard *shard, Register *reg, u_int32_t actTimeS, int expires_add) {
+	wheelRemove(shard, reg);
+	u_int32_t time = getNextCheckTime(reg, actTimeS, expires_add);
+	if(time) {
+		if(!shard->wheel_time) {
+			shard->wheel_time = actTimeS;
+		}
+		wheelInsert(shard, reg, time);
+	}
+}
+
+void Registers::erase(sShard *shard, Register *reg) {
+	RegisterId rid(reg);
+	map<RegisterId, Register*>::iterator iter = shard->registers.find(rid);
+	if(iter == shard->registers.end() || iter->second != reg) {
+		// equality with empty digest_username is not transitive - find by pointer
+		for(iter = shard->registers.begin(); iter != shard->registers.end(); iter++) {
+			if(iter->second == reg) {
+				break;
+			}
+		}
+	}
+	if(iter != shard->registers.end()) {
+		wheelRemove(shard, reg);
+		shard->registers.erase(iter);
+		__sync_sub_and_fetch(&count, 1);
+		retire(reg);
+	}
+}
+
+void Registers::wheelInsert(sShard *shard, Register *reg, u_int32_t time) {
+	if(time <= shard->wheel_time) {
+		time = shard->wheel_time + 1;
+	}
+	reg->wheel_time = time;
+	int slot;
+	if(time - shard->wheel_time <= REGISTERS_WHEEL_SIZE) {
+		slot = time & REGISTERS_WHEEL_MASK;
+	} else {
+		// beyond horizon of second level - parked in farthest slot and reinserted during cascade
+		u_int32_t block = min(time >> REGISTERS_WHEEL_BITS, (shard->wheel_time >> REGISTERS_WHEEL_BITS) + REGISTERS_WHEEL_SIZE);
+		slot = REGISTERS_WHEEL_SIZE + (block & REGISTERS_WHEEL_MASK);
+	}
+	Register **head = &shard->wheel[slot / REGISTERS_WHEEL_SIZE][slot & REGISTERS_WHEEL_MASK];
+	reg->wheel_slot = slot;
+	reg->wheel_prev = NULL;
+	reg->wheel_next = *head;
+	if(*head) {
+		(*head)->wheel_prev = reg;
+	}
+	*head = reg;
+}
+
+void Registers::wheelRemove(sShard *shard, Register *reg) {
+	if(reg->wheel_slot < 0) {
+		return;
+	}
+	if(reg->wheel_prev) {
+		reg->wheel_prev->wheel_next = reg->wheel_next;
+	} else {
+		shard->wheel[reg->wheel_slot / REGISTERS_WHEEL_SIZE][reg->wheel_slot & REGISTERS_WHEEL_MASK] = reg->wheel_next;
+	}
+	if(reg->wheel_next) {
+		reg->wheel_next->wheel_prev = reg->wheel_prev;
+	}
+	reg->wheel_prev = NULL;
+	reg->wheel_next = NULL;
+	reg->wheel_slot = -1;
+}
+
+Register *Registers::wheelAdvance(sShard *shard, u_int32_t time) {
+	// returns due registers linked by wheel_next (removed from wheel)
+	Register *due = NULL;
+	if(!shard->wheel_time || time <= shard->wheel_time) {
+		return(due);
+	}
+	if(time - shard->wheel_time > REGISTERS_WHEEL_SIZE * (REGISTERS_WHEEL_SIZE + 1)) {
+		// time jump - everything is checked
+		for(unsigned level = 0; level < 2; level++) {
+			for(unsigned i = 0; i < REGISTERS_WHEEL_SIZE; i++) {
+				while(shard->wheel[level][i]) {
+					Register *reg = shard->wheel[level][i];
+					wheelRemove(shard, reg);
+					reg->wheel_next = due;
+					due = reg;
+				}
+			}
+		}
+		shard->wheel_time = time;
+		return(due);
+	}
+	while(shard->wheel_time < time) {
+		u_int32_t t = shard->wheel_time + 1;
+		if(!(t & REGISTERS_WHEEL_MASK)) {
+			Register *reg = shard->wheel[1][(t >> REGISTERS_WHEEL_BITS) & REGISTERS_WHEEL_MASK];
+			shard->wheel[1][(t >> REGISTERS_WHEEL_BITS) & REGISTERS_WHEEL_MASK] = NULL;
+			while(reg) {
+				Register *next = reg->wheel_next;
+				reg->wheel_slot = -1;
+				wheelInsert(shard, reg, reg->wheel_time);
+				reg = next;
+			}
+		}
+		Register *reg = shard->wheel[0][t & REGISTERS_WHEEL_MASK];
+		shard->wheel[0][t & REGISTERS_WHEEL_MASK] = NULL;
+		while(reg) {
+			Register *next = reg->wheel_next;
+			reg->wheel_prev = NULL;
+			reg->wheel_slot = -1;
+			reg->wheel_next = due;
+			due = reg;
+			reg = next;
+		}
+		shard->wheel_time = t;
+	}
+	return(due);
+}
+
+void Registers::retire(Register *reg) {
+	lock_retired();
+	retired.push_back(reg);
+	unlock_retired();
+}
+
+void Registers::freeRetired() {
+	// registers in retired are already removed from shards - reader started later cannot see them
+	vector<Register*> retired_free;
+	lock_retired();
+	if(!readers) {
+		retired_free.swap(retired);
+	}
+	unlock_retired();
+	for(unsigned i = 0; i < retired_free.size(); i++) {
+		delete retired_free[i];
 	}
-	unlock_registers();
 }
 
 u_int64_t Registers::getNewRegisterFailedId(int sensorId) {
@@ -962,21 +1222,28 @@ string Registers::getDataTableJson(char *params, bool *zip) {
 		*zip = zipParam == "yes";
 	}
  
-	lock_registers_erase();
-	lock_registers();
-	
-	u_int32_t list_registers_size = registers.size();
-	u_int32_t list_registers_count = 0;
-	Register **list_registers = new FILE_LINE(20005) Register*[list_registers_size];
+	// snapshot of pointers - shard locked only for copy, registers erased meanwhile are not deleted until readers end
+	__sync_add_and_fetch(&readers, 1);
 	
-	//cout << "**** 001 " << getTimeMS() << endl;
+	vector<Register*> snapshot;
+	snapshot.reserve(count + 100);
+	for(unsigned i = 0; i < REGISTERS_SHARDS; i++) {
+		sShard *shard = &shards[i];
+		lock_shard(shard);
+		for(map<RegisterId, Register*>::iterator iter_reg = shard->registers.begin(); iter_reg != shard->registers.end(); iter_reg++) {
+			snapshot.push_back(iter_reg->second);
+		}
+		unlock_shard(shard);
+	}
 	
-	for(map<RegisterId, Register*>::iterator iter_reg = registers.begin(); iter_reg != registers.end(); iter_reg++) {
+	list<RecordArray> records;
+	for(unsigned i = 0; i < snapshot.size(); i++) {
+		Register *reg = snapshot[i];
 		if(states_count) {
 			bool okState = false;
-			eRegisterState state = iter_reg->second->getState();
-			for(unsigned i = 0; i < states_count; i++) {
-				if(states[i] == state) {
+			eRegisterState state = reg->getState();
+			for(unsigned j = 0; j < states_count; j++) {
+				if(states[j] == state) {
 					okState = true;
 					break;
 				}
@@ -986,36 +1253,26 @@ string Registers::getDataTableJson(char *params, bool *zip) {
 			}
 		}
 		if(stateFromLe) {
-			u_int32_t stateFrom = iter_reg->second->getStateFrom_s();
+			u_int32_t stateFrom = reg->getStateFrom_s();
 			if(!stateFrom || stateFrom > stateFromLe) {
 				continue;
 			}
 		}
 		if(rrdGe) {
-			if(!iter_reg->second->rrd_count ||
-			   iter_reg->second->rrd_sum / iter_reg->second->rrd_count < rrdGe) {
+			if(!reg->rrd_count ||
+			   reg->rrd_sum / reg->rrd_count < rrdGe) {
 				continue;
 			}
 		}
-		list_registers[list_registers_count++] = iter_reg->second;
-	}
-	
-	//cout << "**** 002 " << getTimeMS() << endl;
-	
-	unlock_registers();
-	
-	list<RecordArray> records;
-	for(unsigned i = 0; i < list_registers_count; i++) {
 		RecordArray rec(rf__max);
-		if(list_registers[i]->getDataRow(&rec)) {
+		if(reg->getDataRow(&rec)) {
 			rec.sortBy = sortById;
 			rec.sortBy2 = rf_id;
 			records.push_back(rec);
 		}
 	}
-	delete [] list_registers;
 	
-	unlock_registers_erase();
+	__sync_sub_and_fetch(&readers, 1);
 	
 	string table;
 	string header = "[";
@@ -1147,32 +1404,36 @@ void Registers::cleanupByJson(char *params) {
 		}
 	}
 	
-	lock_registers_erase();
-	lock_registers();
-	
-	for(map<RegisterId, Register*>::iterator iter_reg = registers.begin(); iter_reg != registers.end(); ) {
-		bool okState = false;
-		if(states_count) {
-			eRegisterState state = iter_reg->second->getState();
-			for(unsigned i = 0; i < states_count; i++) {
-				if(states[i] == state) {
-					okState = true;
-					break;
+	for(unsigned i = 0; i < REGISTERS_SHARDS; i++) {
+		sShard *shard = &shards[i];
+		lock_shard(shard);
+		for(map<RegisterId, Register*>::iterator iter_reg = shard->registers.begin(); iter_reg != shard->registers.end(); ) {
+			bool okState = false;
+			if(states_count) {
+				eRegisterState state = iter_reg->second->getState();
+				for(unsigned j = 0; j < states_count; j++) {
+					if(states[j] == state) {
+						okState = true;
+						break;
+					}
 				}
+			} else {
+				okState = true;
+			}
+			if(okState) {
+				Register *reg = iter_reg->second;
+				wheelRemove(shard, reg);
+				shard->registers.erase(iter_reg++);
+				__sync_sub_and_fetch(&count, 1);
+				retire(reg);
+			} else {
+				iter_reg++;
 			}
-		} else {
-			okState = true;
-		}
-		if(okState) {
-			delete iter_reg->second;
-			registers.erase(iter_reg++);
-		} else {
-			iter_reg++;
 		}
+		unlock_shard(shard);
 	}
 	
-	unlock_registers();
-	unlock_registers_erase();
+	freeRetired();
 }
 
 
@@ -13,6 +13,11 @@
 
 #define NEW_REGISTER_MAX_STATES 3
 
+#define REGISTERS_SHARDS 64
+#define REGISTERS_WHEEL_BITS 8
+#define REGISTERS_WHEEL_SIZE (1 << REGISTERS_WHEEL_BITS)
+#define REGISTERS_WHEEL_MASK (REGISTERS_WHEEL_SIZE - 1)
+
 #define REG_SIPALG_DETECTED	(1 << 0)
 
 using namespace std;
@@ -67,6 +72,7 @@ public:
 	inline RegisterId(class Register *reg = NULL);
 	inline bool operator == (const RegisterId& other) const;
 	inline bool operator < (const RegisterId& other) const;
+	inline u_int32_t hash() const;
 public:
 	class Register *reg;
 };
@@ -177,12 +183,28 @@ public:
 	string reg_call_id;
 	list<u_int32_t> reg_tcp_seq;
 	volatile int _sync_states;
+	Register *wheel_prev;
+	Register *wheel_next;		// timer wheel slot / due list
+	u_int32_t wheel_time;
+	int16_t wheel_slot;
 	static volatile u_int64_t _id;
 	static volatile int _sync_id;
 };
 
 
+/*
+ registrations in shards selected by hash of RegisterId (fields compared strictly, without digest_username),
+ each shard with own lock and two-level timer wheel (one second slots) with time of next check of register,
+ cleanup visits only due registers, erased registers are retired and deleted when no snapshot reader is active
+*/
 class Registers {
+public:
+	struct sShard {
+		map<RegisterId, Register*> registers;
+		Register *wheel[2][REGISTERS_WHEEL_SIZE];
+		u_int32_t wheel_time;
+		volatile int _sync;
+	};
 public: 
 	Registers();
 	~Registers();
@@ -194,17 +216,23 @@ public:
 	string getDataTableJson(char *params, bool *zip = NULL);
 	int getCount();
 	void cleanupByJson(char *params);
-	void lock_registers() {
-		while(__sync_lock_test_and_set(&_sync_registers, 1));
+	void lock_shard(sShard *shard) {
+		while(__sync_lock_test_and_set(&shard->_sync, 1));
+	}
+	void unlock_shard(sShard *shard) {
+		__sync_lock_release(&shard->_sync);
 	}
-	void unlock_registers() {
-		__sync_lock_release(&_sync_registers);
+	void lock_cleanup() {
+		while(__sync_lock_test_and_set(&_sync_cleanup, 1));
 	}
-	void lock_registers_erase() {
-		while(__sync_lock_test_and_set(&_sync_registers_erase, 1));
+	void unlock_cleanup() {
+		__sync_lock_release(&_sync_cleanup);
 	}
-	void unlock_registers_erase() {
-		__sync_lock_release(&_sync_registers_erase);
+	void lock_retired() {
+		while(__sync_lock_test_and_set(&_sync_retired, 1));
+	}
+	void unlock_retired() {
+		__sync_lock_release(&_sync_retired);
 	}
 	void lock_register_failed_id() {
 		while(__sync_lock_test_and_set(&_sync_register_failed_id, 1));
@@ -212,10 +240,24 @@ public:
 	void unlock_register_failed_id() {
 		__sync_lock_release(&_sync_register_failed_id);
 	}
-public:
-	map<RegisterId, Register*> registers;
-	volatile int _sync_registers;
-	volatile int _sync_registers_erase;
+private:
+	sShard *getShard(RegisterId *rid);
+	bool cleanupRegister(Register *reg, u_int32_t actTimeS, bool force, int expires_add);
+	u_int32_t getNextCheckTime(Register *reg, u_int32_t actTimeS, int expires_add);
+	void schedule(sShard *shard, Register *reg, u_int32_t actTimeS, int expires_add = 0);
+	void erase(sShard *shard, Register *reg);
+	void wheelInsert(sShard *shard, Register *reg, u_int32_t time);
+	void wheelRemove(sShard *shard, Register *reg);
+	Register *wheelAdvance(sShard *shard, u_int32_t time);
+	void retire(Register *reg);
+	void freeRetired();
+private:
+	sShard shards[REGISTERS_SHARDS];
+	volatile int count;
+	volatile int readers;
+	vector<Register*> retired;
+	volatile int _sync_retired;
+	volatile int _sync_cleanup;
 	volatile u_int64_t register_failed_id;
 	volatile int _sync_register_failed_id;
 	u_int32_t last_cleanup_time;
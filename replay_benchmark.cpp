@@ -0,0 +1,138 @@
+#include "voipmonitor.h"
+
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include "replay_benchmark.h"
+#include "pstat.h"
+#include "tools.h"
+
+
+extern char opt_pb_read_from_file[256];
+extern volatile u_int64_t calls_counter_total;
+
+cReplayBenchmark *replayBenchmark;
+
+
+cReplayBenchmark::cReplayBenchmark(const char *report_file) {
+	this->report_file = report_file;
+	sql_mode = _sql_none;
+	start_us = 0;
+	read_end_us = 0;
+	process_end_us = 0;
+	packets = 0;
+	calls_start = 0;
+}
+
+void cReplayBenchmark::setSqlMode(const char *mode) {
+	sql_mode = !strcasecmp(mode, "files") ? _sql_files :
+		   !strcasecmp(mode, "db") ? _sql_db :
+		   _sql_none;
+}
+
+void cReplayBenchmark::setStart() {
+	start_us = getTimeUS();
+	calls_start = calls_counter_total;
+}
+
+void cReplayBenchmark::setReadEnd(u_int64_t packets) {
+	if(!read_end_us) {
+		read_end_us = getTimeUS();
+		this->packets = packets;
+	}
+}
+
+void cReplayBenchmark::setProcessEnd() {
+	if(!process_end_us) {
+		process_end_us = getTimeUS();
+	}
+}
+
+void cReplayBenchmark::report() {
+	string report = getReport();
+	if(report_file.empty() || report_file == "-") {
+		cout << report << endl;
+		return;
+	}
+	FILE *file = fopen(report_file.c_str(), "w");
+	if(!file) {
+		syslog(LOG_ERR, "benchmark: failed to create report file %s", report_file.c_str());
+		return;
+	}
+	fputs(report.c_str(), file);
+	fputs("\n", file);
+	fclose(file);
+	syslog(LOG_NOTICE, "benchmark: report saved to %s", report_file.c_str());
+}
+
+string cReplayBenchmark::getReport() {
+	u_int64_t end_us = getTimeUS();
+	if(!start_us) {
+		start_us = end_us;
+	}
+	if(!read_end_us) {
+		read_end_us = end_us;
+	}
+	if(!process_end_us) {
+		process_end_us = end_us;
+	}
+	double read_s = (read_end_us - start_us) / 1e6;
+	double process_s = (process_end_us - start_us) / 1e6;
+	double total_s = (end_us - start_us) / 1e6;
+	u_int64_t calls = calls_counter_total - calls_start;
+	JsonExport json;
+	json.add("version", RTPSENSOR_VERSION);
+	json.add("files", opt_pb_read_from_file);
+	json.add("sql", sql_mode == _sql_files ? "files" : sql_mode == _sql_db ? "db" : "none");
+	json.add("packets", packets);
+	json.add("calls", calls);
+	json.add("read_time_s", floatToString(read_s, 3, false), JsonExport::_number);
+	json.add("process_time_s", floatToString(process_s, 3, false), JsonExport::_number);
+	json.add("total_time_s", floatToString(total_s, 3, false), JsonExport::_number);
+	json.add("packets_per_s", floatToString(process_s > 0 ? packets / process_s : 0, 0, false), JsonExport::_number);
+	json.add("calls_per_s", floatToString(process_s > 0 ? calls / process_s : 0, 1, false), JsonExport::_number);
+	struct rusage usage;
+	if(!getrusage(RUSAGE_SELF, &usage)) {
+		json.add("peak_rss_kb", (long int)usage.ru_maxrss);
+		json.add("cpu_user_s", floatToString(usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6, 3, false), JsonExport::_number);
+		json.add("cpu_system_s", floatToString(usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6, 3, false), JsonExport::_number);
+	}
+	// cpu of threads alive at the end of benchmark (/proc/self/task)
+	JsonExport *threads = json.addArray("threads");
+	long ticks_per_s = sysconf(_SC_CLK_TCK);
+	DIR *dir = opendir("/proc/self/task");
+	if(dir) {
+		dirent *de;
+		while((de = readdir(dir)) != NULL) {
+			int tid = atoi(de->d_name);
+			if(tid <= 0) {
+				continue;
+			}
+			pstat_data pstat;
+			memset(&pstat, 0, sizeof(pstat));
+			if(!pstat_get_data(tid, &pstat)) {
+				continue;
+			}
+			double cpu_s = (double)(pstat.utime_ticks + pstat.stime_ticks) / ticks_per_s;
+			string name;
+			FILE *comm = fopen(("/proc/self/task/" + intToString(tid) + "/comm").c_str(), "r");
+			if(comm) {
+				char buff[100];
+				if(fgets(buff, sizeof(buff), comm)) {
+					name = buff;
+					while(!name.empty() && name[name.length() - 1] == '\n') {
+						name.resize(name.length() - 1);
+					}
+				}
+				fclose(comm);
+			}
+			JsonExport *thread = threads->addObject(NULL);
+			thread->add("tid", tid);
+			thread->add("name", name);
+			thread->add("cpu_s", floatToString(cpu_s, 3, false), JsonExport::_number);
+			thread->add("cpu_perc", floatToString(total_s > 0 ? cpu_s / total_s * 100 : 0, 1, false), JsonExport::_number);
+		}
+		closedir(dir);
+	}
+	return(json.getJson());
+}
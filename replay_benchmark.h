@@ -0,0 +1,47 @@
+#ifndef REPLAY_BENCHMARK_H
+#define REPLAY_BENCHMARK_H
+
+
+#include <string>
+#include <sys/types.h>
+
+
+/*
+ benchmark of offline replay (-r pb:... --benchmark=report)
+ - pcaps are read at maximum speed through complete pipeline (dedup, defrag, sip/rtp, call close, sql by --benchmark-sql)
+ - phases: read (first packet - end of last pcap), process (until packetbuffer is empty), total (after final cleanup of calls)
+ - report in json with packets/s, calls/s, cpu per thread and peak rss
+*/
+class cReplayBenchmark {
+public:
+	enum eSqlMode {
+		_sql_none,
+		_sql_files,
+		_sql_db
+	};
+public:
+	cReplayBenchmark(const char *report_file);
+	void setSqlMode(const char *mode);
+	eSqlMode getSqlMode() {
+		return(sql_mode);
+	}
+	void setStart();
+	void setReadEnd(u_int64_t packets);
+	void setProcessEnd();
+	void report();
+	std::string getReport();
+private:
+	std::string report_file;
+	eSqlMode sql_mode;
+	u_int64_t start_us;
+	u_int64_t read_end_us;
+	u_int64_t process_end_us;
+	u_int64_t packets;
+	u_int64_t calls_start;
+};
+
+
+extern cReplayBenchmark *replayBenchmark;
+
+
+#endif //REPLAY_BENCHMARK_H
@@ -7,6 +7,14 @@
 #include <unistd.h>
 #include <syslog.h>
 #include <string>
+#include <sstream>
+#include <iomanip>
+#include <sched.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #include "heap_safe.h"
 #include "sync.h"
@@ -180,5 +188,312 @@ private:
 };
 
 
+#define RQUEUE_RING_WAIT_SPIN 64
+#define RQUEUE_RING_WAIT_YIELD 16
+#define RQUEUE_RING_WAIT_DEFAULT_US 100
+
+/**
+  * Bounded ring with head/tail on separate cache lines and per-slot sequence numbers.
+  * Any number of producers (claim via CAS), single consumer.
+  * Interface is compatible with rqueue_quick - queues can be switched over one by one.
+  * Waiting on full/empty ring: spin -> sched_yield -> futex wait (timeout pushUsleep/popUsleep),
+  * the other side wakes waiters only if some are registered.
+  * Waiting ends also on termination - term_rqueue flag or term_check callback (setTermCheck),
+  * the callback lets the owner use the same condition as its thread loop.
+*/
+
+template<class typeItem>
+class rqueue_ring {
+public:
+	struct sStat {
+		u_int64_t push_count;
+		u_int64_t pop_count;
+		u_int64_t push_wait_count;
+		u_int64_t push_wait_us;
+		u_int64_t pop_wait_count;
+		u_int64_t pop_wait_us;
+		u_int32_t size_max;
+	};
+private:
+	struct sSlot {
+		volatile u_int64_t seq;
+		typeItem item;
+	};
+	struct sWait {
+		volatile u_int32_t event;
+		volatile u_int32_t waiters;
+	};
+public:
+	rqueue_ring(size_t length,
+		    unsigned int pushUsleep, unsigned int popUsleep,
+		    volatile int *term_rqueue,
+		    bool binaryBuffer) {
+		this->length = 1;
+		while(this->length < length) {
+			this->length <<= 1;
+		}
+		this->mask = this->length - 1;
+		this->pushUsleep = pushUsleep ? pushUsleep : RQUEUE_RING_WAIT_DEFAULT_US;
+		this->popUsleep = popUsleep ? popUsleep : RQUEUE_RING_WAIT_DEFAULT_US;
+		this->term_rqueue = term_rqueue;
+		this->term_check = NULL;
+		this->term_check_arg = NULL;
+		this->binaryBuffer = binaryBuffer;
+		slots = new FILE_LINE(21003) sSlot[this->length];
+		for(size_t i = 0; i < this->length; i++) {
+			slots[i].seq = i;
+		}
+		head = 0;
+		tail = 0;
+		memset((void*)&push_wait, 0, sizeof(push_wait));
+		memset((void*)&pop_wait, 0, sizeof(pop_wait));
+		memset((void*)&stat, 0, sizeof(stat));
+		memset((void*)&stat_last, 0, sizeof(stat_last));
+		_sync_lock = 0;
+	}
+	~rqueue_ring() {
+		delete [] slots;
+	}
+	void setTermCheck(bool (*term_check)(void *arg), void *term_check_arg) {
+		this->term_check_arg = term_check_arg;
+		this->term_check = term_check;
+	}
+	bool push(typeItem *item, bool waitForFree, bool /*useLock*/ = false) {
+		return(push_batch(item, 1, waitForFree) == 1);
+	}
+	unsigned push_batch(typeItem *items, unsigned count, bool waitForFree) {
+		if(count > length) {
+			count = length;
+		}
+		unsigned wait_round = 0;
+		u_int64_t wait_start = 0;
+		u_int64_t pos;
+		while(true) {
+			pos = tail;
+			sSlot *last = &slots[(pos + count - 1) & mask];
+			int64_t dif = (int64_t)(last->seq - (pos + count - 1));
+			if(dif == 0) {
+				if(__sync_bool_compare_and_swap(&tail, pos, pos + count)) {
+					break;
+				}
+				continue;
+			}
+			if(dif > 0) {
+				// another producer moved tail
+				continue;
+			}
+			if(!waitForFree || isTerm()) {
+				if(wait_start) {
+					addWaitTime(&stat.push_wait_us, wait_start);
+				}
+				return(0);
+			}
+			if(!wait_start) {
+				wait_start = getTimeUS_ring();
+				__sync_add_and_fetch(&stat.push_wait_count, 1);
+			}
+			wait(&push_wait, wait_round++, pushUsleep, false, pos + count - 1);
+		}
+		if(wait_start) {
+			addWaitTime(&stat.push_wait_us, wait_start);
+		}
+		for(unsigned i = 0; i < count; i++) {
+			sSlot *slot = &slots[(pos + i) & mask];
+			if(binaryBuffer) {
+				memcpy(CAST_OBJ_TO_VOID(&slot->item), &items[i], sizeof(typeItem));
+			} else {
+				slot->item = items[i];
+			}
+			__sync_synchronize();
+			slot->seq = pos + i + 1;
+		}
+		__sync_add_and_fetch(&stat.push_count, count);
+		wake(&pop_wait);
+		return(count);
+	}
+	bool pop(typeItem *item, bool waitForFree, bool /*useLock*/ = false) {
+		return(pop_batch(item, 1, waitForFree) == 1);
+	}
+	unsigned pop_batch(typeItem *items, unsigned max_count, bool waitForFree) {
+		unsigned wait_round = 0;
+		u_int64_t wait_start = 0;
+		while(!isReady(head)) {
+			if(!waitForFree || isTerm()) {
+				if(wait_start) {
+					addWaitTime(&stat.pop_wait_us, wait_start);
+				}
+				return(0);
+			}
+			if(!wait_start) {
+				wait_start = getTimeUS_ring();
+				++stat.pop_wait_count;
+			}
+			wait(&pop_wait, wait_round++, popUsleep, true, head);
+		}
+		if(wait_start) {
+			addWaitTime(&stat.pop_wait_us, wait_start);
+		}
+		updateSizeMax();
+		unsigned count = 0;
+		u_int64_t pos = head;
+		while(count < max_count && isReady(pos)) {
+			sSlot *slot = &slots[pos & mask];
+			if(binaryBuffer) {
+				memcpy(CAST_OBJ_TO_VOID(&items[count]), &slot->item, sizeof(typeItem));
+			} else {
+				items[count] = slot->item;
+			}
+			__sync_synchronize();
+			slot->seq = pos + length;
+			++pos;
+			++count;
+		}
+		head = pos;
+		stat.pop_count += count;
+		wake(&push_wait);
+		return(count);
+	}
+	u_int8_t popq(typeItem *item) {
+		return(pop_batch(item, 1, false));
+	}
+	bool get(typeItem *item) {
+		if(!isReady(head)) {
+			return(false);
+		}
+		sSlot *slot = &slots[head & mask];
+		if(binaryBuffer) {
+			memcpy(CAST_OBJ_TO_VOID(item), &slot->item, sizeof(typeItem));
+		} else {
+			*item = slot->item;
+		}
+		return(true);
+	}
+	void moveReadit() {
+		updateSizeMax();
+		u_int64_t pos = head;
+		__sync_synchronize();
+		slots[pos & mask].seq = pos + length;
+		head = pos + 1;
+		++stat.pop_count;
+		wake(&push_wait);
+	}
+	void lock() {
+		__SYNC_LOCK(this->_sync_lock);
+	}
+	void unlock() {
+		__SYNC_UNLOCK(this->_sync_lock);
+	}
+	size_t size() {
+		u_int64_t _head = head;
+		u_int64_t _tail = tail;
+		return(_tail > _head ? std::min((size_t)(_tail - _head), length) : 0);
+	}
+	size_t getLength() {
+		return(length);
+	}
+	void getStat(sStat *stat, bool reset_size_max = true) {
+		*stat = *(sStat*)&this->stat;
+		if(reset_size_max) {
+			this->stat.size_max = 0;
+		}
+	}
+	std::string getStatString() {
+		sStat _stat;
+		getStat(&_stat);
+		std::ostringstream outStr;
+		outStr << std::fixed;
+		outStr << "q" << std::setprecision(1) << (100. * _stat.size_max / length);
+		u_int64_t push_wait_us = _stat.push_wait_us - stat_last.push_wait_us;
+		u_int64_t pop_wait_us = _stat.pop_wait_us - stat_last.pop_wait_us;
+		if(push_wait_us || pop_wait_us) {
+			outStr << "w" << (push_wait_us / 1000) << ":" << (pop_wait_us / 1000);
+		}
+		stat_last = _stat;
+		return(outStr.str());
+	}
+private:
+	inline bool isReady(u_int64_t pos) {
+		return(slots[pos & mask].seq == pos + 1);
+	}
+	inline bool isFree(u_int64_t pos) {
+		return(slots[pos & mask].seq == pos);
+	}
+	inline bool isTerm() {
+		return((term_rqueue && *term_rqueue) ||
+		       (term_check && term_check(term_check_arg)));
+	}
+	inline void updateSizeMax() {
+		u_int32_t _size = size();
+		if(_size > stat.size_max) {
+			stat.size_max = _size;
+		}
+	}
+	void wait(sWait *wait, unsigned round, unsigned max_us, bool pop, u_int64_t pos) {
+		if(round < RQUEUE_RING_WAIT_SPIN) {
+			#if defined(__x86_64__) || defined(__i386__)
+			__asm__ volatile("pause");
+			#endif
+			return;
+		}
+		if(round < RQUEUE_RING_WAIT_SPIN + RQUEUE_RING_WAIT_YIELD) {
+			sched_yield();
+			return;
+		}
+		#ifdef __linux__
+		u_int32_t event = wait->event;
+		__sync_add_and_fetch(&wait->waiters, 1);
+		// re-check after registration (full barrier above) - pairs with barrier in wake,
+		// so either the other side sees the waiter or we see its change and do not sleep
+		if((pop ? !isReady(pos) : !isFree(pos)) && !isTerm()) {
+			timespec timeout;
+			timeout.tv_sec = max_us / 1000000;
+			timeout.tv_nsec = (max_us % 1000000) * 1000;
+			syscall(SYS_futex, &wait->event, FUTEX_WAIT_PRIVATE, event, &timeout, NULL, 0);
+		}
+		__sync_sub_and_fetch(&wait->waiters, 1);
+		#else
+		USLEEP(max_us);
+		#endif
+	}
+	inline void wake(sWait *wait) {
+		#ifdef __linux__
+		__sync_synchronize();
+		if(wait->waiters) {
+			__sync_add_and_fetch(&wait->event, 1);
+			syscall(SYS_futex, &wait->event, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+		}
+		#endif
+	}
+	inline void addWaitTime(volatile u_int64_t *wait_us, u_int64_t wait_start) {
+		__sync_add_and_fetch(wait_us, getTimeUS_ring() - wait_start);
+	}
+	static inline u_int64_t getTimeUS_ring() {
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return(time.tv_sec * 1000000ull + time.tv_nsec / 1000);
+	}
+private:
+	sSlot *slots;
+	size_t length;
+	u_int64_t mask;
+	bool binaryBuffer;
+	unsigned int pushUsleep;
+	unsigned int popUsleep;
+	volatile int *term_rqueue;
+	bool (*term_check)(void *arg);
+	void *term_check_arg;
+	char _pad_head[64];
+	volatile u_int64_t head;
+	char _pad_tail[64 - sizeof(u_int64_t)];
+	volatile u_int64_t tail;
+	char _pad_wait[64 - sizeof(u_int64_t)];
+	sWait push_wait;
+	sWait pop_wait;
+	volatile sStat stat;
+	sStat stat_last;
+	volatile int _sync_lock;
+};
+
+
 #endif
 
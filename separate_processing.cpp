@@ -475,6 +475,7 @@ void cSeparateProcessing::processRtpIpPort(sProcessRtpIpPortData *data) {
 			call->flags = iter->callData->call_flags;
 			strcpy_null_term(call->fbasename, call->call_id.c_str());
 			calltable->calls_listMAP[iter->call_id] = call;
+			calltable->calls_listMAP_index.add(call);
 		}
 		callid_map[iter->call_id] = call;
 		iter->call = call;
@@ -545,6 +546,7 @@ void cSeparateProcessing::processCloseCall(const char *call_id, sDataCloseCall *
 		call->flags = dataCloseCall->call_flags;
 		strcpy_null_term(call->fbasename, call_id);
 		calltable->calls_listMAP[call_id] = call;
+		calltable->calls_listMAP_index.add(call);
 	}
 	if(dataCloseCall->type == _destroy_call_if_not_exists_rtp &&
 	   (call->ssrc_n || call->first_rtp_time_us)) {
@@ -248,6 +248,7 @@ cSnifferServer::cSnifferServer() {
 cSnifferServer::~cSnifferServer() {
 	terminate = true;
 	terminateSocketInConnectionThreads();
+	reactor_stop();
 	unsigned counter = 0;
 	while(existConnectionThread() && counter < 100 && is_terminating() < 2) {
 		USLEEP(100000);
@@ -296,7 +297,7 @@ void cSnifferServer::createConnection(cSocket *socket) {
 		return;
 	}
 	cSnifferServerConnection *connection = new FILE_LINE(0) cSnifferServerConnection(socket, this);
-	connection->connection_start();
+	startConnection(connection);
 }
 
 void cSnifferServer::registerConnectionThread(class cSnifferServerConnection *connectionThread) {
@@ -340,6 +341,9 @@ void cSnifferServer::terminateSocketInConnectionThreads() {
 }
 
 
+map<string, cSnifferServerConnection::sPacketbufferBlockSession*> cSnifferServerConnection::packetbuffer_block_sessions;
+volatile int cSnifferServerConnection::_sync_packetbuffer_block_sessions = 0;
+
 cSnifferServerConnection::cSnifferServerConnection(cSocket *socket, cSnifferServer *server) 
  : cServerConnection(socket) {
 	_sync_tasks = 0;
@@ -348,10 +352,35 @@ cSnifferServerConnection::cSnifferServerConnection(cSocket *socket, cSnifferServ
 	orphan = false;
 	typeConnection = _tc_na;
 	this->server = server;
+	service_state = NULL;
+	query_sqlDb = NULL;
+	packetbuffer_block_counter = 0;
+	packetbuffer_block_session = NULL;
+	reactor_state = _rs_command;
+	reactor_command = NULL;
+	reactor_remainder = NULL;
+	reactor_remainder_length = 0;
+	reactor_gui_task_start_us = 0;
+	reactor_block = NULL;
+	reactor_block_length = 0;
+	reactor_rslt = false;
 }
 
 cSnifferServerConnection::~cSnifferServerConnection() {
 	server->unregisterConnectionThread(this);
+	if(service_state) {
+		delete service_state;
+	}
+	if(query_sqlDb) {
+		delete query_sqlDb;
+	}
+	if(reactor_command) {
+		delete reactor_command;
+	}
+	if(reactor_remainder) {
+		delete [] reactor_remainder;
+	}
+	packetbuffer_block_session_detach();
 	syslog(LOG_NOTICE, "close connection from %s:%i, socket: %i, type connection: %s", 
 	       socket->getIP().c_str(), socket->getPort(), socket->getHandle(),
 	       getTypeConnectionStr().c_str());
@@ -362,16 +391,7 @@ void cSnifferServerConnection::connection_process() {
 	JsonItem jsonData;
 	u_char *remainder = NULL;
 	size_t remainder_length = 0;
-	string str = socket->readLine(&remainder, &remainder_length);
-	if(!str.empty()) {
-		jsonData.parse(str.c_str());
-		typeConnection = convTypeConnection(jsonData.getValue("type_connection"));
-	}
-	if(SS_VERBOSE().connect_command) {
-		ostringstream verbstr;
-		verbstr << "CONNECTION PROCESS CMD: " << str;
-		syslog(LOG_INFO, "%s", verbstr.str().c_str());
-	}
+	readCommand(socket->readLine(&remainder, &remainder_length), &jsonData);
 	if(typeConnection != _tc_response && remainder) {
 		delete [] remainder;
 	}
@@ -409,10 +429,237 @@ void cSnifferServerConnection::connection_process() {
 void cSnifferServerConnection::evData(u_char */*data*/, size_t /*dataLen*/) {
 }
 
+cServerReactor::eWait cSnifferServerConnection::reactor_step(cServerReactor::eEvent event, u_int64_t *wait_ms) {
+	if(event == cServerReactor::_re_start) {
+		server->registerConnectionThread(this);
+		reactor_state = _rs_command;
+		*wait_ms = socket->getTimeoutReadBlock() * 1000ull;
+		return(cServerReactor::_rw_read);
+	}
+	if(server->isTerminate() || is_terminating()) {
+		return(reactorEnd());
+	}
+	switch(reactor_state) {
+	case _rs_command:
+		if(event == cServerReactor::_re_read) {
+			string line;
+			switch(socket->readLinePart(&line, &reactor_remainder, &reactor_remainder_length)) {
+			case cSocketBlock::_rp_incomplete:
+				*wait_ms = socket->getTimeoutReadBlock() * 1000ull;
+				return(cServerReactor::_rw_read);
+			case cSocketBlock::_rp_complete:
+				reactor_command = new FILE_LINE(0) JsonItem;
+				readCommand(line, reactor_command);
+				if(typeConnection != _tc_response && reactor_remainder) {
+					delete [] reactor_remainder;
+					reactor_remainder = NULL;
+				}
+				return(reactorCommand(wait_ms));
+			case cSocketBlock::_rp_error:
+				break;
+			}
+		}
+		break;
+	case _rs_wait_ready:
+		if(reactorIsReady()) {
+			reactor_state = _rs_init;
+			return(cServerReactor::_rw_task);
+		}
+		*wait_ms = 10;
+		return(cServerReactor::_rw_timer);
+	case _rs_init:
+		if(event == cServerReactor::_re_task_done && reactor_rslt) {
+			return(reactorInitDone(wait_ms));
+		}
+		break;
+	case _rs_blocks:
+		if(event == cServerReactor::_re_read) {
+			switch(socket->readBlockPart(&reactor_block, &reactor_block_length, cSocket::_te_aes, "", 1024 * 1024)) {
+			case cSocketBlock::_rp_incomplete:
+				*wait_ms = socket->getTimeoutReadBlock() * 1000ull;
+				return(cServerReactor::_rw_read);
+			case cSocketBlock::_rp_complete:
+				if(typeConnection == _tc_responses) {
+					cp_responses_block(reactor_block, reactor_block_length);
+					*wait_ms = socket->getTimeoutReadBlock() * 1000ull;
+					return(cServerReactor::_rw_read);
+				}
+				reactor_state = _rs_block_process;
+				return(cServerReactor::_rw_task);
+			case cSocketBlock::_rp_error:
+				break;
+			}
+		}
+		break;
+	case _rs_block_process:
+		if(event == cServerReactor::_re_task_done && reactor_rslt) {
+			reactor_state = _rs_blocks;
+			*wait_ms = socket->getTimeoutReadBlock() * 1000ull;
+			return(cServerReactor::_rw_read);
+		}
+		break;
+	case _rs_gui_wait:
+		if(snifferServerGuiTasks.getTaskState(reactor_gui_task.id) == sSnifferServerGuiTask::_complete) {
+			break;
+		}
+		if(getTimeUS() > reactor_gui_task_start_us + 5 * 60 * 1000000ull) {
+			socket->write("timeout");
+			break;
+		}
+		*wait_ms = 10;
+		return(cServerReactor::_rw_timer);
+	case _rs_service:
+		reactor_state = _rs_service_tick;
+		return(cServerReactor::_rw_task);
+	case _rs_service_tick:
+		if(event == cServerReactor::_re_task_done && reactor_rslt) {
+			reactor_state = _rs_service;
+			*wait_ms = service_state->service.remote_chart_server ? 10 : 100;
+			return(cServerReactor::_rw_timer);
+		}
+		break;
+	}
+	return(reactorEnd());
+}
+
+void cSnifferServerConnection::reactor_task() {
+	reactor_rslt = false;
+	switch(reactor_state) {
+	case _rs_init:
+		switch(typeConnection) {
+		case _tc_service:
+			reactor_rslt = cp_service_init();
+			break;
+		case _tc_response:
+			cp_respone_process(reactor_command->getValue("gui_task_id"), reactor_remainder, reactor_remainder_length);
+			reactor_remainder = NULL;
+			break;
+		case _tc_responses:
+		case _tc_packetbuffer_block:
+			reactor_rslt = rsaAesInit();
+			break;
+		case _tc_query:
+			reactor_rslt = cp_query_init();
+			break;
+		case _tc_store:
+			reactor_rslt = cp_store_init();
+			break;
+		default:
+			break;
+		}
+		break;
+	case _rs_block_process:
+		switch(typeConnection) {
+		case _tc_query:
+			cp_query_block(reactor_block, reactor_block_length);
+			reactor_rslt = true;
+			break;
+		case _tc_store:
+			reactor_rslt = cp_store_block(reactor_block, reactor_block_length);
+			break;
+		case _tc_packetbuffer_block:
+			reactor_rslt = cp_packetbuffer_block_process(reactor_block, reactor_block_length);
+			break;
+		default:
+			break;
+		}
+		break;
+	case _rs_service_tick:
+		for(unsigned i = 0; i < 1000 && !server->isTerminate() && !terminate; i++) {
+			eServiceStep step = cp_service_step(0);
+			if(step == _ss_continue) {
+				continue;
+			}
+			reactor_rslt = step != _ss_stop;
+			break;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+cServerReactor::eWait cSnifferServerConnection::reactorCommand(u_int64_t *wait_ms) {
+	switch(typeConnection) {
+	case _tc_gui_command:
+		if(!cp_gui_command_start(atol(reactor_command->getValue("sensor_id").c_str()), reactor_command->getValue("command"), &reactor_gui_task)) {
+			return(reactorEnd());
+		}
+		reactor_gui_task_start_us = getTimeUS();
+		reactor_state = _rs_gui_wait;
+		*wait_ms = 10;
+		return(cServerReactor::_rw_timer);
+	case _tc_manager_command:
+		cp_manager_command_process(reactor_command->getValue("command"));
+		return(reactorEnd());
+	case _tc_service:
+	case _tc_response:
+	case _tc_responses:
+	case _tc_query:
+		reactor_state = _rs_init;
+		return(cServerReactor::_rw_task);
+	case _tc_store:
+	case _tc_packetbuffer_block:
+		if(typeConnection == _tc_packetbuffer_block) {
+			syslog(LOG_NOTICE, "accept new connection from %s:%i, socket: %i", 
+			       socket->getIP().c_str(), socket->getPort(), socket->getHandle());
+		}
+		reactor_state = _rs_wait_ready;
+		if(reactorIsReady()) {
+			reactor_state = _rs_init;
+			return(cServerReactor::_rw_task);
+		}
+		*wait_ms = 10;
+		return(cServerReactor::_rw_timer);
+	default:
+		break;
+	}
+	return(reactorEnd());
+}
+
+cServerReactor::eWait cSnifferServerConnection::reactorInitDone(u_int64_t *wait_ms) {
+	switch(typeConnection) {
+	case _tc_service:
+		reactor_state = _rs_service;
+		*wait_ms = 0;
+		return(cServerReactor::_rw_timer);
+	case _tc_responses:
+	case _tc_query:
+	case _tc_store:
+	case _tc_packetbuffer_block:
+		reactor_state = _rs_blocks;
+		*wait_ms = socket->getTimeoutReadBlock() * 1000ull;
+		return(cServerReactor::_rw_read);
+	default:
+		break;
+	}
+	return(reactorEnd());
+}
+
+cServerReactor::eWait cSnifferServerConnection::reactorEnd() {
+	if(reactor_state == _rs_gui_wait) {
+		snifferServerGuiTasks.remove(&reactor_gui_task);
+	} else if(service_state) {
+		cp_service_end();
+	}
+	return(cServerReactor::_rw_end);
+}
+
+bool cSnifferServerConnection::reactorIsReady() {
+	if(typeConnection == _tc_store) {
+		return(dbDataIsSet());
+	} else if(typeConnection == _tc_packetbuffer_block) {
+		extern PcapQueue_readFromFifo *pcapQueueQ;
+		return(pcapQueueQ && pcapQueueQ->threadInitIsOk());
+	}
+	return(true);
+}
+
 void cSnifferServerConnection::addTask(sSnifferServerGuiTask task) {
 	lock_tasks();
 	tasks.push(task);
 	unlock_tasks();
+	reactor_wake();
 }
 
 sSnifferServerGuiTask cSnifferServerConnection::getTask() {
@@ -437,6 +684,24 @@ bool cSnifferServerConnection::checkPassword(string password, string *rsltStr) {
 }
 
 void cSnifferServerConnection::cp_gui_command(int32_t sensor_id, string command) {
+	sSnifferServerGuiTask task;
+	if(!cp_gui_command_start(sensor_id, command, &task)) {
+		delete this;
+		return;
+	}
+	u_int64_t startTime = getTimeUS();
+	while(snifferServerGuiTasks.getTaskState(task.id) != sSnifferServerGuiTask::_complete && !is_terminating()) {
+		USLEEP(1000);
+		if(getTimeUS() > startTime + 5 * 60 * 1000000ull) {
+			socket->write("timeout");
+			break;
+		}
+	}
+	snifferServerGuiTasks.remove(&task);
+	delete this;
+}
+
+bool cSnifferServerConnection::cp_gui_command_start(int32_t sensor_id, string command, sSnifferServerGuiTask *task) {
 	if(SS_VERBOSE().connect_info) {
 		ostringstream verbstr;
 		verbstr << "GUI COMAND: "
@@ -447,8 +712,7 @@ void cSnifferServerConnection::cp_gui_command(int32_t sensor_id, string command)
 	cSnifferServerConnection *service_connection = snifferServerServices.getServiceConnection(sensor_id, NULL);
 	if(!service_connection) {
 		socket->write("missing sniffer service - connect sensor?");
-		delete this;
-		return;
+		return(false);
 	}
 	if(SS_VERBOSE().connect_info_ext) {
 		ostringstream verbstr;
@@ -456,39 +720,46 @@ void cSnifferServerConnection::cp_gui_command(int32_t sensor_id, string command)
 			<< "addr: " << service_connection;
 		syslog(LOG_INFO, "%s", verbstr.str().c_str());
 	}
-	sSnifferServerGuiTask task;
-	task.sensor_id = sensor_id;
-	task.command = command;
-	task.setTimeId();
-	task.gui_connection = this;
-	snifferServerGuiTasks.add(&task);
-	service_connection->addTask(task);
-	u_int64_t startTime = getTimeUS();
-	while(snifferServerGuiTasks.getTaskState(task.id) != sSnifferServerGuiTask::_complete && !is_terminating()) {
-		USLEEP(1000);
-		if(getTimeUS() > startTime + 5 * 60 * 1000000ull) {
-			socket->write("timeout");
+	task->sensor_id = sensor_id;
+	task->command = command;
+	task->setTimeId();
+	task->gui_connection = this;
+	snifferServerGuiTasks.add(task);
+	service_connection->addTask(*task);
+	return(true);
+}
+
+void cSnifferServerConnection::cp_service() {
+	if(!cp_service_init()) {
+		delete this;
+		return;
+	}
+	while(!server->isTerminate() &&
+	      !terminate) {
+		eServiceStep step = cp_service_step(100);
+		if(step == _ss_stop) {
 			break;
 		}
+		if(step == _ss_sleep) {
+			USLEEP(1000);
+		}
 	}
-	snifferServerGuiTasks.remove(&task);
+	cp_service_end();
 	delete this;
 }
 
-void cSnifferServerConnection::cp_service() {
+bool cSnifferServerConnection::cp_service_init() {
 	socket->generate_rsa_keys(4096);
 	JsonExport json_rsa_key;
 	json_rsa_key.add("rsa_key", socket->get_rsa_pub_key());
 	if(!socket->writeBlock(json_rsa_key.getJson())) {
 		socket->setError("failed send rsa key");
-		delete this;
-		return;
+		return(false);
 	}
 	string rsltPasswordAesKeys;
 	if(!socket->readBlock(&rsltPasswordAesKeys, cSocket::_te_rsa) || rsltPasswordAesKeys.find("password") == string::npos) {
 		socket->setError("failed read password & aes keys");
-		delete this;
-		return;
+		return(false);
 	}
 	JsonItem jsonPasswordAesKeys;
 	jsonPasswordAesKeys.parse(rsltPasswordAesKeys);
@@ -503,36 +774,33 @@ void cSnifferServerConnection::cp_service() {
 		string error = "need upgrade sensor!!!";
 		socket->writeBlock(error);
 		socket->setError(error.c_str());
-		delete this;
-		return;
+		return(false);
 	}
 	string checkPasswordRsltStr;
 	if(!checkPassword(password, &checkPasswordRsltStr)) {
 		socket->writeBlock(checkPasswordRsltStr);
 		socket->setError(checkPasswordRsltStr.c_str());
-		delete this;
-		return;
+		return(false);
 	}
 	if(sensor_id == max(opt_id_sensor, 0) && sensor_string.empty()) {
 		string error = "client sensor_id must be different from receiver sensor_id";
 		socket->writeBlock(error);
 		socket->setError(error.c_str());
-		delete this;
-		return;
+		return(false);
 	}
 	if(jsonPasswordAesKeys.getValue("restore").empty() &&
 	   snifferServerServices.existsService(sensor_id, sensor_string.c_str())) {
 		string error = "client with sensor_id " + intToString(sensor_id) + " is already connected, refusing connection";
 		socket->writeBlock(error);
 		socket->setError(error.c_str());
-		delete this;
-		return;
+		return(false);
 	}
-	bool checkPingResponse = atoi(jsonPasswordAesKeys.getValue("check_ping_response").c_str()) > 0;
+	sServiceState state;
+	state.check_ping_response = atoi(jsonPasswordAesKeys.getValue("check_ping_response").c_str()) > 0;
 	bool autoParameters = atoi(jsonPasswordAesKeys.getValue("auto_parameters").c_str()) > 0;
 	bool remote_chart_server = atoi(jsonPasswordAesKeys.getValue("remote_chart_server").c_str()) > 0; 
-	bool use_encode_data = atoi(jsonPasswordAesKeys.getValue("use_encode_data").c_str()) > 0;
-	if(use_encode_data) {
+	state.use_encode_data = atoi(jsonPasswordAesKeys.getValue("use_encode_data").c_str()) > 0;
+	if(state.use_encode_data) {
 		socket->set_aes_keys(aes_ckey, aes_ivec);
 	}
 	string okAndParameters;
@@ -545,7 +813,9 @@ void cSnifferServerConnection::cp_service() {
 			ok_parameters.add("use_blocks_pb", true);
 		}
 		if(opt_dup_check) {
+			extern int opt_dup_check_hash;
 			ok_parameters.add("deduplicate", true);
+			ok_parameters.add("deduplicate_hash", opt_dup_check_hash);
 		}
 		if(useNewStore()) {
 			ok_parameters.add("mysql_new_store", useNewStore());
@@ -571,8 +841,7 @@ void cSnifferServerConnection::cp_service() {
 	}
 	if(!socket->writeBlock(okAndParameters)) {
 		socket->setError("failed send ok");
-		delete this;
-		return;
+		return(false);
 	}
 	if(SS_VERBOSE().connect_info) {
 		ostringstream verbstr;
@@ -586,140 +855,147 @@ void cSnifferServerConnection::cp_service() {
 	if(!is_read_from_file_simple() && !is_load_pcap_via_client(sensor_string.c_str())) {
 		updateSensorState(sensor_id);
 	}
-	sSnifferServerService service;
-	service.connect_ip = socket->getIPL();
-	service.connect_port = socket->getPort();
-	service.sensor_id = sensor_id;
-	service.sensor_string = sensor_string;
-	service.service_connection = this;
-	service.aes_ckey = aes_ckey;
-	service.aes_ivec = aes_ivec;
-	service.remote_chart_server = remote_chart_server;
-	snifferServerServices.add(&service);
-	u_int64_t lastWriteTimeUS = 0;
-	u_int64_t wait_remote_chart_server_processing_to_time_ms = 0;
-	unsigned errors_counter = 0;
-	while(!server->isTerminate() &&
-	      !terminate) {
-		u_int64_t time_us = getTimeUS();
-		if(stop || !socket->checkHandleRead()) {
-			if(SS_VERBOSE().connect_info) {
-				ostringstream verbstr;
-				verbstr << "SNIFFER SERVICE STOP: "
-					<< "sensor_id: " << sensor_id;
-				if(!sensor_string.empty()) {
-					verbstr << ", " << "sensor_string: " << sensor_string;
-				}
-				syslog(LOG_INFO, "%s", verbstr.str().c_str());
-			}
-			break;
-		}
-		if(errors_counter > 100) {
+	state.service.connect_ip = socket->getIPL();
+	state.service.connect_port = socket->getPort();
+	state.service.sensor_id = sensor_id;
+	state.service.sensor_string = sensor_string;
+	state.service.service_connection = this;
+	state.service.aes_ckey = aes_ckey;
+	state.service.aes_ivec = aes_ivec;
+	state.service.remote_chart_server = remote_chart_server;
+	service_state = new FILE_LINE(0) sServiceState(state);
+	snifferServerServices.add(&service_state->service);
+	return(true);
+}
+
+cSnifferServerConnection::eServiceStep cSnifferServerConnection::cp_service_step(int check_read_timeout_ms) {
+	int32_t sensor_id = service_state->service.sensor_id;
+	string sensor_string = service_state->service.sensor_string;
+	u_int64_t time_us = getTimeUS();
+	if(stop || !socket->checkHandleRead(check_read_timeout_ms)) {
+		if(SS_VERBOSE().connect_info) {
 			ostringstream verbstr;
-			verbstr << "SNIFFER SERVICE STOP (because too many errors): "
+			verbstr << "SNIFFER SERVICE STOP: "
 				<< "sensor_id: " << sensor_id;
 			if(!sensor_string.empty()) {
 				verbstr << ", " << "sensor_string: " << sensor_string;
 			}
 			syslog(LOG_INFO, "%s", verbstr.str().c_str());
-			break;
 		}
-		sSnifferServerGuiTask task = getTask();
-		if(!task.id.empty()) {
-			string idCommand = task.id + "/" + task.command;
-			socket->writeBlock(idCommand, use_encode_data ? cSocket::_te_aes : cSocket::_te_na);
-			lastWriteTimeUS = time_us;
-			continue;
+		return(_ss_stop);
+	}
+	if(service_state->errors_counter > 100) {
+		ostringstream verbstr;
+		verbstr << "SNIFFER SERVICE STOP (because too many errors): "
+			<< "sensor_id: " << sensor_id;
+		if(!sensor_string.empty()) {
+			verbstr << ", " << "sensor_string: " << sensor_string;
 		}
-		if(remote_chart_server &&
-		   (!wait_remote_chart_server_processing_to_time_ms ||
-		    getTimeMS() > wait_remote_chart_server_processing_to_time_ms)) {
-			wait_remote_chart_server_processing_to_time_ms = 0;
-			string *rchs_query = snifferServerServices.get_rchs_query();
-			if(rchs_query) {
-				bool okSend = true;
-				if(snifferServerOptions.type_compress == _cs_compress_gzip) {
-					cGzip gzipCompressQuery;
-					u_char *queryGzip;
-					size_t queryGzipLength;
-					if(gzipCompressQuery.compressString(*rchs_query, &queryGzip, &queryGzipLength)) {
-						if(!socket->writeBlock((u_char*)("rch:" + string((char*)queryGzip, queryGzipLength)).c_str(), queryGzipLength + 4, 
-								       use_encode_data ? cSocket::_te_aes : cSocket::_te_na)) {
-							okSend = false;
-						}
-						delete [] queryGzip;
-					}
-				} else if(snifferServerOptions.type_compress == _cs_compress_lzo) {
-					cLzo lzoCompressQuery;
-					u_char *queryLzo;
-					size_t queryLzoLength;
-					if(lzoCompressQuery.compress((u_char*)rchs_query->c_str(), rchs_query->length(), &queryLzo, &queryLzoLength)) {
-						if(!socket->writeBlock((u_char*)("rch:" + string((char*)queryLzo, queryLzoLength)).c_str(), queryLzoLength + 4, 
-								       use_encode_data ? cSocket::_te_aes : cSocket::_te_na)) {
-							okSend = false;
-						}
-						delete [] queryLzo;
+		syslog(LOG_INFO, "%s", verbstr.str().c_str());
+		return(_ss_stop);
+	}
+	sSnifferServerGuiTask task = getTask();
+	if(!task.id.empty()) {
+		string idCommand = task.id + "/" + task.command;
+		socket->writeBlock(idCommand, service_state->use_encode_data ? cSocket::_te_aes : cSocket::_te_na);
+		service_state->last_write_time_us = time_us;
+		return(_ss_continue);
+	}
+	if(service_state->service.remote_chart_server &&
+	   (!service_state->wait_remote_chart_server_processing_to_time_ms ||
+	    getTimeMS() > service_state->wait_remote_chart_server_processing_to_time_ms)) {
+		service_state->wait_remote_chart_server_processing_to_time_ms = 0;
+		string *rchs_query = snifferServerServices.get_rchs_query();
+		if(rchs_query) {
+			bool okSend = true;
+			if(snifferServerOptions.type_compress == _cs_compress_gzip) {
+				cGzip gzipCompressQuery;
+				u_char *queryGzip;
+				size_t queryGzipLength;
+				if(gzipCompressQuery.compressString(*rchs_query, &queryGzip, &queryGzipLength)) {
+					if(!socket->writeBlock((u_char*)("rch:" + string((char*)queryGzip, queryGzipLength)).c_str(), queryGzipLength + 4, 
+							       service_state->use_encode_data ? cSocket::_te_aes : cSocket::_te_na)) {
+						okSend = false;
 					}
-				} else {
-					if(!socket->writeBlock(("rch:" + *rchs_query).c_str(), use_encode_data ? cSocket::_te_aes : cSocket::_te_na)) {
+					delete [] queryGzip;
+				}
+			} else if(snifferServerOptions.type_compress == _cs_compress_lzo) {
+				cLzo lzoCompressQuery;
+				u_char *queryLzo;
+				size_t queryLzoLength;
+				if(lzoCompressQuery.compress((u_char*)rchs_query->c_str(), rchs_query->length(), &queryLzo, &queryLzoLength)) {
+					if(!socket->writeBlock((u_char*)("rch:" + string((char*)queryLzo, queryLzoLength)).c_str(), queryLzoLength + 4, 
+							       service_state->use_encode_data ? cSocket::_te_aes : cSocket::_te_na)) {
 						okSend = false;
 					}
+					delete [] queryLzo;
 				}
-				if(!okSend) {
-					add_rchs_query(rchs_query, false);
-					syslog(LOG_NOTICE, "failed send data to remote chart client - try again after 1s");
-					wait_remote_chart_server_processing_to_time_ms = getTimeMS() + 1000;
-					++errors_counter;
-					continue;
+			} else {
+				if(!socket->writeBlock(("rch:" + *rchs_query).c_str(), service_state->use_encode_data ? cSocket::_te_aes : cSocket::_te_na)) {
+					okSend = false;
 				}
-				string response;
-				if(socket->readBlockTimeout(&response, 30) &&
-				   response == "OK") {
-					delete rchs_query;
-					errors_counter = 0;
+			}
+			if(!okSend) {
+				add_rchs_query(rchs_query, false);
+				syslog(LOG_NOTICE, "failed send data to remote chart client - try again after 1s");
+				service_state->wait_remote_chart_server_processing_to_time_ms = getTimeMS() + 1000;
+				++service_state->errors_counter;
+				return(_ss_continue);
+			}
+			string response;
+			if(socket->readBlockTimeout(&response, 30) &&
+			   response == "OK") {
+				delete rchs_query;
+				service_state->errors_counter = 0;
+			} else {
+				add_rchs_query(rchs_query, false);
+				if(response.empty()) {
+					syslog(LOG_NOTICE, "failed receive confirmation from remote chart client - try again after 1s");
+					service_state->wait_remote_chart_server_processing_to_time_ms = getTimeMS() + 1000;
 				} else {
-					add_rchs_query(rchs_query, false);
-					if(response.empty()) {
-						syslog(LOG_NOTICE, "failed receive confirmation from remote chart client - try again after 1s");
-						wait_remote_chart_server_processing_to_time_ms = getTimeMS() + 1000;
-					} else {
-						syslog(LOG_NOTICE, "remote chart client sent error '%s' - try again after 1s", response.c_str());
-						wait_remote_chart_server_processing_to_time_ms = getTimeMS() + 1000;
-					}
-					++errors_counter;
+					syslog(LOG_NOTICE, "remote chart client sent error '%s' - try again after 1s", response.c_str());
+					service_state->wait_remote_chart_server_processing_to_time_ms = getTimeMS() + 1000;
 				}
-				continue;
+				++service_state->errors_counter;
 			}
-		}
-		if(time_us > lastWriteTimeUS + 5000000ull) {
-			socket->writeBlock("ping", use_encode_data ? cSocket::_te_aes : cSocket::_te_na);
-			if(checkPingResponse) {
-				string pingResponse;
-				if(!socket->readBlockTimeout(&pingResponse, 5) ||
-				   pingResponse != "pong") {
-					if(SS_VERBOSE().connect_info) {
-						ostringstream verbstr;
-						verbstr << "SNIFFER SERVICE DISCONNECT: "
-							<< "sensor_id: " << sensor_id;
-						if(!sensor_string.empty()) {
-							verbstr << ", " << "sensor_string: " << sensor_string;
-						}
-						syslog(LOG_INFO, "%s", verbstr.str().c_str());
+			return(_ss_continue);
+		}
+	}
+	if(time_us > service_state->last_write_time_us + 5000000ull) {
+		socket->writeBlock("ping", service_state->use_encode_data ? cSocket::_te_aes : cSocket::_te_na);
+		if(service_state->check_ping_response) {
+			string pingResponse;
+			if(!socket->readBlockTimeout(&pingResponse, 5) ||
+			   pingResponse != "pong") {
+				if(SS_VERBOSE().connect_info) {
+					ostringstream verbstr;
+					verbstr << "SNIFFER SERVICE DISCONNECT: "
+						<< "sensor_id: " << sensor_id;
+					if(!sensor_string.empty()) {
+						verbstr << ", " << "sensor_string: " << sensor_string;
 					}
-					break;
+					syslog(LOG_INFO, "%s", verbstr.str().c_str());
 				}
+				return(_ss_stop);
 			}
-			lastWriteTimeUS = time_us;
 		}
-		USLEEP(1000);
+		service_state->last_write_time_us = time_us;
 	}
+	return(_ss_sleep);
+}
+
+void cSnifferServerConnection::cp_service_end() {
 	if(!orphan) {
-		snifferServerServices.remove(&service);
+		snifferServerServices.remove(&service_state->service);
 	}
-	delete this;
 }
 
 void cSnifferServerConnection::cp_respone(string gui_task_id, u_char *remainder, size_t remainder_length) {
+	cp_respone_process(gui_task_id, remainder, remainder_length);
+	delete this;
+}
+
+void cSnifferServerConnection::cp_respone_process(string gui_task_id, u_char *remainder, size_t remainder_length) {
 	cSnifferServerConnection *gui_connection = snifferServerGuiTasks.getGuiConnection(gui_task_id);
 	if(SS_VERBOSE().connect_info) {
 		ostringstream verbstr;
@@ -732,7 +1008,6 @@ void cSnifferServerConnection::cp_respone(string gui_task_id, u_char *remainder,
 		if(remainder) {
 			delete [] remainder;
 		}
-		delete this;
 		return;
 	}
 	sSnifferServerGuiTask task = snifferServerGuiTasks.getTask(gui_task_id);
@@ -743,7 +1018,6 @@ void cSnifferServerConnection::cp_respone(string gui_task_id, u_char *remainder,
 		if(remainder) {
 			delete [] remainder;
 		}
-		delete this;
 		return;
 	}
 	socket->set_aes_keys(aes_ckey, aes_ivec);
@@ -757,7 +1031,6 @@ void cSnifferServerConnection::cp_respone(string gui_task_id, u_char *remainder,
 		snifferServerServices.stopServiceBySensorId(sensor_id);
 	}
 	snifferServerGuiTasks.setTaskState(gui_task_id, sSnifferServerGuiTask::_complete);
-	delete this;
 }
 
 void cSnifferServerConnection::cp_responses() {
@@ -775,89 +1048,107 @@ void cSnifferServerConnection::cp_responses() {
 	unsigned counter = 0;
 	while(!server->isTerminate() &&
 	      (response = socket->readBlock(&responseLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
-		u_char response_last_char = response[responseLength - 1];
-		response[responseLength - 1] = 0;
-		u_char *response_task_id_separator = (u_char*)strchr((char*)response, '#');
-		response[responseLength - 1] = response_last_char;
-		if(!response_task_id_separator) {
-			socket->writeBlock("missing gui task id", cSocket::_te_aes);
-			continue;
-		}
-		string gui_task_id = string((char*)response, response_task_id_separator - response);
-		cSnifferServerConnection *gui_connection = snifferServerGuiTasks.getGuiConnection(gui_task_id);
-		if(!gui_connection) {
-			socket->writeBlock("unknown gui task id", cSocket::_te_aes);
-			continue;
-		}
-		if(gui_connection->socket->write(response_task_id_separator + 1,
-						 responseLength - (response_task_id_separator - response) - 1)) {
-			if(socket->writeBlock("OK", cSocket::_te_aes)) {
-				snifferServerGuiTasks.setTaskState(gui_task_id, sSnifferServerGuiTask::_complete);
-			}
-		}
+		cp_responses_block(response, responseLength);
 	}
 	delete this;
 }
 
+void cSnifferServerConnection::cp_responses_block(u_char *response, size_t responseLength) {
+	if(!responseLength) {
+		socket->writeBlock("missing gui task id", cSocket::_te_aes);
+		return;
+	}
+	u_char response_last_char = response[responseLength - 1];
+	response[responseLength - 1] = 0;
+	u_char *response_task_id_separator = (u_char*)strchr((char*)response, '#');
+	response[responseLength - 1] = response_last_char;
+	if(!response_task_id_separator) {
+		socket->writeBlock("missing gui task id", cSocket::_te_aes);
+		return;
+	}
+	string gui_task_id = string((char*)response, response_task_id_separator - response);
+	cSnifferServerConnection *gui_connection = snifferServerGuiTasks.getGuiConnection(gui_task_id);
+	if(!gui_connection) {
+		socket->writeBlock("unknown gui task id", cSocket::_te_aes);
+		return;
+	}
+	if(gui_connection->socket->write(response_task_id_separator + 1,
+					 responseLength - (response_task_id_separator - response) - 1)) {
+		if(socket->writeBlock("OK", cSocket::_te_aes)) {
+			snifferServerGuiTasks.setTaskState(gui_task_id, sSnifferServerGuiTask::_complete);
+		}
+	}
+}
+
 void cSnifferServerConnection::cp_query() {
-	if(!rsaAesInit()) {
+	if(!cp_query_init()) {
 		delete this;
 		return;
 	}
-	if(SS_VERBOSE().connect_info_ext) {
-		ostringstream verbstr;
-		verbstr << "SQL QUERY";
-		syslog(LOG_INFO, "%s", verbstr.str().c_str());
-	}
-	SqlDb *sqlDb = createSqlObject();
 	u_char *query;
 	size_t queryLength;
 	unsigned counter = 0;
 	while(!server->isTerminate() &&
 	      (query = socket->readBlock(&queryLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
-		string queryStr;
-		cGzip gzipDecompressQuery;
-		if(gzipDecompressQuery.isCompress(query, queryLength)) {
-			queryStr = gzipDecompressQuery.decompressString(query, queryLength);
-		} else {
-			queryStr = string((char*)query, queryLength);
-		}
-		if(!queryStr.empty()) {
-			sqlDb->setMaxQueryPass(1);
-			bool useCsvRslt = false;
-			if(queryStr.substr(0, 4) == "CSV:") {
-				queryStr = queryStr.substr(4);
-				useCsvRslt = true;
-			}
-			if(sqlDb->query(queryStr)) {
-				string rsltQuery = useCsvRslt ? sqlDb->getCsvResult() : sqlDb->getJsonResult();
-				if(rsltQuery.length() > 100) {
-					u_char *rsltQueryGzip;
-					size_t rsltQueryGzipLength;
-					cGzip gzipCompressResult;
-					if(gzipCompressResult.compressString(rsltQuery, &rsltQueryGzip, &rsltQueryGzipLength)) {
-						socket->writeBlock(rsltQueryGzip, rsltQueryGzipLength, cSocket::_te_aes);
-						delete [] rsltQueryGzip;
-					}
-				} else {
-					socket->writeBlock(rsltQuery, cSocket::_te_aes);
+		cp_query_block(query, queryLength);
+		++counter;
+	}
+	delete this;
+}
+
+bool cSnifferServerConnection::cp_query_init() {
+	if(!rsaAesInit()) {
+		return(false);
+	}
+	if(SS_VERBOSE().connect_info_ext) {
+		ostringstream verbstr;
+		verbstr << "SQL QUERY";
+		syslog(LOG_INFO, "%s", verbstr.str().c_str());
+	}
+	query_sqlDb = createSqlObject();
+	return(true);
+}
+
+void cSnifferServerConnection::cp_query_block(u_char *query, size_t queryLength) {
+	string queryStr;
+	cGzip gzipDecompressQuery;
+	if(gzipDecompressQuery.isCompress(query, queryLength)) {
+		queryStr = gzipDecompressQuery.decompressString(query, queryLength);
+	} else {
+		queryStr = string((char*)query, queryLength);
+	}
+	if(!queryStr.empty()) {
+		query_sqlDb->setMaxQueryPass(1);
+		bool useCsvRslt = false;
+		if(queryStr.substr(0, 4) == "CSV:") {
+			queryStr = queryStr.substr(4);
+			useCsvRslt = true;
+		}
+		if(query_sqlDb->query(queryStr)) {
+			string rsltQuery = useCsvRslt ? query_sqlDb->getCsvResult() : query_sqlDb->getJsonResult();
+			if(rsltQuery.length() > 100) {
+				u_char *rsltQueryGzip;
+				size_t rsltQueryGzipLength;
+				cGzip gzipCompressResult;
+				if(gzipCompressResult.compressString(rsltQuery, &rsltQueryGzip, &rsltQueryGzipLength)) {
+					socket->writeBlock(rsltQueryGzip, rsltQueryGzipLength, cSocket::_te_aes);
+					delete [] rsltQueryGzip;
 				}
 			} else {
-				if(sqlDb->getLastError() == ER_SP_ALREADY_EXISTS &&
-				   queryStr.find("create procedure ") == 0 &&
-				   queryStr.find("(") != string::npos) {
-					string procedureName = queryStr.substr(17, queryStr.find("(") - 17);
-					sqlDb->query("repair table mysql.proc");
-					sqlDb->query("drop procedure if exists " + procedureName);
-				}
-				string rsltError = sqlDb->getJsonError();
-				socket->writeBlock(rsltError, cSocket::_te_aes);
+				socket->writeBlock(rsltQuery, cSocket::_te_aes);
 			}
+		} else {
+			if(query_sqlDb->getLastError() == ER_SP_ALREADY_EXISTS &&
+			   queryStr.find("create procedure ") == 0 &&
+			   queryStr.find("(") != string::npos) {
+				string procedureName = queryStr.substr(17, queryStr.find("(") - 17);
+				query_sqlDb->query("repair table mysql.proc");
+				query_sqlDb->query("drop procedure if exists " + procedureName);
+			}
+			string rsltError = query_sqlDb->getJsonError();
+			socket->writeBlock(rsltError, cSocket::_te_aes);
 		}
-		++counter;
 	}
-	delete sqlDb;
-	delete this;
 }
 
 void cSnifferServerConnection::cp_store() {
@@ -868,110 +1159,121 @@ void cSnifferServerConnection::cp_store() {
 		}
 		USLEEP(1000);
 	}
-	if(!rsaAesInit(false)) {
+	if(!cp_store_init()) {
 		delete this;
 		return;
 	}
+	u_char *query;
+	size_t queryLength;
+	unsigned counter = 0;
+	while(!server->isTerminate() &&
+	      (query = socket->readBlock(&queryLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
+		if(!cp_store_block(query, queryLength)) {
+			break;
+		}
+		++counter;
+	}
+	delete this;
+}
+
+bool cSnifferServerConnection::cp_store_init() {
+	if(!rsaAesInit(false)) {
+		return(false);
+	}
 	JsonExport json_ok;
 	json_ok.add("rslt", "OK");
 	json_ok.add("check_store", 1);
 	json_ok.add("check_time", 1);
 	if(!socket->writeBlock(json_ok.getJson())) {
 		socket->setError("failed send ok");
-		delete this;
-		return;
+		return(false);
 	}
-	u_char *query;
-	size_t queryLength;
-	unsigned counter = 0;
-	while(!server->isTerminate() &&
-	      (query = socket->readBlock(&queryLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
-		if(queryLength == 5 && !strncmp((char*)query, "check", 5)) {
-			if(cp_store_check()) {
-				socket->writeBlock("OK", cSocket::_te_aes);
-			}
-			continue;
-		}
+	return(true);
+}
+
+bool cSnifferServerConnection::cp_store_block(u_char *query, size_t queryLength) {
+	if(queryLength == 5 && !strncmp((char*)query, "check", 5)) {
 		if(cp_store_check()) {
-			string queryStr;
-			cGzip gzipDecompressQuery;
-			cLzo lzoDecompressQuery;
-			if(gzipDecompressQuery.isCompress(query, queryLength)) {
-				queryStr = gzipDecompressQuery.decompressString(query, queryLength);
-			} else if(lzoDecompressQuery.isCompress(query, queryLength)) {
-				queryStr = lzoDecompressQuery.decompressString(query, queryLength);
-			} else {
-				queryStr = string((char*)query, queryLength);
-			}
-			if(!queryStr.empty()) {
-				size_t posStoreIdSeparator = queryStr.find('|');
-				if(posStoreIdSeparator != string::npos) {
-					int storeIdMain = atoi(queryStr.c_str());
-					while(!server->isSetSqlStore()) {
-						if(is_terminating()) {
-							delete this;
-							return;
-						}
-						USLEEP(1000);
+			socket->writeBlock("OK", cSocket::_te_aes);
+		}
+		return(true);
+	}
+	if(cp_store_check()) {
+		string queryStr;
+		cGzip gzipDecompressQuery;
+		cLzo lzoDecompressQuery;
+		if(gzipDecompressQuery.isCompress(query, queryLength)) {
+			queryStr = gzipDecompressQuery.decompressString(query, queryLength);
+		} else if(lzoDecompressQuery.isCompress(query, queryLength)) {
+			queryStr = lzoDecompressQuery.decompressString(query, queryLength);
+		} else {
+			queryStr = string((char*)query, queryLength);
+		}
+		if(!queryStr.empty()) {
+			size_t posStoreIdSeparator = queryStr.find('|');
+			if(posStoreIdSeparator != string::npos) {
+				int storeIdMain = atoi(queryStr.c_str());
+				while(!server->isSetSqlStore()) {
+					if(is_terminating()) {
+						return(false);
 					}
-					size_t posBeginQuery = posStoreIdSeparator + 1;
-					if(queryStr[posBeginQuery] == 'T' && isdigit(queryStr[posBeginQuery + 1])) {
-						size_t posTimeSeparator = queryStr.find('|', posBeginQuery);
-						if(posTimeSeparator != string::npos && posTimeSeparator - posBeginQuery <= 20) {
-							string query_time_str = queryStr.substr(posBeginQuery + 1, posTimeSeparator - posBeginQuery - 1);
-							time_t query_time = stringToTime(query_time_str.c_str());
-							time_t act_time = time(NULL);
-							if(query_time > act_time && query_time - act_time > 24 * 60 * 60) {
-								static uint64_t lastTimeSyslog =0;
-								u_int64_t actTime = getTimeMS();
-								if(actTime - 30000 > lastTimeSyslog) {
-									cLogSensor::log(cLogSensor::error, "client/server problem", "client time of %s is too greater than server time", socket->getHost().c_str());
-									lastTimeSyslog = actTime;
-								}
-								JsonExport exp;
-								exp.add("error", "client time is too greater than server time");
-								exp.add("next_attempt", false);
-								socket->writeBlock(exp.getJson(), cSocket::_te_aes);
-								delete this;
-								return;
+					USLEEP(1000);
+				}
+				size_t posBeginQuery = posStoreIdSeparator + 1;
+				if(queryStr[posBeginQuery] == 'T' && isdigit(queryStr[posBeginQuery + 1])) {
+					size_t posTimeSeparator = queryStr.find('|', posBeginQuery);
+					if(posTimeSeparator != string::npos && posTimeSeparator - posBeginQuery <= 20) {
+						string query_time_str = queryStr.substr(posBeginQuery + 1, posTimeSeparator - posBeginQuery - 1);
+						time_t query_time = stringToTime(query_time_str.c_str());
+						time_t act_time = time(NULL);
+						if(query_time > act_time && query_time - act_time > 24 * 60 * 60) {
+							static uint64_t lastTimeSyslog =0;
+							u_int64_t actTime = getTimeMS();
+							if(actTime - 30000 > lastTimeSyslog) {
+								cLogSensor::log(cLogSensor::error, "client/server problem", "client time of %s is too greater than server time", socket->getHost().c_str());
+								lastTimeSyslog = actTime;
 							}
-							posBeginQuery = posTimeSeparator + 1;
+							JsonExport exp;
+							exp.add("error", "client time is too greater than server time");
+							exp.add("next_attempt", false);
+							socket->writeBlock(exp.getJson(), cSocket::_te_aes);
+							return(false);
 						}
+						posBeginQuery = posTimeSeparator + 1;
 					}
-					int storeId2 = server->findMinStoreId2(storeIdMain);
-					if(queryStr[posBeginQuery] == 'L' && isdigit(queryStr[posBeginQuery + 1])) {
-						list<string> queriesStr;
-						size_t pos = posBeginQuery;
-						do {
-							if(queryStr[pos] != 'L') {
-								syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing 'L' separator");
-								break;
-							}
-							unsigned length = atoi(queryStr.c_str() + pos + 1);
-							size_t pos_sep = queryStr.find(':', pos);
-							if(pos_sep == string::npos) {
-								syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing ':' separator");
-								break;
-							}
-							pos = pos_sep + 1;
-							queriesStr.push_back(queryStr.substr(pos, length));
-							pos += length + 1;
-						} while(pos < queryStr.length());
-						if(!sverb.suppress_server_store) {
-							server->sql_query_lock(&queriesStr, storeIdMain, storeId2);
+				}
+				int storeId2 = server->findMinStoreId2(storeIdMain);
+				if(queryStr[posBeginQuery] == 'L' && isdigit(queryStr[posBeginQuery + 1])) {
+					list<string> queriesStr;
+					size_t pos = posBeginQuery;
+					do {
+						if(queryStr[pos] != 'L') {
+							syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing 'L' separator");
+							break;
 						}
-					} else {
-						if(!sverb.suppress_server_store) {
-							server->sql_query_lock(queryStr.substr(posBeginQuery).c_str(), storeIdMain, storeId2);
+						unsigned length = atoi(queryStr.c_str() + pos + 1);
+						size_t pos_sep = queryStr.find(':', pos);
+						if(pos_sep == string::npos) {
+							syslog(LOG_ERR, "cSnifferServerConnection::cp_store: missing ':' separator");
+							break;
 						}
+						pos = pos_sep + 1;
+						queriesStr.push_back(queryStr.substr(pos, length));
+						pos += length + 1;
+					} while(pos < queryStr.length());
+					if(!sverb.suppress_server_store) {
+						server->sql_query_lock(&queriesStr, storeIdMain, storeId2);
+					}
+				} else {
+					if(!sverb.suppress_server_store) {
+						server->sql_query_lock(queryStr.substr(posBeginQuery).c_str(), storeIdMain, storeId2);
 					}
-					socket->writeBlock("OK", cSocket::_te_aes);
 				}
+				socket->writeBlock("OK", cSocket::_te_aes);
 			}
 		}
-		++counter;
 	}
-	delete this;
+	return(true);
 }
 
 bool cSnifferServerConnection::cp_store_check() {
@@ -1006,43 +1308,67 @@ void cSnifferServerConnection::cp_packetbuffer_block() {
 	u_char *block;
 	size_t blockLength;
 	unsigned counter = 0;
-	u_int32_t block_counter = 0;
 	while(!server->isTerminate() &&
 	      (block = socket->readBlock(&blockLength, cSocket::_te_aes, "", counter > 0, 0, 1024 * 1024)) != NULL) {
-		if(is_readend() || !pcapQueueQ) {
+		if(!cp_packetbuffer_block_process(block, blockLength)) {
 			break;
 		}
-		string errorAddBlock;
-		string warningAddBlock;
-		bool require_confirmation = true;
-		bool rsltAddBlock = pcapQueueQ->addBlockStoreToPcapStoreQueue(block, blockLength, &errorAddBlock, &warningAddBlock, &block_counter, &require_confirmation);
-		if(require_confirmation) {
-			if(rsltAddBlock) {
-				socket->writeBlock("OK", cSocket::_te_aes);
-			} else {
-				socket->writeBlock(errorAddBlock, cSocket::_te_aes);
-			}
-		}
 		++counter;
-		if(!errorAddBlock.empty()) {
-			cLogSensor::log(cLogSensor::error, 
-					"error in receiving packets from client",
-					"connection from %s, error: %s", 
-					socket->getIP().c_str(),
-					errorAddBlock.c_str());
-		}
-		if(!warningAddBlock.empty()) {
-			cLogSensor::log(cLogSensor::warning, 
-					"warning in receiving packets from client",
-					"connection from %s, warning: %s", 
-					socket->getIP().c_str(),
-					warningAddBlock.c_str());
-		}
 	}
 	delete this;
 }
 
+bool cSnifferServerConnection::cp_packetbuffer_block_process(u_char *block, size_t blockLength) {
+	extern PcapQueue_readFromFifo *pcapQueueQ;
+	if(is_readend() || !pcapQueueQ) {
+		return(false);
+	}
+	string errorAddBlock;
+	string warningAddBlock;
+	bool require_confirmation = true;
+	u_int32_t *block_counter = &packetbuffer_block_counter;
+	if(packetbuffer_block_session) {
+		// connections of one sender process share the accepted block counter - blocks resent after reconnect are dropped
+		while(__sync_lock_test_and_set(&packetbuffer_block_session->_sync, 1)) {
+			USLEEP(10);
+		}
+		block_counter = &packetbuffer_block_session->block_counter;
+	}
+	bool rsltAddBlock = pcapQueueQ->addBlockStoreToPcapStoreQueue(block, blockLength, &errorAddBlock, &warningAddBlock, block_counter, &require_confirmation);
+	if(packetbuffer_block_session) {
+		packetbuffer_block_session->last_use_s = getTimeS();
+		__sync_lock_release(&packetbuffer_block_session->_sync);
+	}
+	if(require_confirmation) {
+		if(rsltAddBlock) {
+			socket->writeBlock("OK", cSocket::_te_aes);
+		} else {
+			socket->writeBlock(errorAddBlock, cSocket::_te_aes);
+		}
+	}
+	if(!errorAddBlock.empty()) {
+		cLogSensor::log(cLogSensor::error, 
+				"error in receiving packets from client",
+				"connection from %s, error: %s", 
+				socket->getIP().c_str(),
+				errorAddBlock.c_str());
+	}
+	if(!warningAddBlock.empty()) {
+		cLogSensor::log(cLogSensor::warning, 
+				"warning in receiving packets from client",
+				"connection from %s, warning: %s", 
+				socket->getIP().c_str(),
+				warningAddBlock.c_str());
+	}
+	return(true);
+}
+
 void cSnifferServerConnection::cp_manager_command(string command) {
+	cp_manager_command_process(command);
+	delete this;
+}
+
+void cSnifferServerConnection::cp_manager_command_process(string command) {
 	if(SS_VERBOSE().connect_info) {
 		ostringstream verbstr;
 		verbstr << "MANAGER COMAND: "
@@ -1056,7 +1382,19 @@ void cSnifferServerConnection::cp_manager_command(string command) {
 		rslt = "unknown command: " + command;
 	}
 	socket->write(rslt);
-	delete this;
+}
+
+bool cSnifferServerConnection::readCommand(string line, JsonItem *jsonData) {
+	if(!line.empty()) {
+		jsonData->parse(line.c_str());
+		typeConnection = convTypeConnection(jsonData->getValue("type_connection"));
+	}
+	if(SS_VERBOSE().connect_command) {
+		ostringstream verbstr;
+		verbstr << "CONNECTION PROCESS CMD: " << line;
+		syslog(LOG_INFO, "%s", verbstr.str().c_str());
+	}
+	return(typeConnection != _tc_na);
 }
 
 bool cSnifferServerConnection::rsaAesInit(bool writeRsltOK) {
@@ -1109,15 +1447,63 @@ bool cSnifferServerConnection::rsaAesInit(bool writeRsltOK) {
 			}
 		}
 	}
+	if(typeConnection == _tc_packetbuffer_block) {
+		string blockSession = jsonTokenAesKeys.getValue("block_session");
+		if(blockSession.length()) {
+			packetbuffer_block_session_attach(jsonTokenAesKeys.getValue("sensor_id") + ":" + blockSession);
+		}
+	}
+	bool aes_gcm = typeConnection == _tc_packetbuffer_block &&
+		       jsonTokenAesKeys.getValue("aes_mode") == "gcm";
 	if(writeRsltOK) {
-		if(!socket->writeBlock("OK")) {
+		if(!socket->writeBlock(aes_gcm ? "OK aes_gcm" : "OK")) {
 			socket->setError("failed send ok");
 			return(false);
 		}
 	}
+	if(aes_gcm) {
+		socket->set_aes_mode(cAes::_mode_gcm);
+	}
 	return(true);
 }
 
+void cSnifferServerConnection::packetbuffer_block_session_attach(string session) {
+	packetbuffer_block_session_detach();
+	u_int32_t time_s = getTimeS();
+	lock_packetbuffer_block_sessions();
+	for(map<string, sPacketbufferBlockSession*>::iterator iter = packetbuffer_block_sessions.begin(); iter != packetbuffer_block_sessions.end(); ) {
+		if(!iter->second->connections && iter->second->last_use_s + 3600 < time_s) {
+			delete iter->second;
+			packetbuffer_block_sessions.erase(iter++);
+		} else {
+			iter++;
+		}
+	}
+	sPacketbufferBlockSession *blockSession;
+	map<string, sPacketbufferBlockSession*>::iterator iter = packetbuffer_block_sessions.find(session);
+	if(iter != packetbuffer_block_sessions.end()) {
+		blockSession = iter->second;
+	} else {
+		blockSession = new FILE_LINE(0) sPacketbufferBlockSession;
+		packetbuffer_block_sessions[session] = blockSession;
+	}
+	++blockSession->connections;
+	blockSession->last_use_s = time_s;
+	packetbuffer_block_session = blockSession;
+	unlock_packetbuffer_block_sessions();
+}
+
+void cSnifferServerConnection::packetbuffer_block_session_detach() {
+	if(!packetbuffer_block_session) {
+		return;
+	}
+	lock_packetbuffer_block_sessions();
+	--packetbuffer_block_session->connections;
+	packetbuffer_block_session->last_use_s = getTimeS();
+	packetbuffer_block_session = NULL;
+	unlock_packetbuffer_block_sessions();
+}
+
 cSnifferServerConnection::eTypeConnection cSnifferServerConnection::convTypeConnection(string typeConnection) {
 	if(typeConnection == "gui_command") {
 		return(_tc_gui_command);
@@ -1327,6 +1713,14 @@ bool cSnifferClientService::receive_process_loop_begin() {
 							syslog(LOG_NOTICE, "enabling deduplicate because it is enabled on server");
 							change_config = true;
 						}
+						if(!rsltConnectData_json.getValue("deduplicate_hash").empty()) {
+							extern int opt_dup_check_hash;
+							int server_dup_check_hash = atoi(rsltConnectData_json.getValue("deduplicate_hash").c_str());
+							if(server_dup_check_hash && server_dup_check_hash != opt_dup_check_hash) {
+								opt_dup_check_hash = server_dup_check_hash;
+								syslog(LOG_NOTICE, "set deduplicate_hash to %s because it is set on server", dedup_hash_type_name(opt_dup_check_hash));
+							}
+						}
 						if(change_config) {
 							extern void set_context_config();
 							set_context_config();
@@ -1668,6 +2062,9 @@ void snifferServerStart() {
 		delete snifferServer;
 	}
 	snifferServer =  new FILE_LINE(0) cSnifferServer;
+	if(snifferServerOptions.reactor) {
+		snifferServer->setReactor(snifferServerOptions.reactor_workers, snifferServerOptions.reactor_task_threads);
+	}
 	snifferServer->listen_start("sniffer_server", snifferServerOptions.host, snifferServerOptions.port);
 }
 
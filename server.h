@@ -42,6 +42,9 @@ struct sSnifferServerOptions {
 		mysql_redirect_queue_limit = 0;
 		mysql_concat_limit = 1000;
 		type_compress = _cs_compress_gzip;
+		reactor = false;
+		reactor_workers = 4;
+		reactor_task_threads = 16;
 	}
 	bool isEnable() {
 		return(!host.empty() && port);
@@ -52,6 +55,9 @@ struct sSnifferServerOptions {
 	unsigned mysql_redirect_queue_limit;
 	unsigned mysql_concat_limit;
 	eServerClientTypeCompress type_compress;
+	bool reactor;
+	unsigned reactor_workers;
+	unsigned reactor_task_threads;
 };
 
 
@@ -61,6 +67,8 @@ struct sSnifferClientOptions {
 		remote_query = true;
 		remote_store = true;
 		packetbuffer_sender = false;
+		packetbuffer_aes_gcm = false;
+		packetbuffer_window = 1;
 		mysql_new_store = 0;
 		mysql_set_id = false;
 		mysql_concat_limit = 0; // set only from server due compatibility client/server with different versions
@@ -93,6 +101,8 @@ struct sSnifferClientOptions {
 	bool remote_query;
 	bool remote_store;
 	bool packetbuffer_sender;
+	bool packetbuffer_aes_gcm;
+	unsigned packetbuffer_window;
 	int mysql_new_store;
 	bool mysql_set_id;
 	unsigned mysql_concat_limit;
@@ -283,11 +293,55 @@ public:
 		_tc_packetbuffer_block,
 		_tc_manager_command
 	};
+	enum eServiceStep {
+		_ss_continue,
+		_ss_sleep,
+		_ss_stop
+	};
+	enum eReactorState {
+		_rs_command,
+		_rs_wait_ready,
+		_rs_init,
+		_rs_blocks,
+		_rs_block_process,
+		_rs_gui_wait,
+		_rs_service,
+		_rs_service_tick
+	};
+	struct sServiceState {
+		sServiceState() {
+			use_encode_data = false;
+			check_ping_response = false;
+			last_write_time_us = 0;
+			wait_remote_chart_server_processing_to_time_ms = 0;
+			errors_counter = 0;
+		}
+		sSnifferServerService service;
+		bool use_encode_data;
+		bool check_ping_response;
+		u_int64_t last_write_time_us;
+		u_int64_t wait_remote_chart_server_processing_to_time_ms;
+		unsigned errors_counter;
+	};
+	struct sPacketbufferBlockSession {
+		sPacketbufferBlockSession() {
+			block_counter = 0;
+			connections = 0;
+			last_use_s = 0;
+			_sync = 0;
+		}
+		u_int32_t block_counter;
+		int connections;
+		u_int32_t last_use_s;
+		volatile int _sync;
+	};
 public:
 	cSnifferServerConnection(cSocket *socket, cSnifferServer *server);
 	~cSnifferServerConnection();
 	virtual void connection_process();
 	virtual void evData(u_char *data, size_t dataLen);
+	virtual cServerReactor::eWait reactor_step(cServerReactor::eEvent event, u_int64_t *wait_ms);
+	virtual void reactor_task();
 	void addTask(sSnifferServerGuiTask task);
 	sSnifferServerGuiTask getTask();
 	void doStop() {
@@ -302,18 +356,37 @@ public:
 protected:
 	bool checkPassword(string password, string *rsltStr);
 	void cp_gui_command(int32_t sensor_id, string command);
+	bool cp_gui_command_start(int32_t sensor_id, string command, sSnifferServerGuiTask *task);
 	void cp_service();
+	bool cp_service_init();
+	eServiceStep cp_service_step(int check_read_timeout_ms);
+	void cp_service_end();
 	void cp_respone(string gui_task_id, u_char *remainder, size_t remainder_length);
+	void cp_respone_process(string gui_task_id, u_char *remainder, size_t remainder_length);
 	void cp_responses();
+	void cp_responses_block(u_char *response, size_t responseLength);
 	void cp_query();
+	bool cp_query_init();
+	void cp_query_block(u_char *query, size_t queryLength);
 	void cp_store();
+	bool cp_store_init();
+	bool cp_store_block(u_char *query, size_t queryLength);
 	bool cp_store_check();
 	void cp_packetbuffer_block();
+	bool cp_packetbuffer_block_process(u_char *block, size_t blockLength);
+	void packetbuffer_block_session_attach(string session);
+	void packetbuffer_block_session_detach();
 	void cp_manager_command(string command);
+	void cp_manager_command_process(string command);
 private:
+	bool readCommand(string line, JsonItem *jsonData);
 	bool rsaAesInit(bool writeRsltOK = true);
 	eTypeConnection convTypeConnection(string typeConnection);
 	void updateSensorState(int32_t sensor_id);
+	cServerReactor::eWait reactorCommand(u_int64_t *wait_ms);
+	cServerReactor::eWait reactorInitDone(u_int64_t *wait_ms);
+	cServerReactor::eWait reactorEnd();
+	bool reactorIsReady();
 	void lock_tasks() {
 		while(__sync_lock_test_and_set(&_sync_tasks, 1)) {
 			if(SYNC_LOCK_USLEEP) {
@@ -324,6 +397,16 @@ private:
 	void unlock_tasks() {
 		__sync_lock_release(&_sync_tasks);
 	}
+	static void lock_packetbuffer_block_sessions() {
+		while(__sync_lock_test_and_set(&_sync_packetbuffer_block_sessions, 1)) {
+			if(SYNC_LOCK_USLEEP) {
+				USLEEP(SYNC_LOCK_USLEEP);
+			}
+		}
+	}
+	static void unlock_packetbuffer_block_sessions() {
+		__sync_lock_release(&_sync_packetbuffer_block_sessions);
+	}
 	string getTypeConnectionStr();
 protected: 
 	queue<sSnifferServerGuiTask> tasks;
@@ -334,6 +417,21 @@ protected:
 	cSnifferServer *server;
 private:
 	eTypeConnection typeConnection;
+	sServiceState *service_state;
+	class SqlDb *query_sqlDb;
+	u_int32_t packetbuffer_block_counter;
+	sPacketbufferBlockSession *packetbuffer_block_session;
+	eReactorState reactor_state;
+	JsonItem *reactor_command;
+	u_char *reactor_remainder;
+	size_t reactor_remainder_length;
+	sSnifferServerGuiTask reactor_gui_task;
+	u_int64_t reactor_gui_task_start_us;
+	u_char *reactor_block;
+	size_t reactor_block_length;
+	bool reactor_rslt;
+	static map<string, sPacketbufferBlockSession*> packetbuffer_block_sessions;
+	static volatile int _sync_packetbuffer_block_sessions;
 };
 
 
@@ -0,0 +1,283 @@
+#include <string.h>
+#include <algorithm>
+#include <map>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "sip_scan.h"
+
+
+using namespace std;
+
+
+static u_int32_t sip_scan_eol_scalar(const char *data, u_int32_t length) {
+	for(u_int32_t i = 0; i < length; i++) {
+		if(data[i] == '\r' || data[i] == '\n') {
+			return(i);
+		}
+	}
+	return(length);
+}
+
+void sip_scan_key_make(const char *name, unsigned length, sSipScanKey *key) {
+	u_char k[SIP_SCAN_KEY_SIMD_LENGTH];
+	memset(k, 0, sizeof(k));
+	for(unsigned i = 0; i < length && i < SIP_SCAN_KEY_SIMD_LENGTH; i++) {
+		k[i] = sip_scan_lower(name[i]);
+	}
+	memcpy(key->k, k, sizeof(k));
+	key->length = length;
+}
+
+u_int32_t sip_scan_name_key_scalar(const char *data, u_int32_t length, u_int32_t limit, sSipScanKey *key) {
+	if(limit > length) {
+		limit = length;
+	}
+	for(u_int32_t i = 0; i < limit; i++) {
+		char c = data[i];
+		if(sip_scan_is_name_delim(c)) {
+			sip_scan_key_make(data, i + 1, key);
+			return(i + 1);
+		}
+		if(c == '\r' || c == '\n') {
+			break;
+		}
+	}
+	return(0);
+}
+
+#if defined(__x86_64__)
+static u_int32_t sip_scan_eol_sse2(const char *data, u_int32_t length) {
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	u_int32_t i = 0;
+	for(; i + 16 <= length; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+		if(mask) {
+			return(i + __builtin_ctz(mask));
+		}
+	}
+	return(i + sip_scan_eol_scalar(data + i, length - i));
+}
+
+__attribute__((target("avx2")))
+static u_int32_t sip_scan_eol_avx2(const char *data, u_int32_t length) {
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	u_int32_t i = 0;
+	for(; i + 32 <= length; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+		unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+		if(mask) {
+			return(i + __builtin_ctz(mask));
+		}
+	}
+	// tail stays in this function - calling non-vex code with dirty upper ymm state costs transition penalty
+	if(i + 16 <= length) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm256_castsi256_si128(cr)), _mm_cmpeq_epi8(v, _mm256_castsi256_si128(lf))));
+		if(mask) {
+			return(i + __builtin_ctz(mask));
+		}
+		i += 16;
+	}
+	for(; i < length; i++) {
+		if(data[i] == '\r' || data[i] == '\n') {
+			return(i);
+		}
+	}
+	return(length);
+}
+
+#endif
+
+
+u_int32_t (*sip_scan_eol)(const char *data, u_int32_t length) = sip_scan_eol_scalar;
+bool sip_scan_name_key_simd = false;
+static eSipScanType sip_scan_type_selected = _sip_scan_scalar;
+
+
+void sip_scan_init(int forceType) {
+	eSipScanType type = _sip_scan_scalar;
+	#if defined(__x86_64__)
+	__builtin_cpu_init();
+	type = __builtin_cpu_supports("avx2") ? _sip_scan_avx2 : _sip_scan_sse2;
+	#endif
+	if(forceType >= 0 && forceType < type) {
+		type = (eSipScanType)forceType;
+	}
+	switch(type) {
+	#if defined(__x86_64__)
+	case _sip_scan_avx2:
+		sip_scan_eol = sip_scan_eol_avx2;
+		sip_scan_name_key_simd = true;
+		break;
+	case _sip_scan_sse2:
+		sip_scan_eol = sip_scan_eol_sse2;
+		sip_scan_name_key_simd = true;
+		break;
+	#endif
+	default:
+		type = _sip_scan_scalar;
+		sip_scan_eol = sip_scan_eol_scalar;
+		sip_scan_name_key_simd = false;
+		break;
+	}
+	sip_scan_type_selected = type;
+}
+
+eSipScanType sip_scan_type() {
+	return(sip_scan_type_selected);
+}
+
+const char *sip_scan_type_name(eSipScanType type) {
+	switch(type) {
+	case _sip_scan_scalar: return("scalar");
+	case _sip_scan_sse2: return("sse2");
+	case _sip_scan_avx2: return("avx2");
+	}
+	return("");
+}
+
+
+cSipHeaderHash::cSipHeaderHash() {
+	multiplier = 1;
+	shift = 32;
+	perfect = false;
+}
+
+void cSipHeaderHash::build(vector<string> *keys) {
+	this->keys = *keys;
+	slots.clear();
+	perfect = false;
+	if(this->keys.empty()) {
+		return;
+	}
+	vector<sSipScanKey> _keys(this->keys.size());
+	vector<u_int32_t> hashes(this->keys.size());
+	for(unsigned i = 0; i < this->keys.size(); i++) {
+		sip_scan_key_make(this->keys[i].c_str(), this->keys[i].length(), &_keys[i]);
+		hashes[i] = sip_scan_key_hash(&_keys[i]);
+	}
+	unsigned bits = 1;
+	while((1u << bits) < this->keys.size() * 2) {
+		++bits;
+	}
+	u_int32_t rnd = 0x9E3779B9;
+	vector<bool> used;
+	for(unsigned bits_add = 0; bits_add < 4 && !perfect; bits_add++) {
+		unsigned size = 1u << (bits + bits_add);
+		for(unsigned attempt = 0; attempt < 1000 && !perfect; attempt++) {
+			rnd = rnd * 1103515245 + 12345;
+			u_int32_t _multiplier = rnd | 1;
+			unsigned _shift = 32 - (bits + bits_add);
+			used.assign(size, false);
+			bool collision = false;
+			for(unsigned i = 0; i < hashes.size(); i++) {
+				u_int32_t index = (hashes[i] * _multiplier) >> _shift;
+				if(used[index]) {
+					collision = true;
+					break;
+				}
+				used[index] = true;
+			}
+			if(!collision) {
+				multiplier = _multiplier;
+				shift = _shift;
+				perfect = true;
+			}
+		}
+	}
+	if(!perfect) {
+		// keep largest table and resolve collisions by linear probing
+		bits += 3;
+		multiplier = 0x9E3779B1;
+		shift = 32 - bits;
+	}
+	sSlot emptySlot;
+	memset(&emptySlot, 0, sizeof(emptySlot));
+	emptySlot.value = -1;
+	slots.assign(1u << (32 - shift), emptySlot);
+	u_int32_t mask = slots.size() - 1;
+	for(unsigned i = 0; i < hashes.size(); i++) {
+		u_int32_t index = (hashes[i] * multiplier) >> shift;
+		while(slots[index].value >= 0) {
+			index = (index + 1) & mask;
+		}
+		slots[index].key = _keys[i];
+		slots[index].value = i;
+	}
+}
+
+
+cSipHeaderNames::cSipHeaderNames() {
+	maxKeyLength = 0;
+}
+
+void cSipHeaderNames::add(const char *name, int value) {
+	while(*name == '\n') {
+		++name;
+	}
+	if(!*name) {
+		return;
+	}
+	sName _name;
+	_name.name = name;
+	_name.keyLength = 0;
+	for(unsigned i = 0; i < _name.name.length(); i++) {
+		if(_name.name[i] >= 'A' && _name.name[i] <= 'Z') {
+			_name.name[i] += 'a' - 'A';
+		}
+		if(!_name.keyLength && sip_scan_is_name_delim(_name.name[i])) {
+			_name.keyLength = i + 1;
+		}
+	}
+	_name.length = _name.name.length();
+	_name.value = value;
+	names.push_back(_name);
+}
+
+void cSipHeaderNames::build() {
+	groups.clear();
+	groupsNames.clear();
+	unkeyed.clear();
+	maxKeyLength = 0;
+	map<string, unsigned> keys_map;
+	vector<string> keys;
+	vector<vector<unsigned> > _groups;
+	for(unsigned i = 0; i < names.size(); i++) {
+		if(names[i].keyLength) {
+			string key = names[i].name.substr(0, names[i].keyLength);
+			map<string, unsigned>::iterator iter = keys_map.find(key);
+			unsigned group;
+			if(iter != keys_map.end()) {
+				group = iter->second;
+			} else {
+				group = keys.size();
+				keys_map[key] = group;
+				keys.push_back(key);
+				_groups.push_back(vector<unsigned>());
+			}
+			_groups[group].push_back(i);
+			if(names[i].keyLength > maxKeyLength) {
+				maxKeyLength = names[i].keyLength;
+			}
+		} else {
+			unkeyed.push_back(i);
+		}
+	}
+	for(unsigned i = 0; i < _groups.size(); i++) {
+		std::stable_sort(_groups[i].begin(), _groups[i].end(), sNameLengthCmp(&names));
+		sGroup group;
+		const sName *first = &names[_groups[i][0]];
+		group.keyValue = first->length == first->keyLength ? first->value : -1;
+		group.namesBegin = groupsNames.size();
+		groupsNames.insert(groupsNames.end(), _groups[i].begin(), _groups[i].end());
+		group.namesEnd = groupsNames.size();
+		groups.push_back(group);
+	}
+	std::stable_sort(unkeyed.begin(), unkeyed.end(), sNameLengthCmp(&names));
+	hash.build(&keys);
+}
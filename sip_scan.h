@@ -0,0 +1,244 @@
+#ifndef SIP_SCAN_H
+#define SIP_SCAN_H
+
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+
+#define SIP_SCAN_KEY_SIMD_LENGTH 16
+
+
+/**
+  * Scanning helpers for SIP header parsing (ParsePacket::parseData).
+  * sip_scan_eol returns position of the first '\r' or '\n' (length if not found).
+  * sip_scan_name_key finds header name key at line start - lowercase name up to and including the first
+  * delimiter (':', '=', ' '), first 16 bytes are packed into sSipScanKey for hashing and comparison.
+  * It returns key length or 0 if line end or limit comes first.
+  * Implementation (avx2 / sse2 / scalar) is selected at runtime by sip_scan_init.
+*/
+
+struct sSipScanKey {
+	u_int64_t k[2];
+	u_int32_t length;
+};
+
+enum eSipScanType {
+	_sip_scan_scalar = 0,
+	_sip_scan_sse2 = 1,
+	_sip_scan_avx2 = 2
+};
+
+void sip_scan_init(int forceType = -1);
+eSipScanType sip_scan_type();
+const char *sip_scan_type_name(eSipScanType type);
+
+extern u_int32_t (*sip_scan_eol)(const char *data, u_int32_t length);
+extern bool sip_scan_name_key_simd;
+
+inline bool sip_scan_is_name_delim(char c) {
+	return(c == ':' || c == '=' || c == ' ');
+}
+
+inline u_char sip_scan_lower(u_char c) {
+	return(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
+inline bool sip_scan_equal_lower(const char *data, const char *lower, unsigned length) {
+	for(unsigned i = 0; i < length; i++) {
+		if(sip_scan_lower(data[i]) != (u_char)lower[i]) {
+			return(false);
+		}
+	}
+	return(true);
+}
+
+inline u_int32_t sip_scan_key_hash(const sSipScanKey *key) {
+	u_int64_t hash = key->k[0] * 0x9E3779B97F4A7C15ull ^ (key->k[1] + key->length) * 0xC2B2AE3D27D4EB4Full;
+	return((u_int32_t)(hash >> 32) ^ (u_int32_t)hash);
+}
+
+void sip_scan_key_make(const char *name, unsigned length, sSipScanKey *key);
+u_int32_t sip_scan_name_key_scalar(const char *data, u_int32_t length, u_int32_t limit, sSipScanKey *key);
+
+#if defined(__x86_64__)
+inline u_int32_t sip_scan_name_key_sse2(const char *data, u_int32_t length, u_int32_t limit, sSipScanKey *key) {
+	if(length < SIP_SCAN_KEY_SIMD_LENGTH) {
+		return(sip_scan_name_key_scalar(data, length, limit, key));
+	}
+	__m128i v = _mm_loadu_si128((const __m128i*)data);
+	unsigned delim_mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+									   _mm_cmpeq_epi8(v, _mm_set1_epi8('='))),
+							     _mm_cmpeq_epi8(v, _mm_set1_epi8(' '))));
+	unsigned eol_mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+							   _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+	if(!delim_mask) {
+		// key longer than 16 bytes (rare)
+		return(eol_mask || limit <= SIP_SCAN_KEY_SIMD_LENGTH ? 0 : sip_scan_name_key_scalar(data, length, limit, key));
+	}
+	unsigned pos = __builtin_ctz(delim_mask);
+	if(pos >= limit || (eol_mask & ((1u << pos) - 1))) {
+		return(0);
+	}
+	unsigned keyLength = pos + 1;
+	__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+	v = _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+	v = _mm_and_si128(v, _mm_cmpgt_epi8(_mm_set1_epi8(keyLength), _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)));
+	_mm_storeu_si128((__m128i*)key->k, v);
+	key->length = keyLength;
+	return(keyLength);
+}
+#endif
+
+// sse2 is part of x86_64 baseline - inlined to keep key in registers, scalar only when forced
+inline u_int32_t sip_scan_name_key(const char *data, u_int32_t length, u_int32_t limit, sSipScanKey *key) {
+	#if defined(__x86_64__)
+	if(sip_scan_name_key_simd) {
+		return(sip_scan_name_key_sse2(data, length, limit, key));
+	}
+	#endif
+	return(sip_scan_name_key_scalar(data, length, limit, key));
+}
+
+
+/**
+  * Hash of header name keys.
+  * Multiplier and table size are searched in build so that every key gets its own slot;
+  * when no such multiplier exists lookup falls back to linear probing.
+*/
+
+class cSipHeaderHash {
+public:
+	cSipHeaderHash();
+	void build(std::vector<std::string> *keys);
+	int find(const sSipScanKey *key, const char *data) const {
+		if(slots.empty()) {
+			return(-1);
+		}
+		u_int32_t mask = slots.size() - 1;
+		for(u_int32_t i = (sip_scan_key_hash(key) * multiplier) >> shift; ; i = (i + 1) & mask) {
+			const sSlot *slot = &slots[i];
+			if(slot->value < 0) {
+				return(-1);
+			}
+			if(slot->key.k[0] == key->k[0] && slot->key.k[1] == key->k[1] && slot->key.length == key->length &&
+			   (key->length <= SIP_SCAN_KEY_SIMD_LENGTH ||
+			    sip_scan_equal_lower(data + SIP_SCAN_KEY_SIMD_LENGTH, keys[slot->value].c_str() + SIP_SCAN_KEY_SIMD_LENGTH, key->length - SIP_SCAN_KEY_SIMD_LENGTH))) {
+				return(slot->value);
+			}
+		}
+		return(-1);
+	}
+	bool isPerfect() const {
+		return(perfect);
+	}
+private:
+	struct sSlot {
+		sSipScanKey key;
+		int32_t value;
+	};
+	std::vector<sSlot> slots;
+	std::vector<std::string> keys;
+	u_int32_t multiplier;
+	unsigned shift;
+	bool perfect;
+};
+
+
+/**
+  * Header names matched at line start (ParsePacket) - replaces the per-character header trie.
+  * Names are grouped by key, line key is taken by sip_scan_name_key and looked up in cSipHeaderHash;
+  * names without delimiter are compared one by one.
+  * As in the former trie the shortest matching name wins.
+*/
+
+class cSipHeaderNames {
+public:
+	cSipHeaderNames();
+	void add(const char *name, int value);
+	void build();
+	int find(const char *data, u_int32_t datalength, u_int32_t *namelength_rslt) const {
+		int rslt = -1;
+		u_int32_t rsltLength = 0;
+		if(!groups.empty()) {
+			sSipScanKey key;
+			if(sip_scan_name_key(data, datalength, datalength < maxKeyLength ? datalength : maxKeyLength, &key)) {
+				int _group = hash.find(&key, data);
+				if(_group >= 0) {
+					const sGroup *group = &groups[_group];
+					if(group->keyValue >= 0) {
+						// name equal to key is the shortest one in group
+						rslt = group->keyValue;
+						rsltLength = key.length;
+					} else {
+						for(unsigned i = group->namesBegin; i < group->namesEnd; i++) {
+							const sName *name = &names[groupsNames[i]];
+							if(name->length <= datalength &&
+							   sip_scan_equal_lower(data + key.length, name->name.c_str() + key.length, name->length - key.length)) {
+								rslt = name->value;
+								rsltLength = name->length;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+		for(std::vector<unsigned>::const_iterator iter = unkeyed.begin(); iter != unkeyed.end(); iter++) {
+			const sName *name = &names[*iter];
+			if(rslt >= 0 && name->length >= rsltLength) {
+				break;
+			}
+			if(name->length <= datalength &&
+			   sip_scan_equal_lower(data, name->name.c_str(), name->length)) {
+				rslt = name->value;
+				rsltLength = name->length;
+				break;
+			}
+		}
+		if(rslt >= 0 && namelength_rslt) {
+			*namelength_rslt = rsltLength;
+		}
+		return(rslt);
+	}
+	bool isEmpty() const {
+		return(names.empty());
+	}
+	bool isPerfectHash() const {
+		return(hash.isPerfect());
+	}
+private:
+	struct sName {
+		std::string name;
+		u_int32_t length;
+		u_int32_t keyLength;
+		int value;
+	};
+	struct sGroup {
+		int keyValue;
+		unsigned namesBegin;
+		unsigned namesEnd;
+	};
+	struct sNameLengthCmp {
+		sNameLengthCmp(std::vector<sName> *names) {
+			this->names = names;
+		}
+		bool operator() (unsigned index1, unsigned index2) const {
+			return((*names)[index1].length < (*names)[index2].length);
+		}
+		std::vector<sName> *names;
+	};
+	std::vector<sName> names;
+	cSipHeaderHash hash;
+	std::vector<sGroup> groups;
+	std::vector<unsigned> groupsNames;
+	std::vector<unsigned> unkeyed;
+	u_int32_t maxKeyLength;
+};
+
+
+#endif //SIP_SCAN_H
@@ -5914,7 +5914,7 @@ bool process_packet_rtp(packet_s_process_0 *packetS) {
 		packet_s_process_calls_info *call_info = packet_s_process_calls_info::create();
 		call_info->length = 0;
 		call_info->find_by_dest = false;
-		calltable->lock_calls_hash();
+		bool hash_rcu = calltable->lock_calls_hash_read();
 		node_call_rtp *n_call = NULL;
 		if((n_call = calltable->hashfind_by_ip_port(packetS->daddr_(), packetS->dest_(), false))) {
 			call_info->find_by_dest = true;
@@ -5997,7 +5997,7 @@ bool process_packet_rtp(packet_s_process_0 *packetS) {
 				}
 			}
 		}
-		calltable->unlock_calls_hash();
+		calltable->unlock_calls_hash_read(hash_rcu);
 		if(call_info->length) {
 			if(call_info->length > 1) {
 				packetS->set_reuse_counter(call_info->length);
@@ -7254,7 +7254,185 @@ void readdump_libnids(pcap_t *handle) {
 #endif
 */
 
-inline void ipfrag_delete_node(ip_frag_s *node, int pushToStack_queue_index) {
+ipfrag_data_s::ipfrag_data_s() {
+	table = NULL;
+	table_size = 0;
+	table_count = 0;
+	memset(wheel, 0, sizeof(wheel));
+	wheel_time = 0;
+	free_nodes = NULL;
+	free_queues = NULL;
+}
+
+ipfrag_data_s::~ipfrag_data_s() {
+	if(table) {
+		delete [] table;
+	}
+	for(unsigned i = 0; i < nodes_slabs.size(); i++) {
+		delete [] nodes_slabs[i];
+	}
+	for(unsigned i = 0; i < queues_slabs.size(); i++) {
+		delete [] queues_slabs[i];
+	}
+}
+
+ip_frag_queue *ipfrag_data_s::getQueue(vmIP saddr, vmIP daddr, u_int32_t id, u_int8_t protocol, time_t ts) {
+	u_int32_t h = hash(saddr, daddr, id, protocol);
+	if(table) {
+		unsigned mask = table_size - 1;
+		for(unsigned i = h & mask; table[i]; i = (i + 1) & mask) {
+			if(table[i]->hash == h && table[i]->eq(saddr, daddr, id, protocol)) {
+				return(table[i]);
+			}
+		}
+	}
+	if(!free_queues) {
+		addQueuesSlab();
+	}
+	ip_frag_queue *queue = free_queues;
+	free_queues = queue->wheel_next;
+	queue->saddr = saddr;
+	queue->daddr = daddr;
+	queue->id = id;
+	queue->protocol = protocol;
+	queue->has_last = false;
+	queue->hash = h;
+	queue->count = 0;
+	queue->ts = ts;
+	queue->first = NULL;
+	queue->last = NULL;
+	tableInsert(queue);
+	wheelInsert(queue);
+	return(queue);
+}
+
+ip_frag_queue *ipfrag_data_s::popExpiredQueue(time_t expire_to) {
+	if(!table_count) {
+		if(expire_to > wheel_time) {
+			wheel_time = expire_to;
+		}
+		return(NULL);
+	}
+	time_t t = wheel_time + 1;
+	if(expire_to - wheel_time > IPFRAG_WHEEL_SIZE) {
+		t = expire_to - IPFRAG_WHEEL_SIZE + 1;
+	}
+	for(; t <= expire_to; t++) {
+		for(ip_frag_queue *queue = wheel[t & (IPFRAG_WHEEL_SIZE - 1)]; queue; queue = queue->wheel_next) {
+			// slot can also contain queues from the next turn of wheel
+			if(queue->ts <= expire_to) {
+				removeQueue(queue);
+				return(queue);
+			}
+		}
+		wheel_time = t;
+	}
+	return(NULL);
+}
+
+ip_frag_queue *ipfrag_data_s::popQueue() {
+	for(unsigned i = 0; i < IPFRAG_WHEEL_SIZE; i++) {
+		if(wheel[i]) {
+			ip_frag_queue *queue = wheel[i];
+			removeQueue(queue);
+			return(queue);
+		}
+	}
+	return(NULL);
+}
+
+void ipfrag_data_s::tableInsert(ip_frag_queue *queue) {
+	if((table_count + 1) * 2 > table_size) {
+		tableResize(table_size ? table_size * 2 : IPFRAG_TABLE_SIZE_INIT);
+	}
+	unsigned mask = table_size - 1;
+	unsigned i = queue->hash & mask;
+	while(table[i]) {
+		i = (i + 1) & mask;
+	}
+	table[i] = queue;
+	++table_count;
+}
+
+void ipfrag_data_s::tableRemove(ip_frag_queue *queue) {
+	unsigned mask = table_size - 1;
+	unsigned i = queue->hash & mask;
+	while(table[i] != queue) {
+		i = (i + 1) & mask;
+	}
+	// backward shift deletion - no tombstones in probe sequences
+	for(unsigned j = (i + 1) & mask; table[j]; j = (j + 1) & mask) {
+		unsigned k = table[j]->hash & mask;
+		if(i <= j ? (i < k && k <= j) : (i < k || k <= j)) {
+			continue;
+		}
+		table[i] = table[j];
+		i = j;
+	}
+	table[i] = NULL;
+	--table_count;
+}
+
+void ipfrag_data_s::tableResize(unsigned size) {
+	ip_frag_queue **old_table = table;
+	unsigned old_table_size = table_size;
+	table = new FILE_LINE(0) ip_frag_queue*[size];
+	memset(table, 0, size * sizeof(ip_frag_queue*));
+	table_size = size;
+	unsigned mask = size - 1;
+	for(unsigned i = 0; i < old_table_size; i++) {
+		if(old_table[i]) {
+			unsigned j = old_table[i]->hash & mask;
+			while(table[j]) {
+				j = (j + 1) & mask;
+			}
+			table[j] = old_table[i];
+		}
+	}
+	if(old_table) {
+		delete [] old_table;
+	}
+}
+
+void ipfrag_data_s::wheelInsert(ip_frag_queue *queue) {
+	// queue older than already pruned time goes to the next checked slot
+	queue->wheel_slot = (queue->ts > wheel_time ? queue->ts : wheel_time + 1) & (IPFRAG_WHEEL_SIZE - 1);
+	queue->wheel_prev = NULL;
+	queue->wheel_next = wheel[queue->wheel_slot];
+	if(queue->wheel_next) {
+		queue->wheel_next->wheel_prev = queue;
+	}
+	wheel[queue->wheel_slot] = queue;
+}
+
+void ipfrag_data_s::wheelRemove(ip_frag_queue *queue) {
+	if(queue->wheel_prev) {
+		queue->wheel_prev->wheel_next = queue->wheel_next;
+	} else {
+		wheel[queue->wheel_slot] = queue->wheel_next;
+	}
+	if(queue->wheel_next) {
+		queue->wheel_next->wheel_prev = queue->wheel_prev;
+	}
+}
+
+void ipfrag_data_s::addNodesSlab() {
+	ip_frag_s *slab = new FILE_LINE(0) ip_frag_s[IPFRAG_SLAB_ITEMS];
+	nodes_slabs.push_back(slab);
+	for(unsigned i = 0; i < IPFRAG_SLAB_ITEMS; i++) {
+		freeNode(&slab[i]);
+	}
+}
+
+void ipfrag_data_s::addQueuesSlab() {
+	ip_frag_queue *slab = new FILE_LINE(0) ip_frag_queue[IPFRAG_SLAB_ITEMS];
+	queues_slabs.push_back(slab);
+	for(unsigned i = 0; i < IPFRAG_SLAB_ITEMS; i++) {
+		freeQueue(&slab[i]);
+	}
+}
+
+inline void ipfrag_delete_node(ip_frag_s *node, ipfrag_data_s *ipfrag_data, int pushToStack_queue_index) {
 	if(node->header_packet) {
 		PUSH_HP(&node->header_packet, pushToStack_queue_index);
 	}
@@ -7262,7 +7440,16 @@ inline void ipfrag_delete_node(ip_frag_s *node, int pushToStack_queue_index) {
 		((sHeaderPacketPQout*)node->header_packet_pqout)->destroy_or_unlock_blockstore();
 		delete ((sHeaderPacketPQout*)node->header_packet_pqout);
 	}
-	delete node;
+	ipfrag_data->freeNode(node);
+}
+
+inline void ipfrag_delete_queue(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data, int pushToStack_queue_index) {
+	for(ip_frag_s *node = queue->first; node;) {
+		ip_frag_s *next = node->next;
+		ipfrag_delete_node(node, ipfrag_data, pushToStack_queue_index);
+		node = next;
+	}
+	ipfrag_data->freeQueue(queue);
 }
 
 /*
@@ -7271,45 +7458,38 @@ defragment packets from queue and allocates memory for new header and packet whi
 in **header an **packet 
 
 */
-inline int _ipfrag_dequeue(ip_frag_queue *queue, 
+inline int _ipfrag_dequeue(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 			   sHeaderPacket **header_packet, sHeaderPacketPQout *header_packet_pqout,
 			   int pushToStack_queue_index) {
 	//walk queue
 
 	if(!queue) return 1;
-	if(!queue->size()) return 1;
+	if(!queue->first) return 1;
 
 	// prepare newpacket structure and header structure
-	u_int32_t totallen = queue->begin()->second->header_ip_offset;
-	unsigned i = 0;
-	for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-		totallen += it->second->len;
-		if(i) {
-			totallen -= it->second->iphdr_len;
+	u_int32_t totallen = queue->first->header_ip_offset;
+	for (ip_frag_s *node = queue->first; node; node = node->next) {
+		totallen += node->len;
+		if(node != queue->first) {
+			totallen -= node->iphdr_len;
 		}
-		i++;
 	}
-	if(totallen > 0xFFFF + queue->begin()->second->header_ip_offset) {
+	if(totallen > 0xFFFF + queue->first->header_ip_offset) {
 		if(sverb.defrag_overflow) {
-			ip_frag_queue_it_t it = queue->begin();
-			if(it != queue->end()) {
-				ip_frag_s *node = it->second;
-				iphdr2 *iph = (iphdr2*)((u_char*)HPP(node->header_packet) + node->header_ip_offset);
-				syslog(LOG_NOTICE, "ipfrag overflow: %i src ip: %s dst ip: %s", totallen, iph->get_saddr().getString().c_str(), iph->get_daddr().getString().c_str());
-			}
+			syslog(LOG_NOTICE, "ipfrag overflow: %i src ip: %s dst ip: %s", totallen, queue->saddr.getString().c_str(), queue->daddr.getString().c_str());
 		}
-		totallen = 0xFFFF + queue->begin()->second->header_ip_offset;
+		totallen = 0xFFFF + queue->first->header_ip_offset;
 	}
 	
 	unsigned int additionallen = 0;
 	iphdr2 *iphdr = NULL;
-	i = 0;
+	unsigned i = 0;
 	unsigned int len = 0;
 	
 	if(header_packet) {
 		*header_packet = CREATE_HP(totallen);
-		for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-			ip_frag_s *node = it->second;
+		for (ip_frag_s *node = queue->first, *next; node; node = next) {
+			next = node->next;
 			if(i == 0) {
 				// for first packet copy ethernet header and ip header
 				if(node->header_ip_offset) {
@@ -7333,14 +7513,14 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 					additionallen += cpy_len;
 				}
 			}
-			if(i == queue->size() - 1) {
+			if(!next) {
 				memcpy_heapsafe(HPH(*header_packet), *header_packet, 
 						HPH(node->header_packet), node->header_packet,
 						sizeof(struct pcap_pkthdr));
 				HPH(*header_packet)->len = totallen;
 				HPH(*header_packet)->caplen = totallen;
 			}
-			ipfrag_delete_node(node, pushToStack_queue_index);
+			ipfrag_delete_node(node, ipfrag_data, pushToStack_queue_index);
 			i++;
 		}
 	} else {
@@ -7350,8 +7530,8 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 		header_packet_pqout->block_store_index = 0;
 		header_packet_pqout->block_store_locked = false;
 		header_packet_pqout->header_ip_last_offset = 0xFFFF;
-		for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-			ip_frag_s *node = it->second;
+		for (ip_frag_s *node = queue->first, *next; node; node = next) {
+			next = node->next;
 			if(i == 0) {
 				// for first packet copy ethernet header and ip header
 				if(node->header_ip_offset) {
@@ -7385,7 +7565,7 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 					additionallen += cpy_len;
 				}
 			}
-			if(i == queue->size() - 1) {
+			if(!next) {
 				memcpy_heapsafe(header_packet_pqout->header, header_packet_pqout->header,
 						((sHeaderPacketPQout*)node->header_packet_pqout)->header,
 						((sHeaderPacketPQout*)node->header_packet_pqout)->block_store ?
@@ -7395,10 +7575,13 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 				header_packet_pqout->header->set_len(totallen);
 				header_packet_pqout->header->set_caplen(totallen);
 			}
-			ipfrag_delete_node(node, 0);
+			ipfrag_delete_node(node, ipfrag_data, 0);
 			i++;
 		}
 	}
+	queue->first = NULL;
+	queue->last = NULL;
+	queue->count = 0;
 	if(iphdr) {
 		//increase IP header length 
 		iphdr->set_tot_len(iphdr->get_tot_len() + additionallen);
@@ -7411,22 +7594,22 @@ inline int _ipfrag_dequeue(ip_frag_queue *queue,
 	return 1;
 }
 
-inline int ipfrag_dequeue(ip_frag_queue *queue,
+inline int ipfrag_dequeue(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 			  sHeaderPacket **header_packet,
 			  int pushToStack_queue_index) {
-	return(_ipfrag_dequeue(queue,
+	return(_ipfrag_dequeue(queue, ipfrag_data,
 			       header_packet, NULL,
 			       pushToStack_queue_index));
 }
 
-inline int ipfrag_dequeue(ip_frag_queue *queue,
+inline int ipfrag_dequeue(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 			  sHeaderPacketPQout *header_packet_pqout) {
-	return(_ipfrag_dequeue(queue,
+	return(_ipfrag_dequeue(queue, ipfrag_data,
 			       NULL, header_packet_pqout,
 			       -1));
 }
 
-inline int _ipfrag_add(ip_frag_queue *queue, 
+inline int _ipfrag_add(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 		       sHeaderPacket **header_packet, sHeaderPacketPQout *header_packet_pqout,
 		       unsigned int header_ip_offset, unsigned int len,
 		       int pushToStack_queue_index) {
@@ -7443,11 +7626,24 @@ inline int _ipfrag_add(ip_frag_queue *queue,
 		queue->has_last = true;
 	}
 
-	if(!queue->count(offset_d)) {
-		// this offset number is not yet in the queue - add packet to queue which automatically sort it into right position
+	// find position in queue sorted by offset - fragments mostly come in order, so try the tail first
+	ip_frag_s **node_pos;
+	if(!queue->first) {
+		node_pos = &queue->first;
+	} else if(queue->last->offset < offset_d) {
+		node_pos = &queue->last->next;
+	} else {
+		node_pos = &queue->first;
+		while(*node_pos && (*node_pos)->offset < offset_d) {
+			node_pos = &(*node_pos)->next;
+		}
+	}
+
+	if(!*node_pos || (*node_pos)->offset != offset_d) {
+		// this offset number is not yet in the queue - add packet to queue into right position
 
 		// create node
-		ip_frag_s *node = new FILE_LINE(26014) ip_frag_s;
+		ip_frag_s *node = ipfrag_data->allocNode();
 
 		if(header_packet) {
 			node->ts = HPH(*header_packet)->ts.tv_sec;
@@ -7468,8 +7664,13 @@ inline int _ipfrag_add(ip_frag_queue *queue,
 		node->iphdr_len = header_ip->get_hdr_size() - 
 				  (header_ip->_get_protocol() == IPPROTO_ESP ? IPPROTO_ESP_HEADER_SIZE : 0);
 
-		// add to queue (which will sort it automatically
-		(*queue)[offset_d] = node;
+		// add to queue
+		node->next = *node_pos;
+		*node_pos = node;
+		if(!node->next) {
+			queue->last = node;
+		}
+		++queue->count;
 	} else {
 		// node with that offset already exists - discard
 		return -1;
@@ -7478,10 +7679,9 @@ inline int _ipfrag_add(ip_frag_queue *queue,
 	// now check if packets in queue are complete - if yes - defragment - if not, do nithing
 	int ok = true;
 	unsigned int lastoffset = 0;
-	if(queue->has_last and queue->begin()->second->offset == 0) {
+	if(queue->has_last and queue->first->offset == 0) {
 		// queue has first and last packet - check if there are all middle fragments
-		for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-			ip_frag_s *node = it->second;
+		for (ip_frag_s *node = queue->first; node; node = node->next) {
 			if((node->offset != lastoffset)) {
 				ok = false;
 				break;
@@ -7495,27 +7695,27 @@ inline int _ipfrag_add(ip_frag_queue *queue,
 
 	if(ok) {
 		// all packets -> defragment 
-		_ipfrag_dequeue(queue, header_packet, header_packet_pqout, pushToStack_queue_index);
+		_ipfrag_dequeue(queue, ipfrag_data, header_packet, header_packet_pqout, pushToStack_queue_index);
 		return 1;
 	} else {
 		return 0;
 	}
 }
 
-inline int ipfrag_add(ip_frag_queue *queue, 
+inline int ipfrag_add(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 		      sHeaderPacket **header_packet, 
 		      unsigned int header_ip_offset, unsigned int len,
 		      int pushToStack_queue_index) {
-	return(_ipfrag_add(queue, 
+	return(_ipfrag_add(queue, ipfrag_data,
 			   header_packet, NULL,
 			   header_ip_offset, len,
 			   pushToStack_queue_index));
 }
 
-inline int ipfrag_add(ip_frag_queue *queue, 
+inline int ipfrag_add(ip_frag_queue *queue, ipfrag_data_s *ipfrag_data,
 		      sHeaderPacketPQout *header_packet_pqout, 
 		      unsigned int header_ip_offset, unsigned int len) {
-	return(_ipfrag_add(queue, 
+	return(_ipfrag_add(queue, ipfrag_data,
 			   NULL, header_packet_pqout,
 			   header_ip_offset, len,
 			   -1));
@@ -7536,34 +7736,33 @@ inline int _handle_defrag(iphdr2 *header_ip,
 			  ipfrag_data_s *ipfrag_data,
 			  int pushToStack_queue_index) {
  
-	//copy header ip to tmp beacuse it can happen that during exectuion of this function the header_ip can be 
+	//read the queue key before adding the packet to queue beacuse it can happen that during exectuion of this function the header_ip can be 
 	//overwriten in kernel ringbuffer if the ringbuffer is small and thus header_ip->saddr can have different value 
-	iphdr2 *header_ip_orig = (iphdr2*)new FILE_LINE(0) u_char[header_ip->get_hdr_size()];
-	memcpy(header_ip_orig, header_ip, header_ip->get_hdr_size());
-
-	// get queue from ip_frag_stream based on source ip address and ip->id identificator (2-dimensional map array)
-	ip_frag_queue *queue = ipfrag_data->ip_frag_stream[header_ip_orig->get_saddr()][header_ip_orig->get_frag_id()];
-	if(!queue) {
-		// queue does not exists yet - create it and assign to map 
-		queue = new FILE_LINE(26016) ip_frag_queue;
-		ipfrag_data->ip_frag_stream[header_ip_orig->get_saddr()][header_ip_orig->get_frag_id()] = queue;
-	}
+	vmIP saddr = header_ip->get_saddr();
+	vmIP daddr = header_ip->get_daddr();
+	u_int32_t frag_id = header_ip->get_frag_id();
+	u_int8_t protocol = header_ip->_get_protocol();
+	u_int32_t tot_len = header_ip->get_tot_len();
+	time_t ts = header_packet ?
+		     HPH(*header_packet)->ts.tv_sec :
+		     header_packet_pqout->header->get_tv_sec();
+
+	// get queue from hash table based on source and destination ip address, ip->id identificator and protocol
+	ip_frag_queue *queue = ipfrag_data->getQueue(saddr, daddr, frag_id, protocol, ts);
 	int res = header_packet ?
-		   ipfrag_add(queue,
+		   ipfrag_add(queue, ipfrag_data,
 			      header_packet, 
-			      (u_char*)header_ip - HPP(*header_packet), header_ip_orig->get_tot_len(),
+			      (u_char*)header_ip - HPP(*header_packet), tot_len,
 			      pushToStack_queue_index) :
-		   ipfrag_add(queue,
+		   ipfrag_add(queue, ipfrag_data,
 			      header_packet_pqout, 
-			      (u_char*)header_ip - header_packet_pqout->packet, header_ip_orig->get_tot_len());
+			      (u_char*)header_ip - header_packet_pqout->packet, tot_len);
 	if(res > 0) {
-		// packet was created from all pieces - delete queue and remove it from map
-		ipfrag_data->ip_frag_stream[header_ip_orig->get_saddr()].erase(header_ip_orig->get_frag_id());
-		delete queue;
+		// packet was created from all pieces - remove queue from table and return it to pool
+		ipfrag_data->removeQueue(queue);
+		ipfrag_data->freeQueue(queue);
 	};
 	
-	delete header_ip_orig;
-	
 	return res;
 }
 
@@ -7585,24 +7784,14 @@ void ipfrag_prune(unsigned int tv_sec, bool all, ipfrag_data_s *ipfrag_data,
 		prune_limit = 30;
 	}
 	ip_frag_queue *queue;
-	for (ipfrag_data->ip_frag_streamIT = ipfrag_data->ip_frag_stream.begin(); ipfrag_data->ip_frag_streamIT != ipfrag_data->ip_frag_stream.end(); ipfrag_data->ip_frag_streamIT++) {
-		for (ipfrag_data->ip_frag_streamITinner = (*ipfrag_data->ip_frag_streamIT).second.begin(); ipfrag_data->ip_frag_streamITinner != (*ipfrag_data->ip_frag_streamIT).second.end();) {
-			queue = ipfrag_data->ip_frag_streamITinner->second;
-			if(!queue->size()) {
-				ipfrag_data->ip_frag_streamIT->second.erase(ipfrag_data->ip_frag_streamITinner++);
-				delete queue;
-				continue;
-			}
-			if(all or ((tv_sec - queue->begin()->second->ts) > prune_limit)) {
-				for (ip_frag_queue_it_t it = queue->begin(); it != queue->end(); ++it) {
-					ip_frag_s *node = it->second;
-					ipfrag_delete_node(node, pushToStack_queue_index);
-				}
-				ipfrag_data->ip_frag_streamIT->second.erase(ipfrag_data->ip_frag_streamITinner++);
-				delete queue;
-				continue;
-			}
-			ipfrag_data->ip_frag_streamITinner++;
+	if(all) {
+		while((queue = ipfrag_data->popQueue()) != NULL) {
+			ipfrag_delete_queue(queue, ipfrag_data, pushToStack_queue_index);
+		}
+	} else if(tv_sec > (unsigned)prune_limit) {
+		// only timer wheel slots with expired queues are visited
+		while((queue = ipfrag_data->popExpiredQueue(tv_sec - prune_limit - 1)) != NULL) {
+			ipfrag_delete_queue(queue, ipfrag_data, pushToStack_queue_index);
 		}
 	}
 }
@@ -8700,6 +8889,7 @@ PreProcessPacket::PreProcessPacket(eTypePreProcessThread typePreProcessThread, u
 	memset(this->threadPstatData, 0, sizeof(this->threadPstatData));
 	this->qringPushCounter = 0;
 	this->qringPushCounter_full = 0;
+	this->latency_sample_counter = 0;
 	this->outThreadId = 0;
 	this->_sync_push = 0;
 	this->_sync_count = 0;
@@ -8961,6 +9151,7 @@ void *PreProcessPacket::outThreadFunction() {
 	#endif
 	batch_packet_s *batch_detach;
 	batch_packet_s_process *batch;
+	cPacketLatency::eStage latency_stage = this->getLatencyStage();
 	unsigned int usleepCounter = 0;
 	u_int64_t usleepSumTimeForPushBatch = 0;
 	while(!this->term_preProcess) {
@@ -8971,6 +9162,9 @@ void *PreProcessPacket::outThreadFunction() {
 				exists_used = true;
 				preProcessPacket[ppt_detach]->push_packet_detach__active__prepare();
 				batch_detach_x = this->qring_detach_x[this->readit];
+				if(batch_detach_x->push_at) {
+					packetLatency.addTicks(latency_stage, batch_detach_x->push_at);
+				}
 				__SYNC_LOCK(this->_sync_count);
 				unsigned count = batch_detach_x->count;
 				__SYNC_UNLOCK(this->_sync_count);
@@ -9041,6 +9235,9 @@ void *PreProcessPacket::outThreadFunction() {
 			if(this->qring_detach[this->readit]->used == 1) {
 				exists_used = true;
 				batch_detach = this->qring_detach[this->readit];
+				if(batch_detach->push_at) {
+					packetLatency.addTicks(latency_stage, batch_detach->push_at);
+				}
 				if(this->next_thread_handle[0]) {
 					__SYNC_LOCK(this->_sync_count);
 					unsigned count = batch_detach->count;
@@ -9149,6 +9346,9 @@ void *PreProcessPacket::outThreadFunction() {
 			if(this->qring[this->readit]->used == 1) {
 				exists_used = true;
 				batch = this->qring[this->readit];
+				if(batch->push_at) {
+					packetLatency.addTicks(latency_stage, batch->push_at);
+				}
 				
 				#if EXPERIMENTAL_T2_OUTTHREAD_SIP_MOD == 1
 				
@@ -9308,6 +9508,9 @@ void *PreProcessPacket::outThreadFunction() {
 			if(this->qring[this->readit]->used == 1) {
 				exists_used = true;
 				batch = this->qring[this->readit];
+				if(batch->push_at) {
+					packetLatency.addTicks(latency_stage, batch->push_at);
+				}
 				__SYNC_LOCK(this->_sync_count);
 				unsigned count = batch->count;
 				__SYNC_UNLOCK(this->_sync_count);
@@ -10557,6 +10760,7 @@ ProcessRtpPacket::ProcessRtpPacket(eType type, int indexThread) {
 	memset(this->threadPstatData, 0, sizeof(this->threadPstatData));
 	this->qringPushCounter = 0;
 	this->qringPushCounter_full = 0;
+	this->latency_sample_counter = 0;
 	this->outThreadId = 0;
 	this->term_processRtp = false;
 	for(int i = 0; i < MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
@@ -10619,6 +10823,9 @@ void *ProcessRtpPacket::outThreadFunction() {
 	while(!this->term_processRtp) {
 		if(this->qring[this->readit]->used == 1) {
 			batch_packet_s_process *batch = this->qring[this->readit];
+			if(batch->push_at) {
+				packetLatency.addTicks(cPacketLatency::_process_rtp, batch->push_at);
+			}
 			__SYNC_LOCK(this->_sync_count);
 			unsigned count = batch->count;
 			__SYNC_UNLOCK(this->_sync_count);
@@ -10791,7 +10998,8 @@ void ProcessRtpPacket::rtp_batch(batch_packet_s_process *batch, unsigned count)
 			this->hash_find_flag[batch_index] = 0;
 		}
 		#if not EXPERIMENTAL_PROCESS_RTP_MOD_02
-		calltable->lock_calls_hash();
+		// the read section of this thread covers lookups in next threads as they finish before unlock
+		bool hash_rcu = calltable->lock_calls_hash_read();
 		if(this->next_thread_handle[0]) {
 			for(int i = 0; i < MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
 				this->hash_thread_data[i].null();
@@ -10880,7 +11088,7 @@ void ProcessRtpPacket::rtp_batch(batch_packet_s_process *batch, unsigned count)
 				}
 			}
 		}
-		calltable->unlock_calls_hash();
+		calltable->unlock_calls_hash_read(hash_rcu);
 		for(;batch_index_distribute < count; batch_index_distribute++) {
 			packet_s_process_0 *packetS = batch->batch[batch_index_distribute];
 			batch->batch[batch_index_distribute] = NULL;
@@ -10889,7 +11097,7 @@ void ProcessRtpPacket::rtp_batch(batch_packet_s_process *batch, unsigned count)
 			}
 		}
 		#else
-		calltable->lock_calls_hash();
+		bool hash_rcu = calltable->lock_calls_hash_read();
 		if(this->next_thread_handle[0] && _find_hash_only_in_next_threads) {
 			for(int i = 0; i < MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS; i++) {
 				this->hash_thread_data[i].null();
@@ -10935,7 +11143,7 @@ void ProcessRtpPacket::rtp_batch(batch_packet_s_process *batch, unsigned count)
 					}
 				}
 			}
-			calltable->unlock_calls_hash();
+			calltable->unlock_calls_hash_read(hash_rcu);
 			if(batch_index_distribute < count) {
 				for(int i = 0; i < _process_rtp_packets_hash_next_threads; i++) {
 					this->hash_thread_data[i].processing = 2;
@@ -11039,8 +11247,9 @@ void ProcessRtpPacket::find_hash(packet_s_process_0 *packetS, bool lock) {
 	packetS->blockstore_addflag(31 /*pb lock flag*/);
 	packetS->call_info.length = 0;
 	packetS->call_info.find_by_dest = false;
+	bool hash_rcu = false;
 	if(lock) {
-		calltable->lock_calls_hash();
+		hash_rcu = calltable->lock_calls_hash_read();
 	}
 	node_call_rtp *n_call = NULL;
 	#if not EXPERIMENTAL_PACKETS_WITHOUT_IP
@@ -11177,7 +11386,7 @@ void ProcessRtpPacket::find_hash(packet_s_process_0 *packetS, bool lock) {
 		}
 	}
 	if(lock) {
-		calltable->unlock_calls_hash();
+		calltable->unlock_calls_hash_read(hash_rcu);
 	}
 }
 
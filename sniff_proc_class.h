@@ -8,6 +8,7 @@
 #include "calltable.h"
 #include "websocket.h"
 #include "pcap_queue.h"
+#include "packet_latency.h"
 
 
 #define LF_CHAR '\n'
@@ -398,6 +399,7 @@ public:
 		batch_pcap_queue_packet_data(unsigned max_count) {
 			count = 0;
 			used = 0;
+			push_at = 0;
 			batch = new FILE_LINE(0) pcap_queue_packet_data*[max_count];
 			for(unsigned i = 0; i < max_count; i++) {
 				batch[i] = new FILE_LINE(0) pcap_queue_packet_data;
@@ -414,12 +416,14 @@ public:
 		volatile unsigned count;
 		volatile int used;
 		unsigned max_count;
+		u_int64_t push_at;	// ticks of start of filling - only in batches sampled for packetLatency
 	};
 	#endif
 	struct batch_packet_s {
 		batch_packet_s(unsigned max_count) {
 			count = 0;
 			used = 0;
+			push_at = 0;
 			batch = new FILE_LINE(28001) packet_s_plus_pointer*[max_count];
 			for(unsigned i = 0; i < max_count; i++) {
 				batch[i] = new FILE_LINE(28002) packet_s_plus_pointer;
@@ -436,11 +440,13 @@ public:
 		volatile unsigned count;
 		volatile int used;
 		unsigned max_count;
+		u_int64_t push_at;
 	};
 	struct batch_packet_s_process {
 		batch_packet_s_process(unsigned max_count) {
 			count = 0;
 			used = 0;
+			push_at = 0;
 			batch = new FILE_LINE(28003) packet_s_process*[max_count];
 			memset(batch, 0, sizeof(packet_s_process*) * max_count);
 			this->max_count = max_count;
@@ -459,6 +465,7 @@ public:
 		volatile unsigned count;
 		volatile int used;
 		unsigned max_count;
+		u_int64_t push_at;
 	};
 	struct arg_next_thread {
 		PreProcessPacket *preProcessPacket;
@@ -508,6 +515,17 @@ public:
 		push_packet_detach_x__finish();
 	}
 	#endif
+	// for a caller pushing several packets in a row - then push_packet with use_lock = false
+	void push_packet_lock() {
+		if(need_lock_push()) {
+			this->lock_push();
+		}
+	}
+	void push_packet_unlock() {
+		if(need_lock_push()) {
+			this->unlock_push();
+		}
+	}
 	inline void push_packet(
 				#if USE_PACKET_NUMBER
 				u_int64_t packet_number,
@@ -517,7 +535,7 @@ public:
 				u_int16_t handle_index, pcap_pkthdr *header, const u_char *packet, bool packetDelete,
 				packet_flags pflags, struct iphdr2 *header_ip_encaps, struct iphdr2 *header_ip,
 				pcap_block_store *block_store, int block_store_index, int dlt, int sensor_id, vmIP sensor_ip, sPacketInfoData pid,
-				int blockstore_lock = 1) {
+				int blockstore_lock = 1, bool use_lock = true) {
 		extern int opt_t2_boost;
 		extern int opt_skinny;
 		extern char *sipportmatrix;
@@ -573,7 +591,7 @@ public:
 			}
 			return;
 		}
-		if(need_lock_push()) {
+		if(use_lock && need_lock_push()) {
 			this->lock_push();
 		}
 		packet_s *packetS;
@@ -626,7 +644,7 @@ public:
 		} else {
 			push_packet_detach(packetS);
 		}
-		if(need_lock_push()) {
+		if(use_lock && need_lock_push()) {
 			this->unlock_push();
 		}
 	}
@@ -652,6 +670,7 @@ public:
 			qring_push_index = this->writeit + 1;
 			qring_push_index_count = 0;
 			qring_detach_x_active_push_item = qring_detach_x[qring_push_index - 1];
+			qring_detach_x_active_push_item->push_at = cPacketLatency::mark(&latency_sample_counter);
 		}
 		return((pcap_queue_packet_data*)qring_detach_x_active_push_item->batch[qring_push_index_count]);
 	}
@@ -697,6 +716,7 @@ public:
 			qring_push_index = this->writeit + 1;
 			qring_push_index_count = 0;
 			qring_detach_active_push_item = qring_detach[qring_push_index - 1];
+			qring_detach_active_push_item->push_at = cPacketLatency::mark(&latency_sample_counter);
 		}
 		return((packet_s_plus_pointer*)qring_detach_active_push_item->batch[qring_push_index_count]);
 	}
@@ -766,6 +786,7 @@ public:
 			qring_push_index = this->writeit + 1;
 			qring_push_index_count = 0;
 			qring_detach_active_push_item = qring_detach[qring_push_index - 1];
+			qring_detach_active_push_item->push_at = cPacketLatency::mark(&latency_sample_counter);
 		}
 	}
 	inline void push_packet_detach__active__finish(unsigned count) {
@@ -827,6 +848,7 @@ public:
 				qring_push_index = this->writeit + 1;
 				qring_push_index_count = 0;
 				qring_active_push_item = qring[qring_push_index - 1];
+				qring_active_push_item->push_at = cPacketLatency::mark(&latency_sample_counter);
 			}
 			qring_active_push_item->batch[qring_push_index_count] = packetS;
 			++qring_push_index_count;
@@ -1262,6 +1284,33 @@ public:
 		}
 		return("");
 	}
+	cPacketLatency::eStage getLatencyStage() {
+		switch(typePreProcessThread) {
+		#if EXPERIMENTAL_T2_DETACH_X_MOD
+		case ppt_detach_x:
+		#endif
+		case ppt_detach:
+			return(cPacketLatency::_detach);
+		case ppt_sip:
+			return(cPacketLatency::_sip);
+		case ppt_extend:
+			return(cPacketLatency::_extend);
+		case ppt_pp_call:
+		case ppt_pp_callx:
+		case ppt_pp_callfindx:
+			return(cPacketLatency::_call);
+		case ppt_pp_register:
+			return(cPacketLatency::_register);
+		case ppt_pp_sip_other:
+			return(cPacketLatency::_sip_other);
+		case ppt_pp_rtp:
+			return(cPacketLatency::_rtp);
+		case ppt_pp_other:
+		case ppt_end_base:
+			break;
+		}
+		return(cPacketLatency::_other);
+	}
 	static packet_s_process *clonePacketS(u_char *newData, unsigned newDataLength, packet_s_process *packetS);
 	bool existsNextThread(int next_thread_index) {
 		return(next_thread_index < MAX_PRE_PROCESS_PACKET_NEXT_THREADS &&
@@ -1524,6 +1573,7 @@ private:
 	s_next_thread_data next_thread_data[MAX_PRE_PROCESS_PACKET_NEXT_THREADS];
 	u_int64_t qringPushCounter;
 	u_int64_t qringPushCounter_full;
+	unsigned latency_sample_counter;
 	int outThreadId;
 	int nextThreadId[MAX_PRE_PROCESS_PACKET_NEXT_THREADS];
 	volatile int *items_flag;
@@ -1659,6 +1709,7 @@ public:
 		batch_packet_s_process(unsigned max_count) {
 			count = 0;
 			used = 0;
+			push_at = 0;
 			batch = new FILE_LINE(28008) packet_s_process_0*[max_count];
 			memset(batch, 0, sizeof(packet_s_process_0*) * max_count);
 			this->max_count = max_count;
@@ -1677,6 +1728,7 @@ public:
 		volatile unsigned count;
 		volatile int used;
 		unsigned max_count;
+		u_int64_t push_at;
 	};
 	struct arg_next_thread {
 		ProcessRtpPacket *processRtpPacket;
@@ -1750,6 +1802,7 @@ public:
 			qring_push_index = this->writeit + 1;
 			qring_push_index_count = 0;
 			qring_active_push_item = this->qring[qring_push_index - 1];
+			qring_active_push_item->push_at = cPacketLatency::mark(&latency_sample_counter);
 		}
 		qring_active_push_item->batch[qring_push_index_count] = packetS;
 		++qring_push_index_count;
@@ -1873,6 +1926,7 @@ private:
 	pstat_data threadPstatData[1 + MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS][2];
 	u_int64_t qringPushCounter;
 	u_int64_t qringPushCounter_full;
+	unsigned latency_sample_counter;
 	bool term_processRtp;
 	s_hash_thread_data hash_thread_data[MAX_PROCESS_RTP_PACKET_HASH_NEXT_THREADS];
 	volatile int *hash_find_flag;
@@ -67,6 +67,10 @@ extern int opt_ssl_store_sessions;
 extern int opt_cdr_country_code;
 extern int opt_message_country_code;
 extern int opt_mysql_enable_multiple_rows_insert;
+extern bool opt_mysql_load_data;
+extern bool opt_odbc_array_insert;
+extern int opt_odbc_array_insert_size;
+extern bool opt_mysql_mysql_redirect_cdr_queue;
 extern bool opt_time_precision_in_ms;
 extern bool opt_save_energylevels;
 extern int opt_save_ip_from_encaps_ipheader;
@@ -1700,6 +1704,10 @@ bool SqlDb_mysql::connect(bool createDb, bool mainInit) {
 				mysql_options(this->hMysql, MYSQL_SECURE_AUTH, &arg);
 			}
 			#endif
+			if(opt_mysql_load_data) {
+				unsigned int localInfile = 1;
+				mysql_options(this->hMysql, MYSQL_OPT_LOCAL_INFILE, &localInfile);
+			}
 			extern unsigned int opt_mysql_connect_timeout;
 			if(opt_mysql_connect_timeout) {
 				mysql_options(this->hMysql, MYSQL_OPT_CONNECT_TIMEOUT, &opt_mysql_connect_timeout);
@@ -2330,6 +2338,115 @@ int64_t SqlDb_mysql::getInsertId() {
 	return(-1);
 }
 
+struct sLoadDataLocalInfile {
+	const char *data;
+	size_t length;
+	size_t pos;
+};
+
+static int loadData_local_infile_init(void **ptr, const char */*filename*/, void *userdata) {
+	((sLoadDataLocalInfile*)userdata)->pos = 0;
+	*ptr = userdata;
+	return(0);
+}
+
+static int loadData_local_infile_read(void *ptr, char *buf, unsigned int buf_len) {
+	sLoadDataLocalInfile *infile = (sLoadDataLocalInfile*)ptr;
+	size_t length = min((size_t)buf_len, infile->length - infile->pos);
+	if(length) {
+		memcpy(buf, infile->data + infile->pos, length);
+		infile->pos += length;
+	}
+	return(length);
+}
+
+static void loadData_local_infile_end(void */*ptr*/) {
+}
+
+static int loadData_local_infile_error(void */*ptr*/, char *error_msg, unsigned int error_msg_len) {
+	strncpy(error_msg, "load data from memory failed", error_msg_len);
+	error_msg[error_msg_len - 1] = 0;
+	return(CR_UNKNOWN_ERROR);
+}
+
+bool SqlDb_mysql::loadData(string query, const char *data, size_t length, unsigned rows, bool *partiallyStored) {
+	if(partiallyStored) {
+		*partiallyStored = false;
+	}
+	if(opt_nocdr) {
+		return(true);
+	}
+	if(this->hMysqlRes) {
+		while(mysql_fetch_row(this->hMysqlRes));
+		mysql_free_result(this->hMysqlRes);
+		this->hMysqlRes = NULL;
+	}
+	if(!this->connected()) {
+		this->connect();
+	}
+	if(!this->connected() || mysql_ping(this->hMysql)) {
+		return(false);
+	}
+	if(verbosity > 1) {
+		syslog(LOG_INFO, "%s (%zu bytes, %u rows)", query.c_str(), length, rows);
+	}
+	// LOAD DATA LOCAL converts row errors to warnings and skips the row
+	// - load in transaction and roll back unless all rows are stored, caller then inserts the whole batch
+	if(mysql_query(this->hMysqlConn, "START TRANSACTION")) {
+		this->checkLastError("load data error in [start transaction]", !this->disableLogError);
+		return(false);
+	}
+	sLoadDataLocalInfile infile;
+	infile.data = data;
+	infile.length = length;
+	infile.pos = 0;
+	mysql_set_local_infile_handler(this->hMysql,
+				       loadData_local_infile_init, loadData_local_infile_read,
+				       loadData_local_infile_end, loadData_local_infile_error,
+				       &infile);
+	bool rslt = !mysql_query(this->hMysqlConn, query.c_str());
+	mysql_set_local_infile_default(this->hMysql);
+	if(rslt) {
+		u_int64_t affectedRows = mysql_affected_rows(this->hMysqlConn);
+		if(affectedRows != rows) {
+			string warnings;
+			if(!mysql_query(this->hMysqlConn, "SHOW WARNINGS LIMIT 3")) {
+				MYSQL_RES *warningsRes = mysql_store_result(this->hMysqlConn);
+				if(warningsRes) {
+					MYSQL_ROW warningsRow;
+					while((warningsRow = mysql_fetch_row(warningsRes))) {
+						if(!warnings.empty()) {
+							warnings += "; ";
+						}
+						warnings += warningsRow[2] ? warningsRow[2] : "";
+					}
+					mysql_free_result(warningsRes);
+				}
+			}
+			syslog(LOG_NOTICE, "load data stored %llu of %u rows in [%s] (%s) - rollback and use INSERT queries", 
+			       (unsigned long long)affectedRows, rows, 
+			       (query.substr(0,200) + (query.size() > 200 ? "..." : "")).c_str(),
+			       warnings.c_str());
+			rslt = false;
+		}
+	} else {
+		this->checkLastError("load data error in [" + query.substr(0,200) + (query.size() > 200 ? "..." : "") + "]", !this->disableLogError);
+	}
+	if(rslt) {
+		if(mysql_query(this->hMysqlConn, "COMMIT")) {
+			this->checkLastError("load data error in [commit]", !this->disableLogError);
+			rslt = false;
+		}
+	} else {
+		if(!mysql_query(this->hMysqlConn, "ROLLBACK") &&
+		   mysql_warning_count(this->hMysqlConn) && partiallyStored) {
+			// ER_WARNING_NOT_COMPLETE_ROLLBACK - non-transactional table keeps loaded rows
+			*partiallyStored = true;
+		}
+	}
+	return(rslt);
+}
+
 bool SqlDb_mysql::existsTable(const char *table) {
 	const char *db_table_separator;
 	if(isCloud() &&
@@ -2844,6 +2961,232 @@ int SqlDb_odbc_bindBuffer::getIndexField(string fieldName) {
 }
 
 
+SqlDb_odbc_preparedInsert::SqlDb_odbc_preparedInsert(string table, SqlDb_row *row) {
+	this->table = table;
+	for(unsigned i = 0; i < row->row.size(); i++) {
+		this->columns.push_back(row->row[i].fieldName);
+	}
+	this->hStatement = NULL;
+	this->paramStatus = NULL;
+	this->paramStatusSize = 0;
+	this->paramsProcessed = 0;
+}
+
+SqlDb_odbc_preparedInsert::~SqlDb_odbc_preparedInsert() {
+	this->freeParams();
+	this->freeStatement();
+	if(this->paramStatus) {
+		delete [] this->paramStatus;
+	}
+}
+
+bool SqlDb_odbc_preparedInsert::prepare(SQLHANDLE hConnection) {
+	this->freeStatement();
+	if(!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, hConnection, &this->hStatement))) {
+		this->hStatement = NULL;
+		return(false);
+	}
+	string columns_str;
+	string values_str;
+	for(unsigned i = 0; i < this->columns.size(); i++) {
+		if(i) {
+			columns_str += ",";
+			values_str += ",";
+		}
+		columns_str += this->columns[i];
+		values_str += "?";
+	}
+	string query = "INSERT INTO " + this->table + " ( " + columns_str + " ) VALUES ( " + values_str + " )";
+	return(SQL_SUCCEEDED(SQLPrepare(this->hStatement, (SQLCHAR*)query.c_str(), SQL_NTS)) &&
+	       SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0)));
+}
+
+bool SqlDb_odbc_preparedInsert::bindParams(vector<SqlDb_row*> *rows) {
+	SQLULEN rowsCount = rows->size();
+	this->freeParams();
+	SQLFreeStmt(this->hStatement, SQL_RESET_PARAMS);
+	if(rowsCount > this->paramStatusSize) {
+		if(this->paramStatus) {
+			delete [] this->paramStatus;
+		}
+		this->paramStatus = new FILE_LINE(0) SQLUSMALLINT[rowsCount];
+		this->paramStatusSize = rowsCount;
+	}
+	for(unsigned i = 0; i < rowsCount; i++) {
+		this->paramStatus[i] = SQL_PARAM_UNUSED;
+	}
+	this->paramsProcessed = 0;
+	if(!SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)rowsCount, 0)) ||
+	   !SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAM_STATUS_PTR, this->paramStatus, 0)) ||
+	   !SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAMS_PROCESSED_PTR, &this->paramsProcessed, 0))) {
+		return(false);
+	}
+	this->params.resize(this->columns.size());
+	for(unsigned i = 0; i < this->columns.size(); i++) {
+		this->setParamType(i, rows);
+		sParam *param = &this->params[i];
+		param->ind = new FILE_LINE(0) SQLLEN[rowsCount];
+		if(param->cType == SQL_C_CHAR) {
+			vector<string> contents(rowsCount);
+			param->width = 1;
+			for(unsigned j = 0; j < rowsCount; j++) {
+				SqlDb_row::SqlDb_rowField *field = &(*rows)[j]->row[i];
+				if(!field->null) {
+					contents[j] = unescapeContent(field->content);
+					if((SQLLEN)contents[j].length() + 1 > param->width) {
+						param->width = contents[j].length() + 1;
+					}
+				}
+			}
+			param->sqlType = param->width - 1 > 8000 ? SQL_LONGVARCHAR : SQL_VARCHAR;
+			param->buffer = new FILE_LINE(0) char[rowsCount * param->width];
+			for(unsigned j = 0; j < rowsCount; j++) {
+				if((*rows)[j]->row[i].null) {
+					param->buffer[j * param->width] = 0;
+					param->ind[j] = SQL_NULL_DATA;
+				} else {
+					memcpy(param->buffer + j * param->width, contents[j].c_str(), contents[j].length() + 1);
+					param->ind[j] = SQL_NTS;
+				}
+			}
+		} else {
+			// int64_t, u_int64_t and double share 8 bytes of sInternalFieldValue::v
+			param->width = sizeof(int64_t);
+			param->buffer = new FILE_LINE(0) char[rowsCount * param->width];
+			for(unsigned j = 0; j < rowsCount; j++) {
+				SqlDb_row::SqlDb_rowField *field = &(*rows)[j]->row[i];
+				if(field->null) {
+					memset(param->buffer + j * param->width, 0, param->width);
+					param->ind[j] = SQL_NULL_DATA;
+				} else {
+					memcpy(param->buffer + j * param->width, &field->ifv.v, param->width);
+					param->ind[j] = 0;
+				}
+			}
+		}
+		if(!SQL_SUCCEEDED(SQLBindParameter(this->hStatement, i + 1, SQL_PARAM_INPUT, param->cType, param->sqlType,
+						   param->cType == SQL_C_CHAR ? max(param->width - 1, (SQLLEN)1) : 0, 0,
+						   param->buffer, param->width, param->ind))) {
+			return(false);
+		}
+	}
+	return(true);
+}
+
+SQLRETURN SqlDb_odbc_preparedInsert::execute() {
+	return(SQLExecute(this->hStatement));
+}
+
+bool SqlDb_odbc_preparedInsert::isInserted(unsigned rowIndex) {
+	return(rowIndex < this->paramsProcessed && rowIndex < this->paramStatusSize &&
+	       (this->paramStatus[rowIndex] == SQL_PARAM_SUCCESS ||
+		this->paramStatus[rowIndex] == SQL_PARAM_SUCCESS_WITH_INFO));
+}
+
+string SqlDb_odbc_preparedInsert::getLastError() {
+	if(this->hStatement) {
+		SQLCHAR sqlState[10];
+		SQLINTEGER nativeError;
+		SQLCHAR messageText[1000];
+		SQLSMALLINT messageTextLength;
+		if(SQL_SUCCEEDED(SQLGetDiagRec(SQL_HANDLE_STMT, this->hStatement, 1, sqlState, &nativeError, messageText, sizeof(messageText), &messageTextLength))) {
+			return(string((char*)sqlState) + " " + (char*)messageText);
+		}
+	}
+	return("");
+}
+
+bool SqlDb_odbc_preparedInsert::isBindable(SqlDb_row *row) {
+	for(unsigned i = 0; i < row->row.size(); i++) {
+		SqlDb_row::SqlDb_rowField *field = &row->row[i];
+		if(field->null) {
+			continue;
+		}
+		// sql expressions and codebook references exist only in text of query
+		if((field->ifv.type & SqlDb_row::_ift_base) == SqlDb_row::_ift_sql ||
+		   field->ifv.type == SqlDb_row::_ift_cb_string ||
+		   field->content.substr(0, 12) == MYSQL_VAR_PREFIX ||
+		   field->content.substr(0, 14) == MYSQL_CODEBOOK_ID_PREFIX) {
+			return(false);
+		}
+	}
+	return(true);
+}
+
+string SqlDb_odbc_preparedInsert::getKey(string table, SqlDb_row *row) {
+	return(table + ":" + row->implodeFields());
+}
+
+void SqlDb_odbc_preparedInsert::freeStatement() {
+	if(this->hStatement) {
+		SQLFreeHandle(SQL_HANDLE_STMT, this->hStatement);
+		this->hStatement = NULL;
+	}
+}
+
+void SqlDb_odbc_preparedInsert::freeParams() {
+	for(unsigned i = 0; i < this->params.size(); i++) {
+		if(this->params[i].buffer) {
+			delete [] this->params[i].buffer;
+		}
+		if(this->params[i].ind) {
+			delete [] this->params[i].ind;
+		}
+	}
+	this->params.clear();
+}
+
+void SqlDb_odbc_preparedInsert::setParamType(unsigned columnIndex, vector<SqlDb_row*> *rows) {
+	// numeric type only if all not null values of column have it, mixed types go as text
+	int type = -1;
+	for(unsigned i = 0; i < rows->size(); i++) {
+		SqlDb_row::SqlDb_rowField *field = &(*rows)[i]->row[columnIndex];
+		if(field->null) {
+			continue;
+		}
+		int fieldType = field->ifv.type & SqlDb_row::_ift_base;
+		if(fieldType != SqlDb_row::_ift_int &&
+		   fieldType != SqlDb_row::_ift_int_u &&
+		   fieldType != SqlDb_row::_ift_double) {
+			fieldType = SqlDb_row::_ift_string;
+		}
+		if(type < 0) {
+			type = fieldType;
+		} else if(type != fieldType) {
+			type = SqlDb_row::_ift_string;
+			break;
+		}
+	}
+	sParam *param = &this->params[columnIndex];
+	switch(type) {
+	case SqlDb_row::_ift_int:
+		param->cType = SQL_C_SBIGINT;
+		param->sqlType = SQL_BIGINT;
+		break;
+	case SqlDb_row::_ift_int_u:
+		param->cType = SQL_C_UBIGINT;
+		param->sqlType = SQL_BIGINT;
+		break;
+	case SqlDb_row::_ift_double:
+		param->cType = SQL_C_DOUBLE;
+		param->sqlType = SQL_DOUBLE;
+		break;
+	default:
+		param->cType = SQL_C_CHAR;
+		param->sqlType = SQL_VARCHAR;
+		break;
+	}
+}
+
+string SqlDb_odbc_preparedInsert::unescapeContent(string &content) {
+	// content of row is prepared for text of query (escaped by sqlEscapeString for odbc - doubled apostrophe)
+	if(content.find("''") == string::npos) {
+		return(content);
+	}
+	return(find_and_replace(content.c_str(), "''", "'"));
+}
+
+
 SqlDb_odbc::SqlDb_odbc() {
 	this->odbcVersion = (ulong)NULL;
 	this->subtypeDb = "";
@@ -2913,6 +3256,7 @@ bool SqlDb_odbc::connect(bool /*createDb*/, bool /*mainInit*/) {
 }
 
 void SqlDb_odbc::disconnect() {
+	this->cleanPreparedInserts();
 	if(this->hStatement) {
 		SQLFreeHandle(SQL_HANDLE_STMT, this->hStatement);
 		this->hStatement = NULL;
@@ -3132,6 +3476,361 @@ void SqlDb_odbc::clean() {
 	this->cleanFields();
 }
 
+bool SqlDb_odbc::insertArray(string table, vector<SqlDb_row*> *rows) {
+	if(!rows->size()) {
+		return(true);
+	}
+	vector<bool> inserted(rows->size(), false);
+	if(cSqlDbArrayInsert::isEnabled()) {
+		if(!this->connected()) {
+			this->connect();
+		}
+		if(this->connected()) {
+			string key = SqlDb_odbc_preparedInsert::getKey(table, (*rows)[0]);
+			SqlDb_odbc_preparedInsert *preparedInsert = NULL;
+			map<string, SqlDb_odbc_preparedInsert*>::iterator iter = this->preparedInserts.find(key);
+			if(iter != this->preparedInserts.end()) {
+				preparedInsert = iter->second;
+			} else {
+				preparedInsert = new FILE_LINE(0) SqlDb_odbc_preparedInsert(table, (*rows)[0]);
+				if(preparedInsert->prepare(this->hConnection)) {
+					this->preparedInserts[key] = preparedInsert;
+				} else {
+					if(!sql_noerror && !this->disableLogError) {
+						this->setLastError(0, "odbc: prepare insert into " + table + " failed: " + preparedInsert->getLastError(), true);
+					}
+					delete preparedInsert;
+					preparedInsert = NULL;
+				}
+			}
+			if(preparedInsert) {
+				if(!preparedInsert->bindParams(rows)) {
+					cSqlDbArrayInsert::disable(preparedInsert->getLastError().c_str());
+					this->cleanPreparedInserts();
+				} else {
+					SQLRETURN rslt = preparedInsert->execute();
+					// SQL_SUCCESS_WITH_INFO is returned also if only some rows failed - status of each row decides
+					for(unsigned i = 0; i < rows->size(); i++) {
+						inserted[i] = preparedInsert->isInserted(i);
+					}
+					if(!this->okRslt(rslt)) {
+						if(!sql_noerror && !this->disableLogError) {
+							this->setLastError(0, "odbc: array insert into " + table + " failed: " + preparedInsert->getLastError(), true);
+						}
+						// statement is prepared again with next batch
+						this->preparedInserts.erase(key);
+						delete preparedInsert;
+					}
+				}
+			}
+		}
+	}
+	// rows not stored by array go via standard insert queries
+	bool rslt = true;
+	for(unsigned i = 0; i < rows->size(); i++) {
+		if(!inserted[i] &&
+		   !this->query(this->insertQuery(table, *(*rows)[i]))) {
+			rslt = false;
+		}
+	}
+	return(rslt);
+}
+
+void SqlDb_odbc::cleanPreparedInserts() {
+	for(map<string, SqlDb_odbc_preparedInsert*>::iterator iter = this->preparedInserts.begin(); iter != this->preparedInserts.end(); iter++) {
+		delete iter->second;
+	}
+	this->preparedInserts.clear();
+}
+
+volatile bool cSqlDbLoadData::disabled = false;
+
+cSqlDbLoadData::cSqlDbLoadData() {
+}
+
+cSqlDbLoadData::~cSqlDbLoadData() {
+	clear();
+}
+
+bool cSqlDbLoadData::add(cDbTablesContent *tablesContent) {
+	vector<sBatch*> rows_batches;
+	vector<string> rows_data;
+	vector<unsigned> rows_count;
+	for(vector<cDbTableContent*>::iterator iter = tablesContent->tables.begin(); iter != tablesContent->tables.end(); iter++) {
+		cDbTableContent *tableContent = *iter;
+		if(!tableContent->header.items) {
+			return(false);
+		}
+		if(!tableContent->rows.size()) {
+			continue;
+		}
+		cDbStrings *header = tableContent->header.items;
+		vector<string> columns;
+		vector<bool> ipv6Columns;
+		string ipv6Mask;
+		for(unsigned i = 0; i < header->size; i++) {
+			if(!header->strings[i].begin) {
+				continue;
+			}
+			string column = header->strings[i].begin + header->strings[i].offset;
+			// type of null value is not known - ip column is detected by any not null value
+			bool ipColumn = false;
+			for(unsigned j = 0; j < tableContent->rows.size(); j++) {
+				cDbStrings *row = tableContent->rows[j].items;
+				if(i < row->size && !(row->strings[i].flags & SqlDb_row::_ift_null) &&
+				   (row->strings[i].flags & SqlDb_row::_ift_base) == SqlDb_row::_ift_ip) {
+					ipColumn = true;
+					break;
+				}
+			}
+			bool ipv6Column = ipColumn && SqlDb::_isIPv6Column(tableContent->table_name, column);
+			columns.push_back(column);
+			ipv6Columns.push_back(ipv6Column);
+			ipv6Mask += ipv6Column ? '1' : '0';
+		}
+		string key = tableContent->table_name + ":" + header->implodeInsertColumns() + ":" + ipv6Mask;
+		sBatch *batch;
+		map<string, sBatch*>::iterator iter_batch = batches_map.find(key);
+		if(iter_batch != batches_map.end()) {
+			batch = iter_batch->second;
+		} else {
+			batch = new FILE_LINE(0) sBatch;
+			batch->table = tableContent->table_name;
+			batch->columns = columns;
+			batch->ipv6Columns = ipv6Columns;
+			batches.push_back(batch);
+			batches_map[key] = batch;
+		}
+		string data;
+		for(vector<cDbTableContent::sRow>::iterator iter_row = tableContent->rows.begin(); iter_row != tableContent->rows.end(); iter_row++) {
+			if(!iter_row->items->implodeLoadDataValues(&data, &batch->ipv6Columns)) {
+				return(false);
+			}
+		}
+		rows_batches.push_back(batch);
+		rows_data.push_back(data);
+		rows_count.push_back(tableContent->rows.size());
+	}
+	for(unsigned i = 0; i < rows_batches.size(); i++) {
+		rows_batches[i]->data += rows_data[i];
+		rows_batches[i]->rows += rows_count[i];
+	}
+	return(true);
+}
+
+void cSqlDbLoadData::store(SqlDb_mysql *sqlDb, list<string> *fallback_inserts, long unsigned maxAllowedPacket) {
+	// after failure all next batches (child tables) go after main records via inserts
+	bool loadDataFailed = false;
+	for(vector<sBatch*>::iterator iter = batches.begin(); iter != batches.end(); iter++) {
+		sBatch *batch = *iter;
+		if(!batch->rows) {
+			continue;
+		}
+		bool partiallyStored = false;
+		if(!loadDataFailed && isEnabled() && sqlDb) {
+			if(sqlDb->loadData(loadDataQuery(batch), batch->data.c_str(), batch->data.length(), batch->rows, &partiallyStored)) {
+				continue;
+			}
+			unsigned int error = sqlDb->getLastError();
+			if(error == ER_NOT_ALLOWED_COMMAND ||
+			   error == 3948 /* ER_CLIENT_LOCAL_FILES_DISABLED */) {
+				disable(sqlDb->getLastErrorString().c_str());
+			}
+		}
+		loadDataFailed = true;
+		if(partiallyStored) {
+			// rows already loaded cannot be told apart from skipped ones - inserting the batch would duplicate them
+			syslog(LOG_ERR, "load data into %s partially stored and not rolled back (non-transactional table) - batch of %u rows is not inserted again", 
+			       batch->table.c_str(), batch->rows);
+			continue;
+		}
+		insertQueries(batch, fallback_inserts, maxAllowedPacket);
+	}
+	clear();
+}
+
+void cSqlDbLoadData::clear() {
+	for(vector<sBatch*>::iterator iter = batches.begin(); iter != batches.end(); iter++) {
+		delete *iter;
+	}
+	batches.clear();
+	batches_map.clear();
+}
+
+bool cSqlDbLoadData::isEnabled() {
+	return(opt_mysql_load_data && !disabled && 
+	       isSqlDriver("mysql") && !isCloud());
+}
+
+void cSqlDbLoadData::disable(const char *error) {
+	if(!disabled) {
+		disabled = true;
+		syslog(LOG_NOTICE, "mysql_load_data: LOAD DATA LOCAL INFILE is not allowed (%s) - use INSERT queries (enable local_infile in mysql server configuration)", error);
+	}
+}
+
+string cSqlDbLoadData::loadDataQuery(sBatch *batch) {
+	string columns_str;
+	string set_str;
+	for(unsigned i = 0; i < batch->columns.size(); i++) {
+		if(i) {
+			columns_str += ",";
+		}
+		if(batch->ipv6Columns[i]) {
+			string var = "@ipv6_" + intToString(i);
+			columns_str += var;
+			set_str += string(set_str.empty() ? " SET " : ",") + "`" + batch->columns[i] + "` = inet6_aton(" + var + ")";
+		} else {
+			columns_str += "`" + batch->columns[i] + "`";
+		}
+	}
+	return("LOAD DATA LOCAL INFILE 'voipmonitor_" + batch->table + "' INTO TABLE " + batch->table + 
+	       " CHARACTER SET utf8 ( " + columns_str + " )" + set_str);
+}
+
+void cSqlDbLoadData::insertQueries(sBatch *batch, list<string> *dst, long unsigned maxAllowedPacket) {
+	string insert_str = "INSERT INTO " + batch->table + " ( ";
+	for(unsigned i = 0; i < batch->columns.size(); i++) {
+		if(i) {
+			insert_str += ",";
+		}
+		insert_str += "`" + batch->columns[i] + "`";
+	}
+	insert_str += " ) VALUES ";
+	string values_str;
+	const char *data = batch->data.c_str();
+	const char *data_end = data + batch->data.length();
+	while(data < data_end) {
+		const char *row_end = (const char*)memchr(data, '\n', data_end - data);
+		if(!row_end) {
+			row_end = data_end;
+		}
+		string row_str = "( ";
+		unsigned columnIndex = 0;
+		const char *field = data;
+		while(true) {
+			const char *field_end = (const char*)memchr(field, '\t', row_end - field);
+			if(!field_end) {
+				field_end = row_end;
+			}
+			if(columnIndex) {
+				row_str += ",";
+			}
+			if(field_end - field == 2 && field[0] == '\\' && field[1] == 'N') {
+				row_str += "NULL";
+			} else if(columnIndex < batch->ipv6Columns.size() && batch->ipv6Columns[columnIndex]) {
+				row_str += "inet6_aton('" + string(field, field_end - field) + "')";
+			} else {
+				row_str += "'" + string(field, field_end - field) + "'";
+			}
+			++columnIndex;
+			if(field_end == row_end) {
+				break;
+			}
+			field = field_end + 1;
+		}
+		row_str += " )";
+		if(maxAllowedPacket && (values_str.length() + row_str.length()) * 1.1 > maxAllowedPacket && !values_str.empty()) {
+			dst->push_back(insert_str + values_str);
+			values_str = "";
+		}
+		if(!values_str.empty()) {
+			values_str += ",";
+		}
+		values_str += row_str;
+		data = row_end + 1;
+	}
+	if(!values_str.empty()) {
+		dst->push_back(insert_str + values_str);
+	}
+}
+
+volatile bool cSqlDbArrayInsert::disabled = false;
+
+cSqlDbArrayInsert::cSqlDbArrayInsert(SqlDb *sqlDb) {
+	this->sqlDb = sqlDb;
+	this->_sync = 0;
+}
+
+cSqlDbArrayInsert::~cSqlDbArrayInsert() {
+	clear();
+}
+
+void cSqlDbArrayInsert::add(string table, SqlDb_row *row) {
+	if(!isEnabled() || !dynamic_cast<SqlDb_odbc*>(sqlDb) ||
+	   !SqlDb_odbc_preparedInsert::isBindable(row)) {
+		sqlDb->insert(table, *row);
+		return;
+	}
+	string key = SqlDb_odbc_preparedInsert::getKey(table, row);
+	lock();
+	sBatch *batch;
+	map<string, sBatch*>::iterator iter_batch = batches_map.find(key);
+	if(iter_batch != batches_map.end()) {
+		batch = iter_batch->second;
+	} else {
+		batch = new FILE_LINE(0) sBatch;
+		batch->table = table;
+		batches.push_back(batch);
+		batches_map[key] = batch;
+	}
+	batch->rows.push_back(new FILE_LINE(0) SqlDb_row(*row));
+	if(opt_odbc_array_insert_size > 0 && batch->rows.size() >= (unsigned)opt_odbc_array_insert_size) {
+		flush(batch);
+	}
+	unlock();
+}
+
+void cSqlDbArrayInsert::flush() {
+	lock();
+	for(vector<sBatch*>::iterator iter = batches.begin(); iter != batches.end(); iter++) {
+		flush(*iter);
+	}
+	_clear();
+	unlock();
+}
+
+void cSqlDbArrayInsert::clear() {
+	lock();
+	_clear();
+	unlock();
+}
+
+void cSqlDbArrayInsert::_clear() {
+	for(vector<sBatch*>::iterator iter = batches.begin(); iter != batches.end(); iter++) {
+		for(vector<SqlDb_row*>::iterator iter_row = (*iter)->rows.begin(); iter_row != (*iter)->rows.end(); iter_row++) {
+			delete *iter_row;
+		}
+		delete *iter;
+	}
+	batches.clear();
+	batches_map.clear();
+}
+
+bool cSqlDbArrayInsert::isEnabled() {
+	return(opt_odbc_array_insert && !disabled &&
+	       isSqlDriver("odbc"));
+}
+
+void cSqlDbArrayInsert::disable(const char *error) {
+	if(!disabled) {
+		disabled = true;
+		syslog(LOG_NOTICE, "odbc_array_insert: odbc driver does not support arrays of parameters (%s) - use INSERT queries", error);
+	}
+}
+
+void cSqlDbArrayInsert::flush(sBatch *batch) {
+	if(!batch->rows.size()) {
+		return;
+	}
+	// after disabling rows already queued are stored by insertArray via INSERT queries
+	dynamic_cast<SqlDb_odbc*>(sqlDb)->insertArray(batch->table, &batch->rows);
+	for(vector<SqlDb_row*>::iterator iter = batch->rows.begin(); iter != batch->rows.end(); iter++) {
+		delete *iter;
+	}
+	batch->rows.clear();
+}
+
 void *MySqlStore_process_storing(void *storeProcess_addr) {
 	MySqlStore_process *storeProcess = (MySqlStore_process*)storeProcess_addr;
 	storeProcess->store();
@@ -3647,10 +4346,24 @@ void MySqlStore_process::__store(list<string> *queries) {
 	string queries_str;
 	list<string> queries_list;
 	list<string> ig;
+	cSqlDbLoadData loadData;
+	bool useLoadData = cSqlDbLoadData::isEnabled() &&
+			   !(id_main == STORE_PROC_ID_CDR && opt_mysql_mysql_redirect_cdr_queue);
 	__store_prepare_queries(queries, dbData, NULL,
 				&queries_str, &queries_list, NULL,
 				useNewStore(), useSetId(), opt_mysql_enable_multiple_rows_insert,
-				this->sqlDb->maxAllowedPacket);
+				this->sqlDb->maxAllowedPacket, useLoadData ? &loadData : NULL);
+	if(!loadData.isEmpty()) {
+		list<string> load_data_fallback;
+		loadData.store(dynamic_cast<SqlDb_mysql*>(this->sqlDb), &load_data_fallback, this->sqlDb->maxAllowedPacket);
+		for(list<string>::iterator iter = load_data_fallback.begin(); iter != load_data_fallback.end(); iter++) {
+			if(useNewStore() == 2) {
+				queries_list.push_back(*iter);
+			} else {
+				queries_str += sqlEscapeString(*iter) + _MYSQL_QUERY_END_new;
+			}
+		}
+	}
 	if(useNewStore() == 2) {
 		if(sverb.store_process_query_compl) {
 			cout << "store_process_query_compl_" << this->id_main << "_" << this->id_2 << endl;
@@ -3668,7 +4381,7 @@ void MySqlStore_process::__store(list<string> *queries) {
 				#endif
 			}
 		}
-	} else {
+	} else if(!queries_str.empty()) {
 		if(sverb.store_process_query_compl) {
 			cout << "store_process_query_compl_" << this->id_main << "_" << this->id_2 << endl
 			     << queries_str << endl;
@@ -285,6 +285,7 @@ private:
 	SqlDb *sqlDb;
 	vector<SqlDb_rowField> row;
 	bool ignoreCheckExistsField;
+friend class SqlDb_odbc_preparedInsert;
 };
 
 class SqlDb_rows {
@@ -747,6 +748,7 @@ public:
 	string getOptimalCompressType_mariadb(bool memoryEngine, bool useCache);
 	bool testCreateTable(bool memoryEngine, const char *compressType);
 	void setSelectedCompressType(bool memoryEngine, const char *type, const char *subtype = NULL);
+	bool loadData(string query, const char *data, size_t length, unsigned rows, bool *partiallyStored = NULL);
 private:
 	MYSQL *hMysql;
 	MYSQL *hMysqlConn;
@@ -788,6 +790,47 @@ public:
 	int getIndexField(string fieldName);
 };
 
+class SqlDb_odbc_preparedInsert {
+public:
+	struct sParam {
+		sParam() {
+			cType = SQL_C_CHAR;
+			sqlType = SQL_VARCHAR;
+			width = 0;
+			buffer = NULL;
+			ind = NULL;
+		}
+		SQLSMALLINT cType;
+		SQLSMALLINT sqlType;
+		SQLLEN width;
+		char *buffer;
+		SQLLEN *ind;
+	};
+public:
+	SqlDb_odbc_preparedInsert(string table, SqlDb_row *row);
+	~SqlDb_odbc_preparedInsert();
+	bool prepare(SQLHANDLE hConnection);
+	bool bindParams(vector<SqlDb_row*> *rows);
+	SQLRETURN execute();
+	bool isInserted(unsigned rowIndex);
+	string getLastError();
+	static bool isBindable(SqlDb_row *row);
+	static string getKey(string table, SqlDb_row *row);
+private:
+	void freeStatement();
+	void freeParams();
+	void setParamType(unsigned columnIndex, vector<SqlDb_row*> *rows);
+	static string unescapeContent(string &content);
+private:
+	string table;
+	vector<string> columns;
+	vector<sParam> params;
+	SQLHSTMT hStatement;
+	SQLUSMALLINT *paramStatus;
+	SQLULEN paramStatusSize;
+	SQLULEN paramsProcessed;
+};
+
 class SqlDb_odbc : public SqlDb {
 public:
 	SqlDb_odbc();
@@ -822,6 +865,8 @@ public:
 	void checkDbMode();
 	void checkSchema(int connectId = 0, bool checkColumnsSilentLog = false);
 	void updateSensorState();
+	bool insertArray(string table, vector<SqlDb_row*> *rows);
+	void cleanPreparedInserts();
 	string getTypeDb() {
 		return("odbc");
 	}
@@ -839,6 +884,70 @@ private:
 	SQLHANDLE hConnection;
 	SQLHANDLE hStatement;
 	SqlDb_odbc_bindBuffer bindBuffer;
+	map<string, SqlDb_odbc_preparedInsert*> preparedInserts;
+};
+
+class cSqlDbLoadData {
+public:
+	struct sBatch {
+		sBatch() {
+			rows = 0;
+		}
+		string table;
+		vector<string> columns;
+		vector<bool> ipv6Columns;
+		string data;
+		unsigned rows;
+	};
+public:
+	cSqlDbLoadData();
+	~cSqlDbLoadData();
+	bool add(class cDbTablesContent *tablesContent);
+	bool isEmpty() {
+		return(batches.empty());
+	}
+	void store(SqlDb_mysql *sqlDb, list<string> *fallback_inserts, long unsigned maxAllowedPacket);
+	void clear();
+	static bool isEnabled();
+	static void disable(const char *error);
+private:
+	string loadDataQuery(sBatch *batch);
+	void insertQueries(sBatch *batch, list<string> *dst, long unsigned maxAllowedPacket);
+private:
+	vector<sBatch*> batches;
+	map<string, sBatch*> batches_map;
+	static volatile bool disabled;
+};
+
+class cSqlDbArrayInsert {
+public:
+	struct sBatch {
+		string table;
+		vector<SqlDb_row*> rows;
+	};
+public:
+	cSqlDbArrayInsert(SqlDb *sqlDb);
+	~cSqlDbArrayInsert();
+	void add(string table, SqlDb_row *row);
+	void flush();
+	void clear();
+	static bool isEnabled();
+	static void disable(const char *error);
+private:
+	void flush(sBatch *batch);
+	void _clear();
+	void lock() {
+		__SYNC_LOCK_USLEEP(_sync, 10);
+	}
+	void unlock() {
+		__SYNC_UNLOCK(_sync);
+	}
+private:
+	SqlDb *sqlDb;
+	vector<sBatch*> batches;
+	map<string, sBatch*> batches_map;
+	volatile int _sync;
+	static volatile bool disabled;
 };
 
 class MySqlStore_process {
@@ -46,6 +46,7 @@ cSslDsslSession::cSslDsslSession(vmIP ip, vmPort port, string keyfile, string pa
 	stored_at = 0;
 	restored = false;
 	lastTimeSyslog = 0;
+	_sync_process = 0;
 	init();
 }
 
@@ -343,6 +344,8 @@ void cSslDsslSession::store_session(cSslDsslSessions *sessions, struct timeval t
 	   this->session->c_dec.version && this->session->s_dec.version &&
 	    (!this->stored_at || this->stored_at < (u_long)(ts.tv_sec - (session->version == TLS1_3_VERSION ? 60 : 3600)))) {
 		string session_data = get_session_data(ts);
+		// sessions are processed in parallel (each only under its own lock) - sqlDb is shared
+		sessions->lock_store();
 		SqlDb_row session_row_insert;
 		session_row_insert.add(existsColumns.ssl_sessions_id_sensor_is_unsigned && opt_id_sensor < 0 ? 0 : opt_id_sensor, "id_sensor");
 		session_row_insert.add(ip, "serverip", false, sessions->sqlDb, sessions->storeSessionsTableName().c_str());
@@ -360,8 +363,9 @@ void cSslDsslSession::store_session(cSslDsslSessions *sessions, struct timeval t
 		sqlStore->query_lock(MYSQL_ADD_QUERY_END(
 				     sessions->sqlDb->insertOrUpdateQuery(sessions->storeSessionsTableName(), session_row_insert, session_row_update, false, true)),
 				     STORE_PROC_ID_OTHER, 0);
-		this->stored_at = ts.tv_sec;
 		sessions->deleteOldSessions(ts);
+		sessions->unlock_store();
+		this->stored_at = ts.tv_sec;
 	}
 }
 
@@ -635,6 +639,7 @@ const char *cSslDsslSessionKeys::enumToStrType(eSessionKeyType type) {
 cSslDsslSessions::cSslDsslSessions() {
 	_sync_sessions = 0;
 	_sync_sessions_db = 0;
+	_sync_store = 0;
 	sqlDb = NULL;
 	last_delete_old_sessions_at = 0;
 	exists_sessions_table = false;
@@ -729,15 +734,21 @@ void cSslDsslSessions::processData(vector<string> *rslt_decrypt, char *data, uns
 		}
 	}
 	if(session) {
+		// the map lock only covers the lookup, decryption runs under the session lock
+		// (the session lock is taken before the map is unlocked - destroySession waits for it)
+		session->lock_process();
+		unlock_sessions();
 		session->processData(rslt_decrypt, data, datalen, 
 				     saddr, daddr, sport, dport, 
 				     ts, init_client_hello || init_store_session, this,
 				     forceTryIfExistsError);
+		session->unlock_process();
+	} else {
+		unlock_sessions();
 	}
 	if(sverb.ssl_stats) {
 		stats.delay_processData_end.add_delay_from_act(getTimeUS(ts));
 	}
-	unlock_sessions();
 }
 
 void cSslDsslSessions::destroySession(vmIP saddr, vmIP daddr, vmPort sport, vmPort dport) {
@@ -751,16 +762,22 @@ void cSslDsslSessions::destroySession(vmIP saddr, vmIP daddr, vmPort sport, vmPo
 		      dir == ePacketDirFromClient ? dport : sport,
 		      dir == ePacketDirFromClient ? saddr : daddr,
 		      dir == ePacketDirFromClient ? sport : dport);
+	cSslDsslSession *session = NULL;
 	map<sStreamId, cSslDsslSession*>::iterator iter_session;
 	iter_session = sessions.find(sid);
 	if(iter_session != sessions.end()) {
-		if(iter_session->second->get_keys_ok) {
-			keyErase(iter_session->second->session->client_random);
-		}
-		delete iter_session->second;
+		session = iter_session->second;
 		sessions.erase(iter_session);
 	}
 	unlock_sessions();
+	if(session) {
+		// wait for decryption in progress
+		session->lock_process();
+		if(session->get_keys_ok) {
+			keyErase(session->session->client_random);
+		}
+		delete session;
+	}
 }
 
 void cSslDsslSessions::keySet(const char *type, u_char *client_random, u_char *key, unsigned key_length) {
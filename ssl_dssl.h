@@ -64,6 +64,12 @@ private:
 	string get_session_data(struct timeval ts);
 	bool restore_session_data(const char *data);
 	void store_session(class cSslDsslSessions *sessions, struct timeval ts);
+	void lock_process() {
+		while(__sync_lock_test_and_set(&this->_sync_process, 1));
+	}
+	void unlock_process() {
+		__sync_lock_release(&this->_sync_process);
+	}
 private:
 	vmIP ip;
 	vmPort port;
@@ -83,6 +89,7 @@ private:
 	u_long stored_at;
 	bool restored;
 	u_int64_t lastTimeSyslog;
+	volatile int _sync_process;
 friend class cSslDsslSessions;
 };
 
@@ -187,11 +194,18 @@ private:
 	void unlock_sessions_db() {
 		__sync_lock_release(&this->_sync_sessions_db);
 	}
+	void lock_store() {
+		while(__sync_lock_test_and_set(&this->_sync_store, 1));
+	}
+	void unlock_store() {
+		__sync_lock_release(&this->_sync_store);
+	}
 private:
 	map<sStreamId, cSslDsslSession*> sessions;
 	map<sStreamId, sSessionData> sessions_db;
 	volatile int _sync_sessions;
 	volatile int _sync_sessions_db;
+	volatile int _sync_store;
 	cSslDsslSessionKeys session_keys;
 	SqlDb *sqlDb;
 	u_long last_delete_old_sessions_at;
@@ -221,12 +235,13 @@ struct sSslDsslStatsItem_time {
 	void add_delay_from_act(u_int64_t time_us) {
 		u_int64_t act = getTimeMS_rdtsc();
 		if(act >= time_us / 1000) {
+			// called from all ssl reassembly shards
 			u_int64_t delay = act - time_us / 1000;
-			sum_ms += delay;
-			++count;
-			if(delay > max_ms) {
-				max_ms = delay;
-			}
+			__sync_fetch_and_add(&sum_ms, delay);
+			__sync_fetch_and_add(&count, 1);
+			u_int32_t _max_ms;
+			while(delay > (_max_ms = max_ms) &&
+			      !__sync_bool_compare_and_swap(&max_ms, _max_ms, delay));
 		}
 	}
 	u_int32_t avg_ms() {
@@ -29,6 +29,7 @@ extern PreProcessPacket *preProcessPacket[PreProcessPacket::ppt_end_base];
 SslData::SslData() {
 	this->counterProcessData = 0;
 	this->counterDecryptData = 0;
+	this->counterPushPackets = 0;
 }
 
 SslData::~SslData() {
@@ -77,16 +78,11 @@ void SslData::processData(vmIP ip_src, vmIP ip_dst,
 				packet_flags pflags;
 				pflags.init();
 				pflags.tcp = 2;
-				preProcessPacket[PreProcessPacket::ppt_detach]->push_packet(
-						#if USE_PACKET_NUMBER
-						0, 
-						#endif
-						_ip_src, _port_src, _ip_dst, _port_dst, 
-						_datalen, dataOffset,
-						handle_index, tcpHeader, tcpPacket, true, 
-						pflags, (iphdr2*)(tcpPacket + ethHeaderLength), NULL,
-						NULL, 0, dlt, sensor_id, sensor_ip, pid,
-						false);
+				addPushPacket(_ip_src, _port_src, _ip_dst, _port_dst, 
+					      _datalen, dataOffset,
+					      handle_index, tcpHeader, tcpPacket, 
+					      pflags, (iphdr2*)(tcpPacket + ethHeaderLength), NULL,
+					      dlt, sensor_id, sensor_ip, pid);
 				continue;
 			}
 		}
@@ -379,10 +375,12 @@ void SslData::processData(vmIP ip_src, vmIP ip_dst,
 			}
 		}
 	}
+	pushPackets();
 	delete data;
 }
  
 void SslData::printContentSummary() {
+	cout << "SSL DATA: process " << counterProcessData << ", push packets " << counterPushPackets << endl;
 }
 
 void SslData::processPacket(u_char *ethHeader, unsigned ethHeaderLength, bool ethHeaderAlloc,
@@ -424,16 +422,11 @@ void SslData::processPacket(u_char *ethHeader, unsigned ethHeaderLength, bool et
 		pflags.init();
 		pflags.tcp = 2;
 		pflags.ssl = true;
-		preProcessPacket[PreProcessPacket::ppt_detach]->push_packet(
-			#if USE_PACKET_NUMBER
-			0, 
-			#endif
-			ip_src, port_src, ip_dst, port_dst, 
-			dataLength, dataOffset,
-			handle_index, tcpHeader, tcpPacket, true, 
-			pflags, (iphdr2*)(tcpPacket + ethHeaderLength), (iphdr2*)(tcpPacket + ethHeaderLength),
-			NULL, 0, dlt, sensor_id, sensor_ip, pid,
-			false);
+		addPushPacket(ip_src, port_src, ip_dst, port_dst, 
+			      dataLength, dataOffset,
+			      handle_index, tcpHeader, tcpPacket, 
+			      pflags, (iphdr2*)(tcpPacket + ethHeaderLength), (iphdr2*)(tcpPacket + ethHeaderLength),
+			      dlt, sensor_id, sensor_ip, pid, getTimeUS(time));
 	} else {
 		pcap_pkthdr *udpHeader;
 		u_char *udpPacket;
@@ -448,19 +441,11 @@ void SslData::processPacket(u_char *ethHeader, unsigned ethHeaderLength, bool et
 		packet_flags pflags;
 		pflags.init();
 		pflags.ssl = true;
-		preProcessPacket[PreProcessPacket::ppt_detach]->push_packet(
-			#if USE_PACKET_NUMBER
-			0,
-			#endif
-			ip_src, port_src, ip_dst, port_dst, 
-			dataLength, dataOffset,
-			handle_index, udpHeader, udpPacket, true, 
-			pflags, (iphdr2*)(udpPacket + ethHeaderLength), (iphdr2*)(udpPacket + ethHeaderLength),
-			NULL, 0, dlt, sensor_id, sensor_ip, pid,
-			false);
-	}
-	if(sverb.ssl_stats) {
-		ssl_stats_add_delay_processPacket(getTimeUS(time));
+		addPushPacket(ip_src, port_src, ip_dst, port_dst, 
+			      dataLength, dataOffset,
+			      handle_index, udpHeader, udpPacket, 
+			      pflags, (iphdr2*)(udpPacket + ethHeaderLength), (iphdr2*)(udpPacket + ethHeaderLength),
+			      dlt, sensor_id, sensor_ip, pid, getTimeUS(time));
 	}
 	if(ethHeaderAlloc) {
 		delete [] ethHeader;
@@ -470,6 +455,65 @@ void SslData::processPacket(u_char *ethHeader, unsigned ethHeaderLength, bool et
 	}
 }
 
+void SslData::addPushPacket(vmIP saddr, vmPort source, vmIP daddr, vmPort dest,
+			    int datalen, int dataoffset,
+			    u_int16_t handle_index, pcap_pkthdr *header, u_char *packet,
+			    packet_flags pflags, iphdr2 *header_ip_encaps, iphdr2 *header_ip,
+			    int dlt, int sensor_id, vmIP sensor_ip, sPacketInfoData pid, u_int64_t time_us) {
+	sPushPacket pushPacket;
+	pushPacket.saddr = saddr;
+	pushPacket.source = source;
+	pushPacket.daddr = daddr;
+	pushPacket.dest = dest;
+	pushPacket.datalen = datalen;
+	pushPacket.dataoffset = dataoffset;
+	pushPacket.handle_index = handle_index;
+	pushPacket.header = header;
+	pushPacket.packet = packet;
+	pushPacket.pflags = pflags;
+	pushPacket.header_ip_encaps = header_ip_encaps;
+	pushPacket.header_ip = header_ip;
+	pushPacket.dlt = dlt;
+	pushPacket.sensor_id = sensor_id;
+	pushPacket.sensor_ip = sensor_ip;
+	pushPacket.pid = pid;
+	pushPacket.time_us = time_us;
+	pushPacketsQueue.push_back(pushPacket);
+}
+
+void SslData::pushPackets() {
+	if(!pushPacketsQueue.size()) {
+		return;
+	}
+	// packets from one processData are pushed under a single push lock
+	// (the lock is shared with t0 and the other ssl reassembly shards)
+	PreProcessPacket *preProcessPacketDetach = preProcessPacket[PreProcessPacket::ppt_detach];
+	preProcessPacketDetach->push_packet_lock();
+	for(size_t i = 0; i < pushPacketsQueue.size(); i++) {
+		sPushPacket *pushPacket = &pushPacketsQueue[i];
+		preProcessPacketDetach->push_packet(
+			#if USE_PACKET_NUMBER
+			0,
+			#endif
+			pushPacket->saddr, pushPacket->source, pushPacket->daddr, pushPacket->dest, 
+			pushPacket->datalen, pushPacket->dataoffset,
+			pushPacket->handle_index, pushPacket->header, pushPacket->packet, true, 
+			pushPacket->pflags, pushPacket->header_ip_encaps, pushPacket->header_ip,
+			NULL, 0, pushPacket->dlt, pushPacket->sensor_id, pushPacket->sensor_ip, pushPacket->pid,
+			false, false);
+	}
+	preProcessPacketDetach->push_packet_unlock();
+	if(sverb.ssl_stats) {
+		for(size_t i = 0; i < pushPacketsQueue.size(); i++) {
+			if(pushPacketsQueue[i].time_us) {
+				ssl_stats_add_delay_processPacket(pushPacketsQueue[i].time_us);
+			}
+		}
+	}
+	counterPushPackets += pushPacketsQueue.size();
+	pushPacketsQueue.clear();
+}
+
 
 bool checkOkSslData(u_char *data, u_int32_t datalen) {
 	if(!data) {
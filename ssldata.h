@@ -68,7 +68,34 @@ public:
 			 void *uData, void *uData2, void *uData2_last, TcpReassemblyLink *reassemblyLink,
 			 std::ostream *debugStream);
 	void printContentSummary();
+	TcpReassemblyProcessData *createShardDataCallback() {
+		extern int opt_enable_ssl;
+		if(opt_enable_ssl == 10) {
+			// gnutls decrypt_ssl uses static buffers and unlocked session lookup - not thread safe
+			return(NULL);
+		}
+		return(new FILE_LINE(0) SslData);
+	}
 private:
+	struct sPushPacket {
+		vmIP saddr;
+		vmPort source;
+		vmIP daddr;
+		vmPort dest;
+		int datalen;
+		int dataoffset;
+		u_int16_t handle_index;
+		pcap_pkthdr *header;
+		u_char *packet;
+		packet_flags pflags;
+		iphdr2 *header_ip_encaps;
+		iphdr2 *header_ip;
+		int dlt;
+		int sensor_id;
+		vmIP sensor_ip;
+		sPacketInfoData pid;
+		u_int64_t time_us;
+	};
 	void processPacket(ReassemblyBuffer::sDataRslt *dataRslt) {
 		processPacket(dataRslt->ethHeader, dataRslt->ethHeaderLength, dataRslt->ethHeaderAlloc,
 			      dataRslt->data, dataRslt->dataLength, dataRslt->type, dataRslt->dataAlloc,
@@ -81,9 +108,17 @@ private:
 			   vmIP ip_src, vmIP ip_dst, vmPort port_src, vmPort port_dst,
 			   timeval time, u_int32_t ack, u_int32_t seq,
 			   u_int16_t handle_index, int dlt, int sensor_id, vmIP sensor_ip, sPacketInfoData pid);
+	void addPushPacket(vmIP saddr, vmPort source, vmIP daddr, vmPort dest,
+			   int datalen, int dataoffset,
+			   u_int16_t handle_index, pcap_pkthdr *header, u_char *packet,
+			   packet_flags pflags, iphdr2 *header_ip_encaps, iphdr2 *header_ip,
+			   int dlt, int sensor_id, vmIP sensor_ip, sPacketInfoData pid, u_int64_t time_us = 0);
+	void pushPackets();
 private:
 	unsigned int counterProcessData;
 	unsigned int counterDecryptData;
+	unsigned int counterPushPackets;
+	vector<sPushPacket> pushPacketsQueue;
 	ReassemblyBuffer reassemblyBuffer;
 };
 
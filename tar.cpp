@@ -59,13 +59,16 @@ using namespace std;
 volatile unsigned int glob_tar_queued_files;
 
 extern bool opt_pcap_dump_tar_use_hash_instead_of_long_callid;
-extern int opt_pcap_dump_tar_compress_sip; //0 off, 1 gzip, 2 lzma
+extern int opt_pcap_dump_tar_compress_sip; //0 off, 1 gzip, 2 lzma, 3 zstd
 extern int opt_pcap_dump_tar_sip_level;
 extern int opt_pcap_dump_tar_compress_rtp;
 extern int opt_pcap_dump_tar_rtp_level;
 extern int opt_pcap_dump_tar_compress_graph;
 extern int opt_pcap_dump_tar_graph_level;
+extern bool opt_pcap_dump_tar_seekable;
 extern int opt_pcap_dump_tar_threads;
+extern int opt_pcap_dump_tar_zstd_workers;
+extern bool opt_zstd_long_rtp;
 
 extern int opt_filesclean;
 extern int opt_nocdr;
@@ -299,6 +302,9 @@ Tar::tar_open(string pathname, int oflags, int options)
 				continue;
 			} else {
 				rename(pathname.c_str(), newpathname.str().c_str());
+				if(file_exists(pathname + TAR_INDEX_SUFFIX)) {
+					rename((pathname + TAR_INDEX_SUFFIX).c_str(), (newpathname.str() + TAR_INDEX_SUFFIX).c_str());
+				}
 				if(sverb.tar) {
 					syslog(LOG_NOTICE, "tar: renaming %s -> %s", pathname.c_str(), newpathname.str().c_str());
 				}
@@ -306,6 +312,10 @@ Tar::tar_open(string pathname, int oflags, int options)
 			}
 		}
 	}
+	if(oflags & O_CREAT) {
+		// index without its tar must not be used for new tar (it may be written not seekable)
+		unlink((this->pathname + TAR_INDEX_SUFFIX).c_str());
+	}
 	tar.fd = open((char*)this->pathname.c_str(), 
 		      oflags | 
 		      #ifndef FREEBSD
@@ -366,12 +376,17 @@ Tar::chunkbuffer_iterate_ev(char *data, u_int32_t len, u_int32_t pos) {
 void
 Tar::tar_read(const char *filename, u_int32_t recordId, const char *tableType, const char *tarPosString) {
 	bool enableDetectTarPos = true;
+	bool useIndex = false;
 	if(!reg_match(this->pathname.c_str(), "tar\\.gz", __FILE__, __LINE__) &&
-	   !reg_match(this->pathname.c_str(), "tar\\.xz", __FILE__, __LINE__)) {
+	   !reg_match(this->pathname.c_str(), "tar\\.xz", __FILE__, __LINE__) &&
+	   !reg_match(this->pathname.c_str(), "tar\\.zst", __FILE__, __LINE__)) {
 		this->readData.send_parameters_zip = false;
 	} else {
 		enableDetectTarPos = false;
-		if(flushTar(this->pathname.c_str())) {
+		if(file_exists(this->pathname + TAR_INDEX_SUFFIX)) {
+			// members of seekable tar are complete compressed frames - flush is not needed
+			useIndex = true;
+		} else if(flushTar(this->pathname.c_str())) {
 			syslog(LOG_NOTICE, "flush %s in tar_read", this->pathname.c_str());
 		}
 	}
@@ -385,6 +400,8 @@ Tar::tar_read(const char *filename, u_int32_t recordId, const char *tableType, c
 									 CompressStream::gzip :
 									reg_match(this->pathname.c_str(), "tar\\.xz", __FILE__, __LINE__) ?
 									 CompressStream::lzma :
+									reg_match(this->pathname.c_str(), "tar\\.zst", __FILE__, __LINE__) ?
+									 CompressStream::zstd :
 									 CompressStream::compress_na,
 									this->readData.bufferBaseSize, 0);
 	size_t read_position = 0;
@@ -392,7 +409,12 @@ Tar::tar_read(const char *filename, u_int32_t recordId, const char *tableType, c
 	char *read_buffer = new FILE_LINE(34002) char[T_BLOCKSIZE];
 	bool decompressFailed = false;
 	list<u_int64_t> tarPos;
-	if(tarPosString && *tarPosString && *tarPosString != 'x') {
+	list<sIndexItem> indexItems;
+	if(useIndex) {
+		if(!this->tar_read_index(&indexItems)) {
+			useIndex = false;
+		}
+	} else if(tarPosString && *tarPosString && *tarPosString != 'x') {
 		vector<string> tarPosStr = split(tarPosString, ",");
 		for(size_t i = 0; i < tarPosStr.size(); i++) {
 			tarPos.push_back(atoll(tarPosStr[i].c_str()));
@@ -422,7 +444,33 @@ Tar::tar_read(const char *filename, u_int32_t recordId, const char *tableType, c
 			delete sqlDb;
 		}
 	}
-	if(tarPos.size()) {
+	if(useIndex) {
+		for(list<sIndexItem>::iterator it = indexItems.begin(); it != indexItems.end(); it++) {
+			if(lseek(tar.fd, it->offset, SEEK_SET) == (off_t)-1) {
+				this->readData.error = true;
+				break;
+			}
+			decompressStream->termDecompress();
+			this->readData.oneFile = true;
+			this->readData.end = false;
+			this->readData.position = 0;
+			this->readData.bufferLength = 0;
+			this->readData.fileSize = 0;
+			this->readData.nullFileHeader();
+			u_int64_t frame_rest = it->length;
+			while(frame_rest && !this->readData.end && !this->readData.error &&
+			      (read_size = read(tar.fd, read_buffer, min(frame_rest, (u_int64_t)T_BLOCKSIZE))) > 0) {
+				frame_rest -= read_size;
+				if(!decompressStream->decompress(read_buffer, read_size, 0, false, this)) {
+					decompressFailed = true;
+					break;
+				}
+			}
+			if(decompressFailed || this->readData.error) {
+				break;
+			}
+		}
+	} else if(tarPos.size()) {
 		for(list<u_int64_t>::iterator it = tarPos.begin(); it != tarPos.end(); it++) {
 			if(!lseek(tar.fd, *it)) {
 				this->readData.error = true;
@@ -606,20 +654,7 @@ Tar::tar_read_block_ev(char *data) {
 extern int _sendvm(int socket, void *c_client, const char *buf, size_t len, int mode);
 void 
 Tar::tar_read_file_ev(tar_header fileHeader, char *data, u_int32_t /*pos*/, u_int32_t len) {
-	unsigned cmpLengthNameInTar = strlen(fileHeader.name);
-	if(reg_match(fileHeader.name, "#[0-9]+$", __FILE__, __LINE__) ||
-	   reg_match(fileHeader.name, "_[0-9]{1,6}$", __FILE__, __LINE__)) {
-		while(isdigit(fileHeader.name[cmpLengthNameInTar - 1])) {
-			--cmpLengthNameInTar;
-		}
-		--cmpLengthNameInTar;
-	}
-	if(((this->readData.filename.length() > TAR_FILENAME_RESERVE_LIMIT || 
-	     cmpLengthNameInTar == this->readData.filename.length()) &&
-	    !strncmp(fileHeader.name, this->readData.filename.c_str(), cmpLengthNameInTar)) ||
-	   (!this->readData.hash_filename.empty() && 
-	    cmpLengthNameInTar == this->readData.hash_filename.length() && 
-	    !strncmp(fileHeader.name, this->readData.hash_filename.c_str(), cmpLengthNameInTar))) {
+	if(this->tar_read_check_filename(fileHeader.name)) {
 		if(len) {
 			if(!this->readData.decompressStreamFromLzo) {
 				this->readData.decompressStreamFromLzo = new FILE_LINE(34004) CompressStream(CompressStream::compress_auto, 0, 0);
@@ -653,6 +688,84 @@ Tar::tar_read_file_ev(tar_header fileHeader, char *data, u_int32_t /*pos*/, u_in
 	}
 }
 
+bool
+Tar::tar_read_check_filename(const char *name) {
+	unsigned cmpLengthNameInTar = strlen(name);
+	if(reg_match(name, "#[0-9]+$", __FILE__, __LINE__) ||
+	   reg_match(name, "_[0-9]{1,6}$", __FILE__, __LINE__)) {
+		while(isdigit(name[cmpLengthNameInTar - 1])) {
+			--cmpLengthNameInTar;
+		}
+		--cmpLengthNameInTar;
+	}
+	return(((this->readData.filename.length() > TAR_FILENAME_RESERVE_LIMIT || 
+		 cmpLengthNameInTar == this->readData.filename.length()) &&
+		!strncmp(name, this->readData.filename.c_str(), cmpLengthNameInTar)) ||
+	       (!this->readData.hash_filename.empty() && 
+		cmpLengthNameInTar == this->readData.hash_filename.length() && 
+		!strncmp(name, this->readData.hash_filename.c_str(), cmpLengthNameInTar)));
+}
+
+bool
+Tar::tar_read_index(list<sIndexItem> *items) {
+	FILE *file = fopen((this->pathname + TAR_INDEX_SUFFIX).c_str(), "r");
+	if(!file) {
+		return(false);
+	}
+	char line[TAR_FILENAME_LENGTH + 100];
+	while(fgets(line, sizeof(line), file)) {
+		// offset length name - incomplete last line (member just being added) is skipped
+		char *lineEnd = strchr(line, '\n');
+		if(!lineEnd) {
+			break;
+		}
+		*lineEnd = 0;
+		sIndexItem item;
+		int namePos = 0;
+		if(sscanf(line, "%llu %llu %n", (unsigned long long*)&item.offset, (unsigned long long*)&item.length, &namePos) == 2 &&
+		   namePos && this->tar_read_check_filename(line + namePos)) {
+			items->push_back(item);
+		}
+	}
+	fclose(file);
+	return(true);
+}
+
+void
+Tar::seekable_member_begin() {
+	// fd is O_APPEND - file offset is not at end of file before first write, use file size
+	struct stat st;
+	seekableMemberOffset = fstat(tar.fd, &st) == 0 ? st.st_size : 0;
+}
+
+void
+Tar::seekable_member_end() {
+	if(!finishCompressFrame()) {
+		return;
+	}
+	struct stat st;
+	if(fstat(tar.fd, &st) != 0 || (u_int64_t)st.st_size <= seekableMemberOffset) {
+		return;
+	}
+	u_int64_t offset = st.st_size;
+	if(!indexFile) {
+		string indexPathname = pathname + TAR_INDEX_SUFFIX;
+		int indexFd = open(indexPathname.c_str(), O_WRONLY | O_CREAT | O_APPEND, spooldir_file_permission());
+		if(indexFd == -1) {
+			syslog(LOG_ERR, "tar: failed to create index %s", indexPathname.c_str());
+			seekable = false;
+			return;
+		}
+		spooldir_chown(indexFd);
+		indexFile = fdopen(indexFd, "a");
+	}
+	fprintf(indexFile, "%llu %llu %s\n",
+		(unsigned long long)seekableMemberOffset,
+		(unsigned long long)(offset - seekableMemberOffset),
+		tar.th_buf.name);
+	fflush(indexFile);
+}
+
 int    
 Tar::initZip() {
 	if(!this->zipStream) {
@@ -802,9 +915,103 @@ Tar::writeLzma(const void *buf, size_t len) {
 }      
 #endif
 
+#ifdef HAVE_LIBZSTD
+static int tar_zstd_workers() {
+	if(opt_pcap_dump_tar_zstd_workers >= 0) {
+		return(opt_pcap_dump_tar_zstd_workers);
+	}
+	// auto - cpu cores are divided between tar threads (tar_maxthreads)
+	int workers = sysconf(_SC_NPROCESSORS_ONLN) / max(opt_pcap_dump_tar_threads, 1);
+	return(workers >= 2 ? workers : 0);
+}
+
+int
+Tar::initZstd() {
+	if(!this->zstdStream) {
+		zstdworkers = tar_zstd_workers();
+		this->zstdStream = ZSTD_createCCtx();
+		if(!this->zstdStream) {
+			syslog(LOG_ERR, "tar: zstd initialize failed");
+			return(false);
+		}
+		ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_compressionLevel, zstdlevel);
+		if(zstdlong) {
+			ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_enableLongDistanceMatching, 1);
+		}
+		if(zstdworkers > 0 &&
+		   ZSTD_isError(ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_nbWorkers, zstdworkers))) {
+			static bool warning_mt;
+			if(!warning_mt) {
+				syslog(LOG_NOTICE, "tar: libzstd without multithread support - tar_zstd_workers ignored");
+				warning_mt = true;
+			}
+		}
+		this->zipBufferLength = ZSTD_CStreamOutSize();
+		this->zipBuffer = new FILE_LINE(0) char[this->zipBufferLength];
+	}
+	return(true);
+}
+
+bool 
+Tar::flushZstd() {
+	if(!writeCounter || writeCounterFlush >= writeCounter) {
+		return(false);
+	}
+	// ZSTD_e_end finishes frame, next write begins new frame in the same context
+	ZSTD_inBuffer inBuffer = { NULL, 0, 0 };
+	size_t rslt;
+	do {
+		ZSTD_outBuffer outBuffer = { this->zipBuffer, (size_t)this->zipBufferLength, 0 };
+		rslt = ZSTD_compressStream2(this->zstdStream, &outBuffer, &inBuffer, ZSTD_e_end);
+		if(ZSTD_isError(rslt)) {
+			syslog(LOG_ERR, "tar: zstd flush error: %s", ZSTD_getErrorName(rslt));
+			break;
+		}
+		if(outBuffer.pos &&
+		   ::write(tar.fd, (const char*)this->zipBuffer, outBuffer.pos) <= 0) {
+			break;
+		}
+	} while(rslt);
+	writeCounterFlush = writeCounter;
+	return(true);
+}
+
+int
+Tar::writeZstd(const void *buf, size_t len) {
+	if(!this->initZstd()) {
+		return(false);
+	}
+	++writeCounter;
+	ZSTD_inBuffer inBuffer = { buf, len, 0 };
+	do {
+		ZSTD_outBuffer outBuffer = { this->zipBuffer, (size_t)this->zipBufferLength, 0 };
+		size_t rslt = ZSTD_compressStream2(this->zstdStream, &outBuffer, &inBuffer, ZSTD_e_continue);
+		if(ZSTD_isError(rslt)) {
+			syslog(LOG_ERR, "tar: zstd compress error: %s", ZSTD_getErrorName(rslt));
+			return(false);
+		}
+		if(outBuffer.pos &&
+		   ::write(tar.fd, (const char*)this->zipBuffer, outBuffer.pos) <= 0) {
+			return(false);
+		}
+	} while(inBuffer.pos < inBuffer.size);
+	return(true);
+}
+#endif
+
 bool
 Tar::flush() {
 	tarlock();
+	bool _flush = finishCompressFrame();
+	if(_flush && sverb.tar) {
+		syslog(LOG_NOTICE, "force flush %s", this->pathname.c_str());
+	}
+	tarunlock();
+	return(_flush);
+}
+
+bool
+Tar::finishCompressFrame() {
 	bool _flush = false;
 #ifdef HAVE_LIBLZMA
 	if(this->lzmaStream) {
@@ -830,10 +1037,13 @@ Tar::flush() {
 			_flush = true;
 		}
 	}
-	if(_flush && sverb.tar) {
-		syslog(LOG_NOTICE, "force flush %s", this->pathname.c_str());
+#ifdef HAVE_LIBZSTD
+	if(this->zstdStream) {
+		if(this->flushZstd()) {
+			_flush = true;
+		}
 	}
-	tarunlock();
+#endif
 	return(_flush);
 }
 
@@ -844,6 +1054,7 @@ Tar::tar_block_write(const char *buf, u_int32_t len){
 	}
 	int zip = false;
 	int lzma = false;
+	int zstd = false;
 	switch(tar.qtype) {
 	case 1:
 		if(opt_pcap_dump_tar_compress_sip == 1) {
@@ -852,6 +1063,10 @@ Tar::tar_block_write(const char *buf, u_int32_t len){
 		} else if(opt_pcap_dump_tar_compress_sip == 2) {
 			lzmalevel = opt_pcap_dump_tar_sip_level;
 			lzma = true;
+		} else if(opt_pcap_dump_tar_compress_sip == 3) {
+			zstdlevel = opt_pcap_dump_tar_sip_level;
+			zstdlong = false;
+			zstd = true;
 		}
 		break;
 	case 2:
@@ -861,6 +1076,10 @@ Tar::tar_block_write(const char *buf, u_int32_t len){
 		} else if(opt_pcap_dump_tar_compress_rtp == 2) {
 			lzmalevel = opt_pcap_dump_tar_rtp_level;
 			lzma = true;
+		} else if(opt_pcap_dump_tar_compress_rtp == 3) {
+			zstdlevel = opt_pcap_dump_tar_rtp_level;
+			zstdlong = opt_zstd_long_rtp;
+			zstd = true;
 		}
 		break;
 	case 3:
@@ -870,6 +1089,10 @@ Tar::tar_block_write(const char *buf, u_int32_t len){
 		} else if(opt_pcap_dump_tar_compress_graph == 2) {
 			lzmalevel = opt_pcap_dump_tar_graph_level;
 			lzma = true;
+		} else if(opt_pcap_dump_tar_compress_graph == 3) {
+			zstdlevel = opt_pcap_dump_tar_graph_level;
+			zstdlong = false;
+			zstd = true;
 		}
 		break;
 	}
@@ -880,6 +1103,10 @@ Tar::tar_block_write(const char *buf, u_int32_t len){
 		#ifdef HAVE_LIBLZMA
 		writeLzma((char *)(buf), len);
 		#endif //HAVE_LIBLZMA
+	} else if(zstd) {
+		#ifdef HAVE_LIBZSTD
+		writeZstd((char *)(buf), len);
+		#endif //HAVE_LIBZSTD
 	} else {
 		::write(tar.fd, (char *)(buf), len);
 	}
@@ -908,10 +1135,21 @@ void Tar::tar_close() {
 			delete this->lzmaStream;
 			this->lzmaStream = NULL;
 		}
+	#endif
+	#ifdef HAVE_LIBZSTD
+		if(this->zstdStream) {
+			flushZstd();
+			ZSTD_freeCCtx(this->zstdStream);
+			this->zstdStream = NULL;
+		}
 	#endif
 		if(this->zipBuffer) {
 			delete [] this->zipBuffer;
 		}
+		if(this->indexFile) {
+			fclose(this->indexFile);
+			this->indexFile = NULL;
+		}
 		addtofilesqueue();
 		if(sverb.tar) { 
 			syslog(LOG_NOTICE, "tar %s destroyd (destructor)\n", pathname.c_str());
@@ -927,6 +1165,13 @@ string Tar::get_hashcomb_long_filename(const char *filename) {
 }
 
 void Tar::addtofilesqueue() {
+	addtofilesqueue(pathname);
+	if(seekable) {
+		addtofilesqueue(pathname + TAR_INDEX_SUFFIX);
+	}
+}
+
+void Tar::addtofilesqueue(string pathname) {
 
 	if(!opt_filesclean or opt_nocdr or !isSqlDriver("mysql") or !CleanSpool::isSetCleanspoolParameters(spoolIndex)) return;
 
@@ -1074,6 +1319,9 @@ TarQueue::write(int qtype, data_t data) {
 		case 2:
 			tar_name << ".xz";
 			break;
+		case 3:
+			tar_name << ".zst";
+			break;
 		}
 		break;
 	case 2:
@@ -1084,6 +1332,9 @@ TarQueue::write(int qtype, data_t data) {
 		case 2:
 			tar_name << ".xz";
 			break;
+		case 3:
+			tar_name << ".zst";
+			break;
 		}
 		break;
 	case 3:
@@ -1094,6 +1345,9 @@ TarQueue::write(int qtype, data_t data) {
 		case 2:
 			tar_name << ".xz";
 			break;
+		case 3:
+			tar_name << ".zst";
+			break;
 		}
 		break;
 	}
@@ -1116,6 +1370,10 @@ TarQueue::write(int qtype, data_t data) {
 		pthread_mutex_unlock(&tarslock);
 		tar->tar_open(tar_name.str(), O_WRONLY | O_CREAT | O_APPEND, TAR_GNU);
 		tar->tar.qtype = qtype;
+		tar->seekable = opt_pcap_dump_tar_seekable &&
+				(qtype == 1 ? opt_pcap_dump_tar_compress_sip :
+				 qtype == 2 ? opt_pcap_dump_tar_compress_rtp :
+				 qtype == 3 ? opt_pcap_dump_tar_compress_graph : 0);
 		tar->time = data;
 		tar->created_at = data.time;
 		tar->spoolIndex = spoolIndex;
@@ -1432,6 +1690,9 @@ TarQueue::tarthreads_t::processData(TarQueue *tarQueue, const char *tarName,
 			tar->th_set_mtime(data->time);
 			tar->th_set_size(lenForProceedSafe);
 			tar->th_set_path((char*)data->filename.c_str(), !isClosed);
+			if(tar->seekable) {
+				tar->seekable_member_begin();
+			}
 			
 			#if TAR_PROF
 			__prof_i1 = rdtsc();
@@ -1450,6 +1711,9 @@ TarQueue::tarthreads_t::processData(TarQueue *tarQueue, const char *tarName,
 				if(sverb.chunk_buffer > 2) {
 					cout << " *** " << data->buffer->getName() << " " << lenForProceedSafe << endl;
 				}
+				if(tar->seekable) {
+					tar->seekable_member_end();
+				}
 			}
 			tar->writing = 0;
 		}
@@ -38,6 +38,8 @@
 
 #define TAR_CHUNK_KB	128
 
+#define TAR_INDEX_SUFFIX ".idx"
+
 #define TAR_FILENAME_LENGTH 100u
 #define TAR_FILENAME_LENGTH_RESERVE 8u
 #define TAR_FILENAME_RESERVE_LIMIT (TAR_FILENAME_LENGTH - TAR_FILENAME_LENGTH_RESERVE)
@@ -91,6 +93,10 @@ public:
 			return(octal_decimal((u_int32_t)atol(size_pointer)));
 		}
 	};
+	struct sIndexItem {
+		u_int64_t offset;
+		u_int64_t length;
+	};
 	typedef int (*openfunc_t)(const char *, int, ...);
 	typedef int (*closefunc_t)(int);
 	typedef ssize_t (*readfunc_t)(int, void *, size_t);
@@ -118,6 +124,13 @@ public:
 	data_tar_time time;
 	unsigned int created_at;
 	int thread_id;
+	/*
+	 seekable compressed tar (tar_seekable)
+	 - each member (header + data) is compressed as independent gzip member / xz stream / zstd frame
+	 - (offset, length) of each member in compressed file is appended to sidecar index <tar>.idx
+	 - tar_read decompresses only members from index, without flush of open tar and without scan from begin of file
+	*/
+	bool seekable;
 	
 
 	Tar() {    
@@ -125,6 +138,9 @@ public:
 		this->zipStream = NULL;
 #ifdef HAVE_LIBLZMA
 		this->lzmaStream = NULL;
+#endif
+#ifdef HAVE_LIBZSTD
+		this->zstdStream = NULL;
 #endif
 		this->zipBuffer = NULL;
 		memset(&tar, 0, sizeof(tar));
@@ -136,6 +152,9 @@ public:
 		writeCounterFlush = 0;
 		this->writing = 0;
 		this->_sync_lock = 0;
+		this->seekable = false;
+		this->indexFile = NULL;
+		this->seekableMemberOffset = 0;
 	};
 	virtual ~Tar();
 
@@ -152,8 +171,15 @@ public:
 	virtual bool decompress_ev(char *data, u_int32_t len);
 	void tar_read_block_ev(char *data);
 	void tar_read_file_ev(tar_header fileHeader, char *data, u_int32_t pos, u_int32_t len);
+	bool tar_read_check_filename(const char *name);
+	bool tar_read_index(list<sIndexItem> *items);
+	void seekable_member_begin();
+	void seekable_member_end();
 	int gziplevel;
 	int lzmalevel;
+	int zstdlevel;
+	int zstdworkers;
+	bool zstdlong;
 
 	void th_set_type(mode_t mode);
 	void th_set_path(char *pathname, bool partSuffix = false);
@@ -184,9 +210,15 @@ public:
 	int initLzma();
 	bool flushLzma();
 	int writeLzma(const void *buf, size_t len);
+#endif
+#ifdef HAVE_LIBZSTD
+	int initZstd();
+	bool flushZstd();
+	int writeZstd(const void *buf, size_t len);
 #endif
 	bool flush();
 	void addtofilesqueue();
+	void addtofilesqueue(string pathname);
 	
 	bool isReadError() {
 		return(readData.error);
@@ -205,6 +237,7 @@ public:
 		__sync_lock_release(&this->_sync_lock);
 	}
 private:
+	bool finishCompressFrame();
 	z_stream *zipStream;
 	int zipBufferLength;
 	char *zipBuffer;
@@ -217,6 +250,8 @@ private:
 	u_int64_t tarLength;
 	volatile u_int32_t writeCounter;
 	volatile u_int32_t writeCounterFlush;
+	FILE *indexFile;
+	u_int64_t seekableMemberOffset;
 	
 	class ReadData : public CompressStream_baseEv {
 	public:
@@ -294,6 +329,9 @@ private:
 	#define LZMA_RET_ERROR_OUTPUT	3
 	#define LZMA_RET_ERROR_COMPRESSION   4
 
+#endif
+#ifdef HAVE_LIBZSTD
+	ZSTD_CCtx *zstdStream;
 #endif
 
 	volatile int _sync_lock;
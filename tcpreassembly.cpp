@@ -58,18 +58,18 @@ bool TcpReassemblyData::isFill() {
 }
 
 
-void TcpReassemblyStream_packet_var::push(TcpReassemblyStream_packet packet) {
+void TcpReassemblyStream_packet_var::push(const TcpReassemblyStream_packet &packet) {
 	map<uint32_t, TcpReassemblyStream_packet>::iterator iter;
 	iter = this->queuePackets.find(packet.next_seq);
-	if(iter == this->queuePackets.end() ||
-	   (iter->second.datalen && iter->second.data[0] == 0 && packet.datalen && packet.data[0] != 0)) {
-		this->queuePackets[packet.next_seq];
-		this->queuePackets[packet.next_seq] = packet;
+	if(iter == this->queuePackets.end()) {
+		this->queuePackets.insert(make_pair(packet.next_seq, packet));
+	} else if(iter->second.datalen && iter->second.data[0] == 0 && packet.datalen && packet.data[0] != 0) {
+		iter->second = packet;
 	}
-	this->last_packet_at_from_header = getTimeMS(&packet.time);
+	this->last_packet_at_from_header = getTimeMS(packet.time.tv_sec, packet.time.tv_usec);
 }
 
-void TcpReassemblyStream::push(TcpReassemblyStream_packet packet) {
+void TcpReassemblyStream::push(const TcpReassemblyStream_packet &packet) {
 	if(link->reassembly->enableSmartCompleteData) {
 		this->clearCompleteData();
 		this->is_ok = false;
@@ -81,7 +81,7 @@ void TcpReassemblyStream::push(TcpReassemblyStream_packet packet) {
 	if(PACKET_DATALEN(packet.datalen, packet.datacaplen)) {
 		exists_data = true;
 	}
-	this->last_packet_at_from_header = getTimeMS(&packet.time);
+	this->last_packet_at_from_header = getTimeMS(packet.time.tv_sec, packet.time.tv_usec);
 }
 
 int TcpReassemblyStream::ok(bool crazySequence, bool enableSimpleCmpMaxNextSeq, u_int32_t maxNextSeq,
@@ -401,7 +401,7 @@ u_char *TcpReassemblyStream::complete(u_int32_t *datalen, deque<s_index_item> *d
 	u_int32_t lastNextSeq = 0;
 	size_t i;
 	for(i = startIndex; i < this->ok_packets.size(); i++) {
-		TcpReassemblyStream_packet packet = this->queuePacketVars[this->ok_packets[i][0]].queuePackets[this->ok_packets[i][1]];
+		TcpReassemblyStream_packet &packet = this->queuePacketVars[this->ok_packets[i][0]].queuePackets[this->ok_packets[i][1]];
 		if(PACKET_DATALEN(packet.datalen, packet.datacaplen) && 
 		   !(link->reassembly->ignoreZeroData && packet.data[0] == 0)) {
 			if(seq && !*seq) {
@@ -1308,7 +1308,7 @@ bool TcpReassemblyLink::push_crazy(
 }
 
 void TcpReassemblyLink::pushpacket(TcpReassemblyStream::eDirection direction,
-				   TcpReassemblyStream_packet packet,
+				   const TcpReassemblyStream_packet &packet,
 				   bool isSip) {
 	TcpReassemblyStream *stream;
 	map<uint32_t, TcpReassemblyStream*>::iterator iter;
@@ -1358,7 +1358,7 @@ void TcpReassemblyLink::pushpacket(TcpReassemblyStream::eDirection direction,
 		stream->max_next_seq = packet.next_seq;
 	}
 	this->last_ack = stream->ack;
-	this->last_packet_at_from_header = getTimeMS(&packet.time);
+	this->last_packet_at_from_header = getTimeMS(packet.time.tv_sec, packet.time.tv_usec);
 }
 
 void TcpReassemblyLink::printContent(int level) {
@@ -2961,8 +2961,12 @@ bool TcpReassemblyLink::checkDuplicitySeq(u_int32_t newSeq) {
 }
 
 
-TcpReassembly::TcpReassembly(eType type) {
+TcpReassembly::TcpReassembly(eType type, TcpReassembly *shardParent) {
 	this->type = type;
+	this->shardParent = shardParent;
+	this->shards = NULL;
+	this->shardsDataCallback = NULL;
+	this->shardsCount = 0;
 	this->_sync_links = 0;
 	this->_sync_push = 0;
 	this->_sync_cleanup = 0;
@@ -3025,7 +3029,7 @@ TcpReassembly::TcpReassembly(eType type) {
 	case ssl: log = opt_tcpreassembly_ssl_log; break;
 	case sip: log = opt_tcpreassembly_sip_log; break;
 	}
-	if(log && *log) {
+	if(log && *log && !shardParent) {
 		this->log = fopen(log, "at");
 		if(this->log) {
 			this->addLog((string(" -- start ") + sqlDateTimeString(getTimeMS()/1000)).c_str());
@@ -3041,6 +3045,14 @@ TcpReassembly::TcpReassembly(eType type) {
 }
 
 TcpReassembly::~TcpReassembly() {
+	if(this->shards) {
+		for(unsigned i = 0; i < this->shardsCount; i++) {
+			delete this->shards[i];
+			delete this->shardsDataCallback[i];
+		}
+		delete [] this->shards;
+		delete [] this->shardsDataCallback;
+	}
 	if(this->initCleanupThreadOk) {
 		this->terminatingCleanupThread = true;
 		pthread_join(this->cleanupThreadHandle, NULL);
@@ -3139,6 +3151,35 @@ double TcpReassembly::getPacketCpuUsagePerc(bool preparePstatData) {
 
 string TcpReassembly::getCpuUsagePerc() {
 	ostringstream outStr;
+	if(this->shardsCount) {
+		outStr << fixed;
+		size_t links_size = 0;
+		for(unsigned i = 0; i < this->shardsCount; i++) {
+			double tPacketCpu = this->shards[i]->getPacketCpuUsagePerc(true);
+			if(i) {
+				outStr << '|';
+			}
+			outStr << setprecision(1) << (tPacketCpu >= 0 ? tPacketCpu : 0);
+			links_size += this->shards[i]->links.size();
+		}
+		outStr << '%';
+		if(links_size) {
+			outStr << '|' << links_size << 'l';
+			extern int opt_sip_tcp_reassembly_ext_quick_mod;
+			if(opt_sip_tcp_reassembly_ext_quick_mod != 2 && this->enableExtStat) {
+				unsigned sumStreams = 0;
+				unsigned maxStreams = 0;
+				unsigned sumPackets = 0;
+				unsigned maxPackets = 0;
+				for(unsigned i = 0; i < this->shardsCount; i++) {
+					this->shards[i]->addExtStat(&sumStreams, &maxStreams, &sumPackets, &maxPackets);
+				}
+				outStr << '|' << sumStreams << '/' << maxStreams << 's'
+				       << '|' << sumPackets << '/' << maxPackets << 'p';
+			}
+		}
+		return(outStr.str());
+	}
 	double tPacketCpu = -1;
 	double tCleanupCpu = -1;
 	outStr << fixed;
@@ -3171,41 +3212,45 @@ string TcpReassembly::getCpuUsagePerc() {
 		outStr << links.size() << 'l';
 		extern int opt_sip_tcp_reassembly_ext_quick_mod;
 		if(opt_sip_tcp_reassembly_ext_quick_mod != 2 && this->enableExtStat) {
-			if(this->enablePushLock) {
-				this->lock_push();
-			}
 			unsigned sumStreams = 0;
 			unsigned maxStreams = 0;
 			unsigned sumPackets = 0;
 			unsigned maxPackets = 0;
-			map<TcpReassemblyLink_id, TcpReassemblyLink*>::iterator iter_link;
-			for(iter_link = this->links.begin(); iter_link != this->links.end(); iter_link++) {
-				TcpReassemblyLink *link = iter_link->second;
-				unsigned streamsCount = link->queue_by_ack.size();
-				sumStreams += streamsCount;
-				if(streamsCount > maxStreams) {
-					maxStreams = streamsCount;
-				}
-				map<uint32_t, TcpReassemblyStream*>::iterator iter_stream;
-				for(iter_stream = link->queue_by_ack.begin(); iter_stream != link->queue_by_ack.end(); iter_stream++) {
-					TcpReassemblyStream *stream = iter_stream->second;
-					unsigned packetsCount = stream->queuePacketVars.size();
-					sumPackets += packetsCount;
-					if(packetsCount > maxPackets) {
-						maxPackets = packetsCount;
-					}
-				}
-			}
+			this->addExtStat(&sumStreams, &maxStreams, &sumPackets, &maxPackets);
 			outStr << '|' << sumStreams << '/' << maxStreams << 's'
 			       << '|' << sumPackets << '/' << maxPackets << 'p';
-			if(this->enablePushLock) {
-				this->unlock_push();
-			}
 		}
 	}
 	return(outStr.str());
 }
 
+void TcpReassembly::addExtStat(unsigned *sumStreams, unsigned *maxStreams, unsigned *sumPackets, unsigned *maxPackets) {
+	if(this->enablePushLock) {
+		this->lock_push();
+	}
+	map<TcpReassemblyLink_id, TcpReassemblyLink*>::iterator iter_link;
+	for(iter_link = this->links.begin(); iter_link != this->links.end(); iter_link++) {
+		TcpReassemblyLink *link = iter_link->second;
+		unsigned streamsCount = link->queue_by_ack.size();
+		*sumStreams += streamsCount;
+		if(streamsCount > *maxStreams) {
+			*maxStreams = streamsCount;
+		}
+		map<uint32_t, TcpReassemblyStream*>::iterator iter_stream;
+		for(iter_stream = link->queue_by_ack.begin(); iter_stream != link->queue_by_ack.end(); iter_stream++) {
+			TcpReassemblyStream *stream = iter_stream->second;
+			unsigned packetsCount = stream->queuePacketVars.size();
+			*sumPackets += packetsCount;
+			if(packetsCount > *maxPackets) {
+				*maxPackets = packetsCount;
+			}
+		}
+	}
+	if(this->enablePushLock) {
+		this->unlock_push();
+	}
+}
+
 void TcpReassembly::createCleanupThread() {
 	if(!this->cleanupThreadHandle) {
 		vm_pthread_create("tcp reassembly cleanup",
@@ -3287,9 +3332,80 @@ void* TcpReassembly::packetThreadFunction(void*) {
 
 void TcpReassembly::setIgnoreTerminating(bool ignoreTerminating) {
 	this->ignoreTerminating = ignoreTerminating;
+	for(unsigned i = 0; i < this->shardsCount; i++) {
+		this->shards[i]->setIgnoreTerminating(ignoreTerminating);
+	}
+}
+
+void TcpReassembly::setShards(unsigned shardsCount) {
+	if(shardsCount < 2 || this->shards || this->shardParent || !this->dataCallback) {
+		return;
+	}
+	TcpReassemblyProcessData **shardsDataCallback = new FILE_LINE(0) TcpReassemblyProcessData*[shardsCount];
+	for(unsigned i = 0; i < shardsCount; i++) {
+		shardsDataCallback[i] = this->dataCallback->createShardDataCallback();
+		if(!shardsDataCallback[i]) {
+			// data callback does not support sharding
+			for(unsigned j = 0; j < i; j++) {
+				delete shardsDataCallback[j];
+			}
+			delete [] shardsDataCallback;
+			return;
+		}
+	}
+	this->shards = new FILE_LINE(0) TcpReassembly*[shardsCount];
+	this->shardsDataCallback = shardsDataCallback;
+	for(unsigned i = 0; i < shardsCount; i++) {
+		this->shards[i] = new FILE_LINE(0) TcpReassembly(this->type, this);
+		this->copySettingsToShard(this->shards[i]);
+		this->shards[i]->setDataCallback(shardsDataCallback[i]);
+		this->shards[i]->setEnablePacketThread();
+	}
+	this->shardsCount = shardsCount;
+}
+
+void TcpReassembly::copySettingsToShard(TcpReassembly *shard) {
+	shard->enableHttpForceInit = this->enableHttpForceInit;
+	shard->enableCrazySequence = this->enableCrazySequence;
+	shard->enableWildLink = this->enableWildLink;
+	shard->ignoreTcpHandshake = this->ignoreTcpHandshake;
+	shard->enableIgnorePairReqResp = this->enableIgnorePairReqResp;
+	shard->enableDestroyStreamsInComplete = this->enableDestroyStreamsInComplete;
+	shard->enableAllCompleteAfterZerodataAck = this->enableAllCompleteAfterZerodataAck;
+	shard->enableValidateDataViaCheckData = this->enableValidateDataViaCheckData;
+	shard->unlimitedReassemblyAttempts = this->unlimitedReassemblyAttempts;
+	shard->maxReassemblyAttempts = this->maxReassemblyAttempts;
+	shard->enableValidateLastQueueDataViaCheckData = this->enableValidateLastQueueDataViaCheckData;
+	shard->enableStrictValidateDataViaCheckData = this->enableStrictValidateDataViaCheckData;
+	shard->needValidateDataViaCheckData = this->needValidateDataViaCheckData;
+	shard->simpleByAck = this->simpleByAck;
+	shard->ignorePshInCheckOkData = this->ignorePshInCheckOkData;
+	shard->smartMaxSeq = this->smartMaxSeq;
+	shard->smartMaxSeqByPsh = this->smartMaxSeqByPsh;
+	shard->skipZeroData = this->skipZeroData;
+	shard->ignoreZeroData = this->ignoreZeroData;
+	shard->enableAutoCleanup = this->enableAutoCleanup;
+	shard->cleanupPeriod = this->cleanupPeriod;
+	shard->enableHttpCleanupExt = this->enableHttpCleanupExt;
+	shard->enablePushLock = this->enablePushLock;
+	shard->enableLinkLock = this->enableLinkLock;
+	shard->enableSmartCompleteData = this->enableSmartCompleteData;
+	shard->completeMod = this->completeMod;
+	shard->enableExtStat = this->enableExtStat;
+	shard->extCleanupStreamsLimitStreams = this->extCleanupStreamsLimitStreams;
+	shard->extCleanupStreamsLimitHeap = this->extCleanupStreamsLimitHeap;
+	shard->linkTimeout = this->linkTimeout;
+	shard->ignoreTerminating = this->ignoreTerminating;
+	if(this->enableCleanupThread) {
+		shard->setEnableCleanupThread();
+	}
 }
 
 void TcpReassembly::addLog(const char *logString) {
+	if(this->shardParent) {
+		this->shardParent->addLog(logString);
+		return;
+	}
 	if(!this->log) {
 		return;
 	}
@@ -3350,6 +3466,15 @@ void TcpReassembly::push_tcp(pcap_pkthdr *header, iphdr2 *header_ip, u_char *pac
 		}
 	}
  
+	if(this->shardsCount) {
+		this->shards[this->getShardIndex(header_ip)]->push_tcp(
+			header, header_ip, packet, alloc_packet,
+			block_store, block_store_index, block_store_locked,
+			handle_index, dlt, sensor_id, sensor_ip, pid,
+			uData, uData2, isSip);
+		return;
+	}
+ 
 	if(_ENABLE_DEBUG(type, true) && !_debug_stream) {
 		if(sverb.tcpreassembly_debug_file) {
 			_debug_stream = new std::ofstream((sverb.tcpreassembly_debug_file + (" " + sqlDateTimeString(time(NULL)))).c_str(), 
@@ -4010,8 +4135,16 @@ void TcpReassembly::printContent() {
 
 void TcpReassembly::printContentSummary() {
 	std::ostream *__debug_stream = _debug_stream ? _debug_stream : &cout;
-	(*__debug_stream) << "LINKS " << getTypeString(true) << ": " << this->links.size() << endl;
-	if(this->dataCallback) {
+	size_t links_size = this->links.size();
+	for(unsigned i = 0; i < this->shardsCount; i++) {
+		links_size += this->shards[i]->links.size();
+	}
+	(*__debug_stream) << "LINKS " << getTypeString(true) << ": " << links_size << endl;
+	if(this->shardsCount) {
+		for(unsigned i = 0; i < this->shardsCount; i++) {
+			this->shardsDataCallback[i]->printContentSummary();
+		}
+	} else if(this->dataCallback) {
 		this->dataCallback->printContentSummary();
 	}
 }
@@ -219,6 +219,7 @@ public:
 
 class TcpReassemblyProcessData {
 public:
+	virtual ~TcpReassemblyProcessData() {}
 	virtual void processData(vmIP ip_src, vmIP ip_dst,
 				 vmPort port_src, vmPort port_dst,
 				 TcpReassemblyData *data,
@@ -229,6 +230,7 @@ public:
 				 std::ostream *debugStream) = 0;
 	virtual void writeToDb(bool /*all*/ = false) {}
 	virtual void printContentSummary() {}
+	virtual TcpReassemblyProcessData *createShardDataCallback() { return(NULL); }
 };
 
 struct TcpReassemblyLink_id {
@@ -375,7 +377,7 @@ public:
 		offset = 0;
 		last_packet_at_from_header = 0;
 	}
-	void push(TcpReassemblyStream_packet packet);
+	void push(const TcpReassemblyStream_packet &packet);
 	u_int32_t getNextSeqCheck() {
 		map<uint32_t, TcpReassemblyStream_packet>::iterator iter;
 		for(iter = this->queuePackets.begin(); iter != this->queuePackets.end(); iter++) {
@@ -495,7 +497,7 @@ public:
 		this->link = link;
 		counterTryOk = 0;
 	}
-	void push(TcpReassemblyStream_packet packet);
+	void push(const TcpReassemblyStream_packet &packet);
 	int ok(bool crazySequence = false, bool enableSimpleCmpMaxNextSeq = false, u_int32_t maxNextSeq = 0,
 	       int enableValidateDataViaCheckData = -1, int needValidateDataViaCheckData = -1, int unlimitedReassemblyAttempts = -1,
 	       TcpReassemblyStream *prevHttpStream = NULL, bool enableDebug = false,
@@ -867,7 +869,7 @@ private:
 		__sync_lock_release(&this->_sync_queue);
 	}
 	void pushpacket(TcpReassemblyStream::eDirection direction,
-		        TcpReassemblyStream_packet packet,
+		        const TcpReassemblyStream_packet &packet,
 			bool isSip);
 	void setLastSeq(TcpReassemblyStream::eDirection direction, 
 			u_int32_t lastSeq);
@@ -949,7 +951,7 @@ public:
 		bool isSip;
 	};
 public:
-	TcpReassembly(eType type);
+	TcpReassembly(eType type, TcpReassembly *shardParent = NULL);
 	~TcpReassembly();
 	void push_tcp(pcap_pkthdr *header, iphdr2 *header_ip, u_char *packet, bool alloc_packet,
 		      pcap_block_store *block_store, int block_store_index, bool block_store_locked,
@@ -1053,6 +1055,10 @@ public:
 		this->extCleanupStreamsLimitStreams = extCleanupStreamsLimitStreams;
 		this->extCleanupStreamsLimitHeap = extCleanupStreamsLimitHeap;
 	}
+	void setShards(unsigned shardsCount);
+	unsigned getShardsCount() {
+		return(shardsCount);
+	}
 	/*
 	bool enableStop();
 	*/
@@ -1067,13 +1073,14 @@ public:
 	}
 	void addLog(const char *logString);
 	bool isActiveLog() {
-		return(this->log != NULL);
+		return(shardParent ? shardParent->isActiveLog() : this->log != NULL);
 	}
 	void prepareCleanupPstatData();
 	double getCleanupCpuUsagePerc(bool preparePstatData = false);
 	void preparePacketPstatData();
 	double getPacketCpuUsagePerc(bool preparePstatData = false);
 	string getCpuUsagePerc();
+	void addExtStat(unsigned *sumStreams, unsigned *maxStreams, unsigned *sumPackets, unsigned *maxPackets);
 	bool check_ip(vmIP ip, vmPort port = 0) {
 		if(type == http || type == webrtc) {
 			extern vector<vmIP> httpip;
@@ -1125,6 +1132,13 @@ private:
 		   void *uData, void *uData2, bool isSip);
 	void createCleanupThread();
 	void createPacketThread();
+	void copySettingsToShard(TcpReassembly *shard);
+	inline unsigned getShardIndex(iphdr2 *header_ip) {
+		tcphdr2 *header_tcp = (tcphdr2*)((u_char*)header_ip + header_ip->get_hdr_size());
+		// the same shard for both directions of link
+		return((header_ip->get_saddr().getHashNumber() ^ header_ip->get_daddr().getHashNumber() ^
+			header_tcp->get_source().getPort() ^ header_tcp->get_dest().getPort()) % shardsCount);
+	}
 	void *cleanupThreadFunction(void *);
 	void *packetThreadFunction(void *);
 	void lock_links() {
@@ -1226,6 +1240,10 @@ private:
 	volatile int dumperSync;
 	u_int64_t dumperFileCounter;
 	u_int64_t dumperPacketCounter;
+	TcpReassembly *shardParent;
+	TcpReassembly **shards;
+	TcpReassemblyProcessData **shardsDataCallback;
+	unsigned shardsCount;
 friend class TcpReassemblyLink;
 friend class TcpReassemblyStream;
 friend void *_TcpReassembly_cleanupThreadFunction(void* arg);
@@ -89,6 +89,7 @@
 #include "config_param.h"
 #include "websocket.h"
 #include "mgcp.h"
+#include "rcu.h"
 
 #ifndef SIZE_MAX
 # ifdef __SIZE_MAX__
@@ -3006,6 +3007,94 @@ void ListPhoneNumber::addComb(const char *number, ListPhoneNumber *negList) {
 	}
 }
 
+bool ListPhoneNumber::checkNumber(const char *check_number) {
+	if(index_dirty) {
+		if(autoLock) lock();
+		if(index_dirty) {
+			buildIndex();
+		}
+		if(autoLock) unlock();
+	}
+	if(!index) {
+		return(false);
+	}
+	cEpochRcu *rcu = getRcu();
+	bool rcu_lock = rcu->read_lock();
+	if(!rcu_lock && autoLock) lock();
+	sIndex *_index = index;
+	bool rslt = _index && _index->check(check_number);
+	if(rcu_lock) {
+		rcu->read_unlock();
+	} else if(autoLock) {
+		unlock();
+	}
+	return(rslt);
+}
+
+void ListPhoneNumber::buildIndex() {
+	sIndex *newIndex = NULL;
+	if(!is_empty()) {
+		newIndex = new FILE_LINE(0) sIndex;
+		for(int pass = 0; pass < 2; pass++) {
+			std::vector<PhoneNumber> *list = pass == 0 ? &listPhoneNumber : &listPrefixes;
+			for(std::vector<PhoneNumber>::iterator iter = list->begin(); iter != list->end(); iter++) {
+				if(iter->isPrefix()) {
+					if(!newIndex->prefixes.add(iter->number.c_str(), 0)) {
+						newIndex->otherPrefixes.push_back(*iter);
+					}
+				} else {
+					if(!newIndex->numbers.add(iter->number.c_str(), 0)) {
+						newIndex->otherNumbers.push_back(*iter);
+					}
+				}
+			}
+		}
+		std::sort(newIndex->otherNumbers.begin(), newIndex->otherNumbers.end());
+		for(std::vector<string>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
+			newIndex->regExp.add(iter->c_str());
+		}
+		newIndex->regExp.build();
+	}
+	__sync_synchronize();
+	sIndex *oldIndex = index;
+	index = newIndex;
+	index_dirty = false;
+	if(oldIndex) {
+		cEpochRcu *rcu = getRcu();
+		rcu->retire(oldIndex, sIndex::destroy);
+		rcu->reclaim();
+	}
+}
+
+cEpochRcu *ListPhoneNumber::getRcu() {
+	static cEpochRcu rcu;
+	return(&rcu);
+}
+
+bool ListPhoneNumber::sIndex::check(const char *check_number) {
+	if(!numbers.isEmpty() && numbers.findExact(check_number) != DIGIT_TRIE_NO_VALUE) {
+		return(true);
+	}
+	if(!prefixes.isEmpty() && prefixes.findShortestPrefix(check_number) != DIGIT_TRIE_NO_VALUE) {
+		return(true);
+	}
+	if(otherNumbers.size()) {
+		std::vector<PhoneNumber>::iterator it_number = std::lower_bound(otherNumbers.begin(), otherNumbers.end(), PhoneNumber(check_number, false));
+		if(it_number != otherNumbers.end() && it_number->checkNumber(check_number)) {
+			return(true);
+		}
+	}
+	for(std::vector<PhoneNumber>::iterator iter = otherPrefixes.begin(); iter != otherPrefixes.end(); iter++) {
+		if(iter->checkNumber(check_number)) {
+			return(true);
+		}
+	}
+	if(!regExp.isEmpty() && regExp.match(check_number)) {
+		return(true);
+	}
+	return(false);
+}
+
 void ListUA::addComb(string &ua, ListUA *negList,
 		     bool enableSpaceSeparator, const char *separators, const char *separatorsSeparator) {
 	addComb(ua.c_str(), negList,
@@ -3159,75 +3248,29 @@ void ListCheckString_wb::addBlack(const char *checkString,
 }
 
 
-ParsePacket::ppNode::ppNode() {
-	for(int i = 0; i < 256; i++) {
-		nodes[i] = 0;
-	}
-	leaf = false;
-	typeNode = typeNode_std;
-	nodeIndex = 0;
-	isContentLength = false;
-}
-
-ParsePacket::ppNode::~ppNode() {
-	for(int i = 0; i < 256; i++) {
-		if(nodes[i]) {
-			delete nodes[i];
-		}
-	}
-}
-
-void ParsePacket::ppNode::addNode(const char *nodeName, eTypeNode typeNode, int nodeIndex, bool isContentLength) {
-	while(*nodeName == '\n') {
-		 ++nodeName;
-	}
-	if(*nodeName) {
-		unsigned char nodeChar = (unsigned char)*nodeName;
-		if(nodeChar >= 'A' && nodeChar <= 'Z') {
-			nodeChar -= 'A' - 'a';
-		}
-		ppNode *node = (ppNode*)nodes[nodeChar];
-		if(!node) {
-			node = new FILE_LINE(38005) ppNode;
-		}
-		node->addNode(nodeName + 1, typeNode, nodeIndex, isContentLength);
-		if(!nodes[nodeChar]) {
-			nodes[nodeChar] = node;
-		}
-	} else {
-		leaf = true;
-		this->typeNode = typeNode;
-		this->nodeIndex = nodeIndex;
-		this->isContentLength = isContentLength;
-	}
-}
-		
 void ParsePacket::ppNode::debugData(ppContentsX *contents, ParsePacket *parsePacket) {
-	if(leaf) {
-		if(typeNode == typeNode_std && contents->std[nodeIndex].length > 0) {
-			cout << "S " << parsePacket->nodesStd[nodeIndex] 
-			     << " : " << string(contents->parseDataPtr +  contents->std[nodeIndex].offset, contents->std[nodeIndex].length)
-			     << " : L " << contents->std[nodeIndex].length
-			     << endl;
-		} else if(typeNode == typeNode_custom && contents->custom[nodeIndex].length > 0) {
-			cout << "C " << parsePacket->nodesCustom[nodeIndex] 
-			     << " : " << string(contents->parseDataPtr +  contents->custom[nodeIndex].offset, contents->custom[nodeIndex].length)
-			     << " : L " << contents->custom[nodeIndex].length
-			     << endl;
-		}
-	} else {
-		for(int i = 0; i < 256; i++) {
-			if(nodes[i]) {
-				ppNode *node = (ppNode*)nodes[i];
-				node->debugData(contents, parsePacket);
-			}
-		}
+	if(typeNode == typeNode_std && contents->std[nodeIndex].length > 0) {
+		cout << "S " << parsePacket->nodesStd[nodeIndex] 
+		     << " : " << string(contents->parseDataPtr +  contents->std[nodeIndex].offset, contents->std[nodeIndex].length)
+		     << " : L " << contents->std[nodeIndex].length
+		     << endl;
+	} else if(typeNode == typeNode_custom && contents->custom[nodeIndex].length > 0) {
+		cout << "C " << parsePacket->nodesCustom[nodeIndex] 
+		     << " : " << string(contents->parseDataPtr +  contents->custom[nodeIndex].offset, contents->custom[nodeIndex].length)
+		     << " : L " << contents->custom[nodeIndex].length
+		     << endl;
 	}
 }
 
 ParsePacket::ParsePacket() {
-	root = NULL;
-	rootCheckSip = NULL;
+	index = NULL;
+	indexCheckSip = NULL;
+	indexDirty = false;
+	indexDeferBuild = 0;
+	_sync_index = 0;
+	_sync_index_owner = 0;
+	_sync_index_nesting = 0;
+	sip_scan_init();
 	timeSync_SIP_HEADERfilter = 0;
 	timeSync_custom_headers_cdr = 0;
 	timeSync_custom_headers_message = 0;
@@ -3239,12 +3282,8 @@ ParsePacket::~ParsePacket() {
 }
 	
 void ParsePacket::setStdParse() {
-	if(!root) {
-		root = new FILE_LINE(38006) ppNode;
-	}
-	if(!rootCheckSip) {
-		rootCheckSip = new FILE_LINE(38007) ppNode;
-	}
+	lock_index();
+	++indexDeferBuild;
 	addNode("content-length:", typeNode_std, true);
 	addNode("l:", typeNode_std, true);
 	addNode("INVITE ", typeNode_std);
@@ -3420,6 +3459,10 @@ void ParsePacket::setStdParse() {
 		addNode("subscription-state:", typeNode_std);
 		addNode("referred-by:", typeNode_std);
 	}
+	
+	--indexDeferBuild;
+	buildIndex();
+	unlock_index();
 }
 
 void ParsePacket::addNode(const char *nodeName, eTypeNode typeNode, bool isContentLength) {
@@ -3430,28 +3473,102 @@ void ParsePacket::addNode(const char *nodeName, eTypeNode typeNode, bool isConte
 	}
 	string nodeNameUpper = string(*nodeName == '\n' ? nodeName + 1 : nodeName);
 	std::transform(nodeNameUpper.begin(), nodeNameUpper.end(), nodeNameUpper.begin(), ::toupper);
+	lock_index();
 	if(std::find(nodesStd.begin(), nodesStd.end(), nodeNameUpper) == nodesStd.end() &&
 	   std::find(nodesCustom.begin(), nodesCustom.end(), nodeNameUpper) == nodesCustom.end()) {
 		if(listNodes->size() < (typeNode == typeNode_std ? ParsePacket_std_max : ParsePacket_custom_max)) {
 			listNodes->push_back(nodeNameUpper);
-			if(!root) {
-				root = new FILE_LINE(38008) ppNode;
+			nodes.push_back(new FILE_LINE(38008) ppNode(typeNode, listNodes->size() - 1, isContentLength));
+			nodesNames.push_back(nodeName);
+			indexDirty = true;
+			if(!indexDeferBuild) {
+				buildIndex();
 			}
-			root->addNode(nodeName, typeNode, listNodes->size() - 1, isContentLength);
 		} else {
 			syslog(LOG_WARNING, "too much sip nodes for ParsePacket");
 		}
 	}
+	unlock_index();
 }
 
 void ParsePacket::addNodeCheckSip(const char *nodeName) {
+	lock_index();
 	if(std::find(nodesCheckSip.begin(), nodesCheckSip.end(), nodeName) == nodesCheckSip.end()) {
 		nodesCheckSip.push_back(nodeName);
-		if(!rootCheckSip) {
-			rootCheckSip = new FILE_LINE(38009) ppNode;
+		indexDirty = true;
+		if(!indexDeferBuild) {
+			buildIndex();
 		}
-		rootCheckSip->addNode(nodeName, typeNode_checkSip, nodesCheckSip.size() - 1, false);
 	}
+	unlock_index();
+}
+
+ParsePacket::ppNode *ParsePacket::getNode(const char *data, u_int32_t datalength, u_int32_t *namelength_rslt) {
+	bool rcu_lock = index_read_lock();
+	ppNode *node = _getNode(index, data, datalength, namelength_rslt);
+	index_read_unlock(rcu_lock);
+	return(node);
+}
+
+bool ParsePacket::isSipContent(const char *data, u_int32_t datalength) {
+	bool rcu_lock = index_read_lock();
+	bool rslt = _isSipContent(indexCheckSip, data, datalength);
+	index_read_unlock(rcu_lock);
+	return(rslt);
+}
+
+void ParsePacket::buildIndex() {
+	// under lock_index
+	if(!indexDirty) {
+		return;
+	}
+	ppIndex *newIndex = new FILE_LINE(38006) ppIndex;
+	for(unsigned i = 0; i < nodes.size(); i++) {
+		newIndex->names.add(nodesNames[i].c_str(), i);
+	}
+	newIndex->names.build();
+	newIndex->nodes = nodes;
+	ppIndex *newIndexCheckSip = new FILE_LINE(38007) ppIndex;
+	for(unsigned i = 0; i < nodesCheckSip.size(); i++) {
+		newIndexCheckSip->names.add(nodesCheckSip[i].c_str(), i);
+	}
+	newIndexCheckSip->names.build();
+	__sync_synchronize();
+	ppIndex *_index = index;
+	ppIndex *_indexCheckSip = indexCheckSip;
+	index = newIndex;
+	indexCheckSip = newIndexCheckSip;
+	indexDirty = false;
+	// parse threads can hold the replaced indexes - released after they leave read section
+	cEpochRcu *rcu = getRcu();
+	if(_index) {
+		rcu->retire(_index, ppIndex::destroy);
+	}
+	if(_indexCheckSip) {
+		rcu->retire(_indexCheckSip, ppIndex::destroy);
+	}
+	rcu->reclaim();
+}
+
+bool ParsePacket::index_read_lock() {
+	if(getRcu()->read_lock()) {
+		return(true);
+	}
+	lock_index();
+	return(false);
+}
+
+void ParsePacket::index_read_unlock(bool rcu_lock) {
+	if(rcu_lock) {
+		getRcu()->read_unlock();
+	} else {
+		unlock_index();
+	}
+}
+
+cEpochRcu *ParsePacket::getRcu() {
+	static cEpochRcu rcu;
+	return(&rcu);
 }
 
 u_int32_t ParsePacket::parseData(char *data, unsigned long datalen, ppContentsX *contents) {
@@ -3496,9 +3613,39 @@ u_int32_t ParsePacket::parseData(char *data, unsigned long datalen, ppContentsX
 		}
 	}
 	unsigned long rsltDataLen = datalen;
-	contents->sip = datalen ? isSipContent(data, datalen - 1) : false;
+	bool rcu_lock = index_read_lock();
+	ppIndex *_index = index;
+	contents->sip = datalen ? _isSipContent(indexCheckSip, data, datalen - 1) : false;
 	unsigned int namelength;
-	for(unsigned long i = 0; i < datalen; i++) {
+	unsigned long i = 0;
+	while(i < datalen) {
+		if((i == 0 || data[i - 1] == '\n') && data[i] != '\r') {
+			ppNode *node = _getNode(_index, data + i, datalen - i - 1, &namelength);
+			if(node && !node->isSetNode(contents)) {
+				ppContentItemX *contentItem = node->getPointerToItem(contents);
+				contentItem->offset = i + namelength;
+				i += namelength;
+				i += sip_scan_eol(data + i, datalen - i);
+				contentItem->length = i - contentItem->offset;
+				contentItem->trim(data);
+				if(node->isContentLength && contentItem->length) {
+					if(contentItem->offset + contentItem->length == datalen) {
+						char tempLength[10];
+						int maxLengthLength = MIN(sizeof(tempLength) - 1, contentItem->length);
+						strncpy(tempLength, data + contentItem->offset, maxLengthLength);
+						tempLength[maxLengthLength] = 0;
+						contents->contentLength = atoi(tempLength);
+					} else {
+						contents->contentLength = atoi(data + contentItem->offset);
+					}
+				}
+				continue;
+			}
+		}
+		i += sip_scan_eol(data + i, datalen - i);
+		if(i >= datalen) {
+			break;
+		}
 		if(!contents->doubleEndLine && 
 		   datalen > 3 &&
 		   data[i] == '\r' && i < datalen - 3 && 
@@ -3514,58 +3661,47 @@ u_int32_t ParsePacket::parseData(char *data, unsigned long datalen, ppContentsX
 				rsltDataLen = contents->doubleEndLine + 4 - data;
 				break;
 			}
-			i += 2;
-		} else if(i == 0 || data[i - 1] == '\n') {
-			ppNode *node = getNode(data + i, datalen - i - 1, &namelength);
-			if(node && !node->isSetNode(contents)) {
-				ppContentItemX *contentItem = node->getPointerToItem(contents);
-				contentItem->offset = i + namelength;
-				i += namelength;
-				bool endLine = false;
-				for(; i < datalen; i++) {
-					if(data[i] == '\r' || data[i] == '\n') {
-						endLine = true;
-						break;
-					}
-				}
-				if(endLine || i == datalen) {
-					contentItem->length = i - contentItem->offset;
-					contentItem->trim(data);
-					if(node->isContentLength && contentItem->length) {
-						if(contentItem->offset + contentItem->length == datalen) {
-							char tempLength[10];
-							int maxLengthLength = MIN(sizeof(tempLength) - 1, contentItem->length);
-							strncpy(tempLength, data + contentItem->offset, maxLengthLength);
-							tempLength[maxLengthLength] = 0;
-							contents->contentLength = atoi(tempLength);
-						} else {
-							contents->contentLength = atoi(data + contentItem->offset);
-						}
-					}
-					if(endLine) {
-						--i;
-					}
-				}
-			}
+			i += 4;
+		} else {
+			++i;
 		}
 	}
+	index_read_unlock(rcu_lock);
 	contents->parseDataPtr = data;
 	return(rsltDataLen);
 }
 
 void ParsePacket::free() {
-	if(root) {
-		delete root;
-		root = NULL;
+	lock_index();
+	if(index || indexCheckSip) {
+		cEpochRcu *rcu = getRcu();
+		if(index) {
+			rcu->retire(index, ppIndex::destroy);
+			index = NULL;
+		}
+		if(indexCheckSip) {
+			rcu->retire(indexCheckSip, ppIndex::destroy);
+			indexCheckSip = NULL;
+		}
+		rcu->synchronize();
+		rcu->reclaim();
 	}
-	if(rootCheckSip) {
-		delete rootCheckSip;
-		rootCheckSip = NULL;
+	for(std::vector<ppNode*>::iterator iter = nodes.begin(); iter != nodes.end(); iter++) {
+		delete *iter;
 	}
+	nodes.clear();
+	nodesNames.clear();
+	nodesStd.clear();
+	nodesCheckSip.clear();
+	nodesCustom.clear();
+	indexDirty = false;
+	unlock_index();
 }
 
 void ParsePacket::debugData(ppContentsX *contents) {
-	root->debugData(contents, this);
+	for(std::vector<ppNode*>::iterator iter = nodes.begin(); iter != nodes.end(); iter++) {
+		(*iter)->debugData(contents, this);
+	}
 }
 
 
@@ -3934,6 +4070,7 @@ bool FileZipHandler::_directWriteToFile(char *data, int length, bool flush) {
 	case gzip:
 	case snappy:
 	case lzo:
+	case zstd:
 		if(!this->compressStream) {
 			this->initCompress();
 		}
@@ -3974,14 +4111,23 @@ bool FileZipHandler::__directWriteToFile(char *data, int length) {
 void FileZipHandler::initCompress() {
 	this->compressStream =  new FILE_LINE(38017) CompressStream(this->typeCompress == gzip ? CompressStream::gzip :
 							     this->typeCompress == snappy ? CompressStream::snappy :
-							     this->typeCompress == lzo ? CompressStream::lzo : CompressStream::compress_na,
+							     this->typeCompress == lzo ? CompressStream::lzo :
+							     this->typeCompress == zstd ? CompressStream::zstd : CompressStream::compress_na,
 							     this->typeCompress == snappy || this->typeCompress == lzo ?
 							      this->bufferLength :
 							      8 * 1024, 
 							     0);
-	this->compressStream->setZipLevel(typeFile == pcap_sip ? opt_pcap_dump_ziplevel_sip : 
-					  typeFile == pcap_rtp ? opt_pcap_dump_ziplevel_rtp : 
-					  typeFile == graph_rtp ? opt_pcap_dump_ziplevel_graph : Z_DEFAULT_COMPRESSION);
+	int zipLevel = typeFile == pcap_sip ? opt_pcap_dump_ziplevel_sip : 
+		       typeFile == pcap_rtp ? opt_pcap_dump_ziplevel_rtp : 
+		       typeFile == graph_rtp ? opt_pcap_dump_ziplevel_graph : Z_DEFAULT_COMPRESSION;
+	this->compressStream->setZipLevel(zipLevel);
+	if(this->typeCompress == zstd) {
+		if(zipLevel != Z_DEFAULT_COMPRESSION) {
+			this->compressStream->setZstdLevel(zipLevel);
+		}
+		extern bool opt_zstd_long_rtp;
+		this->compressStream->setZstdLongDistance(typeFile == pcap_rtp && opt_zstd_long_rtp);
+	}
 	this->compressStream->enableAutoPrefixFile();
 	this->compressStream->enableForceStream();
 }
@@ -3989,7 +4135,8 @@ void FileZipHandler::initCompress() {
 void FileZipHandler::initDecompress() {
 	this->compressStream =  new FILE_LINE(38018) CompressStream(this->typeCompress == gzip ? CompressStream::gzip :
 							     this->typeCompress == snappy ? CompressStream::snappy :
-							     this->typeCompress == lzo ? CompressStream::lzo : CompressStream::compress_na,
+							     this->typeCompress == lzo ? CompressStream::lzo :
+							     this->typeCompress == zstd ? CompressStream::zstd : CompressStream::compress_na,
 							     8 * 1024,
 							     0);
 }
@@ -4115,6 +4262,11 @@ FileZipHandler::eTypeCompress FileZipHandler::convTypeCompress(const char *typeC
 	} else if(!strcmp(_compress_method, "lzo")) {
 		return(FileZipHandler::lzo);
 	}
+	#ifdef HAVE_LIBZSTD
+	else if(!strcmp(_compress_method, "zstd")) {
+		return(FileZipHandler::zstd);
+	}
+	#endif //HAVE_LIBZSTD
 	return(FileZipHandler::compress_na);
 }
 
@@ -4126,6 +4278,10 @@ const char *FileZipHandler::convTypeCompress(eTypeCompress typeCompress) {
 		return("snappy");
 	case lzo:
 		return("lzo");
+	#ifdef HAVE_LIBZSTD
+	case zstd:
+		return("zstd");
+	#endif //HAVE_LIBZSTD
 	case compress_default:
 		return("yes");
 	default:
@@ -4140,6 +4296,9 @@ string FileZipHandler::getConfigMenuString() {
 	       << convTypeCompress(gzip) << ':' << gzip << '|'
 	       << convTypeCompress(snappy) << ':' << snappy << '|'
 	       << convTypeCompress(lzo) << ':' << lzo << '|'
+	       #ifdef HAVE_LIBZSTD
+	       << convTypeCompress(zstd) << ':' << zstd << '|'
+	       #endif //HAVE_LIBZSTD
 	       << "no:0";
 	return(outStr.str());
 }
@@ -6820,6 +6979,72 @@ string cDbStrings::implodeInsertValues(const char *table, cDbStrings *header, Sq
 	return(rslt);
 }
 
+bool cDbStrings::implodeLoadDataValues(string *dst, vector<bool> *ipv6Columns) {
+	unsigned counter = 0;
+	for(size_t i = 0; i < size; i++) {
+		if(!strings[i].begin) {
+			continue;
+		}
+		if(counter) { *dst += '\t'; }
+		if(strings[i].flags & SqlDb_row::_ift_null) {
+			*dst += "\\N";
+		} else {
+			switch(strings[i].flags & SqlDb_row::_ift_base) {
+			case SqlDb_row::_ift_string:
+				// content is already escaped for sql string - only tab is left as is
+				if(strchr(strings[i].str, '\t')) {
+					for(const char *p = strings[i].str; *p; p++) {
+						if(*p == '\t') {
+							*dst += "\\t";
+						} else {
+							*dst += *p;
+						}
+					}
+				} else {
+					*dst += strings[i].str;
+				}
+				break;
+			case SqlDb_row::_ift_int:
+			case SqlDb_row::_ift_int_u:
+			case SqlDb_row::_ift_double:
+				*dst += strings[i].str;
+				break;
+			case SqlDb_row::_ift_ip:
+				if(counter < ipv6Columns->size() && (*ipv6Columns)[counter]) {
+					*dst += strings[i].str;
+				} else {
+					*dst += intToString(str_2_vmIP(strings[i].str).getIPv4());
+				}
+				break;
+			case SqlDb_row::_ift_calldate:
+				*dst += sqlDateTimeString_us2ms(atoll(strings[i].str));
+				break;
+			case SqlDb_row::_ift_sql:
+				if(strings[i].ai_id) {
+					*dst += intToString(strings[i].ai_id);
+				} else if(!strcasecmp(strings[i].str, "NULL")) {
+					*dst += "\\N";
+				} else if(isdigit(strings[i].str[0]) && strspn(strings[i].str, "0123456789") == strlen(strings[i].str)) {
+					*dst += strings[i].str;
+				} else {
+					// sql expression cannot be passed via LOAD DATA
+					return(false);
+				}
+				break;
+			default:
+				if((strings[i].flags & SqlDb_row::_ift_base) >= SqlDb_row::_ift_cb_string && strings[i].cb_id) {
+					*dst += intToString(strings[i].cb_id);
+				} else {
+					*dst += "\\N";
+				}
+			}
+		}
+		++counter;
+	}
+	*dst += '\n';
+	return(true);
+}
+
 cDbTableContent::cDbTableContent(const char *table_name) {
 	this->table_name = table_name;
 }
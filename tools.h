@@ -38,6 +38,8 @@
 #include "rqueue.h"
 #include "voipmonitor.h"
 #include "tar_data.h"
+#include "digit_trie.h"
+#include "sip_scan.h"
 
 using namespace std;
 
@@ -595,7 +597,8 @@ public:
 		compress_default,
 		gzip,
 		snappy,
-		lzo
+		lzo,
+		zstd
 	};
 	struct sReadBufferItem {
 		u_char *buff;
@@ -1732,81 +1735,53 @@ private:
 };
 
 class ListPhoneNumber {
+private:
+	struct sIndex {
+		cDigitTrie numbers;
+		cDigitTrie prefixes;
+		std::vector<PhoneNumber> otherNumbers;
+		std::vector<PhoneNumber> otherPrefixes;
+		cRegExpSet regExp;
+		bool check(const char *check_number);
+		static void destroy(void *index) {
+			delete (sIndex*)index;
+		}
+	};
 public:
 	ListPhoneNumber(bool autoLock = true) {
 		this->autoLock = autoLock;
 		_sync = 0;
-		_listPhoneNumber_sorted = 0;
-		_listPrefixes_sorted = 0;
+		index = NULL;
+		index_dirty = false;
 	}
 	~ListPhoneNumber() {
-		for(std::list<cRegExp*>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
-			delete *iter;
+		if(index) {
+			delete index;
 		}
 	}
 	void add(const char *number, bool prefix = true) {
 		if(autoLock) lock();
 		if(number[0] == 'R' && number[1] == '(' && number[strlen(number) - 1] == ')') {
 			if(check_regexp(number)) {
-				cRegExp *regexp = new FILE_LINE(0) cRegExp(string(number).substr(2, strlen(number) - 3).c_str());
-				listRegExp.push_back(regexp);
+				listRegExp.push_back(string(number).substr(2, strlen(number) - 3));
 			}
 		} else if(!prefix) {
 			listPhoneNumber.push_back(PhoneNumber(number, false));
 		} else {
 			listPrefixes.push_back(PhoneNumber(number, true));
 		}
+		index_dirty = true;
 		if(autoLock) unlock();
 	}
 	void addComb(string &number, ListPhoneNumber *negList = NULL);
 	void addComb(const char *number, ListPhoneNumber *negList = NULL);
-	bool checkNumber(const char *check_number) {
-		bool rslt =  false;
-		if(autoLock) lock();
-		if(listPhoneNumber.size()) {
-			if(!_listPhoneNumber_sorted) {
-				std::sort(listPhoneNumber.begin(), listPhoneNumber.end());
-				_listPhoneNumber_sorted = true;
-			}
-			std::vector<PhoneNumber>::iterator it_number = std::lower_bound(listPhoneNumber.begin(), listPhoneNumber.end(), PhoneNumber(check_number, false));
-			if(it_number != listPhoneNumber.end() && it_number->checkNumber(check_number)) {
-				rslt = true;
-			}
-		}
-		if(!rslt && listPrefixes.size()) {
-			if(!_listPrefixes_sorted) {
-				std::sort (listPrefixes.begin(), listPrefixes.end());
-				_listPrefixes_sorted = true;
-			}
-			std::vector<PhoneNumber>::iterator it_prefix = std::lower_bound(listPrefixes.begin(), listPrefixes.end(), PhoneNumber(check_number, false));
-			if(it_prefix != listPrefixes.end() && it_prefix->checkNumber(check_number)) {
-				rslt = true;
-			} else if(it_prefix != listPrefixes.begin()) {
-				--it_prefix;
-				if(it_prefix->checkNumber(check_number)) {
-					rslt = true;
-				}
-			}
-		}
-		if(!rslt && listRegExp.size()) {
-			for(std::list<cRegExp*>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
-				if((*iter)->match(check_number)) {
-					rslt = true;
-					break;
-				}
-			}
-		}
-		if(autoLock) unlock();
-		return(rslt);
-	}
+	bool checkNumber(const char *check_number);
 	void clear() {
 		if(autoLock) lock();
 		listPhoneNumber.clear();
 		listPrefixes.clear();
-		for(std::list<cRegExp*>::iterator iter = listRegExp.begin(); iter != listRegExp.end(); iter++) {
-			delete *iter;
-		}
 		listRegExp.clear();
+		index_dirty = true;
 		if(autoLock) unlock();
 	}
 	bool is_empty() {
@@ -1818,14 +1793,17 @@ public:
 	void unlock() {
 		__sync_lock_release(&this->_sync);
 	}
+private:
+	void buildIndex();
+	static class cEpochRcu *getRcu();
 private:
 	std::vector<PhoneNumber> listPhoneNumber;
 	std::vector<PhoneNumber> listPrefixes;
-	std::list<cRegExp*> listRegExp;
+	std::vector<string> listRegExp;
 	bool autoLock;
 	volatile int _sync;
-	volatile int _listPhoneNumber_sorted;
-	volatile int _listPrefixes_sorted;
+	sIndex * volatile index;
+	volatile bool index_dirty;
 };
 
 class ListUA {
@@ -2145,51 +2123,10 @@ public:
 		bool sip;
 	};
 	struct ppNode {
-		ppNode();
-		~ppNode();
-		void addNode(const char *nodeName, eTypeNode typeNode, int nodeIndex, bool isContentLength);
-		ppContentItemX *getContent(const char *nodeName, ppContentsX *contents, ppNode **node_rslt, u_int32_t *namelength_rslt = NULL, 
-					   u_int32_t namelength = 0, u_int32_t namelength_limit = UINT_MAX) {
-			if(!leaf) {
-				if(!*nodeName) {
-					return(NULL);
-				}
-				unsigned char nodeChar = (unsigned char)*nodeName;
-				if(nodeChar >= 'A' && nodeChar <= 'Z') {
-					nodeChar -= 'A' - 'a';
-				}
-				if(nodes[nodeChar]) {
-					++namelength;
-					if(namelength > namelength_limit) {
-						return(NULL);
-					}
-					ppNode *node = (ppNode*)nodes[nodeChar];
-					return(node->getContent(nodeName + 1, contents, node_rslt, namelength_rslt, 
-								namelength, namelength_limit));
-				} else {
-					return(NULL);
-				}
-			} else {
-				if(namelength_rslt) {
-					*namelength_rslt = namelength;
-				}
-				if(node_rslt) {
-					*node_rslt = this;
-				}
-				if(contents) {
-					switch(typeNode) {
-					case typeNode_std:
-						return(contents->std[nodeIndex].offset ? &contents->std[nodeIndex] : NULL);
-					case typeNode_custom:
-						return(contents->custom[nodeIndex].offset ? &contents->custom[nodeIndex] : NULL);
-					case typeNode_checkSip:
-						return(NULL);
-					}
-				} else {
-					return((ppContentItemX*)true);
-				}
-			}
-			return(NULL);
+		ppNode(eTypeNode typeNode, int nodeIndex, bool isContentLength) {
+			this->typeNode = typeNode;
+			this->nodeIndex = nodeIndex;
+			this->isContentLength = isContentLength;
 		}
 		bool isSetNode(ppContentsX *contents) {
 			return((typeNode == typeNode_std && contents->std[this->nodeIndex].length) ||
@@ -2200,43 +2137,79 @@ public:
 			       typeNode == typeNode_custom ? &contents->custom[this->nodeIndex] : NULL);
 		}
 		void debugData(ppContentsX *contents, ParsePacket *parsePacket);
-		volatile ppNode *nodes[256];
-		bool leaf;
 		eTypeNode typeNode;
 		int nodeIndex;
 		bool isContentLength;
 	};
+	struct ppIndex {
+		cSipHeaderNames names;
+		std::vector<ppNode*> nodes;
+		static void destroy(void *index) {
+			delete (ppIndex*)index;
+		}
+	};
 public:
 	ParsePacket();
 	~ParsePacket();
 	void setStdParse();
 	void addNode(const char *nodeName, eTypeNode typeNode, bool isContentLength = false);
 	void addNodeCheckSip(const char *nodeName);
-	ppNode *getNode(const char *data, u_int32_t datalength, u_int32_t *namelength_rslt) {
-		ppNode *node;
-		if(root->getContent(data, NULL, &node, namelength_rslt, 
-				    0, datalength)) {
-			return(node);
+	ppNode *getNode(const char *data, u_int32_t datalength, u_int32_t *namelength_rslt);
+	bool isSipContent(const char *data, u_int32_t datalength);
+	u_int32_t parseData(char *data, unsigned long datalen, ppContentsX *contents);
+	void free();
+	void debugData(ppContentsX *contents);
+private:
+	// only inside index_read_lock / index_read_unlock
+	ppNode *_getNode(ppIndex *_index, const char *data, u_int32_t datalength, u_int32_t *namelength_rslt) {
+		if(_index) {
+			int node = _index->names.find(data, datalength, namelength_rslt);
+			if(node >= 0) {
+				return(_index->nodes[node]);
+			}
 		}
 		return(NULL);
 	}
-	bool isSipContent(const char *data, u_int32_t datalength) {
-		if(rootCheckSip &&
-		   rootCheckSip->getContent(data, NULL, NULL, NULL,
-					    0, datalength)) {
-			return(true);
+	bool _isSipContent(ppIndex *_indexCheckSip, const char *data, u_int32_t datalength) {
+		return(_indexCheckSip && _indexCheckSip->names.find(data, datalength, NULL) >= 0);
+	}
+	void buildIndex();
+	bool index_read_lock();
+	void index_read_unlock(bool rcu_lock);
+	// recursive - custom headers / SIP_HEADERfilter call addNode from setStdParse
+	void lock_index() {
+		unsigned int tid = get_unix_tid();
+		if(_sync_index_owner == tid) {
+			++_sync_index_nesting;
+			return;
 		}
-		return(false);
+		while(__sync_lock_test_and_set(&_sync_index, 1)) {
+			USLEEP(10);
+		}
+		_sync_index_owner = tid;
+		_sync_index_nesting = 1;
 	}
-	u_int32_t parseData(char *data, unsigned long datalen, ppContentsX *contents);
-	void free();
-	void debugData(ppContentsX *contents);
+	void unlock_index() {
+		if(--_sync_index_nesting) {
+			return;
+		}
+		_sync_index_owner = 0;
+		__sync_lock_release(&_sync_index);
+	}
+	static class cEpochRcu *getRcu();
 private:
 	std::vector<string> nodesStd;
 	std::vector<string> nodesCheckSip;
 	std::vector<string> nodesCustom;
-	ppNode *root;
-	ppNode *rootCheckSip;
+	std::vector<ppNode*> nodes;
+	std::vector<string> nodesNames;
+	ppIndex * volatile index;
+	ppIndex * volatile indexCheckSip;
+	bool indexDirty;
+	int indexDeferBuild;
+	volatile int _sync_index;
+	volatile unsigned int _sync_index_owner;
+	unsigned int _sync_index_nesting;
 	unsigned long timeSync_SIP_HEADERfilter;
 	unsigned long timeSync_custom_headers_cdr;
 	unsigned long timeSync_custom_headers_message;
@@ -3642,6 +3615,7 @@ public:
 	void substAI(class cSqlDbData *dbData, u_int64_t *ai_id, const char *table_name);
 	string implodeInsertColumns();
 	string implodeInsertValues(const char *table, cDbStrings *header, SqlDb *sqlDb);
+	bool implodeLoadDataValues(string *dst, vector<bool> *ipv6Columns);
 	void print();
 	sDbString *strings;
 	map<sDbString, unsigned> *strings_map;
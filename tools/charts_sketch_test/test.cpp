@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <vector>
+
+#include "../../charts_sketch.h"
+
+
+using namespace std;
+
+
+// accuracy of cChartPercSketch (charts_percentile = sketch) against exact percentile
+// exact percentile is taken as in cChartDataItem::getPerc - sorted values (as float), index round(size * perc / 100)
+// p50 / p95 / p99 in asc and desc direction must be within relative accuracy for each distribution
+// last case overfills max_bins so that buckets on the opposite tail are joined - only p95 / p99 (used by charts) are checked
+//
+// usage: test [accuracy percent] [values] [seed]
+
+
+double opt_accuracy = 1;
+unsigned opt_values = 100000;
+unsigned opt_seed = 1;
+
+unsigned errors;
+
+
+double rand_uniform(unsigned *seed) {
+	return((rand_r(seed) + 1.) / ((double)RAND_MAX + 2.));
+}
+
+double rand_normal(unsigned *seed) {
+	return(sqrt(-2 * log(rand_uniform(seed))) * cos(2 * M_PI * rand_uniform(seed)));
+}
+
+double exactPerc(vector<float> *values, unsigned perc, bool desc) {
+	unsigned size = values->size();
+	unsigned percIndex = min((unsigned)round((double)size * perc / 100), size - 1);
+	return(desc ? (*values)[size - 1 - percIndex] : (*values)[percIndex]);
+}
+
+void check(const char *name, vector<double> *values, double accuracy, unsigned max_bins, bool only_tail = false) {
+	cChartPercSketch::setParameters(accuracy / 100, max_bins);
+	for(unsigned desc = 0; desc < 2; desc++) {
+		cChartPercSketch sketch;
+		vector<float> exact;
+		for(unsigned i = 0; i < values->size(); i++) {
+			sketch.add((*values)[i], desc);
+			exact.push_back((*values)[i]);
+		}
+		sort(exact.begin(), exact.end());
+		if(sketch.getCount() != values->size()) {
+			printf("%-28s %s count %u != %u  FAILED\n", name, desc ? "desc" : "asc ", sketch.getCount(), (unsigned)values->size());
+			++errors;
+		}
+		unsigned percs[] = { 50, 95, 99 };
+		for(unsigned i = only_tail ? 1 : 0; i < sizeof(percs) / sizeof(percs[0]); i++) {
+			double v_exact = exactPerc(&exact, percs[i], desc);
+			double v_sketch = sketch.getPerc(percs[i], desc);
+			double err = v_exact ? fabs(v_sketch - v_exact) / fabs(v_exact) : fabs(v_sketch);
+			bool ok = err <= accuracy / 100 * (1 + 1e-6) + 1e-7;
+			printf("%-28s %s p%u exact %-14g sketch %-14g err %.4f%%  %s\n",
+			       name, desc ? "desc" : "asc ", percs[i], v_exact, v_sketch, err * 100, ok ? "ok" : "FAILED");
+			if(!ok) {
+				++errors;
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if(argc > 1) opt_accuracy = atof(argv[1]);
+	if(argc > 2) opt_values = atoi(argv[2]);
+	if(argc > 3) opt_seed = atoi(argv[3]);
+	if(opt_accuracy <= 0 || opt_accuracy > 50 || !opt_values) {
+		printf("bad parameters\n");
+		return(1);
+	}
+	unsigned seed = opt_seed;
+	vector<double> values;
+	// delay in ms
+	values.clear();
+	for(unsigned i = 0; i < opt_values; i++) {
+		values.push_back(rand_uniform(&seed) * 500);
+	}
+	check("uniform 0-500", &values, opt_accuracy, CHART_PERC_SKETCH_MAX_BINS);
+	// mos
+	values.clear();
+	for(unsigned i = 0; i < opt_values; i++) {
+		values.push_back(min(4.5, max(1., 4.2 + rand_normal(&seed) * 0.3)));
+	}
+	check("normal mos", &values, opt_accuracy, CHART_PERC_SKETCH_MAX_BINS);
+	// jitter / loss - long tail
+	values.clear();
+	for(unsigned i = 0; i < opt_values; i++) {
+		values.push_back(exp(rand_normal(&seed) * 2));
+	}
+	check("lognormal sigma 2", &values, opt_accuracy, CHART_PERC_SKETCH_MAX_BINS);
+	// few distinct values (codes, integers)
+	values.clear();
+	for(unsigned i = 0; i < opt_values; i++) {
+		values.push_back(rand_r(&seed) % 20 + 1);
+	}
+	check("integers 1-20", &values, opt_accuracy, CHART_PERC_SKETCH_MAX_BINS);
+	// range wider than max bins - lower (asc) or upper (desc) tail is joined
+	values.clear();
+	for(unsigned i = 0; i < opt_values; i++) {
+		values.push_back(exp(rand_uniform(&seed) * 40 - 20));
+	}
+	check("log-uniform e^-20-e^20", &values, opt_accuracy, 512, true);
+	printf("%s\n", errors ? "FAILED" : "OK");
+	return(errors ? 1 : 0);
+}
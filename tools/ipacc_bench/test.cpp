@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <vector>
+
+#define FILE_LINE(alloc_number)
+
+#include "../../ipaccount_flow.h"
+
+
+using namespace std;
+
+
+// ip accounting aggregation throughput (Ipacc::push / out thread)
+// - ring:  packet ring consumed by out thread which aggregates each packet into map (former add_octets)
+// - table: producer aggregates into IpaccFlowTable, out thread only merges handed-off tables into map
+// one producer thread as in sniffer (t2 destroy blocks thread)
+// packets are generated from synthetic flows with skewed distribution (few heavy flows, long tail),
+// timestamps advance so that intervals rotate
+//
+// usage: test [ring|table|both] [flows] [packets] [ipv6 percent] [packets per second of time]
+
+
+#define RING_SIZE 10000
+#define TABLE_QRING_SIZE 64
+#define INTERVAL 60
+
+
+struct sPacket {
+	time_t timestamp;
+	vmIP saddr;
+	vmIP daddr;
+	vmPort port;
+	int proto;
+	int packetlen;
+	int voippacket;
+	volatile int used;
+};
+
+struct sFlow {
+	vmIP saddr;
+	vmIP daddr;
+	vmPort port;
+	int proto;
+	int voippacket;
+};
+
+unsigned opt_flows = 100000;
+unsigned opt_packets = 10000000;
+unsigned opt_ipv6_perc = 10;
+unsigned opt_packets_per_second = 100000;
+
+vector<sFlow> flows;
+sPacket *ring;
+unsigned ring_readit;
+unsigned ring_writeit;
+IpaccFlowTable *table;
+IpaccFlowTable * volatile table_qring[TABLE_QRING_SIZE];
+unsigned table_readit;
+unsigned table_writeit;
+volatile int producer_finished;
+map<unsigned, t_ipacc_buffer> intervals;
+
+
+u_int64_t getTimeUS() {
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return(tv.tv_sec * 1000000ull + tv.tv_usec);
+}
+
+void generateFlows() {
+	flows.resize(opt_flows);
+	unsigned seed = 1;
+	for(unsigned i = 0; i < opt_flows; i++) {
+		sFlow *flow = &flows[i];
+		if((unsigned)rand_r(&seed) % 100 < opt_ipv6_perc) {
+			in6_addr ip6;
+			for(unsigned j = 0; j < 4; j++) {
+				ip6.s6_addr32[j] = rand_r(&seed);
+			}
+			flow->saddr = vmIP(ip6);
+			ip6.s6_addr32[3] = rand_r(&seed);
+			flow->daddr = vmIP(ip6);
+		} else {
+			flow->saddr = vmIP((u_int32_t)(0x0A000000 + rand_r(&seed) % 0xFFFFFF));
+			flow->daddr = vmIP((u_int32_t)(0xC0A80000 + rand_r(&seed) % 0xFFFF));
+		}
+		flow->proto = IPPROTO_UDP;
+		flow->port = rand_r(&seed) % 4 ? 5060 : 0;
+		flow->voippacket = rand_r(&seed) % 2;
+	}
+}
+
+inline sFlow *nextFlow(unsigned *seed) {
+	// half of packets from 1% of flows
+	unsigned r = rand_r(seed);
+	unsigned heavy = opt_flows / 100 ? opt_flows / 100 : 1;
+	return(&flows[(r & 1) ? (r >> 1) % heavy : (r >> 1) % opt_flows]);
+}
+
+inline void aggregate(t_ipacc_buffer *ipacc_buffer, sPacket *packet) {
+	t_ipacc_buffer_key key;
+	key.saddr = packet->saddr;
+	key.daddr = packet->daddr;
+	key.port = packet->port;
+	key.proto = packet->proto;
+	key.voip = packet->voippacket;
+	t_ipacc_buffer::iterator iter = ipacc_buffer->find(key);
+	if(iter != ipacc_buffer->end()) {
+		iter->second.octects += packet->packetlen;
+		iter->second.numpackets++;
+	} else {
+		octects_t octects_data;
+		octects_data.octects += packet->packetlen;
+		octects_data.numpackets++;
+		(*ipacc_buffer)[key] = octects_data;
+	}
+}
+
+void *producerRing(void *) {
+	unsigned seed = 1;
+	time_t timestamp = 1000000000;
+	for(unsigned i = 0; i < opt_packets; i++) {
+		sFlow *flow = nextFlow(&seed);
+		while(ring[ring_writeit].used) {
+			usleep(10);
+		}
+		sPacket *packet = &ring[ring_writeit];
+		packet->timestamp = timestamp + i / opt_packets_per_second;
+		packet->saddr = flow->saddr;
+		packet->daddr = flow->daddr;
+		packet->port = flow->port;
+		packet->proto = flow->proto;
+		packet->packetlen = 200;
+		packet->voippacket = flow->voippacket;
+		packet->used = 1;
+		ring_writeit = (ring_writeit + 1) % RING_SIZE;
+	}
+	producer_finished = 1;
+	return(NULL);
+}
+
+void *consumerRing(void *) {
+	while(true) {
+		bool finished = producer_finished;
+		if(ring[ring_readit].used) {
+			sPacket *packet = &ring[ring_readit];
+			aggregate(&intervals[packet->timestamp / INTERVAL * INTERVAL], packet);
+			packet->used = 0;
+			ring_readit = (ring_readit + 1) % RING_SIZE;
+		} else if(finished) {
+			break;
+		} else {
+			usleep(1000);
+		}
+	}
+	return(NULL);
+}
+
+void pushTable() {
+	while(table_qring[table_writeit]) {
+		usleep(10);
+	}
+	__sync_synchronize();
+	table_qring[table_writeit] = table;
+	table_writeit = (table_writeit + 1) % TABLE_QRING_SIZE;
+	table = NULL;
+}
+
+void *producerTable(void *) {
+	unsigned seed = 1;
+	time_t timestamp = 1000000000;
+	for(unsigned i = 0; i < opt_packets; i++) {
+		sFlow *flow = nextFlow(&seed);
+		unsigned interval_time = (timestamp + i / opt_packets_per_second) / INTERVAL * INTERVAL;
+		t_ipacc_flow_key key;
+		key.set(flow->saddr, flow->daddr, flow->port, flow->proto, flow->voippacket);
+		if(table &&
+		   (table->interval_time != interval_time || table->isFull())) {
+			pushTable();
+		}
+		if(!table) {
+			table = new IpaccFlowTable(interval_time);
+		}
+		table->add(&key, 200);
+	}
+	if(table) {
+		pushTable();
+	}
+	producer_finished = 1;
+	return(NULL);
+}
+
+void *consumerTable(void *) {
+	while(true) {
+		bool finished = producer_finished;
+		IpaccFlowTable *_table = table_qring[table_readit];
+		if(_table) {
+			__sync_synchronize();
+			_table->mergeTo(&intervals[_table->interval_time]);
+			delete _table;
+			table_qring[table_readit] = NULL;
+			table_readit = (table_readit + 1) % TABLE_QRING_SIZE;
+		} else if(finished) {
+			break;
+		} else {
+			usleep(1000);
+		}
+	}
+	return(NULL);
+}
+
+void run(bool use_table) {
+	intervals.clear();
+	ring = NULL;
+	ring_readit = ring_writeit = 0;
+	table = NULL;
+	memset((void*)table_qring, 0, sizeof(table_qring));
+	table_readit = table_writeit = 0;
+	producer_finished = 0;
+	if(!use_table) {
+		ring = new sPacket[RING_SIZE];
+		memset((void*)ring, 0, sizeof(sPacket) * RING_SIZE);
+	}
+	u_int64_t start = getTimeUS();
+	pthread_t consumer_thread;
+	pthread_t producer_thread;
+	pthread_create(&consumer_thread, NULL, use_table ? consumerTable : consumerRing, NULL);
+	pthread_create(&producer_thread, NULL, use_table ? producerTable : producerRing, NULL);
+	pthread_join(producer_thread, NULL);
+	pthread_join(consumer_thread, NULL);
+	u_int64_t time_us = getTimeUS() - start;
+	u_int64_t packets = 0;
+	u_int64_t octects = 0;
+	size_t keys = 0;
+	for(map<unsigned, t_ipacc_buffer>::iterator iter = intervals.begin(); iter != intervals.end(); iter++) {
+		keys += iter->second.size();
+		for(t_ipacc_buffer::iterator iter2 = iter->second.begin(); iter2 != iter->second.end(); iter2++) {
+			packets += iter2->second.numpackets;
+			octects += iter2->second.octects;
+		}
+	}
+	printf("%-6s packets: %llu  intervals: %zu  keys: %zu  octects: %llu  time: %.3lfs  %.2lf Mpps\n",
+	       use_table ? "table" : "ring",
+	       (unsigned long long)packets, intervals.size(), keys, (unsigned long long)octects,
+	       time_us / 1e6, (double)packets / time_us);
+	if(ring) {
+		delete [] ring;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const char *mode = argc > 1 ? argv[1] : "both";
+	if(argc > 2) opt_flows = atoi(argv[2]);
+	if(argc > 3) opt_packets = atoi(argv[3]);
+	if(argc > 4) opt_ipv6_perc = atoi(argv[4]);
+	if(argc > 5) opt_packets_per_second = atoi(argv[5]);
+	if(!opt_flows || !opt_packets_per_second) {
+		printf("bad parameters\n");
+		return(1);
+	}
+	generateFlows();
+	if(!strcmp(mode, "ring") || !strcmp(mode, "both")) {
+		run(false);
+	}
+	if(!strcmp(mode, "table") || !strcmp(mode, "both")) {
+		run(true);
+	}
+	return(0);
+}
@@ -0,0 +1,765 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sql.h>
+#include <sqlext.h>
+#include <sqltypes.h>
+
+
+using namespace std;
+
+
+// array insert via unixODBC (odbc_array_insert) against real odbc driver (default sqlite3 odbc driver)
+// the calls are those of SqlDb_odbc_preparedInsert (prepare / bindParams / execute / isInserted) and SqlDb_odbc::insertArray
+// (fallback of not inserted rows to INSERT queries, runtime disable if driver does not accept arrays of parameters),
+// rows are in form of SqlDb_row - typed value + content escaped for odbc (doubled apostrophe)
+// - keep in sync with sql_db.cpp
+// cases:
+// - mixed:      int / unsigned / double / string columns, column with int and string values in batch goes as text
+// - null:       null in each type of column
+// - apostrophe: content with doubled apostrophe is stored with single one
+// - failrow:    one row of batch violates primary key - status of rows decides, rest of rows via INSERT queries
+// - noarray:    driver rejects SQL_ATTR_PARAMSET_SIZE > 1 (simulated if no such driver given) - array insert is disabled,
+//               batch and next batches via INSERT queries
+//
+// usage: test [connect string] [rows in batch] [connect string of driver without arrays of parameters]
+
+
+string opt_connect = "Driver=SQLite3;Database=/tmp/odbc_insert_test.db";
+unsigned opt_rows = 100;
+string opt_connect_noarray;
+
+unsigned errors;
+
+
+enum eFieldType {
+	_ft_int,
+	_ft_int_u,
+	_ft_double,
+	_ft_string
+};
+
+struct sField {
+	sField(const char *name) {
+		this->name = name;
+		type = _ft_string;
+		null = true;
+		v.i = 0;
+	}
+	string name;
+	eFieldType type;
+	bool null;
+	string content;
+	union {
+		int64_t i;
+		u_int64_t u;
+		double d;
+	} v;
+};
+
+class cRow {
+public:
+	void add(const char *name, int64_t value) {
+		sField field(name);
+		field.type = _ft_int;
+		field.null = false;
+		field.v.i = value;
+		char content[100];
+		snprintf(content, sizeof(content), "%lli", (long long)value);
+		field.content = content;
+		fields.push_back(field);
+	}
+	void add_u(const char *name, u_int64_t value) {
+		sField field(name);
+		field.type = _ft_int_u;
+		field.null = false;
+		field.v.u = value;
+		char content[100];
+		snprintf(content, sizeof(content), "%llu", (unsigned long long)value);
+		field.content = content;
+		fields.push_back(field);
+	}
+	void add(const char *name, double value) {
+		sField field(name);
+		field.type = _ft_double;
+		field.null = false;
+		field.v.d = value;
+		char content[100];
+		snprintf(content, sizeof(content), "%.17g", value);
+		field.content = content;
+		fields.push_back(field);
+	}
+	void add(const char *name, const char *value) {
+		sField field(name);
+		field.type = _ft_string;
+		field.null = false;
+		field.content = escape(value);
+		fields.push_back(field);
+	}
+	void add_null(const char *name) {
+		fields.push_back(sField(name));
+	}
+	static string escape(const char *value) {
+		// as sqlEscapeString for odbc
+		string rslt;
+		for(const char *p = value; *p; p++) {
+			if(*p == '\'') {
+				rslt += "''";
+			} else {
+				rslt += *p;
+			}
+		}
+		return(rslt);
+	}
+	vector<sField> fields;
+};
+
+
+class cOdbc {
+public:
+	cOdbc() {
+		hEnvironment = NULL;
+		hConnection = NULL;
+	}
+	~cOdbc() {
+		disconnect();
+	}
+	bool connect(string connectString) {
+		if(!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &hEnvironment)) ||
+		   !SQL_SUCCEEDED(SQLSetEnvAttr(hEnvironment, SQL_ATTR_ODBC_VERSION, (SQLPOINTER)SQL_OV_ODBC3, 0)) ||
+		   !SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_DBC, hEnvironment, &hConnection))) {
+			return(false);
+		}
+		SQLCHAR outConnectString[1024];
+		SQLSMALLINT outConnectStringLength;
+		if(!SQL_SUCCEEDED(SQLDriverConnect(hConnection, NULL, (SQLCHAR*)connectString.c_str(), SQL_NTS,
+						   outConnectString, sizeof(outConnectString), &outConnectStringLength, SQL_DRIVER_NOPROMPT))) {
+			printf("connect '%s' failed: %s\n", connectString.c_str(), getLastError(SQL_HANDLE_DBC, hConnection).c_str());
+			return(false);
+		}
+		return(true);
+	}
+	void disconnect() {
+		if(hConnection) {
+			SQLDisconnect(hConnection);
+			SQLFreeHandle(SQL_HANDLE_DBC, hConnection);
+			hConnection = NULL;
+		}
+		if(hEnvironment) {
+			SQLFreeHandle(SQL_HANDLE_ENV, hEnvironment);
+			hEnvironment = NULL;
+		}
+	}
+	bool query(string query, bool logError = true) {
+		SQLHSTMT hStatement;
+		if(!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, hConnection, &hStatement))) {
+			return(false);
+		}
+		bool rslt = SQL_SUCCEEDED(SQLExecDirect(hStatement, (SQLCHAR*)query.c_str(), SQL_NTS));
+		if(!rslt && logError) {
+			printf("query '%s' failed: %s\n", query.c_str(), getLastError(SQL_HANDLE_STMT, hStatement).c_str());
+		}
+		SQLFreeHandle(SQL_HANDLE_STMT, hStatement);
+		return(rslt);
+	}
+	bool fetchValue(string query, string *value, bool *null) {
+		SQLHSTMT hStatement;
+		if(!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, hConnection, &hStatement))) {
+			return(false);
+		}
+		bool rslt = false;
+		char buffer[10000];
+		SQLLEN ind;
+		if(SQL_SUCCEEDED(SQLExecDirect(hStatement, (SQLCHAR*)query.c_str(), SQL_NTS)) &&
+		   SQL_SUCCEEDED(SQLFetch(hStatement)) &&
+		   SQL_SUCCEEDED(SQLGetData(hStatement, 1, SQL_C_CHAR, buffer, sizeof(buffer), &ind))) {
+			*null = ind == SQL_NULL_DATA;
+			*value = *null ? "" : buffer;
+			rslt = true;
+		}
+		SQLFreeHandle(SQL_HANDLE_STMT, hStatement);
+		return(rslt);
+	}
+	static string getLastError(SQLSMALLINT handleType, SQLHANDLE handle) {
+		SQLCHAR sqlState[10];
+		SQLINTEGER nativeError;
+		SQLCHAR messageText[1000];
+		SQLSMALLINT messageTextLength;
+		if(handle &&
+		   SQL_SUCCEEDED(SQLGetDiagRec(handleType, handle, 1, sqlState, &nativeError, messageText, sizeof(messageText), &messageTextLength))) {
+			return(string((char*)sqlState) + " " + (char*)messageText);
+		}
+		return("");
+	}
+	SQLHANDLE hEnvironment;
+	SQLHANDLE hConnection;
+};
+
+
+// as SqlDb_odbc_preparedInsert
+class cPreparedInsert {
+public:
+	struct sParam {
+		sParam() {
+			cType = SQL_C_CHAR;
+			sqlType = SQL_VARCHAR;
+			width = 0;
+			buffer = NULL;
+			ind = NULL;
+		}
+		SQLSMALLINT cType;
+		SQLSMALLINT sqlType;
+		SQLLEN width;
+		char *buffer;
+		SQLLEN *ind;
+	};
+public:
+	cPreparedInsert(string table, cRow *row) {
+		this->table = table;
+		for(unsigned i = 0; i < row->fields.size(); i++) {
+			this->columns.push_back(row->fields[i].name);
+		}
+		this->hStatement = NULL;
+		this->paramStatus = NULL;
+		this->paramStatusSize = 0;
+		this->paramsProcessed = 0;
+		this->simulateNoArray = false;
+	}
+	~cPreparedInsert() {
+		this->freeParams();
+		if(this->hStatement) {
+			SQLFreeHandle(SQL_HANDLE_STMT, this->hStatement);
+		}
+		if(this->paramStatus) {
+			delete [] this->paramStatus;
+		}
+	}
+	bool prepare(SQLHANDLE hConnection) {
+		if(!SQL_SUCCEEDED(SQLAllocHandle(SQL_HANDLE_STMT, hConnection, &this->hStatement))) {
+			this->hStatement = NULL;
+			return(false);
+		}
+		string columns_str;
+		string values_str;
+		for(unsigned i = 0; i < this->columns.size(); i++) {
+			if(i) {
+				columns_str += ",";
+				values_str += ",";
+			}
+			columns_str += this->columns[i];
+			values_str += "?";
+		}
+		string query = "INSERT INTO " + this->table + " ( " + columns_str + " ) VALUES ( " + values_str + " )";
+		return(SQL_SUCCEEDED(SQLPrepare(this->hStatement, (SQLCHAR*)query.c_str(), SQL_NTS)) &&
+		       SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0)));
+	}
+	bool bindParams(vector<cRow*> *rows) {
+		SQLULEN rowsCount = rows->size();
+		this->freeParams();
+		SQLFreeStmt(this->hStatement, SQL_RESET_PARAMS);
+		if(rowsCount > this->paramStatusSize) {
+			if(this->paramStatus) {
+				delete [] this->paramStatus;
+			}
+			this->paramStatus = new SQLUSMALLINT[rowsCount];
+			this->paramStatusSize = rowsCount;
+		}
+		for(unsigned i = 0; i < rowsCount; i++) {
+			this->paramStatus[i] = SQL_PARAM_UNUSED;
+		}
+		this->paramsProcessed = 0;
+		if((this->simulateNoArray && rowsCount > 1) ||
+		   !SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)rowsCount, 0)) ||
+		   !SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAM_STATUS_PTR, this->paramStatus, 0)) ||
+		   !SQL_SUCCEEDED(SQLSetStmtAttr(this->hStatement, SQL_ATTR_PARAMS_PROCESSED_PTR, &this->paramsProcessed, 0))) {
+			return(false);
+		}
+		this->params.resize(this->columns.size());
+		for(unsigned i = 0; i < this->columns.size(); i++) {
+			this->setParamType(i, rows);
+			sParam *param = &this->params[i];
+			param->ind = new SQLLEN[rowsCount];
+			if(param->cType == SQL_C_CHAR) {
+				vector<string> contents(rowsCount);
+				param->width = 1;
+				for(unsigned j = 0; j < rowsCount; j++) {
+					sField *field = &(*rows)[j]->fields[i];
+					if(!field->null) {
+						contents[j] = unescapeContent(field->content);
+						if((SQLLEN)contents[j].length() + 1 > param->width) {
+							param->width = contents[j].length() + 1;
+						}
+					}
+				}
+				param->sqlType = param->width - 1 > 8000 ? SQL_LONGVARCHAR : SQL_VARCHAR;
+				param->buffer = new char[rowsCount * param->width];
+				for(unsigned j = 0; j < rowsCount; j++) {
+					if((*rows)[j]->fields[i].null) {
+						param->buffer[j * param->width] = 0;
+						param->ind[j] = SQL_NULL_DATA;
+					} else {
+						memcpy(param->buffer + j * param->width, contents[j].c_str(), contents[j].length() + 1);
+						param->ind[j] = SQL_NTS;
+					}
+				}
+			} else {
+				param->width = sizeof(int64_t);
+				param->buffer = new char[rowsCount * param->width];
+				for(unsigned j = 0; j < rowsCount; j++) {
+					sField *field = &(*rows)[j]->fields[i];
+					if(field->null) {
+						memset(param->buffer + j * param->width, 0, param->width);
+						param->ind[j] = SQL_NULL_DATA;
+					} else {
+						memcpy(param->buffer + j * param->width, &field->v, param->width);
+						param->ind[j] = 0;
+					}
+				}
+			}
+			if(!SQL_SUCCEEDED(SQLBindParameter(this->hStatement, i + 1, SQL_PARAM_INPUT, param->cType, param->sqlType,
+							   param->cType == SQL_C_CHAR ? max(param->width - 1, (SQLLEN)1) : 0, 0,
+							   param->buffer, param->width, param->ind))) {
+				return(false);
+			}
+		}
+		return(true);
+	}
+	SQLRETURN execute() {
+		return(SQLExecute(this->hStatement));
+	}
+	bool isInserted(unsigned rowIndex) {
+		return(rowIndex < this->paramsProcessed && rowIndex < this->paramStatusSize &&
+		       (this->paramStatus[rowIndex] == SQL_PARAM_SUCCESS ||
+			this->paramStatus[rowIndex] == SQL_PARAM_SUCCESS_WITH_INFO));
+	}
+	string getLastError() {
+		return(cOdbc::getLastError(SQL_HANDLE_STMT, this->hStatement));
+	}
+	SQLSMALLINT getCType(unsigned columnIndex) {
+		return(columnIndex < this->params.size() ? this->params[columnIndex].cType : 0);
+	}
+private:
+	void freeParams() {
+		for(unsigned i = 0; i < this->params.size(); i++) {
+			if(this->params[i].buffer) {
+				delete [] this->params[i].buffer;
+			}
+			if(this->params[i].ind) {
+				delete [] this->params[i].ind;
+			}
+		}
+		this->params.clear();
+	}
+	void setParamType(unsigned columnIndex, vector<cRow*> *rows) {
+		int type = -1;
+		for(unsigned i = 0; i < rows->size(); i++) {
+			sField *field = &(*rows)[i]->fields[columnIndex];
+			if(field->null) {
+				continue;
+			}
+			if(type < 0) {
+				type = field->type;
+			} else if(type != field->type) {
+				type = _ft_string;
+				break;
+			}
+		}
+		sParam *param = &this->params[columnIndex];
+		switch(type) {
+		case _ft_int:
+			param->cType = SQL_C_SBIGINT;
+			param->sqlType = SQL_BIGINT;
+			break;
+		case _ft_int_u:
+			param->cType = SQL_C_UBIGINT;
+			param->sqlType = SQL_BIGINT;
+			break;
+		case _ft_double:
+			param->cType = SQL_C_DOUBLE;
+			param->sqlType = SQL_DOUBLE;
+			break;
+		default:
+			param->cType = SQL_C_CHAR;
+			param->sqlType = SQL_VARCHAR;
+			break;
+		}
+	}
+	static string unescapeContent(string &content) {
+		string rslt;
+		size_t pos = 0;
+		size_t pos_apostrophe;
+		while((pos_apostrophe = content.find("''", pos)) != string::npos) {
+			rslt += content.substr(pos, pos_apostrophe - pos) + "'";
+			pos = pos_apostrophe + 2;
+		}
+		rslt += content.substr(pos);
+		return(rslt);
+	}
+public:
+	bool simulateNoArray;
+private:
+	string table;
+	vector<string> columns;
+	vector<sParam> params;
+	SQLHSTMT hStatement;
+	SQLUSMALLINT *paramStatus;
+	SQLULEN paramStatusSize;
+	SQLULEN paramsProcessed;
+};
+
+
+// as SqlDb_odbc::insertArray + cSqlDbArrayInsert::disable
+class cArrayInsert {
+public:
+	cArrayInsert(cOdbc *odbc, bool simulateNoArray = false) {
+		this->odbc = odbc;
+		this->simulateNoArray = simulateNoArray;
+		disabled = false;
+		countArrayBatches = 0;
+		countArrayRows = 0;
+		countFallbackRows = 0;
+	}
+	bool insertArray(string table, vector<cRow*> *rows, cPreparedInsert **preparedInsertRslt = NULL) {
+		if(!rows->size()) {
+			return(true);
+		}
+		vector<bool> inserted(rows->size(), false);
+		if(!disabled) {
+			cPreparedInsert *preparedInsert = new cPreparedInsert(table, (*rows)[0]);
+			preparedInsert->simulateNoArray = simulateNoArray;
+			if(!preparedInsert->prepare(odbc->hConnection)) {
+				printf("prepare insert into %s failed: %s\n", table.c_str(), preparedInsert->getLastError().c_str());
+			} else if(!preparedInsert->bindParams(rows)) {
+				disabled = true;
+				disableError = preparedInsert->getLastError();
+			} else {
+				preparedInsert->execute();
+				++countArrayBatches;
+				for(unsigned i = 0; i < rows->size(); i++) {
+					inserted[i] = preparedInsert->isInserted(i);
+					if(inserted[i]) {
+						++countArrayRows;
+					}
+				}
+			}
+			if(preparedInsertRslt) {
+				*preparedInsertRslt = preparedInsert;
+			} else {
+				delete preparedInsert;
+			}
+		}
+		bool rslt = true;
+		for(unsigned i = 0; i < rows->size(); i++) {
+			if(!inserted[i]) {
+				++countFallbackRows;
+				if(!odbc->query(insertQuery(table, (*rows)[i]), false)) {
+					rslt = false;
+				}
+			}
+		}
+		return(rslt);
+	}
+	static string insertQuery(string table, cRow *row) {
+		string columns_str;
+		string values_str;
+		for(unsigned i = 0; i < row->fields.size(); i++) {
+			if(i) {
+				columns_str += ",";
+				values_str += ",";
+			}
+			sField *field = &row->fields[i];
+			columns_str += field->name;
+			if(field->null) {
+				values_str += "NULL";
+			} else if(field->type == _ft_string) {
+				values_str += "'" + field->content + "'";
+			} else {
+				values_str += field->content;
+			}
+		}
+		return("INSERT INTO " + table + " ( " + columns_str + " ) VALUES ( " + values_str + " )");
+	}
+	cOdbc *odbc;
+	bool simulateNoArray;
+	bool disabled;
+	string disableError;
+	unsigned countArrayBatches;
+	unsigned countArrayRows;
+	unsigned countFallbackRows;
+};
+
+
+void check(bool ok, const char *case_name, const char *format, ...) {
+	if(!ok) {
+		char buffer[1000];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		printf("  %s: FAILED %s\n", case_name, buffer);
+		++errors;
+	}
+}
+
+void checkValue(cOdbc *odbc, const char *case_name, string table, unsigned id, const char *column, const char *value) {
+	char query[1000];
+	snprintf(query, sizeof(query), "SELECT %s FROM %s WHERE id = %u", column, table.c_str(), id);
+	string rsltValue;
+	bool rsltNull;
+	if(!odbc->fetchValue(query, &rsltValue, &rsltNull)) {
+		check(false, case_name, "row %u missing", id);
+		return;
+	}
+	if(value) {
+		check(!rsltNull && rsltValue == value, case_name, "row %u column %s: '%s'%s (expected '%s')",
+		      id, column, rsltValue.c_str(), rsltNull ? " (null)" : "", value);
+	} else {
+		check(rsltNull, case_name, "row %u column %s: '%s' (expected null)", id, column, rsltValue.c_str());
+	}
+}
+
+unsigned countRows(cOdbc *odbc, string table) {
+	string rsltValue;
+	bool rsltNull;
+	if(!odbc->fetchValue("SELECT COUNT(*) FROM " + table, &rsltValue, &rsltNull)) {
+		return(0);
+	}
+	return(atol(rsltValue.c_str()));
+}
+
+void createTable(cOdbc *odbc, string table) {
+	odbc->query("DROP TABLE " + table, false);
+	odbc->query("CREATE TABLE " + table + " ( id INTEGER PRIMARY KEY, i BIGINT, u BIGINT, d DOUBLE, s VARCHAR(255), m VARCHAR(255) )");
+}
+
+void freeRows(vector<cRow*> *rows) {
+	for(unsigned i = 0; i < rows->size(); i++) {
+		delete (*rows)[i];
+	}
+	rows->clear();
+}
+
+cRow *createRow(unsigned id) {
+	cRow *row = new cRow;
+	row->add("id", (int64_t)id);
+	row->add("i", (int64_t)(id * -1000000007ll));
+	row->add_u("u", (u_int64_t)id * 4000000000ull);
+	row->add("d", id + 0.25);
+	char s[100];
+	snprintf(s, sizeof(s), "s_%u", id);
+	row->add("s", s);
+	if(id % 2) {
+		row->add("m", (int64_t)id);
+	} else {
+		snprintf(s, sizeof(s), "m_%u", id);
+		row->add("m", s);
+	}
+	return(row);
+}
+
+void checkRow(cOdbc *odbc, const char *case_name, string table, unsigned id) {
+	char value[100];
+	snprintf(value, sizeof(value), "%lli", (long long)id * -1000000007ll);
+	checkValue(odbc, case_name, table, id, "i", value);
+	snprintf(value, sizeof(value), "%llu", (unsigned long long)id * 4000000000ull);
+	checkValue(odbc, case_name, table, id, "u", value);
+	snprintf(value, sizeof(value), "%u", id * 4 + 1);
+	checkValue(odbc, case_name, table, id, "CAST(d * 4 AS INTEGER)", value);
+	snprintf(value, sizeof(value), "s_%u", id);
+	checkValue(odbc, case_name, table, id, "s", value);
+	if(id % 2) {
+		snprintf(value, sizeof(value), "%u", id);
+	} else {
+		snprintf(value, sizeof(value), "m_%u", id);
+	}
+	checkValue(odbc, case_name, table, id, "m", value);
+}
+
+
+void test_mixed(cOdbc *odbc) {
+	const char *case_name = "mixed";
+	string table = "odbc_insert_test_mixed";
+	createTable(odbc, table);
+	cArrayInsert arrayInsert(odbc);
+	vector<cRow*> rows;
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		rows.push_back(createRow(i));
+	}
+	cPreparedInsert *preparedInsert = NULL;
+	bool rslt = arrayInsert.insertArray(table, &rows, &preparedInsert);
+	check(rslt, case_name, "insertArray failed");
+	check(!arrayInsert.disabled, case_name, "array insert disabled: %s", arrayInsert.disableError.c_str());
+	check(arrayInsert.countArrayRows == opt_rows, case_name, "rows inserted by array: %u (expected %u)", arrayInsert.countArrayRows, opt_rows);
+	if(preparedInsert) {
+		check(preparedInsert->getCType(1) == SQL_C_SBIGINT, case_name, "column i is not bound as SQL_C_SBIGINT");
+		check(preparedInsert->getCType(2) == SQL_C_UBIGINT, case_name, "column u is not bound as SQL_C_UBIGINT");
+		check(preparedInsert->getCType(3) == SQL_C_DOUBLE, case_name, "column d is not bound as SQL_C_DOUBLE");
+		check(preparedInsert->getCType(4) == SQL_C_CHAR, case_name, "column s is not bound as SQL_C_CHAR");
+		check(opt_rows < 2 || preparedInsert->getCType(5) == SQL_C_CHAR, case_name, "mixed column m is not bound as SQL_C_CHAR");
+		delete preparedInsert;
+	}
+	check(countRows(odbc, table) == opt_rows, case_name, "rows in table: %u (expected %u)", countRows(odbc, table), opt_rows);
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		checkRow(odbc, case_name, table, i);
+	}
+	freeRows(&rows);
+}
+
+void test_null(cOdbc *odbc) {
+	const char *case_name = "null";
+	string table = "odbc_insert_test_null";
+	createTable(odbc, table);
+	cArrayInsert arrayInsert(odbc);
+	vector<cRow*> rows;
+	const char *columns[] = { "i", "u", "d", "s", "m" };
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		// null in one column of each row, all columns null in last row
+		cRow *row = createRow(i);
+		for(unsigned j = 1; j < row->fields.size(); j++) {
+			if(i == opt_rows || j - 1 == i % 5) {
+				row->fields[j].null = true;
+			}
+		}
+		rows.push_back(row);
+	}
+	bool rslt = arrayInsert.insertArray(table, &rows);
+	check(rslt, case_name, "insertArray failed");
+	check(arrayInsert.countArrayRows == opt_rows, case_name, "rows inserted by array: %u (expected %u)", arrayInsert.countArrayRows, opt_rows);
+	check(countRows(odbc, table) == opt_rows, case_name, "rows in table: %u (expected %u)", countRows(odbc, table), opt_rows);
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		for(unsigned j = 1; j < rows[i - 1]->fields.size(); j++) {
+			sField *field = &rows[i - 1]->fields[j];
+			if(field->null) {
+				checkValue(odbc, case_name, table, i, columns[j - 1], NULL);
+			}
+		}
+	}
+	freeRows(&rows);
+}
+
+void test_apostrophe(cOdbc *odbc) {
+	const char *case_name = "apostrophe";
+	string table = "odbc_insert_test_apostrophe";
+	createTable(odbc, table);
+	cArrayInsert arrayInsert(odbc);
+	const char *values[] = { "O'Brien", "'", "''", "a''b'c", "'begin", "end'", "no apostrophe" };
+	unsigned countValues = sizeof(values) / sizeof(values[0]);
+	vector<cRow*> rows;
+	for(unsigned i = 1; i <= countValues; i++) {
+		cRow *row = new cRow;
+		row->add("id", (int64_t)i);
+		row->add("s", values[i - 1]);
+		rows.push_back(row);
+	}
+	bool rslt = arrayInsert.insertArray(table, &rows);
+	check(rslt, case_name, "insertArray failed");
+	check(arrayInsert.countArrayRows == countValues, case_name, "rows inserted by array: %u (expected %u)", arrayInsert.countArrayRows, countValues);
+	for(unsigned i = 1; i <= countValues; i++) {
+		checkValue(odbc, case_name, table, i, "s", values[i - 1]);
+	}
+	freeRows(&rows);
+}
+
+void test_failrow(cOdbc *odbc) {
+	const char *case_name = "failrow";
+	string table = "odbc_insert_test_failrow";
+	createTable(odbc, table);
+	cArrayInsert arrayInsert(odbc);
+	unsigned failRow = opt_rows / 2 + 1;
+	// id of fail row exists in table before
+	cRow *rowExists = createRow(failRow);
+	odbc->query(cArrayInsert::insertQuery(table, rowExists));
+	delete rowExists;
+	vector<cRow*> rows;
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		rows.push_back(createRow(i));
+	}
+	bool rslt = arrayInsert.insertArray(table, &rows);
+	check(!rslt, case_name, "insertArray did not report failed row");
+	check(!arrayInsert.disabled, case_name, "array insert disabled: %s", arrayInsert.disableError.c_str());
+	check(arrayInsert.countArrayRows < opt_rows, case_name, "failed row reported as inserted by array");
+	check(arrayInsert.countFallbackRows >= 1 && arrayInsert.countArrayRows + arrayInsert.countFallbackRows == opt_rows, case_name,
+	      "rows inserted by array: %u, rows via INSERT queries: %u (expected %u together)",
+	      arrayInsert.countArrayRows, arrayInsert.countFallbackRows, opt_rows);
+	check(countRows(odbc, table) == opt_rows, case_name, "rows in table: %u (expected %u)", countRows(odbc, table), opt_rows);
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		checkRow(odbc, case_name, table, i);
+	}
+	printf("  %s: rows inserted by array: %u, rows via INSERT queries: %u\n", case_name, arrayInsert.countArrayRows, arrayInsert.countFallbackRows);
+	freeRows(&rows);
+}
+
+void test_noarray(cOdbc *odbc) {
+	const char *case_name = "noarray";
+	string table = "odbc_insert_test_noarray";
+	createTable(odbc, table);
+	cArrayInsert arrayInsert(odbc, opt_connect_noarray.empty());
+	vector<cRow*> rows;
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		rows.push_back(createRow(i));
+	}
+	// first batch disables array insert, next batch goes directly via INSERT queries
+	unsigned half = opt_rows / 2;
+	vector<cRow*> rows1(rows.begin(), rows.begin() + half);
+	vector<cRow*> rows2(rows.begin() + half, rows.end());
+	bool rslt1 = arrayInsert.insertArray(table, &rows1);
+	bool disabledAfterFirst = arrayInsert.disabled;
+	unsigned arrayBatchesAfterFirst = arrayInsert.countArrayBatches;
+	bool rslt2 = arrayInsert.insertArray(table, &rows2);
+	check(rslt1 && rslt2, case_name, "insertArray failed");
+	check(disabledAfterFirst, case_name, "array insert not disabled by first batch");
+	check(arrayBatchesAfterFirst == 0 && arrayInsert.countArrayBatches == 0, case_name, "batch executed as array after disable");
+	check(arrayInsert.countFallbackRows == opt_rows, case_name, "rows via INSERT queries: %u (expected %u)", arrayInsert.countFallbackRows, opt_rows);
+	check(countRows(odbc, table) == opt_rows, case_name, "rows in table: %u (expected %u)", countRows(odbc, table), opt_rows);
+	for(unsigned i = 1; i <= opt_rows; i++) {
+		checkRow(odbc, case_name, table, i);
+	}
+	printf("  %s: disabled (%s)\n", case_name, arrayInsert.disableError.empty() ? "simulated" : arrayInsert.disableError.c_str());
+	freeRows(&rows);
+}
+
+
+int main(int argc, char *argv[]) {
+	if(argc > 1) {
+		opt_connect = argv[1];
+	}
+	if(argc > 2) {
+		opt_rows = max(atoi(argv[2]), 4);
+	}
+	if(argc > 3) {
+		opt_connect_noarray = argv[3];
+	}
+	cOdbc odbc;
+	if(!odbc.connect(opt_connect)) {
+		return(1);
+	}
+	printf("connect: %s, rows in batch: %u\n", opt_connect.c_str(), opt_rows);
+	struct {
+		const char *name;
+		void (*test)(cOdbc *odbc);
+	} cases[] = {
+		{ "mixed", test_mixed },
+		{ "null", test_null },
+		{ "apostrophe", test_apostrophe },
+		{ "failrow", test_failrow },
+		{ "noarray", test_noarray }
+	};
+	for(unsigned i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		unsigned errors_before = errors;
+		cOdbc odbcNoArray;
+		bool noArrayDriver = !strcmp(cases[i].name, "noarray") && !opt_connect_noarray.empty();
+		if(noArrayDriver && !odbcNoArray.connect(opt_connect_noarray)) {
+			++errors;
+			continue;
+		}
+		cases[i].test(noArrayDriver ? &odbcNoArray : &odbc);
+		printf("%s: %s\n", cases[i].name, errors == errors_before ? "OK" : "FAILED");
+	}
+	printf("%s\n", errors ? "FAILED" : "OK");
+	return(errors ? 1 : 0);
+}
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+#include "../../rcu.h"
+
+
+// lookup throughput of RTP ip:port hash (Calltable::calls_hash)
+// - lock:  lock_calls_hash for each lookup batch (original find_hash / rtp_batch)
+// - rcu:   cEpochRcu read section for each lookup batch (HASH_RTP_FIND__RCU)
+// writer thread adds / removes streams at given rate in both modes
+//
+// usage: test [readers] [streams] [seconds] [writer ops per second] [batch]
+
+
+#define MAXNODE 150000
+
+
+struct node_call_rtp {
+	node_call_rtp *next;
+	void *call;
+	int8_t iscaller;
+};
+
+struct node_call_rtp_ip_port {
+	node_call_rtp_ip_port *next;
+	node_call_rtp *calls;
+	u_int32_t addr;
+	u_int16_t port;
+};
+
+inline unsigned int tuplehash(u_int32_t addr, u_int16_t port) {
+	unsigned int key;
+	key = (unsigned int)(addr * port);
+	key += ~(key << 15);
+	key ^=  (key >> 10);
+	key +=  (key << 3);
+	key ^=  (key >> 6);
+	key += ~(key << 11);
+	key ^=  (key >> 16);
+	return key % MAXNODE;
+}
+
+
+node_call_rtp_ip_port *calls_hash[MAXNODE];
+volatile int _sync_lock_calls_hash;
+cEpochRcu calls_hash_rcu;
+bool use_rcu;
+volatile int terminating;
+
+unsigned opt_readers = 4;
+unsigned opt_streams = 100000;
+unsigned opt_seconds = 5;
+unsigned opt_writer_ops = 10000;
+unsigned opt_batch = 32;
+
+
+void lock_calls_hash() {
+	while(__sync_lock_test_and_set(&_sync_lock_calls_hash, 1));
+}
+
+void unlock_calls_hash() {
+	__sync_lock_release(&_sync_lock_calls_hash);
+}
+
+u_int64_t getTimeUS() {
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return(tv.tv_sec * 1000000ull + tv.tv_usec);
+}
+
+void stream(unsigned index, u_int32_t *addr, u_int16_t *port) {
+	*addr = 0x0A000000 + index / 16;
+	*port = 10000 + (index % 16) * 2;
+}
+
+static void destroy_node_call_rtp(void *node) {
+	delete (node_call_rtp*)node;
+}
+
+static void destroy_node_call_rtp_ip_port(void *node) {
+	delete (node_call_rtp_ip_port*)node;
+}
+
+void hash_add(u_int32_t addr, u_int16_t port, void *call) {
+	unsigned h = tuplehash(addr, port);
+	node_call_rtp *node_call = new node_call_rtp;
+	node_call->next = NULL;
+	node_call->call = call;
+	node_call->iscaller = 1;
+	node_call_rtp_ip_port *node = new node_call_rtp_ip_port;
+	node->addr = addr;
+	node->port = port;
+	node->calls = node_call;
+	node->next = calls_hash[h];
+	__sync_synchronize();
+	calls_hash[h] = node;
+}
+
+void hash_remove(u_int32_t addr, u_int16_t port) {
+	unsigned h = tuplehash(addr, port);
+	node_call_rtp_ip_port *prev = NULL;
+	for(node_call_rtp_ip_port *node = calls_hash[h]; node; node = node->next) {
+		if(node->addr == addr && node->port == port) {
+			if(prev) {
+				prev->next = node->next;
+			} else {
+				calls_hash[h] = node->next;
+			}
+			if(use_rcu) {
+				calls_hash_rcu.retire(node->calls, destroy_node_call_rtp);
+				calls_hash_rcu.retire(node, destroy_node_call_rtp_ip_port);
+			} else {
+				delete node->calls;
+				delete node;
+			}
+			break;
+		}
+		prev = node;
+	}
+}
+
+inline node_call_rtp *hash_find(u_int32_t addr, u_int16_t port) {
+	for(node_call_rtp_ip_port *node = calls_hash[tuplehash(addr, port)]; node; node = node->next) {
+		if(node->port == port && node->addr == addr) {
+			return(node->calls);
+		}
+	}
+	return(NULL);
+}
+
+void *reader(void *arg) {
+	u_int64_t *counter = (u_int64_t*)arg;
+	unsigned seed = (unsigned)(long)arg;
+	u_int64_t found = 0;
+	while(!terminating) {
+		bool rcu = use_rcu && calls_hash_rcu.read_lock();
+		if(!rcu) {
+			lock_calls_hash();
+		}
+		for(unsigned i = 0; i < opt_batch; i++) {
+			u_int32_t addr;
+			u_int16_t port;
+			stream(rand_r(&seed) % opt_streams, &addr, &port);
+			node_call_rtp *n_call = hash_find(addr, port);
+			if(n_call && n_call->call) {
+				++found;
+			}
+		}
+		if(rcu) {
+			calls_hash_rcu.read_unlock();
+		} else {
+			unlock_calls_hash();
+		}
+		counter[0] += opt_batch;
+	}
+	counter[1] = found;
+	return(NULL);
+}
+
+void *writer(void *arg) {
+	u_int64_t *counter = (u_int64_t*)arg;
+	unsigned seed = 1;
+	u_int64_t next_op_us = getTimeUS();
+	while(!terminating) {
+		if(opt_writer_ops) {
+			u_int64_t time_us = getTimeUS();
+			if(time_us < next_op_us) {
+				usleep(next_op_us - time_us > 1000 ? 1000 : next_op_us - time_us);
+				continue;
+			}
+			next_op_us += 1000000 / opt_writer_ops;
+		} else {
+			usleep(1000);
+			continue;
+		}
+		u_int32_t addr;
+		u_int16_t port;
+		stream(rand_r(&seed) % opt_streams, &addr, &port);
+		lock_calls_hash();
+		hash_remove(addr, port);
+		hash_add(addr, port, (void*)1);
+		unlock_calls_hash();
+		if(use_rcu && !(++counter[0] % 100)) {
+			calls_hash_rcu.reclaim();
+		}
+	}
+	return(NULL);
+}
+
+double run(bool rcu) {
+	use_rcu = rcu;
+	terminating = 0;
+	u_int64_t counters[64][8];
+	memset(counters, 0, sizeof(counters));
+	pthread_t threads[64];
+	pthread_t writer_thread;
+	u_int64_t writer_counter = 0;
+	for(unsigned i = 0; i < opt_readers; i++) {
+		pthread_create(&threads[i], NULL, reader, counters[i]);
+	}
+	pthread_create(&writer_thread, NULL, writer, &writer_counter);
+	u_int64_t start = getTimeUS();
+	sleep(opt_seconds);
+	terminating = 1;
+	u_int64_t sum = 0;
+	for(unsigned i = 0; i < opt_readers; i++) {
+		pthread_join(threads[i], NULL);
+		sum += counters[i][0];
+	}
+	pthread_join(writer_thread, NULL);
+	double mlps = (double)sum / (getTimeUS() - start);
+	calls_hash_rcu.reclaim();
+	printf("%-5s %2u readers: %8.2f Mlookups/s (%.2f per reader)\n",
+	       rcu ? "rcu" : "lock", opt_readers, mlps, mlps / opt_readers);
+	return(mlps);
+}
+
+int main(int argc, char *argv[]) {
+	if(argc > 1) opt_readers = atoi(argv[1]);
+	if(argc > 2) opt_streams = atoi(argv[2]);
+	if(argc > 3) opt_seconds = atoi(argv[3]);
+	if(argc > 4) opt_writer_ops = atoi(argv[4]);
+	if(argc > 5) opt_batch = atoi(argv[5]);
+	if(opt_readers < 1 || opt_readers > 64 || !opt_streams || !opt_batch) {
+		printf("usage: %s [readers (1-64)] [streams] [seconds] [writer ops per second] [batch]\n", argv[0]);
+		return(1);
+	}
+	for(unsigned i = 0; i < opt_streams; i++) {
+		u_int32_t addr;
+		u_int16_t port;
+		stream(i, &addr, &port);
+		hash_add(addr, port, (void*)1);
+	}
+	printf("streams: %u, writer ops/s: %u, batch: %u\n", opt_streams, opt_writer_ops, opt_batch);
+	double lock = run(false);
+	double rcu = run(true);
+	printf("rcu / lock: %.2fx\n", lock > 0 ? rcu / lock : 0);
+	return(0);
+}
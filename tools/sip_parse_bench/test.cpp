@@ -0,0 +1,423 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+#include "../../sip_scan.h"
+
+
+// SIP header parsing throughput (ParsePacket::parseData)
+// - trie: former 256-way ppNode trie, character by character scan for line ends
+// - scan: sip_scan_eol / sip_scan_name_delim + cSipHeaderNames (perfect hash of header name keys)
+// both parsers are run over the same corpus and their results are compared
+//
+// usage: test [scalar|sse42|avx2|auto] [iterations] [corpus file]
+// corpus file: SIP messages separated by line "%%" (LF line ends are converted to CRLF),
+// without corpus file messages are generated
+
+
+#define STD_MAX 100
+
+
+struct sItem {
+	u_int32_t offset;
+	u_int32_t length;
+};
+
+struct sContents {
+	void clean() {
+		memset(std, 0, sizeof(std));
+		doubleEndLine = NULL;
+		contentLength = -1;
+	}
+	sItem std[STD_MAX];
+	char *doubleEndLine;
+	int32_t contentLength;
+};
+
+static void trim(sItem *item, const char *data) {
+	while(item->length && data[item->offset + item->length - 1] == ' ') {
+		--item->length;
+	}
+	while(item->length && data[item->offset] == ' ') {
+		++item->offset;
+		--item->length;
+	}
+}
+
+static void setContentLength(sContents *contents, sItem *item, const char *data, unsigned long datalen) {
+	if(item->offset + item->length == datalen) {
+		char tempLength[10];
+		int maxLengthLength = sizeof(tempLength) - 1 < item->length ? sizeof(tempLength) - 1 : item->length;
+		strncpy(tempLength, data + item->offset, maxLengthLength);
+		tempLength[maxLengthLength] = 0;
+		contents->contentLength = atoi(tempLength);
+	} else {
+		contents->contentLength = atoi(data + item->offset);
+	}
+}
+
+
+struct ppNode {
+	ppNode() {
+		memset(nodes, 0, sizeof(nodes));
+		leaf = false;
+		nodeIndex = 0;
+		isContentLength = false;
+	}
+	void addNode(const char *nodeName, int nodeIndex, bool isContentLength) {
+		if(*nodeName) {
+			unsigned char nodeChar = (unsigned char)*nodeName;
+			if(nodeChar >= 'A' && nodeChar <= 'Z') {
+				nodeChar -= 'A' - 'a';
+			}
+			if(!nodes[nodeChar]) {
+				nodes[nodeChar] = new ppNode;
+			}
+			nodes[nodeChar]->addNode(nodeName + 1, nodeIndex, isContentLength);
+		} else {
+			leaf = true;
+			this->nodeIndex = nodeIndex;
+			this->isContentLength = isContentLength;
+		}
+	}
+	ppNode *getNode(const char *nodeName, u_int32_t *namelength_rslt, u_int32_t namelength, u_int32_t namelength_limit) {
+		if(leaf) {
+			*namelength_rslt = namelength;
+			return(this);
+		}
+		if(!*nodeName) {
+			return(NULL);
+		}
+		unsigned char nodeChar = (unsigned char)*nodeName;
+		if(nodeChar >= 'A' && nodeChar <= 'Z') {
+			nodeChar -= 'A' - 'a';
+		}
+		if(!nodes[nodeChar] || ++namelength > namelength_limit) {
+			return(NULL);
+		}
+		return(nodes[nodeChar]->getNode(nodeName + 1, namelength_rslt, namelength, namelength_limit));
+	}
+	ppNode *nodes[256];
+	bool leaf;
+	int nodeIndex;
+	bool isContentLength;
+};
+
+ppNode trie_root;
+
+u_int32_t parse_trie(char *data, unsigned long datalen, sContents *contents) {
+	unsigned long rsltDataLen = datalen;
+	u_int32_t namelength;
+	for(unsigned long i = 0; i < datalen; i++) {
+		if(!contents->doubleEndLine &&
+		   datalen > 3 &&
+		   data[i] == '\r' && i < datalen - 3 &&
+		   data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
+			contents->doubleEndLine = data + i;
+			if(contents->contentLength > -1) {
+				unsigned long modify_datalen = contents->doubleEndLine + 4 - data + contents->contentLength;
+				if(modify_datalen < datalen) {
+					datalen = modify_datalen;
+					rsltDataLen = datalen;
+				}
+			} else {
+				rsltDataLen = contents->doubleEndLine + 4 - data;
+				break;
+			}
+			i += 2;
+		} else if(i == 0 || data[i - 1] == '\n') {
+			ppNode *node = trie_root.getNode(data + i, &namelength, 0, datalen - i - 1);
+			if(node && !contents->std[node->nodeIndex].length) {
+				sItem *item = &contents->std[node->nodeIndex];
+				item->offset = i + namelength;
+				i += namelength;
+				bool endLine = false;
+				for(; i < datalen; i++) {
+					if(data[i] == '\r' || data[i] == '\n') {
+						endLine = true;
+						break;
+					}
+				}
+				item->length = i - item->offset;
+				trim(item, data);
+				if(node->isContentLength && item->length) {
+					setContentLength(contents, item, data, datalen);
+				}
+				if(endLine) {
+					--i;
+				}
+			}
+		}
+	}
+	return(rsltDataLen);
+}
+
+
+cSipHeaderNames scan_names;
+std::vector<bool> scan_isContentLength;
+
+u_int32_t parse_scan(char *data, unsigned long datalen, sContents *contents) {
+	unsigned long rsltDataLen = datalen;
+	u_int32_t namelength;
+	unsigned long i = 0;
+	while(i < datalen) {
+		if((i == 0 || data[i - 1] == '\n') && data[i] != '\r') {
+			int node = scan_names.find(data + i, datalen - i - 1, &namelength);
+			if(node >= 0 && !contents->std[node].length) {
+				sItem *item = &contents->std[node];
+				item->offset = i + namelength;
+				i += namelength;
+				i += sip_scan_eol(data + i, datalen - i);
+				item->length = i - item->offset;
+				trim(item, data);
+				if(scan_isContentLength[node] && item->length) {
+					setContentLength(contents, item, data, datalen);
+				}
+				continue;
+			}
+		}
+		i += sip_scan_eol(data + i, datalen - i);
+		if(i >= datalen) {
+			break;
+		}
+		if(!contents->doubleEndLine &&
+		   datalen > 3 &&
+		   data[i] == '\r' && i < datalen - 3 &&
+		   data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
+			contents->doubleEndLine = data + i;
+			if(contents->contentLength > -1) {
+				unsigned long modify_datalen = contents->doubleEndLine + 4 - data + contents->contentLength;
+				if(modify_datalen < datalen) {
+					datalen = modify_datalen;
+					rsltDataLen = datalen;
+				}
+			} else {
+				rsltDataLen = contents->doubleEndLine + 4 - data;
+				break;
+			}
+			i += 4;
+		} else {
+			++i;
+		}
+	}
+	return(rsltDataLen);
+}
+
+
+const char *std_nodes[] = {
+	"content-length:", "l:", "INVITE ", "MESSAGE ", "call-id:", "i:", "from:", "f:", "to:", "t:",
+	"contact:", "m:", "remote-party-id:", "P-Asserted-Identity:", "geoposition:", "user-agent:",
+	"authorization:", "proxy-authorization:", "expires:", "x-voipmonitor-norecord:", "signal:", "signal=",
+	"x-voipmonitor-custom1:", "content-type:", "c:", "cseq:", "supported:", "proxy-authenticate:",
+	"via:", "v:", "reason:", "m=audio ", "a=rtpmap:", "o=", "c=IN IP4 ", "expires=", "username=\"", "realm=\"",
+	"CallID:", "LocalAddr:", "RemoteAddr:", "QualityEst:", "PacketLoss:",
+	"X-Siptrace-Fromip:", "X-Siptrace-Toip:", "X-Siptrace-Time:",
+	"event:", "subscription-state:", "referred-by:"
+};
+
+void init_nodes() {
+	unsigned count = sizeof(std_nodes) / sizeof(std_nodes[0]);
+	for(unsigned i = 0; i < count; i++) {
+		bool isContentLength = i < 2;
+		trie_root.addNode(std_nodes[i], i, isContentLength);
+		scan_names.add(std_nodes[i], i);
+		scan_isContentLength.push_back(isContentLength);
+	}
+	scan_names.build();
+}
+
+
+const char *gen_methods[] = { "INVITE", "BYE", "ACK", "REGISTER", "OPTIONS", "NOTIFY" };
+const char *gen_extra_headers[] = {
+	"Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, INFO\r\n",
+	"Max-Forwards: 70\r\n",
+	"Record-Route: <sip:10.0.0.1;lr;ftag=as4f2c1d>\r\n",
+	"Session-Expires: 1800;refresher=uac\r\n",
+	"X-Custom-Routing-Information: gateway=12;trunk=backup;priority=high\r\n",
+	"P-Charging-Vector: icid-value=1234567890abcdef;icid-generated-at=10.0.0.1\r\n",
+	"Privacy: none\r\n"
+};
+
+std::string gen_message(unsigned index) {
+	unsigned seed = index * 7919 + 1;
+	char buff[4096];
+	const char *method = gen_methods[rand_r(&seed) % (sizeof(gen_methods) / sizeof(gen_methods[0]))];
+	bool response = rand_r(&seed) % 2;
+	bool compact = rand_r(&seed) % 4 == 0;
+	std::string sdp;
+	if(!strcmp(method, "INVITE") && !response) {
+		snprintf(buff, sizeof(buff),
+			 "v=0\r\n"
+			 "o=- %u 1 IN IP4 10.1.%u.%u\r\n"
+			 "s=-\r\n"
+			 "c=IN IP4 10.1.%u.%u\r\n"
+			 "t=0 0\r\n"
+			 "m=audio %u RTP/AVP 8 0 101\r\n"
+			 "a=rtpmap:8 PCMA/8000\r\n"
+			 "a=rtpmap:0 PCMU/8000\r\n"
+			 "a=rtpmap:101 telephone-event/8000\r\n"
+			 "a=sendrecv\r\n",
+			 index, index / 256 % 256, index % 256, index / 256 % 256, index % 256, 10000 + index % 20000 * 2);
+		sdp = buff;
+	}
+	std::string msg;
+	if(response) {
+		msg = "SIP/2.0 200 OK\r\n";
+	} else {
+		snprintf(buff, sizeof(buff), "%s sip:%u@10.0.0.2 SIP/2.0\r\n", method, 420000000 + index);
+		msg = buff;
+	}
+	snprintf(buff, sizeof(buff),
+		 "%s SIP/2.0/UDP 10.0.0.1:5060;branch=z9hG4bK%08x\r\n"
+		 "%s \"%u\" <sip:%u@10.0.0.1>;tag=%08x\r\n"
+		 "%s <sip:%u@10.0.0.2>\r\n"
+		 "%s %08x-%u@10.0.0.1\r\n"
+		 "CSeq: %u %s\r\n"
+		 "%s <sip:%u@10.0.0.1:5060>\r\n"
+		 "User-Agent: Test UA 1.%u\r\n",
+		 compact ? "v:" : "Via:", index,
+		 compact ? "f:" : "From:", index, index, index * 3,
+		 compact ? "t:" : "To:", 420000000 + index,
+		 compact ? "i:" : "Call-ID:", index * 13, index,
+		 index % 100 + 1, method,
+		 compact ? "m:" : "Contact:", index,
+		 index % 10);
+	msg += buff;
+	unsigned extra = rand_r(&seed) % 5;
+	for(unsigned i = 0; i < extra; i++) {
+		msg += gen_extra_headers[rand_r(&seed) % (sizeof(gen_extra_headers) / sizeof(gen_extra_headers[0]))];
+	}
+	if(sdp.length()) {
+		msg += compact ? "c: application/sdp\r\n" : "Content-Type: application/sdp\r\n";
+	}
+	snprintf(buff, sizeof(buff), "%s %u\r\n\r\n", compact ? "l:" : "Content-Length:", (unsigned)sdp.length());
+	msg += buff;
+	msg += sdp;
+	return(msg);
+}
+
+bool load_corpus(const char *fileName, std::vector<std::string> *corpus) {
+	FILE *file = fopen(fileName, "r");
+	if(!file) {
+		return(false);
+	}
+	std::string msg;
+	char line[65536];
+	while(fgets(line, sizeof(line), file)) {
+		if(!strcmp(line, "%%\n") || !strcmp(line, "%%\r\n")) {
+			if(msg.length()) {
+				corpus->push_back(msg);
+			}
+			msg.clear();
+			continue;
+		}
+		size_t length = strlen(line);
+		if(length && line[length - 1] == '\n' && (length < 2 || line[length - 2] != '\r')) {
+			line[length - 1] = 0;
+			msg += line;
+			msg += "\r\n";
+		} else {
+			msg += line;
+		}
+	}
+	if(msg.length()) {
+		corpus->push_back(msg);
+	}
+	fclose(file);
+	return(true);
+}
+
+
+u_int64_t getCpuTimeUS() {
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return(ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+double run(bool scan, std::vector<std::string> *corpus, unsigned iterations, u_int64_t *bytes) {
+	sContents contents;
+	u_int64_t sum = 0;
+	*bytes = 0;
+	u_int64_t start = getCpuTimeUS();
+	for(unsigned iter = 0; iter < iterations; iter++) {
+		for(unsigned i = 0; i < corpus->size(); i++) {
+			char *data = (char*)(*corpus)[i].c_str();
+			unsigned long datalen = (*corpus)[i].length();
+			contents.clean();
+			sum += scan ?
+				parse_scan(data, datalen, &contents) :
+				parse_trie(data, datalen, &contents);
+			*bytes += datalen;
+		}
+	}
+	u_int64_t time_us = getCpuTimeUS() - start;
+	if(!sum) {
+		printf("empty result\n");
+	}
+	return(time_us ? (double)corpus->size() * iterations / time_us : 0);
+}
+
+int main(int argc, char *argv[]) {
+	int scanType = -1;
+	unsigned iterations = 1000;
+	if(argc > 1) {
+		if(!strcmp(argv[1], "scalar")) scanType = _sip_scan_scalar;
+		else if(!strcmp(argv[1], "sse2")) scanType = _sip_scan_sse2;
+		else if(!strcmp(argv[1], "avx2")) scanType = _sip_scan_avx2;
+		else if(strcmp(argv[1], "auto")) {
+			printf("usage: %s [scalar|sse42|avx2|auto] [iterations] [corpus file]\n", argv[0]);
+			return(1);
+		}
+	}
+	if(argc > 2) iterations = atoi(argv[2]);
+	std::vector<std::string> corpus;
+	if(argc > 3) {
+		if(!load_corpus(argv[3], &corpus) || !corpus.size()) {
+			printf("failed load corpus %s\n", argv[3]);
+			return(1);
+		}
+	} else {
+		for(unsigned i = 0; i < 1000; i++) {
+			corpus.push_back(gen_message(i));
+		}
+	}
+	sip_scan_init(scanType);
+	init_nodes();
+	printf("messages: %u, iterations: %u, scanner: %s, perfect hash: %s\n",
+	       (unsigned)corpus.size(), iterations, sip_scan_type_name(sip_scan_type()),
+	       scan_names.isPerfectHash() ? "yes" : "no");
+	unsigned diffs = 0;
+	for(unsigned i = 0; i < corpus.size(); i++) {
+		char *data = (char*)corpus[i].c_str();
+		unsigned long datalen = corpus[i].length();
+		sContents contents_trie, contents_scan;
+		contents_trie.clean();
+		contents_scan.clean();
+		u_int32_t rslt_trie = parse_trie(data, datalen, &contents_trie);
+		u_int32_t rslt_scan = parse_scan(data, datalen, &contents_scan);
+		if(rslt_trie != rslt_scan ||
+		   contents_trie.doubleEndLine != contents_scan.doubleEndLine ||
+		   contents_trie.contentLength != contents_scan.contentLength ||
+		   memcmp(contents_trie.std, contents_scan.std, sizeof(contents_trie.std))) {
+			if(!diffs) {
+				printf("result differs for message %u:\n%s\n", i, corpus[i].c_str());
+			}
+			++diffs;
+		}
+	}
+	if(diffs) {
+		printf("different results: %u\n", diffs);
+	}
+	u_int64_t bytes;
+	double trie = run(false, &corpus, iterations, &bytes);
+	printf("trie: %8.3f Mmsgs/s %8.1f MB/s\n", trie, trie * bytes / corpus.size() / iterations);
+	double scan = run(true, &corpus, iterations, &bytes);
+	printf("scan: %8.3f Mmsgs/s %8.1f MB/s\n", scan, scan * bytes / corpus.size() / iterations);
+	printf("scan / trie: %.2fx\n", trie > 0 ? scan / trie : 0);
+	return(diffs ? 1 : 0);
+}
@@ -40,9 +40,16 @@ CompressStream::CompressStream(eTypeCompress typeCompress, u_int32_t compressBuf
 	this->lzoWrkmemDecompress = NULL;
 	this->lzoDecompressData = NULL;
 	#endif //HAVE_LIBLZO
+	#ifdef HAVE_LIBZSTD
+	this->zstdStream = NULL;
+	this->zstdStreamDecompress = NULL;
+	#endif //HAVE_LIBZSTD
 	this->snappyDecompressData = NULL;
 	this->zipLevel = Z_DEFAULT_COMPRESSION;
 	this->lzmaLevel = 6;
+	this->zstdLevel = 3;
+	this->zstdWorkers = 0;
+	this->zstdLongDistance = false;
 	this->autoPrefixFile = false;
 	this->forceStream = false;
 	this->processed_len = 0;
@@ -63,6 +70,18 @@ void CompressStream::setLzmaLevel(int lzmaLevel) {
 	this->lzmaLevel = lzmaLevel;
 }
 
+void CompressStream::setZstdLevel(int zstdLevel) {
+	this->zstdLevel = zstdLevel;
+}
+
+void CompressStream::setZstdWorkers(int zstdWorkers) {
+	this->zstdWorkers = zstdWorkers;
+}
+
+void CompressStream::setZstdLongDistance(bool zstdLongDistance) {
+	this->zstdLongDistance = zstdLongDistance;
+}
+
 void CompressStream::enableAutoPrefixFile() {
 	this->autoPrefixFile = true;
 }
@@ -141,6 +160,30 @@ void CompressStream::initCompress() {
 		}
 		#endif //HAVE_LIBLZ4
 		break;
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStream) {
+			this->zstdStream = ZSTD_createCCtx();
+			if(!this->zstdStream) {
+				this->setError("zstd initialize failed");
+				break;
+			}
+			size_t rslt = ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_compressionLevel, this->zstdLevel);
+			if(!ZSTD_isError(rslt) && this->zstdLongDistance) {
+				rslt = ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_enableLongDistanceMatching, 1);
+			}
+			if(ZSTD_isError(rslt)) {
+				this->setError(string("zstd initialize failed - ") + ZSTD_getErrorName(rslt));
+				break;
+			}
+			if(this->zstdWorkers > 0) {
+				// fails if libzstd is built without multithread support - compression then runs in caller thread
+				ZSTD_CCtx_setParameter(this->zstdStream, ZSTD_c_nbWorkers, this->zstdWorkers);
+			}
+			createCompressBuffer();
+		}
+		#endif //HAVE_LIBZSTD
+		break;
 	case compress_auto:
 		break;
 	}
@@ -213,6 +256,18 @@ void CompressStream::initDecompress(u_int32_t dataLen) {
 		createDecompressBuffer(dataLen);
 		#endif //HAVE_LIBLZ4
 		break;
+	case zstd:
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStreamDecompress) {
+			this->zstdStreamDecompress = ZSTD_createDCtx();
+			if(this->zstdStreamDecompress) {
+				createDecompressBuffer(this->decompressBufferLength);
+			} else {
+				this->setError("unzstd initialize failed");
+			}
+		}
+		#endif //HAVE_LIBZSTD
+		break;
 	case compress_auto:
 		break;
 	}
@@ -243,6 +298,12 @@ void CompressStream::termCompress() {
 		this->lz4Stream = NULL;
 	}
 	#endif //ifdef HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	if(this->zstdStream) {
+		ZSTD_freeCCtx(this->zstdStream);
+		this->zstdStream = NULL;
+	}
+	#endif //HAVE_LIBZSTD
 	if(this->compressBuffer) {
 		delete [] this->compressBuffer;
 		this->compressBuffer = NULL;
@@ -282,6 +343,12 @@ void CompressStream::termDecompress() {
 		this->lz4StreamDecode = NULL;
 	}
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	if(this->zstdStreamDecompress) {
+		ZSTD_freeDCtx(this->zstdStreamDecompress);
+		this->zstdStreamDecompress = NULL;
+	}
+	#endif //HAVE_LIBZSTD
 	if(this->decompressBuffer) {
 		delete [] this->decompressBuffer;
 		this->decompressBuffer = NULL;
@@ -497,6 +564,33 @@ bool CompressStream::compress(char *data, u_int32_t len, bool flush, CompressStr
 		#endif //HAVE_LIBLZ4
 		}
 		break;
+	case zstd: {
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStream) {
+			this->initCompress();
+			if(this->isError()) {
+				return(false);
+			}
+		}
+		ZSTD_inBuffer inBuffer = { data, len, 0 };
+		size_t rslt;
+		do {
+			ZSTD_outBuffer outBuffer = { this->compressBuffer, this->compressBufferLength, 0 };
+			rslt = ZSTD_compressStream2(this->zstdStream, &outBuffer, &inBuffer, flush ? ZSTD_e_end : ZSTD_e_continue);
+			if(ZSTD_isError(rslt)) {
+				this->setError(string("zstd compress failed - ") + ZSTD_getErrorName(rslt));
+				return(false);
+			}
+			if(outBuffer.pos &&
+			   !baseEv->compress_ev(this->compressBuffer, outBuffer.pos, 0)) {
+				this->setError("zstd compress_ev failed");
+				return(false);
+			}
+		} while(inBuffer.pos < inBuffer.size || (flush && rslt));
+		this->processed_len += len;
+		#endif //HAVE_LIBZSTD
+		}
+		break;
 	case compress_auto:
 		break;
 	}
@@ -526,6 +620,10 @@ bool CompressStream::decompress(char *data, u_int32_t len, u_int32_t decompress_
 			this->typeCompress = lzo;
 			data += 3;
 			len -= 3;
+		#ifdef HAVE_LIBZSTD
+		} else if(len >= ZSTD_HEADER_CHECK_LENGTH && ZSTD_HEADER_CHECK(data, 0)) {
+			this->typeCompress = zstd;
+		#endif //HAVE_LIBZSTD
 		} else {
 			this->typeCompress = compress_na;
 		}
@@ -753,6 +851,37 @@ bool CompressStream::decompress(char *data, u_int32_t len, u_int32_t decompress_
 		}
 		#endif //HAVE_LIBLZ4
 		break;
+	case zstd: {
+		#ifdef HAVE_LIBZSTD
+		if(!this->zstdStreamDecompress) {
+			this->initDecompress(0);
+			if(this->isError()) {
+				return(false);
+			}
+		}
+		ZSTD_inBuffer inBuffer = { data, len, 0 };
+		ZSTD_outBuffer outBuffer;
+		do {
+			outBuffer.dst = this->decompressBuffer;
+			outBuffer.size = this->decompressBufferLength;
+			outBuffer.pos = 0;
+			size_t rslt = ZSTD_decompressStream(this->zstdStreamDecompress, &outBuffer, &inBuffer);
+			if(ZSTD_isError(rslt)) {
+				this->setError(string("zstd decompress failed - ") + ZSTD_getErrorName(rslt));
+				return(false);
+			}
+			if(outBuffer.pos &&
+			   !baseEv->decompress_ev(this->decompressBuffer, outBuffer.pos)) {
+				this->setError("zstd decompress_ev failed");
+				return(false);
+			}
+		} while(inBuffer.pos < inBuffer.size || outBuffer.pos == outBuffer.size);
+		if(use_len) {
+			*use_len = inBuffer.pos;
+		}
+		#endif //HAVE_LIBZSTD
+		}
+		break;
 	case compress_auto:
 		break;
 	}
@@ -769,6 +898,7 @@ void CompressStream::createCompressBuffer() {
 	case zip:
 	case gzip:
 	case lzma:
+	case zstd:
 		if(!this->compressBufferLength) {
 			this->compressBufferLength = 8 * 1024;
 		}
@@ -822,6 +952,7 @@ void CompressStream::createDecompressBuffer(u_int32_t bufferLen) {
 	case zip:
 	case gzip:
 	case lzma:
+	case zstd:
 		if(!this->decompressBufferLength) {
 			this->decompressBufferLength = 8 * 1024;
 		}
@@ -880,6 +1011,11 @@ CompressStream::eTypeCompress CompressStream::convTypeCompress(const char *typeC
 		return(CompressStream::lz4_stream);
 	}
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	else if(!strcmp(_compress_method, "zstd")) {
+		return(CompressStream::zstd);
+	}
+	#endif //HAVE_LIBZSTD
 	return(CompressStream::compress_na);
 }
 
@@ -901,6 +1037,10 @@ const char *CompressStream::convTypeCompress(eTypeCompress typeCompress) {
 	case lz4_stream:
 		return("lz4_stream");
 	#endif //HAVE_LIBLZ4
+	#ifdef HAVE_LIBZSTD
+	case zstd:
+		return("zstd");
+	#endif //HAVE_LIBZSTD
 	default:
 		return("no");
 	}
@@ -913,6 +1053,9 @@ string CompressStream::getConfigMenuString() {
 	       << convTypeCompress(lzma) << ':' << lzma << '|'
 	       << convTypeCompress(snappy) << ':' << snappy << '|'
 	       << convTypeCompress(lzo) << ':' << lzo << '|'
+	       #ifdef HAVE_LIBZSTD
+	       << convTypeCompress(zstd) << ':' << zstd << '|'
+	       #endif //HAVE_LIBZSTD
 	       << "no:0";
 	return(outStr.str());
 }
@@ -1048,6 +1191,9 @@ void ChunkBuffer::setTypeCompress(CompressStream::eTypeCompress typeCompress, u_
 void ChunkBuffer::setZipLevel(int zipLevel) {
 	if(this->compressStream) {
 		this->compressStream->setZipLevel(zipLevel);
+		if(zipLevel != Z_DEFAULT_COMPRESSION) {
+			this->compressStream->setZstdLevel(zipLevel);
+		}
 	}
 }
 
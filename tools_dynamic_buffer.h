@@ -13,10 +13,14 @@
 #endif //HAVE_LIBLZMA
 #ifdef HAVE_LIBLZ4
 #include <lz4.h>
+#include <lz4hc.h>
 #endif //HAVE_LIBLZ4
 #ifdef HAVE_LIBLZO
 #include <lzo/lzo1x.h>
 #endif //HAVE_LIBLZO
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif //HAVE_LIBZSTD
 #include <snappy-c.h>
 
 #include "tar_data.h"
@@ -28,6 +32,8 @@ using namespace std;
 #define GZIP_HEADER_LENGTH 10
 #define GZIP_HEADER_CHECK_LENGTH 4
 #define GZIP_HEADER_CHECK(buff, offset) ((u_char)buff[offset+0] == 0x1F && (u_char)buff[offset+1] == 0x8B && (u_char)buff[offset+2] == 0x08 && (u_char)buff[offset+3] == 0x00)
+#define ZSTD_HEADER_CHECK_LENGTH 4
+#define ZSTD_HEADER_CHECK(buff, offset) ((u_char)buff[offset+0] == 0x28 && (u_char)buff[offset+1] == 0xB5 && (u_char)buff[offset+2] == 0x2F && (u_char)buff[offset+3] == 0xFD)
 
 
 class CompressStream_baseEv {
@@ -48,6 +54,7 @@ public:
 		lzo,
 		lz4,
 		lz4_stream,
+		zstd,
 		compress_auto
 	};
 	struct sChunkSizeInfo {
@@ -59,6 +66,9 @@ public:
 	virtual ~CompressStream();
 	void setZipLevel(int zipLevel);
 	void setLzmaLevel(int lzmaLevel);
+	void setZstdLevel(int zstdLevel);
+	void setZstdWorkers(int zstdWorkers);
+	void setZstdLongDistance(bool zstdLongDistance);
 	void enableAutoPrefixFile();
 	void enableForceStream();
 	void setSendParameters(int client, void *c_client);
@@ -72,7 +82,8 @@ public:
 		return(typeCompress == compress_na ||
 		       typeCompress == zip ||
 		       typeCompress == gzip ||
-		       typeCompress == lzma);
+		       typeCompress == lzma ||
+		       typeCompress == zstd);
 	}
 	void setError(const char *errorString) {
 		if(errorString && *errorString) {
@@ -130,10 +141,17 @@ private:
 	u_char *lzoWrkmemDecompress;
 	class SimpleBuffer *lzoDecompressData;
 	#endif //HAVE_LIBLZO
+	#ifdef HAVE_LIBZSTD
+	ZSTD_CCtx *zstdStream;
+	ZSTD_DCtx *zstdStreamDecompress;
+	#endif //HAVE_LIBZSTD
 	class SimpleBuffer *snappyDecompressData;
 	string errorString;
 	int zipLevel;
 	int lzmaLevel;
+	int zstdLevel;
+	int zstdWorkers;
+	bool zstdLongDistance;
 	bool autoPrefixFile;
 	bool forceStream;
 	u_int32_t processed_len;
@@ -1034,6 +1034,91 @@ int cRegExp::match(const char *subject, vector<string> *matches) {
 	return(-1);
 }
 
+cRegExpSet::cRegExpSet() {
+	combined = NULL;
+}
+
+cRegExpSet::~cRegExpSet() {
+	clear();
+}
+
+void cRegExpSet::add(const char *pattern) {
+	patterns.push_back(pattern);
+}
+
+void cRegExpSet::build() {
+	if(combined) {
+		delete combined;
+		combined = NULL;
+	}
+	for(unsigned i = 0; i < separate.size(); i++) {
+		delete separate[i];
+	}
+	separate.clear();
+	string combined_pattern;
+	unsigned combined_count = 0;
+	for(unsigned i = 0; i < patterns.size(); i++) {
+		bool backReference = false;
+		for(unsigned j = 0; j + 1 < patterns[i].length(); j++) {
+			if(patterns[i][j] == '\\') {
+				if(isdigit(patterns[i][j + 1])) {
+					backReference = true;
+					break;
+				}
+				++j;
+			}
+		}
+		if(backReference) {
+			separate.push_back(new FILE_LINE(0) cRegExp(patterns[i].c_str()));
+		} else {
+			if(combined_count) {
+				combined_pattern += "|";
+			}
+			combined_pattern += "(" + patterns[i] + ")";
+			++combined_count;
+		}
+	}
+	if(combined_count) {
+		combined = new FILE_LINE(0) cRegExp(combined_pattern.c_str());
+		if(!combined->isOK()) {
+			// some pattern is not usable in alternation - test patterns one by one
+			delete combined;
+			combined = NULL;
+			for(unsigned i = 0; i < separate.size(); i++) {
+				delete separate[i];
+			}
+			separate.clear();
+			for(unsigned i = 0; i < patterns.size(); i++) {
+				separate.push_back(new FILE_LINE(0) cRegExp(patterns[i].c_str()));
+			}
+		}
+	}
+}
+
+void cRegExpSet::clear() {
+	patterns.clear();
+	if(combined) {
+		delete combined;
+		combined = NULL;
+	}
+	for(unsigned i = 0; i < separate.size(); i++) {
+		delete separate[i];
+	}
+	separate.clear();
+}
+
+bool cRegExpSet::match(const char *subject) {
+	if(combined && combined->match(subject) > 0) {
+		return(true);
+	}
+	for(unsigned i = 0; i < separate.size(); i++) {
+		if(separate[i]->match(subject)) {
+			return(true);
+		}
+	}
+	return(false);
+}
+
 
 cGzip::cGzip() {
 	operation = _na;
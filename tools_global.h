@@ -595,6 +595,29 @@ private:
 };
 
 
+/**
+  * Set of regular expressions tested by one regexec - patterns are joined to one alternation.
+  * Patterns with back-references (group numbers would change) are kept separately.
+*/
+
+class cRegExpSet {
+public:
+	cRegExpSet();
+	~cRegExpSet();
+	void add(const char *pattern);
+	void build();
+	void clear();
+	bool match(const char *subject);
+	bool isEmpty() {
+		return(patterns.empty());
+	}
+private:
+	vector<string> patterns;
+	cRegExp *combined;
+	vector<cRegExp*> separate;
+};
+
+
 class SimpleBuffer {
 public:
 	SimpleBuffer(u_int32_t capacityReserve = 0) {
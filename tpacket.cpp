@@ -0,0 +1,409 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#endif
+
+#include "tools_global.h"
+
+#include "tpacket.h"
+
+
+using namespace std;
+
+
+#if defined(__linux__) && defined(TPACKET3_HDRLEN) && defined(PACKET_FANOUT)
+
+#define TPACKET_FRAME_SIZE	2048
+#define TPACKET_VLAN_TAG_LEN	4
+
+struct sTpacketRingBlock {
+	sTpacket *tpacket;
+	tpacket_block_desc *desc;
+	// taken by read thread and not yet returned to the kernel (pcap_block_store with zerocopy)
+	volatile int held;
+};
+
+struct sTpacket {
+	sTpacket() {
+		fd = -1;
+		ring = NULL;
+		ring_length = 0;
+		blocks = NULL;
+		blocks_count = 0;
+		block_index = 0;
+		blocks_held = 0;
+		memset(&stat, 0, sizeof(stat));
+		_sync_stat = 0;
+	}
+	sTpacketConfig config;
+	int fd;
+	u_char *ring;
+	size_t ring_length;
+	sTpacketRingBlock *blocks;
+	unsigned blocks_count;
+	unsigned block_index;
+	volatile int blocks_held;
+	struct {
+		u_int64_t packets;
+		u_int64_t drops;
+		u_int64_t freeze_q_cnt;
+	} stat;
+	volatile int _sync_stat;
+};
+
+
+bool tpacket_is_supported() {
+	return(true);
+}
+
+sTpacketHandle *create_tpacket_handle() {
+	return(new FILE_LINE(0) sTpacket);
+}
+
+void destroy_tpacket_handle(sTpacketHandle *tpacket) {
+	if(tpacket->ring) {
+		if(tpacket->blocks_held > 0) {
+			// blocks referenced by packetbuffer - the ring must stay mapped
+			syslog(LOG_NOTICE, "tpacket %s: %i ring blocks still held - ring is not unmapped",
+			       tpacket->config.device, tpacket->blocks_held);
+		} else {
+			munmap(tpacket->ring, tpacket->ring_length);
+			delete [] tpacket->blocks;
+		}
+	}
+	if(tpacket->fd >= 0) {
+		close(tpacket->fd);
+	}
+	if(!tpacket->ring || tpacket->blocks_held <= 0) {
+		delete tpacket;
+	}
+}
+
+int tpacket_activate(sTpacketConfig *config, sTpacketHandle *tpacket, std::string *error) {
+	tpacket->config = *config;
+	char errorstr[1024];
+	unsigned ifindex = if_nametoindex(config->device);
+	if(!ifindex) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: unknown interface", config->device);
+		*error = errorstr;
+		return(-1);
+	}
+	tpacket->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if(tpacket->fd < 0) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: socket failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	int version = TPACKET_V3;
+	if(setsockopt(tpacket->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: TPACKET_V3 is not supported: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	// room in front of the mac header for reinserting vlan tag stripped by the kernel
+	unsigned reserve = TPACKET_VLAN_TAG_LEN;
+	if(setsockopt(tpacket->fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: PACKET_RESERVE failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	unsigned page_size = getpagesize();
+	unsigned block_size = page_size;
+	while(block_size < config->block_size) {
+		block_size <<= 1;
+	}
+	unsigned blocks_count = config->ring_size / block_size;
+	if(blocks_count < 4) {
+		blocks_count = 4;
+	}
+	tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = block_size;
+	req.tp_block_nr = blocks_count;
+	req.tp_frame_size = TPACKET_FRAME_SIZE;
+	req.tp_frame_nr = (block_size / TPACKET_FRAME_SIZE) * blocks_count;
+	req.tp_retire_blk_tov = config->block_timeout_ms ? config->block_timeout_ms : 10;
+	req.tp_feature_req_word = 0;
+	if(setsockopt(tpacket->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: PACKET_RX_RING (%u x %u) failed: %s",
+			 config->device, blocks_count, block_size, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	tpacket->ring_length = (size_t)block_size * blocks_count;
+	void *ring = mmap(NULL, tpacket->ring_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, tpacket->fd, 0);
+	if(ring == MAP_FAILED) {
+		// MAP_LOCKED can fail because of RLIMIT_MEMLOCK
+		ring = mmap(NULL, tpacket->ring_length, PROT_READ | PROT_WRITE, MAP_SHARED, tpacket->fd, 0);
+	}
+	if(ring == MAP_FAILED) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: mmap failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	tpacket->ring = (u_char*)ring;
+	tpacket->blocks_count = blocks_count;
+	tpacket->blocks = new FILE_LINE(0) sTpacketRingBlock[blocks_count];
+	for(unsigned i = 0; i < blocks_count; i++) {
+		tpacket->blocks[i].tpacket = tpacket;
+		tpacket->blocks[i].desc = (tpacket_block_desc*)(tpacket->ring + (size_t)i * block_size);
+		tpacket->blocks[i].held = 0;
+	}
+	sockaddr_ll addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ETH_P_ALL);
+	addr.sll_ifindex = ifindex;
+	if(bind(tpacket->fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: bind failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	if(config->promisc) {
+		packet_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = ifindex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		if(setsockopt(tpacket->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+			syslog(LOG_NOTICE, "tpacket %s: set promiscuous mode failed: %s", config->device, strerror(errno));
+		}
+	}
+	if(config->fanout_mode != _tpacket_fanout_na) {
+		unsigned fanout_type = config->fanout_mode == _tpacket_fanout_cpu ? PACKET_FANOUT_CPU :
+				       config->fanout_mode == _tpacket_fanout_lb ? PACKET_FANOUT_LB :
+				       // fragments are defragmented before hashing so that all of them get to the same socket
+				       PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+		unsigned fanout_arg = config->fanout_group_id | (fanout_type << 16);
+		if(setsockopt(tpacket->fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof(fanout_arg)) < 0) {
+			snprintf(errorstr, sizeof(errorstr), "tpacket %s: PACKET_FANOUT (group %u) failed: %s",
+				 config->device, config->fanout_group_id, strerror(errno));
+			*error = errorstr;
+			return(-1);
+		}
+	}
+	syslog(LOG_NOTICE, "tpacket %s: ring %u x %u kB%s%s",
+	       config->device, blocks_count, block_size / 1024,
+	       config->fanout_mode != _tpacket_fanout_na ? ", fanout group " : "",
+	       config->fanout_mode != _tpacket_fanout_na ? intToString(config->fanout_group_id).c_str() : "");
+	return(0);
+}
+
+int tpacket_setfilter(sTpacketHandle *tpacket, bpf_program *filter, std::string *error) {
+	sock_fprog fprog;
+	fprog.len = filter->bf_len;
+	fprog.filter = (sock_filter*)filter->bf_insns;
+	if(setsockopt(tpacket->fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+		char errorstr[1024];
+		snprintf(errorstr, sizeof(errorstr), "tpacket %s: SO_ATTACH_FILTER failed: %s", tpacket->config.device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	return(0);
+}
+
+bool tpacket_read_block(sTpacketHandle *tpacket, sTpacketBlock *block, int timeout_ms) {
+	sTpacketRingBlock *ring_block = &tpacket->blocks[tpacket->block_index];
+	if(ring_block->held) {
+		// reader wrapped round the ring to a block still referenced by pcap_block_store - status stays TP_STATUS_USER
+		// until it is released, it is not a new block
+		USLEEP(timeout_ms > 0 ? min(timeout_ms * 1000, 1000) : 100);
+		return(false);
+	}
+	if(!(ring_block->desc->hdr.bh1.block_status & TP_STATUS_USER)) {
+		pollfd pfd;
+		pfd.fd = tpacket->fd;
+		pfd.events = POLLIN | POLLERR;
+		pfd.revents = 0;
+		poll(&pfd, 1, timeout_ms);
+		if(!(ring_block->desc->hdr.bh1.block_status & TP_STATUS_USER)) {
+			return(false);
+		}
+	}
+	__sync_synchronize();
+	tpacket->block_index = (tpacket->block_index + 1) % tpacket->blocks_count;
+	ring_block->held = 1;
+	__sync_add_and_fetch(&tpacket->blocks_held, 1);
+	block->tpacket = tpacket;
+	block->ring_block = ring_block;
+	block->packets_count = ring_block->desc->hdr.bh1.num_pkts;
+	block->packets_index = 0;
+	block->packet_hdr = (u_char*)ring_block->desc + ring_block->desc->hdr.bh1.offset_to_first_pkt;
+	return(true);
+}
+
+bool tpacket_block_next_packet(sTpacketBlock *block, pcap_pkthdr *header, u_char **packet) {
+	if(block->packets_index >= block->packets_count) {
+		return(false);
+	}
+	tpacket3_hdr *hdr = (tpacket3_hdr*)block->packet_hdr;
+	block->packet_hdr += hdr->tp_next_offset;
+	++block->packets_index;
+	u_char *data = (u_char*)hdr + hdr->tp_mac;
+	u_int32_t caplen = hdr->tp_snaplen;
+	u_int32_t len = hdr->tp_len;
+	if((hdr->hv1.tp_vlan_tci || (hdr->tp_status & TP_STATUS_VLAN_VALID)) &&
+	   caplen >= ETH_ALEN * 2) {
+		// vlan tag was stripped by the kernel / nic - put it back as libpcap does
+		data -= TPACKET_VLAN_TAG_LEN;
+		memmove(data, data + TPACKET_VLAN_TAG_LEN, ETH_ALEN * 2);
+		u_int16_t tpid =
+			#ifdef TP_STATUS_VLAN_TPID_VALID
+			hdr->tp_status & TP_STATUS_VLAN_TPID_VALID ? hdr->hv1.tp_vlan_tpid :
+			#endif
+			ETH_P_8021Q;
+		*(u_int16_t*)(data + ETH_ALEN * 2) = htons(tpid);
+		*(u_int16_t*)(data + ETH_ALEN * 2 + 2) = htons(hdr->hv1.tp_vlan_tci);
+		caplen += TPACKET_VLAN_TAG_LEN;
+		len += TPACKET_VLAN_TAG_LEN;
+	}
+	sTpacketConfig *config = &block->tpacket->config;
+	if(config->snaplen > 0 && caplen > (u_int32_t)config->snaplen) {
+		caplen = config->snaplen;
+	}
+	header->ts.tv_sec = hdr->tp_sec;
+	header->ts.tv_usec = hdr->tp_nsec / 1000;
+	header->caplen = caplen;
+	header->len = len;
+	*packet = data;
+	return(true);
+}
+
+void tpacket_release_block(sTpacketBlock *block) {
+	tpacket_ring_block_release(block->ring_block);
+	block->ring_block = NULL;
+}
+
+void tpacket_ring_block_release(void *ring_block) {
+	sTpacketRingBlock *_ring_block = (sTpacketRingBlock*)ring_block;
+	// exactly once - second release would return block which kernel / another store already uses
+	if(!__sync_bool_compare_and_swap(&_ring_block->held, 1, 2)) {
+		return;
+	}
+	__sync_synchronize();
+	_ring_block->desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	__sync_synchronize();
+	// held cleared after status - reader must not see free block with stale TP_STATUS_USER
+	_ring_block->held = 0;
+	__sync_sub_and_fetch(&_ring_block->tpacket->blocks_held, 1);
+}
+
+bool tpacket_zerocopy_enable(sTpacketHandle *tpacket) {
+	// keep part of the ring free for the kernel - when packetbuffer holds too many blocks packets are copied
+	return(tpacket->config.zerocopy &&
+	       (unsigned)tpacket->blocks_held * 100 < tpacket->blocks_count * tpacket->config.zerocopy_max_held_perc);
+}
+
+int pcap_tpacket_stats(sTpacketHandle *tpacket, pcap_stat *ps, std::string *str_out) {
+	tpacket_stats_v3 kstats;
+	socklen_t kstats_len = sizeof(kstats);
+	memset(&kstats, 0, sizeof(kstats));
+	if(getsockopt(tpacket->fd, SOL_PACKET, PACKET_STATISTICS, &kstats, &kstats_len) < 0) {
+		return(-1);
+	}
+	// kernel resets counters on each read
+	while(__sync_lock_test_and_set(&tpacket->_sync_stat, 1));
+	tpacket->stat.packets += kstats.tp_packets;
+	tpacket->stat.drops += kstats.tp_drops;
+	tpacket->stat.freeze_q_cnt += kstats.tp_freeze_q_cnt;
+	if(ps) {
+		ps->ps_recv = tpacket->stat.packets;
+		ps->ps_drop = tpacket->stat.drops;
+		ps->ps_ifdrop = 0;
+	}
+	if(str_out) {
+		ostringstream outStr;
+		outStr << "TPACKET "
+		       << tpacket->config.device
+		       << " [packets: " << tpacket->stat.packets
+		       << "; drops: " << tpacket->stat.drops
+		       << "; freeze: " << tpacket->stat.freeze_q_cnt
+		       << "; held blocks: " << tpacket->blocks_held << "/" << tpacket->blocks_count
+		       << "]";
+		*str_out = outStr.str();
+	}
+	__sync_lock_release(&tpacket->_sync_stat);
+	return(0);
+}
+
+sTpacketConfig *tpacket_config(sTpacketHandle *tpacket) {
+	return(&tpacket->config);
+}
+
+u_int16_t tpacket_fanout_group_id(const char *device) {
+	return((if_nametoindex(device) ^ getpid()) & 0xFFFF);
+}
+
+
+#else
+
+
+struct sTpacket {
+	sTpacketConfig config;
+};
+
+bool tpacket_is_supported() {
+	return(false);
+}
+
+sTpacketHandle *create_tpacket_handle() {
+	return(NULL);
+}
+
+void destroy_tpacket_handle(sTpacketHandle */*tpacket*/) {
+}
+
+int tpacket_activate(sTpacketConfig */*config*/, sTpacketHandle */*tpacket*/, std::string *error) {
+	*error = "not supported";
+	return(-1);
+}
+
+int tpacket_setfilter(sTpacketHandle */*tpacket*/, bpf_program */*filter*/, std::string *error) {
+	*error = "not supported";
+	return(-1);
+}
+
+bool tpacket_read_block(sTpacketHandle */*tpacket*/, sTpacketBlock */*block*/, int /*timeout_ms*/) {
+	return(false);
+}
+
+bool tpacket_block_next_packet(sTpacketBlock */*block*/, pcap_pkthdr */*header*/, u_char **/*packet*/) {
+	return(false);
+}
+
+void tpacket_release_block(sTpacketBlock */*block*/) {
+}
+
+void tpacket_ring_block_release(void */*ring_block*/) {
+}
+
+bool tpacket_zerocopy_enable(sTpacketHandle */*tpacket*/) {
+	return(false);
+}
+
+int pcap_tpacket_stats(sTpacketHandle */*tpacket*/, pcap_stat */*ps*/, std::string */*str_out*/) {
+	return(-1);
+}
+
+sTpacketConfig *tpacket_config(sTpacketHandle *tpacket) {
+	return(&tpacket->config);
+}
+
+u_int16_t tpacket_fanout_group_id(const char */*device*/) {
+	return(0);
+}
+
+
+#endif
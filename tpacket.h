@@ -0,0 +1,68 @@
+#ifndef TPACKET_H
+#define TPACKET_H
+
+
+#include <pcap.h>
+#include <string>
+#include <string.h>
+#include <sys/types.h>
+
+
+/**
+  * Native AF_PACKET TPACKET_V3 capture (alternative to libpcap for packetbuffer read threads).
+  * The kernel fills whole blocks of the mmaped ring, the read thread takes a block, walks its packets
+  * and either references them directly from pcap_block_store (zerocopy - the ring block is returned
+  * to the kernel in pcap_block_store::destroy) or copies them and returns the block at once.
+  * With PACKET_FANOUT several read threads (each with its own socket and ring) share one interface.
+*/
+
+enum eTpacketFanoutMode {
+	_tpacket_fanout_na = 0,
+	_tpacket_fanout_hash = 1,
+	_tpacket_fanout_cpu = 2,
+	_tpacket_fanout_lb = 3
+};
+
+struct sTpacketConfig {
+	char device[100];
+	int snaplen;
+	int promisc;
+	unsigned ring_size;
+	unsigned block_size;
+	unsigned block_timeout_ms;
+	eTpacketFanoutMode fanout_mode;
+	u_int16_t fanout_group_id;
+	bool zerocopy;
+	unsigned zerocopy_max_held_perc;
+	sTpacketConfig() {
+		memset(this, 0, sizeof(*this));
+	}
+};
+
+typedef struct sTpacket sTpacketHandle;
+
+struct sTpacketBlock {
+	sTpacketHandle *tpacket;
+	void *ring_block;
+	u_int32_t packets_count;
+	u_int32_t packets_index;
+	u_char *packet_hdr;
+};
+
+
+bool tpacket_is_supported();
+sTpacketHandle *create_tpacket_handle();
+void destroy_tpacket_handle(sTpacketHandle *tpacket);
+int tpacket_activate(sTpacketConfig *config, sTpacketHandle *tpacket, std::string *error);
+int tpacket_setfilter(sTpacketHandle *tpacket, bpf_program *filter, std::string *error);
+bool tpacket_read_block(sTpacketHandle *tpacket, sTpacketBlock *block, int timeout_ms);
+bool tpacket_block_next_packet(sTpacketBlock *block, pcap_pkthdr *header, u_char **packet);
+void tpacket_release_block(sTpacketBlock *block);
+void tpacket_ring_block_release(void *ring_block);
+bool tpacket_zerocopy_enable(sTpacketHandle *tpacket);
+int pcap_tpacket_stats(sTpacketHandle *tpacket, pcap_stat *ps, std::string *str_out = NULL);
+sTpacketConfig *tpacket_config(sTpacketHandle *tpacket);
+u_int16_t tpacket_fanout_group_id(const char *device);
+
+
+#endif //TPACKET_H
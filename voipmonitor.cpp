@@ -74,6 +74,7 @@
 #include "ssldata.h"
 #include "sip_tcp_data.h"
 #include "ip_frag.h"
+#include "dedup.h"
 #include "cleanspool.h"
 #include "regcache.h"
 #include "fraud.h"
@@ -99,6 +100,7 @@
 #include "ipfix.h"
 #include "hep.h"
 #include "separate_processing.h"
+#include "replay_benchmark.h"
 
 #if HAVE_LIBTCMALLOC_HEAPPROF
 #include <gperftools/heap-profiler.h>
@@ -289,6 +291,7 @@ int opt_audio_format = FORMAT_WAV;	// define format for audio writing (if -W opt
 int opt_manager_port = 5029;	// manager api TCP port
 char opt_manager_ip[32] = "127.0.0.1";	// manager api listen IP address
 int opt_manager_nonblock_mode = 0;
+unsigned int opt_listcalls_delta_refresh_ms = 1000;
 int opt_rtpsave_threaded = 1;
 int opt_norecord_header = 0;	// if = 1 SIP call with X-VoipMonitor-norecord header will be not saved although global configuration says to record. 
 int opt_rtpnosip = 0;		// if = 1 RTP stream will be saved into calls regardless on SIP signalizatoin (handy if you need extract RTP without SIP)
@@ -306,6 +309,8 @@ volatile int readend = 0;
 int opt_dup_check = 0;
 int opt_dup_check_ipheader = 1;
 int opt_dup_check_ipheader_ignore_ttl = 1;
+int opt_dup_check_hash = _dedup_hash_md5;
+int opt_dup_check_time_window_ms = 1000;
 int opt_fax_dup_seq_check = 0;
 int opt_fax_create_udptl_streams = 0;
 int rtptimeout = 300;
@@ -317,6 +322,7 @@ bool opt_get_reason_from_bye_cancel = true;
 bool opt_cleanspool = true;
 bool opt_cleanspool_use_files = true;
 bool opt_cleanspool_use_files_set = false;
+bool opt_cleanspool_index = false;
 int opt_cleanspool_interval = 0; // number of seconds between cleaning spool directory. 0 = disabled
 int opt_cleanspool_sizeMB = 0; // number of MB to keep in spooldir
 int opt_domainport = 0;
@@ -357,6 +363,8 @@ char opt_keycheck[1024] = "";
 bool opt_cdr_stat_values = true;
 bool opt_cdr_stat_sources = false;
 int opt_cdr_stat_interval = 15;
+int opt_charts_percentile = 0;
+double opt_charts_percentile_sketch_accuracy = 1;
 bool opt_charts_cache = false;
 int opt_charts_cache_max_threads = 3;
 bool opt_charts_cache_store = false;
@@ -416,6 +424,7 @@ unsigned int opt_process_rtp_packets_qring_item_length = 0;
 unsigned int opt_process_rtp_packets_qring_usleep = 10;
 unsigned int opt_process_rtp_packets_qring_push_usleep = 10;
 bool opt_process_rtp_packets_qring_force_push = true;
+unsigned int opt_packet_latency_sample = 10;
 int opt_cleanup_calls_period = 10;
 int opt_destroy_calls_period = 2;
 int opt_safe_cleanup_calls = 1;
@@ -432,6 +441,7 @@ bool opt_http_cleanup_ext = false;
 int opt_enable_webrtc = 0;
 int opt_enable_ssl = 0;
 unsigned int opt_ssl_link_timeout = 5 * 60;
+int opt_ssl_tcp_reassembly_threads = 1;
 bool opt_ssl_ignore_tcp_handshake = true;
 bool opt_ssl_log_errors = false;
 bool opt_ssl_ignore_error_invalid_mac = false;
@@ -469,6 +479,7 @@ int opt_mysql_max_multiple_rows_insert = 20;
 int opt_mysql_enable_new_store = 0;
 bool opt_mysql_enable_set_id = false;
 bool opt_csv_store_format = false;
+bool opt_mysql_load_data = false;
 bool opt_mysql_mysql_redirect_cdr_queue = false;
 int opt_cdr_sip_response_number_max_length = 0;
 vector<string> opt_cdr_sip_response_reg_remove;
@@ -590,7 +601,7 @@ int opt_pcap_dump_asyncwrite_maxsize = 100; //MB
 int opt_pcap_dump_tar = 1;
 bool opt_pcap_dump_tar_use_hash_instead_of_long_callid = 1;
 int opt_pcap_dump_tar_threads = 8;
-int opt_pcap_dump_tar_compress_sip = 1; //0 off, 1 gzip, 2 lzma
+int opt_pcap_dump_tar_compress_sip = 1; //0 off, 1 gzip, 2 lzma, 3 zstd
 int opt_pcap_dump_tar_sip_level = 6;
 int opt_pcap_dump_tar_sip_use_pos = 0;
 int opt_pcap_dump_tar_compress_rtp = 0;
@@ -599,6 +610,9 @@ int opt_pcap_dump_tar_rtp_use_pos = 0;
 int opt_pcap_dump_tar_compress_graph = 0;
 int opt_pcap_dump_tar_graph_level = 1;
 int opt_pcap_dump_tar_graph_use_pos = 0;
+bool opt_pcap_dump_tar_seekable = false;
+int opt_pcap_dump_tar_zstd_workers = 0;
+bool opt_zstd_long_rtp = false;
 CompressStream::eTypeCompress opt_pcap_dump_tar_internalcompress_sip = CompressStream::compress_na;
 CompressStream::eTypeCompress opt_pcap_dump_tar_internalcompress_rtp = CompressStream::compress_na;
 CompressStream::eTypeCompress opt_pcap_dump_tar_internalcompress_graph = CompressStream::compress_na;
@@ -663,6 +677,11 @@ extern uint64_t opt_pcap_queue_bypass_max_size;
 extern int opt_pcap_queue_compress;
 extern pcap_block_store::compress_method opt_pcap_queue_compress_method;
 extern int opt_pcap_queue_compress_ratio;
+extern int opt_pcap_queue_compress_level;
+extern string opt_pcap_queue_compress_zstd_dictionary;
+extern int opt_pcap_queue_file_io;
+extern int opt_pcap_queue_file_io_threads;
+extern u_int64_t opt_pcap_queue_file_readahead;
 extern string opt_pcap_queue_disk_folder;
 extern ip_port opt_pcap_queue_send_to_ip_port;
 extern ip_port opt_pcap_queue_receive_from_ip_port;
@@ -786,6 +805,8 @@ char odbc_dsn[256] = "voipmonitor";
 char odbc_user[256];
 char odbc_password[256];
 char odbc_driver[256];
+bool opt_odbc_array_insert = false;
+int opt_odbc_array_insert_size = 1000;
 
 int opt_cloud_activecheck_period = 60;				//0 = disable, how often to check if cloud tunnel is passable in [sec.]
 int cloud_activecheck_timeout = 5;				//2sec by default, how long to wait for response until restart of a cloud tunnel
@@ -887,6 +908,18 @@ string opt_dpdk_worker2_thread_lcore;
 int opt_dpdk_memory_channels = 4;
 string opt_dpdk_pci_device;
 int opt_dpdk_force_max_simd_bitwidth = 0;
+bool opt_use_tpacket = false;
+int opt_tpacket_block_size = 1024;
+int opt_tpacket_block_timeout = 10;
+int opt_tpacket_fanout = 0;
+int opt_tpacket_fanout_threads = 1;
+bool opt_tpacket_zerocopy = true;
+bool opt_use_xdp = false;
+int opt_xdp_queues = 0;
+int opt_xdp_attach_mode = 0;
+int opt_xdp_bind_mode = 0;
+int opt_xdp_frame_size = 4096;
+bool opt_xdp_frames_in_packetbuffer = true;
 string opt_cpu_cores;
 
 char opt_scanpcapdir[2048] = "";	// Specifies the name of the network device to use for 
@@ -2151,6 +2184,9 @@ void *storing_cdr( void */*dummy*/ ) {
 					}
 					++counter;
 				}
+				if(!opt_nocdr) {
+					Call::flushSaveToDbArrayInsert();
+				}
 				if(useConvertToWav) {
 					calltable->lock_calls_audioqueue();
 				}
@@ -2300,6 +2336,9 @@ void *storing_cdr_next_thread( void *_indexNextThread ) {
 			}
 			++counter;
 		}
+		if(!opt_nocdr) {
+			Call::flushSaveToDbArrayInsert();
+		}
 		if(useConvertToWav) {
 			calltable->lock_calls_audioqueue();
 		}
@@ -4587,6 +4626,12 @@ int main_init_read() {
 			tcpReassemblySsl->setEnableWildLink();
 			tcpReassemblySsl->setIgnoreTcpHandshake();
 		}
+		if(opt_ssl_tcp_reassembly_threads > 1) {
+			if(opt_enable_ssl == 10) {
+				syslog(LOG_NOTICE, "ssl_tcp_reassembly_threads is ignored with gnutls ssl decoder - single thread is used");
+			}
+			tcpReassemblySsl->setShards(opt_ssl_tcp_reassembly_threads);
+		}
 	}
 	if(opt_sip_tcp_reassembly_ext) {
 		tcpReassemblySipExt = new FILE_LINE(42031) TcpReassembly(TcpReassembly::sip);
@@ -4661,6 +4706,8 @@ int main_init_read() {
 		}
 	}
 	#endif
+	
+	dedup_hash_init();
 
 	if(is_enable_packetbuffer()) {
 		PcapQueue_init();
@@ -5185,6 +5232,12 @@ void main_term_read() {
 	rtp_stat.flush();
 	
 	pthread_mutex_destroy(&mysqlconnect_lock);
+	extern cSqlDbArrayInsert *sqlDbSaveCallArrayInsert;
+	if(sqlDbSaveCallArrayInsert) {
+		sqlDbSaveCallArrayInsert->flush();
+		delete sqlDbSaveCallArrayInsert;
+		sqlDbSaveCallArrayInsert = NULL;
+	}
 	extern SqlDb *sqlDbSaveCall;
 	if(sqlDbSaveCall) {
 		delete sqlDbSaveCall;
@@ -6999,6 +7052,7 @@ void cConfig::addConfigItems() {
 					expert();
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("mysql_enable_set_id", &opt_mysql_enable_set_id));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("csv_store_format", &opt_csv_store_format));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("mysql_load_data", &opt_mysql_load_data));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("mysql_redirect_cdr_queue", &opt_mysql_mysql_redirect_cdr_queue));
 		subgroup("cleaning");
 			addConfigItem(new FILE_LINE(42116) cConfigItem_integer("cleandatabase"));
@@ -7107,6 +7161,28 @@ void cConfig::addConfigItems() {
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("dpdk_memory_channels", &opt_dpdk_memory_channels));
 					addConfigItem(new FILE_LINE(0) cConfigItem_string("dpdk_pci_device", &opt_dpdk_pci_device));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("dpdk_force_max_simd_bitwidth", &opt_dpdk_force_max_simd_bitwidth));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("tpacket", &opt_use_tpacket));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("tpacket_block_size", &opt_tpacket_block_size));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("tpacket_block_timeout", &opt_tpacket_block_timeout));
+					addConfigItem((new FILE_LINE(0) cConfigItem_yesno("tpacket_fanout", &opt_tpacket_fanout))
+						->disableYes()
+						->addValues("hash:1|cpu:2|lb:3"));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("tpacket_fanout_threads", &opt_tpacket_fanout_threads));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("tpacket_zerocopy", &opt_tpacket_zerocopy));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("xdp", &opt_use_xdp));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("xdp_queues", &opt_xdp_queues));
+					addConfigItem((new FILE_LINE(0) cConfigItem_yesno("xdp_attach_mode", &opt_xdp_attach_mode))
+						->disableYes()
+						->disableNo()
+						->addValues("auto:0|skb:1|generic:1|drv:2|native:2")
+						->setDefaultValueStr("auto"));
+					addConfigItem((new FILE_LINE(0) cConfigItem_yesno("xdp_bind_mode", &opt_xdp_bind_mode))
+						->disableYes()
+						->disableNo()
+						->addValues("auto:0|copy:1|zerocopy:2")
+						->setDefaultValueStr("auto"));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("xdp_frame_size", &opt_xdp_frame_size));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("xdp_frames_in_packetbuffer", &opt_xdp_frames_in_packetbuffer));
 					addConfigItem(new FILE_LINE(0) cConfigItem_string("thread_affinity", &opt_cpu_cores));
 			normal();
 			addConfigItem(new FILE_LINE(42135) cConfigItem_yesno("promisc", &opt_promisc));
@@ -7188,6 +7264,7 @@ void cConfig::addConfigItems() {
 					addConfigItem(new FILE_LINE(42160) cConfigItem_integer("process_rtp_packets_qring_usleep", &opt_process_rtp_packets_qring_usleep));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("process_rtp_packets_qring_push_usleep", &opt_process_rtp_packets_qring_push_usleep));
 					addConfigItem(new FILE_LINE(42161) cConfigItem_yesno("process_rtp_packets_qring_force_push", &opt_process_rtp_packets_qring_force_push));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("packet_latency_sample", &opt_packet_latency_sample));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("cleanup_calls_period", &opt_cleanup_calls_period));
 					addConfigItem(new FILE_LINE(0) cConfigItem_integer("destroy_calls_period", &opt_destroy_calls_period));
 					addConfigItem((new FILE_LINE(0) cConfigItem_yesno("safe_cleanup_calls", &opt_safe_cleanup_calls))
@@ -7197,6 +7274,7 @@ void cConfig::addConfigItems() {
 	group("manager");
 		addConfigItem(new FILE_LINE(42162) cConfigItem_string("managerip", opt_manager_ip, sizeof(opt_manager_ip)));
 		addConfigItem(new FILE_LINE(42163) cConfigItem_integer("managerport", &opt_manager_port));
+		addConfigItem(new FILE_LINE(0) cConfigItem_integer("listcalls_delta_refresh", &opt_listcalls_delta_refresh_ms));
 	group("buffers and memory usage");
 		subgroup("main");
 			addConfigItem((new FILE_LINE(42164) cConfigItem_integer("max_buffer_mem"))
@@ -7233,6 +7311,14 @@ void cConfig::addConfigItems() {
 					addConfigItem((new FILE_LINE(42178) cConfigItem_integer("packetbuffer_file_totalmaxsize", &opt_pcap_queue_store_queue_max_disk_size))
 						->setMultiple(1024 * 1024));
 					addConfigItem(new FILE_LINE(42179) cConfigItem_string("packetbuffer_file_path", &opt_pcap_queue_disk_folder));
+					addConfigItem((new FILE_LINE(0) cConfigItem_yesno("packetbuffer_file_io", &opt_pcap_queue_file_io))
+						->disableYes()
+						->disableNo()
+						->addValues("buffered:0|direct:1|uring:2|io_uring:2")
+						->setDefaultValueStr("buffered"));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("packetbuffer_file_io_threads", &opt_pcap_queue_file_io_threads));
+					addConfigItem((new FILE_LINE(0) cConfigItem_integer("packetbuffer_file_readahead", &opt_pcap_queue_file_readahead))
+						->setMultiple(1024 * 1024));
 	group("data storing");
 		setDisableIfBegin("sniffer_mode=" + snifferMode_sender_str);
 		subgroup("main");
@@ -7258,12 +7344,15 @@ void cConfig::addConfigItems() {
 				addConfigItem(new FILE_LINE(0) cConfigItem_string("tar_move_destination_path", &opt_tar_move_destination_path));
 				addConfigItem(new FILE_LINE(0) cConfigItem_string("tar_move_source_trim_path", &opt_tar_move_source_trim_path));
 				addConfigItem(new FILE_LINE(0) cConfigItem_integer("tar_move_max_threads", &opt_tar_move_max_threads));
+				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("tar_seekable", &opt_pcap_dump_tar_seekable));
 					expert();
 					addConfigItem(new FILE_LINE(42191) cConfigItem_yesno("convert_dlt_sll2en10", &opt_convert_dlt_sll_to_en10));
 					addConfigItem(new FILE_LINE(42192) cConfigItem_yesno("dumpallpackets", &opt_pcapdump));
 					addConfigItem(new FILE_LINE(42195) cConfigItem_string("bogus_dumper_path", opt_bogus_dumper_path, sizeof(opt_bogus_dumper_path)));
 		subgroup("scaling");
 			addConfigItem(new FILE_LINE(42196) cConfigItem_integer("tar_maxthreads", &opt_pcap_dump_tar_threads));
+			addConfigItem((new FILE_LINE(0) cConfigItem_integer("tar_zstd_workers", &opt_pcap_dump_tar_zstd_workers))
+				->addValues("auto:-1"));
 				advanced();
 				addConfigItem(new FILE_LINE(42197) cConfigItem_integer("maxpcapsize", &opt_maxpcapsize_mb));
 					expert();
@@ -7283,7 +7372,7 @@ void cConfig::addConfigItems() {
 					addConfigItem(new FILE_LINE(42203) cConfigItem_type_compress("pcap_dump_zip_sip", &opt_pcap_dump_zip_sip));
 					addConfigItem(new FILE_LINE(42204) cConfigItem_integer("pcap_dump_ziplevel_sip", &opt_pcap_dump_ziplevel_sip));
 					addConfigItem((new FILE_LINE(42205) cConfigItem_yesno("tar_compress_sip", &opt_pcap_dump_tar_compress_sip))
-						->addValues("zip:1|z:1|gzip:1|g:1|lz4:2|l:2|no:0|n:0|0:0"));
+						->addValues("zstd:3|zip:1|z:1|gzip:1|g:1|lz4:2|l:2|no:0|n:0|0:0"));
 					addConfigItem(new FILE_LINE(42206) cConfigItem_integer("tar_sip_level", &opt_pcap_dump_tar_sip_level));
 					addConfigItem(new FILE_LINE(42207) cConfigItem_type_compress("tar_internalcompress_sip", &opt_pcap_dump_tar_internalcompress_sip));
 					addConfigItem(new FILE_LINE(42208) cConfigItem_integer("tar_internal_sip_level", &opt_pcap_dump_tar_internal_gzip_sip_level));
@@ -7313,8 +7402,9 @@ void cConfig::addConfigItems() {
 					addConfigItem(new FILE_LINE(42212) cConfigItem_type_compress("pcap_dump_zip_rtp", &opt_pcap_dump_zip_rtp));
 					addConfigItem(new FILE_LINE(42213) cConfigItem_integer("pcap_dump_ziplevel_rtp", &opt_pcap_dump_ziplevel_rtp));
 					addConfigItem((new FILE_LINE(42214) cConfigItem_yesno("tar_compress_rtp", &opt_pcap_dump_tar_compress_rtp))
-						->addValues("zip:1|z:1|gzip:1|g:1|lz4:2|l:2|no:0|n:0|0:0"));
+						->addValues("zstd:3|zip:1|z:1|gzip:1|g:1|lz4:2|l:2|no:0|n:0|0:0"));
 					addConfigItem(new FILE_LINE(42215) cConfigItem_integer("tar_rtp_level", &opt_pcap_dump_tar_rtp_level));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("zstd_long_rtp", &opt_zstd_long_rtp));
 					addConfigItem(new FILE_LINE(42216) cConfigItem_type_compress("tar_internalcompress_rtp", &opt_pcap_dump_tar_internalcompress_rtp));
 					addConfigItem(new FILE_LINE(42217) cConfigItem_integer("tar_internal_rtp_level", &opt_pcap_dump_tar_internal_gzip_rtp_level));
 		subgroup("GRAPH");
@@ -7325,7 +7415,7 @@ void cConfig::addConfigItems() {
 					addConfigItem(new FILE_LINE(42219) cConfigItem_type_compress("pcap_dump_zip_graph", &opt_gzipGRAPH));
 					addConfigItem(new FILE_LINE(42220) cConfigItem_integer("pcap_dump_ziplevel_graph", &opt_pcap_dump_ziplevel_graph));
 					addConfigItem((new FILE_LINE(42221) cConfigItem_yesno("tar_compress_graph", &opt_pcap_dump_tar_compress_graph))
-						->addValues("zip:1|z:1|gzip:1|g:1|lz4:2|l:2|no:0|n:0|0:0"));
+						->addValues("zstd:3|zip:1|z:1|gzip:1|g:1|lz4:2|l:2|no:0|n:0|0:0"));
 					addConfigItem(new FILE_LINE(42222) cConfigItem_integer("tar_graph_level", &opt_pcap_dump_tar_graph_level));
 					addConfigItem(new FILE_LINE(42223) cConfigItem_type_compress("tar_internalcompress_graph", &opt_pcap_dump_tar_internalcompress_graph));
 					addConfigItem(new FILE_LINE(42224) cConfigItem_integer("tar_internal_graph_level", &opt_pcap_dump_tar_internal_gzip_graph_level));
@@ -7356,6 +7446,7 @@ void cConfig::addConfigItems() {
 		addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanspool", &opt_cleanspool));
 			advanced();
 			addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanspool_use_files", &opt_cleanspool_use_files));
+			addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cleanspool_index", &opt_cleanspool_index));
 			addConfigItem(new FILE_LINE(42231) cConfigItem_integer("cleanspool_interval", &opt_cleanspool_interval));
 		normal();
 		addConfigItem(new FILE_LINE(42232) cConfigItem_hour_interval("cleanspool_enable_fromto", &opt_cleanspool_enable_run_hour_from, &opt_cleanspool_enable_run_hour_to));
@@ -7384,6 +7475,12 @@ void cConfig::addConfigItems() {
 		addConfigItem(new FILE_LINE(42249) cConfigItem_yesno("dscp", &opt_dscp));
 				expert();
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("deduplicate_ipheader_ignore_ttl", &opt_dup_check_ipheader_ignore_ttl));
+				addConfigItem((new FILE_LINE(0) cConfigItem_yesno("deduplicate_hash", &opt_dup_check_hash))
+					->disableYes()
+					->disableNo()
+					->addValues("md5:1|crc32c:2|crc:2|xxh64:3|xxhash:3|murmur3:4|murmur:4")
+					->setDefaultValueStr("md5"));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("deduplicate_time_window_ms", &opt_dup_check_time_window_ms));
 				addConfigItem(new FILE_LINE(42250) cConfigItem_string("tcpreassembly_http_log", opt_tcpreassembly_http_log, sizeof(opt_tcpreassembly_http_log)));
 				addConfigItem(new FILE_LINE(42251) cConfigItem_string("tcpreassembly_webrtc_log", opt_tcpreassembly_webrtc_log, sizeof(opt_tcpreassembly_webrtc_log)));
 				addConfigItem(new FILE_LINE(42252) cConfigItem_string("tcpreassembly_ssl_log", opt_tcpreassembly_ssl_log, sizeof(opt_tcpreassembly_ssl_log)));
@@ -7394,6 +7491,7 @@ void cConfig::addConfigItems() {
 			->addValues("old:10|only:2"));
 		addConfigItem(new FILE_LINE(42255) cConfigItem_ip_port_str_map("ssl_ipport", &ssl_ipport));
 		addConfigItem(new FILE_LINE(42256) cConfigItem_integer("ssl_link_timeout", &opt_ssl_link_timeout));
+		addConfigItem(new FILE_LINE(0) cConfigItem_integer("ssl_tcp_reassembly_threads", &opt_ssl_tcp_reassembly_threads));
 			advanced();
 			addConfigItem(new FILE_LINE(0) cConfigItem_yesno("ssl_sessionkey_udp", &ssl_client_random_enable));
 			addConfigItem(new FILE_LINE(0) cConfigItem_ports("ssl_sessionkey_udp_port", ssl_client_random_portmatrix));
@@ -7777,6 +7875,8 @@ void cConfig::addConfigItems() {
 					addConfigItem(new FILE_LINE(42402) cConfigItem_string("odbcuser", odbc_user, sizeof(odbc_user)));
 					addConfigItem(new FILE_LINE(42403) cConfigItem_string("odbcpass", odbc_password, sizeof(odbc_password)));
 					addConfigItem(new FILE_LINE(42404) cConfigItem_string("odbcdriver", odbc_driver, sizeof(odbc_driver)));
+					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("odbc_array_insert", &opt_odbc_array_insert));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("odbc_array_insert_size", &opt_odbc_array_insert_size));
 					addConfigItem(new FILE_LINE(42405) cConfigItem_yesno("cdr_partition", &opt_cdr_partition));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cdr_partition_by_hours", &opt_cdr_partition_by_hours));
 					addConfigItem(new FILE_LINE(0) cConfigItem_yesno("cdr_force_primary_index_in_all_tables", &opt_cdr_force_primary_index_in_all_tables));
@@ -7844,9 +7944,11 @@ void cConfig::addConfigItems() {
 					addConfigItem((new FILE_LINE(42443) cConfigItem_integer("packetbuffer_total_maxheap", &opt_pcap_queue_store_queue_max_memory_size))
 						->setMultiple(1024 * 1024));
 					addConfigItem((new FILE_LINE(42444) cConfigItem_yesno("packetbuffer_compress_method"))
-						->addValues("snappy:1|s:1|lz4:2|l:2")
+						->addValues("snappy:1|s:1|lz4:2|l:2|lz4hc:3|lz4_hc:3|zstd:4|z:4|adaptive:5|auto:5")
 						->setDefaultValueStr("no"));
 					addConfigItem(new FILE_LINE(42445) cConfigItem_integer("packetbuffer_compress_ratio", &opt_pcap_queue_compress_ratio));
+					addConfigItem(new FILE_LINE(0) cConfigItem_integer("packetbuffer_compress_level", &opt_pcap_queue_compress_level));
+					addConfigItem(new FILE_LINE(0) cConfigItem_string("packetbuffer_compress_zstd_dictionary", &opt_pcap_queue_compress_zstd_dictionary));
 						obsolete();
 						addConfigItem(new FILE_LINE(42446) cConfigItem_yesno("pcap_dispatch", &opt_pcap_dispatch));
 		subgroup("storing packets into pcap files, graph, audio");
@@ -7885,6 +7987,11 @@ void cConfig::addConfigItems() {
 				addConfigItem((new FILE_LINE(0) cConfigItem_yesno("server_type_compress", (int*)&snifferServerOptions.type_compress))
 					->addValues("gzip:1|zip:1|lzo:2")
 					->setDefaultValueStr("yes"));
+				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("server_reactor", &snifferServerOptions.reactor));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("server_reactor_workers", &snifferServerOptions.reactor_workers));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("server_reactor_task_threads", &snifferServerOptions.reactor_task_threads));
+				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("packetbuffer_sender_aes_gcm", &snifferClientOptions.packetbuffer_aes_gcm));
+				addConfigItem(new FILE_LINE(0) cConfigItem_integer("packetbuffer_sender_window", &snifferClientOptions.packetbuffer_window));
 				addConfigItem(new FILE_LINE(0) cConfigItem_integer("client_server_connect_maximum_time_diff_s", &opt_client_server_connect_maximum_time_diff_s));
 				addConfigItem(new FILE_LINE(0) cConfigItem_integer("client_server_sleep_ms_if_queue_is_full", &opt_client_server_sleep_ms_if_queue_is_full));
 		subgroup("other");
@@ -7899,6 +8006,12 @@ void cConfig::addConfigItems() {
 			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_queue_limit", &opt_charts_cache_queue_limit));
 			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_remote_queue_limit", &opt_charts_cache_remote_queue_limit));
 			addConfigItem(new FILE_LINE(0) cConfigItem_integer("charts_cache_remote_concat_limit", &opt_charts_cache_remote_concat_limit));
+			addConfigItem((new FILE_LINE(0) cConfigItem_yesno("charts_percentile", &opt_charts_percentile))
+				->disableYes()
+				->disableNo()
+				->addValues("exact:0|sketch:1")
+				->setDefaultValueStr("exact"));
+			addConfigItem(new FILE_LINE(0) cConfigItem_float("charts_percentile_sketch_accuracy", &opt_charts_percentile_sketch_accuracy));
 				advanced();
 				addConfigItem(new FILE_LINE(0) cConfigItem_yesno("watchdog", &enable_wdt));
 				addConfigItem(new FILE_LINE(42460) cConfigItem_yesno("printinsertid", &opt_printinsertid));
@@ -8101,6 +8214,15 @@ void cConfig::evSetConfigItem(cConfigItem *configItem) {
 		case 2:
 			opt_pcap_queue_compress_method = pcap_block_store::lz4;
 			break;
+		case 3:
+			opt_pcap_queue_compress_method = pcap_block_store::lz4_hc;
+			break;
+		case 4:
+			opt_pcap_queue_compress_method = pcap_block_store::zstd;
+			break;
+		case 5:
+			opt_pcap_queue_compress_method = pcap_block_store::compress_method_adaptive;
+			break;
 		}
 	}
 	if((configItem->config_name == "mirror_destination" && ((cConfigItem_ip_port*)configItem)->getValue()) || 
@@ -8322,6 +8444,9 @@ void parse_command_line_arguments(int argc, char *argv[]) {
 	    {"eval-formula", 1, 0, 345},
 	    {"ipfix-client-emulation", 1, 0, 401},
 	    {"ws-calls", 1, 0, 402},
+	    {"benchmark", 1, 0, 403},
+	    {"benchmark-sql", 1, 0, 404},
+	    {"benchmark-corpus", 1, 0, 405},
 /*
 	    {"maxpoolsize", 1, 0, NULL},
 	    {"maxpooldays", 1, 0, NULL},
@@ -8523,6 +8648,7 @@ void parse_verb_param(string verbParam) {
 void get_command_line_arguments() {
 	get_command_line_arguments_mysql();
 	get_command_line_arguments_json_config();
+	string replayBenchmarkSqlMode;
 	for(map<int, string>::iterator iter = command_line_data.begin(); iter != command_line_data.end(); iter++) {
 		int c = iter->first;
 		char *optarg = NULL;
@@ -9027,11 +9153,42 @@ void get_command_line_arguments() {
 					ws_calls->load(optarg);
 				}
 				break;
+			case 403:
+				if(!replayBenchmark) {
+					replayBenchmark = new FILE_LINE(0) cReplayBenchmark(optarg);
+				}
+				opt_pb_read_from_file_speed = 0;
+				opt_continue_after_read = false;
+				opt_nonstop_read = false;
+				break;
+			case 404:
+				// applied after all options - replayBenchmark is created by --benchmark
+				replayBenchmarkSqlMode = optarg;
+				break;
+			case 405:
+				exit(generate_replay_corpus(optarg));
+				break;
 		}
 		if(optarg) {
 			delete [] optarg;
 		}
 	}
+	if(replayBenchmark) {
+		if(!replayBenchmarkSqlMode.empty()) {
+			replayBenchmark->setSqlMode(replayBenchmarkSqlMode.c_str());
+		}
+		switch(replayBenchmark->getSqlMode()) {
+		case cReplayBenchmark::_sql_none:
+			opt_nocdr = 1;
+			break;
+		case cReplayBenchmark::_sql_files:
+			opt_save_query_to_files = true;
+			opt_load_query_from_files = 0;
+			break;
+		case cReplayBenchmark::_sql_db:
+			break;
+		}
+	}
 }
 
 void get_command_line_arguments_mysql() {
@@ -9282,6 +9439,21 @@ void set_context_config() {
 			opt_cachedir[0] = '\0';
 			syslog(LOG_ERR, "option cachedir is not suported with option 'tar = yes'");
 		}
+		#ifndef HAVE_LIBZSTD
+		// config items map 'zstd' to 3 also in build without libzstd - tar_block_write would then write nothing
+		if(opt_pcap_dump_tar_compress_sip == 3) {
+			syslog(LOG_ERR, "missing zstd support - tar_compress_sip is set to gzip");
+			opt_pcap_dump_tar_compress_sip = 1;
+		}
+		if(opt_pcap_dump_tar_compress_rtp == 3) {
+			syslog(LOG_ERR, "missing zstd support - tar_compress_rtp is set to gzip");
+			opt_pcap_dump_tar_compress_rtp = 1;
+		}
+		if(opt_pcap_dump_tar_compress_graph == 3) {
+			syslog(LOG_ERR, "missing zstd support - tar_compress_graph is set to gzip");
+			opt_pcap_dump_tar_compress_graph = 1;
+		}
+		#endif //HAVE_LIBZSTD
 		if(opt_pcap_dump_tar_compress_sip) {
 			opt_pcap_dump_zip_sip = FileZipHandler::compress_na;
 		}
@@ -10254,6 +10426,46 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "dpdk_force_max_simd_bitwidth", NULL))) {
 		opt_dpdk_force_max_simd_bitwidth = atoi(value);
 	}
+	if((value = ini.GetValue("general", "tpacket", NULL))) {
+		opt_use_tpacket = yesno(value);
+	}
+	if((value = ini.GetValue("general", "tpacket_block_size", NULL))) {
+		opt_tpacket_block_size = atoi(value);
+	}
+	if((value = ini.GetValue("general", "tpacket_block_timeout", NULL))) {
+		opt_tpacket_block_timeout = atoi(value);
+	}
+	if((value = ini.GetValue("general", "tpacket_fanout", NULL))) {
+		opt_tpacket_fanout = !strcasecmp(value, "hash") || yesno(value) ? 1 :
+				     !strcasecmp(value, "cpu") ? 2 :
+				     !strcasecmp(value, "lb") ? 3 : 0;
+	}
+	if((value = ini.GetValue("general", "tpacket_fanout_threads", NULL))) {
+		opt_tpacket_fanout_threads = atoi(value);
+	}
+	if((value = ini.GetValue("general", "tpacket_zerocopy", NULL))) {
+		opt_tpacket_zerocopy = yesno(value);
+	}
+	if((value = ini.GetValue("general", "xdp", NULL))) {
+		opt_use_xdp = yesno(value);
+	}
+	if((value = ini.GetValue("general", "xdp_queues", NULL))) {
+		opt_xdp_queues = atoi(value);
+	}
+	if((value = ini.GetValue("general", "xdp_attach_mode", NULL))) {
+		opt_xdp_attach_mode = !strcasecmp(value, "skb") || !strcasecmp(value, "generic") ? 1 :
+				      !strcasecmp(value, "drv") || !strcasecmp(value, "native") ? 2 : 0;
+	}
+	if((value = ini.GetValue("general", "xdp_bind_mode", NULL))) {
+		opt_xdp_bind_mode = !strcasecmp(value, "copy") ? 1 :
+				    !strcasecmp(value, "zerocopy") ? 2 : 0;
+	}
+	if((value = ini.GetValue("general", "xdp_frame_size", NULL))) {
+		opt_xdp_frame_size = atoi(value);
+	}
+	if((value = ini.GetValue("general", "xdp_frames_in_packetbuffer", NULL))) {
+		opt_xdp_frames_in_packetbuffer = yesno(value);
+	}
 	if((value = ini.GetValue("general", "thread_affinity", NULL))) {
 		opt_cpu_cores = value;
 	}
@@ -10347,6 +10559,9 @@ int eval_config(string inistr) {
 		opt_cleanspool_use_files = yesno(value);
 		opt_cleanspool_use_files_set = true;
 	}
+	if((value = ini.GetValue("general", "cleanspool_index", NULL))) {
+		opt_cleanspool_index = yesno(value);
+	}
 	if((value = ini.GetValue("general", "cleanspool_interval", NULL))) {
 		opt_cleanspool_interval = atoi(value);
 	}
@@ -10596,6 +10811,15 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "deduplicate_ipheader_ignore_ttl", NULL))) {
 		opt_dup_check_ipheader_ignore_ttl = yesno(value);
 	}
+	if((value = ini.GetValue("general", "deduplicate_hash", NULL))) {
+		int dup_check_hash = dedup_hash_type_from_name(value);
+		if(dup_check_hash) {
+			opt_dup_check_hash = dup_check_hash;
+		}
+	}
+	if((value = ini.GetValue("general", "deduplicate_time_window_ms", NULL))) {
+		opt_dup_check_time_window_ms = atoi(value);
+	}
 	if((value = ini.GetValue("general", "dscp", NULL))) {
 		opt_dscp = yesno(value);
 	}
@@ -10991,6 +11215,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "managerip", NULL))) {
 		strcpy_null_term(opt_manager_ip, value);
 	}
+	if((value = ini.GetValue("general", "listcalls_delta_refresh", NULL))) {
+		opt_listcalls_delta_refresh_ms = atol(value);
+	}
 	if((value = ini.GetValue("general", "manager_nonblock_mode", NULL))) {
 		opt_manager_nonblock_mode = yesno(value);
 	}
@@ -11211,6 +11438,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "csv_store_format"))) {
 		opt_csv_store_format = yesno(value);
 	}
+	if((value = ini.GetValue("general", "mysql_load_data"))) {
+		opt_mysql_load_data = yesno(value);
+	}
 	if((value = ini.GetValue("general", "mysqlhost", NULL))) {
 		strcpy_null_term(mysql_host, value);
 	}
@@ -11306,6 +11536,12 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "odbcdriver", NULL))) {
 		strcpy_null_term(odbc_driver, value);
 	}
+	if((value = ini.GetValue("general", "odbc_array_insert", NULL))) {
+		opt_odbc_array_insert = yesno(value);
+	}
+	if((value = ini.GetValue("general", "odbc_array_insert_size", NULL))) {
+		opt_odbc_array_insert_size = atoi(value);
+	}
 	if((value = ini.GetValue("general", "cloud_host", NULL))) {
 		strcpy_null_term(cloud_host, value);
 	}
@@ -11692,6 +11928,15 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "charts_cache_remote_concat_limit", NULL))) {
 		opt_charts_cache_remote_concat_limit = atoi(value);
 	}
+	if((value = ini.GetValue("general", "charts_percentile", NULL))) {
+		// same values as config item: exact:0|sketch:1, other via yesno
+		opt_charts_percentile = !strcasecmp(value, "sketch") ? 1 :
+					!strcasecmp(value, "exact") ? 0 :
+					yesno(value);
+	}
+	if((value = ini.GetValue("general", "charts_percentile_sketch_accuracy", NULL))) {
+		opt_charts_percentile_sketch_accuracy = atof(value);
+	}
 	if((value = ini.GetValue("general", "convertchar", NULL))) {
 		strcpy_null_term(opt_convert_char, value);
 	}
@@ -11733,6 +11978,16 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "packetbuffer_file_path", NULL))) {
 		opt_pcap_queue_disk_folder = value;
 	}
+	if((value = ini.GetValue("general", "packetbuffer_file_io", NULL))) {
+		opt_pcap_queue_file_io = !strcasecmp(value, "direct") ? 1 :
+					 !strcasecmp(value, "uring") || !strcasecmp(value, "io_uring") ? 2 : 0;
+	}
+	if((value = ini.GetValue("general", "packetbuffer_file_io_threads", NULL))) {
+		opt_pcap_queue_file_io_threads = atoi(value);
+	}
+	if((value = ini.GetValue("general", "packetbuffer_file_readahead", NULL))) {
+		opt_pcap_queue_file_readahead = atol(value) * 1024ull * 1024ull;
+	}
 	/*
 	DEFAULT VALUES
 	if((value = ini.GetValue("general", "packetbuffer_file_maxfilesize", NULL))) {
@@ -11753,11 +12008,25 @@ int eval_config(string inistr) {
 			opt_pcap_queue_compress_method = pcap_block_store::snappy;
 		} else if(!strcmp(_opt_pcap_queue_compress_method, "lz4")) {
 			opt_pcap_queue_compress_method = pcap_block_store::lz4;
+		} else if(!strcmp(_opt_pcap_queue_compress_method, "lz4hc") ||
+			  !strcmp(_opt_pcap_queue_compress_method, "lz4_hc")) {
+			opt_pcap_queue_compress_method = pcap_block_store::lz4_hc;
+		} else if(!strcmp(_opt_pcap_queue_compress_method, "zstd")) {
+			opt_pcap_queue_compress_method = pcap_block_store::zstd;
+		} else if(!strcmp(_opt_pcap_queue_compress_method, "adaptive") ||
+			  !strcmp(_opt_pcap_queue_compress_method, "auto")) {
+			opt_pcap_queue_compress_method = pcap_block_store::compress_method_adaptive;
 		}
 	}
 	if((value = ini.GetValue("general", "packetbuffer_compress_ratio", NULL))) {
 		opt_pcap_queue_compress_ratio = atoi(value);
 	}
+	if((value = ini.GetValue("general", "packetbuffer_compress_level", NULL))) {
+		opt_pcap_queue_compress_level = atoi(value);
+	}
+	if((value = ini.GetValue("general", "packetbuffer_compress_zstd_dictionary", NULL))) {
+		opt_pcap_queue_compress_zstd_dictionary = value;
+	}
 	if((value = ini.GetValue("general", "mirror_destination_ip", NULL)) &&
 	   (value2 = ini.GetValue("general", "mirror_destination_port", NULL))) {
 		opt_pcap_queue_send_to_ip_port.set_ip(value);
@@ -11908,6 +12177,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "ssl_link_timeout", NULL))) {
 		opt_ssl_link_timeout = atol(value);
 	}
+	if((value = ini.GetValue("general", "ssl_tcp_reassembly_threads", NULL))) {
+		opt_ssl_tcp_reassembly_threads = atoi(value);
+	}
 	if((value = ini.GetValue("general", "ssl_ignore_tcp_handshake", NULL))) {
 		opt_ssl_ignore_tcp_handshake = yesno(value);
 	}
@@ -12218,60 +12490,87 @@ int eval_config(string inistr) {
 		opt_pcap_dump_tar_threads = atoi(value);
 	}
 	if((value = ini.GetValue("general", "tar_compress_sip", NULL))) {
-		switch(value[0]) {
-		case 'z':
-		case 'Z':
-		case 'g':
-		case 'G':
+		if(!strncasecmp(value, "zstd", 4)) {
+			#ifdef HAVE_LIBZSTD
+			opt_pcap_dump_tar_compress_sip = 3; // zstd
+			#else
+			syslog(LOG_ERR, "missing zstd support - tar_compress_sip is set to gzip");
 			opt_pcap_dump_tar_compress_sip = 1; // gzip
-			break;
-		case 'l':
-		case 'L':
-			opt_pcap_dump_tar_compress_sip = 2; // lzma
-			break;
-		case '0':
-		case 'n':
-		case 'N':
-			opt_pcap_dump_tar_compress_sip = 0; // na
-			break;
+			#endif //HAVE_LIBZSTD
+		} else {
+			switch(value[0]) {
+			case 'z':
+			case 'Z':
+			case 'g':
+			case 'G':
+				opt_pcap_dump_tar_compress_sip = 1; // gzip
+				break;
+			case 'l':
+			case 'L':
+				opt_pcap_dump_tar_compress_sip = 2; // lzma
+				break;
+			case '0':
+			case 'n':
+			case 'N':
+				opt_pcap_dump_tar_compress_sip = 0; // na
+				break;
+			}
 		}
 	}
 	if((value = ini.GetValue("general", "tar_compress_rtp", NULL))) {
-		switch(value[0]) {
-		case 'z':
-		case 'Z':
-		case 'g':
-		case 'G':
+		if(!strncasecmp(value, "zstd", 4)) {
+			#ifdef HAVE_LIBZSTD
+			opt_pcap_dump_tar_compress_rtp = 3; // zstd
+			#else
+			syslog(LOG_ERR, "missing zstd support - tar_compress_rtp is set to gzip");
 			opt_pcap_dump_tar_compress_rtp = 1; // gzip
-			break;
-		case 'l':
-		case 'L':
-			opt_pcap_dump_tar_compress_rtp = 2; // lzma
-			break;
-		case '0':
-		case 'n':
-		case 'N':
-			opt_pcap_dump_tar_compress_rtp = 0; // na
-			break;
+			#endif //HAVE_LIBZSTD
+		} else {
+			switch(value[0]) {
+			case 'z':
+			case 'Z':
+			case 'g':
+			case 'G':
+				opt_pcap_dump_tar_compress_rtp = 1; // gzip
+				break;
+			case 'l':
+			case 'L':
+				opt_pcap_dump_tar_compress_rtp = 2; // lzma
+				break;
+			case '0':
+			case 'n':
+			case 'N':
+				opt_pcap_dump_tar_compress_rtp = 0; // na
+				break;
+			}
 		}
 	}
 	if((value = ini.GetValue("general", "tar_compress_graph", NULL))) {
-		switch(value[0]) {
-		case 'z':
-		case 'Z':
-		case 'g':
-		case 'G':
+		if(!strncasecmp(value, "zstd", 4)) {
+			#ifdef HAVE_LIBZSTD
+			opt_pcap_dump_tar_compress_graph = 3; // zstd
+			#else
+			syslog(LOG_ERR, "missing zstd support - tar_compress_graph is set to gzip");
 			opt_pcap_dump_tar_compress_graph = 1; // gzip
-			break;
-		case 'l':
-		case 'L':
-			opt_pcap_dump_tar_compress_graph = 2; // lzma
-			break;
-		case '0':
-		case 'n':
-		case 'N':
-			opt_pcap_dump_tar_compress_graph = 0; // na
-			break;
+			#endif //HAVE_LIBZSTD
+		} else {
+			switch(value[0]) {
+			case 'z':
+			case 'Z':
+			case 'g':
+			case 'G':
+				opt_pcap_dump_tar_compress_graph = 1; // gzip
+				break;
+			case 'l':
+			case 'L':
+				opt_pcap_dump_tar_compress_graph = 2; // lzma
+				break;
+			case '0':
+			case 'n':
+			case 'N':
+				opt_pcap_dump_tar_compress_graph = 0; // na
+				break;
+			}
 		}
 	}
 	if((value = ini.GetValue("general", "tar_sip_level", NULL))) {
@@ -12283,6 +12582,15 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "tar_graph_level", NULL))) {
 		opt_pcap_dump_tar_graph_level = atoi(value);
 	}
+	if((value = ini.GetValue("general", "tar_seekable", NULL))) {
+		opt_pcap_dump_tar_seekable = yesno(value);
+	}
+	if((value = ini.GetValue("general", "tar_zstd_workers", NULL))) {
+		opt_pcap_dump_tar_zstd_workers = !strcasecmp(value, "auto") ? -1 : atoi(value);
+	}
+	if((value = ini.GetValue("general", "zstd_long_rtp", NULL))) {
+		opt_zstd_long_rtp = yesno(value);
+	}
 	if((value = ini.GetValue("general", "tar_internalcompress_sip", NULL))) {
 		opt_pcap_dump_tar_internalcompress_sip = CompressStream::convTypeCompress(value);
 	}
@@ -12504,6 +12812,9 @@ int eval_config(string inistr) {
 	if((value = ini.GetValue("general", "process_rtp_packets_qring_force_push", NULL))) {
 		opt_process_rtp_packets_qring_force_push = yesno(value);
 	}
+	if((value = ini.GetValue("general", "packet_latency_sample", NULL))) {
+		opt_packet_latency_sample = atol(value);
+	}
 	if((value = ini.GetValue("general", "cleanup_calls_period", NULL))) {
 		opt_cleanup_calls_period = atoi(value);
 	}
@@ -0,0 +1,785 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/ethtool.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sockios.h>
+#endif
+
+#include "tools_global.h"
+
+#include "xdp.h"
+
+
+using namespace std;
+
+
+#if defined(__linux__) && defined(XDP_USE_NEED_WAKEUP) && defined(__NR_bpf)
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#define XDP_RX_BATCH		64
+#define XDP_COMPLETION_RING_SIZE	64
+
+// linux/bpf.h can not be included together with pcap.h (struct bpf_insn) - used part of the ebpf interface
+#define XDP_BPF_MAP_CREATE		0
+#define XDP_BPF_MAP_UPDATE_ELEM		2
+#define XDP_BPF_PROG_LOAD		5
+#define XDP_BPF_MAP_TYPE_XSKMAP		17
+#define XDP_BPF_PROG_TYPE_XDP		6
+#define XDP_BPF_FUNC_redirect_map	51
+#define XDP_BPF_PSEUDO_MAP_FD		1
+#define XDP_BPF_XDP_PASS		2
+#define XDP_BPF_XDP_MD_RX_QUEUE_INDEX	16
+#define XDP_BPF_OP_LDX_MEM_W		0x61
+#define XDP_BPF_OP_LD_IMM_DW		0x18
+#define XDP_BPF_OP_ALU64_MOV_K		0xb7
+#define XDP_BPF_OP_CALL			0x85
+#define XDP_BPF_OP_EXIT			0x95
+
+struct sXdpBpfInsn {
+	u_int8_t code;
+	u_int8_t dst_reg:4;
+	u_int8_t src_reg:4;
+	int16_t off;
+	int32_t imm;
+};
+
+union sXdpBpfAttr {
+	struct {
+		u_int32_t map_type;
+		u_int32_t key_size;
+		u_int32_t value_size;
+		u_int32_t max_entries;
+	} map_create;
+	struct {
+		u_int32_t map_fd;
+		u_int64_t key __attribute__((aligned(8)));
+		u_int64_t value;
+		u_int64_t flags;
+	} map_elem;
+	struct {
+		u_int32_t prog_type;
+		u_int32_t insn_cnt;
+		u_int64_t insns;
+		u_int64_t license;
+		u_int32_t log_level;
+		u_int32_t log_size;
+		u_int64_t log_buf;
+	} prog_load;
+	u_char pad[128];
+};
+
+struct sXdpRing {
+	volatile u_int32_t *producer;
+	volatile u_int32_t *consumer;
+	volatile u_int32_t *flags;
+	void *desc;
+	u_int32_t size;
+	u_int32_t mask;
+	u_int32_t cached;
+	void *map;
+	size_t map_length;
+};
+
+struct sXdpUmem {
+	u_char *area;
+	size_t area_length;
+	unsigned frame_size;
+	unsigned frames;
+	u_int64_t *recycle;
+	unsigned recycle_count;
+	volatile int held;
+	volatile int _sync_recycle;
+	bool handle_destroyed;
+};
+
+struct sXdpProgram {
+	int prog_fd;
+	int map_fd;
+	u_int32_t attach_flags;
+	unsigned queues;
+	unsigned next_queue;
+	int users;
+};
+
+struct sXdp {
+	sXdp() {
+		fd = -1;
+		promisc_fd = -1;
+		ifindex = 0;
+		queue_id = 0;
+		umem = NULL;
+		memset(&fill, 0, sizeof(fill));
+		memset(&rx, 0, sizeof(rx));
+		free_frames = NULL;
+		free_frames_count = 0;
+		zerocopy = false;
+		memset(&filter, 0, sizeof(filter));
+		memset(&stat, 0, sizeof(stat));
+	}
+	sXdpConfig config;
+	int fd;
+	int promisc_fd;
+	int ifindex;
+	unsigned queue_id;
+	sXdpUmem *umem;
+	sXdpRing fill;
+	sXdpRing rx;
+	u_int64_t *free_frames;
+	unsigned free_frames_count;
+	bool zerocopy;
+	bpf_program filter;
+	struct {
+		u_int64_t packets;
+		u_int64_t bytes;
+		u_int64_t bpf_drop;
+		u_int64_t copied;
+	} stat;
+};
+
+
+static map<int, sXdpProgram*> xdp_programs;
+static volatile int _sync_xdp_programs = 0;
+
+
+static int xdp_bpf(int cmd, sXdpBpfAttr *attr) {
+	return(syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+}
+
+static int xdp_netlink_set_prog(int ifindex, int prog_fd, u_int32_t flags) {
+	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if(fd < 0) {
+		return(-errno);
+	}
+	struct {
+		nlmsghdr nh;
+		ifinfomsg ifinfo;
+		char attrbuf[64];
+	} req;
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	req.nh.nlmsg_type = RTM_SETLINK;
+	req.nh.nlmsg_seq = 1;
+	req.ifinfo.ifi_family = AF_UNSPEC;
+	req.ifinfo.ifi_index = ifindex;
+	rtattr *nest = (rtattr*)((char*)&req + NLMSG_ALIGN(req.nh.nlmsg_len));
+	nest->rta_type = NLA_F_NESTED | IFLA_XDP;
+	nest->rta_len = RTA_LENGTH(0);
+	rtattr *attr = (rtattr*)((char*)nest + nest->rta_len);
+	attr->rta_type = IFLA_XDP_FD;
+	attr->rta_len = RTA_LENGTH(sizeof(int));
+	memcpy(RTA_DATA(attr), &prog_fd, sizeof(int));
+	nest->rta_len += RTA_ALIGN(attr->rta_len);
+	if(flags) {
+		attr = (rtattr*)((char*)nest + nest->rta_len);
+		attr->rta_type = IFLA_XDP_FLAGS;
+		attr->rta_len = RTA_LENGTH(sizeof(u_int32_t));
+		memcpy(RTA_DATA(attr), &flags, sizeof(u_int32_t));
+		nest->rta_len += RTA_ALIGN(attr->rta_len);
+	}
+	req.nh.nlmsg_len = NLMSG_ALIGN(req.nh.nlmsg_len) + nest->rta_len;
+	sockaddr_nl sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	int rslt = 0;
+	if(sendto(fd, &req, req.nh.nlmsg_len, 0, (sockaddr*)&sa, sizeof(sa)) < 0) {
+		rslt = -errno;
+	} else {
+		char buf[4096];
+		int len = recv(fd, buf, sizeof(buf), 0);
+		if(len < 0) {
+			rslt = -errno;
+		} else {
+			for(nlmsghdr *nh = (nlmsghdr*)buf; NLMSG_OK(nh, (unsigned)len); nh = NLMSG_NEXT(nh, len)) {
+				if(nh->nlmsg_type == NLMSG_ERROR) {
+					rslt = ((nlmsgerr*)NLMSG_DATA(nh))->error;
+					break;
+				}
+			}
+		}
+	}
+	close(fd);
+	return(rslt);
+}
+
+static int xdp_program_load(int map_fd, string *error) {
+	// r2 = ctx->rx_queue_index; return bpf_redirect_map(&xsks_map, r2, XDP_PASS)
+	// (default action in flags - kernel >= 5.3, packets of queues without socket go to the kernel stack)
+	sXdpBpfInsn insns[6];
+	memset(insns, 0, sizeof(insns));
+	insns[0].code = XDP_BPF_OP_LDX_MEM_W;
+	insns[0].dst_reg = 2;
+	insns[0].src_reg = 1;
+	insns[0].off = XDP_BPF_XDP_MD_RX_QUEUE_INDEX;
+	insns[1].code = XDP_BPF_OP_LD_IMM_DW;
+	insns[1].dst_reg = 1;
+	insns[1].src_reg = XDP_BPF_PSEUDO_MAP_FD;
+	insns[1].imm = map_fd;
+	insns[3].code = XDP_BPF_OP_ALU64_MOV_K;
+	insns[3].dst_reg = 3;
+	insns[3].imm = XDP_BPF_XDP_PASS;
+	insns[4].code = XDP_BPF_OP_CALL;
+	insns[4].imm = XDP_BPF_FUNC_redirect_map;
+	insns[5].code = XDP_BPF_OP_EXIT;
+	static char license[] = "GPL";
+	char log[4096];
+	log[0] = 0;
+	sXdpBpfAttr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_load.prog_type = XDP_BPF_PROG_TYPE_XDP;
+	attr.prog_load.insn_cnt = sizeof(insns) / sizeof(insns[0]);
+	attr.prog_load.insns = (u_int64_t)(unsigned long)insns;
+	attr.prog_load.license = (u_int64_t)(unsigned long)license;
+	attr.prog_load.log_buf = (u_int64_t)(unsigned long)log;
+	attr.prog_load.log_size = sizeof(log);
+	attr.prog_load.log_level = 1;
+	int fd = xdp_bpf(XDP_BPF_PROG_LOAD, &attr);
+	if(fd < 0) {
+		*error = string("BPF_PROG_LOAD failed: ") + strerror(errno) + (log[0] ? string(" - ") + log : "");
+	}
+	return(fd);
+}
+
+static sXdpProgram *xdp_program_get(sXdpConfig *config, int ifindex, string *error) {
+	while(__sync_lock_test_and_set(&_sync_xdp_programs, 1));
+	map<int, sXdpProgram*>::iterator iter = xdp_programs.find(ifindex);
+	if(iter != xdp_programs.end()) {
+		++iter->second->users;
+		__sync_lock_release(&_sync_xdp_programs);
+		return(iter->second);
+	}
+	sXdpProgram *program = NULL;
+	unsigned queues = xdp_queues_count(config->device);
+	if(config->queue_id >= 0 && (unsigned)config->queue_id >= queues) {
+		queues = config->queue_id + 1;
+	}
+	sXdpBpfAttr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_create.map_type = XDP_BPF_MAP_TYPE_XSKMAP;
+	attr.map_create.key_size = sizeof(int);
+	attr.map_create.value_size = sizeof(int);
+	attr.map_create.max_entries = queues;
+	int map_fd = xdp_bpf(XDP_BPF_MAP_CREATE, &attr);
+	if(map_fd < 0) {
+		*error = string("BPF_MAP_CREATE (xskmap) failed: ") + strerror(errno);
+	} else {
+		int prog_fd = xdp_program_load(map_fd, error);
+		if(prog_fd >= 0) {
+			u_int32_t attach_flags = XDP_FLAGS_UPDATE_IF_NOEXIST |
+						 (config->attach_mode == _xdp_attach_skb ? XDP_FLAGS_SKB_MODE : XDP_FLAGS_DRV_MODE);
+			int rslt = xdp_netlink_set_prog(ifindex, prog_fd, attach_flags);
+			if(rslt < 0 && rslt != -EBUSY && config->attach_mode == _xdp_attach_auto) {
+				// driver without native xdp - generic (skb) mode, sockets can be bound only in copy mode
+				attach_flags = XDP_FLAGS_UPDATE_IF_NOEXIST | XDP_FLAGS_SKB_MODE;
+				rslt = xdp_netlink_set_prog(ifindex, prog_fd, attach_flags);
+			}
+			if(rslt < 0) {
+				*error = string("attach xdp program failed: ") + strerror(-rslt) +
+					 (rslt == -EBUSY ? string(" (interface already has xdp program - ip link set dev ") + config->device + " xdp off)" : "");
+				close(prog_fd);
+				close(map_fd);
+			} else {
+				program = new FILE_LINE(0) sXdpProgram;
+				program->prog_fd = prog_fd;
+				program->map_fd = map_fd;
+				program->attach_flags = attach_flags;
+				program->queues = queues;
+				program->next_queue = 0;
+				program->users = 1;
+				xdp_programs[ifindex] = program;
+			}
+		} else {
+			close(map_fd);
+		}
+	}
+	__sync_lock_release(&_sync_xdp_programs);
+	return(program);
+}
+
+static void xdp_program_put(int ifindex) {
+	while(__sync_lock_test_and_set(&_sync_xdp_programs, 1));
+	map<int, sXdpProgram*>::iterator iter = xdp_programs.find(ifindex);
+	if(iter != xdp_programs.end() && !--iter->second->users) {
+		sXdpProgram *program = iter->second;
+		xdp_netlink_set_prog(ifindex, -1, program->attach_flags & XDP_FLAGS_MODES);
+		close(program->prog_fd);
+		close(program->map_fd);
+		delete program;
+		xdp_programs.erase(iter);
+	}
+	__sync_lock_release(&_sync_xdp_programs);
+}
+
+static void xdp_umem_free(sXdpUmem *umem) {
+	munmap(umem->area, umem->area_length);
+	delete [] umem->recycle;
+	delete umem;
+}
+
+static bool xdp_ring_map(int fd, sXdpRing *ring, xdp_ring_offset *off, u_int32_t size, size_t desc_size, u_int64_t pgoff) {
+	ring->map_length = off->desc + size * desc_size;
+	ring->map = mmap(NULL, ring->map_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, pgoff);
+	if(ring->map == MAP_FAILED) {
+		ring->map = NULL;
+		return(false);
+	}
+	ring->producer = (u_int32_t*)((u_char*)ring->map + off->producer);
+	ring->consumer = (u_int32_t*)((u_char*)ring->map + off->consumer);
+	ring->flags = (u_int32_t*)((u_char*)ring->map + off->flags);
+	ring->desc = (u_char*)ring->map + off->desc;
+	ring->size = size;
+	ring->mask = size - 1;
+	return(true);
+}
+
+static void xdp_fill(sXdp *xdp) {
+	sXdpUmem *umem = xdp->umem;
+	if(umem->recycle_count) {
+		while(__sync_lock_test_and_set(&umem->_sync_recycle, 1));
+		memcpy(xdp->free_frames + xdp->free_frames_count, umem->recycle, umem->recycle_count * sizeof(u_int64_t));
+		xdp->free_frames_count += umem->recycle_count;
+		umem->recycle_count = 0;
+		__sync_lock_release(&umem->_sync_recycle);
+	}
+	if(!xdp->free_frames_count) {
+		return;
+	}
+	sXdpRing *fill = &xdp->fill;
+	u_int32_t free = fill->size - (fill->cached - __atomic_load_n(fill->consumer, __ATOMIC_ACQUIRE));
+	if(free > xdp->free_frames_count) {
+		free = xdp->free_frames_count;
+	}
+	for(u_int32_t i = 0; i < free; i++) {
+		((u_int64_t*)fill->desc)[(fill->cached + i) & fill->mask] = xdp->free_frames[--xdp->free_frames_count];
+	}
+	fill->cached += free;
+	__atomic_store_n(fill->producer, fill->cached, __ATOMIC_RELEASE);
+	if(free && (*fill->flags & XDP_RING_NEED_WAKEUP)) {
+		recvfrom(xdp->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+	}
+}
+
+
+bool xdp_is_supported() {
+	return(true);
+}
+
+sXdpHandle *create_xdp_handle() {
+	return(new FILE_LINE(0) sXdp);
+}
+
+void destroy_xdp_handle(sXdpHandle *xdp) {
+	if(xdp->fd >= 0) {
+		// socket is removed from xskmap by the kernel
+		close(xdp->fd);
+	}
+	if(xdp->promisc_fd >= 0) {
+		close(xdp->promisc_fd);
+	}
+	if(xdp->fill.map) {
+		munmap(xdp->fill.map, xdp->fill.map_length);
+	}
+	if(xdp->rx.map) {
+		munmap(xdp->rx.map, xdp->rx.map_length);
+	}
+	if(xdp->ifindex) {
+		xdp_program_put(xdp->ifindex);
+	}
+	if(xdp->umem) {
+		sXdpUmem *umem = xdp->umem;
+		while(__sync_lock_test_and_set(&umem->_sync_recycle, 1));
+		bool free = umem->held <= 0;
+		umem->handle_destroyed = true;
+		__sync_lock_release(&umem->_sync_recycle);
+		if(free) {
+			xdp_umem_free(umem);
+		} else {
+			// frames referenced by packetbuffer - umem is freed by the last xdp_frames_release
+			syslog(LOG_NOTICE, "xdp %s: %i umem frames still held", xdp->config.device, umem->held);
+		}
+	}
+	if(xdp->free_frames) {
+		delete [] xdp->free_frames;
+	}
+	if(xdp->filter.bf_insns) {
+		pcap_freecode(&xdp->filter);
+	}
+	delete xdp;
+}
+
+int xdp_activate(sXdpConfig *config, sXdpHandle *xdp, std::string *error) {
+	xdp->config = *config;
+	char errorstr[1024];
+	xdp->ifindex = if_nametoindex(config->device);
+	if(!xdp->ifindex) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: unknown interface", config->device);
+		*error = errorstr;
+		return(-1);
+	}
+	// umem pages are pinned and bpf objects are charged to memlock on older kernels
+	rlimit rlim = { RLIM_INFINITY, RLIM_INFINITY };
+	setrlimit(RLIMIT_MEMLOCK, &rlim);
+	string programError;
+	sXdpProgram *program = xdp_program_get(config, xdp->ifindex, &programError);
+	if(!program) {
+		xdp->ifindex = 0;
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: %s", config->device, programError.c_str());
+		*error = errorstr;
+		return(-1);
+	}
+	if(config->queue_id >= 0) {
+		xdp->queue_id = config->queue_id;
+	} else {
+		while(__sync_lock_test_and_set(&_sync_xdp_programs, 1));
+		xdp->queue_id = program->next_queue++ % program->queues;
+		__sync_lock_release(&_sync_xdp_programs);
+	}
+	unsigned frame_size = 2048;
+	while(frame_size < config->frame_size && frame_size < (unsigned)getpagesize()) {
+		frame_size <<= 1;
+	}
+	unsigned frames = 1024;
+	while(frames * 2 <= config->frames) {
+		frames <<= 1;
+	}
+	xdp->config.frame_size = frame_size;
+	xdp->config.frames = frames;
+	sXdpUmem *umem = new FILE_LINE(0) sXdpUmem;
+	memset(umem, 0, sizeof(*umem));
+	umem->frame_size = frame_size;
+	umem->frames = frames;
+	umem->area_length = (size_t)frame_size * frames;
+	void *area = mmap(NULL, umem->area_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if(area == MAP_FAILED) {
+		delete umem;
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: umem mmap (%u x %u) failed: %s", config->device, frames, frame_size, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	umem->area = (u_char*)area;
+	umem->recycle = new FILE_LINE(0) u_int64_t[frames];
+	xdp->umem = umem;
+	xdp->free_frames = new FILE_LINE(0) u_int64_t[frames];
+	for(unsigned i = 0; i < frames; i++) {
+		xdp->free_frames[xdp->free_frames_count++] = (u_int64_t)i * frame_size;
+	}
+	xdp->fd = socket(AF_XDP, SOCK_RAW, 0);
+	if(xdp->fd < 0) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: socket failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	xdp_umem_reg mr;
+	memset(&mr, 0, sizeof(mr));
+	mr.addr = (u_int64_t)(unsigned long)umem->area;
+	mr.len = umem->area_length;
+	mr.chunk_size = frame_size;
+	mr.headroom = 0;
+	if(setsockopt(xdp->fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: XDP_UMEM_REG failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	unsigned ring_size = frames;
+	unsigned completion_size = XDP_COMPLETION_RING_SIZE;
+	if(setsockopt(xdp->fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0 ||
+	   setsockopt(xdp->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &completion_size, sizeof(completion_size)) < 0 ||
+	   setsockopt(xdp->fd, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: set rings (%u) failed: %s", config->device, ring_size, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	xdp_mmap_offsets off;
+	socklen_t optlen = sizeof(off);
+	if(getsockopt(xdp->fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: XDP_MMAP_OFFSETS failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	if(!xdp_ring_map(xdp->fd, &xdp->fill, &off.fr, ring_size, sizeof(u_int64_t), XDP_UMEM_PGOFF_FILL_RING) ||
+	   !xdp_ring_map(xdp->fd, &xdp->rx, &off.rx, ring_size, sizeof(xdp_desc), XDP_PGOFF_RX_RING)) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: mmap rings failed: %s", config->device, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	xdp_fill(xdp);
+	sockaddr_xdp sxdp;
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = xdp->ifindex;
+	sxdp.sxdp_queue_id = xdp->queue_id;
+	int bindRslt = -1;
+	if(config->bind_mode != _xdp_bind_copy && !(program->attach_flags & XDP_FLAGS_SKB_MODE)) {
+		sxdp.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+		bindRslt = bind(xdp->fd, (sockaddr*)&sxdp, sizeof(sxdp));
+		xdp->zerocopy = bindRslt == 0;
+	}
+	if(bindRslt < 0 && config->bind_mode != _xdp_bind_zerocopy) {
+		sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+		bindRslt = bind(xdp->fd, (sockaddr*)&sxdp, sizeof(sxdp));
+	}
+	if(bindRslt < 0) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: bind to queue %u%s failed: %s",
+			 config->device, xdp->queue_id, config->bind_mode == _xdp_bind_zerocopy ? " (zerocopy)" : "", strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	int key = xdp->queue_id;
+	sXdpBpfAttr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_elem.map_fd = program->map_fd;
+	attr.map_elem.key = (u_int64_t)(unsigned long)&key;
+	attr.map_elem.value = (u_int64_t)(unsigned long)&xdp->fd;
+	attr.map_elem.flags = 0;
+	if(xdp_bpf(XDP_BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+		snprintf(errorstr, sizeof(errorstr), "xdp %s: xskmap update (queue %u) failed: %s", config->device, xdp->queue_id, strerror(errno));
+		*error = errorstr;
+		return(-1);
+	}
+	if(config->promisc) {
+		// packet socket without protocol receives nothing, promiscuous mode is dropped with the socket
+		xdp->promisc_fd = socket(AF_PACKET, SOCK_RAW, 0);
+		packet_mreq mreq;
+		memset(&mreq, 0, sizeof(mreq));
+		mreq.mr_ifindex = xdp->ifindex;
+		mreq.mr_type = PACKET_MR_PROMISC;
+		if(xdp->promisc_fd < 0 ||
+		   setsockopt(xdp->promisc_fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+			syslog(LOG_NOTICE, "xdp %s: set promiscuous mode failed: %s", config->device, strerror(errno));
+		}
+	}
+	syslog(LOG_NOTICE, "xdp %s: queue %u, %s mode, %s xdp, umem %u x %u",
+	       config->device, xdp->queue_id,
+	       xdp->zerocopy ? "zerocopy" : "copy",
+	       program->attach_flags & XDP_FLAGS_SKB_MODE ? "generic" : "native",
+	       frames, frame_size);
+	return(0);
+}
+
+int xdp_setfilter(sXdpHandle *xdp, bpf_program *filter, std::string */*error*/) {
+	// socket filter can not be attached to AF_XDP socket - filter runs in xdp_read_proc
+	xdp->filter.bf_len = filter->bf_len;
+	xdp->filter.bf_insns = (bpf_insn*)malloc(filter->bf_len * sizeof(*filter->bf_insns));
+	memcpy(xdp->filter.bf_insns, filter->bf_insns, filter->bf_len * sizeof(*filter->bf_insns));
+	return(0);
+}
+
+int xdp_read_proc(sXdpHandle *xdp) {
+	xdp_fill(xdp);
+	sXdpRing *rx = &xdp->rx;
+	u_int32_t avail = __atomic_load_n(rx->producer, __ATOMIC_ACQUIRE) - rx->cached;
+	if(!avail) {
+		pollfd pfd;
+		pfd.fd = xdp->fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		poll(&pfd, 1, xdp->config.read_timeout_ms);
+		avail = __atomic_load_n(rx->producer, __ATOMIC_ACQUIRE) - rx->cached;
+		if(!avail) {
+			return(0);
+		}
+	}
+	if(avail > XDP_RX_BATCH) {
+		avail = XDP_RX_BATCH;
+	}
+	sXdpUmem *umem = xdp->umem;
+	sXdpConfig *config = &xdp->config;
+	sDpdkCallback *callback = &config->callback;
+	u_int64_t frame_mask = ~((u_int64_t)umem->frame_size - 1);
+	pcap_pkthdr header;
+	gettimeofday(&header.ts, NULL);
+	for(u_int32_t i = 0; i < avail; i++) {
+		xdp_desc *desc = &((xdp_desc*)rx->desc)[(rx->cached + i) & rx->mask];
+		u_char *packet = umem->area + desc->addr;
+		u_int64_t frame = desc->addr & frame_mask;
+		++xdp->stat.packets;
+		xdp->stat.bytes += desc->len;
+		header.len = desc->len;
+		header.caplen = config->snapshot > 0 && desc->len > (u_int32_t)config->snapshot ? config->snapshot : desc->len;
+		if(xdp->filter.bf_insns &&
+		   !pcap_offline_filter(&xdp->filter, &header, packet)) {
+			++xdp->stat.bpf_drop;
+			xdp->free_frames[xdp->free_frames_count++] = frame;
+			continue;
+		}
+		if(config->frames_in_packetbuffer &&
+		   (unsigned)umem->held * 100 < umem->frames * config->frames_max_held_perc) {
+			// frame is owned by packetbuffer block until xdp_frames_release
+			__sync_add_and_fetch(&umem->held, 1);
+			callback->packet_process__mbufs_in_packetbuffer(callback->packet_user, &header, packet);
+		} else {
+			u_int32_t packet_maxlen;
+			u_char *dst = callback->packet_allocation(callback->packet_user, &packet_maxlen);
+			if(header.caplen > packet_maxlen) {
+				header.caplen = packet_maxlen;
+			}
+			memcpy(dst, packet, header.caplen);
+			callback->packet_completion(callback->packet_user, &header, dst);
+			xdp->free_frames[xdp->free_frames_count++] = frame;
+			++xdp->stat.copied;
+		}
+	}
+	rx->cached += avail;
+	__atomic_store_n(rx->consumer, rx->cached, __ATOMIC_RELEASE);
+	return(avail);
+}
+
+void xdp_frames_release(void *umem, u_char **packets, unsigned count) {
+	sXdpUmem *_umem = (sXdpUmem*)umem;
+	u_int64_t frame_mask = ~((u_int64_t)_umem->frame_size - 1);
+	while(__sync_lock_test_and_set(&_umem->_sync_recycle, 1));
+	for(unsigned i = 0; i < count; i++) {
+		_umem->recycle[_umem->recycle_count++] = (u_int64_t)(packets[i] - _umem->area) & frame_mask;
+	}
+	// held is incremented by the rx thread without _sync_recycle
+	int held = __sync_sub_and_fetch(&_umem->held, count);
+	bool free = _umem->handle_destroyed && held <= 0;
+	__sync_lock_release(&_umem->_sync_recycle);
+	if(free) {
+		xdp_umem_free(_umem);
+	}
+}
+
+void *xdp_umem(sXdpHandle *xdp) {
+	return(xdp->umem);
+}
+
+int xdp_queues_count(const char *device) {
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(fd < 0) {
+		return(1);
+	}
+	ethtool_channels channels;
+	memset(&channels, 0, sizeof(channels));
+	channels.cmd = ETHTOOL_GCHANNELS;
+	ifreq ifr;
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, device, IFNAMSIZ - 1);
+	ifr.ifr_data = (char*)&channels;
+	int queues = 1;
+	if(ioctl(fd, SIOCETHTOOL, &ifr) == 0) {
+		queues = channels.combined_count + channels.rx_count;
+		if(queues < 1) {
+			queues = 1;
+		}
+	}
+	close(fd);
+	return(queues);
+}
+
+int pcap_xdp_stats(sXdpHandle *xdp, pcap_stat *ps, std::string *str_out) {
+	xdp_statistics kstats;
+	socklen_t kstats_len = sizeof(kstats);
+	memset(&kstats, 0, sizeof(kstats));
+	if(getsockopt(xdp->fd, SOL_XDP, XDP_STATISTICS, &kstats, &kstats_len) < 0) {
+		return(-1);
+	}
+	u_int64_t drops = kstats.rx_dropped + kstats.rx_ring_full;
+	if(ps) {
+		ps->ps_recv = xdp->stat.packets + drops + kstats.rx_fill_ring_empty_descs;
+		ps->ps_drop = drops + xdp->stat.bpf_drop;
+		ps->ps_ifdrop = kstats.rx_fill_ring_empty_descs;
+	}
+	if(str_out) {
+		ostringstream outStr;
+		outStr << "XDP "
+		       << xdp->config.device
+		       << " queue " << xdp->queue_id
+		       << " " << (xdp->zerocopy ? "zerocopy" : "copy")
+		       << " [packets: " << xdp->stat.packets
+		       << "; copied: " << xdp->stat.copied
+		       << "; drops: " << kstats.rx_dropped
+		       << "; ring full: " << kstats.rx_ring_full
+		       << "; fill ring empty: " << kstats.rx_fill_ring_empty_descs
+		       << "; bpf drop: " << xdp->stat.bpf_drop
+		       << "; held frames: " << xdp->umem->held << "/" << xdp->umem->frames
+		       << "]";
+		*str_out = outStr.str();
+	}
+	return(0);
+}
+
+sXdpConfig *xdp_config(sXdpHandle *xdp) {
+	return(&xdp->config);
+}
+
+
+#else
+
+
+struct sXdp {
+	sXdpConfig config;
+};
+
+bool xdp_is_supported() {
+	return(false);
+}
+
+sXdpHandle *create_xdp_handle() {
+	return(NULL);
+}
+
+void destroy_xdp_handle(sXdpHandle */*xdp*/) {
+}
+
+int xdp_activate(sXdpConfig */*config*/, sXdpHandle */*xdp*/, std::string *error) {
+	*error = "not supported";
+	return(-1);
+}
+
+int xdp_setfilter(sXdpHandle */*xdp*/, bpf_program */*filter*/, std::string *error) {
+	*error = "not supported";
+	return(-1);
+}
+
+int xdp_read_proc(sXdpHandle */*xdp*/) {
+	return(0);
+}
+
+void xdp_frames_release(void */*umem*/, u_char **/*packets*/, unsigned /*count*/) {
+}
+
+void *xdp_umem(sXdpHandle */*xdp*/) {
+	return(NULL);
+}
+
+int xdp_queues_count(const char */*device*/) {
+	return(1);
+}
+
+int pcap_xdp_stats(sXdpHandle */*xdp*/, pcap_stat */*ps*/, std::string */*str_out*/) {
+	return(-1);
+}
+
+sXdpConfig *xdp_config(sXdpHandle *xdp) {
+	return(&xdp->config);
+}
+
+
+#endif
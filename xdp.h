@@ -0,0 +1,70 @@
+#ifndef XDP_H
+#define XDP_H
+
+
+#include <pcap.h>
+#include <string>
+#include <string.h>
+#include <sys/types.h>
+
+#include "dpdk.h"
+
+
+/**
+  * AF_XDP capture (kernel bypass without hugepages and nic binding - the nic stays under its kernel driver).
+  * A small xdp program redirects packets of bound rx queues to the socket, packets are received into UMEM frames.
+  * Packets are delivered through the same callbacks as in dpdk (sDpdkCallback):
+  * packet_allocation / packet_completion - packet is copied into packetbuffer block and the frame is refilled at once,
+  * packet_process__mbufs_in_packetbuffer - frame is referenced from pcap_block_store and returned to the fill ring
+  * by xdp_frames_release when the block is destroyed.
+  * Socket is bound in zerocopy mode on capable drivers, otherwise (e.g. veth, generic xdp) in copy mode.
+*/
+
+enum eXdpAttachMode {
+	_xdp_attach_auto = 0,
+	_xdp_attach_skb = 1,
+	_xdp_attach_drv = 2
+};
+
+enum eXdpBindMode {
+	_xdp_bind_auto = 0,
+	_xdp_bind_copy = 1,
+	_xdp_bind_zerocopy = 2
+};
+
+struct sXdpConfig {
+	char device[100];
+	int snapshot;
+	int promisc;
+	int queue_id;
+	unsigned frames;
+	unsigned frame_size;
+	eXdpAttachMode attach_mode;
+	eXdpBindMode bind_mode;
+	bool frames_in_packetbuffer;
+	unsigned frames_max_held_perc;
+	int read_timeout_ms;
+	sDpdkCallback callback;
+	sXdpConfig() {
+		memset(this, 0, sizeof(*this));
+		queue_id = -1;
+	}
+};
+
+typedef struct sXdp sXdpHandle;
+
+
+bool xdp_is_supported();
+sXdpHandle *create_xdp_handle();
+void destroy_xdp_handle(sXdpHandle *xdp);
+int xdp_activate(sXdpConfig *config, sXdpHandle *xdp, std::string *error);
+int xdp_setfilter(sXdpHandle *xdp, bpf_program *filter, std::string *error);
+int xdp_read_proc(sXdpHandle *xdp);
+void xdp_frames_release(void *umem, u_char **packets, unsigned count);
+void *xdp_umem(sXdpHandle *xdp);
+int xdp_queues_count(const char *device);
+int pcap_xdp_stats(sXdpHandle *xdp, pcap_stat *ps, std::string *str_out = NULL);
+sXdpConfig *xdp_config(sXdpHandle *xdp);
+
+
+#endif //XDP_H